@@ -212,6 +212,7 @@ static void *run_maintenance(void *opaque) {
     uint64_t now;
     sleep_maintenance_interval(MAINTENANCE_POLL_INTERVAL_MS);
     if (shutdown_requested) break;
+    (void)YAP_V2_http_runtime_maintain_memtable(maintenance->http_runtime);
     if (maintenance_has_foreground_work(maintenance)) {
       YAP_V2_http_runtime_record_maintenance_deferral(
         maintenance->http_runtime);
@@ -305,6 +306,15 @@ int main(int argc, char **argv) {
     runtime_policy = application.runtime_policy;
     io_threads = application.core_io_threads;
     search_threads = application.core_search_threads;
+    YAP_V2_http_set_ann_build_threads(application.ann_build_threads);
+    YAP_V2_http_set_memtable_policy(application.memtable_max_operations,
+                                    application.memtable_max_age_ms);
+    YAP_V2_http_set_wal_durability(application.wal_durability,
+                                   application.wal_sync_interval_ms);
+    YAP_V2_http_set_latency_precision(application.latency_precision_bits);
+    YAP_V2_http_set_slow_query_log(application.slow_query_entries,
+                                   application.slow_query_interval_seconds,
+                                   application.slow_query_sample_one_in);
     writer_queue_capacity = application.core_writer_queue_capacity;
     writer_queue_bytes = application.core_writer_queue_bytes;
     compaction_policy = application.compaction_policy;
@@ -331,6 +341,7 @@ int main(int argc, char **argv) {
     YAP_V2_RUNTIME_POLICY writer_policy = runtime_policy;
     writer_policy.max_inflight = writer_queue_capacity + 1U;
     writer_policy.max_inflight_bytes = writer_queue_bytes;
+    writer_policy.adaptive_concurrency = 0;
     if (YAP_V2_runtime_limiter_init(&writer_limiter, &writer_policy) != YAP_V2_OK) {
       fputs("Invalid writer queue policy\n", stderr);
       YAP_V2_runtime_limiter_close(&runtime_limiter);
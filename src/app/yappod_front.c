@@ -31,6 +31,7 @@ typedef enum {
   ENDPOINT_METRICS,
   ENDPOINT_SEARCH,
   ENDPOINT_RETRIEVE,
+  ENDPOINT_SUGGEST,
   ENDPOINT_PREPARE,
   ENDPOINT_INGEST
 } endpoint_t;
@@ -219,6 +220,7 @@ static endpoint_t endpoint_for(const char *method, const char *target) {
   if (strcmp(method, "POST") == 0 || strcmp(method, "QUERY") == 0) {
     if (strcmp(target, "/v2/search") == 0) return ENDPOINT_SEARCH;
     if (strcmp(target, "/v2/retrieve") == 0) return ENDPOINT_RETRIEVE;
+    if (strcmp(target, "/v2/suggest") == 0) return ENDPOINT_SUGGEST;
   }
   if (strcmp(method, "POST") == 0) {
     if (strcmp(target, "/v2/passages:prepare") == 0) return ENDPOINT_PREPARE;
@@ -230,7 +232,7 @@ static endpoint_t endpoint_for(const char *method, const char *target) {
 static int is_known_target(const char *target) {
   return strcmp(target, "/health/live") == 0 || strcmp(target, "/health/ready") == 0 ||
          strcmp(target, "/metrics") == 0 || strcmp(target, "/v2/search") == 0 ||
-         strcmp(target, "/v2/retrieve") == 0 ||
+         strcmp(target, "/v2/retrieve") == 0 || strcmp(target, "/v2/suggest") == 0 ||
          strcmp(target, "/v2/passages:prepare") == 0 ||
          strcmp(target, "/v2/documents:batch") == 0;
 }
@@ -390,13 +392,22 @@ static int discard_request_body(FILE *stream, size_t body_bytes) {
   return 0;
 }
 
+/* Searches spend only what is left of the front budget, which the core receives as
+ * X-Yappo-Timeout-Ms and uses to drop the query if it would start too late. */
+static uint32_t remaining_timeout_ms(uint64_t started) {
+  uint64_t elapsed_ms = (YAP_V2_monotonic_microseconds() - started) / 1000U;
+  if (elapsed_ms >= runtime_policy.request_timeout_ms) return 1U;
+  return runtime_policy.request_timeout_ms - (uint32_t)elapsed_ms;
+}
+
 static int core_roundtrip(worker_t *worker, endpoint_t endpoint,
                           const unsigned char *body, size_t body_bytes,
-                          const char *authorization,
+                          const char *authorization, uint64_t started,
                           core_result_t *result) {
   const char *method = endpoint == ENDPOINT_INGEST ? "POST" : "QUERY";
   const char *target = endpoint == ENDPOINT_SEARCH ? "/v2/search" :
                        endpoint == ENDPOINT_RETRIEVE ? "/v2/retrieve" :
+                       endpoint == ENDPOINT_SUGGEST ? "/v2/suggest" :
                        "/v2/documents:batch";
   YAP_V2_CORE_HTTP_RESPONSE response;
   memset(result, 0, sizeof(*result));
@@ -405,7 +416,7 @@ static int core_roundtrip(worker_t *worker, endpoint_t endpoint,
                                       worker->core_host, worker->core_port,
                                       endpoint == ENDPOINT_INGEST ?
                                       runtime_policy.ingest_timeout_ms :
-                                      runtime_policy.request_timeout_ms,
+                                      remaining_timeout_ms(started),
                                       method, target,
                                       endpoint == ENDPOINT_INGEST ? authorization : NULL,
                                       body, body_bytes, &response) != YAP_V2_CORE_HTTP_OK)
@@ -455,6 +466,12 @@ static int handle_operational(FILE *stream, worker_t *worker, endpoint_t endpoin
                            "application/json; charset=utf-8", body, body_bytes);
   } else {
     size_t inflight, inflight_bytes, max_inflight, max_inflight_bytes;
+    YAP_V2_RUNTIME_LIMITER_STATE admission;
+    if (YAP_V2_runtime_limiter_state(&runtime_limiter, &admission) != YAP_V2_OK)
+      return send_json_error(stream, 500, "internal_error", "Internal Server Error");
+    state.front_concurrency_limit = admission.limit;
+    state.front_rtt_noload_microseconds = admission.rtt_noload_microseconds;
+    state.front_admission_rejected = admission.rejected;
     if (YAP_V2_runtime_limiter_snapshot(&runtime_limiter, &inflight, &inflight_bytes,
                                         &max_inflight, &max_inflight_bytes) != YAP_V2_OK ||
         YAP_V2_metrics_render(&metrics, &state, inflight, inflight_bytes, max_inflight,
@@ -468,13 +485,14 @@ static int handle_operational(FILE *stream, worker_t *worker, endpoint_t endpoin
 }
 
 static YAP_V2_OBSERVE_OPERATION observe_operation(endpoint_t endpoint) {
-  return endpoint == ENDPOINT_SEARCH ? YAP_V2_OBSERVE_SEARCH :
+  return (endpoint == ENDPOINT_SEARCH || endpoint == ENDPOINT_SUGGEST) ? YAP_V2_OBSERVE_SEARCH :
          (endpoint == ENDPOINT_RETRIEVE || endpoint == ENDPOINT_PREPARE) ?
          YAP_V2_OBSERVE_RETRIEVE : YAP_V2_OBSERVE_INGEST;
 }
 
 static const char *allow_for_target(const char *target) {
-  if (strcmp(target, "/v2/search") == 0 || strcmp(target, "/v2/retrieve") == 0)
+  if (strcmp(target, "/v2/search") == 0 || strcmp(target, "/v2/retrieve") == 0 ||
+      strcmp(target, "/v2/suggest") == 0)
     return "QUERY, POST";
   if (strcmp(target, "/v2/passages:prepare") == 0 ||
       strcmp(target, "/v2/documents:batch") == 0)
@@ -487,7 +505,8 @@ static const char *allow_for_target(const char *target) {
 }
 
 static int query_endpoint(endpoint_t endpoint) {
-  return endpoint == ENDPOINT_SEARCH || endpoint == ENDPOINT_RETRIEVE;
+  return endpoint == ENDPOINT_SEARCH || endpoint == ENDPOINT_RETRIEVE ||
+         endpoint == ENDPOINT_SUGGEST;
 }
 
 static int send_endpoint_error(FILE *stream, endpoint_t endpoint, int status,
@@ -503,7 +522,7 @@ static int handle_client(FILE *stream, worker_t *worker) {
   core_result_t result;
   YAP_V2_RUNTIME_LIMITER *admission_limiter = NULL;
   int read_status, header_status, response_status = 500;
-  uint64_t started = 0U;
+  uint64_t started = 0U, elapsed;
   read_status = read_line(stream, &line);
   if (read_status <= 0 || parse_request_line(line, &request) != 0) {
     free(line);
@@ -529,7 +548,8 @@ static int handle_client(FILE *stream, worker_t *worker) {
       known ? "Method Not Allowed" : "Not Found",
       known ? allow_for_target(request.target) : NULL,
       strcmp(request.target, "/v2/search") == 0 ||
-      strcmp(request.target, "/v2/retrieve") == 0);
+      strcmp(request.target, "/v2/retrieve") == 0 ||
+      strcmp(request.target, "/v2/suggest") == 0);
   }
   if (request.endpoint == ENDPOINT_LIVE || request.endpoint == ENDPOINT_READY ||
       request.endpoint == ENDPOINT_METRICS) {
@@ -590,7 +610,7 @@ static int handle_client(FILE *stream, worker_t *worker) {
     result.body = (unsigned char *)prepared; result.body_bytes = prepared_bytes;
   } else if (core_roundtrip(worker, request.endpoint, body, request.content_length,
                             request.authorization[0] == '\0' ? NULL : request.authorization,
-                            &result) != 0) {
+                            started, &result) != 0) {
     response_status = 503;
     (void)send_endpoint_error(stream, request.endpoint, response_status,
                               "core_unavailable", "Service Unavailable");
@@ -603,11 +623,22 @@ static int handle_client(FILE *stream, worker_t *worker) {
                               result.body, result.body_bytes);
   free(result.body);
 observed:
-  if (admission_limiter != NULL)
+  elapsed = YAP_V2_monotonic_microseconds() - started;
+  /* Only completed searches are latency samples; fast failures would fake a low RTT. A 503
+   * that used up the whole budget is a timeout or deadline miss and backs the limit off. */
+  if (admission_limiter != NULL && response_status >= 200 && response_status < 300)
+    YAP_V2_runtime_limiter_release_observed(admission_limiter, request.content_length,
+                                            elapsed);
+  else if (admission_limiter != NULL && response_status == 503 &&
+           elapsed >= (uint64_t)(request.endpoint == ENDPOINT_INGEST ?
+                                 runtime_policy.ingest_timeout_ms :
+                                 runtime_policy.request_timeout_ms) * 1000U)
+    YAP_V2_runtime_limiter_release_dropped(admission_limiter, request.content_length);
+  else if (admission_limiter != NULL)
     YAP_V2_runtime_limiter_release(admission_limiter, request.content_length);
   free(body);
   YAP_V2_metrics_record(&metrics, observe_operation(request.endpoint), response_status,
-                        YAP_V2_monotonic_microseconds() - started);
+                        elapsed);
   return 0;
 }
 
@@ -645,6 +676,7 @@ int main(int argc, char **argv) {
   size_t io_threads = YAP_APPLICATION_DEFAULT_IO_THREADS;
   size_t writer_queue_capacity = 1U;
   size_t writer_queue_bytes = YAP_APPLICATION_DEFAULT_WRITER_QUEUE_BYTES;
+  unsigned latency_precision_bits = YAP_APPLICATION_DEFAULT_LATENCY_PRECISION_BITS;
   int foreground = 0, have_port = 0, have_core_port = 0;
   YAP_V2_compaction_policy_init(&compaction_policy);
   for (i = 1; i < argc; i++) {
@@ -693,6 +725,7 @@ int main(int argc, char **argv) {
     io_threads = application.front_io_threads;
     writer_queue_capacity = application.core_writer_queue_capacity;
     writer_queue_bytes = application.core_writer_queue_bytes;
+    latency_precision_bits = application.latency_precision_bits;
     compaction_policy = application.compaction_policy;
     if (!foreground && set_run_paths(application.run_directory) != 0) {
       fprintf(stderr, "Cannot create run directory: %s\n", strerror(errno));
@@ -722,9 +755,10 @@ int main(int argc, char **argv) {
     YAP_V2_RUNTIME_POLICY ingest_policy = runtime_policy;
     ingest_policy.max_inflight = writer_queue_capacity + 1U;
     ingest_policy.max_inflight_bytes = writer_queue_bytes;
+    ingest_policy.adaptive_concurrency = 0;
     if (YAP_V2_runtime_limiter_init(&runtime_limiter, &runtime_policy) != YAP_V2_OK ||
         YAP_V2_runtime_limiter_init(&ingest_limiter, &ingest_policy) != YAP_V2_OK ||
-        YAP_V2_metrics_init(&metrics) != YAP_V2_OK) {
+        YAP_V2_metrics_init_with_precision(&metrics, latency_precision_bits) != YAP_V2_OK) {
       fprintf(stderr, "Invalid runtime policy: %s\n", policy_error);
       YAP_V2_runtime_limiter_close(&ingest_limiter);
       YAP_V2_runtime_limiter_close(&runtime_limiter);
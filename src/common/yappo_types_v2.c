@@ -1,5 +1,7 @@
 #include "common/yappo_types_v2.h"
 
+#include <time.h>
+
 static int bytes_view_validate(YAP_V2_BYTES_VIEW value, size_t max_bytes, int required) {
   size_t i;
 
@@ -41,6 +43,8 @@ const char *YAP_V2_status_string(YAP_V2_STATUS status) {
     return "not found";
   case YAP_V2_SEGMENT_CAPACITY_EXCEEDED:
     return "segment capacity exceeded";
+  case YAP_V2_CANCELLED:
+    return "cancelled";
   default:
     return "unknown status";
   }
@@ -102,3 +106,43 @@ int YAP_V2_passage_validate(const YAP_V2_PASSAGE_VIEW *passage) {
   }
   return YAP_V2_OK;
 }
+
+void YAP_V2_cancellation_init(YAP_V2_CANCELLATION *cancellation,
+                              uint64_t deadline_microseconds) {
+  if (cancellation == NULL) return;
+  cancellation->deadline_microseconds = deadline_microseconds;
+  cancellation->cancelled = 0;
+}
+
+void YAP_V2_cancellation_cancel(YAP_V2_CANCELLATION *cancellation) {
+  if (cancellation != NULL)
+    __atomic_store_n(&cancellation->cancelled, 1, __ATOMIC_RELEASE);
+}
+
+uint64_t YAP_V2_cancellation_clock_microseconds(void) {
+  struct timespec now;
+  if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) return 0U;
+  return (uint64_t)now.tv_sec * 1000000U + (uint64_t)now.tv_nsec / 1000U;
+}
+
+int YAP_V2_cancellation_requested(const YAP_V2_CANCELLATION *cancellation) {
+  if (cancellation == NULL) return 0;
+  if (__atomic_load_n(&cancellation->cancelled, __ATOMIC_ACQUIRE)) return 1;
+  return cancellation->deadline_microseconds != 0U &&
+         YAP_V2_cancellation_clock_microseconds() >= cancellation->deadline_microseconds;
+}
+
+uint32_t YAP_V2_crc32c_update(uint32_t crc, const unsigned char *data, size_t len) {
+  size_t i;
+  unsigned int bit;
+  for (i = 0U; i < len; i++) {
+    crc ^= data[i];
+    for (bit = 0U; bit < 8U; bit++)
+      crc = (crc & 1U) != 0U ? (crc >> 1) ^ UINT32_C(0x82f63b78) : crc >> 1;
+  }
+  return crc;
+}
+
+uint32_t YAP_V2_crc32c(const unsigned char *data, size_t len) {
+  return ~YAP_V2_crc32c_update(UINT32_MAX, data, len);
+}
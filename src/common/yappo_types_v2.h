@@ -21,7 +21,8 @@ typedef enum {
   YAP_V2_CHECKSUM_MISMATCH = -7,
   YAP_V2_CONFLICT = -8,
   YAP_V2_NOT_FOUND = -9,
-  YAP_V2_SEGMENT_CAPACITY_EXCEEDED = -10
+  YAP_V2_SEGMENT_CAPACITY_EXCEEDED = -10,
+  YAP_V2_CANCELLED = -11
 } YAP_V2_STATUS;
 
 /* A byte view never owns data. All text values must be UTF-8 without NUL bytes. */
@@ -48,7 +49,25 @@ typedef struct {
   uint32_t end_char;
 } YAP_V2_PASSAGE_VIEW;
 
+/* Cooperative cancellation shared by a request owner and the thread executing it.
+ * deadline_microseconds is CLOCK_MONOTONIC time, 0 for none; cancelled is set by
+ * YAP_V2_cancellation_cancel from any thread. Long loops poll between units of work. */
+typedef struct {
+  uint64_t deadline_microseconds;
+  int cancelled;
+} YAP_V2_CANCELLATION;
+
 const char *YAP_V2_status_string(YAP_V2_STATUS status);
+void YAP_V2_cancellation_init(YAP_V2_CANCELLATION *cancellation,
+                              uint64_t deadline_microseconds);
+void YAP_V2_cancellation_cancel(YAP_V2_CANCELLATION *cancellation);
+/* Returns 1 after cancel or once the deadline has passed; NULL never cancels. */
+int YAP_V2_cancellation_requested(const YAP_V2_CANCELLATION *cancellation);
+uint64_t YAP_V2_cancellation_clock_microseconds(void);
+/* CRC-32C (Castagnoli) of the checksummed v2 file sections. The update form continues a
+ * running value that starts at UINT32_MAX and is inverted once at the end. */
+uint32_t YAP_V2_crc32c(const unsigned char *data, size_t len);
+uint32_t YAP_V2_crc32c_update(uint32_t crc, const unsigned char *data, size_t len);
 int YAP_V2_document_validate(const YAP_V2_DOCUMENT_VIEW *document);
 int YAP_V2_passage_validate(const YAP_V2_PASSAGE_VIEW *passage);
 
@@ -1,5 +1,6 @@
 #include "common/yappo_unicode.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -8,72 +9,217 @@
 #include <unicode/unorm2.h>
 #include <unicode/ustring.h>
 #include <unicode/utf16.h>
+#include <unicode/uvernum.h>
 
+/* Opening a break iterator compiles its rules, so each thread clones the shared
+ * prototypes once and rebinds the clones with ubrk_setText.  The UTF-16 and offset
+ * buffers stay with the thread and only grow. */
 typedef struct {
+  UBreakIterator *words;
+  UBreakIterator *graphemes;
+  UBreakIterator *sentences;
+  UChar *source;
+  size_t source_capacity;
   UChar *text;
-  int32_t length;
+  size_t text_capacity;
   int32_t *byte_offsets;
+  size_t byte_offset_capacity;
   uint32_t *char_offsets;
+  size_t char_offset_capacity;
+} TOKENIZER_CONTEXT;
+
+typedef struct {
+  const UChar *text;
+  int32_t length;
+  const int32_t *byte_offsets;
+  const uint32_t *char_offsets;
   char *utf8;
   size_t utf8_bytes;
 } NORMALIZED_TEXT;
 
-static void normalized_free(NORMALIZED_TEXT *text) {
-  if (text == NULL) return;
-  free(text->text); free(text->byte_offsets); free(text->char_offsets); free(text->utf8);
-  memset(text, 0, sizeof(*text));
+static pthread_once_t context_once = PTHREAD_ONCE_INIT;
+static pthread_key_t context_key;
+static const UNormalizer2 *nfkc_casefold;
+static UBreakIterator *word_prototype, *grapheme_prototype, *sentence_prototype;
+static int context_ready;
+
+static void context_destroy(void *value) {
+  TOKENIZER_CONTEXT *context = value;
+  if (context == NULL) return;
+  if (context->words != NULL) ubrk_close(context->words);
+  if (context->graphemes != NULL) ubrk_close(context->graphemes);
+  if (context->sentences != NULL) ubrk_close(context->sentences);
+  free(context->source); free(context->text);
+  free(context->byte_offsets); free(context->char_offsets);
+  free(context);
+}
+
+static void context_init_once(void) {
+  UErrorCode error = U_ZERO_ERROR;
+  if (pthread_key_create(&context_key, context_destroy) != 0) return;
+  nfkc_casefold = unorm2_getNFKCCasefoldInstance(&error);
+  word_prototype = ubrk_open(UBRK_WORD, "root", NULL, 0, &error);
+  grapheme_prototype = ubrk_open(UBRK_CHARACTER, "root", NULL, 0, &error);
+  sentence_prototype = ubrk_open(UBRK_SENTENCE, "root", NULL, 0, &error);
+  context_ready = U_SUCCESS(error);
+}
+
+static UBreakIterator *clone_iterator(const UBreakIterator *prototype, UErrorCode *error) {
+#if U_ICU_VERSION_MAJOR_NUM >= 69
+  return ubrk_clone(prototype, error);
+#else
+  return ubrk_safeClone(prototype, NULL, NULL, error);
+#endif
+}
+
+static TOKENIZER_CONTEXT *context_get(void) {
+  TOKENIZER_CONTEXT *context;
+  UErrorCode error = U_ZERO_ERROR;
+  if (pthread_once(&context_once, context_init_once) != 0 || !context_ready) return NULL;
+  context = (TOKENIZER_CONTEXT *)pthread_getspecific(context_key);
+  if (context != NULL) return context;
+  context = (TOKENIZER_CONTEXT *)calloc(1U, sizeof(*context));
+  if (context == NULL) return NULL;
+  context->words = clone_iterator(word_prototype, &error);
+  context->graphemes = clone_iterator(grapheme_prototype, &error);
+  context->sentences = clone_iterator(sentence_prototype, &error);
+  if (U_FAILURE(error) || pthread_setspecific(context_key, context) != 0) {
+    context_destroy(context);
+    return NULL;
+  }
+  return context;
 }
 
-static int normalize_text(const char *utf8, size_t bytes, NORMALIZED_TEXT *out) {
-  const UNormalizer2 *normalizer;
-  UChar *source = NULL;
-  int32_t source_length = 0, normalized_length, utf8_length = 0;
+static int reserve(void **buffer, size_t *capacity, size_t count, size_t size) {
+  void *grown;
+  size_t next;
+  if (count <= *capacity) return YAP_V2_OK;
+  next = *capacity == 0U ? 256U : *capacity;
+  while (next < count) next = next > SIZE_MAX / 2U ? count : next * 2U;
+  if (next > SIZE_MAX / size) return YAP_V2_ALLOCATION_FAILED;
+  grown = realloc(*buffer, next * size);
+  if (grown == NULL) return YAP_V2_ALLOCATION_FAILED;
+  *buffer = grown; *capacity = next;
+  return YAP_V2_OK;
+}
+
+static int reserve_text(TOKENIZER_CONTEXT *context, size_t units) {
+  if (reserve((void **)&context->text, &context->text_capacity, units,
+              sizeof(*context->text)) != YAP_V2_OK ||
+      reserve((void **)&context->byte_offsets, &context->byte_offset_capacity, units,
+              sizeof(*context->byte_offsets)) != YAP_V2_OK ||
+      reserve((void **)&context->char_offsets, &context->char_offset_capacity, units,
+              sizeof(*context->char_offsets)) != YAP_V2_OK)
+    return YAP_V2_ALLOCATION_FAILED;
+  return YAP_V2_OK;
+}
+
+#define ASCII_HIGH_BITS UINT64_C(0x8080808080808080)
+#define ASCII_REPEAT(byte) (UINT64_C(0x0101010101010101) * (uint64_t)(byte))
+
+/* Eight bytes at a time: a set high bit anywhere means the input is not ASCII. */
+static int is_ascii(const char *utf8, size_t bytes) {
+  size_t i = 0U;
+  unsigned char tail = 0U;
+  for (; i + 8U <= bytes; i += 8U) {
+    uint64_t word;
+    memcpy(&word, utf8 + i, sizeof(word));
+    if ((word & ASCII_HIGH_BITS) != 0U) return 0;
+  }
+  for (; i < bytes; i++) tail |= (unsigned char)utf8[i];
+  return tail < 0x80U;
+}
+
+/* NFKC casefolding maps ASCII only by lowercasing A-Z.  For ASCII bytes the two
+ * additions below cannot carry across byte lanes, so their high bits mark the
+ * lanes that are >= 'A' and > 'Z'. */
+static void ascii_casefold(char *output, const char *utf8, size_t bytes) {
+  size_t i = 0U;
+  for (; i + 8U <= bytes; i += 8U) {
+    uint64_t word, upper;
+    memcpy(&word, utf8 + i, sizeof(word));
+    upper = (word + ASCII_REPEAT(0x80U - 'A')) & ~(word + ASCII_REPEAT(0x80U - 'Z' - 1U)) &
+            ASCII_HIGH_BITS;
+    word |= upper >> 2U;
+    memcpy(output + i, &word, sizeof(word));
+  }
+  for (; i < bytes; i++)
+    output[i] = utf8[i] >= 'A' && utf8[i] <= 'Z' ? (char)(utf8[i] - 'A' + 'a') : utf8[i];
+}
+
+static int normalize_ascii(TOKENIZER_CONTEXT *context, const char *utf8, size_t bytes,
+                           NORMALIZED_TEXT *out) {
+  size_t i;
+  if (reserve_text(context, bytes + 1U) != YAP_V2_OK) return YAP_V2_ALLOCATION_FAILED;
+  out->utf8 = (char *)malloc(bytes + 1U);
+  if (out->utf8 == NULL) return YAP_V2_ALLOCATION_FAILED;
+  ascii_casefold(out->utf8, utf8, bytes);
+  out->utf8[bytes] = '\0';
+  for (i = 0U; i <= bytes; i++) {
+    context->text[i] = (UChar)(unsigned char)out->utf8[i];
+    context->byte_offsets[i] = (int32_t)i;
+    context->char_offsets[i] = (uint32_t)i;
+  }
+  out->utf8_bytes = bytes;
+  out->length = (int32_t)bytes;
+  return YAP_V2_OK;
+}
+
+static int normalize_text(TOKENIZER_CONTEXT *context, const char *utf8, size_t bytes,
+                          NORMALIZED_TEXT *out) {
+  int32_t source_length = 0, normalized_length, length, utf8_length = 0;
   int32_t i, byte_offset = 0;
   uint32_t char_offset = 0;
   UErrorCode error = U_ZERO_ERROR;
+  int status;
   if (utf8 == NULL || out == NULL || bytes > INT32_MAX) return YAP_V2_INVALID_ARGUMENT;
   memset(out, 0, sizeof(*out));
-  u_strFromUTF8(NULL, 0, &source_length, utf8, (int32_t)bytes, &error);
-  if (error != U_BUFFER_OVERFLOW_ERROR && U_FAILURE(error)) return YAP_V2_INVALID_FORMAT;
-  error = U_ZERO_ERROR;
-  source = (UChar *)malloc(((size_t)source_length + 1U) * sizeof(*source));
-  if (source == NULL) return YAP_V2_ALLOCATION_FAILED;
-  u_strFromUTF8(source, source_length + 1, NULL, utf8, (int32_t)bytes, &error);
-  if (U_FAILURE(error)) { free(source); return YAP_V2_INVALID_FORMAT; }
-  normalizer = unorm2_getNFKCCasefoldInstance(&error);
-  if (U_FAILURE(error)) { free(source); return YAP_V2_INVALID_FORMAT; }
-  normalized_length = unorm2_normalize(normalizer, source, source_length, NULL, 0, &error);
-  if (error != U_BUFFER_OVERFLOW_ERROR && U_FAILURE(error)) { free(source); return YAP_V2_INVALID_FORMAT; }
-  error = U_ZERO_ERROR;
-  out->text = (UChar *)malloc(((size_t)normalized_length + 1U) * sizeof(*out->text));
-  if (out->text == NULL) { free(source); return YAP_V2_ALLOCATION_FAILED; }
-  out->length = unorm2_normalize(normalizer, source, source_length, out->text,
-                                 normalized_length + 1, &error);
-  free(source);
-  if (U_FAILURE(error)) { normalized_free(out); return YAP_V2_INVALID_FORMAT; }
-  u_strToUTF8(NULL, 0, &utf8_length, out->text, out->length, &error);
-  if (error != U_BUFFER_OVERFLOW_ERROR && U_FAILURE(error)) { normalized_free(out); return YAP_V2_INVALID_FORMAT; }
-  error = U_ZERO_ERROR;
-  out->utf8 = (char *)malloc((size_t)utf8_length + 1U);
-  out->byte_offsets = (int32_t *)calloc((size_t)out->length + 1U, sizeof(*out->byte_offsets));
-  out->char_offsets = (uint32_t *)calloc((size_t)out->length + 1U, sizeof(*out->char_offsets));
-  if (out->utf8 == NULL || out->byte_offsets == NULL || out->char_offsets == NULL) {
-    normalized_free(out); return YAP_V2_ALLOCATION_FAILED;
-  }
-  u_strToUTF8(out->utf8, utf8_length + 1, NULL, out->text, out->length, &error);
-  if (U_FAILURE(error)) { normalized_free(out); return YAP_V2_INVALID_FORMAT; }
-  out->utf8_bytes = (size_t)utf8_length;
-  i = 0;
-  while (i < out->length) {
-    int32_t start = i;
-    UChar32 cp;
-    U16_NEXT(out->text, i, out->length, cp);
-    out->byte_offsets[start] = byte_offset;
-    out->char_offsets[start] = char_offset;
-    if (i - start == 2) { out->byte_offsets[start + 1] = byte_offset; out->char_offsets[start + 1] = char_offset; }
-    byte_offset += U8_LENGTH(cp); char_offset++;
-    out->byte_offsets[i] = byte_offset; out->char_offsets[i] = char_offset;
+  if (is_ascii(utf8, bytes)) status = normalize_ascii(context, utf8, bytes, out);
+  else {
+    u_strFromUTF8(NULL, 0, &source_length, utf8, (int32_t)bytes, &error);
+    if (error != U_BUFFER_OVERFLOW_ERROR && U_FAILURE(error)) return YAP_V2_INVALID_FORMAT;
+    error = U_ZERO_ERROR;
+    if (reserve((void **)&context->source, &context->source_capacity,
+                (size_t)source_length + 1U, sizeof(*context->source)) != YAP_V2_OK)
+      return YAP_V2_ALLOCATION_FAILED;
+    u_strFromUTF8(context->source, source_length + 1, NULL, utf8, (int32_t)bytes, &error);
+    if (U_FAILURE(error)) return YAP_V2_INVALID_FORMAT;
+    normalized_length = unorm2_normalize(nfkc_casefold, context->source, source_length,
+                                         NULL, 0, &error);
+    if (error != U_BUFFER_OVERFLOW_ERROR && U_FAILURE(error)) return YAP_V2_INVALID_FORMAT;
+    error = U_ZERO_ERROR;
+    if (reserve_text(context, (size_t)normalized_length + 1U) != YAP_V2_OK)
+      return YAP_V2_ALLOCATION_FAILED;
+    length = unorm2_normalize(nfkc_casefold, context->source, source_length, context->text,
+                              normalized_length + 1, &error);
+    if (U_FAILURE(error)) return YAP_V2_INVALID_FORMAT;
+    u_strToUTF8(NULL, 0, &utf8_length, context->text, length, &error);
+    if (error != U_BUFFER_OVERFLOW_ERROR && U_FAILURE(error)) return YAP_V2_INVALID_FORMAT;
+    error = U_ZERO_ERROR;
+    out->utf8 = (char *)malloc((size_t)utf8_length + 1U);
+    if (out->utf8 == NULL) return YAP_V2_ALLOCATION_FAILED;
+    u_strToUTF8(out->utf8, utf8_length + 1, NULL, context->text, length, &error);
+    if (U_FAILURE(error)) { free(out->utf8); out->utf8 = NULL; return YAP_V2_INVALID_FORMAT; }
+    out->utf8_bytes = (size_t)utf8_length;
+    out->length = length;
+    i = 0;
+    context->byte_offsets[0] = 0; context->char_offsets[0] = 0U;
+    while (i < length) {
+      int32_t start = i;
+      UChar32 cp;
+      U16_NEXT(context->text, i, length, cp);
+      context->byte_offsets[start] = byte_offset;
+      context->char_offsets[start] = char_offset;
+      if (i - start == 2) { context->byte_offsets[start + 1] = byte_offset; context->char_offsets[start + 1] = char_offset; }
+      byte_offset += U8_LENGTH(cp); char_offset++;
+      context->byte_offsets[i] = byte_offset; context->char_offsets[i] = char_offset;
+    }
+    status = YAP_V2_OK;
   }
+  if (status != YAP_V2_OK) { free(out->utf8); memset(out, 0, sizeof(*out)); return status; }
+  out->text = context->text;
+  out->byte_offsets = context->byte_offsets;
+  out->char_offsets = context->char_offsets;
   return YAP_V2_OK;
 }
 
@@ -82,39 +228,113 @@ void YAP_V2_token_sequence_free(YAP_V2_TOKEN_SEQUENCE *sequence) {
   free(sequence->normalized_utf8); free(sequence->tokens); memset(sequence, 0, sizeof(*sequence));
 }
 
+static int append_token(YAP_V2_TOKEN_SEQUENCE *sequence, size_t *capacity,
+                        const NORMALIZED_TEXT *text, int32_t start, int32_t end) {
+  YAP_V2_TOKEN *token;
+  if (reserve((void **)&sequence->tokens, capacity, sequence->token_count + 1U,
+              sizeof(*sequence->tokens)) != YAP_V2_OK)
+    return YAP_V2_ALLOCATION_FAILED;
+  token = &sequence->tokens[sequence->token_count++];
+  token->byte_start = (size_t)text->byte_offsets[start];
+  token->byte_end = (size_t)text->byte_offsets[end];
+  token->char_start = text->char_offsets[start];
+  token->char_end = text->char_offsets[end];
+  return YAP_V2_OK;
+}
+
+/* ICU's word rules add '@' to the letters. */
+static int is_ascii_word(UChar c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '@';
+}
+
+/* UAX #29 joins ASCII words only through '_' and through . ' , ; : between two
+ * letters or digits.  Without those, every word is a maximal run of letters and
+ * digits, which is what the ICU word iterator returns. */
+static int ascii_piece_is_simple(const UChar *text, int32_t start, int32_t end) {
+  int32_t i;
+  for (i = start; i < end; i++) {
+    UChar c = text[i];
+    if (c >= 0x80U || c == '_') return 0;
+    if ((c == '.' || c == '\'' || c == ',' || c == ';' || c == ':') && i > start &&
+        i + 1 < end && is_ascii_word(text[i - 1]) && is_ascii_word(text[i + 1]))
+      return 0;
+  }
+  return 1;
+}
+
+static int tokenize_ascii(YAP_V2_TOKEN_SEQUENCE *sequence, size_t *capacity,
+                          const NORMALIZED_TEXT *text, int32_t start, int32_t end) {
+  int32_t i = start;
+  while (i < end) {
+    int32_t word;
+    while (i < end && !is_ascii_word(text->text[i])) i++;
+    word = i;
+    while (i < end && is_ascii_word(text->text[i])) i++;
+    if (word < i && append_token(sequence, capacity, text, word, i) != YAP_V2_OK)
+      return YAP_V2_ALLOCATION_FAILED;
+  }
+  return YAP_V2_OK;
+}
+
+static int tokenize_icu(TOKENIZER_CONTEXT *context, YAP_V2_TOKEN_SEQUENCE *sequence,
+                        size_t *capacity, const NORMALIZED_TEXT *text,
+                        int32_t start, int32_t end) {
+  UErrorCode error = U_ZERO_ERROR;
+  int32_t first, last;
+  if (start >= end) return YAP_V2_OK;
+  ubrk_setText(context->words, text->text + start, end - start, &error);
+  if (U_FAILURE(error)) return YAP_V2_INVALID_FORMAT;
+  for (first = ubrk_first(context->words), last = ubrk_next(context->words);
+       last != UBRK_DONE; first = last, last = ubrk_next(context->words)) {
+    if (ubrk_getRuleStatus(context->words) == UBRK_WORD_NONE) continue;
+    if (append_token(sequence, capacity, text, start + first, start + last) != YAP_V2_OK)
+      return YAP_V2_ALLOCATION_FAILED;
+  }
+  return YAP_V2_OK;
+}
+
+/* An ASCII space or control character followed by a printable ASCII character is
+ * always a word boundary, so the text is cut there into pieces.  Simple ASCII
+ * pieces skip ICU; consecutive remaining pieces go through the word iterator as
+ * one range. */
+static int tokenize_text(TOKENIZER_CONTEXT *context, YAP_V2_TOKEN_SEQUENCE *sequence,
+                         const NORMALIZED_TEXT *text) {
+  size_t capacity = 0U;
+  int32_t piece = 0, pending = 0, i;
+  int status = YAP_V2_OK;
+  for (i = 1; status == YAP_V2_OK && i <= text->length; i++) {
+    if (i < text->length && !(text->text[i - 1] <= 0x20U && text->text[i] > 0x20U &&
+                              text->text[i] < 0x80U))
+      continue;
+    if (ascii_piece_is_simple(text->text, piece, i)) {
+      status = tokenize_icu(context, sequence, &capacity, text, pending, piece);
+      if (status == YAP_V2_OK) status = tokenize_ascii(sequence, &capacity, text, piece, i);
+      pending = i;
+    }
+    piece = i;
+  }
+  if (status == YAP_V2_OK)
+    status = tokenize_icu(context, sequence, &capacity, text, pending, text->length);
+  return status;
+}
+
 int YAP_V2_unicode_tokenize(const char *utf8, size_t utf8_bytes, YAP_V2_TOKEN_SEQUENCE *sequence) {
+  TOKENIZER_CONTEXT *context;
   NORMALIZED_TEXT text;
-  UBreakIterator *iterator;
-  UErrorCode error = U_ZERO_ERROR;
-  int32_t start, end;
-  size_t count = 0U;
   int status;
   if (sequence == NULL) return YAP_V2_INVALID_ARGUMENT;
   memset(sequence, 0, sizeof(*sequence));
-  status = normalize_text(utf8, utf8_bytes, &text);
+  context = context_get();
+  if (context == NULL) return YAP_V2_ALLOCATION_FAILED;
+  status = normalize_text(context, utf8, utf8_bytes, &text);
   if (status != YAP_V2_OK) return status;
-  iterator = ubrk_open(UBRK_WORD, "root", text.text, text.length, &error);
-  if (U_FAILURE(error)) { normalized_free(&text); return YAP_V2_INVALID_FORMAT; }
-  for (start = ubrk_first(iterator), end = ubrk_next(iterator); end != UBRK_DONE;
-       start = end, end = ubrk_next(iterator)) {
-    if (ubrk_getRuleStatus(iterator) != UBRK_WORD_NONE) count++;
-  }
-  sequence->tokens = count == 0U ? NULL : (YAP_V2_TOKEN *)calloc(count, sizeof(*sequence->tokens));
-  if (count > 0U && sequence->tokens == NULL) { ubrk_close(iterator); normalized_free(&text); return YAP_V2_ALLOCATION_FAILED; }
-  count = 0U;
-  for (start = ubrk_first(iterator), end = ubrk_next(iterator); end != UBRK_DONE;
-       start = end, end = ubrk_next(iterator)) {
-    if (ubrk_getRuleStatus(iterator) == UBRK_WORD_NONE) continue;
-    sequence->tokens[count].byte_start = (size_t)text.byte_offsets[start];
-    sequence->tokens[count].byte_end = (size_t)text.byte_offsets[end];
-    sequence->tokens[count].char_start = text.char_offsets[start];
-    sequence->tokens[count].char_end = text.char_offsets[end];
-    count++;
+  status = tokenize_text(context, sequence, &text);
+  if (status != YAP_V2_OK) {
+    free(text.utf8); YAP_V2_token_sequence_free(sequence);
+    return status;
   }
-  ubrk_close(iterator);
-  sequence->normalized_utf8 = text.utf8; text.utf8 = NULL;
-  sequence->normalized_bytes = text.utf8_bytes; sequence->token_count = count;
-  normalized_free(&text);
+  sequence->normalized_utf8 = text.utf8;
+  sequence->normalized_bytes = text.utf8_bytes;
   return YAP_V2_OK;
 }
 
@@ -146,18 +366,21 @@ void YAP_V2_chunk_sequence_free(YAP_V2_CHUNK_SEQUENCE *sequence) {
 int YAP_V2_unicode_chunk(const char *document_id, const char *utf8, size_t utf8_bytes,
                          uint32_t max_chars, uint32_t overlap_chars,
                          YAP_V2_CHUNK_SEQUENCE *sequence) {
+  TOKENIZER_CONTEXT *context;
   NORMALIZED_TEXT text;
-  UBreakIterator *graphemes = NULL, *sentences = NULL;
+  UBreakIterator *graphemes, *sentences;
   UErrorCode error = U_ZERO_ERROR;
   int32_t start = 0;
   size_t capacity = 0U;
   int status;
   if (document_id == NULL || document_id[0] == '\0' || sequence == NULL || max_chars == 0U || overlap_chars >= max_chars) return YAP_V2_INVALID_ARGUMENT;
   memset(sequence,0,sizeof(*sequence));
-  status=normalize_text(utf8,utf8_bytes,&text); if(status!=YAP_V2_OK)return status;
-  graphemes=ubrk_open(UBRK_CHARACTER,"root",text.text,text.length,&error);
-  sentences=ubrk_open(UBRK_SENTENCE,"root",text.text,text.length,&error);
-  if(U_FAILURE(error)){if(graphemes)ubrk_close(graphemes);if(sentences)ubrk_close(sentences);normalized_free(&text);return YAP_V2_INVALID_FORMAT;}
+  context=context_get(); if(context==NULL)return YAP_V2_ALLOCATION_FAILED;
+  status=normalize_text(context,utf8,utf8_bytes,&text); if(status!=YAP_V2_OK)return status;
+  graphemes=context->graphemes; sentences=context->sentences;
+  ubrk_setText(graphemes,text.text,text.length,&error);
+  ubrk_setText(sentences,text.text,text.length,&error);
+  if(U_FAILURE(error)){free(text.utf8);return YAP_V2_INVALID_FORMAT;}
   while(start<text.length){
     int32_t limit=start, candidate, end, next_start;
     uint32_t start_char=text.char_offsets[start];
@@ -194,7 +417,7 @@ int YAP_V2_unicode_chunk(const char *document_id, const char *utf8, size_t utf8_
   }
   status=YAP_V2_OK;
 done:
-  ubrk_close(graphemes);ubrk_close(sentences);normalized_free(&text);
+  free(text.utf8);
   if(status!=YAP_V2_OK)YAP_V2_chunk_sequence_free(sequence);
   return status;
 }
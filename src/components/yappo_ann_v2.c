@@ -1,11 +1,29 @@
 #include "components/yappo_ann_v2.h"
 
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#define YAP_V2_ANN_ADD_CHUNK 256U
+
+static size_t configured_build_threads = 0U;
+
+typedef struct {
+  pthread_mutex_t lock;
+  usearch_index_t index;
+  const uint64_t *keys;
+  const float *const *values;
+  size_t count;
+  size_t next;
+  int failed;
+} ANN_ADD_BATCH;
+
 static usearch_metric_kind_t metric_kind(YAP_V2_VECTOR_METRIC metric) {
   if (metric == YAP_V2_VECTOR_COSINE) return usearch_metric_cos_k;
   if (metric == YAP_V2_VECTOR_DOT) return usearch_metric_ip_k;
@@ -53,6 +71,76 @@ static int descriptor(const char *path, size_t records, YAP_V2_COMPONENT_DESCRIP
   return YAP_ANN_OK;
 }
 
+void YAP_V2_ann_set_build_threads(size_t threads) {
+  configured_build_threads = threads > YAP_V2_ANN_MAX_BUILD_THREADS ?
+                             YAP_V2_ANN_MAX_BUILD_THREADS : threads;
+}
+
+size_t YAP_V2_ann_build_threads(void) {
+  long online;
+  if (configured_build_threads > 0U) return configured_build_threads;
+  online = sysconf(_SC_NPROCESSORS_ONLN);
+  if (online < 1L) return 1U;
+  return (size_t)online > YAP_V2_ANN_MAX_BUILD_THREADS ? YAP_V2_ANN_MAX_BUILD_THREADS :
+                                                         (size_t)online;
+}
+
+/* Workers claim fixed-size chunks so that uneven insertion costs do not leave threads idle.
+ * USearch hands every concurrent add its own thread context. */
+static void *add_batch_worker(void *argument) {
+  ANN_ADD_BATCH *batch = argument;
+  for (;;) {
+    usearch_error_t error = NULL;
+    size_t first, end, i;
+    pthread_mutex_lock(&batch->lock);
+    first = batch->next;
+    end = batch->failed || first >= batch->count ? first :
+          (batch->count - first > YAP_V2_ANN_ADD_CHUNK ? first + YAP_V2_ANN_ADD_CHUNK :
+                                                         batch->count);
+    batch->next = end;
+    pthread_mutex_unlock(&batch->lock);
+    if (first == end) return NULL;
+    for (i = first; i < end && error == NULL; i++)
+      usearch_add(batch->index, (usearch_key_t)batch->keys[i], batch->values[i],
+                  usearch_scalar_f32_k, &error);
+    if (error != NULL) {
+      pthread_mutex_lock(&batch->lock);
+      batch->failed = 1;
+      pthread_mutex_unlock(&batch->lock);
+      return NULL;
+    }
+  }
+}
+
+static int add_parallel(usearch_index_t index, const uint64_t *keys,
+                        const float *const *values, size_t count) {
+  usearch_error_t error = NULL;
+  pthread_t threads[YAP_V2_ANN_MAX_BUILD_THREADS];
+  ANN_ADD_BATCH batch;
+  size_t thread_count = YAP_V2_ann_build_threads(), started = 0U, i;
+  if (count == 0U) return YAP_ANN_OK;
+  if (thread_count > (count + YAP_V2_ANN_ADD_CHUNK - 1U) / YAP_V2_ANN_ADD_CHUNK)
+    thread_count = (count + YAP_V2_ANN_ADD_CHUNK - 1U) / YAP_V2_ANN_ADD_CHUNK;
+  memset(&batch, 0, sizeof(batch));
+  batch.index = index;
+  batch.keys = keys;
+  batch.values = values;
+  batch.count = count;
+  if (thread_count > 1U) {
+    usearch_change_threads_add(index, thread_count, &error);
+    if (error != NULL) thread_count = 1U;
+  }
+  if (pthread_mutex_init(&batch.lock, NULL) != 0) return YAP_ANN_BACKEND_ERROR;
+  for (i = 1U; i < thread_count; i++) {
+    if (pthread_create(&threads[i], NULL, add_batch_worker, &batch) != 0) break;
+    started++;
+  }
+  (void)add_batch_worker(&batch);
+  for (i = 0U; i < started; i++) (void)pthread_join(threads[i + 1U], NULL);
+  pthread_mutex_destroy(&batch.lock);
+  return batch.failed || batch.next != count ? YAP_ANN_BACKEND_ERROR : YAP_ANN_OK;
+}
+
 const char *YAP_V2_ann_status_string(YAP_ANN_STATUS status) {
   switch (status) {
     case YAP_ANN_OK: return "ok";
@@ -84,6 +172,7 @@ void YAP_V2_ann_index_close(YAP_V2_ANN_INDEX *index) {
   usearch_error_t error = NULL;
   if (index == NULL) return;
   if (index->index != NULL) usearch_free(index->index, &error);
+  if (index->mapping != NULL) munmap(index->mapping, index->mapping_bytes);
   memset(index, 0, sizeof(*index));
 }
 
@@ -121,6 +210,75 @@ int YAP_V2_ann_index_add(YAP_V2_ANN_INDEX *index, uint64_t key, const float *vec
   return YAP_ANN_OK;
 }
 
+int YAP_V2_ann_index_add_batch(YAP_V2_ANN_INDEX *index, const uint64_t *keys,
+                               const float *const *values, size_t count) {
+  usearch_error_t error = NULL;
+  size_t size;
+  if (index == NULL || index->index == NULL || (count > 0U && (keys == NULL || values == NULL)))
+    return YAP_ANN_INVALID_ARGUMENT;
+  if (add_parallel(index->index, keys, values, count) != YAP_ANN_OK)
+    return YAP_ANN_BACKEND_ERROR;
+  size = usearch_size(index->index, &error);
+  if (error != NULL) return YAP_ANN_BACKEND_ERROR;
+  if (size != index->entry_count + count) return YAP_ANN_CONFLICT;
+  index->entry_count = size;
+  return YAP_ANN_OK;
+}
+
+int YAP_V2_ann_index_remove(YAP_V2_ANN_INDEX *index, uint64_t key, int *removed) {
+  usearch_error_t error = NULL;
+  size_t count;
+  if (index == NULL || index->index == NULL || removed == NULL) return YAP_ANN_INVALID_ARGUMENT;
+  count = usearch_remove(index->index, (usearch_key_t)key, &error);
+  if (error != NULL) return YAP_ANN_BACKEND_ERROR;
+  *removed = count > 0U;
+  if (*removed && index->entry_count > 0U) index->entry_count--;
+  return YAP_ANN_OK;
+}
+
+int YAP_V2_ann_index_clone(const YAP_V2_ANN_INDEX *source, size_t capacity,
+                           size_t expansion_add, size_t expansion_search,
+                           YAP_V2_ANN_INDEX *clone) {
+  usearch_error_t error = NULL;
+  usearch_index_t created = NULL;
+  void *buffer = NULL;
+  size_t bytes, size;
+  int status = YAP_ANN_BACKEND_ERROR;
+  if (source == NULL || source->index == NULL || clone == NULL || clone->index != NULL ||
+      expansion_add == 0U || expansion_search == 0U)
+    return YAP_ANN_INVALID_ARGUMENT;
+  bytes = usearch_serialized_length(source->index, &error);
+  if (error != NULL || bytes == 0U) return YAP_ANN_BACKEND_ERROR;
+  buffer = malloc(bytes);
+  if (buffer == NULL) return YAP_ANN_ALLOCATION_FAILED;
+  usearch_save_buffer(source->index, buffer, bytes, &error);
+  if (error != NULL) goto done;
+  created = create_index_for_config(source->metric, source->dimensions, 0U, expansion_add,
+                                    expansion_search, &error);
+  if (created == NULL || error != NULL) goto done;
+  usearch_load_buffer(created, buffer, bytes, &error);
+  if (error != NULL) goto done;
+  usearch_change_expansion_add(created, expansion_add, &error);
+  if (error == NULL) usearch_change_expansion_search(created, expansion_search, &error);
+  size = error == NULL ? usearch_size(created, &error) : 0U;
+  if (error != NULL) goto done;
+  if (size != source->entry_count) { status = YAP_ANN_CONFLICT; goto done; }
+  if (capacity > size) {
+    usearch_reserve(created, capacity, &error);
+    if (error != NULL) { status = YAP_ANN_ALLOCATION_FAILED; goto done; }
+  }
+  clone->index = created;
+  clone->metric = source->metric;
+  clone->dimensions = source->dimensions;
+  clone->entry_count = size;
+  created = NULL;
+  status = YAP_ANN_OK;
+done:
+  free(buffer);
+  if (created != NULL) { usearch_error_t ignored = NULL; usearch_free(created, &ignored); }
+  return status;
+}
+
 int YAP_V2_ann_index_save(const YAP_V2_ANN_INDEX *index, const char *path) {
   usearch_error_t error = NULL;
   if (index == NULL || index->index == NULL || path == NULL || index->entry_count == 0U)
@@ -129,13 +287,41 @@ int YAP_V2_ann_index_save(const YAP_V2_ANN_INDEX *index, const char *path) {
   return error == NULL ? YAP_ANN_OK : YAP_ANN_IO_ERROR;
 }
 
+/* Graph traversal touches nodes in no particular order, so readahead only evicts useful pages.
+ * Huge pages cut TLB misses on large graphs where the kernel supports them for file mappings. */
+static int map_index_file(const char *path, void **mapping, size_t *mapping_bytes) {
+  struct stat info;
+  void *map;
+  int fd;
+  fd = open(path, O_RDONLY);
+  if (fd < 0) return YAP_ANN_IO_ERROR;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0 || (uint64_t)info.st_size > SIZE_MAX) {
+    close(fd);
+    return YAP_ANN_IO_ERROR;
+  }
+  map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (close(fd) != 0 || map == MAP_FAILED) {
+    if (map != MAP_FAILED) munmap(map, (size_t)info.st_size);
+    return YAP_ANN_IO_ERROR;
+  }
+  (void)madvise(map, (size_t)info.st_size, MADV_RANDOM);
+#ifdef MADV_HUGEPAGE
+  (void)madvise(map, (size_t)info.st_size, MADV_HUGEPAGE);
+#endif
+  *mapping = map;
+  *mapping_bytes = (size_t)info.st_size;
+  return YAP_ANN_OK;
+}
+
 int YAP_V2_ann_index_view(const char *path, YAP_V2_VECTOR_METRIC metric,
                           size_t dimensions, size_t expected_count,
                           size_t expansion_search, YAP_V2_ANN_INDEX *index) {
   usearch_error_t error = NULL;
   usearch_init_options_t metadata;
-  usearch_index_t viewed;
-  size_t actual_dimensions, actual_count;
+  usearch_index_t viewed = NULL;
+  void *mapping = NULL;
+  size_t mapping_bytes = 0U, actual_dimensions, actual_count;
+  int status;
   if (path == NULL || index == NULL || index->index != NULL || dimensions == 0U ||
       expected_count == 0U || expansion_search == 0U ||
       metric_kind(metric) == usearch_metric_unknown_k)
@@ -146,29 +332,32 @@ int YAP_V2_ann_index_view(const char *path, YAP_V2_VECTOR_METRIC metric,
   if (metadata.metric_kind != metric_kind(metric) ||
       metadata.quantization != usearch_scalar_f32_k || metadata.dimensions != dimensions)
     return YAP_ANN_CONFLICT;
+  status = map_index_file(path, &mapping, &mapping_bytes);
+  if (status != YAP_ANN_OK) return status;
   viewed = create_index_for_config(metric, dimensions, 0U, 0U, expansion_search, &error);
-  if (viewed == NULL || error != NULL) return YAP_ANN_BACKEND_ERROR;
-  usearch_view(viewed, path, &error);
-  if (error != NULL) {
-    usearch_free(viewed, &error);
-    return YAP_ANN_IO_ERROR;
-  }
+  if (viewed == NULL || error != NULL) { status = YAP_ANN_BACKEND_ERROR; goto done; }
+  usearch_view_buffer(viewed, mapping, mapping_bytes, &error);
+  if (error != NULL) { status = YAP_ANN_IO_ERROR; goto done; }
   actual_dimensions = usearch_dimensions(viewed, &error);
   actual_count = usearch_size(viewed, &error);
   if (error != NULL || actual_dimensions != dimensions || actual_count != expected_count) {
-    usearch_free(viewed, &error);
-    return YAP_ANN_CONFLICT;
+    status = YAP_ANN_CONFLICT; goto done;
   }
   usearch_change_expansion_search(viewed, expansion_search, &error);
-  if (error != NULL) {
-    usearch_free(viewed, &error);
-    return YAP_ANN_BACKEND_ERROR;
-  }
+  if (error != NULL) { status = YAP_ANN_BACKEND_ERROR; goto done; }
   index->index = viewed;
   index->metric = metric;
   index->dimensions = dimensions;
   index->entry_count = expected_count;
-  return YAP_ANN_OK;
+  index->mapping = mapping;
+  index->mapping_bytes = mapping_bytes;
+  viewed = NULL;
+  mapping = NULL;
+  status = YAP_ANN_OK;
+done:
+  if (viewed != NULL) { usearch_error_t ignored = NULL; usearch_free(viewed, &ignored); }
+  if (mapping != NULL) munmap(mapping, mapping_bytes);
+  return status;
 }
 
 int YAP_V2_ann_index_search(const YAP_V2_ANN_INDEX *index, const float *query,
@@ -196,25 +385,103 @@ int YAP_V2_ann_index_search(const YAP_V2_ANN_INDEX *index, const float *query,
   return YAP_VECTOR_OK;
 }
 
-int YAP_V2_ann_build_save(const char *path, const YAP_V2_VECTOR_SEGMENT *vectors,
-                          size_t connectivity, size_t expansion_add,
-                          size_t expansion_search, YAP_V2_COMPONENT_DESCRIPTOR *component) {
+/* Seed keys are moved through a disjoint temporary range so that a rename never lands on a
+ * key that has not been moved yet. */
+#define YAP_V2_ANN_SEED_TEMPORARY_KEY (UINT64_C(1) << 62)
+
+static int seed_index(usearch_index_t index, const YAP_V2_VECTOR_SEGMENT *vectors,
+                      const char *seed_path, const uint64_t *seed_ordinals, size_t seed_count,
+                      size_t connectivity, unsigned char *present, size_t *reused) {
+  usearch_error_t error = NULL;
+  usearch_init_options_t metadata;
+  size_t k;
+  memset(&metadata, 0, sizeof(metadata));
+  usearch_metadata(seed_path, &metadata, &error);
+  if (error != NULL) return YAP_ANN_IO_ERROR;
+  if (metadata.metric_kind != metric_kind(vectors->metric) ||
+      metadata.quantization != usearch_scalar_f32_k ||
+      metadata.dimensions != vectors->dimensions)
+    return YAP_ANN_CONFLICT;
+  usearch_load(index, seed_path, &error);
+  if (error != NULL) return YAP_ANN_IO_ERROR;
+  if (usearch_connectivity(index, &error) != connectivity || error != NULL ||
+      usearch_size(index, &error) != seed_count || error != NULL)
+    return YAP_ANN_CONFLICT;
+  for (k = 0U; k < seed_count; k++) {
+    uint64_t ordinal = seed_ordinals[k];
+    if (ordinal >= vectors->entry_count) {
+      if (usearch_remove(index, (usearch_key_t)k, &error) != 1U || error != NULL)
+        return YAP_ANN_BACKEND_ERROR;
+      continue;
+    }
+    if (present[ordinal]) return YAP_ANN_CONFLICT;
+    present[ordinal] = 1U;
+    (*reused)++;
+    if (ordinal != k &&
+        (usearch_rename(index, (usearch_key_t)k,
+                        (usearch_key_t)(YAP_V2_ANN_SEED_TEMPORARY_KEY + ordinal), &error) != 1U ||
+         error != NULL))
+      return YAP_ANN_BACKEND_ERROR;
+  }
+  for (k = 0U; k < seed_count; k++) {
+    uint64_t ordinal = seed_ordinals[k];
+    if (ordinal >= vectors->entry_count || ordinal == k) continue;
+    if (usearch_rename(index, (usearch_key_t)(YAP_V2_ANN_SEED_TEMPORARY_KEY + ordinal),
+                       (usearch_key_t)ordinal, &error) != 1U || error != NULL)
+      return YAP_ANN_BACKEND_ERROR;
+  }
+  return YAP_ANN_OK;
+}
+
+static int build_save(const char *path, const YAP_V2_VECTOR_SEGMENT *vectors,
+                      const char *seed_path, const uint64_t *seed_ordinals, size_t seed_count,
+                      size_t connectivity, size_t expansion_add, size_t expansion_search,
+                      size_t *reused_vectors, YAP_V2_COMPONENT_DESCRIPTOR *component) {
   usearch_error_t error = NULL;
   usearch_index_t index = NULL;
+  unsigned char *present = NULL;
+  uint64_t *keys = NULL;
+  const float **values = NULL;
   char *temporary = NULL;
-  size_t i, path_len;
+  size_t i, path_len, reused = 0U, pending = 0U;
   int status = YAP_ANN_BACKEND_ERROR;
   if (path == NULL || vectors == NULL || vectors->entries == NULL || vectors->entry_count == 0U ||
       metric_kind(vectors->metric) == usearch_metric_unknown_k || connectivity == 0U ||
-      expansion_add == 0U || expansion_search == 0U)
+      expansion_add == 0U || expansion_search == 0U ||
+      (seed_path != NULL && seed_count > 0U && seed_ordinals == NULL))
     return YAP_ANN_INVALID_ARGUMENT;
   index = create_index(vectors, connectivity, expansion_add, expansion_search, &error);
   if (index == NULL || error != NULL) goto done;
+  if (seed_path != NULL && seed_count > 0U) {
+    present = calloc(vectors->entry_count, sizeof(*present));
+    if (present == NULL) { status = YAP_ANN_ALLOCATION_FAILED; goto done; }
+    if (seed_index(index, vectors, seed_path, seed_ordinals, seed_count, connectivity, present,
+                   &reused) != YAP_ANN_OK) {
+      usearch_error_t ignored = NULL;
+      usearch_free(index, &ignored);
+      memset(present, 0, vectors->entry_count * sizeof(*present));
+      reused = 0U;
+      index = create_index(vectors, connectivity, expansion_add, expansion_search, &error);
+      if (index == NULL || error != NULL) goto done;
+    }
+  }
   usearch_reserve(index, vectors->entry_count, &error);
   if (error != NULL) goto done;
+  keys = malloc(sizeof(*keys) * (vectors->entry_count - reused));
+  values = malloc(sizeof(*values) * (vectors->entry_count - reused));
+  if (reused < vectors->entry_count && (keys == NULL || values == NULL)) {
+    status = YAP_ANN_ALLOCATION_FAILED;
+    goto done;
+  }
   for (i = 0U; i < vectors->entry_count; i++) {
-    usearch_add(index, (usearch_key_t)i, vectors->entries[i].values, usearch_scalar_f32_k, &error);
-    if (error != NULL) goto done;
+    if (present != NULL && present[i]) continue;
+    keys[pending] = i;
+    values[pending++] = vectors->entries[i].values;
+  }
+  if (add_parallel(index, keys, values, pending) != YAP_ANN_OK) goto done;
+  if (usearch_size(index, &error) != vectors->entry_count || error != NULL) {
+    status = YAP_ANN_CONFLICT;
+    goto done;
   }
   path_len = strlen(path);
   if (path_len > SIZE_MAX - 5U) { status = YAP_ANN_ALLOCATION_FAILED; goto done; }
@@ -226,13 +493,34 @@ int YAP_V2_ann_build_save(const char *path, const YAP_V2_VECTOR_SEGMENT *vectors
   if (error != NULL) goto done;
   if (rename(temporary, path) != 0) { status = YAP_ANN_IO_ERROR; goto done; }
   status = descriptor(path, vectors->entry_count, component);
+  if (status == YAP_ANN_OK && reused_vectors != NULL) *reused_vectors = reused;
 done:
   if (status != YAP_ANN_OK && temporary != NULL) unlink(temporary);
   free(temporary);
+  free(present);
+  free(keys);
+  free(values);
   if (index != NULL) { usearch_error_t ignored = NULL; usearch_free(index, &ignored); }
   return status;
 }
 
+int YAP_V2_ann_build_save(const char *path, const YAP_V2_VECTOR_SEGMENT *vectors,
+                          size_t connectivity, size_t expansion_add,
+                          size_t expansion_search, YAP_V2_COMPONENT_DESCRIPTOR *component) {
+  return build_save(path, vectors, NULL, NULL, 0U, connectivity, expansion_add,
+                    expansion_search, NULL, component);
+}
+
+int YAP_V2_ann_build_save_seeded(const char *path, const YAP_V2_VECTOR_SEGMENT *vectors,
+                                 const char *seed_path, const uint64_t *seed_ordinals,
+                                 size_t seed_count, size_t connectivity, size_t expansion_add,
+                                 size_t expansion_search, size_t *reused_vectors,
+                                 YAP_V2_COMPONENT_DESCRIPTOR *component) {
+  if (reused_vectors != NULL) *reused_vectors = 0U;
+  return build_save(path, vectors, seed_path, seed_ordinals, seed_count, connectivity,
+                    expansion_add, expansion_search, reused_vectors, component);
+}
+
 int YAP_V2_ann_view(const char *path, const YAP_V2_VECTOR_SEGMENT *vectors,
                     size_t expansion_search, YAP_V2_ANN_SEGMENT *segment,
                     YAP_V2_COMPONENT_DESCRIPTOR *component) {
@@ -5,6 +5,8 @@
 
 #include "components/yappo_vector_v2.h"
 
+#define YAP_V2_ANN_MAX_BUILD_THREADS 256U
+
 typedef enum {
   YAP_ANN_OK = 0,
   YAP_ANN_INVALID_ARGUMENT = -1,
@@ -24,6 +26,8 @@ typedef struct {
   YAP_V2_VECTOR_METRIC metric;
   size_t dimensions;
   size_t entry_count;
+  void *mapping;
+  size_t mapping_bytes;
 } YAP_V2_ANN_INDEX;
 
 typedef struct {
@@ -32,6 +36,10 @@ typedef struct {
 } YAP_V2_ANN_HIT;
 
 const char *YAP_V2_ann_status_string(YAP_ANN_STATUS status);
+/* Sets the number of threads that insert vectors into a graph under construction for the whole
+ * process. 0 uses the number of online CPUs. */
+void YAP_V2_ann_set_build_threads(size_t threads);
+size_t YAP_V2_ann_build_threads(void);
 void YAP_V2_ann_segment_init(YAP_V2_ANN_SEGMENT *segment);
 void YAP_V2_ann_segment_close(YAP_V2_ANN_SEGMENT *segment);
 void YAP_V2_ann_index_init(YAP_V2_ANN_INDEX *index);
@@ -41,7 +49,17 @@ int YAP_V2_ann_index_create(YAP_V2_VECTOR_METRIC metric, size_t dimensions,
                             size_t expansion_add, size_t expansion_search,
                             YAP_V2_ANN_INDEX *index);
 int YAP_V2_ann_index_add(YAP_V2_ANN_INDEX *index, uint64_t key, const float *vector);
+/* Adds count vectors with YAP_V2_ann_build_threads() threads. Capacity must already be reserved. */
+int YAP_V2_ann_index_add_batch(YAP_V2_ANN_INDEX *index, const uint64_t *keys,
+                               const float *const *values, size_t count);
+int YAP_V2_ann_index_remove(YAP_V2_ANN_INDEX *index, uint64_t key, int *removed);
+/* Copies a built or viewed index into a new writable index with room for capacity vectors. */
+int YAP_V2_ann_index_clone(const YAP_V2_ANN_INDEX *source, size_t capacity,
+                           size_t expansion_add, size_t expansion_search,
+                           YAP_V2_ANN_INDEX *clone);
 int YAP_V2_ann_index_save(const YAP_V2_ANN_INDEX *index, const char *path);
+/* Maps a saved index read-only and searches it in place. The pages stay in the shared page cache,
+ * so reopening the same file after a restart does not read or copy the graph again. */
 int YAP_V2_ann_index_view(const char *path, YAP_V2_VECTOR_METRIC metric,
                           size_t dimensions, size_t expected_count,
                           size_t expansion_search, YAP_V2_ANN_INDEX *index);
@@ -51,6 +69,14 @@ int YAP_V2_ann_index_search(const YAP_V2_ANN_INDEX *index, const float *query,
 int YAP_V2_ann_build_save(const char *path, const YAP_V2_VECTOR_SEGMENT *vectors,
                           size_t connectivity, size_t expansion_add,
                           size_t expansion_search, YAP_V2_COMPONENT_DESCRIPTOR *component);
+/* Builds the same index as YAP_V2_ann_build_save, but starts from a copy of an existing graph
+ * whose key k holds the vector now stored at seed_ordinals[k]; keys mapped outside the new
+ * segment are removed. Falls back to a full build when the seed cannot be reused. */
+int YAP_V2_ann_build_save_seeded(const char *path, const YAP_V2_VECTOR_SEGMENT *vectors,
+                                 const char *seed_path, const uint64_t *seed_ordinals,
+                                 size_t seed_count, size_t connectivity, size_t expansion_add,
+                                 size_t expansion_search, size_t *reused_vectors,
+                                 YAP_V2_COMPONENT_DESCRIPTOR *component);
 int YAP_V2_ann_view(const char *path, const YAP_V2_VECTOR_SEGMENT *vectors,
                     size_t expansion_search, YAP_V2_ANN_SEGMENT *segment,
                     YAP_V2_COMPONENT_DESCRIPTOR *component);
@@ -1,4 +1,5 @@
 #include "components/yappo_lexical_v2.h"
+#include "components/yappo_term_filter_v2.h"
 
 #include <fcntl.h>
 #include <stdio.h>
@@ -10,6 +11,18 @@
 
 #define POSTING_BYTES 48U
 #define BLOCK_BYTES 16U
+#define TERM_HEADER_BYTES 48U
+#define TERM_BLOCK_BYTES 24U
+
+typedef struct {
+  uint32_t shared;
+  uint32_t suffix_len;
+  const unsigned char *suffix;
+  uint32_t document_frequency;
+  uint32_t passage_frequency;
+  uint32_t postings_bytes;
+  uint32_t positions_bytes;
+} TERM_RECORD;
 
 static uint32_t get_u32(const unsigned char *data) {
   return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) |
@@ -24,25 +37,13 @@ static uint64_t get_u64(const unsigned char *data) {
   return value;
 }
 
-static uint32_t crc32c(const unsigned char *data, size_t len) {
-  uint32_t crc = UINT32_MAX;
-  size_t i;
-  unsigned int bit;
-  for (i = 0U; i < len; i++) {
-    crc ^= data[i];
-    for (bit = 0U; bit < 8U; bit++)
-      crc = (crc & 1U) != 0U ? (crc >> 1) ^ UINT32_C(0x82f63b78) : crc >> 1;
-  }
-  return ~crc;
-}
-
 static int range_valid(size_t offset, size_t bytes, size_t size) {
   return offset <= size && bytes <= size - offset;
 }
 
 static int term_compare(YAP_V2_BYTES_VIEW left, YAP_V2_BYTES_VIEW right) {
   size_t common = left.len < right.len ? left.len : right.len;
-  int order = memcmp(left.data, right.data, common);
+  int order = common == 0U ? 0 : memcmp(left.data, right.data, common);
   if (order != 0) return order;
   if (left.len == right.len) return 0;
   return left.len < right.len ? -1 : 1;
@@ -77,7 +78,7 @@ static int map_component(const char *path, uint32_t type, uint64_t expected_gene
     munmap(map, (size_t)info.st_size);
     return status == YAP_V2_OK ? YAP_V2_INVALID_FORMAT : status;
   }
-  if (crc32c(map + YAP_V2_FILE_HEADER_BYTES, (size_t)header.payload_bytes) !=
+  if (YAP_V2_crc32c(map + YAP_V2_FILE_HEADER_BYTES, (size_t)header.payload_bytes) !=
       header.payload_crc32c) {
     munmap(map, (size_t)info.st_size);
     return YAP_V2_CHECKSUM_MISMATCH;
@@ -100,7 +101,6 @@ void YAP_V2_lexical_segment_close(YAP_V2_LEXICAL_SEGMENT *segment) {
   for (i = 0U; i < 3U; i++)
     if (segment->maps[i] != NULL)
       munmap(segment->maps[i], segment->map_bytes[i]);
-  free(segment->terms);
   YAP_V2_lexical_segment_init(segment);
 }
 
@@ -118,50 +118,168 @@ static int parse_posting(const unsigned char *data, YAP_V2_POSTING *posting) {
   return YAP_V2_OK;
 }
 
+/* Gaps are unsigned LEB128 of at most five bytes. Overlong forms are rejected so that every
+ * position list has exactly one encoding. */
+static int read_varint(const unsigned char *data, size_t end, size_t *offset, uint32_t *value) {
+  uint32_t result = 0U;
+  unsigned shift;
+  size_t at = *offset;
+  for (shift = 0U; shift <= 28U; shift += 7U) {
+    unsigned char byte;
+    if (at >= end)
+      return YAP_V2_INVALID_FORMAT;
+    byte = data[at++];
+    if ((shift == 28U && byte > 0x0fU) || (shift > 0U && byte == 0U))
+      return YAP_V2_INVALID_FORMAT;
+    result |= (uint32_t)(byte & 0x7fU) << shift;
+    if ((byte & 0x80U) == 0U) {
+      *offset = at;
+      *value = result;
+      return YAP_V2_OK;
+    }
+  }
+  return YAP_V2_INVALID_FORMAT;
+}
+
+static int position_next(YAP_V2_POSITION_ITERATOR *iterator, YAP_V2_POSITION *position) {
+  uint32_t field = iterator->previous.field == 0U ? YAP_V2_FIELD_TITLE : iterator->previous.field;
+  uint32_t value;
+  int status;
+  while (field <= YAP_V2_FIELD_PASSAGE && iterator->remaining[field - 1U] == 0U)
+    field++;
+  if (field > YAP_V2_FIELD_PASSAGE)
+    return YAP_V2_OUT_OF_RANGE;
+  status = read_varint(iterator->data, iterator->end, &iterator->offset, &value);
+  if (status != YAP_V2_OK)
+    return status;
+  if (field == iterator->previous.field) {
+    if (value >= UINT32_MAX - iterator->previous.position)
+      return YAP_V2_INVALID_FORMAT;
+    value += iterator->previous.position + 1U;
+  }
+  iterator->remaining[field - 1U]--;
+  iterator->previous.field = field;
+  iterator->previous.position = value;
+  *position = iterator->previous;
+  return YAP_V2_OK;
+}
+
+static int term_record_read(const YAP_V2_LEXICAL_SEGMENT *segment, size_t *offset,
+                            TERM_RECORD *record) {
+  const unsigned char *data = (const unsigned char *)segment->maps[0];
+  size_t end = segment->term_index_offset;
+  int status = read_varint(data, end, offset, &record->shared);
+  if (status == YAP_V2_OK)
+    status = read_varint(data, end, offset, &record->suffix_len);
+  if (status == YAP_V2_OK && end - *offset < record->suffix_len)
+    status = YAP_V2_INVALID_FORMAT;
+  if (status == YAP_V2_OK) {
+    record->suffix = data + *offset;
+    *offset += record->suffix_len;
+    status = read_varint(data, end, offset, &record->document_frequency);
+  }
+  if (status == YAP_V2_OK)
+    status = read_varint(data, end, offset, &record->passage_frequency);
+  if (status == YAP_V2_OK && record->passage_frequency > record->document_frequency)
+    status = YAP_V2_INVALID_FORMAT;
+  if (status == YAP_V2_OK)
+    status = read_varint(data, end, offset, &record->postings_bytes);
+  if (status == YAP_V2_OK)
+    status = read_varint(data, end, offset, &record->positions_bytes);
+  return status;
+}
+
+static int cursor_start(const YAP_V2_LEXICAL_SEGMENT *segment, size_t block,
+                        YAP_V2_TERM_CURSOR *cursor) {
+  const unsigned char *entry =
+    (const unsigned char *)segment->maps[0] + segment->term_index_offset + block * TERM_BLOCK_BYTES;
+  uint64_t offset = get_u64(entry);
+  if (offset < TERM_HEADER_BYTES ||
+      offset > segment->term_index_offset - YAP_V2_FILE_HEADER_BYTES)
+    return YAP_V2_INVALID_FORMAT;
+  cursor->segment = segment;
+  cursor->offset = YAP_V2_FILE_HEADER_BYTES + (size_t)offset;
+  cursor->index = block * YAP_V2_TERMS_BLOCK_SIZE;
+  cursor->postings_offset = get_u64(entry + 8U);
+  cursor->positions_offset = get_u64(entry + 16U);
+  cursor->term_len = 0U;
+  return YAP_V2_OK;
+}
+
+/* Compares the first term of a block, which is stored whole, with term. */
+static int block_compare(const YAP_V2_LEXICAL_SEGMENT *segment, size_t block,
+                         YAP_V2_BYTES_VIEW term, int *order) {
+  YAP_V2_TERM_CURSOR cursor;
+  TERM_RECORD record;
+  YAP_V2_BYTES_VIEW first;
+  int status = cursor_start(segment, block, &cursor);
+  if (status == YAP_V2_OK)
+    status = term_record_read(segment, &cursor.offset, &record);
+  if (status == YAP_V2_OK && record.shared != 0U)
+    status = YAP_V2_INVALID_FORMAT;
+  if (status == YAP_V2_OK) {
+    first.data = record.suffix;
+    first.len = record.suffix_len;
+    *order = term_compare(first, term);
+  }
+  return status;
+}
+
+/* Index of the last block whose first term is not greater than term, or zero. */
+static int block_search(const YAP_V2_LEXICAL_SEGMENT *segment, YAP_V2_BYTES_VIEW term,
+                        size_t *block, int *before_first) {
+  size_t low = 0U, high = segment->term_block_count;
+  int order = 0;
+  int status = YAP_V2_OK;
+  while (status == YAP_V2_OK && low < high) {
+    size_t middle = low + (high - low) / 2U;
+    status = block_compare(segment, middle, term, &order);
+    if (order <= 0)
+      low = middle + 1U;
+    else
+      high = middle;
+  }
+  *before_first = low == 0U;
+  *block = low == 0U ? 0U : low - 1U;
+  return status;
+}
+
 static int validate_term_stream(YAP_V2_LEXICAL_SEGMENT *segment) {
   const unsigned char *data = (const unsigned char *)segment->maps[0];
   size_t size = segment->map_bytes[0];
   size_t offset = YAP_V2_FILE_HEADER_BYTES;
-  uint64_t count;
-  size_t i;
+  uint64_t count, blocks, index, filter, filter_blocks;
 
-  if (!range_valid(offset, 12U, size) || get_u32(data + offset) != YAP_V2_LEXICAL_PAYLOAD_VERSION)
+  if (!range_valid(offset, TERM_HEADER_BYTES, size) ||
+      get_u32(data + offset) != YAP_V2_TERMS_PAYLOAD_VERSION ||
+      get_u32(data + offset + 12U) != YAP_V2_TERMS_BLOCK_SIZE)
     return YAP_V2_INVALID_FORMAT;
   count = get_u64(data + offset + 4U);
-  if (count > SIZE_MAX || count > YAP_V2_MAX_SEGMENT_PAYLOAD_BYTES / sizeof(*segment->terms))
-    return YAP_V2_OUT_OF_RANGE;
-  segment->terms =
-    count == 0U ? NULL : (YAP_V2_TERM_ENTRY *)calloc((size_t)count, sizeof(*segment->terms));
-  if (count > 0U && segment->terms == NULL)
-    return YAP_V2_ALLOCATION_FAILED;
+  blocks = get_u64(data + offset + 16U);
+  index = get_u64(data + offset + 24U);
+  filter = get_u64(data + offset + 32U);
+  filter_blocks = get_u64(data + offset + 40U);
+  if (blocks != count / YAP_V2_TERMS_BLOCK_SIZE + (count % YAP_V2_TERMS_BLOCK_SIZE != 0U) ||
+      filter_blocks != YAP_V2_term_filter_block_count(count) ||
+      index < TERM_HEADER_BYTES || index > size - offset ||
+      filter < index || filter > size - offset ||
+      ((size_t)filter - (size_t)index) % TERM_BLOCK_BYTES != 0U ||
+      ((size_t)filter - (size_t)index) / TERM_BLOCK_BYTES != blocks ||
+      (size - offset - (size_t)filter) % YAP_V2_TERM_FILTER_BLOCK_BYTES != 0U ||
+      (size - offset - (size_t)filter) / YAP_V2_TERM_FILTER_BLOCK_BYTES != filter_blocks)
+    return YAP_V2_INVALID_FORMAT;
   segment->term_count = (size_t)count;
-  offset += 12U;
-  for (i = 0U; i < segment->term_count; i++) {
-    uint32_t length;
-    YAP_V2_TERM_ENTRY *term = &segment->terms[i];
-    if (!range_valid(offset, 4U, size))
-      return YAP_V2_INVALID_FORMAT;
-    length = get_u32(data + offset);
-    offset += 4U;
-    if (length == 0U || !range_valid(offset, (size_t)length + 40U, size))
-      return YAP_V2_INVALID_FORMAT;
-    term->term.data = data + offset;
-    term->term.len = length;
-    offset += length;
-    term->document_frequency = get_u64(data + offset);
-    term->postings_offset = get_u64(data + offset + 8U);
-    term->postings_bytes = get_u64(data + offset + 16U);
-    term->positions_offset = get_u64(data + offset + 24U);
-    term->positions_bytes = get_u64(data + offset + 32U);
-    offset += 40U;
-    if (term->document_frequency == 0U ||
-        (i > 0U && term_compare(segment->terms[i - 1U].term, term->term) >= 0))
-      return YAP_V2_INVALID_FORMAT;
-  }
-  return offset == size ? YAP_V2_OK : YAP_V2_INVALID_FORMAT;
+  segment->term_block_count = (size_t)blocks;
+  segment->term_index_offset = offset + (size_t)index;
+  segment->term_filter_offset = offset + (size_t)filter;
+  segment->term_filter_block_count = (size_t)filter_blocks;
+  return YAP_V2_OK;
 }
 
-static int validate_payloads(YAP_V2_LEXICAL_SEGMENT *segment) {
+/* Walks the term dictionary once with cursor, checking each block index entry, the term
+ * order, and every posting and position list the terms point at. */
+static int validate_term_payloads(YAP_V2_LEXICAL_SEGMENT *segment, YAP_V2_TERM_CURSOR *cursor) {
+  const unsigned char *terms = (const unsigned char *)segment->maps[0];
   const unsigned char *postings = (const unsigned char *)segment->maps[1];
   const unsigned char *positions = (const unsigned char *)segment->maps[2];
   size_t postings_size = segment->map_bytes[1];
@@ -176,7 +294,7 @@ static int validate_payloads(YAP_V2_LEXICAL_SEGMENT *segment) {
       get_u32(postings + YAP_V2_FILE_HEADER_BYTES) != YAP_V2_LEXICAL_PAYLOAD_VERSION ||
       get_u32(postings + YAP_V2_FILE_HEADER_BYTES + 4U) != YAP_V2_POSTINGS_BLOCK_SIZE ||
       !range_valid(YAP_V2_FILE_HEADER_BYTES, 12U, positions_size) ||
-      get_u32(positions + YAP_V2_FILE_HEADER_BYTES) != YAP_V2_LEXICAL_PAYLOAD_VERSION)
+      get_u32(positions + YAP_V2_FILE_HEADER_BYTES) != YAP_V2_POSITIONS_PAYLOAD_VERSION)
     return YAP_V2_INVALID_FORMAT;
   segment->document_count = get_u64(postings + YAP_V2_FILE_HEADER_BYTES + 8U);
   segment->passage_count = get_u64(postings + YAP_V2_FILE_HEADER_BYTES + 16U);
@@ -186,15 +304,34 @@ static int validate_payloads(YAP_V2_LEXICAL_SEGMENT *segment) {
   segment->field_token_count[2] = get_u64(postings + YAP_V2_FILE_HEADER_BYTES + 48U);
   segment->position_count = get_u64(positions + YAP_V2_FILE_HEADER_BYTES + 4U);
 
+  cursor->segment = segment;
+  cursor->offset = YAP_V2_FILE_HEADER_BYTES + TERM_HEADER_BYTES;
+  cursor->postings_offset = posting_cursor - YAP_V2_FILE_HEADER_BYTES;
+  cursor->positions_offset = position_cursor - YAP_V2_FILE_HEADER_BYTES;
   for (term_index = 0U; term_index < segment->term_count; term_index++) {
-    const YAP_V2_TERM_ENTRY *term = &segment->terms[term_index];
+    const YAP_V2_TERM_ENTRY *term = &cursor->entry;
     uint64_t position_records;
+    uint64_t term_positions = 0U;
+    uint64_t position_bytes = 0U;
+    uint64_t passages = 0U;
     uint32_t block_count;
     size_t i;
     YAP_V2_POSTING previous = {0};
     size_t posting_data;
     size_t block_data;
 
+    if (term_index % YAP_V2_TERMS_BLOCK_SIZE == 0U) {
+      const unsigned char *entry = terms + segment->term_index_offset +
+                                   term_index / YAP_V2_TERMS_BLOCK_SIZE * TERM_BLOCK_BYTES;
+      if (get_u64(entry) != cursor->offset - YAP_V2_FILE_HEADER_BYTES ||
+          get_u64(entry + 8U) != cursor->postings_offset ||
+          get_u64(entry + 16U) != cursor->positions_offset)
+        return YAP_V2_INVALID_FORMAT;
+    }
+    if (YAP_V2_term_cursor_next(cursor) != YAP_V2_OK ||
+        !YAP_V2_lexical_term_may_exist(segment,
+                                       YAP_V2_term_filter_hash(cursor->term, cursor->term_len)))
+      return YAP_V2_INVALID_FORMAT;
     if (term->postings_offset > SIZE_MAX || term->postings_bytes > SIZE_MAX ||
         term->positions_offset > SIZE_MAX || term->positions_bytes > SIZE_MAX ||
         term->postings_offset != posting_cursor - YAP_V2_FILE_HEADER_BYTES ||
@@ -218,15 +355,14 @@ static int validate_payloads(YAP_V2_LEXICAL_SEGMENT *segment) {
     block_data = posting_data + (size_t)term->document_frequency * POSTING_BYTES;
     if ((uint64_t)(20U + (size_t)term->document_frequency * POSTING_BYTES +
                    (size_t)block_count * BLOCK_BYTES) != term->postings_bytes ||
-        position_records > (SIZE_MAX - 16U) / 8U ||
-        term->positions_bytes != 16U + position_records * 8U)
+        term->positions_bytes < 16U)
       return YAP_V2_INVALID_FORMAT;
     for (i = 0U; i < (size_t)term->document_frequency; i++) {
       YAP_V2_POSTING posting;
+      YAP_V2_POSITION_ITERATOR iterator;
+      YAP_V2_POSITION position;
       uint64_t tf;
-      size_t p;
-      uint32_t field_counts[3] = {0U, 0U, 0U};
-      uint32_t previous_position[3] = {0U, 0U, 0U};
+      int status;
       parse_posting(postings + posting_data + i * POSTING_BYTES, &posting);
       tf =
         (uint64_t)posting.term_frequency[0] + posting.term_frequency[1] + posting.term_frequency[2];
@@ -237,28 +373,27 @@ static int validate_payloads(YAP_V2_LEXICAL_SEGMENT *segment) {
           (posting.object_type == YAP_V2_LEXICAL_PASSAGE &&
            posting.object_ordinal >= segment->passage_count) ||
           tf == 0U || tf != posting.position_count ||
-          posting.position_offset + posting.position_count > position_records ||
+          posting.position_offset != position_bytes ||
           (i > 0U && (posting.object_type < previous.object_type ||
                       (posting.object_type == previous.object_type &&
                        posting.object_ordinal <= previous.object_ordinal))))
         return YAP_V2_INVALID_FORMAT;
-      for (p = 0U; p < posting.position_count; p++) {
-        size_t at = position_cursor + 16U + ((size_t)posting.position_offset + p) * 8U;
-        uint32_t field = get_u32(positions + at);
-        uint32_t position = get_u32(positions + at + 4U);
-        if (field < YAP_V2_FIELD_TITLE || field > YAP_V2_FIELD_PASSAGE ||
-            position >= posting.field_length[field - 1U] ||
-            (field_counts[field - 1U] > 0U && position <= previous_position[field - 1U]))
+      /* Gaps of at least one make positions strictly increase within a field by construction. */
+      status = YAP_V2_position_iterator_init(segment, term, &posting, &iterator);
+      while (status == YAP_V2_OK) {
+        status = position_next(&iterator, &position);
+        if (status == YAP_V2_OK && position.position >= posting.field_length[position.field - 1U])
           return YAP_V2_INVALID_FORMAT;
-        previous_position[field - 1U] = position;
-        field_counts[field - 1U]++;
       }
-      if (field_counts[0] != posting.term_frequency[0] ||
-          field_counts[1] != posting.term_frequency[1] ||
-          field_counts[2] != posting.term_frequency[2])
+      if (status != YAP_V2_OUT_OF_RANGE)
         return YAP_V2_INVALID_FORMAT;
+      position_bytes = iterator.offset - (position_cursor + 16U);
+      term_positions += posting.position_count;
+      passages += posting.object_type == YAP_V2_LEXICAL_PASSAGE;
       previous = posting;
     }
+    if (passages != term->passage_frequency)
+      return YAP_V2_INVALID_FORMAT;
     for (i = 0U; i < block_count; i++) {
       uint32_t first = get_u32(postings + block_data + i * BLOCK_BYTES);
       uint32_t count = get_u32(postings + block_data + i * BLOCK_BYTES + 4U);
@@ -291,18 +426,29 @@ static int validate_payloads(YAP_V2_LEXICAL_SEGMENT *segment) {
       if (stored_max_tf != max_tf || stored_min_length != min_length)
         return YAP_V2_INVALID_FORMAT;
     }
+    if (term_positions != position_records || 16U + position_bytes != term->positions_bytes)
+      return YAP_V2_INVALID_FORMAT;
     counted_postings += term->document_frequency;
     counted_positions += position_records;
     posting_cursor += (size_t)term->postings_bytes;
     position_cursor += (size_t)term->positions_bytes;
   }
-  return posting_cursor == postings_size && position_cursor == positions_size &&
-             counted_postings == segment->posting_count &&
+  return cursor->offset == segment->term_index_offset && posting_cursor == postings_size &&
+             position_cursor == positions_size && counted_postings == segment->posting_count &&
              counted_positions == segment->position_count
            ? YAP_V2_OK
            : YAP_V2_INVALID_FORMAT;
 }
 
+static int validate_payloads(YAP_V2_LEXICAL_SEGMENT *segment) {
+  YAP_V2_TERM_CURSOR cursor;
+  int status;
+  YAP_V2_term_cursor_init(&cursor);
+  status = validate_term_payloads(segment, &cursor);
+  YAP_V2_term_cursor_free(&cursor);
+  return status;
+}
+
 int YAP_V2_lexical_segment_open(const char *segment_dir, uint64_t expected_generation,
                                 YAP_V2_LEXICAL_SEGMENT *segment) {
   static const char *const names[] = {"terms.yap2", "postings.yap2", "positions.yap2"};
@@ -342,51 +488,164 @@ int YAP_V2_lexical_segment_open(const char *segment_dir, uint64_t expected_gener
   return YAP_V2_OK;
 }
 
-const YAP_V2_TERM_ENTRY *YAP_V2_lexical_term_find(const YAP_V2_LEXICAL_SEGMENT *segment,
-                                                  YAP_V2_BYTES_VIEW term) {
-  size_t low = 0U, high;
-  if (segment == NULL || (term.len > 0U && term.data == NULL))
-    return NULL;
-  high = segment->term_count;
-  while (low < high) {
-    size_t middle = low + (high - low) / 2U;
-    const YAP_V2_TERM_ENTRY *entry = &segment->terms[middle];
-    size_t common = entry->term.len < term.len ? entry->term.len : term.len;
-    int order = memcmp(entry->term.data, term.data, common);
-    if (order == 0 && entry->term.len == term.len)
-      return entry;
-    if (order < 0 || (order == 0 && entry->term.len < term.len))
-      low = middle + 1U;
-    else
-      high = middle;
+int YAP_V2_lexical_term_find(const YAP_V2_LEXICAL_SEGMENT *segment, YAP_V2_BYTES_VIEW term,
+                             YAP_V2_TERM_ENTRY *entry) {
+  YAP_V2_TERM_CURSOR cursor;
+  size_t block, last, matched = 0U;
+  int before_first;
+  int status;
+  if (segment == NULL || entry == NULL || (term.len > 0U && term.data == NULL))
+    return YAP_V2_INVALID_ARGUMENT;
+  if (segment->term_count == 0U || term.len == 0U)
+    return YAP_V2_NOT_FOUND;
+  status = block_search(segment, term, &block, &before_first);
+  if (status == YAP_V2_OK && before_first)
+    return YAP_V2_NOT_FOUND;
+  if (status == YAP_V2_OK)
+    status = cursor_start(segment, block, &cursor);
+  last = (block + 1U) * YAP_V2_TERMS_BLOCK_SIZE;
+  if (last > segment->term_count)
+    last = segment->term_count;
+  /* matched is the common prefix of term and the current entry, which sorts below term. An
+   * entry sharing less than that with its predecessor sorts above term; one sharing more
+   * still sorts below it. Only entries sharing exactly matched bytes need their suffix. */
+  for (; status == YAP_V2_OK && cursor.index < last; cursor.index++) {
+    TERM_RECORD record;
+    status = term_record_read(segment, &cursor.offset, &record);
+    if (status != YAP_V2_OK)
+      break;
+    if (record.shared < matched)
+      return YAP_V2_NOT_FOUND;
+    if (record.shared == matched) {
+      size_t common = 0U;
+      while (common < record.suffix_len && matched + common < term.len &&
+             record.suffix[common] == term.data[matched + common])
+        common++;
+      if (common == record.suffix_len && matched + common == term.len) {
+        entry->document_frequency = record.document_frequency;
+        entry->passage_frequency = record.passage_frequency;
+        entry->postings_offset = cursor.postings_offset;
+        entry->postings_bytes = record.postings_bytes;
+        entry->positions_offset = cursor.positions_offset;
+        entry->positions_bytes = record.positions_bytes;
+        return YAP_V2_OK;
+      }
+      if (matched + common == term.len ||
+          (common < record.suffix_len && record.suffix[common] > term.data[matched + common]))
+        return YAP_V2_NOT_FOUND;
+      matched += common;
+    }
+    cursor.postings_offset += record.postings_bytes;
+    cursor.positions_offset += record.positions_bytes;
+  }
+  return status == YAP_V2_OK ? YAP_V2_NOT_FOUND : status;
+}
+
+int YAP_V2_lexical_term_may_exist(const YAP_V2_LEXICAL_SEGMENT *segment, uint64_t term_hash) {
+  if (segment == NULL || segment->term_count == 0U)
+    return 0;
+  return YAP_V2_term_filter_may_contain(
+    (const unsigned char *)segment->maps[0] + segment->term_filter_offset,
+    segment->term_filter_block_count, term_hash);
+}
+
+void YAP_V2_term_cursor_init(YAP_V2_TERM_CURSOR *cursor) {
+  if (cursor != NULL)
+    memset(cursor, 0, sizeof(*cursor));
+}
+
+void YAP_V2_term_cursor_free(YAP_V2_TERM_CURSOR *cursor) {
+  if (cursor == NULL)
+    return;
+  free(cursor->term);
+  YAP_V2_term_cursor_init(cursor);
+}
+
+int YAP_V2_term_cursor_seek(const YAP_V2_LEXICAL_SEGMENT *segment, YAP_V2_BYTES_VIEW term,
+                            YAP_V2_TERM_CURSOR *cursor) {
+  size_t block;
+  int before_first;
+  int status;
+  if (segment == NULL || cursor == NULL || (term.len > 0U && term.data == NULL))
+    return YAP_V2_INVALID_ARGUMENT;
+  if (segment->term_count == 0U)
+    return YAP_V2_OUT_OF_RANGE;
+  status = block_search(segment, term, &block, &before_first);
+  if (status == YAP_V2_OK)
+    status = cursor_start(segment, block, cursor);
+  while (status == YAP_V2_OK) {
+    YAP_V2_BYTES_VIEW current;
+    status = YAP_V2_term_cursor_next(cursor);
+    current.data = cursor->term;
+    current.len = cursor->term_len;
+    if (status == YAP_V2_OK && term_compare(current, term) >= 0)
+      return YAP_V2_OK;
+  }
+  return status;
+}
+
+int YAP_V2_term_cursor_next(YAP_V2_TERM_CURSOR *cursor) {
+  TERM_RECORD record;
+  size_t length;
+  int block_start;
+  int status;
+  if (cursor == NULL || cursor->segment == NULL)
+    return YAP_V2_INVALID_ARGUMENT;
+  if (cursor->index >= cursor->segment->term_count)
+    return YAP_V2_OUT_OF_RANGE;
+  status = term_record_read(cursor->segment, &cursor->offset, &record);
+  if (status != YAP_V2_OK)
+    return status;
+  block_start = cursor->index % YAP_V2_TERMS_BLOCK_SIZE == 0U;
+  if ((block_start && record.shared != 0U) || record.shared > cursor->term_len ||
+      record.suffix_len == 0U || record.document_frequency == 0U)
+    return YAP_V2_INVALID_FORMAT;
+  /* Terms strictly increase. Inside a block the first suffix byte must exceed the byte it
+   * replaces, which also makes shared the exact common prefix that term_find relies on. */
+  if (block_start) {
+    YAP_V2_BYTES_VIEW previous, next;
+    previous.data = cursor->term;
+    previous.len = cursor->term_len;
+    next.data = record.suffix;
+    next.len = record.suffix_len;
+    if (term_compare(previous, next) >= 0)
+      return YAP_V2_INVALID_FORMAT;
+  } else if (record.shared < cursor->term_len &&
+             record.suffix[0] <= cursor->term[record.shared]) {
+    return YAP_V2_INVALID_FORMAT;
+  }
+  length = (size_t)record.shared + record.suffix_len;
+  if (length > cursor->term_capacity) {
+    unsigned char *next = (unsigned char *)realloc(cursor->term, length);
+    if (next == NULL)
+      return YAP_V2_ALLOCATION_FAILED;
+    cursor->term = next;
+    cursor->term_capacity = length;
   }
-  return NULL;
+  memcpy(cursor->term + record.shared, record.suffix, record.suffix_len);
+  cursor->term_len = length;
+  cursor->entry.document_frequency = record.document_frequency;
+  cursor->entry.passage_frequency = record.passage_frequency;
+  cursor->entry.postings_offset = cursor->postings_offset;
+  cursor->entry.postings_bytes = record.postings_bytes;
+  cursor->entry.positions_offset = cursor->positions_offset;
+  cursor->entry.positions_bytes = record.positions_bytes;
+  cursor->postings_offset += record.postings_bytes;
+  cursor->positions_offset += record.positions_bytes;
+  cursor->index++;
+  return YAP_V2_OK;
 }
 
 int YAP_V2_lexical_term_type_frequency(const YAP_V2_LEXICAL_SEGMENT *segment,
                                        const YAP_V2_TERM_ENTRY *term,
                                        uint32_t object_type, uint64_t *frequency) {
-  const unsigned char *postings;
-  size_t low = 0U, high;
   if (segment == NULL || term == NULL || frequency == NULL ||
       (object_type != YAP_V2_LEXICAL_DOCUMENT && object_type != YAP_V2_LEXICAL_PASSAGE) ||
-      term->document_frequency > SIZE_MAX)
+      term->passage_frequency > term->document_frequency)
     return YAP_V2_INVALID_ARGUMENT;
-  postings = (const unsigned char *)segment->maps[1] + YAP_V2_FILE_HEADER_BYTES +
-             (size_t)term->postings_offset + 20U;
-  high = (size_t)term->document_frequency;
-  while (low < high) {
-    YAP_V2_POSTING posting;
-    size_t middle = low + (high - low) / 2U;
-    parse_posting(postings + middle * POSTING_BYTES, &posting);
-    if (posting.object_type < YAP_V2_LEXICAL_PASSAGE)
-      low = middle + 1U;
-    else
-      high = middle;
-  }
   *frequency = object_type == YAP_V2_LEXICAL_DOCUMENT
-                 ? (uint64_t)low
-                 : term->document_frequency - (uint64_t)low;
+                 ? term->document_frequency - term->passage_frequency
+                 : term->passage_frequency;
   return YAP_V2_OK;
 }
 
@@ -435,49 +694,68 @@ int YAP_V2_posting_iterator_block(const YAP_V2_POSTING_ITERATOR *iterator, size_
 }
 
 int YAP_V2_position_iterator_init(const YAP_V2_LEXICAL_SEGMENT *segment,
-                                  const YAP_V2_TERM_ENTRY *term,
+                                  const YAP_V2_TERM_ENTRY *term, const YAP_V2_POSTING *posting,
                                   YAP_V2_POSITION_ITERATOR *iterator) {
-  if (segment == NULL || term == NULL || iterator == NULL)
+  size_t data;
+  if (segment == NULL || term == NULL || posting == NULL || iterator == NULL)
     return YAP_V2_INVALID_ARGUMENT;
   memset(iterator, 0, sizeof(*iterator));
-  iterator->segment = segment;
-  iterator->term = term;
-  iterator->offset = YAP_V2_FILE_HEADER_BYTES + (size_t)term->positions_offset + 16U;
+  data = YAP_V2_FILE_HEADER_BYTES + (size_t)term->positions_offset + 16U;
+  if (term->positions_bytes < 16U || posting->position_offset > term->positions_bytes - 16U)
+    return YAP_V2_OUT_OF_RANGE;
+  iterator->data = (const unsigned char *)segment->maps[2];
+  iterator->offset = data + (size_t)posting->position_offset;
+  iterator->end = data + (size_t)term->positions_bytes - 16U;
+  iterator->remaining[0] = posting->term_frequency[0];
+  iterator->remaining[1] = posting->term_frequency[1];
+  iterator->remaining[2] = posting->term_frequency[2];
   return YAP_V2_OK;
 }
 
 int YAP_V2_position_iterator_next(YAP_V2_POSITION_ITERATOR *iterator, YAP_V2_POSITION *position) {
-  const unsigned char *data;
-  size_t count;
-  if (iterator == NULL || position == NULL || iterator->term == NULL)
+  if (iterator == NULL || position == NULL || iterator->data == NULL)
     return YAP_V2_INVALID_ARGUMENT;
-  count = ((size_t)iterator->term->positions_bytes - 16U) / 8U;
-  if (iterator->index >= count)
-    return YAP_V2_OUT_OF_RANGE;
-  data = (const unsigned char *)iterator->segment->maps[2] + iterator->offset;
-  position->field = get_u32(data);
-  position->position = get_u32(data + 4U);
-  iterator->offset += 8U;
-  iterator->index++;
-  return YAP_V2_OK;
+  return position_next(iterator, position);
 }
 
-int YAP_V2_posting_position_at(const YAP_V2_LEXICAL_SEGMENT *segment, const YAP_V2_TERM_ENTRY *term,
-                               const YAP_V2_POSTING *posting, size_t index,
-                               YAP_V2_POSITION *position) {
-  const unsigned char *data;
-  size_t offset;
-  if (segment == NULL || term == NULL || posting == NULL || position == NULL)
+int YAP_V2_posting_positions_read(const YAP_V2_LEXICAL_SEGMENT *segment,
+                                  const YAP_V2_TERM_ENTRY *term, const YAP_V2_POSTING *posting,
+                                  YAP_V2_POSITION *positions) {
+  YAP_V2_POSITION_ITERATOR iterator;
+  size_t i = 0U;
+  int status;
+  if (segment == NULL || term == NULL || posting == NULL ||
+      (positions == NULL && posting->position_count > 0U))
     return YAP_V2_INVALID_ARGUMENT;
-  if (index >= posting->position_count || term->positions_offset > SIZE_MAX ||
-      posting->position_offset > SIZE_MAX - index)
-    return YAP_V2_OUT_OF_RANGE;
-  offset = YAP_V2_FILE_HEADER_BYTES + (size_t)term->positions_offset + 16U +
-           ((size_t)posting->position_offset + index) * 8U;
-  if (!range_valid(offset, 8U, segment->map_bytes[2]))
-    return YAP_V2_INVALID_FORMAT;
-  data = (const unsigned char *)segment->maps[2] + offset;
-  position->field = get_u32(data);
-  position->position = get_u32(data + 4U);
-  return YAP_V2_OK;
+  status = YAP_V2_position_iterator_init(segment, term, posting, &iterator);
+  while (status == YAP_V2_OK && i < posting->position_count) {
+    uint32_t field = iterator.previous.field;
+    uint64_t word;
+    /* Inside a field, eight bytes without a continuation bit are eight whole gaps, which is
+     * the usual case for repeated terms. One 64-bit test replaces eight varint decodes. */
+    if (field != 0U && iterator.remaining[field - 1U] >= 8U &&
+        iterator.end - iterator.offset >= 8U &&
+        iterator.previous.position <= UINT32_MAX - 8U * 128U) {
+      memcpy(&word, iterator.data + iterator.offset, sizeof(word));
+      if ((word & UINT64_C(0x8080808080808080)) == 0U) {
+        const unsigned char *gaps = iterator.data + iterator.offset;
+        uint32_t position = iterator.previous.position;
+        size_t k;
+        for (k = 0U; k < 8U; k++) {
+          position += (uint32_t)gaps[k] + 1U;
+          positions[i + k].field = field;
+          positions[i + k].position = position;
+        }
+        iterator.previous.position = position;
+        iterator.remaining[field - 1U] -= 8U;
+        iterator.offset += 8U;
+        i += 8U;
+        continue;
+      }
+    }
+    status = position_next(&iterator, &positions[i]);
+    if (status == YAP_V2_OK)
+      i++;
+  }
+  return status == YAP_V2_OUT_OF_RANGE ? YAP_V2_INVALID_FORMAT : status;
 }
@@ -1,6 +1,7 @@
 #include "components/yappo_lexical_v2.h"
 
 #include "common/yappo_unicode.h"
+#include "components/yappo_term_filter_v2.h"
 
 #include <fcntl.h>
 #include <stdio.h>
@@ -73,16 +74,119 @@ static int append_u64(BUFFER *buffer, uint64_t value) {
   return append(buffer, encoded, sizeof(encoded));
 }
 
-static uint32_t crc32c(const unsigned char *data, size_t len) {
-  uint32_t crc = UINT32_MAX;
-  size_t i;
-  unsigned int bit;
-  for (i = 0U; i < len; i++) {
-    crc ^= data[i];
-    for (bit = 0U; bit < 8U; bit++)
-      crc = (crc & 1U) != 0U ? (crc >> 1) ^ UINT32_C(0x82f63b78) : crc >> 1;
+static int append_varint(BUFFER *buffer, uint32_t value) {
+  unsigned char encoded[5];
+  size_t len = 0U;
+  while (value >= 0x80U) {
+    encoded[len++] = (unsigned char)(value | 0x80U);
+    value >>= 7;
   }
-  return ~crc;
+  encoded[len++] = (unsigned char)value;
+  return append(buffer, encoded, len);
+}
+
+/* Positions of one posting arrive ordered by field and then position. The first position of
+ * each field is stored as is and later ones as the gap minus one, so adjacent tokens cost one
+ * byte. previous starts zeroed for every posting. */
+static int append_position(BUFFER *positions, YAP_V2_POSITION *previous, uint32_t field,
+                           uint32_t position) {
+  uint32_t value = field == previous->field ? position - previous->position - 1U : position;
+  previous->field = field;
+  previous->position = position;
+  return append_varint(positions, value);
+}
+
+/* terms.yap2 holds blocks of YAP_V2_TERMS_BLOCK_SIZE front-coded entries followed by one
+ * fixed-width index record per block and the vocabulary filter. Terms must be added in strictly
+ * increasing order. */
+typedef struct {
+  BUFFER index;
+  BUFFER previous;
+  BUFFER hashes;
+  uint64_t count;
+} TERM_WRITER;
+
+static int term_writer_add(TERM_WRITER *writer, BUFFER *terms, const unsigned char *term,
+                           size_t term_len, const YAP_V2_TERM_ENTRY *entry) {
+  size_t shared = 0U;
+  int status = YAP_V2_OK;
+  if (term_len > UINT32_MAX || entry->document_frequency > UINT32_MAX ||
+      entry->passage_frequency > entry->document_frequency ||
+      entry->postings_bytes > UINT32_MAX || entry->positions_bytes > UINT32_MAX)
+    return YAP_V2_OUT_OF_RANGE;
+  if (writer->count % YAP_V2_TERMS_BLOCK_SIZE == 0U) {
+    status = append_u64(&writer->index, terms->len);
+    if (status == YAP_V2_OK)
+      status = append_u64(&writer->index, entry->postings_offset);
+    if (status == YAP_V2_OK)
+      status = append_u64(&writer->index, entry->positions_offset);
+  } else {
+    while (shared < term_len && shared < writer->previous.len &&
+           term[shared] == writer->previous.data[shared])
+      shared++;
+  }
+  if (status == YAP_V2_OK)
+    status = append_varint(terms, (uint32_t)shared);
+  if (status == YAP_V2_OK)
+    status = append_varint(terms, (uint32_t)(term_len - shared));
+  if (status == YAP_V2_OK)
+    status = append(terms, term + shared, term_len - shared);
+  if (status == YAP_V2_OK)
+    status = append_varint(terms, (uint32_t)entry->document_frequency);
+  if (status == YAP_V2_OK)
+    status = append_varint(terms, (uint32_t)entry->passage_frequency);
+  if (status == YAP_V2_OK)
+    status = append_varint(terms, (uint32_t)entry->postings_bytes);
+  if (status == YAP_V2_OK)
+    status = append_varint(terms, (uint32_t)entry->positions_bytes);
+  writer->previous.len = 0U;
+  if (status == YAP_V2_OK)
+    status = append(&writer->previous, term, term_len);
+  if (status == YAP_V2_OK) {
+    uint64_t hash = YAP_V2_term_filter_hash(term, term_len);
+    status = append(&writer->hashes, &hash, sizeof(hash));
+  }
+  if (status == YAP_V2_OK)
+    writer->count++;
+  return status;
+}
+
+static int term_writer_finish(TERM_WRITER *writer, BUFFER *terms) {
+  size_t index_offset = terms->len;
+  size_t filter_offset = index_offset + writer->index.len;
+  uint64_t filter_blocks = YAP_V2_term_filter_block_count(writer->count);
+  const uint64_t *hashes = (const uint64_t *)(void *)writer->hashes.data;
+  unsigned char *filter = NULL;
+  uint64_t i;
+  int status;
+  if (filter_blocks > UINT32_MAX)
+    return YAP_V2_OUT_OF_RANGE;
+  if (filter_blocks > 0U) {
+    filter = (unsigned char *)calloc((size_t)filter_blocks, YAP_V2_TERM_FILTER_BLOCK_BYTES);
+    if (filter == NULL)
+      return YAP_V2_ALLOCATION_FAILED;
+    for (i = 0U; i < writer->count; i++)
+      YAP_V2_term_filter_insert(filter, filter_blocks, hashes[i]);
+  }
+  status = append(terms, writer->index.data, writer->index.len);
+  if (status == YAP_V2_OK)
+    status = append(terms, filter, (size_t)filter_blocks * YAP_V2_TERM_FILTER_BLOCK_BYTES);
+  if (status == YAP_V2_OK) {
+    put_u64(terms->data + 4U, writer->count);
+    put_u64(terms->data + 16U, writer->index.len / 24U);
+    put_u64(terms->data + 24U, index_offset);
+    put_u64(terms->data + 32U, filter_offset);
+    put_u64(terms->data + 40U, filter_blocks);
+  }
+  free(filter);
+  return status;
+}
+
+static void term_writer_free(TERM_WRITER *writer) {
+  free(writer->index.data);
+  free(writer->previous.data);
+  free(writer->hashes.data);
+  memset(writer, 0, sizeof(*writer));
 }
 
 static int fsync_parent(const char *path) {
@@ -127,7 +231,7 @@ static int write_component(const char *path, uint32_t file_type, uint64_t genera
   header.file_type = file_type;
   header.generation = generation;
   header.payload_bytes = payload->len;
-  header.payload_crc32c = crc32c(payload->data, payload->len);
+  header.payload_crc32c = YAP_V2_crc32c(payload->data, payload->len);
   status = YAP_V2_file_header_encode(&header, encoded);
   if (status != YAP_V2_OK)
     return status;
@@ -267,18 +371,20 @@ static int same_object(const OCCURRENCE *a, const OCCURRENCE *b) {
   return a->object_type == b->object_type && a->object_ordinal == b->object_ordinal;
 }
 
-static int build_payloads(OCCURRENCES *occurrences, size_t document_count, size_t passage_count,
-                          const uint64_t field_totals[3], BUFFER *terms, BUFFER *postings,
-                          BUFFER *positions, uint64_t *term_count_out,
-                          uint64_t *posting_count_out) {
-  size_t term_start;
-  uint64_t term_ordinal = 0U;
-  uint64_t posting_total = 0U;
-  int status;
-
-  if (occurrences->count > 1U)
-    qsort(occurrences->items, occurrences->count, sizeof(*occurrences->items), occurrence_compare);
-  status = append_u32(terms, YAP_V2_LEXICAL_PAYLOAD_VERSION);
+static int append_headers(BUFFER *terms, BUFFER *postings, BUFFER *positions,
+                          uint64_t document_count, uint64_t passage_count,
+                          const uint64_t field_totals[3]) {
+  int status = append_u32(terms, YAP_V2_TERMS_PAYLOAD_VERSION);
+  if (status == YAP_V2_OK)
+    status = append_u64(terms, 0U);
+  if (status == YAP_V2_OK)
+    status = append_u32(terms, YAP_V2_TERMS_BLOCK_SIZE);
+  if (status == YAP_V2_OK)
+    status = append_u64(terms, 0U);
+  if (status == YAP_V2_OK)
+    status = append_u64(terms, 0U);
+  if (status == YAP_V2_OK)
+    status = append_u64(terms, 0U);
   if (status == YAP_V2_OK)
     status = append_u64(terms, 0U);
   if (status == YAP_V2_OK)
@@ -298,17 +404,35 @@ static int build_payloads(OCCURRENCES *occurrences, size_t document_count, size_
   if (status == YAP_V2_OK)
     status = append_u64(postings, field_totals[2]);
   if (status == YAP_V2_OK)
-    status = append_u32(positions, YAP_V2_LEXICAL_PAYLOAD_VERSION);
+    status = append_u32(positions, YAP_V2_POSITIONS_PAYLOAD_VERSION);
   if (status == YAP_V2_OK)
     status = append_u64(positions, 0U);
+  return status;
+}
+
+static int build_payloads(OCCURRENCES *occurrences, size_t document_count, size_t passage_count,
+                          const uint64_t field_totals[3], BUFFER *terms, BUFFER *postings,
+                          BUFFER *positions, uint64_t *term_count_out,
+                          uint64_t *posting_count_out) {
+  TERM_WRITER writer;
+  size_t term_start;
+  uint64_t term_ordinal = 0U;
+  uint64_t posting_total = 0U;
+  int status;
+
+  memset(&writer, 0, sizeof(writer));
+  if (occurrences->count > 1U)
+    qsort(occurrences->items, occurrences->count, sizeof(*occurrences->items), occurrence_compare);
+  status = append_headers(terms, postings, positions, document_count, passage_count, field_totals);
 
   for (term_start = 0U; status == YAP_V2_OK && term_start < occurrences->count;) {
     size_t term_end = term_start + 1U;
     size_t object_start;
     uint64_t document_frequency = 0U;
+    uint64_t passage_frequency = 0U;
     uint64_t posting_offset = postings->len;
     uint64_t position_offset = positions->len;
-    uint64_t term_positions = 0U;
+    size_t position_data = positions->len + 16U;
 
     while (term_end < occurrences->count &&
            same_term(&occurrences->items[term_start], &occurrences->items[term_end]))
@@ -319,6 +443,8 @@ static int build_payloads(OCCURRENCES *occurrences, size_t document_count, size_
              same_object(&occurrences->items[object_start], &occurrences->items[object_end]))
         object_end++;
       document_frequency++;
+      if (occurrences->items[object_start].object_type == YAP_V2_LEXICAL_PASSAGE)
+        passage_frequency++;
       object_start = object_end;
     }
     status = append_u64(postings, term_ordinal);
@@ -336,6 +462,8 @@ static int build_payloads(OCCURRENCES *occurrences, size_t document_count, size_
     for (object_start = term_start; status == YAP_V2_OK && object_start < term_end;) {
       size_t object_end = object_start + 1U;
       size_t i;
+      uint64_t posting_positions = positions->len - position_data;
+      YAP_V2_POSITION previous = {0U, 0U};
       uint32_t title_tf = 0U, body_tf = 0U, passage_tf = 0U;
       uint32_t title_len = 0U, body_len = 0U, passage_len = 0U;
       while (object_end < term_end &&
@@ -353,9 +481,8 @@ static int build_payloads(OCCURRENCES *occurrences, size_t document_count, size_
           passage_tf++;
           passage_len = item->field_length;
         }
-        status = append_u32(positions, item->field);
         if (status == YAP_V2_OK)
-          status = append_u32(positions, item->position);
+          status = append_position(positions, &previous, item->field, item->position);
       }
       if (status == YAP_V2_OK)
         status = append_u32(postings, occurrences->items[object_start].object_type);
@@ -374,10 +501,9 @@ static int build_payloads(OCCURRENCES *occurrences, size_t document_count, size_
       if (status == YAP_V2_OK)
         status = append_u32(postings, passage_len);
       if (status == YAP_V2_OK)
-        status = append_u64(postings, term_positions);
+        status = append_u64(postings, posting_positions);
       if (status == YAP_V2_OK)
         status = append_u32(postings, (uint32_t)(object_end - object_start));
-      term_positions += object_end - object_start;
       posting_total++;
       object_start = object_end;
     }
@@ -420,26 +546,25 @@ static int build_payloads(OCCURRENCES *occurrences, size_t document_count, size_
         block_start = block_end;
       }
     }
-    if (status == YAP_V2_OK)
-      status = append_u32(terms, (uint32_t)occurrences->items[term_start].term_len);
-    if (status == YAP_V2_OK)
-      status =
-        append(terms, occurrences->items[term_start].term, occurrences->items[term_start].term_len);
-    if (status == YAP_V2_OK)
-      status = append_u64(terms, document_frequency);
-    if (status == YAP_V2_OK)
-      status = append_u64(terms, posting_offset);
-    if (status == YAP_V2_OK)
-      status = append_u64(terms, postings->len - posting_offset);
-    if (status == YAP_V2_OK)
-      status = append_u64(terms, position_offset);
-    if (status == YAP_V2_OK)
-      status = append_u64(terms, positions->len - position_offset);
+    if (status == YAP_V2_OK) {
+      YAP_V2_TERM_ENTRY entry;
+      entry.document_frequency = document_frequency;
+      entry.passage_frequency = passage_frequency;
+      entry.postings_offset = posting_offset;
+      entry.postings_bytes = postings->len - posting_offset;
+      entry.positions_offset = position_offset;
+      entry.positions_bytes = positions->len - position_offset;
+      status = term_writer_add(&writer, terms,
+                               (const unsigned char *)occurrences->items[term_start].term,
+                               occurrences->items[term_start].term_len, &entry);
+    }
     term_ordinal++;
     term_start = term_end;
   }
+  if (status == YAP_V2_OK)
+    status = term_writer_finish(&writer, terms);
+  term_writer_free(&writer);
   if (status == YAP_V2_OK) {
-    put_u64(terms->data + 4U, term_ordinal);
     put_u64(postings->data + 24U, posting_total);
     put_u64(positions->data + 4U, occurrences->count);
     *term_count_out = term_ordinal;
@@ -448,23 +573,12 @@ static int build_payloads(OCCURRENCES *occurrences, size_t document_count, size_
   return status;
 }
 
-static int write_occurrences(const char *segment_dir, uint64_t generation,
-                             OCCURRENCES *occurrences, size_t document_count,
-                             size_t passage_count, const uint64_t field_totals[3],
-                             YAP_V2_COMPONENT_DESCRIPTOR components[3]) {
+static int write_payloads(const char *segment_dir, uint64_t generation, const BUFFER payloads[3],
+                          const uint64_t records[3], YAP_V2_COMPONENT_DESCRIPTOR components[3]) {
   static const char *const names[] = {"terms.yap2", "postings.yap2", "positions.yap2"};
   static const uint32_t types[] = {YAP_V2_FILE_TERMS, YAP_V2_FILE_POSTINGS, YAP_V2_FILE_POSITIONS};
-  BUFFER payloads[3] = {{0}};
-  uint64_t term_count = 0U;
-  uint64_t posting_count = 0U;
-  uint64_t records[3];
   size_t i;
-  int status;
-  status = build_payloads(occurrences, document_count, passage_count, field_totals, &payloads[0],
-                          &payloads[1], &payloads[2], &term_count, &posting_count);
-  records[0] = term_count;
-  records[1] = posting_count;
-  records[2] = occurrences->count;
+  int status = YAP_V2_OK;
   for (i = 0U; status == YAP_V2_OK && i < 3U; i++) {
     size_t path_len = strlen(segment_dir) + strlen(names[i]) + 2U;
     char *path = (char *)malloc(path_len);
@@ -477,6 +591,26 @@ static int write_occurrences(const char *segment_dir, uint64_t generation,
     if (status == YAP_V2_OK) (void)strcpy(components[i].name, names[i]);
     free(path);
   }
+  return status;
+}
+
+static int write_occurrences(const char *segment_dir, uint64_t generation,
+                             OCCURRENCES *occurrences, size_t document_count,
+                             size_t passage_count, const uint64_t field_totals[3],
+                             YAP_V2_COMPONENT_DESCRIPTOR components[3]) {
+  BUFFER payloads[3] = {{0}};
+  uint64_t term_count = 0U;
+  uint64_t posting_count = 0U;
+  uint64_t records[3];
+  size_t i;
+  int status;
+  status = build_payloads(occurrences, document_count, passage_count, field_totals, &payloads[0],
+                          &payloads[1], &payloads[2], &term_count, &posting_count);
+  records[0] = term_count;
+  records[1] = posting_count;
+  records[2] = occurrences->count;
+  if (status == YAP_V2_OK)
+    status = write_payloads(segment_dir, generation, payloads, records, components);
   for (i = 0U; i < 3U; i++) free(payloads[i].data);
   return status;
 }
@@ -591,3 +725,292 @@ int YAP_V2_lexical_write(const char *segment_dir, uint64_t generation,
   YAP_V2_lexical_prepared_free(&occurrences);
   return status;
 }
+
+typedef struct {
+  uint32_t term_frequency;
+  uint32_t min_length;
+} MERGED_POSTING;
+
+typedef struct {
+  MERGED_POSTING *items;
+  size_t count;
+  size_t capacity;
+  uint64_t positions;
+  size_t position_data;
+  uint64_t previous_ordinal;
+  int has_previous;
+} MERGED_TERM;
+
+static int cursor_compare(const YAP_V2_TERM_CURSOR *left, const YAP_V2_TERM_CURSOR *right) {
+  size_t common = left->term_len < right->term_len ? left->term_len : right->term_len;
+  int order = memcmp(left->term, right->term, common);
+  if (order != 0)
+    return order;
+  if (left->term_len == right->term_len)
+    return 0;
+  return left->term_len < right->term_len ? -1 : 1;
+}
+
+static int merged_term_add(MERGED_TERM *merged, uint32_t term_frequency, uint32_t min_length) {
+  if (merged->count == merged->capacity) {
+    size_t capacity = merged->capacity == 0U ? 256U : merged->capacity * 2U;
+    MERGED_POSTING *next;
+    if (capacity < merged->capacity || capacity > SIZE_MAX / sizeof(*next))
+      return YAP_V2_OUT_OF_RANGE;
+    next = (MERGED_POSTING *)realloc(merged->items, capacity * sizeof(*next));
+    if (next == NULL)
+      return YAP_V2_ALLOCATION_FAILED;
+    merged->items = next;
+    merged->capacity = capacity;
+  }
+  merged->items[merged->count].term_frequency = term_frequency;
+  merged->items[merged->count].min_length = min_length;
+  merged->count++;
+  return YAP_V2_OK;
+}
+
+/* Copies the kept postings of one object type from a source term, renumbering objects and
+ * recording per-object field lengths so the merged header totals match a fresh build. */
+static int merge_source_postings(const YAP_V2_LEXICAL_MERGE_SOURCE *source,
+                                 const YAP_V2_TERM_ENTRY *term, uint32_t object_type,
+                                 size_t object_count, uint32_t *field_lengths,
+                                 MERGED_TERM *merged, BUFFER *postings, BUFFER *positions) {
+  const uint64_t *ordinals = object_type == YAP_V2_LEXICAL_DOCUMENT ? source->document_ordinals
+                                                                    : source->passage_ordinals;
+  YAP_V2_POSTING_ITERATOR iterator;
+  YAP_V2_POSTING posting;
+  int status = YAP_V2_posting_iterator_init(source->segment, term, &iterator);
+
+  while (status == YAP_V2_OK) {
+    YAP_V2_POSITION_ITERATOR source_positions;
+    YAP_V2_POSITION position;
+    YAP_V2_POSITION previous = {0U, 0U};
+    uint64_t ordinal;
+    uint32_t min_length = UINT32_MAX;
+    size_t i;
+    status = YAP_V2_posting_iterator_next(&iterator, &posting);
+    if (status == YAP_V2_OUT_OF_RANGE)
+      return YAP_V2_OK;
+    if (status != YAP_V2_OK)
+      break;
+    if (posting.object_type != object_type) {
+      if (object_type == YAP_V2_LEXICAL_DOCUMENT)
+        break;
+      continue;
+    }
+    ordinal = ordinals[posting.object_ordinal];
+    if (ordinal == YAP_V2_LEXICAL_ORDINAL_DROPPED)
+      continue;
+    if (ordinal >= object_count || (merged->has_previous && ordinal <= merged->previous_ordinal))
+      return YAP_V2_INVALID_ARGUMENT;
+    for (i = 0U; i < 3U; i++) {
+      if (posting.term_frequency[i] == 0U)
+        continue;
+      field_lengths[(size_t)ordinal * 3U + i] = posting.field_length[i];
+      if (posting.field_length[i] < min_length)
+        min_length = posting.field_length[i];
+    }
+    status = append_u32(postings, object_type);
+    if (status == YAP_V2_OK)
+      status = append_u64(postings, ordinal);
+    for (i = 0U; status == YAP_V2_OK && i < 3U; i++)
+      status = append_u32(postings, posting.term_frequency[i]);
+    for (i = 0U; status == YAP_V2_OK && i < 3U; i++)
+      status = append_u32(postings, posting.field_length[i]);
+    if (status == YAP_V2_OK)
+      status = append_u64(postings, positions->len - merged->position_data);
+    if (status == YAP_V2_OK)
+      status = append_u32(postings, posting.position_count);
+    if (status == YAP_V2_OK)
+      status =
+        YAP_V2_position_iterator_init(source->segment, term, &posting, &source_positions);
+    while (status == YAP_V2_OK) {
+      status = YAP_V2_position_iterator_next(&source_positions, &position);
+      if (status == YAP_V2_OK)
+        status = append_position(positions, &previous, position.field, position.position);
+    }
+    if (status == YAP_V2_OUT_OF_RANGE)
+      status = YAP_V2_OK;
+    if (status == YAP_V2_OK)
+      status = merged_term_add(merged, posting.position_count, min_length);
+    merged->positions += posting.position_count;
+    merged->previous_ordinal = ordinal;
+    merged->has_previous = 1;
+  }
+  return status;
+}
+
+static int append_merged_blocks(BUFFER *postings, const MERGED_TERM *merged) {
+  size_t first;
+  int status = YAP_V2_OK;
+  for (first = 0U; status == YAP_V2_OK && first < merged->count;
+       first += YAP_V2_POSTINGS_BLOCK_SIZE) {
+    size_t count = merged->count - first < YAP_V2_POSTINGS_BLOCK_SIZE
+                     ? merged->count - first
+                     : YAP_V2_POSTINGS_BLOCK_SIZE;
+    uint32_t max_tf = 0U;
+    uint32_t min_length = UINT32_MAX;
+    size_t i;
+    for (i = first; i < first + count; i++) {
+      if (merged->items[i].term_frequency > max_tf)
+        max_tf = merged->items[i].term_frequency;
+      if (merged->items[i].min_length < min_length)
+        min_length = merged->items[i].min_length;
+    }
+    status = append_u32(postings, (uint32_t)first);
+    if (status == YAP_V2_OK)
+      status = append_u32(postings, (uint32_t)count);
+    if (status == YAP_V2_OK)
+      status = append_u32(postings, max_tf);
+    if (status == YAP_V2_OK)
+      status = append_u32(postings, min_length == UINT32_MAX ? 0U : min_length);
+  }
+  return status;
+}
+
+/* Streams the source term dictionaries in term order and rewrites only the kept postings, so
+ * compaction produces the same payloads as re-tokenizing the surviving documents. */
+int YAP_V2_lexical_merge(const char *segment_dir, uint64_t generation,
+                         const YAP_V2_LEXICAL_MERGE_SOURCE *sources, size_t source_count,
+                         size_t document_count, size_t passage_count,
+                         YAP_V2_COMPONENT_DESCRIPTOR components[3]) {
+  static const uint64_t no_field_totals[3] = {0U, 0U, 0U};
+  static const uint32_t object_types[2] = {YAP_V2_LEXICAL_DOCUMENT, YAP_V2_LEXICAL_PASSAGE};
+  static const YAP_V2_BYTES_VIEW first_term = {NULL, 0U};
+  BUFFER payloads[3] = {{0}};
+  TERM_WRITER writer;
+  MERGED_TERM merged = {0};
+  YAP_V2_TERM_CURSOR *cursors = NULL;
+  unsigned char *live = NULL;
+  unsigned char *matched = NULL;
+  uint32_t *lengths[2] = {NULL, NULL};
+  uint64_t records[3] = {0U, 0U, 0U};
+  uint64_t field_totals[3] = {0U, 0U, 0U};
+  size_t i, t;
+  int status;
+
+  memset(&writer, 0, sizeof(writer));
+  if (segment_dir == NULL || generation == 0U || components == NULL ||
+      (source_count > 0U && sources == NULL) || document_count > YAP_V2_MAX_SEGMENT_DOCUMENTS ||
+      passage_count > YAP_V2_MAX_SEGMENT_PASSAGES)
+    return YAP_V2_INVALID_ARGUMENT;
+  for (i = 0U; i < source_count; i++)
+    if (sources[i].segment == NULL ||
+        (sources[i].segment->document_count > 0U && sources[i].document_ordinals == NULL) ||
+        (sources[i].segment->passage_count > 0U && sources[i].passage_ordinals == NULL))
+      return YAP_V2_INVALID_ARGUMENT;
+  cursors = source_count == 0U ? NULL
+                                : (YAP_V2_TERM_CURSOR *)calloc(source_count, sizeof(*cursors));
+  live = source_count == 0U ? NULL : (unsigned char *)calloc(source_count, sizeof(*live));
+  matched = source_count == 0U ? NULL : (unsigned char *)calloc(source_count, sizeof(*matched));
+  lengths[0] = document_count == 0U ? NULL : (uint32_t *)calloc(document_count * 3U,
+                                                                  sizeof(*lengths[0]));
+  lengths[1] = passage_count == 0U ? NULL : (uint32_t *)calloc(passage_count * 3U,
+                                                                 sizeof(*lengths[1]));
+  if ((source_count > 0U && (cursors == NULL || live == NULL || matched == NULL)) ||
+      (document_count > 0U && lengths[0] == NULL) || (passage_count > 0U && lengths[1] == NULL)) {
+    status = YAP_V2_ALLOCATION_FAILED;
+    goto done;
+  }
+  status = append_headers(&payloads[0], &payloads[1], &payloads[2], document_count,
+                          passage_count, no_field_totals);
+  for (i = 0U; status == YAP_V2_OK && i < source_count; i++) {
+    status = YAP_V2_term_cursor_seek(sources[i].segment, first_term, &cursors[i]);
+    live[i] = status == YAP_V2_OK;
+    if (status == YAP_V2_OUT_OF_RANGE)
+      status = YAP_V2_OK;
+  }
+  while (status == YAP_V2_OK) {
+    const YAP_V2_TERM_CURSOR *term = NULL;
+    size_t posting_offset = payloads[1].len;
+    size_t position_offset = payloads[2].len;
+    size_t document_postings = 0U;
+    for (i = 0U; i < source_count; i++)
+      if (live[i] && (term == NULL || cursor_compare(&cursors[i], term) < 0))
+        term = &cursors[i];
+    if (term == NULL)
+      break;
+    for (i = 0U; i < source_count; i++)
+      matched[i] = live[i] && cursor_compare(&cursors[i], term) == 0;
+    merged.count = 0U;
+    merged.positions = 0U;
+    merged.position_data = position_offset + 16U;
+    status = append_u64(&payloads[1], records[0]);
+    if (status == YAP_V2_OK)
+      status = append_u64(&payloads[1], 0U);
+    if (status == YAP_V2_OK)
+      status = append_u32(&payloads[1], 0U);
+    if (status == YAP_V2_OK)
+      status = append_u64(&payloads[2], records[0]);
+    if (status == YAP_V2_OK)
+      status = append_u64(&payloads[2], 0U);
+    for (t = 0U; status == YAP_V2_OK && t < 2U; t++) {
+      if (t == 1U)
+        document_postings = merged.count;
+      merged.has_previous = 0;
+      for (i = 0U; status == YAP_V2_OK && i < source_count; i++)
+        if (matched[i])
+          status = merge_source_postings(&sources[i], &cursors[i].entry,
+                                         object_types[t], t == 0U ? document_count : passage_count,
+                                         lengths[t], &merged, &payloads[1], &payloads[2]);
+    }
+    if (status == YAP_V2_OK && merged.count == 0U) {
+      payloads[1].len = posting_offset;
+      payloads[2].len = position_offset;
+    } else if (status == YAP_V2_OK) {
+      put_u64(payloads[1].data + posting_offset + 8U, merged.count);
+      put_u32(payloads[1].data + posting_offset + 16U,
+              (uint32_t)((merged.count + YAP_V2_POSTINGS_BLOCK_SIZE - 1U) /
+                         YAP_V2_POSTINGS_BLOCK_SIZE));
+      put_u64(payloads[2].data + position_offset + 8U, merged.positions);
+      status = append_merged_blocks(&payloads[1], &merged);
+      if (status == YAP_V2_OK) {
+        YAP_V2_TERM_ENTRY entry;
+        entry.document_frequency = merged.count;
+        entry.passage_frequency = merged.count - document_postings;
+        entry.postings_offset = posting_offset;
+        entry.postings_bytes = payloads[1].len - posting_offset;
+        entry.positions_offset = position_offset;
+        entry.positions_bytes = payloads[2].len - position_offset;
+        status = term_writer_add(&writer, &payloads[0], term->term, term->term_len, &entry);
+      }
+      records[0]++;
+      records[1] += merged.count;
+      records[2] += merged.positions;
+    }
+    for (i = 0U; status == YAP_V2_OK && i < source_count; i++) {
+      if (!matched[i])
+        continue;
+      status = YAP_V2_term_cursor_next(&cursors[i]);
+      live[i] = status == YAP_V2_OK;
+      if (status == YAP_V2_OUT_OF_RANGE)
+        status = YAP_V2_OK;
+    }
+  }
+  for (i = 0U; status == YAP_V2_OK && i < document_count * 3U; i++)
+    field_totals[i % 3U] += lengths[0][i];
+  for (i = 0U; status == YAP_V2_OK && i < passage_count * 3U; i++)
+    field_totals[i % 3U] += lengths[1][i];
+  if (status == YAP_V2_OK)
+    status = term_writer_finish(&writer, &payloads[0]);
+  if (status == YAP_V2_OK) {
+    put_u64(payloads[1].data + 24U, records[1]);
+    for (i = 0U; i < 3U; i++)
+      put_u64(payloads[1].data + 32U + i * 8U, field_totals[i]);
+    put_u64(payloads[2].data + 4U, records[2]);
+    status = write_payloads(segment_dir, generation, payloads, records, components);
+  }
+done:
+  for (i = 0U; i < 3U; i++)
+    free(payloads[i].data);
+  term_writer_free(&writer);
+  free(merged.items);
+  free(lengths[0]);
+  free(lengths[1]);
+  for (i = 0U; cursors != NULL && i < source_count; i++)
+    YAP_V2_term_cursor_free(&cursors[i]);
+  free(live);
+  free(matched);
+  free(cursors);
+  return status;
+}
@@ -7,7 +7,11 @@
 #include <stdint.h>
 
 #define YAP_V2_LEXICAL_PAYLOAD_VERSION UINT32_C(1)
+#define YAP_V2_POSITIONS_PAYLOAD_VERSION UINT32_C(2)
+#define YAP_V2_TERMS_PAYLOAD_VERSION UINT32_C(4)
+#define YAP_V2_TERMS_BLOCK_SIZE 16U
 #define YAP_V2_POSTINGS_BLOCK_SIZE 128U
+#define YAP_V2_LEXICAL_ORDINAL_DROPPED UINT64_MAX
 
 typedef enum { YAP_V2_LEXICAL_DOCUMENT = 1, YAP_V2_LEXICAL_PASSAGE = 2 } YAP_V2_LEXICAL_OBJECT_TYPE;
 
@@ -36,9 +40,11 @@ typedef struct {
   size_t passage_count;
 } YAP_V2_LEXICAL_PREPARED;
 
+/* document_frequency counts every object holding the term; passage_frequency counts the
+ * passages among them, so the document count is the difference. */
 typedef struct {
-  YAP_V2_BYTES_VIEW term;
   uint64_t document_frequency;
+  uint64_t passage_frequency;
   uint64_t postings_offset;
   uint64_t postings_bytes;
   uint64_t positions_offset;
@@ -75,25 +81,55 @@ typedef struct {
   uint64_t posting_count;
   uint64_t position_count;
   uint64_t field_token_count[3];
-  YAP_V2_TERM_ENTRY *terms;
   size_t term_count;
+  size_t term_block_count;
+  size_t term_index_offset;
+  size_t term_filter_offset;
+  size_t term_filter_block_count;
 } YAP_V2_LEXICAL_SEGMENT;
 
+/* Walks the front-coded term dictionary in place. Terms share a prefix with the previous
+ * term of their block, so the cursor rebuilds each one in its own buffer; term stays valid
+ * until the next call on the cursor. */
 typedef struct {
   const YAP_V2_LEXICAL_SEGMENT *segment;
-  const YAP_V2_TERM_ENTRY *term;
   size_t offset;
   size_t index;
-  size_t blocks_offset;
-} YAP_V2_POSTING_ITERATOR;
+  uint64_t postings_offset;
+  uint64_t positions_offset;
+  unsigned char *term;
+  size_t term_len;
+  size_t term_capacity;
+  YAP_V2_TERM_ENTRY entry;
+} YAP_V2_TERM_CURSOR;
 
 typedef struct {
   const YAP_V2_LEXICAL_SEGMENT *segment;
   const YAP_V2_TERM_ENTRY *term;
   size_t offset;
   size_t index;
+  size_t blocks_offset;
+} YAP_V2_POSTING_ITERATOR;
+
+/* Walks the positions of one posting. They are stored grouped by field, with the per-field
+ * counts taken from the posting's term frequencies, so the field is never encoded. */
+typedef struct {
+  const unsigned char *data;
+  size_t offset;
+  size_t end;
+  uint32_t remaining[3];
+  YAP_V2_POSITION previous;
 } YAP_V2_POSITION_ITERATOR;
 
+/* Source ordinal maps hold one entry per source document and passage. Kept objects map to
+ * output ordinals that increase with source order; removed ones map to
+ * YAP_V2_LEXICAL_ORDINAL_DROPPED. */
+typedef struct {
+  const YAP_V2_LEXICAL_SEGMENT *segment;
+  const uint64_t *document_ordinals;
+  const uint64_t *passage_ordinals;
+} YAP_V2_LEXICAL_MERGE_SOURCE;
+
 int YAP_V2_lexical_write(const char *segment_dir, uint64_t generation,
                          const YAP_V2_DOCUMENT_VIEW *documents, size_t document_count,
                          const YAP_V2_PASSAGE_VIEW *passages, size_t passage_count,
@@ -108,12 +144,28 @@ int YAP_V2_lexical_write_prepared(const char *segment_dir, uint64_t generation,
                                   const YAP_V2_LEXICAL_PREPARED *const *prepared,
                                   size_t prepared_count,
                                   YAP_V2_COMPONENT_DESCRIPTOR components[3]);
+int YAP_V2_lexical_merge(const char *segment_dir, uint64_t generation,
+                         const YAP_V2_LEXICAL_MERGE_SOURCE *sources, size_t source_count,
+                         size_t document_count, size_t passage_count,
+                         YAP_V2_COMPONENT_DESCRIPTOR components[3]);
 void YAP_V2_lexical_segment_init(YAP_V2_LEXICAL_SEGMENT *segment);
 void YAP_V2_lexical_segment_close(YAP_V2_LEXICAL_SEGMENT *segment);
 int YAP_V2_lexical_segment_open(const char *segment_dir, uint64_t expected_generation,
                                 YAP_V2_LEXICAL_SEGMENT *segment);
-const YAP_V2_TERM_ENTRY *YAP_V2_lexical_term_find(const YAP_V2_LEXICAL_SEGMENT *segment,
-                                                  YAP_V2_BYTES_VIEW term);
+/* Binary-searches the block index in the mapping and scans one block, comparing front-coded
+ * suffixes against term without rebuilding entries. Returns YAP_V2_NOT_FOUND when absent. */
+int YAP_V2_lexical_term_find(const YAP_V2_LEXICAL_SEGMENT *segment, YAP_V2_BYTES_VIEW term,
+                             YAP_V2_TERM_ENTRY *entry);
+/* Probes the vocabulary filter with a hash from YAP_V2_term_filter_hash. 0 means the term is
+ * absent from the segment; 1 means YAP_V2_lexical_term_find has to decide. */
+int YAP_V2_lexical_term_may_exist(const YAP_V2_LEXICAL_SEGMENT *segment, uint64_t term_hash);
+void YAP_V2_term_cursor_init(YAP_V2_TERM_CURSOR *cursor);
+void YAP_V2_term_cursor_free(YAP_V2_TERM_CURSOR *cursor);
+/* Positions the cursor on the first term not less than term; an empty term starts at the
+ * first entry. Returns YAP_V2_OUT_OF_RANGE when every term is smaller. */
+int YAP_V2_term_cursor_seek(const YAP_V2_LEXICAL_SEGMENT *segment, YAP_V2_BYTES_VIEW term,
+                            YAP_V2_TERM_CURSOR *cursor);
+int YAP_V2_term_cursor_next(YAP_V2_TERM_CURSOR *cursor);
 int YAP_V2_lexical_term_type_frequency(const YAP_V2_LEXICAL_SEGMENT *segment,
                                        const YAP_V2_TERM_ENTRY *term,
                                        uint32_t object_type, uint64_t *frequency);
@@ -123,11 +175,13 @@ int YAP_V2_posting_iterator_next(YAP_V2_POSTING_ITERATOR *iterator, YAP_V2_POSTI
 int YAP_V2_posting_iterator_block(const YAP_V2_POSTING_ITERATOR *iterator, size_t block_index,
                                   YAP_V2_POSTINGS_BLOCK *block);
 int YAP_V2_position_iterator_init(const YAP_V2_LEXICAL_SEGMENT *segment,
-                                  const YAP_V2_TERM_ENTRY *term,
+                                  const YAP_V2_TERM_ENTRY *term, const YAP_V2_POSTING *posting,
                                   YAP_V2_POSITION_ITERATOR *iterator);
 int YAP_V2_position_iterator_next(YAP_V2_POSITION_ITERATOR *iterator, YAP_V2_POSITION *position);
-int YAP_V2_posting_position_at(const YAP_V2_LEXICAL_SEGMENT *segment, const YAP_V2_TERM_ENTRY *term,
-                               const YAP_V2_POSTING *posting, size_t index,
-                               YAP_V2_POSITION *position);
+/* Decodes all posting->position_count positions of one posting, in stored order. Runs of
+ * one-byte gaps are decoded eight at a time. */
+int YAP_V2_posting_positions_read(const YAP_V2_LEXICAL_SEGMENT *segment,
+                                  const YAP_V2_TERM_ENTRY *term, const YAP_V2_POSTING *posting,
+                                  YAP_V2_POSITION *positions);
 
 #endif
@@ -34,17 +34,6 @@ static void put_u64(unsigned char *p, uint64_t value) {
   for (i = 0U; i < 8U; i++) p[i] = (unsigned char)(value >> (8U * i));
 }
 
-static uint32_t crc32c(const unsigned char *data, size_t len) {
-  uint32_t crc = UINT32_MAX;
-  size_t i; unsigned int bit;
-  for (i = 0U; i < len; i++) {
-    crc ^= data[i];
-    for (bit = 0U; bit < 8U; bit++)
-      crc = (crc & 1U) != 0U ? (crc >> 1) ^ UINT32_C(0x82f63b78) : crc >> 1;
-  }
-  return ~crc;
-}
-
 static int append(BUFFER *buffer, const void *data, size_t len) {
   size_t needed, capacity; unsigned char *next;
   if (len > SIZE_MAX - buffer->len) return YAP_V2_OUT_OF_RANGE;
@@ -138,7 +127,7 @@ static int write_atomic(const char *path, uint64_t generation, BUFFER *payload,
   memset(&header, 0, sizeof(header)); header.format_version = YAP_V2_FORMAT_VERSION;
   header.header_bytes = YAP_V2_FILE_HEADER_BYTES; header.file_type = YAP_V2_FILE_METADATA;
   header.generation = generation; header.payload_bytes = payload->len;
-  header.payload_crc32c = crc32c(payload->data, payload->len);
+  header.payload_crc32c = YAP_V2_crc32c(payload->data, payload->len);
   if (YAP_V2_file_header_encode(&header, encoded) != YAP_V2_OK) return YAP_V2_INVALID_FORMAT;
   temporary = malloc(path_len + 5U); if (temporary == NULL) return YAP_V2_ALLOCATION_FAILED;
   snprintf(temporary, path_len + 5U, "%s.tmp", path);
@@ -244,7 +233,7 @@ int YAP_V2_metadata_read(const char *path, uint64_t expected_generation,
       (expected_generation != 0U && header.generation != expected_generation) ||
       header.payload_bytes != (uint64_t)size - YAP_V2_FILE_HEADER_BYTES || header.payload_bytes > SIZE_MAX) goto done;
   payload = malloc((size_t)header.payload_bytes); if (payload == NULL && header.payload_bytes > 0U) { status = YAP_V2_ALLOCATION_FAILED; goto done; }
-  if (fread(payload, 1U, (size_t)header.payload_bytes, file) != header.payload_bytes || crc32c(payload, (size_t)header.payload_bytes) != header.payload_crc32c) { status = YAP_V2_CHECKSUM_MISMATCH; goto done; }
+  if (fread(payload, 1U, (size_t)header.payload_bytes, file) != header.payload_bytes || YAP_V2_crc32c(payload, (size_t)header.payload_bytes) != header.payload_crc32c) { status = YAP_V2_CHECKSUM_MISMATCH; goto done; }
   if (header.payload_bytes < 24U || get_u32(payload) != 1U || get_u32(payload + 4U) != config->filterable_field_count) goto done;
   index->field_count = config->filterable_field_count; index->document_count = get_u64(payload + 8U); entry_count = get_u64(payload + 16U); offset = 24U;
   if (entry_count > SIZE_MAX / sizeof(*index->entries)) { status = YAP_V2_OUT_OF_RANGE; goto done; }
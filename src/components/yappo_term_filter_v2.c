@@ -0,0 +1,70 @@
+#include "components/yappo_term_filter_v2.h"
+
+static const uint32_t salts[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                  0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+static uint32_t get_u32(const unsigned char *data) {
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) |
+         ((uint32_t)data[3] << 24);
+}
+
+static void put_u32(unsigned char *out, uint32_t value) {
+  out[0] = (unsigned char)value;
+  out[1] = (unsigned char)(value >> 8);
+  out[2] = (unsigned char)(value >> 16);
+  out[3] = (unsigned char)(value >> 24);
+}
+
+/* The high half picks the block by multiply-shift, so block counts need not be powers of two;
+ * the low half picks one bit per word. */
+static const unsigned char *block_for(const unsigned char *blocks, uint64_t block_count,
+                                      uint64_t hash) {
+  uint64_t block = ((hash >> 32) * block_count) >> 32;
+  return blocks + (size_t)block * YAP_V2_TERM_FILTER_BLOCK_BYTES;
+}
+
+uint64_t YAP_V2_term_filter_hash(const unsigned char *term, size_t term_len) {
+  uint64_t hash = UINT64_C(1469598103934665603);
+  size_t i;
+  for (i = 0U; i < term_len; i++) {
+    hash ^= term[i];
+    hash *= UINT64_C(1099511628211);
+  }
+  /* FNV-1a leaves the high bits weakly mixed; the block choice depends on them. */
+  hash ^= hash >> 33;
+  hash *= UINT64_C(0xff51afd7ed558ccd);
+  hash ^= hash >> 33;
+  hash *= UINT64_C(0xc4ceb9fe1a85ec53);
+  hash ^= hash >> 33;
+  return hash;
+}
+
+uint64_t YAP_V2_term_filter_block_count(uint64_t term_count) {
+  return term_count / YAP_V2_TERM_FILTER_TERMS_PER_BLOCK +
+         (term_count % YAP_V2_TERM_FILTER_TERMS_PER_BLOCK != 0U);
+}
+
+void YAP_V2_term_filter_insert(unsigned char *blocks, uint64_t block_count, uint64_t hash) {
+  unsigned char *block;
+  uint32_t key = (uint32_t)hash;
+  size_t i;
+  if (blocks == NULL || block_count == 0U || block_count > UINT32_MAX)
+    return;
+  block = (unsigned char *)block_for(blocks, block_count, hash);
+  for (i = 0U; i < 8U; i++)
+    put_u32(block + i * 4U, get_u32(block + i * 4U) | (UINT32_C(1) << ((key * salts[i]) >> 27)));
+}
+
+int YAP_V2_term_filter_may_contain(const unsigned char *blocks, uint64_t block_count,
+                                   uint64_t hash) {
+  const unsigned char *block;
+  uint32_t key = (uint32_t)hash;
+  size_t i;
+  if (blocks == NULL || block_count == 0U || block_count > UINT32_MAX)
+    return 0;
+  block = block_for(blocks, block_count, hash);
+  for (i = 0U; i < 8U; i++)
+    if ((get_u32(block + i * 4U) & (UINT32_C(1) << ((key * salts[i]) >> 27))) == 0U)
+      return 0;
+  return 1;
+}
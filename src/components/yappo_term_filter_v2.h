@@ -0,0 +1,20 @@
+#ifndef YAPPO_TERM_FILTER_V2_H
+#define YAPPO_TERM_FILTER_V2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A split-block Bloom filter over one segment's vocabulary. Each term sets one bit in each of
+ * the eight 32-bit words of a single 32-byte block, so a probe touches one cache line. */
+#define YAP_V2_TERM_FILTER_BLOCK_BYTES 32U
+#define YAP_V2_TERM_FILTER_TERMS_PER_BLOCK 16U
+
+uint64_t YAP_V2_term_filter_hash(const unsigned char *term, size_t term_len);
+/* One block per YAP_V2_TERM_FILTER_TERMS_PER_BLOCK terms, rounded up; 0 for no terms. */
+uint64_t YAP_V2_term_filter_block_count(uint64_t term_count);
+void YAP_V2_term_filter_insert(unsigned char *blocks, uint64_t block_count, uint64_t hash);
+/* Returns 0 when no term with this hash was inserted and 1 when one may have been. */
+int YAP_V2_term_filter_may_contain(const unsigned char *blocks, uint64_t block_count,
+                                   uint64_t hash);
+
+#endif
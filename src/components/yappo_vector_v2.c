@@ -51,16 +51,6 @@ static int utf8_valid(const unsigned char *data, size_t len) {
   return 1;
 }
 
-static uint32_t crc32c(const unsigned char *data, size_t len) {
-  uint32_t crc = UINT32_MAX; size_t i; unsigned int bit;
-  for (i = 0U; i < len; i++) {
-    crc ^= data[i];
-    for (bit = 0U; bit < 8U; bit++)
-      crc = (crc & 1U) != 0U ? (crc >> 1) ^ UINT32_C(0x82f63b78) : crc >> 1;
-  }
-  return ~crc;
-}
-
 static int append(BUFFER *buffer, const void *data, size_t len) {
   size_t needed, capacity; unsigned char *next;
   if (len > SIZE_MAX - buffer->len) return YAP_V2_OUT_OF_RANGE;
@@ -111,7 +101,7 @@ static int write_atomic(const char *path, uint64_t generation, const BUFFER *pay
   memset(&header, 0, sizeof(header)); header.format_version = YAP_V2_FORMAT_VERSION;
   header.header_bytes = YAP_V2_FILE_HEADER_BYTES; header.file_type = YAP_V2_FILE_VECTORS;
   header.generation = generation; header.payload_bytes = payload->len;
-  header.payload_crc32c = crc32c(payload->data, payload->len);
+  header.payload_crc32c = YAP_V2_crc32c(payload->data, payload->len);
   status = YAP_V2_file_header_encode(&header, encoded); if (status != YAP_V2_OK) return status;
   path_len = strlen(path); temporary = malloc(path_len + 5U);
   if (temporary == NULL) return YAP_V2_ALLOCATION_FAILED;
@@ -216,7 +206,7 @@ int YAP_V2_vector_segment_open(const char *path, uint64_t expected_generation,
     status = YAP_V2_INVALID_FORMAT; goto done;
   }
   payload = map + YAP_V2_FILE_HEADER_BYTES; payload_bytes = (size_t)header.payload_bytes;
-  if (crc32c(payload, payload_bytes) != header.payload_crc32c) { status = YAP_V2_CHECKSUM_MISMATCH; goto done; }
+  if (YAP_V2_crc32c(payload, payload_bytes) != header.payload_crc32c) { status = YAP_V2_CHECKSUM_MISMATCH; goto done; }
   if (payload_bytes < VECTOR_FIXED_HEADER_BYTES || get_u32(payload) != VECTOR_PAYLOAD_VERSION)
     goto done;
   if (get_u32(payload + 4U) != (uint32_t)config->vector_metric ||
@@ -201,6 +201,12 @@ void YAP_application_config_init(YAP_APPLICATION_CONFIG *config) {
   config->core_search_threads = YAP_APPLICATION_DEFAULT_SEARCH_THREADS;
   config->core_writer_queue_capacity = 1U;
   config->core_writer_queue_bytes = YAP_APPLICATION_DEFAULT_WRITER_QUEUE_BYTES;
+  config->memtable_max_age_ms = YAP_APPLICATION_DEFAULT_MEMTABLE_MAX_AGE_MS;
+  config->wal_durability = YAP_V2_WAL_SYNC_BATCH;
+  config->wal_sync_interval_ms = YAP_V2_DEFAULT_WAL_SYNC_INTERVAL_MS;
+  config->latency_precision_bits = YAP_APPLICATION_DEFAULT_LATENCY_PRECISION_BITS;
+  config->slow_query_entries = YAP_APPLICATION_DEFAULT_SLOW_QUERY_ENTRIES;
+  config->slow_query_interval_seconds = YAP_APPLICATION_DEFAULT_SLOW_QUERY_INTERVAL_SECONDS;
   YAP_V2_compaction_policy_init(&config->compaction_policy);
 }
 
@@ -213,8 +219,12 @@ int YAP_application_config_load(const char *path, YAP_APPLICATION_CONFIG *config
   static const char *const metadata_keys[] = {"filterable_fields", NULL};
   static const char *const daemon_keys[] = {"run_directory", "core_host", "core_port",
     "front_host", "front_port", "max_inflight", "max_inflight_bytes",
-    "front_io_threads", "core_io_threads", "core_search_threads",
+    "adaptive_concurrency", "adaptive_min_inflight", "adaptive_latency_target_ms",
+    "front_io_threads", "core_io_threads", "core_search_threads", "ann_build_threads",
     "core_writer_queue_capacity", "core_writer_queue_bytes",
+    "memtable_max_operations", "memtable_max_age_ms", "wal_durability", "wal_sync_interval_ms",
+    "latency_precision_bits", "slow_query_entries", "slow_query_interval_seconds",
+    "slow_query_sample_one_in",
     "request_timeout_ms", "ingest_max_body_bytes", "ingest_timeout_ms", "write_token",
     "auto_compact_enabled", "auto_compact_check_interval_ms",
     "auto_compact_small_segment_bytes", "auto_compact_min_small_segments", NULL};
@@ -223,6 +233,7 @@ int YAP_application_config_load(const char *path, YAP_APPLICATION_CONFIG *config
   toml_datum_t enabled, metric, token;
   char parse_error[256] = {0}, canonical[YAP_APPLICATION_PATH_BYTES];
   char base[YAP_APPLICATION_PATH_BYTES], path_value[YAP_APPLICATION_PATH_BYTES];
+  char durability[16];
   uint32_t value;
   int status = YAP_V2_INVALID_FORMAT;
   char *slash;
@@ -334,6 +345,33 @@ int YAP_application_config_load(const char *path, YAP_APPLICATION_CONFIG *config
                        YAP_APPLICATION_MAX_EXECUTION_THREADS, 0, error, error_size);
   if (status != YAP_V2_OK) goto done;
   config->core_search_threads = value;
+  value = (uint32_t)config->ann_build_threads;
+  status = read_uint32(daemon, "ann_build_threads", &value, 0U,
+                       YAP_APPLICATION_MAX_ANN_BUILD_THREADS, 0, error, error_size);
+  if (status != YAP_V2_OK) goto done;
+  config->ann_build_threads = value;
+  value = (uint32_t)config->memtable_max_operations;
+  status = read_uint32(daemon, "memtable_max_operations", &value, 0U,
+                       YAP_APPLICATION_MAX_MEMTABLE_OPERATIONS, 0, error, error_size);
+  if (status != YAP_V2_OK) goto done;
+  config->memtable_max_operations = value;
+  status = read_uint32(daemon, "memtable_max_age_ms", &config->memtable_max_age_ms, 1U,
+                       3600000U, 0, error, error_size);
+  if (status != YAP_V2_OK) goto done;
+  durability[0] = '\0';
+  status = read_string(daemon, "wal_durability", durability, sizeof(durability), 0,
+                       error, error_size);
+  if (status != YAP_V2_OK) goto done;
+  if (strcmp(durability, "request") == 0) config->wal_durability = YAP_V2_WAL_SYNC_REQUEST;
+  else if (strcmp(durability, "interval") == 0) config->wal_durability = YAP_V2_WAL_SYNC_INTERVAL;
+  else if (durability[0] != '\0' && strcmp(durability, "batch") != 0) {
+    set_error(error, error_size, "daemon.wal_durability must be request, batch or interval");
+    status = YAP_V2_INVALID_FORMAT;
+    goto done;
+  }
+  status = read_uint32(daemon, "wal_sync_interval_ms", &config->wal_sync_interval_ms, 1U,
+                       YAP_V2_MAX_WAL_SYNC_INTERVAL_MS, 0, error, error_size);
+  if (status != YAP_V2_OK) goto done;
   value = (uint32_t)config->core_writer_queue_capacity;
   status = read_uint32(daemon, "core_writer_queue_capacity", &value, 1U,
                        1024U, 0, error, error_size);
@@ -352,6 +390,35 @@ int YAP_application_config_load(const char *path, YAP_APPLICATION_CONFIG *config
   status = read_uint32(daemon, "max_inflight_bytes", &value, 1U, 1024U * 1024U * 1024U, 0, error, error_size);
   if (status != YAP_V2_OK) goto done;
   config->runtime_policy.max_inflight_bytes = value;
+  status = read_boolean(daemon, "adaptive_concurrency",
+                        &config->runtime_policy.adaptive_concurrency, 0, error, error_size);
+  if (status != YAP_V2_OK) goto done;
+  value = (uint32_t)config->runtime_policy.adaptive_min_inflight;
+  status = read_uint32(daemon, "adaptive_min_inflight", &value, 1U, 1024U, 0, error, error_size);
+  if (status != YAP_V2_OK) goto done;
+  if (value > config->runtime_policy.max_inflight) {
+    set_error(error, error_size, "adaptive_min_inflight must not exceed max_inflight");
+    status = YAP_V2_OUT_OF_RANGE;
+    goto done;
+  }
+  config->runtime_policy.adaptive_min_inflight = value;
+  status = read_uint32(daemon, "adaptive_latency_target_ms",
+                       &config->runtime_policy.adaptive_latency_target_ms, 0U, 60000U, 0,
+                       error, error_size);
+  if (status != YAP_V2_OK) goto done;
+  status = read_uint32(daemon, "latency_precision_bits", &config->latency_precision_bits, 1U,
+                       YAP_APPLICATION_MAX_LATENCY_PRECISION_BITS, 0, error, error_size);
+  if (status != YAP_V2_OK) goto done;
+  status = read_uint32(daemon, "slow_query_entries", &config->slow_query_entries, 0U,
+                       YAP_APPLICATION_MAX_SLOW_QUERY_ENTRIES, 0, error, error_size);
+  if (status != YAP_V2_OK) goto done;
+  status = read_uint32(daemon, "slow_query_interval_seconds",
+                       &config->slow_query_interval_seconds, 1U,
+                       YAP_APPLICATION_MAX_SLOW_QUERY_INTERVAL_SECONDS, 0, error, error_size);
+  if (status != YAP_V2_OK) goto done;
+  status = read_uint32(daemon, "slow_query_sample_one_in", &config->slow_query_sample_one_in, 0U,
+                       YAP_APPLICATION_MAX_SLOW_QUERY_SAMPLE_ONE_IN, 0, error, error_size);
+  if (status != YAP_V2_OK) goto done;
   value = config->runtime_policy.request_timeout_ms;
   status = read_uint32(daemon, "request_timeout_ms", &value, 1U, 60000U, 0, error, error_size);
   if (status != YAP_V2_OK) goto done;
@@ -13,8 +13,18 @@
 #define YAP_APPLICATION_DEFAULT_IO_THREADS 16U
 #define YAP_APPLICATION_DEFAULT_SEARCH_THREADS 16U
 #define YAP_APPLICATION_MAX_EXECUTION_THREADS 1024U
+#define YAP_APPLICATION_MAX_ANN_BUILD_THREADS 256U
+#define YAP_APPLICATION_MAX_MEMTABLE_OPERATIONS 10000U
+#define YAP_APPLICATION_DEFAULT_MEMTABLE_MAX_AGE_MS 1000U
 #define YAP_APPLICATION_DEFAULT_WRITER_QUEUE_BYTES (128U * 1024U * 1024U)
 #define YAP_APPLICATION_MAX_WRITER_QUEUE_BYTES (1024U * 1024U * 1024U)
+#define YAP_APPLICATION_DEFAULT_LATENCY_PRECISION_BITS 5U
+#define YAP_APPLICATION_MAX_LATENCY_PRECISION_BITS 8U
+#define YAP_APPLICATION_DEFAULT_SLOW_QUERY_ENTRIES 16U
+#define YAP_APPLICATION_MAX_SLOW_QUERY_ENTRIES 1024U
+#define YAP_APPLICATION_DEFAULT_SLOW_QUERY_INTERVAL_SECONDS 60U
+#define YAP_APPLICATION_MAX_SLOW_QUERY_INTERVAL_SECONDS 86400U
+#define YAP_APPLICATION_MAX_SLOW_QUERY_SAMPLE_ONE_IN 1000000U
 
 typedef struct {
   YAP_V2_CONFIG index_config;
@@ -28,8 +38,17 @@ typedef struct {
   size_t front_io_threads;
   size_t core_io_threads;
   size_t core_search_threads;
+  size_t ann_build_threads;
+  size_t memtable_max_operations;
+  uint32_t memtable_max_age_ms;
+  YAP_V2_WAL_DURABILITY wal_durability;
+  uint32_t wal_sync_interval_ms;
   size_t core_writer_queue_capacity;
   size_t core_writer_queue_bytes;
+  uint32_t latency_precision_bits;
+  uint32_t slow_query_entries;
+  uint32_t slow_query_interval_seconds;
+  uint32_t slow_query_sample_one_in;
   YAP_V2_COMPACTION_POLICY compaction_policy;
 } YAP_APPLICATION_CONFIG;
 
@@ -1,5 +1,6 @@
 #include "config/yappo_runtime_policy_v2.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,6 +13,16 @@
 #define YAP_V2_DEFAULT_MAX_INFLIGHT_BYTES (4U * 1024U * 1024U)
 #define YAP_V2_DEFAULT_TIMEOUT_MS 5000U
 #define YAP_V2_MAX_TIMEOUT_MS 60000U
+/* The no-load latency is the minimum of the previous window, so it can rise again after
+ * the index or the hardware gets slower. */
+#define YAP_V2_ADAPTIVE_WINDOW_SAMPLES 512U
+/* Without a latency target, latency may reach this multiple of the no-load latency
+ * before the limit shrinks. */
+#define YAP_V2_ADAPTIVE_TOLERANCE 2.0
+#define YAP_V2_ADAPTIVE_SMOOTHING 0.2
+/* A request that ran out of its deadline multiplies the limit by this, as a loss does to a
+ * TCP window. */
+#define YAP_V2_ADAPTIVE_DROP_BACKOFF 0.9
 
 static void set_error(char *error, size_t capacity, const char *message) {
   if (error != NULL && capacity > 0U) (void)snprintf(error, capacity, "%s", message);
@@ -22,6 +33,7 @@ void YAP_V2_runtime_policy_init(YAP_V2_RUNTIME_POLICY *policy) {
   memset(policy, 0, sizeof(*policy));
   policy->max_inflight = YAP_V2_DEFAULT_MAX_INFLIGHT;
   policy->max_inflight_bytes = YAP_V2_DEFAULT_MAX_INFLIGHT_BYTES;
+  policy->adaptive_min_inflight = 1U;
   policy->request_timeout_ms = YAP_V2_DEFAULT_TIMEOUT_MS;
   policy->ingest_max_body_bytes = YAP_V2_DEFAULT_INGEST_MAX_BODY_BYTES;
   policy->ingest_timeout_ms = YAP_V2_DEFAULT_INGEST_TIMEOUT_MS;
@@ -118,11 +130,21 @@ int YAP_V2_runtime_policy_load_config(YAP_V2_RUNTIME_POLICY *policy, const char
 int YAP_V2_runtime_limiter_init(YAP_V2_RUNTIME_LIMITER *limiter,
                                 const YAP_V2_RUNTIME_POLICY *policy) {
   if (limiter == NULL || policy == NULL || policy->max_inflight == 0U ||
-      policy->max_inflight_bytes == 0U || limiter->initialized) return YAP_V2_INVALID_ARGUMENT;
+      policy->max_inflight_bytes == 0U || limiter->initialized ||
+      (policy->adaptive_concurrency &&
+       (policy->adaptive_min_inflight == 0U ||
+        policy->adaptive_min_inflight > policy->max_inflight)))
+    return YAP_V2_INVALID_ARGUMENT;
   memset(limiter, 0, sizeof(*limiter));
   if (pthread_mutex_init(&limiter->lock, NULL) != 0) return YAP_V2_IO_ERROR;
   limiter->max_inflight = policy->max_inflight;
   limiter->max_inflight_bytes = policy->max_inflight_bytes; limiter->initialized = 1;
+  limiter->adaptive = policy->adaptive_concurrency != 0;
+  limiter->min_inflight = policy->adaptive_min_inflight;
+  limiter->latency_target_microseconds = (uint64_t)policy->adaptive_latency_target_ms * 1000U;
+  /* Start halfway so a cold burst cannot use the whole ceiling before any sample arrives. */
+  limiter->limit = (double)(policy->max_inflight + 1U) / 2.0;
+  if (limiter->limit < (double)limiter->min_inflight) limiter->limit = (double)limiter->min_inflight;
   return YAP_V2_OK;
 }
 
@@ -131,18 +153,60 @@ void YAP_V2_runtime_limiter_close(YAP_V2_RUNTIME_LIMITER *limiter) {
   (void)pthread_mutex_destroy(&limiter->lock); memset(limiter, 0, sizeof(*limiter));
 }
 
+static size_t limiter_count_limit(const YAP_V2_RUNTIME_LIMITER *limiter) {
+  return limiter->adaptive ? (size_t)limiter->limit : limiter->max_inflight;
+}
+
 int YAP_V2_runtime_limiter_acquire(YAP_V2_RUNTIME_LIMITER *limiter, size_t request_bytes) {
   int status = YAP_V2_OK;
   if (limiter == NULL || !limiter->initialized || request_bytes == 0U)
     return YAP_V2_INVALID_ARGUMENT;
   pthread_mutex_lock(&limiter->lock);
-  if (limiter->inflight >= limiter->max_inflight ||
-      request_bytes > limiter->max_inflight_bytes - limiter->inflight_bytes)
-    status = YAP_V2_OUT_OF_RANGE;
-  else { limiter->inflight++; limiter->inflight_bytes += request_bytes; }
+  if (limiter->inflight >= limiter_count_limit(limiter) ||
+      request_bytes > limiter->max_inflight_bytes - limiter->inflight_bytes) {
+    status = YAP_V2_OUT_OF_RANGE; limiter->rejected++;
+  } else { limiter->inflight++; limiter->inflight_bytes += request_bytes; }
   pthread_mutex_unlock(&limiter->lock); return status;
 }
 
+/* Gradient limit in the style of TCP Vegas: shrink by target / latency, or without a
+ * target by rtt_noload * tolerance / latency, once latency exceeds it; otherwise add
+ * sqrt(limit) of queueing headroom, but only while the limit is actually being used.
+ * Called with lock held. */
+static void limiter_observe(YAP_V2_RUNTIME_LIMITER *limiter, size_t inflight,
+                            uint64_t latency_microseconds) {
+  double gradient, next;
+  if (latency_microseconds == 0U) latency_microseconds = 1U;
+  if (limiter->rtt_noload_microseconds == 0U ||
+      latency_microseconds < limiter->rtt_noload_microseconds)
+    limiter->rtt_noload_microseconds = latency_microseconds;
+  if (limiter->window_samples == 0U || latency_microseconds < limiter->window_min_microseconds)
+    limiter->window_min_microseconds = latency_microseconds;
+  if (++limiter->window_samples >= YAP_V2_ADAPTIVE_WINDOW_SAMPLES) {
+    limiter->rtt_noload_microseconds = limiter->window_min_microseconds;
+    limiter->window_samples = 0U;
+  }
+  if (limiter->latency_target_microseconds != 0U)
+    gradient = (double)limiter->latency_target_microseconds / (double)latency_microseconds;
+  else
+    gradient = (double)limiter->rtt_noload_microseconds * YAP_V2_ADAPTIVE_TOLERANCE /
+               (double)latency_microseconds;
+  if (gradient > 1.0) gradient = 1.0;
+  if (gradient < 0.5) gradient = 0.5;
+  next = limiter->limit * gradient;
+  if (gradient >= 1.0 && (double)inflight * 2.0 >= limiter->limit) next += sqrt(limiter->limit);
+  limiter->limit = limiter->limit * (1.0 - YAP_V2_ADAPTIVE_SMOOTHING) +
+                   next * YAP_V2_ADAPTIVE_SMOOTHING;
+  if (limiter->limit < (double)limiter->min_inflight) limiter->limit = (double)limiter->min_inflight;
+  if (limiter->limit > (double)limiter->max_inflight) limiter->limit = (double)limiter->max_inflight;
+}
+
+/* Called with lock held. */
+static void limiter_drop(YAP_V2_RUNTIME_LIMITER *limiter) {
+  limiter->limit *= YAP_V2_ADAPTIVE_DROP_BACKOFF;
+  if (limiter->limit < (double)limiter->min_inflight) limiter->limit = (double)limiter->min_inflight;
+}
+
 void YAP_V2_runtime_limiter_release(YAP_V2_RUNTIME_LIMITER *limiter, size_t request_bytes) {
   if (limiter == NULL || !limiter->initialized) return;
   pthread_mutex_lock(&limiter->lock);
@@ -152,6 +216,29 @@ void YAP_V2_runtime_limiter_release(YAP_V2_RUNTIME_LIMITER *limiter, size_t requ
   pthread_mutex_unlock(&limiter->lock);
 }
 
+void YAP_V2_runtime_limiter_release_observed(YAP_V2_RUNTIME_LIMITER *limiter,
+                                             size_t request_bytes,
+                                             uint64_t latency_microseconds) {
+  if (limiter == NULL || !limiter->initialized) return;
+  pthread_mutex_lock(&limiter->lock);
+  if (limiter->inflight > 0U && request_bytes <= limiter->inflight_bytes) {
+    if (limiter->adaptive) limiter_observe(limiter, limiter->inflight, latency_microseconds);
+    limiter->inflight--; limiter->inflight_bytes -= request_bytes;
+  }
+  pthread_mutex_unlock(&limiter->lock);
+}
+
+void YAP_V2_runtime_limiter_release_dropped(YAP_V2_RUNTIME_LIMITER *limiter,
+                                            size_t request_bytes) {
+  if (limiter == NULL || !limiter->initialized) return;
+  pthread_mutex_lock(&limiter->lock);
+  if (limiter->inflight > 0U && request_bytes <= limiter->inflight_bytes) {
+    if (limiter->adaptive) limiter_drop(limiter);
+    limiter->inflight--; limiter->inflight_bytes -= request_bytes;
+  }
+  pthread_mutex_unlock(&limiter->lock);
+}
+
 int YAP_V2_runtime_limiter_snapshot(YAP_V2_RUNTIME_LIMITER *limiter, size_t *inflight,
                                     size_t *inflight_bytes, size_t *max_inflight,
                                     size_t *max_inflight_bytes) {
@@ -159,7 +246,19 @@ int YAP_V2_runtime_limiter_snapshot(YAP_V2_RUNTIME_LIMITER *limiter, size_t *inf
       max_inflight == NULL || max_inflight_bytes == NULL) return YAP_V2_INVALID_ARGUMENT;
   pthread_mutex_lock(&limiter->lock);
   *inflight = limiter->inflight; *inflight_bytes = limiter->inflight_bytes;
-  *max_inflight = limiter->max_inflight; *max_inflight_bytes = limiter->max_inflight_bytes;
+  *max_inflight = limiter_count_limit(limiter);
+  *max_inflight_bytes = limiter->max_inflight_bytes;
+  pthread_mutex_unlock(&limiter->lock); return YAP_V2_OK;
+}
+
+int YAP_V2_runtime_limiter_state(YAP_V2_RUNTIME_LIMITER *limiter,
+                                 YAP_V2_RUNTIME_LIMITER_STATE *state) {
+  if (limiter == NULL || !limiter->initialized || state == NULL) return YAP_V2_INVALID_ARGUMENT;
+  pthread_mutex_lock(&limiter->lock);
+  state->adaptive = limiter->adaptive;
+  state->limit = limiter_count_limit(limiter);
+  state->rtt_noload_microseconds = limiter->rtt_noload_microseconds;
+  state->rejected = limiter->rejected;
   pthread_mutex_unlock(&limiter->lock); return YAP_V2_OK;
 }
 
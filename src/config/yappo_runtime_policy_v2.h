@@ -11,10 +11,25 @@
 #define YAP_V2_MAX_INGEST_BODY_BYTES (256U * 1024U * 1024U)
 #define YAP_V2_DEFAULT_INGEST_TIMEOUT_MS 60000U
 #define YAP_V2_MAX_INGEST_TIMEOUT_MS 600000U
+#define YAP_V2_DEFAULT_WAL_SYNC_INTERVAL_MS 100U
+#define YAP_V2_MAX_WAL_SYNC_INTERVAL_MS 10000U
 
+/* When the core fsyncs memtable WAL records: after each appended request group, once per
+ * writer microbatch, or at most once per interval with acknowledgements ahead of the sync. */
+typedef enum {
+  YAP_V2_WAL_SYNC_BATCH = 0,
+  YAP_V2_WAL_SYNC_REQUEST = 1,
+  YAP_V2_WAL_SYNC_INTERVAL = 2
+} YAP_V2_WAL_DURABILITY;
+
+/* With adaptive_concurrency the limiter treats max_inflight as a ceiling and moves its
+ * count limit between adaptive_min_inflight and that ceiling from observed latency. */
 typedef struct {
   size_t max_inflight;
   size_t max_inflight_bytes;
+  int adaptive_concurrency;
+  size_t adaptive_min_inflight;
+  uint32_t adaptive_latency_target_ms;
   uint32_t request_timeout_ms;
   size_t ingest_max_body_bytes;
   uint32_t ingest_timeout_ms;
@@ -29,8 +44,23 @@ typedef struct {
   size_t max_inflight;
   size_t max_inflight_bytes;
   int initialized;
+  int adaptive;
+  size_t min_inflight;
+  uint64_t latency_target_microseconds;
+  double limit;
+  uint64_t rtt_noload_microseconds;
+  uint64_t window_min_microseconds;
+  size_t window_samples;
+  uint64_t rejected;
 } YAP_V2_RUNTIME_LIMITER;
 
+typedef struct {
+  int adaptive;
+  size_t limit;
+  uint64_t rtt_noload_microseconds;
+  uint64_t rejected;
+} YAP_V2_RUNTIME_LIMITER_STATE;
+
 void YAP_V2_runtime_policy_init(YAP_V2_RUNTIME_POLICY *policy);
 int YAP_V2_runtime_policy_load_config(YAP_V2_RUNTIME_POLICY *policy, const char *config_path,
                                       char *error, size_t error_size);
@@ -39,9 +69,22 @@ int YAP_V2_runtime_limiter_init(YAP_V2_RUNTIME_LIMITER *limiter,
 void YAP_V2_runtime_limiter_close(YAP_V2_RUNTIME_LIMITER *limiter);
 int YAP_V2_runtime_limiter_acquire(YAP_V2_RUNTIME_LIMITER *limiter, size_t request_bytes);
 void YAP_V2_runtime_limiter_release(YAP_V2_RUNTIME_LIMITER *limiter, size_t request_bytes);
+/* Releases like YAP_V2_runtime_limiter_release and, for an adaptive limiter, feeds the
+ * request latency into the next count limit. */
+void YAP_V2_runtime_limiter_release_observed(YAP_V2_RUNTIME_LIMITER *limiter,
+                                             size_t request_bytes,
+                                             uint64_t latency_microseconds);
+/* Releases a request that missed its deadline, in the queue or while running. For an
+ * adaptive limiter this cuts the count limit multiplicatively; such a request is not a
+ * latency sample. */
+void YAP_V2_runtime_limiter_release_dropped(YAP_V2_RUNTIME_LIMITER *limiter,
+                                            size_t request_bytes);
+/* max_inflight reports the count limit currently enforced. */
 int YAP_V2_runtime_limiter_snapshot(YAP_V2_RUNTIME_LIMITER *limiter, size_t *inflight,
                                     size_t *inflight_bytes, size_t *max_inflight,
                                     size_t *max_inflight_bytes);
+int YAP_V2_runtime_limiter_state(YAP_V2_RUNTIME_LIMITER *limiter,
+                                 YAP_V2_RUNTIME_LIMITER_STATE *state);
 int YAP_V2_authorize_write(const YAP_V2_RUNTIME_POLICY *policy, const char *authorization);
 int YAP_V2_socket_set_deadline(int fd, uint32_t timeout_ms);
 
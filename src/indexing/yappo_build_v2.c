@@ -2,6 +2,8 @@
 
 #include "config/yappo_config_v2.h"
 #include "config/yappo_application_config.h"
+#include "components/yappo_ann_v2.h"
+#include "indexing/yappo_compact_v2.h"
 #include "indexing/yappo_ingest.h"
 #include "storage/yappo_manifest_v2.h"
 #include "indexing/yappo_update_v2.h"
@@ -9,10 +11,13 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 static int join_path(char *output, size_t capacity, const char *left, const char *right) {
@@ -58,90 +63,546 @@ static int sync_parent(const char *path) {
   return status;
 }
 
-static void free_operations(YAP_V2_INGEST_OPERATION *operations, size_t count) {
-  size_t i;
-  for (i = 0U; i < count; i++) YAP_V2_ingest_operation_free(&operations[i]);
-  free(operations);
+#define YAP_V2_BUILD_MAX_THREADS 64U
+
+typedef enum {
+  BUILD_STAGE_READ = 0,
+  BUILD_STAGE_PREPARE = 1,
+  BUILD_STAGE_WRITE = 2,
+  BUILD_STAGE_PUBLISH = 3,
+  BUILD_STAGE_COUNT = 4
+} BUILD_STAGE;
+
+typedef struct {
+  size_t threads;
+  uint64_t records;
+  uint64_t busy_microseconds;
+} BUILD_STAGE_STATS;
+
+typedef struct {
+  size_t sequence;
+  size_t first_line;
+  char *text;
+  size_t text_bytes;
+  size_t text_capacity;
+  size_t *line_offsets;
+  size_t *line_bytes;
+  size_t line_count;
+  YAP_V2_BUILD_BATCH *batch;
+} BUILD_WORK;
+
+typedef struct {
+  BUILD_WORK **items;
+  size_t capacity;
+  size_t head;
+  size_t count;
+  int closed;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+} WORK_QUEUE;
+
+/* Batches flow reader -> prepare workers -> segment writers -> publisher.  Batch
+ * sequence numbers fix the manifest generation of every batch, and the publisher
+ * commits them strictly in sequence order, so the published index does not depend
+ * on thread scheduling.  At most `window` batches are in flight at once.  In bulk
+ * mode every batch is written at the single target generation and the publisher
+ * only appends its segments to `staged`; one manifest is published at the end. */
+typedef struct {
+  const char *index_dir;
+  const YAP_V2_CONFIG *config;
+  YAP_V2_MANIFEST *staged;
+  FILE *input;
+  pthread_mutex_t mutex;
+  pthread_cond_t publish_ready;
+  pthread_cond_t publish_space;
+  WORK_QUEUE prepare_queue;
+  WORK_QUEUE write_queue;
+  BUILD_WORK **ready;
+  size_t window;
+  size_t next_publish;
+  size_t active_preparers;
+  size_t active_writers;
+  int failed;
+  int status;
+  size_t error_sequence;
+  char error[256];
+  BUILD_STAGE_STATS stages[BUILD_STAGE_COUNT];
+} BUILD_PIPELINE;
+
+static uint64_t monotonic_microseconds(void) {
+  struct timespec value;
+  if (clock_gettime(CLOCK_MONOTONIC, &value) != 0) return 0U;
+  return (uint64_t)value.tv_sec * UINT64_C(1000000) + (uint64_t)value.tv_nsec / 1000U;
 }
 
-static int publish_batch(const char *index_dir, YAP_V2_INGEST_OPERATION *operations,
-                         size_t count, uint64_t *generation, size_t *accepted,
-                         char *error, size_t error_size) {
-  YAP_V2_UPDATE_RESULT result;
-  YAP_V2_update_result_init(&result);
-  int status = YAP_V2_build_apply(index_dir, operations, count, &result, error, error_size);
-  if (status == YAP_V2_OK) {
-    *generation = result.generation;
-    *accepted += result.accepted;
-  }
-  YAP_V2_update_result_free(&result);
-  return status;
+static BUILD_WORK *work_create(size_t sequence, size_t first_line) {
+  BUILD_WORK *work = calloc(1U, sizeof(*work));
+  if (work == NULL) return NULL;
+  work->sequence = sequence;
+  work->first_line = first_line;
+  work->line_offsets = malloc(YAP_V2_BUILD_BATCH_OPERATIONS * sizeof(*work->line_offsets));
+  work->line_bytes = malloc(YAP_V2_BUILD_BATCH_OPERATIONS * sizeof(*work->line_bytes));
+  if (work->line_offsets == NULL || work->line_bytes == NULL) {
+    free(work->line_offsets); free(work->line_bytes); free(work);
+    return NULL;
+  }
+  return work;
 }
 
-static int ingest_stream(const char *input_path, const char *index_dir,
-                         uint64_t *generation, size_t *accepted,
-                         char *error, size_t error_size) {
-  FILE *input = fopen(input_path, "rb");
-  YAP_V2_INGEST_OPERATION *operations;
-  char *line = NULL;
-  size_t capacity = 0U, count = 0U, line_number = 0U;
-  int status = YAP_V2_OK;
-  ssize_t length;
-  if (input == NULL) {
-    (void)snprintf(error, error_size, "cannot open input: %s", strerror(errno));
-    return YAP_V2_IO_ERROR;
+static void work_free(BUILD_WORK *work) {
+  if (work == NULL) return;
+  free(work->text);
+  free(work->line_offsets);
+  free(work->line_bytes);
+  YAP_V2_build_batch_free(work->batch);
+  free(work);
+}
+
+static int work_append(BUILD_WORK *work, const char *line, size_t bytes) {
+  if (bytes > SIZE_MAX - 1U || work->text_bytes > SIZE_MAX - bytes - 1U) return -1;
+  if (work->text_bytes + bytes + 1U > work->text_capacity) {
+    size_t capacity = work->text_capacity == 0U ? 65536U : work->text_capacity;
+    char *grown;
+    while (capacity < work->text_bytes + bytes + 1U) {
+      if (capacity > SIZE_MAX / 2U) return -1;
+      capacity *= 2U;
+    }
+    grown = realloc(work->text, capacity);
+    if (grown == NULL) return -1;
+    work->text = grown;
+    work->text_capacity = capacity;
   }
-  operations = calloc(YAP_V2_BUILD_BATCH_OPERATIONS, sizeof(*operations));
-  if (operations == NULL) {
-    (void)snprintf(error, error_size, "cannot allocate build batch");
-    (void)fclose(input);
-    return YAP_V2_ALLOCATION_FAILED;
+  memcpy(work->text + work->text_bytes, line, bytes);
+  work->text[work->text_bytes + bytes] = '\0';
+  work->line_offsets[work->line_count] = work->text_bytes;
+  work->line_bytes[work->line_count++] = bytes;
+  work->text_bytes += bytes + 1U;
+  return 0;
+}
+
+static int queue_init(WORK_QUEUE *queue, size_t capacity) {
+  memset(queue, 0, sizeof(*queue));
+  queue->items = calloc(capacity, sizeof(*queue->items));
+  if (queue->items == NULL) return -1;
+  queue->capacity = capacity;
+  if (pthread_cond_init(&queue->not_empty, NULL) != 0) { free(queue->items); return -1; }
+  if (pthread_cond_init(&queue->not_full, NULL) != 0) {
+    pthread_cond_destroy(&queue->not_empty); free(queue->items); return -1;
+  }
+  return 0;
+}
+
+static void queue_destroy(WORK_QUEUE *queue) {
+  while (queue->count > 0U) {
+    work_free(queue->items[queue->head]);
+    queue->head = (queue->head + 1U) % queue->capacity;
+    queue->count--;
   }
-  while ((length = getline(&line, &capacity, input)) >= 0) {
+  pthread_cond_destroy(&queue->not_empty);
+  pthread_cond_destroy(&queue->not_full);
+  free(queue->items);
+}
+
+static void wake_all_locked(BUILD_PIPELINE *pipeline) {
+  pthread_cond_broadcast(&pipeline->prepare_queue.not_empty);
+  pthread_cond_broadcast(&pipeline->prepare_queue.not_full);
+  pthread_cond_broadcast(&pipeline->write_queue.not_empty);
+  pthread_cond_broadcast(&pipeline->write_queue.not_full);
+  pthread_cond_broadcast(&pipeline->publish_ready);
+  pthread_cond_broadcast(&pipeline->publish_space);
+}
+
+/* Keeps the error of the earliest failing batch so the reported failure matches
+ * what a sequential build would have stopped on. */
+static void pipeline_fail(BUILD_PIPELINE *pipeline, size_t sequence, int status,
+                          const char *message) {
+  pthread_mutex_lock(&pipeline->mutex);
+  if (!pipeline->failed || sequence < pipeline->error_sequence) {
+    pipeline->status = status == YAP_V2_OK ? YAP_V2_IO_ERROR : status;
+    pipeline->error_sequence = sequence;
+    (void)snprintf(pipeline->error, sizeof(pipeline->error), "%s",
+                   message == NULL ? "" : message);
+  }
+  pipeline->failed = 1;
+  wake_all_locked(pipeline);
+  pthread_mutex_unlock(&pipeline->mutex);
+}
+
+static void pipeline_record(BUILD_PIPELINE *pipeline, BUILD_STAGE stage,
+                            uint64_t records, uint64_t busy_microseconds) {
+  pthread_mutex_lock(&pipeline->mutex);
+  pipeline->stages[stage].records += records;
+  pipeline->stages[stage].busy_microseconds += busy_microseconds;
+  pthread_mutex_unlock(&pipeline->mutex);
+}
+
+static int queue_push(BUILD_PIPELINE *pipeline, WORK_QUEUE *queue, BUILD_WORK *work) {
+  int accepted = 0;
+  pthread_mutex_lock(&pipeline->mutex);
+  while (!pipeline->failed && !queue->closed && queue->count == queue->capacity)
+    pthread_cond_wait(&queue->not_full, &pipeline->mutex);
+  if (!pipeline->failed && !queue->closed) {
+    queue->items[(queue->head + queue->count) % queue->capacity] = work;
+    queue->count++;
+    accepted = 1;
+    pthread_cond_signal(&queue->not_empty);
+  }
+  pthread_mutex_unlock(&pipeline->mutex);
+  return accepted;
+}
+
+static BUILD_WORK *queue_pop(BUILD_PIPELINE *pipeline, WORK_QUEUE *queue) {
+  BUILD_WORK *work = NULL;
+  pthread_mutex_lock(&pipeline->mutex);
+  while (!pipeline->failed && !queue->closed && queue->count == 0U)
+    pthread_cond_wait(&queue->not_empty, &pipeline->mutex);
+  if (!pipeline->failed && queue->count > 0U) {
+    work = queue->items[queue->head];
+    queue->head = (queue->head + 1U) % queue->capacity;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+  }
+  pthread_mutex_unlock(&pipeline->mutex);
+  return work;
+}
+
+static int wait_for_window(BUILD_PIPELINE *pipeline, size_t sequence) {
+  int admitted;
+  pthread_mutex_lock(&pipeline->mutex);
+  while (!pipeline->failed && sequence >= pipeline->next_publish + pipeline->window)
+    pthread_cond_wait(&pipeline->publish_space, &pipeline->mutex);
+  admitted = !pipeline->failed;
+  pthread_mutex_unlock(&pipeline->mutex);
+  return admitted;
+}
+
+static void *reader_main(void *argument) {
+  BUILD_PIPELINE *pipeline = argument;
+  BUILD_WORK *work = NULL;
+  char *line = NULL, message[256];
+  size_t capacity = 0U, line_number = 0U, sequence = 0U;
+  uint64_t records = 0U, busy = 0U, started = monotonic_microseconds();
+  ssize_t length;
+  while ((length = getline(&line, &capacity, pipeline->input)) >= 0) {
     size_t bytes = (size_t)length;
     line_number++;
     while (bytes > 0U && (line[bytes - 1U] == '\n' || line[bytes - 1U] == '\r')) bytes--;
     if (bytes == 0U) {
-      (void)snprintf(error, error_size, "empty record at line %zu", line_number);
-      status = YAP_V2_INVALID_FORMAT;
+      (void)snprintf(message, sizeof(message), "empty record at line %zu", line_number);
+      pipeline_fail(pipeline, sequence, YAP_V2_INVALID_FORMAT, message);
       break;
     }
-    status = YAP_V2_ingest_parse_ndjson(line, bytes, &operations[count], error, error_size);
+    if (work == NULL) {
+      busy += monotonic_microseconds() - started;
+      if (!wait_for_window(pipeline, sequence)) break;
+      started = monotonic_microseconds();
+      work = work_create(sequence, line_number);
+      if (work == NULL) {
+        pipeline_fail(pipeline, sequence, YAP_V2_ALLOCATION_FAILED, "cannot allocate build batch");
+        break;
+      }
+    }
+    if (work_append(work, line, bytes) != 0) {
+      pipeline_fail(pipeline, sequence, YAP_V2_ALLOCATION_FAILED, "cannot allocate build batch");
+      break;
+    }
+    records++;
+    if (work->line_count == YAP_V2_BUILD_BATCH_OPERATIONS) {
+      busy += monotonic_microseconds() - started;
+      if (!queue_push(pipeline, &pipeline->prepare_queue, work)) break;
+      work = NULL;
+      sequence++;
+      started = monotonic_microseconds();
+    }
+  }
+  if (length < 0 && ferror(pipeline->input))
+    pipeline_fail(pipeline, sequence, YAP_V2_IO_ERROR, "cannot read input");
+  busy += monotonic_microseconds() - started;
+  if (work != NULL && queue_push(pipeline, &pipeline->prepare_queue, work)) work = NULL;
+  work_free(work);
+  free(line);
+  pipeline_record(pipeline, BUILD_STAGE_READ, records, busy);
+  pthread_mutex_lock(&pipeline->mutex);
+  pipeline->prepare_queue.closed = 1;
+  pthread_cond_broadcast(&pipeline->prepare_queue.not_empty);
+  pthread_mutex_unlock(&pipeline->mutex);
+  return NULL;
+}
+
+static int prepare_work(const BUILD_PIPELINE *pipeline, BUILD_WORK *work,
+                        char *error, size_t error_size) {
+  YAP_V2_INGEST_OPERATION *operations;
+  size_t i;
+  int status = YAP_V2_OK;
+  operations = calloc(work->line_count, sizeof(*operations));
+  if (operations == NULL) {
+    (void)snprintf(error, error_size, "cannot allocate build batch");
+    return YAP_V2_ALLOCATION_FAILED;
+  }
+  for (i = 0U; i < work->line_count; i++) {
+    status = YAP_V2_ingest_parse_ndjson(work->text + work->line_offsets[i], work->line_bytes[i],
+                                        &operations[i], error, error_size);
     if (status != YAP_V2_OK) break;
-    if (operations[count].kind != YAP_V2_INGEST_UPSERT) {
+    if (operations[i].kind != YAP_V2_INGEST_UPSERT) {
       (void)snprintf(error, error_size, "build accepts upsert records only (line %zu)",
-                     line_number);
+                     work->first_line + i);
       status = YAP_V2_INVALID_FORMAT;
+      i++;
       break;
     }
-    count++;
-    if (count == YAP_V2_BUILD_BATCH_OPERATIONS) {
-      status = publish_batch(index_dir, operations, count, generation, accepted,
-                             error, error_size);
-      free_operations(operations, count);
-      operations = NULL;
-      count = 0U;
-      if (status != YAP_V2_OK) break;
-      operations = calloc(YAP_V2_BUILD_BATCH_OPERATIONS, sizeof(*operations));
-      if (operations == NULL) { status = YAP_V2_ALLOCATION_FAILED; break; }
+  }
+  if (status != YAP_V2_OK) {
+    YAP_V2_update_operations_free(operations, i);
+    return status;
+  }
+  free(work->text);
+  work->text = NULL;
+  return YAP_V2_build_batch_prepare(pipeline->config, operations, work->line_count,
+                                    &work->batch, error, error_size);
+}
+
+static void *prepare_main(void *argument) {
+  BUILD_PIPELINE *pipeline = argument;
+  BUILD_WORK *work;
+  char error[256];
+  uint64_t records = 0U, busy = 0U;
+  while ((work = queue_pop(pipeline, &pipeline->prepare_queue)) != NULL) {
+    uint64_t started = monotonic_microseconds();
+    int status;
+    error[0] = '\0';
+    status = prepare_work(pipeline, work, error, sizeof(error));
+    busy += monotonic_microseconds() - started;
+    if (status != YAP_V2_OK) {
+      pipeline_fail(pipeline, work->sequence, status, error);
+      work_free(work);
+      break;
     }
+    records += work->line_count;
+    if (!queue_push(pipeline, &pipeline->write_queue, work)) { work_free(work); break; }
   }
-  if (status == YAP_V2_OK && ferror(input)) status = YAP_V2_IO_ERROR;
-  if (status == YAP_V2_OK && count != 0U)
-    status = publish_batch(index_dir, operations, count, generation, accepted,
-                           error, error_size);
+  pipeline_record(pipeline, BUILD_STAGE_PREPARE, records, busy);
+  pthread_mutex_lock(&pipeline->mutex);
+  if (--pipeline->active_preparers == 0U) {
+    pipeline->write_queue.closed = 1;
+    pthread_cond_broadcast(&pipeline->write_queue.not_empty);
+  }
+  pthread_mutex_unlock(&pipeline->mutex);
+  return NULL;
+}
+
+static void *write_main(void *argument) {
+  BUILD_PIPELINE *pipeline = argument;
+  BUILD_WORK *work;
+  char error[256];
+  uint64_t records = 0U, busy = 0U;
+  while ((work = queue_pop(pipeline, &pipeline->write_queue)) != NULL) {
+    uint64_t started = monotonic_microseconds();
+    int status;
+    error[0] = '\0';
+    status = YAP_V2_build_batch_write(pipeline->index_dir, pipeline->config,
+                                      pipeline->staged != NULL ? pipeline->staged->generation :
+                                        (uint64_t)work->sequence + 2U,
+                                      work->batch, error, sizeof(error));
+    busy += monotonic_microseconds() - started;
+    if (status != YAP_V2_OK) {
+      pipeline_fail(pipeline, work->sequence, status, error);
+      work_free(work);
+      break;
+    }
+    records += work->line_count;
+    pthread_mutex_lock(&pipeline->mutex);
+    pipeline->ready[work->sequence % pipeline->window] = work;
+    pthread_cond_signal(&pipeline->publish_ready);
+    pthread_mutex_unlock(&pipeline->mutex);
+  }
+  pipeline_record(pipeline, BUILD_STAGE_WRITE, records, busy);
+  pthread_mutex_lock(&pipeline->mutex);
+  if (--pipeline->active_writers == 0U) pthread_cond_broadcast(&pipeline->publish_ready);
+  pthread_mutex_unlock(&pipeline->mutex);
+  return NULL;
+}
+
+static void publish_in_order(BUILD_PIPELINE *pipeline, uint64_t *generation, size_t *accepted) {
+  char error[256];
+  uint64_t records = 0U, busy = 0U;
+  pthread_mutex_lock(&pipeline->mutex);
+  for (;;) {
+    size_t slot = pipeline->next_publish % pipeline->window;
+    BUILD_WORK *work;
+    YAP_V2_UPDATE_RESULT result;
+    uint64_t started;
+    int status;
+    while (!pipeline->failed && pipeline->ready[slot] == NULL && pipeline->active_writers > 0U)
+      pthread_cond_wait(&pipeline->publish_ready, &pipeline->mutex);
+    work = pipeline->ready[slot];
+    if (pipeline->failed || work == NULL) break;
+    pipeline->ready[slot] = NULL;
+    pthread_mutex_unlock(&pipeline->mutex);
+    started = monotonic_microseconds();
+    error[0] = '\0';
+    YAP_V2_update_result_init(&result);
+    if (pipeline->staged != NULL) {
+      status = YAP_V2_build_batch_stage(work->batch, pipeline->staged, &result);
+      if (status != YAP_V2_OK) (void)snprintf(error, sizeof(error), "cannot stage segments");
+    }
+    else
+      status = YAP_V2_build_batch_publish(pipeline->index_dir, pipeline->config, work->batch,
+                                          &result, error, sizeof(error));
+    if (status == YAP_V2_OK) {
+      *generation = result.generation;
+      *accepted += result.accepted;
+      records += result.accepted;
+    }
+    YAP_V2_update_result_free(&result);
+    busy += monotonic_microseconds() - started;
+    if (status != YAP_V2_OK) pipeline_fail(pipeline, work->sequence, status, error);
+    work_free(work);
+    pthread_mutex_lock(&pipeline->mutex);
+    pipeline->next_publish++;
+    pthread_cond_broadcast(&pipeline->publish_space);
+  }
+  pipeline->stages[BUILD_STAGE_PUBLISH].records += records;
+  pipeline->stages[BUILD_STAGE_PUBLISH].busy_microseconds += busy;
+  pthread_mutex_unlock(&pipeline->mutex);
+}
+
+static void report_stages(const BUILD_PIPELINE *pipeline, uint64_t elapsed_microseconds) {
+  static const char *const names[BUILD_STAGE_COUNT] = {"read", "prepare", "write", "publish"};
+  size_t i;
+  for (i = 0U; i < BUILD_STAGE_COUNT; i++) {
+    const BUILD_STAGE_STATS *stage = &pipeline->stages[i];
+    double busy = (double)stage->busy_microseconds / 1000000.0;
+    double rate = busy > 0.0 ? (double)stage->records * (double)stage->threads / busy : 0.0;
+    fprintf(stderr, "build stage %-7s threads=%zu records=%llu busy=%.3fs records_per_second=%.0f\n",
+            names[i], stage->threads, (unsigned long long)stage->records, busy, rate);
+  }
+  fprintf(stderr, "build total   records=%llu elapsed=%.3fs records_per_second=%.0f\n",
+          (unsigned long long)pipeline->stages[BUILD_STAGE_PUBLISH].records,
+          (double)elapsed_microseconds / 1000000.0,
+          elapsed_microseconds > 0U ?
+            (double)pipeline->stages[BUILD_STAGE_PUBLISH].records * 1000000.0 /
+              (double)elapsed_microseconds : 0.0);
+}
+
+/* Bulk mode: merge runs of undersized staged segments when requested, then publish
+ * the staged segments as a single manifest generation. */
+static int publish_staged(const char *index_dir, const YAP_V2_CONFIG *config,
+                          YAP_V2_MANIFEST *staged, int merge, uint64_t *generation,
+                          char *error, size_t error_size) {
+  int status = YAP_V2_OK;
+  if (merge) {
+    size_t written = staged->segment_count, merged = 0U;
+    uint64_t started = monotonic_microseconds();
+    status = YAP_V2_compact_staged(index_dir, config, staged, &merged, error, error_size);
+    if (status != YAP_V2_OK) return status;
+    fprintf(stderr, "build merge   segments=%zu merged=%zu output=%zu elapsed=%.3fs\n",
+            written, merged, staged->segment_count,
+            (double)(monotonic_microseconds() - started) / 1000000.0);
+  }
+  status = YAP_V2_build_publish_staged(index_dir, config, staged, error, error_size);
+  if (status == YAP_V2_OK) *generation = staged->generation;
+  return status;
+}
+
+static int ingest_stream(const char *input_path, const char *index_dir, size_t threads,
+                         int bulk, int merge, uint64_t *generation, size_t *accepted,
+                         char *error, size_t error_size) {
+  BUILD_PIPELINE pipeline;
+  YAP_V2_CONFIG config;
+  YAP_V2_MANIFEST staged;
+  pthread_t reader, *preparers = NULL, *writers = NULL;
+  char config_path[4096], config_error[256];
+  size_t preparer_count = threads, writer_count = (threads + 1U) / 2U;
+  size_t started_preparers = 0U, started_writers = 0U, i;
+  int reader_started = 0, mutex_ready = 0, ready_cond = 0, space_cond = 0;
+  int prepare_queue_ready = 0, write_queue_ready = 0, status;
+  uint64_t started = monotonic_microseconds();
+  if (join_path(config_path, sizeof(config_path), index_dir, "config.toml") != 0) {
+    (void)snprintf(error, error_size, "index path is too long");
+    return YAP_V2_OUT_OF_RANGE;
+  }
+  status = YAP_V2_config_load(config_path, &config, config_error, sizeof(config_error));
+  if (status != YAP_V2_OK) {
+    (void)snprintf(error, error_size, "%s", config_error);
+    return status;
+  }
+  memset(&pipeline, 0, sizeof(pipeline));
+  YAP_V2_manifest_init(&staged);
+  pipeline.index_dir = index_dir;
+  pipeline.config = &config;
+  if (bulk) {
+    staged.generation = 2U;
+    status = YAP_V2_config_fingerprint(&config, staged.config_fingerprint);
+    if (status != YAP_V2_OK) return status;
+    pipeline.staged = &staged;
+  }
+  pipeline.window = preparer_count + writer_count + 2U;
+  pipeline.stages[BUILD_STAGE_READ].threads = 1U;
+  pipeline.stages[BUILD_STAGE_PREPARE].threads = preparer_count;
+  pipeline.stages[BUILD_STAGE_WRITE].threads = writer_count;
+  pipeline.stages[BUILD_STAGE_PUBLISH].threads = 1U;
+  pipeline.active_preparers = preparer_count;
+  pipeline.active_writers = writer_count;
+  pipeline.input = fopen(input_path, "rb");
+  if (pipeline.input == NULL) {
+    (void)snprintf(error, error_size, "cannot open input: %s", strerror(errno));
+    return YAP_V2_IO_ERROR;
+  }
+  pipeline.ready = calloc(pipeline.window, sizeof(*pipeline.ready));
+  preparers = calloc(preparer_count, sizeof(*preparers));
+  writers = calloc(writer_count, sizeof(*writers));
+  mutex_ready = pthread_mutex_init(&pipeline.mutex, NULL) == 0;
+  ready_cond = pthread_cond_init(&pipeline.publish_ready, NULL) == 0;
+  space_cond = pthread_cond_init(&pipeline.publish_space, NULL) == 0;
+  prepare_queue_ready = queue_init(&pipeline.prepare_queue, preparer_count) == 0;
+  write_queue_ready = queue_init(&pipeline.write_queue, writer_count) == 0;
+  if (pipeline.ready == NULL || preparers == NULL || writers == NULL || !mutex_ready ||
+      !ready_cond || !space_cond || !prepare_queue_ready || !write_queue_ready) {
+    (void)snprintf(error, error_size, "cannot allocate build pipeline");
+    status = YAP_V2_ALLOCATION_FAILED;
+    goto done;
+  }
+  for (i = 0U; i < writer_count; i++) {
+    if (pthread_create(&writers[i], NULL, write_main, &pipeline) != 0) break;
+    started_writers++;
+  }
+  for (i = 0U; started_writers == writer_count && i < preparer_count; i++) {
+    if (pthread_create(&preparers[i], NULL, prepare_main, &pipeline) != 0) break;
+    started_preparers++;
+  }
+  if (started_writers == writer_count && started_preparers == preparer_count)
+    reader_started = pthread_create(&reader, NULL, reader_main, &pipeline) == 0;
+  if (reader_started) publish_in_order(&pipeline, generation, accepted);
+  else pipeline_fail(&pipeline, 0U, YAP_V2_IO_ERROR, "cannot start build thread");
+  if (reader_started) (void)pthread_join(reader, NULL);
+  for (i = 0U; i < started_preparers; i++) (void)pthread_join(preparers[i], NULL);
+  for (i = 0U; i < started_writers; i++) (void)pthread_join(writers[i], NULL);
+  status = pipeline.failed ? pipeline.status : YAP_V2_OK;
+  if (status != YAP_V2_OK) (void)snprintf(error, error_size, "%s", pipeline.error);
+done:
+  if (pipeline.ready != NULL)
+    for (i = 0U; i < pipeline.window; i++) work_free(pipeline.ready[i]);
+  if (prepare_queue_ready) queue_destroy(&pipeline.prepare_queue);
+  if (write_queue_ready) queue_destroy(&pipeline.write_queue);
+  if (space_cond) pthread_cond_destroy(&pipeline.publish_space);
+  if (ready_cond) pthread_cond_destroy(&pipeline.publish_ready);
+  if (mutex_ready) pthread_mutex_destroy(&pipeline.mutex);
+  free(pipeline.ready); free(preparers); free(writers);
+  if (fclose(pipeline.input) != 0 && status == YAP_V2_OK) status = YAP_V2_IO_ERROR;
   if (status == YAP_V2_OK && *accepted == 0U) {
     (void)snprintf(error, error_size, "build input is empty");
     status = YAP_V2_INVALID_FORMAT;
   }
-  free_operations(operations, count);
-  free(line);
-  if (fclose(input) != 0 && status == YAP_V2_OK) status = YAP_V2_IO_ERROR;
+  if (status == YAP_V2_OK && bulk)
+    status = publish_staged(index_dir, &config, &staged, merge, generation, error, error_size);
+  if (status == YAP_V2_OK) report_stages(&pipeline, monotonic_microseconds() - started);
+  YAP_V2_manifest_free(&staged);
   return status;
 }
 
 static int build_index(const YAP_APPLICATION_CONFIG *application, const char *input_path,
-                       const char *index_dir, uint64_t *generation, size_t *accepted,
+                       const char *index_dir, size_t threads, int bulk, int merge,
+                       uint64_t *generation, size_t *accepted,
                        char *error, size_t error_size) {
   const YAP_V2_CONFIG *config = &application->index_config;
   YAP_V2_MANIFEST manifest;
@@ -175,7 +636,8 @@ static int build_index(const YAP_APPLICATION_CONFIG *application, const char *in
   if (status == YAP_V2_OK) status = YAP_V2_manifest_save_atomic(manifest_path, &manifest);
   YAP_V2_manifest_free(&manifest);
   if (status == YAP_V2_OK)
-    status = ingest_stream(input_path, temporary, generation, accepted, error, error_size);
+    status = ingest_stream(input_path, temporary, threads, bulk, merge, generation, accepted,
+                           error, error_size);
   if (status == YAP_V2_OK && lstat(index_dir, &info) == 0) {
     (void)snprintf(error, error_size, "index path appeared during build");
     status = YAP_V2_CONFLICT;
@@ -193,32 +655,49 @@ done:
 
 int YAP_V2_build_main(int argc, char **argv) {
   const char *config_path = NULL, *input_path = NULL, *index_option = NULL;
+  const char *threads_option = NULL;
   YAP_APPLICATION_CONFIG application;
   uint64_t generation = 0U;
-  size_t accepted = 0U;
+  size_t accepted = 0U, threads = 1U;
   char error[256] = {0};
-  int i, status;
+  int i, status, bulk = 0, merge = 0;
   for (i = 1; i < argc; i++) {
     const char **target;
+    if (strcmp(argv[i], "--bulk") == 0) { bulk = 1; continue; }
+    if (strcmp(argv[i], "--merge") == 0) { merge = 1; continue; }
     if (strcmp(argv[i], "--config") == 0) target = &config_path;
     else if (strcmp(argv[i], "--input") == 0) target = &input_path;
     else if (strcmp(argv[i], "--index") == 0) target = &index_option;
+    else if (strcmp(argv[i], "--threads") == 0) target = &threads_option;
     else { fprintf(stderr, "Unknown build option: %s\n", argv[i]); return EXIT_FAILURE; }
     if (++i >= argc) { fputs("Missing build option value\n", stderr); return EXIT_FAILURE; }
     *target = argv[i];
   }
-  if (config_path == NULL || input_path == NULL || index_option != NULL) {
-    fputs("Usage: yappo_makeindex build --config CONFIG --input documents.ndjson\n", stderr);
+  if (config_path == NULL || input_path == NULL || index_option != NULL || (merge && !bulk)) {
+    fputs("Usage: yappo_makeindex build --config CONFIG --input documents.ndjson"
+          " [--threads N] [--bulk [--merge]]\n", stderr);
     return EXIT_FAILURE;
   }
+  if (threads_option != NULL) {
+    char *end = NULL;
+    unsigned long parsed;
+    errno = 0;
+    parsed = strtoul(threads_option, &end, 10);
+    if (errno != 0 || end == threads_option || *end != '\0' || threads_option[0] == '-' ||
+        parsed == 0UL || parsed > YAP_V2_BUILD_MAX_THREADS) {
+      fprintf(stderr, "--threads must be between 1 and %u\n", YAP_V2_BUILD_MAX_THREADS);
+      return EXIT_FAILURE;
+    }
+    threads = (size_t)parsed;
+  }
   status = YAP_application_config_load(config_path, &application, error, sizeof(error));
   if (status != YAP_V2_OK) {
     fprintf(stderr, "Config error: %s\n", error);
     return EXIT_FAILURE;
   }
-  status = build_index(&application, input_path, application.index_directory,
-                       &generation, &accepted,
-                       error, sizeof(error));
+  YAP_V2_ann_set_build_threads(application.ann_build_threads);
+  status = build_index(&application, input_path, application.index_directory, threads,
+                       bulk, merge, &generation, &accepted, error, sizeof(error));
   if (status != YAP_V2_OK) {
     fprintf(stderr, "Build failed: %s (%s)\n", error, YAP_V2_status_string(status));
     return EXIT_FAILURE;
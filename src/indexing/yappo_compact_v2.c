@@ -6,6 +6,8 @@
 #include "storage/yappo_manifest_v2.h"
 #include "indexing/yappo_segment_planner_v2.h"
 #include "indexing/yappo_update_v2.h"
+#include "components/yappo_ann_v2.h"
+#include "components/yappo_lexical_v2.h"
 #include "components/yappo_vector_v2.h"
 #include "storage/yappo_writer_lock_v2.h"
 
@@ -121,6 +123,10 @@ typedef struct {
   YAP_V2_SEGMENT documents;
   YAP_V2_TOMBSTONES tombstones;
   YAP_V2_VECTOR_SEGMENT vectors;
+  YAP_V2_LEXICAL_SEGMENT lexical;
+  uint64_t *document_ordinals;
+  uint64_t *passage_ordinals;
+  char ann_path[4096];
 } COMPACTION_SOURCE;
 
 typedef struct {
@@ -290,6 +296,9 @@ static void compaction_input_free(COMPACTION_INPUT *input) {
   size_t i;
   if (input == NULL) return;
   for (i = 0U; i < input->source_count; i++) {
+    free(input->sources[i].document_ordinals);
+    free(input->sources[i].passage_ordinals);
+    YAP_V2_lexical_segment_close(&input->sources[i].lexical);
     YAP_V2_vector_segment_close(&input->sources[i].vectors);
     YAP_V2_tombstones_free(&input->sources[i].tombstones);
     YAP_V2_segment_free(&input->sources[i].documents);
@@ -303,16 +312,18 @@ static void compaction_input_free(COMPACTION_INPUT *input) {
 static int load_source(const char *index_dir, const YAP_V2_CONFIG *config,
                        uint64_t manifest_generation,
                        const YAP_V2_SEGMENT_DESCRIPTOR *descriptor,
-                       COMPACTION_SOURCE *source) {
+                       int merge_lexical, COMPACTION_SOURCE *source) {
   const YAP_V2_COMPONENT_DESCRIPTOR *documents;
   const YAP_V2_COMPONENT_DESCRIPTOR *tombstones;
   const YAP_V2_COMPONENT_DESCRIPTOR *vectors;
+  const YAP_V2_COMPONENT_DESCRIPTOR *ann;
   char directory[4096], path[4096];
   int written;
   int status;
   YAP_V2_segment_init(&source->documents);
   YAP_V2_tombstones_init(&source->tombstones);
   YAP_V2_vector_segment_init(&source->vectors);
+  YAP_V2_lexical_segment_init(&source->lexical);
   status = YAP_V2_manifest_verify_segment_components(
     index_dir, manifest_generation, descriptor);
   if (status != YAP_V2_OK) return status;
@@ -323,6 +334,7 @@ static int load_source(const char *index_dir, const YAP_V2_CONFIG *config,
   documents = segment_component(descriptor, YAP_V2_FILE_DOCUMENTS);
   tombstones = segment_component(descriptor, YAP_V2_FILE_TOMBSTONES);
   vectors = segment_component(descriptor, YAP_V2_FILE_VECTORS);
+  ann = segment_component(descriptor, YAP_V2_FILE_ANN);
   if (documents == NULL ||
       join_path(path, sizeof(path), directory, documents->name) != 0)
     return YAP_V2_INVALID_FORMAT;
@@ -350,15 +362,42 @@ static int load_source(const char *index_dir, const YAP_V2_CONFIG *config,
       status = YAP_V2_vector_segment_open(path, 0U, config,
                                           &source->vectors, NULL);
   }
+  if (status == YAP_V2_OK && merge_lexical && source->vectors.entry_count > 0U && ann != NULL &&
+      join_path(source->ann_path, sizeof(source->ann_path), directory, ann->name) != 0)
+    source->ann_path[0] = '\0';
+  if (status == YAP_V2_OK && merge_lexical && descriptor->document_count > 0U) {
+    status = YAP_V2_lexical_segment_open(directory, 0U, &source->lexical);
+    if (status == YAP_V2_OK &&
+        (source->lexical.document_count != descriptor->document_count ||
+         source->lexical.passage_count != descriptor->passage_count))
+      status = YAP_V2_CONFLICT;
+  }
+  if (status == YAP_V2_OK && merge_lexical) {
+    size_t documents = source->documents.document_count;
+    size_t passages = source->documents.passage_count;
+    size_t i;
+    source->document_ordinals = documents == 0U ? NULL :
+                                malloc(documents * sizeof(*source->document_ordinals));
+    source->passage_ordinals = passages == 0U ? NULL :
+                               malloc(passages * sizeof(*source->passage_ordinals));
+    if ((documents > 0U && source->document_ordinals == NULL) ||
+        (passages > 0U && source->passage_ordinals == NULL))
+      return YAP_V2_ALLOCATION_FAILED;
+    for (i = 0U; i < documents; i++)
+      source->document_ordinals[i] = YAP_V2_LEXICAL_ORDINAL_DROPPED;
+    for (i = 0U; i < passages; i++)
+      source->passage_ordinals[i] = YAP_V2_LEXICAL_ORDINAL_DROPPED;
+  }
   return status;
 }
 
 static int collect_range(const char *index_dir, const YAP_V2_CONFIG *config,
                          const YAP_V2_MANIFEST *manifest, size_t first,
-                         size_t count, int drop_tombstones,
+                         size_t count, int drop_tombstones, int merge_lexical,
                          COMPACTION_INPUT *input) {
   COMPACTION_EVENT_MAP events;
   size_t records = 0U, i, j, unit_index = 0U, vector_index = 0U;
+  uint64_t document_ordinal = 0U, passage_ordinal = 0U;
   int status = YAP_V2_OK;
   memset(input, 0, sizeof(*input));
   memset(&events, 0, sizeof(events));
@@ -368,7 +407,7 @@ static int collect_range(const char *index_dir, const YAP_V2_CONFIG *config,
     const YAP_V2_SEGMENT_DESCRIPTOR *descriptor =
       &manifest->segments[first + i];
     status = load_source(index_dir, config, manifest->generation,
-                         descriptor, &input->sources[i]);
+                         descriptor, merge_lexical, &input->sources[i]);
     input->source_count = i + 1U;
     if (descriptor->document_count > SIZE_MAX ||
         descriptor->tombstone_count > SIZE_MAX ||
@@ -475,6 +514,11 @@ static int collect_range(const char *index_dir, const YAP_V2_CONFIG *config,
       input->units[unit_index].passages =
         source->documents.passages + start;
       input->units[unit_index].passage_count = passage - start;
+      if (source->document_ordinals != NULL) {
+        source->document_ordinals[j] = document_ordinal++;
+        for (k = start; k < passage; k++)
+          source->passage_ordinals[k] = passage_ordinal++;
+      }
       input->units[unit_index].vectors =
         input->vector_values == NULL ? NULL :
         input->vector_values +
@@ -505,6 +549,175 @@ static int collect_range(const char *index_dir, const YAP_V2_CONFIG *config,
   return status;
 }
 
+static void remove_segment_paths(char (*segment_paths)[4096], size_t count) {
+  size_t i;
+  if (segment_paths == NULL) return;
+  for (i = 0U; i < count; i++)
+    if (segment_paths[i][0] != '\0') (void)remove_segment_directory(segment_paths[i]);
+}
+
+static int write_compacted_segments(const char *segments_path, uint64_t generation,
+                                    const YAP_V2_CONFIG *config,
+                                    const COMPACTION_INPUT *input, YAP_V2_SEGMENT_PLAN *plan,
+                                    YAP_V2_SEGMENT_ANN_STATS *ann_stats,
+                                    YAP_V2_SEGMENT_DESCRIPTOR **descriptors_out,
+                                    char (**segment_paths_out)[4096],
+                                    YAP_V2_SEGMENT_ID_LIST *segment_ids) {
+  YAP_V2_SEGMENT_DESCRIPTOR *descriptors;
+  char (*segment_paths)[4096];
+  size_t i, failed_slice;
+  int status;
+write_segments:
+  status = YAP_V2_OK;
+  failed_slice = SIZE_MAX;
+  descriptors = calloc(plan->count, sizeof(*descriptors));
+  segment_paths = calloc(plan->count, sizeof(*segment_paths));
+  if (descriptors == NULL || segment_paths == NULL) {
+    free(descriptors); free(segment_paths); return YAP_V2_ALLOCATION_FAILED;
+  }
+  for (i = 0U; status == YAP_V2_OK && i < plan->count; i++) {
+    const char *segment_id;
+    int written = snprintf(
+      segment_paths[i], sizeof(segment_paths[i]),
+      "%s/compact-%020llu-XXXXXX", segments_path,
+      (unsigned long long)generation);
+    if (written < 0 || (size_t)written >= sizeof(segment_paths[i]) ||
+        mkdtemp(segment_paths[i]) == NULL) {
+      segment_paths[i][0] = '\0'; status = YAP_V2_IO_ERROR; break;
+    }
+    segment_id = strrchr(segment_paths[i], '/');
+    segment_id = segment_id == NULL ? segment_paths[i] : segment_id + 1;
+    status = YAP_V2_segment_slice_write(
+      segment_paths[i], segment_id, generation, config,
+      input->units, plan, plan->slices[i], ann_stats, &descriptors[i]);
+    if (status == YAP_V2_SEGMENT_CAPACITY_EXCEEDED) failed_slice = i;
+    if (status == YAP_V2_OK) status = YAP_V2_segment_id_list_add(segment_ids, segment_id);
+  }
+  if (status == YAP_V2_OK) status = sync_directory(segments_path);
+  if (status != YAP_V2_OK) {
+    remove_segment_paths(segment_paths, plan->count);
+    free(descriptors); free(segment_paths);
+    YAP_V2_segment_id_list_free(segment_ids);
+    YAP_V2_segment_id_list_init(segment_ids);
+    if (status == YAP_V2_SEGMENT_CAPACITY_EXCEEDED && failed_slice < plan->count &&
+        plan->slices[failed_slice].count > 1U) {
+      status = YAP_V2_segment_plan_bisect(plan, failed_slice);
+      if (status == YAP_V2_OK) goto write_segments;
+    }
+    return status;
+  }
+  *descriptors_out = descriptors;
+  *segment_paths_out = segment_paths;
+  return YAP_V2_OK;
+}
+
+/* Consecutive segments whose summed component sizes stay within the planner target can be
+ * merged into one output segment without planning, because dropping superseded documents
+ * only shrinks each component. */
+static size_t merge_group_size(const YAP_V2_MANIFEST *manifest, size_t first,
+                               size_t target_bytes) {
+  uint64_t totals[YAP_V2_FILE_ANN_BASE + 1U];
+  uint64_t documents = 0U, passages = 0U;
+  size_t count = 0U, i;
+  memset(totals, 0, sizeof(totals));
+  while (first + count < manifest->segment_count &&
+         count < YAP_V2_COMPACTION_MAX_SOURCE_SEGMENTS) {
+    const YAP_V2_SEGMENT_DESCRIPTOR *segment = &manifest->segments[first + count];
+    int fits = segment->document_count <= YAP_V2_MAX_SEGMENT_DOCUMENTS - documents &&
+               segment->passage_count <= YAP_V2_MAX_SEGMENT_PASSAGES - passages;
+    for (i = 0U; i < segment->component_count; i++) {
+      const YAP_V2_COMPONENT_DESCRIPTOR *component = &segment->components[i];
+      if (component->file_type > YAP_V2_FILE_ANN_BASE ||
+          component->file_bytes > target_bytes - totals[component->file_type])
+        fits = 0;
+    }
+    if (!fits) break;
+    for (i = 0U; i < segment->component_count; i++)
+      totals[segment->components[i].file_type] += segment->components[i].file_bytes;
+    documents += segment->document_count;
+    passages += segment->passage_count;
+    count++;
+  }
+  return count;
+}
+
+/* The merged ANN graph starts from the source graph that keeps the most live vectors, so only
+ * the vectors of the other sources are inserted. */
+static int select_ann_seed(const COMPACTION_INPUT *input, YAP_V2_SEGMENT_ANN_SEED *seed) {
+  size_t best_live = 0U, i, k;
+  memset(seed, 0, sizeof(*seed));
+  for (i = 0U; i < input->source_count; i++) {
+    const COMPACTION_SOURCE *source = &input->sources[i];
+    size_t live = 0U;
+    if (source->ann_path[0] == '\0' || source->passage_ordinals == NULL) continue;
+    for (k = 0U; k < source->documents.passage_count; k++)
+      if (source->passage_ordinals[k] != YAP_V2_LEXICAL_ORDINAL_DROPPED) live++;
+    if (live <= best_live) continue;
+    best_live = live;
+    seed->path = source->ann_path;
+    seed->passage_ordinals = source->passage_ordinals;
+    seed->passage_count = source->documents.passage_count;
+  }
+  return best_live > 0U;
+}
+
+static int write_merged_segment(const char *segments_path, uint64_t generation,
+                                const YAP_V2_CONFIG *config, const COMPACTION_INPUT *input,
+                                YAP_V2_SEGMENT_ANN_STATS *ann_stats,
+                                YAP_V2_SEGMENT_DESCRIPTOR **descriptor_out,
+                                char (**segment_path_out)[4096],
+                                YAP_V2_SEGMENT_ID_LIST *segment_ids) {
+  YAP_V2_LEXICAL_MERGE_SOURCE *lexical;
+  YAP_V2_SEGMENT_DESCRIPTOR *descriptor;
+  YAP_V2_SEGMENT_ANN_SEED ann_seed;
+  char (*segment_path)[4096];
+  const char *segment_id;
+  size_t lexical_count = 0U, i;
+  int written, status, seeded;
+  descriptor = calloc(1U, sizeof(*descriptor));
+  segment_path = calloc(1U, sizeof(*segment_path));
+  lexical = calloc(input->source_count, sizeof(*lexical));
+  if (descriptor == NULL || segment_path == NULL || lexical == NULL) {
+    free(descriptor); free(segment_path); free(lexical); return YAP_V2_ALLOCATION_FAILED;
+  }
+  for (i = 0U; i < input->source_count; i++) {
+    const COMPACTION_SOURCE *source = &input->sources[i];
+    if (source->documents.document_count == 0U) continue;
+    lexical[lexical_count].segment = &source->lexical;
+    lexical[lexical_count].document_ordinals = source->document_ordinals;
+    lexical[lexical_count].passage_ordinals = source->passage_ordinals;
+    lexical_count++;
+  }
+  seeded = select_ann_seed(input, &ann_seed);
+  written = snprintf(segment_path[0], sizeof(segment_path[0]), "%s/compact-%020llu-XXXXXX",
+                     segments_path, (unsigned long long)generation);
+  if (written < 0 || (size_t)written >= sizeof(segment_path[0]) ||
+      mkdtemp(segment_path[0]) == NULL) {
+    segment_path[0][0] = '\0';
+    status = YAP_V2_IO_ERROR;
+  } else {
+    segment_id = strrchr(segment_path[0], '/');
+    segment_id = segment_id == NULL ? segment_path[0] : segment_id + 1;
+    status = YAP_V2_segment_merge_write(segment_path[0], segment_id, generation, config,
+                                        input->units, input->unit_count, lexical,
+                                        lexical_count, seeded ? &ann_seed : NULL, ann_stats,
+                                        descriptor);
+    if (status == YAP_V2_OK) status = YAP_V2_segment_id_list_add(segment_ids, segment_id);
+  }
+  if (status == YAP_V2_OK) status = sync_directory(segments_path);
+  free(lexical);
+  if (status != YAP_V2_OK) {
+    remove_segment_paths(segment_path, 1U);
+    free(descriptor); free(segment_path);
+    YAP_V2_segment_id_list_free(segment_ids);
+    YAP_V2_segment_id_list_init(segment_ids);
+    return status;
+  }
+  *descriptor_out = descriptor;
+  *segment_path_out = segment_path;
+  return YAP_V2_OK;
+}
+
 static int selected_range_unchanged(const YAP_V2_MANIFEST *base,
                                     const YAP_V2_MANIFEST *current,
                                     size_t first, size_t count) {
@@ -605,21 +818,22 @@ static int compact_internal(
   YAP_V2_SEGMENT_DESCRIPTOR *descriptors = NULL;
   YAP_V2_SEGMENT_PLAN plan;
   YAP_V2_SEGMENT_CAPACITY_ERROR capacity_error;
+  YAP_V2_SEGMENT_ANN_STATS ann_stats;
   char (*segment_paths)[4096] = NULL;
   char config_path[4096], manifest_path[4096], segments_path[4096];
   char config_error[256];
   size_t range_first = 0U, range_count = 0U;
-  size_t removed_before = 0U, removed_after = 0U, i;
-  size_t failed_slice = SIZE_MAX;
+  size_t removed_before = 0U, removed_after = 0U, output_count = 0U, i;
   uint64_t output_generation = 0U;
   uint64_t status_generation = 0U;
-  int status = YAP_V2_OK, published = 0, status_started = 0;
+  int status = YAP_V2_OK, published = 0, status_started = 0, merge = 0;
   int needed = 1;
   YAP_V2_WRITER_LOCK writer_lock, compaction_lock;
   YAP_V2_manifest_init(&manifest);
   YAP_V2_manifest_init(&current);
   YAP_V2_manifest_init(&candidate);
   memset(&input, 0, sizeof(input));
+  memset(&ann_stats, 0, sizeof(ann_stats));
   YAP_V2_segment_plan_init(&plan);
   YAP_V2_writer_lock_init(&writer_lock);
   YAP_V2_writer_lock_init(&compaction_lock);
@@ -693,59 +907,43 @@ static int compact_internal(
   output_generation = manifest.generation + 1U;
   YAP_V2_writer_lock_release(&writer_lock);
 
+  /* A range that fits one target-sized segment is merged from its postings; larger ranges
+   * are re-planned so that oversized outputs are split. */
+  merge = merge_group_size(&manifest, range_first,
+                           YAP_V2_segment_planner_size_policy().target_payload_bytes) ==
+          range_count;
   status = collect_range(index_dir, &config, &manifest, range_first,
                          range_count,
                          range_first == 0U &&
                          range_count == manifest.segment_count,
-                         &input);
+                         merge, &input);
   if (status != YAP_V2_OK) {
     set_error(error, error_size, "cannot collect selected segment range");
     goto done;
   }
-  status = YAP_V2_segment_plan_with_policy(
-    &config, input.units, input.unit_count, 35U,
-    YAP_V2_segment_planner_size_policy(), &plan, &capacity_error);
-  if (status == YAP_V2_SEGMENT_CAPACITY_EXCEEDED) {
-    (void)snprintf(error, error_size,
-      "document '%.*s' requires %zu bytes in %s (limit %zu)",
-      (int)capacity_error.document_id.len, capacity_error.document_id.data,
-      capacity_error.required_bytes, capacity_error.component, capacity_error.limit_bytes);
-    goto done;
-  }
-  if (status != YAP_V2_OK) { set_error(error, error_size, "segment planning failed"); goto done; }
-write_segments:
-  failed_slice = SIZE_MAX;
-  descriptors = calloc(plan.count, sizeof(*descriptors));
-  segment_paths = calloc(plan.count, sizeof(*segment_paths));
-  if (descriptors == NULL || segment_paths == NULL) { status = YAP_V2_ALLOCATION_FAILED; goto done; }
-  for (i = 0U; status == YAP_V2_OK && i < plan.count; i++) {
-    const char *segment_id;
-    int written = snprintf(
-      segment_paths[i], sizeof(segment_paths[i]),
-      "%s/compact-%020llu-XXXXXX", segments_path,
-      (unsigned long long)output_generation);
-    if (written < 0 || (size_t)written >= sizeof(segment_paths[i]) ||
-        mkdtemp(segment_paths[i]) == NULL) { status = YAP_V2_IO_ERROR; break; }
-    segment_id = strrchr(segment_paths[i], '/');
-    segment_id = segment_id == NULL ? segment_paths[i] : segment_id + 1;
-    status = YAP_V2_segment_slice_write(
-      segment_paths[i], segment_id, output_generation, &config,
-      input.units, &plan, plan.slices[i], &descriptors[i]);
-    if (status == YAP_V2_SEGMENT_CAPACITY_EXCEEDED) failed_slice = i;
-    if (status == YAP_V2_OK) status = YAP_V2_segment_id_list_add(&result->segment_ids, segment_id);
-  }
-  if (status == YAP_V2_SEGMENT_CAPACITY_EXCEEDED && failed_slice < plan.count &&
-      plan.slices[failed_slice].count > 1U) {
-    for (i = 0U; i < plan.count; i++)
-      if (segment_paths[i][0] != '\0') (void)remove_segment_directory(segment_paths[i]);
-    free(descriptors); free(segment_paths); descriptors = NULL; segment_paths = NULL;
-    YAP_V2_segment_id_list_free(&result->segment_ids);
-    YAP_V2_segment_id_list_init(&result->segment_ids);
-    status = YAP_V2_segment_plan_bisect(&plan, failed_slice);
-    if (status == YAP_V2_OK) goto write_segments;
+  if (merge && input.unit_count > 0U) {
+    status = write_merged_segment(segments_path, output_generation, &config, &input, &ann_stats,
+                                  &descriptors, &segment_paths, &result->segment_ids);
+    if (status != YAP_V2_OK) { set_error(error, error_size, "merged segment creation failed"); goto done; }
+    output_count = 1U;
+  } else {
+    status = YAP_V2_segment_plan_with_policy(
+      &config, input.units, input.unit_count, 35U,
+      YAP_V2_segment_planner_size_policy(), &plan, &capacity_error);
+    if (status == YAP_V2_SEGMENT_CAPACITY_EXCEEDED) {
+      (void)snprintf(error, error_size,
+        "document '%.*s' requires %zu bytes in %s (limit %zu)",
+        (int)capacity_error.document_id.len, capacity_error.document_id.data,
+        capacity_error.required_bytes, capacity_error.component, capacity_error.limit_bytes);
+      goto done;
+    }
+    if (status != YAP_V2_OK) { set_error(error, error_size, "segment planning failed"); goto done; }
+    status = write_compacted_segments(segments_path, output_generation, &config, &input, &plan,
+                                     &ann_stats, &descriptors, &segment_paths,
+                                     &result->segment_ids);
+    if (status != YAP_V2_OK) { set_error(error, error_size, "compacted segment creation failed"); goto done; }
+    output_count = plan.count;
   }
-  if (status == YAP_V2_OK) status = sync_directory(segments_path);
-  if (status != YAP_V2_OK) { set_error(error, error_size, "compacted segment creation failed"); goto done; }
   call_testing_hook("before_publish_lock");
   (void)failpoint("before_publish");
 
@@ -768,7 +966,7 @@ write_segments:
   }
   status_generation = current.generation;
   if (current.segment_count - range_count >
-        YAP_V2_MAX_SEGMENTS - plan.count) {
+        YAP_V2_MAX_SEGMENTS - output_count) {
     status = YAP_V2_OUT_OF_RANGE;
     set_error(error, error_size, "index segment limit reached");
     goto done;
@@ -779,13 +977,13 @@ write_segments:
          sizeof(candidate.config_fingerprint));
   for (i = 0U; status == YAP_V2_OK && i < range_first; i++)
     status = YAP_V2_manifest_add_segment(&candidate, &current.segments[i]);
-  for (i = 0U; status == YAP_V2_OK && i < plan.count; i++)
+  for (i = 0U; status == YAP_V2_OK && i < output_count; i++)
     status = YAP_V2_manifest_add_segment(&candidate, &descriptors[i]);
   for (i = range_first + range_count;
        status == YAP_V2_OK && i < current.segment_count; i++)
     status = YAP_V2_manifest_add_segment(&candidate, &current.segments[i]);
   if (status == YAP_V2_OK) status = YAP_V2_manifest_validate(&candidate);
-  for (i = 0U; status == YAP_V2_OK && i < plan.count; i++)
+  for (i = 0U; status == YAP_V2_OK && i < output_count; i++)
     status = YAP_V2_manifest_verify_segment_components(
       index_dir, candidate.generation, &descriptors[i]);
   if (status == YAP_V2_OK)
@@ -815,15 +1013,23 @@ write_segments:
   result->documents = input.document_count;
   result->passages = input.passage_count;
   result->removed_segments = removed_before + removed_after;
+  result->ann_build_microseconds = ann_stats.build_microseconds;
+  result->ann_reused_vectors = ann_stats.reused_vectors;
+  result->ann_inserted_vectors = ann_stats.inserted_vectors;
 done:
   YAP_V2_writer_lock_release(&writer_lock);
-  if (status_started)
-    (void)YAP_V2_compaction_status_write(index_dir,
-      status == YAP_V2_OK ? YAP_V2_COMPACTION_SUCCEEDED : YAP_V2_COMPACTION_FAILED,
-      status == YAP_V2_OK ? result->generation : status_generation);
-  if (!published && segment_paths != NULL)
-    for (i = 0U; i < plan.count; i++)
-      if (segment_paths[i][0] != '\0') (void)remove_segment_directory(segment_paths[i]);
+  if (status_started && status == YAP_V2_OK) {
+    YAP_V2_COMPACTION_ANN_REPORT ann_report;
+    ann_report.build_microseconds = result->ann_build_microseconds;
+    ann_report.reused_vectors = result->ann_reused_vectors;
+    ann_report.inserted_vectors = result->ann_inserted_vectors;
+    (void)YAP_V2_compaction_status_write_report(index_dir, YAP_V2_COMPACTION_SUCCEEDED,
+                                                result->generation, &ann_report);
+  } else if (status_started) {
+    (void)YAP_V2_compaction_status_write(index_dir, YAP_V2_COMPACTION_FAILED,
+                                         status_generation);
+  }
+  if (!published) remove_segment_paths(segment_paths, output_count);
   if (status != YAP_V2_OK) YAP_V2_compaction_result_free(result);
   compaction_input_free(&input);
   free(descriptors);
@@ -836,6 +1042,100 @@ done:
   return status;
 }
 
+int YAP_V2_compact_staged(const char *index_dir, const YAP_V2_CONFIG *config,
+                          YAP_V2_MANIFEST *staged, size_t *merged_segments,
+                          char *error, size_t error_size) {
+  YAP_V2_SEGMENT_SIZE_POLICY size_policy = YAP_V2_segment_planner_size_policy();
+  YAP_V2_MANIFEST merged;
+  YAP_V2_SEGMENT_ID_LIST outputs;
+  unsigned char *replaced = NULL;
+  char segments_path[4096];
+  size_t first = 0U, merged_count = 0U, i;
+  int status = YAP_V2_OK;
+  if (index_dir == NULL || config == NULL || staged == NULL || merged_segments == NULL ||
+      staged->generation == 0U)
+    return YAP_V2_INVALID_ARGUMENT;
+  *merged_segments = 0U;
+  if (staged->segment_count < 2U) return YAP_V2_OK;
+  if (join_path(segments_path, sizeof(segments_path), index_dir, "segments") != 0)
+    return YAP_V2_OUT_OF_RANGE;
+  YAP_V2_manifest_init(&merged);
+  YAP_V2_segment_id_list_init(&outputs);
+  merged.format_version = staged->format_version;
+  merged.generation = staged->generation;
+  memcpy(merged.config_fingerprint, staged->config_fingerprint,
+         sizeof(merged.config_fingerprint));
+  replaced = calloc(staged->segment_count, sizeof(*replaced));
+  if (replaced == NULL) { status = YAP_V2_ALLOCATION_FAILED; goto done; }
+  while (status == YAP_V2_OK && first < staged->segment_count) {
+    COMPACTION_INPUT input;
+    YAP_V2_SEGMENT_DESCRIPTOR *descriptor = NULL;
+    YAP_V2_SEGMENT_ID_LIST written;
+    char (*segment_path)[4096] = NULL;
+    size_t count = merge_group_size(staged, first, size_policy.target_payload_bytes);
+    if (count < 2U) {
+      status = YAP_V2_manifest_add_segment(&merged, &staged->segments[first]);
+      first++;
+      continue;
+    }
+    status = collect_range(index_dir, config, staged, first, count, 0, 1, &input);
+    if (status != YAP_V2_OK) {
+      set_error(error, error_size, "cannot collect staged segments");
+      break;
+    }
+    YAP_V2_segment_id_list_init(&written);
+    status = write_merged_segment(segments_path, staged->generation, config, &input, NULL,
+                                  &descriptor, &segment_path, &written);
+    if (status != YAP_V2_OK) set_error(error, error_size, "merged segment creation failed");
+    if (status == YAP_V2_OK) status = YAP_V2_segment_id_list_add(&outputs, written.items[0]);
+    if (status == YAP_V2_OK) status = YAP_V2_manifest_add_segment(&merged, descriptor);
+    if (status == YAP_V2_OK) {
+      for (i = 0U; i < count; i++) replaced[first + i] = 1U;
+      merged_count += count;
+    }
+    else
+      remove_segment_paths(segment_path, segment_path == NULL ? 0U : 1U);
+    YAP_V2_segment_id_list_free(&written);
+    free(descriptor);
+    free(segment_path);
+    compaction_input_free(&input);
+    first += count;
+  }
+  if (status == YAP_V2_OK) status = YAP_V2_manifest_validate(&merged);
+  if (status != YAP_V2_OK) {
+    if (error != NULL && error_size > 0U && error[0] == '\0')
+      set_error(error, error_size, "staged segment merge failed");
+    goto done;
+  }
+  for (i = 0U; status == YAP_V2_OK && i < staged->segment_count; i++) {
+    char obsolete[4096];
+    if (!replaced[i]) continue;
+    if (join_path(obsolete, sizeof(obsolete), segments_path, staged->segments[i].id) != 0)
+      status = YAP_V2_OUT_OF_RANGE;
+    else
+      status = remove_segment_directory(obsolete);
+  }
+  if (status != YAP_V2_OK) {
+    set_error(error, error_size, "merged source segment cleanup failed");
+    goto done;
+  }
+  YAP_V2_manifest_free(staged);
+  *staged = merged;
+  YAP_V2_manifest_init(&merged);
+  *merged_segments = merged_count;
+done:
+  if (status != YAP_V2_OK)
+    for (i = 0U; i < outputs.count; i++) {
+      char output[4096];
+      if (join_path(output, sizeof(output), segments_path, outputs.items[i]) == 0)
+        (void)remove_segment_directory(output);
+    }
+  YAP_V2_segment_id_list_free(&outputs);
+  YAP_V2_manifest_free(&merged);
+  free(replaced);
+  return status;
+}
+
 int YAP_V2_compact_if_needed(
     const char *index_dir, const YAP_V2_COMPACTION_POLICY *policy,
     YAP_V2_COMPACTION_RESULT *result, int *compacted,
@@ -868,6 +1168,7 @@ int YAP_V2_compact_main(int argc, char **argv) {
     status = YAP_application_config_load(config_path, &application, error, sizeof(error));
     if (status != YAP_V2_OK) { fprintf(stderr, "Config error: %s\n", error); return EXIT_FAILURE; }
     index_dir = application.index_directory;
+    YAP_V2_ann_set_build_threads(application.ann_build_threads);
   }
   YAP_V2_compaction_result_init(&result);
   status = YAP_V2_compact(index_dir, &result, error, sizeof(error));
@@ -875,9 +1176,11 @@ int YAP_V2_compact_main(int argc, char **argv) {
     fprintf(stderr, "Compaction failed: %s (%s)\n", error, YAP_V2_status_string(status)); return EXIT_FAILURE;
   }
   printf("{\"generation\":%llu,\"documents\":%zu,\"passages\":%zu,"
-         "\"removed_segments\":%zu,\"segment_ids\":[",
+         "\"removed_segments\":%zu,\"ann_build_seconds\":%.6f,\"ann_reused_vectors\":%zu,"
+         "\"ann_inserted_vectors\":%zu,\"segment_ids\":[",
          (unsigned long long)result.generation, result.documents, result.passages,
-         result.removed_segments);
+         result.removed_segments, (double)result.ann_build_microseconds / 1000000.0,
+         result.ann_reused_vectors, result.ann_inserted_vectors);
   for (i = 0; i < (int)result.segment_ids.count; i++)
     printf("%s\"%s\"", i == 0 ? "" : ",", result.segment_ids.items[i]);
   puts("]}");
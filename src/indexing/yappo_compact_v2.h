@@ -9,6 +9,9 @@ typedef struct {
   size_t documents;
   size_t passages;
   size_t removed_segments;
+  uint64_t ann_build_microseconds;
+  size_t ann_reused_vectors;
+  size_t ann_inserted_vectors;
   YAP_V2_SEGMENT_ID_LIST segment_ids;
 } YAP_V2_COMPACTION_RESULT;
 
@@ -35,6 +38,9 @@ int YAP_V2_compact_if_needed(
   const char *index_dir, const YAP_V2_COMPACTION_POLICY *policy,
   YAP_V2_COMPACTION_RESULT *result, int *compacted,
   size_t *small_segment_count, char *error, size_t error_size);
+int YAP_V2_compact_staged(const char *index_dir, const YAP_V2_CONFIG *config,
+                          YAP_V2_MANIFEST *staged, size_t *merged_segments,
+                          char *error, size_t error_size);
 int YAP_V2_compact(const char *index_dir, YAP_V2_COMPACTION_RESULT *result,
                    char *error, size_t error_size);
 int YAP_V2_compact_main(int argc, char **argv);
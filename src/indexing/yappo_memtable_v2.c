@@ -0,0 +1,417 @@
+#include "indexing/yappo_memtable_v2.h"
+
+#include "indexing/yappo_segment_planner_v2.h"
+#include "indexing/yappo_update_wal_v2.h"
+#include "storage/yappo_manifest_v2.h"
+#include "storage/yappo_writer_lock_v2.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void set_error(char *error, size_t capacity, const char *message) {
+  if (error != NULL && capacity > 0U) (void)snprintf(error, capacity, "%s", message);
+}
+
+static const char *testing_failpoint;
+
+void YAP_V2_memtable_set_failpoint_for_testing(const char *name) {
+  testing_failpoint = name;
+}
+
+static int failpoint(const char *name) {
+  return testing_failpoint != NULL && strcmp(testing_failpoint, name) == 0;
+}
+
+static int join_path(char *output, size_t capacity, const char *left, const char *right) {
+  int written = snprintf(output, capacity, "%s/%s", left, right);
+  return written < 0 || (size_t)written >= capacity ? -1 : 0;
+}
+
+static uint64_t id_hash(const char *value) {
+  uint64_t hash = UINT64_C(1469598103934665603);
+  for (; *value != '\0'; value++) {
+    hash ^= (unsigned char)*value;
+    hash *= UINT64_C(1099511628211);
+  }
+  return hash;
+}
+
+static int copy_text(const char *source, char **target) {
+  size_t length;
+  *target = NULL;
+  if (source == NULL) return YAP_V2_OK;
+  length = strlen(source) + 1U;
+  *target = malloc(length);
+  if (*target == NULL) return YAP_V2_ALLOCATION_FAILED;
+  memcpy(*target, source, length);
+  return YAP_V2_OK;
+}
+
+static int copy_operation(YAP_V2_INGEST_OPERATION *target,
+                          const YAP_V2_INGEST_OPERATION *source) {
+  size_t values;
+  memset(target, 0, sizeof(*target));
+  target->kind = source->kind;
+  target->updated_at_unix_ms = source->updated_at_unix_ms;
+  if (copy_text(source->id, &target->id) != YAP_V2_OK ||
+      copy_text(source->url, &target->url) != YAP_V2_OK ||
+      copy_text(source->title, &target->title) != YAP_V2_OK ||
+      copy_text(source->body, &target->body) != YAP_V2_OK ||
+      copy_text(source->metadata_json, &target->metadata_json) != YAP_V2_OK)
+    goto failed;
+  if (source->vectors != NULL) {
+    if (source->vector_dimensions != 0U &&
+        source->vector_count > SIZE_MAX / source->vector_dimensions / sizeof(float))
+      goto failed;
+    values = source->vector_count * source->vector_dimensions;
+    target->vectors = malloc(values * sizeof(float));
+    if (values != 0U && target->vectors == NULL) goto failed;
+    if (values != 0U) memcpy(target->vectors, source->vectors, values * sizeof(float));
+    target->vector_count = source->vector_count;
+    target->vector_dimensions = source->vector_dimensions;
+  }
+  return YAP_V2_OK;
+failed:
+  YAP_V2_ingest_operation_free(target);
+  return YAP_V2_ALLOCATION_FAILED;
+}
+
+static size_t id_slot(const char *const *ids, size_t capacity, const char *id) {
+  size_t slot = (size_t)(id_hash(id) & (uint64_t)(capacity - 1U));
+  while (ids[slot] != NULL && strcmp(ids[slot], id) != 0) slot = (slot + 1U) & (capacity - 1U);
+  return slot;
+}
+
+static int id_buffered(const YAP_V2_MEMTABLE *memtable, const char *id) {
+  return memtable->id_capacity != 0U &&
+         memtable->ids[id_slot(memtable->ids, memtable->id_capacity, id)] != NULL;
+}
+
+/* Grows the ID set ahead of time so recording an absorbed batch cannot fail. */
+static int id_reserve(YAP_V2_MEMTABLE *memtable, size_t count) {
+  const char **ids;
+  size_t capacity = memtable->id_capacity == 0U ? 16U : memtable->id_capacity, i;
+  while (capacity < count * 2U) capacity *= 2U;
+  if (capacity == memtable->id_capacity) return YAP_V2_OK;
+  ids = calloc(capacity, sizeof(*ids));
+  if (ids == NULL) return YAP_V2_ALLOCATION_FAILED;
+  for (i = 0U; i < memtable->id_capacity; i++)
+    if (memtable->ids[i] != NULL)
+      ids[id_slot(ids, capacity, memtable->ids[i])] = memtable->ids[i];
+  free(memtable->ids);
+  memtable->ids = ids;
+  memtable->id_capacity = capacity;
+  return YAP_V2_OK;
+}
+
+static void id_insert(YAP_V2_MEMTABLE *memtable, const char *id) {
+  size_t slot = id_slot(memtable->ids, memtable->id_capacity, id);
+  if (memtable->ids[slot] == NULL) memtable->operation_count++;
+  memtable->ids[slot] = id;
+}
+
+static int reserve_batches(YAP_V2_MEMTABLE *memtable, size_t count) {
+  YAP_V2_MEMTABLE_BATCH *batches;
+  size_t capacity = memtable->batch_capacity == 0U ? 8U : memtable->batch_capacity;
+  if (count <= memtable->batch_capacity) return YAP_V2_OK;
+  while (capacity < count) capacity *= 2U;
+  batches = realloc(memtable->batches, capacity * sizeof(*batches));
+  if (batches == NULL) return YAP_V2_ALLOCATION_FAILED;
+  memtable->batches = batches;
+  memtable->batch_capacity = capacity;
+  return YAP_V2_OK;
+}
+
+static int reserve_segments(YAP_V2_MEMTABLE *memtable, size_t count) {
+  YAP_V2_SEGMENT_DESCRIPTOR *segments;
+  size_t capacity = memtable->segment_capacity == 0U ? 8U : memtable->segment_capacity;
+  if (count <= memtable->segment_capacity) return YAP_V2_OK;
+  while (capacity < count) capacity *= 2U;
+  segments = realloc(memtable->segments, capacity * sizeof(*segments));
+  if (segments == NULL) return YAP_V2_ALLOCATION_FAILED;
+  memtable->segments = segments;
+  memtable->segment_capacity = capacity;
+  return YAP_V2_OK;
+}
+
+static void memtable_reset(YAP_V2_MEMTABLE *memtable) {
+  uint64_t sequence = memtable->sequence;
+  YAP_V2_memtable_free(memtable);
+  memtable->sequence = sequence + 1U;
+}
+
+void YAP_V2_memtable_init(YAP_V2_MEMTABLE *memtable) {
+  if (memtable != NULL) memset(memtable, 0, sizeof(*memtable));
+}
+
+void YAP_V2_memtable_free(YAP_V2_MEMTABLE *memtable) {
+  size_t i;
+  if (memtable == NULL) return;
+  for (i = 0U; i < memtable->batch_count; i++)
+    YAP_V2_build_batch_free(memtable->batches[i].batch);
+  free(memtable->batches);
+  free(memtable->segments);
+  free(memtable->ids);
+  memset(memtable, 0, sizeof(*memtable));
+}
+
+int YAP_V2_memtable_reconcile(YAP_V2_MEMTABLE *memtable, const char *index_dir,
+                              const YAP_V2_CONFIG *config) {
+  YAP_V2_MANIFEST manifest;
+  char manifest_path[4096];
+  int status, current = 0;
+  if (memtable == NULL || index_dir == NULL || config == NULL) return YAP_V2_INVALID_ARGUMENT;
+  if (memtable->batch_count == 0U)
+    return YAP_V2_update_wal_exists(index_dir) ?
+           YAP_V2_update_recover(index_dir, NULL, 0U) : YAP_V2_OK;
+  if (join_path(manifest_path, sizeof(manifest_path), index_dir, "manifest.yap2") != 0)
+    return YAP_V2_OUT_OF_RANGE;
+  if (YAP_V2_update_wal_exists(index_dir)) {
+    YAP_V2_manifest_init(&manifest);
+    status = YAP_V2_manifest_load_for_config(manifest_path, config, &manifest);
+    current = status == YAP_V2_OK && manifest.generation == memtable->base_generation;
+    YAP_V2_manifest_free(&manifest);
+    if (status != YAP_V2_OK) return status;
+  }
+  if (!current) memtable_reset(memtable);
+  return YAP_V2_OK;
+}
+
+/* Builds delta segments from the incoming operations only; earlier batches stay on disk
+ * untouched, so the cost of an absorb does not grow with the amount already buffered. */
+int YAP_V2_memtable_absorb(YAP_V2_MEMTABLE *memtable, const char *index_dir,
+                           const YAP_V2_CONFIG *config,
+                           const YAP_V2_INGEST_OPERATION *operations, size_t operation_count,
+                           uint64_t now_ms, YAP_V2_UPDATE_RESULT *result,
+                           char *error, size_t error_size) {
+  YAP_V2_MANIFEST manifest;
+  YAP_V2_WRITER_LOCK writer_lock;
+  YAP_V2_BUILD_BATCH *batch = NULL;
+  YAP_V2_INGEST_OPERATION *copied = NULL;
+  YAP_V2_MEMTABLE_BATCH *entry;
+  const YAP_V2_INGEST_OPERATION *buffered;
+  const YAP_V2_SEGMENT_DESCRIPTOR *segments;
+  char manifest_path[4096];
+  size_t copied_count = 0U, added = 0U, segment_count = 0U, i;
+  uint64_t base_generation;
+  int status;
+  if (memtable == NULL || index_dir == NULL || config == NULL || operations == NULL ||
+      result == NULL || operation_count == 0U ||
+      operation_count > YAP_V2_UPDATE_MAX_OPERATIONS)
+    return YAP_V2_INVALID_ARGUMENT;
+  YAP_V2_update_result_init(result);
+  if (join_path(manifest_path, sizeof(manifest_path), index_dir, "manifest.yap2") != 0) {
+    set_error(error, error_size, "index path is too long"); return YAP_V2_OUT_OF_RANGE;
+  }
+  status = YAP_V2_memtable_reconcile(memtable, index_dir, config);
+  if (status != YAP_V2_OK) {
+    set_error(error, error_size, "pending update WAL could not be recovered");
+    return status;
+  }
+  YAP_V2_manifest_init(&manifest);
+  YAP_V2_writer_lock_init(&writer_lock);
+  status = YAP_V2_writer_lock_acquire(&writer_lock, index_dir);
+  if (status != YAP_V2_OK) {
+    set_error(error, error_size, "cannot acquire index writer lock");
+    return status;
+  }
+  status = YAP_V2_manifest_load_for_config(manifest_path, config, &manifest);
+  if (status != YAP_V2_OK) { set_error(error, error_size, "current index snapshot is invalid"); goto done; }
+  if (memtable->batch_count != 0U && manifest.generation != memtable->base_generation) {
+    status = YAP_V2_CONFLICT;
+    set_error(error, error_size, "generation changed while updates were buffered");
+    goto done;
+  }
+  if (manifest.generation == UINT64_MAX ||
+      YAP_V2_segment_count_validate(manifest.segment_count,
+                                    memtable->segment_count + 1U) != YAP_V2_OK) {
+    status = YAP_V2_OUT_OF_RANGE; set_error(error, error_size, "index generation or segment limit reached"); goto done;
+  }
+  base_generation = memtable->batch_count != 0U ? memtable->base_generation : manifest.generation;
+  for (i = 0U; i < operation_count; i++)
+    if (!id_buffered(memtable, operations[i].id)) added++;
+  if (memtable->operation_count + added > YAP_V2_UPDATE_MAX_OPERATIONS) {
+    status = YAP_V2_OUT_OF_RANGE; set_error(error, error_size, "memtable is full"); goto done;
+  }
+  status = reserve_batches(memtable, memtable->batch_count + 1U);
+  if (status == YAP_V2_OK) status = id_reserve(memtable, memtable->operation_count + added);
+  copied = status == YAP_V2_OK ? calloc(operation_count, sizeof(*copied)) : NULL;
+  if (copied == NULL) status = YAP_V2_ALLOCATION_FAILED;
+  for (; status == YAP_V2_OK && copied_count < operation_count; copied_count++)
+    status = copy_operation(&copied[copied_count], &operations[copied_count]);
+  if (status != YAP_V2_OK) { set_error(error, error_size, "cannot buffer update operations"); goto done; }
+  buffered = copied;
+  status = YAP_V2_build_batch_prepare(config, copied, operation_count, &batch, error, error_size);
+  copied = NULL;
+  if (status != YAP_V2_OK) goto done;
+  status = YAP_V2_build_batch_write_delta(index_dir, config, base_generation + 1U, batch,
+                                          error, error_size);
+  if (status != YAP_V2_OK) goto done;
+  segments = YAP_V2_build_batch_segments(batch, &segment_count);
+  status = reserve_segments(memtable, memtable->segment_count + segment_count);
+  if (status != YAP_V2_OK) { set_error(error, error_size, "cannot buffer update operations"); goto done; }
+  if (!memtable->wal_unsynced) status = YAP_V2_memtable_mark(memtable, index_dir);
+  if (status == YAP_V2_OK)
+    status = YAP_V2_update_wal_append(index_dir, base_generation, operations, operation_count);
+  if (status != YAP_V2_OK) { set_error(error, error_size, "cannot append update WAL"); goto done; }
+  memtable->wal_unsynced = 1;
+  if (memtable->batch_count == 0U) memtable->opened_at_ms = now_ms;
+  entry = &memtable->batches[memtable->batch_count];
+  entry->batch = batch;
+  entry->operations = buffered;
+  entry->operation_count = operation_count;
+  batch = NULL;
+  memtable->batch_count++;
+  memcpy(memtable->segments + memtable->segment_count, segments,
+         segment_count * sizeof(*segments));
+  memtable->segment_count += segment_count;
+  for (i = 0U; i < operation_count; i++) id_insert(memtable, entry->operations[i].id);
+  memtable->base_generation = base_generation;
+  memtable->sequence++;
+  result->generation = base_generation;
+  result->accepted = operation_count;
+  for (i = 0U; i < operation_count; i++) {
+    if (operations[i].kind == YAP_V2_INGEST_DELETE) result->deletes++;
+    else result->upserts++;
+  }
+done:
+  YAP_V2_update_operations_free(copied, copied_count);
+  YAP_V2_build_batch_free(batch);
+  YAP_V2_manifest_free(&manifest);
+  YAP_V2_writer_lock_release(&writer_lock);
+  return status;
+}
+
+/* Stages every buffered batch, in absorb order, into one manifest generation so later
+ * batches keep shadowing earlier ones once they are published. */
+static int flush_batches(YAP_V2_MEMTABLE *memtable, const char *index_dir,
+                         const YAP_V2_CONFIG *config, YAP_V2_UPDATE_RESULT *result,
+                         char *error, size_t error_size) {
+  YAP_V2_MANIFEST staged;
+  YAP_V2_UPDATE_RESULT batch_result;
+  size_t i, j;
+  int status = YAP_V2_OK;
+  for (i = 0U; status == YAP_V2_OK && i < memtable->batch_count; i++)
+    status = YAP_V2_build_batch_promote(index_dir, memtable->batches[i].batch, error, error_size);
+  if (status != YAP_V2_OK) return status;
+  YAP_V2_manifest_init(&staged);
+  staged.generation = memtable->base_generation + 1U;
+  for (i = 0U; status == YAP_V2_OK && i < memtable->batch_count; i++) {
+    YAP_V2_update_result_init(&batch_result);
+    status = YAP_V2_build_batch_stage(memtable->batches[i].batch, &staged, &batch_result);
+    for (j = 0U; status == YAP_V2_OK && j < batch_result.segment_ids.count; j++)
+      status = YAP_V2_segment_id_list_add(&result->segment_ids,
+                                          batch_result.segment_ids.items[j]);
+    result->accepted += batch_result.accepted;
+    result->upserts += batch_result.upserts;
+    result->deletes += batch_result.deletes;
+    YAP_V2_update_result_free(&batch_result);
+  }
+  if (status != YAP_V2_OK) set_error(error, error_size, "cannot stage segments");
+  else status = YAP_V2_build_publish_staged(index_dir, config, &staged, error, error_size);
+  if (status == YAP_V2_OK) result->generation = staged.generation;
+  YAP_V2_manifest_free(&staged);
+  return status;
+}
+
+/* Promotes the delta segments that are already on disk; when that is not possible the WAL
+ * is replayed instead, which rebuilds the same operations as fresh segments. Segments that
+ * were promoted but never published are left for compaction GC. */
+int YAP_V2_memtable_flush(YAP_V2_MEMTABLE *memtable, const char *index_dir,
+                          const YAP_V2_CONFIG *config, YAP_V2_UPDATE_RESULT *result,
+                          char *error, size_t error_size) {
+  int status;
+  if (memtable == NULL || index_dir == NULL || config == NULL || result == NULL)
+    return YAP_V2_INVALID_ARGUMENT;
+  YAP_V2_update_result_init(result);
+  status = YAP_V2_memtable_reconcile(memtable, index_dir, config);
+  if (status != YAP_V2_OK || memtable->batch_count == 0U) return status;
+  status = flush_batches(memtable, index_dir, config, result, error, error_size);
+  if (status == YAP_V2_OK) {
+    status = YAP_V2_update_wal_clear(index_dir);
+    if (status != YAP_V2_OK)
+      set_error(error, error_size, "manifest published but WAL could not be cleared");
+    memtable_reset(memtable);
+    return status;
+  }
+  if (error != NULL && error_size > 0U) error[0] = '\0';
+  YAP_V2_update_result_free(result);
+  status = YAP_V2_update_recover(index_dir, error, error_size);
+  if (status != YAP_V2_OK) return status;
+  result->generation = memtable->base_generation + 1U;
+  result->accepted = memtable->operation_count;
+  memtable_reset(memtable);
+  return YAP_V2_OK;
+}
+
+int YAP_V2_memtable_sync(YAP_V2_MEMTABLE *memtable, const char *index_dir,
+                         uint64_t *sync_microseconds) {
+  int status;
+  if (sync_microseconds != NULL) *sync_microseconds = 0U;
+  if (memtable == NULL || index_dir == NULL) return YAP_V2_INVALID_ARGUMENT;
+  if (!memtable->wal_unsynced) return YAP_V2_OK;
+  if (failpoint("before_wal_sync")) return YAP_V2_IO_ERROR;
+  status = YAP_V2_update_wal_sync(index_dir, sync_microseconds);
+  /* A missing log means another writer already replayed and published it. */
+  if (status == YAP_V2_NOT_FOUND) status = YAP_V2_OK;
+  if (status == YAP_V2_OK) memtable->wal_unsynced = 0;
+  return status;
+}
+
+int YAP_V2_memtable_mark(YAP_V2_MEMTABLE *memtable, const char *index_dir) {
+  uint64_t bytes;
+  int status;
+  if (memtable == NULL || index_dir == NULL) return YAP_V2_INVALID_ARGUMENT;
+  status = YAP_V2_update_wal_size(index_dir, &bytes);
+  if (status != YAP_V2_OK) return status;
+  memtable->rollback_batch_count = memtable->batch_count;
+  memtable->rollback_wal_bytes = bytes;
+  memtable->rollback_wal_unsynced = memtable->wal_unsynced;
+  return YAP_V2_OK;
+}
+
+/* Frees the batches absorbed after the mark, which also discards their delta segments, and
+ * cuts their records off update.wal so neither search nor recovery sees them again. */
+int YAP_V2_memtable_rollback(YAP_V2_MEMTABLE *memtable, const char *index_dir) {
+  size_t keep, count, i, j;
+  int status;
+  if (memtable == NULL || index_dir == NULL) return YAP_V2_INVALID_ARGUMENT;
+  if (!memtable->wal_unsynced) return YAP_V2_OK;
+  keep = memtable->rollback_batch_count < memtable->batch_count ?
+         memtable->rollback_batch_count : memtable->batch_count;
+  status = YAP_V2_update_wal_truncate(index_dir, memtable->rollback_wal_bytes);
+  if (status == YAP_V2_NOT_FOUND) status = YAP_V2_OK;
+  for (i = keep; i < memtable->batch_count; i++)
+    YAP_V2_build_batch_free(memtable->batches[i].batch);
+  memtable->batch_count = keep;
+  if (keep == 0U) {
+    memtable_reset(memtable);
+    return status;
+  }
+  memtable->segment_count = 0U;
+  memtable->operation_count = 0U;
+  memset(memtable->ids, 0, memtable->id_capacity * sizeof(*memtable->ids));
+  for (i = 0U; i < keep; i++) {
+    (void)YAP_V2_build_batch_segments(memtable->batches[i].batch, &count);
+    memtable->segment_count += count;
+    for (j = 0U; j < memtable->batches[i].operation_count; j++)
+      id_insert(memtable, memtable->batches[i].operations[j].id);
+  }
+  memtable->wal_unsynced = memtable->rollback_wal_unsynced;
+  memtable->sequence++;
+  return status;
+}
+
+int YAP_V2_memtable_flush_due(const YAP_V2_MEMTABLE *memtable, size_t max_operations,
+                              uint64_t max_age_ms, uint64_t now_ms) {
+  if (memtable == NULL || memtable->batch_count == 0U) return 0;
+  return memtable->operation_count >= max_operations ||
+         (now_ms >= memtable->opened_at_ms && now_ms - memtable->opened_at_ms >= max_age_ms);
+}
+
+const YAP_V2_SEGMENT_DESCRIPTOR *YAP_V2_memtable_segments(const YAP_V2_MEMTABLE *memtable,
+                                                          size_t *count) {
+  if (count != NULL) *count = memtable == NULL ? 0U : memtable->segment_count;
+  return memtable == NULL ? NULL : memtable->segments;
+}
@@ -0,0 +1,67 @@
+#ifndef YAPPO_MEMTABLE_V2_H
+#define YAPPO_MEMTABLE_V2_H
+
+#include "indexing/yappo_update_v2.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* One absorbed request: its delta segments and the operations they were built from. */
+typedef struct {
+  YAP_V2_BUILD_BATCH *batch;
+  const YAP_V2_INGEST_OPERATION *operations;
+  size_t operation_count;
+} YAP_V2_MEMTABLE_BATCH;
+
+/* Buffered updates that are logged in update.wal and searchable through delta segments
+ * under index_dir/memtable, but not yet part of the published manifest. Each absorb appends
+ * one WAL record and one more batch of delta segments built from just its own operations;
+ * later batches shadow earlier ones by document ID. The caller decides when
+ * YAP_V2_memtable_sync makes the records durable; when that fails, YAP_V2_memtable_rollback
+ * drops every batch absorbed since the last mark. All functions must be called by a single
+ * writer; readers only see the descriptors it exposes. */
+typedef struct {
+  YAP_V2_MEMTABLE_BATCH *batches;
+  size_t batch_count;
+  size_t batch_capacity;
+  YAP_V2_SEGMENT_DESCRIPTOR *segments;
+  size_t segment_count;
+  size_t segment_capacity;
+  const char **ids;
+  size_t id_capacity;
+  size_t operation_count;
+  uint64_t base_generation;
+  uint64_t sequence;
+  uint64_t opened_at_ms;
+  size_t rollback_batch_count;
+  uint64_t rollback_wal_bytes;
+  int rollback_wal_unsynced;
+  int wal_unsynced;
+} YAP_V2_MEMTABLE;
+
+void YAP_V2_memtable_init(YAP_V2_MEMTABLE *memtable);
+void YAP_V2_memtable_free(YAP_V2_MEMTABLE *memtable);
+/* Drops the buffered state when another writer already replayed the WAL. */
+int YAP_V2_memtable_reconcile(YAP_V2_MEMTABLE *memtable, const char *index_dir,
+                              const YAP_V2_CONFIG *config);
+int YAP_V2_memtable_absorb(YAP_V2_MEMTABLE *memtable, const char *index_dir,
+                           const YAP_V2_CONFIG *config,
+                           const YAP_V2_INGEST_OPERATION *operations, size_t operation_count,
+                           uint64_t now_ms, YAP_V2_UPDATE_RESULT *result,
+                           char *error, size_t error_size);
+int YAP_V2_memtable_flush(YAP_V2_MEMTABLE *memtable, const char *index_dir,
+                          const YAP_V2_CONFIG *config, YAP_V2_UPDATE_RESULT *result,
+                          char *error, size_t error_size);
+int YAP_V2_memtable_sync(YAP_V2_MEMTABLE *memtable, const char *index_dir,
+                         uint64_t *sync_microseconds);
+/* Records the state YAP_V2_memtable_rollback returns to. Absorb marks implicitly while
+ * every record is synced; callers that answer before syncing mark what they acknowledged. */
+int YAP_V2_memtable_mark(YAP_V2_MEMTABLE *memtable, const char *index_dir);
+int YAP_V2_memtable_rollback(YAP_V2_MEMTABLE *memtable, const char *index_dir);
+int YAP_V2_memtable_flush_due(const YAP_V2_MEMTABLE *memtable, size_t max_operations,
+                              uint64_t max_age_ms, uint64_t now_ms);
+void YAP_V2_memtable_set_failpoint_for_testing(const char *name);
+const YAP_V2_SEGMENT_DESCRIPTOR *YAP_V2_memtable_segments(const YAP_V2_MEMTABLE *memtable,
+                                                          size_t *count);
+
+#endif
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <yyjson.h>
 
@@ -17,7 +18,9 @@ typedef struct {
   size_t term_bytes;
   size_t occurrences;
   size_t postings;
+  size_t position_bytes;
   uint64_t last_object;
+  YAP_V2_POSITION last_position;
   int used;
 } TERM_SLOT;
 
@@ -35,6 +38,7 @@ typedef struct {
   size_t metadata_payload;
   size_t vector_id_bytes;
   size_t term_payload;
+  size_t term_entries;
   size_t posting_payload;
   size_t position_payload;
   size_t tombstone_payload;
@@ -181,6 +185,44 @@ static int checked_add(size_t *value, size_t additional) {
   return YAP_V2_OK;
 }
 
+static size_t varint_bytes(size_t value) {
+  size_t bytes = 1U;
+  while (value >= 0x80U) {
+    value >>= 7;
+    bytes++;
+  }
+  return bytes;
+}
+
+/* positions.yap2 stores each position as a varint: absolute for the first one of a field in a
+ * posting, the gap minus one after that. */
+static size_t position_varint_bytes(TERM_SLOT *slot, uint32_t field, uint32_t position) {
+  uint32_t value = slot->last_position.field == field
+                     ? position - slot->last_position.position - 1U
+                     : position;
+  slot->last_position.field = field;
+  slot->last_position.position = position;
+  return varint_bytes(value);
+}
+
+/* One terms.yap2 entry counted with its whole term. The prefix it shares with the previous
+ * term is known only once the slice is sorted, so the term payload is an upper bound. */
+static size_t term_entry_bytes(size_t term_bytes, size_t postings, size_t position_bytes) {
+  size_t blocks = (postings + YAP_V2_POSTINGS_BLOCK_SIZE - 1U) / YAP_V2_POSTINGS_BLOCK_SIZE;
+  return 1U + varint_bytes(term_bytes) + term_bytes + varint_bytes(postings) +
+         varint_bytes(20U + postings * 48U + blocks * 16U) + varint_bytes(16U + position_bytes);
+}
+
+static size_t term_added_bytes(size_t term_entries, const TERM_SLOT *source,
+                               const TERM_SLOT *target) {
+  if (target == NULL)
+    return (term_entries % YAP_V2_TERMS_BLOCK_SIZE == 0U ? 24U : 0U) +
+           term_entry_bytes(source->term_bytes, source->postings, source->position_bytes);
+  return term_entry_bytes(source->term_bytes, target->postings + source->postings,
+                          target->position_bytes + source->position_bytes) -
+         term_entry_bytes(source->term_bytes, target->postings, target->position_bytes);
+}
+
 static int bytes_view_size(YAP_V2_BYTES_VIEW value, size_t *bytes) {
   if (value.len > SIZE_MAX - 4U) return YAP_V2_OUT_OF_RANGE;
   return checked_add(bytes, 4U + value.len);
@@ -255,7 +297,10 @@ static int prepare_unit(const YAP_V2_CONFIG *config, const YAP_V2_SEGMENT_UNIT *
       if (slot->last_object != object_key) {
         slot->postings++;
         slot->last_object = object_key;
+        slot->last_position.field = 0U;
       }
+      slot->position_bytes +=
+        position_varint_bytes(slot, occurrence->field, occurrence->position);
     }
   }
   for (i = 0U; status == YAP_V2_OK && i < unit->passage_count; i++) {
@@ -332,7 +377,7 @@ static int projected_fits(const YAP_V2_CONFIG *config, const SIZER *sizer,
   int status;
   if (unit->document != NULL) {
     if (projected.documents == 0U) {
-      projected.term_payload = 12U;
+      projected.term_payload = 32U;
       projected.posting_payload = 56U;
       projected.position_payload = 12U;
     }
@@ -348,8 +393,9 @@ static int projected_fits(const YAP_V2_CONFIG *config, const SIZER *sizer,
       size_t old_blocks = 0U, new_blocks;
       if (!source->used) continue;
       target = term_map_find(&sizer->terms, source->term, source->term_bytes);
+      projected.term_payload += term_added_bytes(projected.term_entries, source, target);
       if (target == NULL) {
-        projected.term_payload += 44U + source->term_bytes;
+        projected.term_entries++;
         projected.posting_payload += 20U;
         projected.position_payload += 16U;
       } else {
@@ -360,7 +406,7 @@ static int projected_fits(const YAP_V2_CONFIG *config, const SIZER *sizer,
       new_blocks = (old_postings + source->postings + YAP_V2_POSTINGS_BLOCK_SIZE - 1U) /
                    YAP_V2_POSTINGS_BLOCK_SIZE;
       projected.posting_payload += source->postings * 48U + (new_blocks - old_blocks) * 16U;
-      projected.position_payload += source->occurrences * 8U;
+      projected.position_payload += source->position_bytes;
     }
   } else {
     projected.tombstones++;
@@ -397,7 +443,7 @@ static int sizer_add(SIZER *sizer, const YAP_V2_SEGMENT_UNIT *unit,
     return YAP_V2_OK;
   }
   if (sizer->documents == 0U) {
-    sizer->term_payload = 12U;
+    sizer->term_payload = 32U;
     sizer->posting_payload = 56U;
     sizer->position_payload = 12U;
   }
@@ -416,8 +462,11 @@ static int sizer_add(SIZER *sizer, const YAP_V2_SEGMENT_UNIT *unit,
     old_postings = 0U;
     status = term_map_slot(&sizer->terms, source->term, source->term_bytes, 1, &target);
     if (status == YAP_V2_OK) {
-      if (target->occurrences == 0U && target->postings == 0U) {
-        sizer->term_payload += 44U + source->term_bytes;
+      int created = target->occurrences == 0U && target->postings == 0U;
+      sizer->term_payload += term_added_bytes(sizer->term_entries, source,
+                                              created ? NULL : target);
+      if (created) {
+        sizer->term_entries++;
         sizer->posting_payload += 20U;
         sizer->position_payload += 16U;
       } else {
@@ -428,9 +477,10 @@ static int sizer_add(SIZER *sizer, const YAP_V2_SEGMENT_UNIT *unit,
       new_blocks = (old_postings + source->postings + YAP_V2_POSTINGS_BLOCK_SIZE - 1U) /
                    YAP_V2_POSTINGS_BLOCK_SIZE;
       sizer->posting_payload += source->postings * 48U + (new_blocks - old_blocks) * 16U;
-      sizer->position_payload += source->occurrences * 8U;
+      sizer->position_payload += source->position_bytes;
       target->occurrences += source->occurrences;
       target->postings += source->postings;
+      target->position_bytes += source->position_bytes;
     }
   }
   return status;
@@ -657,6 +707,12 @@ static int join_path(char *output, size_t capacity, const char *left, const char
   return written < 0 || (size_t)written >= capacity ? -1 : 0;
 }
 
+static uint64_t monotonic_microseconds(void) {
+  struct timespec value;
+  if (clock_gettime(CLOCK_MONOTONIC, &value) != 0) return 0U;
+  return (uint64_t)value.tv_sec * UINT64_C(1000000) + (uint64_t)value.tv_nsec / 1000U;
+}
+
 static int sync_directory(const char *path) {
   int descriptor = open(path, O_RDONLY | O_DIRECTORY);
   int status;
@@ -666,114 +722,215 @@ static int sync_directory(const char *path) {
   return status;
 }
 
-int YAP_V2_segment_slice_write(const char *directory, const char *segment_id,
-                               uint64_t generation, const YAP_V2_CONFIG *config,
-                               const YAP_V2_SEGMENT_UNIT *units,
-                               const YAP_V2_SEGMENT_PLAN *plan,
-                               YAP_V2_SEGMENT_SLICE slice,
-                               YAP_V2_SEGMENT_DESCRIPTOR *descriptor) {
-  YAP_V2_DOCUMENT_VIEW *documents = NULL;
-  YAP_V2_PASSAGE_VIEW *passages = NULL;
-  YAP_V2_BYTES_VIEW *tombstones = NULL;
-  const YAP_V2_LEXICAL_PREPARED **lexical_prepared = NULL;
-  const void **metadata_roots = NULL;
-  float *vectors = NULL;
-  size_t document_count = 0U, passage_count = 0U, tombstone_count = 0U;
+typedef struct {
+  YAP_V2_DOCUMENT_VIEW *documents;
+  YAP_V2_PASSAGE_VIEW *passages;
+  YAP_V2_BYTES_VIEW *tombstones;
+  const YAP_V2_LEXICAL_PREPARED **lexical_prepared;
+  const void **metadata_roots;
+  float *vectors;
+  size_t document_count;
+  size_t passage_count;
+  size_t tombstone_count;
+} SEGMENT_CONTENT;
+
+static void segment_content_free(SEGMENT_CONTENT *content) {
+  free(content->documents); free(content->passages); free(content->tombstones);
+  free(content->vectors); free(content->lexical_prepared); free(content->metadata_roots);
+  memset(content, 0, sizeof(*content));
+}
+
+/* Gathers the views of consecutive units; prepared units are optional because the merge
+ * path reuses source postings instead of tokenized text. */
+static int segment_content_collect(const YAP_V2_CONFIG *config, const YAP_V2_SEGMENT_UNIT *units,
+                                   size_t unit_count, const PREPARED_UNIT *prepared,
+                                   SEGMENT_CONTENT *content) {
   size_t d = 0U, p = 0U, t = 0U, i, j;
-  char path[4096];
-  int status = YAP_V2_OK;
-  const PREPARED_UNIT *prepared;
-  if (directory == NULL || segment_id == NULL || generation == 0U || config == NULL ||
-      descriptor == NULL || (slice.count > 0U && units == NULL) || plan == NULL ||
-      (plan->prepared_unit_count > 0U && plan->prepared_units == NULL) ||
-      slice.first > plan->prepared_unit_count ||
-      slice.count > plan->prepared_unit_count - slice.first) return YAP_V2_INVALID_ARGUMENT;
-  prepared = plan->prepared_units;
-  for (i = 0U; i < slice.count; i++) {
-    const YAP_V2_SEGMENT_UNIT *unit = &units[slice.first + i];
-    if (unit->document != NULL) { document_count++; passage_count += unit->passage_count; }
-    else tombstone_count++;
-  }
-  documents = document_count == 0U ? NULL : calloc(document_count, sizeof(*documents));
-  passages = passage_count == 0U ? NULL : calloc(passage_count, sizeof(*passages));
-  tombstones = tombstone_count == 0U ? NULL : calloc(tombstone_count, sizeof(*tombstones));
-  lexical_prepared = document_count == 0U ? NULL : calloc(document_count, sizeof(*lexical_prepared));
-  metadata_roots = document_count == 0U ? NULL : calloc(document_count, sizeof(*metadata_roots));
-  if (config->vector_metric != YAP_V2_VECTOR_DISABLED && passage_count > 0U) {
-    if (config->vector_dimensions == 0U || passage_count > SIZE_MAX / config->vector_dimensions ||
-        passage_count * config->vector_dimensions > SIZE_MAX / sizeof(*vectors)) {
-      status = YAP_V2_OUT_OF_RANGE;
-      goto done;
+  memset(content, 0, sizeof(*content));
+  for (i = 0U; i < unit_count; i++) {
+    if (units[i].document != NULL) {
+      content->document_count++;
+      content->passage_count += units[i].passage_count;
+    } else {
+      content->tombstone_count++;
+    }
+  }
+  if (content->document_count > 0U) {
+    content->documents = calloc(content->document_count, sizeof(*content->documents));
+    if (content->documents == NULL) return YAP_V2_ALLOCATION_FAILED;
+  }
+  if (content->passage_count > 0U) {
+    content->passages = calloc(content->passage_count, sizeof(*content->passages));
+    if (content->passages == NULL) return YAP_V2_ALLOCATION_FAILED;
+  }
+  if (content->tombstone_count > 0U) {
+    content->tombstones = calloc(content->tombstone_count, sizeof(*content->tombstones));
+    if (content->tombstones == NULL) return YAP_V2_ALLOCATION_FAILED;
+  }
+  if (prepared != NULL && content->document_count > 0U) {
+    content->lexical_prepared = calloc(content->document_count,
+                                       sizeof(*content->lexical_prepared));
+    content->metadata_roots = calloc(content->document_count, sizeof(*content->metadata_roots));
+    if (content->lexical_prepared == NULL || content->metadata_roots == NULL)
+      return YAP_V2_ALLOCATION_FAILED;
+  }
+  if (config->vector_metric != YAP_V2_VECTOR_DISABLED && content->passage_count > 0U) {
+    if (config->vector_dimensions == 0U ||
+        content->passage_count > SIZE_MAX / config->vector_dimensions ||
+        content->passage_count * config->vector_dimensions > SIZE_MAX / sizeof(float))
+      return YAP_V2_OUT_OF_RANGE;
+    content->vectors = malloc(content->passage_count * config->vector_dimensions * sizeof(float));
+    if (content->vectors == NULL) return YAP_V2_ALLOCATION_FAILED;
+  }
+  for (i = 0U; i < unit_count; i++) {
+    const YAP_V2_SEGMENT_UNIT *unit = &units[i];
+    if (unit->document == NULL) { content->tombstones[t++] = unit->tombstone; continue; }
+    content->documents[d] = *unit->document;
+    if (prepared != NULL) {
+      content->lexical_prepared[d] = &prepared[i].lexical;
+      content->metadata_roots[d] = yyjson_doc_get_root(prepared[i].metadata_document);
     }
-    vectors = malloc(passage_count * config->vector_dimensions * sizeof(*vectors));
-  }
-  if ((document_count > 0U && documents == NULL) || (passage_count > 0U && passages == NULL) ||
-      (tombstone_count > 0U && tombstones == NULL) ||
-      (document_count > 0U && (lexical_prepared == NULL || metadata_roots == NULL)) ||
-      (config->vector_metric != YAP_V2_VECTOR_DISABLED && passage_count > 0U && vectors == NULL)) {
-    status = YAP_V2_ALLOCATION_FAILED;
-    goto done;
-  }
-  for (i = 0U; i < slice.count; i++) {
-    const YAP_V2_SEGMENT_UNIT *unit = &units[slice.first + i];
-    if (unit->document == NULL) { tombstones[t++] = unit->tombstone; continue; }
-    documents[d] = *unit->document;
-    lexical_prepared[d] = &prepared[slice.first + i].lexical;
-    metadata_roots[d] = yyjson_doc_get_root(prepared[slice.first + i].metadata_document);
     d++;
     for (j = 0U; j < unit->passage_count; j++) {
-      passages[p] = unit->passages[j];
-      if (vectors != NULL)
-        memcpy(vectors + p * config->vector_dimensions,
+      content->passages[p] = unit->passages[j];
+      if (content->vectors != NULL)
+        memcpy(content->vectors + p * config->vector_dimensions,
                unit->vectors + j * config->vector_dimensions,
-               config->vector_dimensions * sizeof(*vectors));
+               config->vector_dimensions * sizeof(float));
       p++;
     }
   }
+  return YAP_V2_OK;
+}
+
+static int segment_content_write(const char *directory, const char *segment_id,
+                                 uint64_t generation, const YAP_V2_CONFIG *config,
+                                 const SEGMENT_CONTENT *content,
+                                 const YAP_V2_LEXICAL_MERGE_SOURCE *lexical_sources,
+                                 size_t lexical_source_count,
+                                 const YAP_V2_SEGMENT_ANN_SEED *ann_seed,
+                                 YAP_V2_SEGMENT_ANN_STATS *ann_stats,
+                                 YAP_V2_SEGMENT_DESCRIPTOR *descriptor) {
+  char path[4096];
+  size_t i;
+  int status;
   if (join_path(path, sizeof(path), directory, "documents.yap2") != 0) status = YAP_V2_OUT_OF_RANGE;
-  else status = YAP_V2_segment_write(path, segment_id, generation, documents, document_count,
-                                     passages, passage_count, descriptor);
-  if (status == YAP_V2_OK && document_count > 0U) {
+  else status = YAP_V2_segment_write(path, segment_id, generation, content->documents,
+                                     content->document_count, content->passages,
+                                     content->passage_count, descriptor);
+  if (status == YAP_V2_OK && content->document_count > 0U) {
     YAP_V2_COMPONENT_DESCRIPTOR lexical[3], metadata;
-    status = YAP_V2_lexical_write_prepared(directory, generation, lexical_prepared,
-                                           document_count, lexical);
+    if (content->lexical_prepared != NULL)
+      status = YAP_V2_lexical_write_prepared(directory, generation, content->lexical_prepared,
+                                             content->document_count, lexical);
+    else
+      status = YAP_V2_lexical_merge(directory, generation, lexical_sources, lexical_source_count,
+                                    content->document_count, content->passage_count, lexical);
     for (i = 0U; status == YAP_V2_OK && i < 3U; i++)
       status = YAP_V2_segment_descriptor_add_component(descriptor, &lexical[i]);
-    if (status == YAP_V2_OK && join_path(path, sizeof(path), directory, "metadata.yap2") == 0)
-      status = YAP_V2_metadata_write_preparsed(path, generation, config, documents,
-                                               metadata_roots, document_count, &metadata);
-    else if (status == YAP_V2_OK) status = YAP_V2_OUT_OF_RANGE;
+    if (status == YAP_V2_OK && join_path(path, sizeof(path), directory, "metadata.yap2") != 0)
+      status = YAP_V2_OUT_OF_RANGE;
+    else if (status == YAP_V2_OK && content->metadata_roots != NULL)
+      status = YAP_V2_metadata_write_preparsed(path, generation, config, content->documents,
+                                               content->metadata_roots, content->document_count,
+                                               &metadata);
+    else if (status == YAP_V2_OK)
+      status = YAP_V2_metadata_write(path, generation, config, content->documents,
+                                     content->document_count, &metadata);
     if (status == YAP_V2_OK) status = YAP_V2_segment_descriptor_add_component(descriptor, &metadata);
   }
-  if (status == YAP_V2_OK && vectors != NULL) {
+  if (status == YAP_V2_OK && content->vectors != NULL) {
     YAP_V2_COMPONENT_DESCRIPTOR vector_component, ann_component;
     YAP_EMBEDDING_RESULT embeddings;
     YAP_V2_VECTOR_SEGMENT vector_segment;
-    embeddings.values = vectors; embeddings.input_count = passage_count;
+    embeddings.values = content->vectors; embeddings.input_count = content->passage_count;
     embeddings.dimensions = config->vector_dimensions;
     if (join_path(path, sizeof(path), directory, "vectors.yap2") != 0) status = YAP_V2_OUT_OF_RANGE;
-    else status = YAP_V2_vectors_write(path, generation, config, passages, passage_count,
-                                       &embeddings, &vector_component);
+    else status = YAP_V2_vectors_write(path, generation, config, content->passages,
+                                       content->passage_count, &embeddings, &vector_component);
     if (status == YAP_V2_OK) status = YAP_V2_segment_descriptor_add_component(descriptor, &vector_component);
     YAP_V2_vector_segment_init(&vector_segment);
     if (status == YAP_V2_OK) status = YAP_V2_vector_segment_open(path, generation, config, &vector_segment, NULL);
     if (status == YAP_V2_OK && join_path(path, sizeof(path), directory, "vectors.usearch") == 0) {
-      if (YAP_V2_ann_build_save(path, &vector_segment, 16U, 128U, 64U, &ann_component) != YAP_ANN_OK)
+      uint64_t started = monotonic_microseconds();
+      size_t reused = 0U;
+      if (YAP_V2_ann_build_save_seeded(path, &vector_segment,
+                                       ann_seed == NULL ? NULL : ann_seed->path,
+                                       ann_seed == NULL ? NULL : ann_seed->passage_ordinals,
+                                       ann_seed == NULL ? 0U : ann_seed->passage_count, 16U,
+                                       128U, 64U, &reused, &ann_component) != YAP_ANN_OK)
         status = YAP_V2_CONFLICT;
+      if (status == YAP_V2_OK && ann_stats != NULL) {
+        ann_stats->build_microseconds += monotonic_microseconds() - started;
+        ann_stats->reused_vectors += reused;
+        ann_stats->inserted_vectors += vector_segment.entry_count - reused;
+      }
     } else if (status == YAP_V2_OK) status = YAP_V2_OUT_OF_RANGE;
     YAP_V2_vector_segment_close(&vector_segment);
     if (status == YAP_V2_OK) status = YAP_V2_segment_descriptor_add_component(descriptor, &ann_component);
   }
-  if (status == YAP_V2_OK && tombstone_count > 0U) {
+  if (status == YAP_V2_OK && content->tombstone_count > 0U) {
     YAP_V2_COMPONENT_DESCRIPTOR component;
     if (join_path(path, sizeof(path), directory, "tombstones.yap2") != 0) status = YAP_V2_OUT_OF_RANGE;
-    else status = YAP_V2_tombstones_write(path, generation, tombstones, tombstone_count, &component);
+    else status = YAP_V2_tombstones_write(path, generation, content->tombstones,
+                                          content->tombstone_count, &component);
     if (status == YAP_V2_OK) status = YAP_V2_segment_descriptor_add_component(descriptor, &component);
-    descriptor->tombstone_count = tombstone_count;
+    descriptor->tombstone_count = content->tombstone_count;
   }
   if (status == YAP_V2_OK) status = sync_directory(directory);
-done:
-  free(documents); free(passages); free(tombstones); free(vectors);
-  free(lexical_prepared); free(metadata_roots);
+  return status;
+}
+
+int YAP_V2_segment_slice_write(const char *directory, const char *segment_id,
+                               uint64_t generation, const YAP_V2_CONFIG *config,
+                               const YAP_V2_SEGMENT_UNIT *units,
+                               const YAP_V2_SEGMENT_PLAN *plan,
+                               YAP_V2_SEGMENT_SLICE slice,
+                               YAP_V2_SEGMENT_ANN_STATS *ann_stats,
+                               YAP_V2_SEGMENT_DESCRIPTOR *descriptor) {
+  SEGMENT_CONTENT content;
+  const PREPARED_UNIT *prepared;
+  int status;
+  if (directory == NULL || segment_id == NULL || generation == 0U || config == NULL ||
+      descriptor == NULL || (slice.count > 0U && units == NULL) || plan == NULL ||
+      (plan->prepared_unit_count > 0U && plan->prepared_units == NULL) ||
+      slice.first > plan->prepared_unit_count ||
+      slice.count > plan->prepared_unit_count - slice.first) return YAP_V2_INVALID_ARGUMENT;
+  prepared = plan->prepared_units;
+  status = segment_content_collect(config, units + slice.first, slice.count,
+                                   prepared + slice.first, &content);
+  if (status == YAP_V2_OK)
+    status = segment_content_write(directory, segment_id, generation, config, &content, NULL, 0U,
+                                   NULL, ann_stats, descriptor);
+  segment_content_free(&content);
+  return status;
+}
+
+int YAP_V2_segment_merge_write(const char *directory, const char *segment_id,
+                               uint64_t generation, const YAP_V2_CONFIG *config,
+                               const YAP_V2_SEGMENT_UNIT *units, size_t unit_count,
+                               const YAP_V2_LEXICAL_MERGE_SOURCE *lexical_sources,
+                               size_t lexical_source_count,
+                               const YAP_V2_SEGMENT_ANN_SEED *ann_seed,
+                               YAP_V2_SEGMENT_ANN_STATS *ann_stats,
+                               YAP_V2_SEGMENT_DESCRIPTOR *descriptor) {
+  SEGMENT_CONTENT content;
+  int status;
+  if (directory == NULL || segment_id == NULL || generation == 0U || config == NULL ||
+      descriptor == NULL || (unit_count > 0U && units == NULL) ||
+      (lexical_source_count > 0U && lexical_sources == NULL) ||
+      (ann_seed != NULL && (ann_seed->path == NULL ||
+                            (ann_seed->passage_count > 0U && ann_seed->passage_ordinals == NULL))))
+    return YAP_V2_INVALID_ARGUMENT;
+  status = segment_content_collect(config, units, unit_count, NULL, &content);
+  if (status == YAP_V2_OK &&
+      (content.document_count > YAP_V2_MAX_SEGMENT_DOCUMENTS ||
+       content.passage_count > YAP_V2_MAX_SEGMENT_PASSAGES))
+    status = YAP_V2_SEGMENT_CAPACITY_EXCEEDED;
+  if (status == YAP_V2_OK)
+    status = segment_content_write(directory, segment_id, generation, config, &content,
+                                   lexical_sources, lexical_source_count, ann_seed, ann_stats,
+                                   descriptor);
+  segment_content_free(&content);
   return status;
 }
@@ -1,6 +1,7 @@
 #ifndef YAPPO_SEGMENT_PLANNER_V2_H
 #define YAPPO_SEGMENT_PLANNER_V2_H
 
+#include "components/yappo_lexical_v2.h"
 #include "config/yappo_config_v2.h"
 #include "storage/yappo_storage_v2.h"
 
@@ -49,6 +50,20 @@ typedef struct {
   size_t hard_max_payload_bytes;
 } YAP_V2_SEGMENT_SIZE_POLICY;
 
+/* An ANN graph of a source segment that a merged segment starts from. passage_ordinals maps
+ * every source key to its output passage ordinal, or to YAP_V2_LEXICAL_ORDINAL_DROPPED. */
+typedef struct {
+  const char *path;
+  const uint64_t *passage_ordinals;
+  size_t passage_count;
+} YAP_V2_SEGMENT_ANN_SEED;
+
+typedef struct {
+  uint64_t build_microseconds;
+  size_t reused_vectors;
+  size_t inserted_vectors;
+} YAP_V2_SEGMENT_ANN_STATS;
+
 void YAP_V2_segment_plan_init(YAP_V2_SEGMENT_PLAN *plan);
 void YAP_V2_segment_plan_free(YAP_V2_SEGMENT_PLAN *plan);
 int YAP_V2_segment_plan_bisect(YAP_V2_SEGMENT_PLAN *plan, size_t slice_index);
@@ -72,6 +87,19 @@ int YAP_V2_segment_slice_write(const char *directory, const char *segment_id,
                                const YAP_V2_SEGMENT_UNIT *units,
                                const YAP_V2_SEGMENT_PLAN *plan,
                                YAP_V2_SEGMENT_SLICE slice,
+                               YAP_V2_SEGMENT_ANN_STATS *ann_stats,
+                               YAP_V2_SEGMENT_DESCRIPTOR *descriptor);
+/* Writes all units as one segment, merging lexical components from already written sources
+ * instead of tokenizing the documents again. When ann_seed is set, the ANN graph starts from
+ * that source graph and only the remaining vectors are inserted. ann_stats accumulates the
+ * ANN build cost and may be NULL. */
+int YAP_V2_segment_merge_write(const char *directory, const char *segment_id,
+                               uint64_t generation, const YAP_V2_CONFIG *config,
+                               const YAP_V2_SEGMENT_UNIT *units, size_t unit_count,
+                               const YAP_V2_LEXICAL_MERGE_SOURCE *lexical_sources,
+                               size_t lexical_source_count,
+                               const YAP_V2_SEGMENT_ANN_SEED *ann_seed,
+                               YAP_V2_SEGMENT_ANN_STATS *ann_stats,
                                YAP_V2_SEGMENT_DESCRIPTOR *descriptor);
 
 #endif
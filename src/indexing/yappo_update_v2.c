@@ -5,9 +5,11 @@
 #include "storage/yappo_manifest_v2.h"
 #include "indexing/yappo_segment_planner_v2.h"
 #include "indexing/yappo_update_wal_v2.h"
+#include "components/yappo_ann_v2.h"
 #include "common/yappo_unicode.h"
 #include "storage/yappo_writer_lock_v2.h"
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
@@ -105,6 +107,219 @@ void YAP_V2_update_result_free(YAP_V2_UPDATE_RESULT *result) {
   memset(result, 0, sizeof(*result));
 }
 
+struct YAP_V2_BUILD_BATCH {
+  YAP_V2_INGEST_OPERATION *owned_operations;
+  const YAP_V2_INGEST_OPERATION *operations;
+  size_t operation_count;
+  OPERATION_CHUNKS *chunks;
+  YAP_V2_DOCUMENT_VIEW *documents;
+  YAP_V2_PASSAGE_VIEW *passages;
+  YAP_V2_BYTES_VIEW *tombstones;
+  YAP_V2_SEGMENT_UNIT *units;
+  float *vector_values;
+  size_t document_count;
+  size_t passage_count;
+  size_t tombstone_count;
+  YAP_V2_SEGMENT_PLAN plan;
+  YAP_V2_SEGMENT_DESCRIPTOR *descriptors;
+  char (*segment_paths)[4096];
+  size_t segment_count;
+  YAP_V2_SEGMENT_ID_LIST segment_ids;
+  uint64_t generation;
+  int published;
+};
+
+static void batch_init(YAP_V2_BUILD_BATCH *batch) {
+  memset(batch, 0, sizeof(*batch));
+  YAP_V2_segment_plan_init(&batch->plan);
+  YAP_V2_segment_id_list_init(&batch->segment_ids);
+}
+
+static void batch_discard_segments(YAP_V2_BUILD_BATCH *batch) {
+  size_t i;
+  if (!batch->published && batch->segment_paths != NULL)
+    for (i = 0U; i < batch->segment_count; i++)
+      if (batch->segment_paths[i][0] != '\0') cleanup_segment_dir(batch->segment_paths[i]);
+  free(batch->descriptors); free(batch->segment_paths);
+  batch->descriptors = NULL; batch->segment_paths = NULL; batch->segment_count = 0U;
+  YAP_V2_segment_id_list_free(&batch->segment_ids);
+  YAP_V2_segment_id_list_init(&batch->segment_ids);
+}
+
+static void batch_release(YAP_V2_BUILD_BATCH *batch) {
+  batch_discard_segments(batch);
+  free(batch->documents); free(batch->passages); free(batch->tombstones);
+  free(batch->vector_values); free(batch->units);
+  YAP_V2_segment_plan_free(&batch->plan);
+  free_chunks(batch->chunks, batch->operation_count);
+  if (batch->owned_operations != NULL)
+    YAP_V2_update_operations_free(batch->owned_operations, batch->operation_count);
+  memset(batch, 0, sizeof(*batch));
+}
+
+static int prepare_batch(YAP_V2_BUILD_BATCH *batch, const YAP_V2_CONFIG *config,
+                         const YAP_V2_INGEST_OPERATION *operations, size_t operation_count,
+                         char *error, size_t error_size) {
+  YAP_V2_SEGMENT_CAPACITY_ERROR capacity_error;
+  size_t i, j, document_index = 0U, passage_index = 0U, tombstone_index = 0U;
+  int status;
+  batch->operations = operations;
+  batch->operation_count = operation_count;
+  batch->chunks = calloc(operation_count, sizeof(*batch->chunks));
+  if (batch->chunks == NULL) return YAP_V2_ALLOCATION_FAILED;
+  for (i = 0U; i < operation_count; i++) {
+    if (operations[i].kind == YAP_V2_INGEST_DELETE) { batch->tombstone_count++; continue; }
+    batch->document_count++;
+    status = YAP_V2_unicode_chunk(operations[i].id, operations[i].body, strlen(operations[i].body),
+                                  config->chunk_max_chars, config->chunk_overlap_chars,
+                                  &batch->chunks[i].chunks);
+    if (status != YAP_V2_OK) { set_error(error, error_size, "document chunking failed"); return status; }
+    if (batch->chunks[i].chunks.chunk_count > SIZE_MAX - batch->passage_count) return YAP_V2_OUT_OF_RANGE;
+    batch->passage_count += batch->chunks[i].chunks.chunk_count;
+    if (config->vector_metric != YAP_V2_VECTOR_DISABLED &&
+        (operations[i].vectors == NULL ||
+         operations[i].vector_count != batch->chunks[i].chunks.chunk_count ||
+         operations[i].vector_dimensions != config->vector_dimensions)) {
+      set_error(error, error_size, "vectors must match generated passage count and configured dimensions");
+      return YAP_V2_INVALID_FORMAT;
+    }
+    if (config->vector_metric == YAP_V2_VECTOR_DISABLED && operations[i].vectors != NULL) {
+      set_error(error, error_size, "vectors are disabled by config"); return YAP_V2_INVALID_FORMAT;
+    }
+  }
+  batch->documents = batch->document_count == 0U ? NULL :
+    calloc(batch->document_count, sizeof(*batch->documents));
+  batch->passages = batch->passage_count == 0U ? NULL :
+    calloc(batch->passage_count, sizeof(*batch->passages));
+  batch->tombstones = batch->tombstone_count == 0U ? NULL :
+    calloc(batch->tombstone_count, sizeof(*batch->tombstones));
+  batch->units = calloc(operation_count, sizeof(*batch->units));
+  if ((batch->document_count != 0U && batch->documents == NULL) ||
+      (batch->passage_count != 0U && batch->passages == NULL) ||
+      (batch->tombstone_count != 0U && batch->tombstones == NULL) || batch->units == NULL)
+    return YAP_V2_ALLOCATION_FAILED;
+  if (config->vector_metric != YAP_V2_VECTOR_DISABLED && batch->passage_count != 0U) {
+    if (batch->passage_count > SIZE_MAX / config->vector_dimensions ||
+        batch->passage_count * config->vector_dimensions > SIZE_MAX / sizeof(float))
+      return YAP_V2_OUT_OF_RANGE;
+    batch->vector_values = malloc(batch->passage_count * config->vector_dimensions * sizeof(float));
+    if (batch->vector_values == NULL) return YAP_V2_ALLOCATION_FAILED;
+  }
+  for (i = 0U; i < operation_count; i++) {
+    const YAP_V2_INGEST_OPERATION *operation = &operations[i];
+    YAP_V2_DOCUMENT_VIEW *document;
+    if (operation->kind == YAP_V2_INGEST_DELETE) {
+      batch->tombstones[tombstone_index] = view(operation->id);
+      batch->units[i].tombstone = batch->tombstones[tombstone_index++];
+      continue;
+    }
+    document = &batch->documents[document_index];
+    batch->units[i].document = document;
+    batch->units[i].passages = &batch->passages[passage_index];
+    batch->units[i].passage_count = batch->chunks[i].chunks.chunk_count;
+    batch->units[i].vectors = batch->vector_values == NULL ? NULL :
+      batch->vector_values + passage_index * config->vector_dimensions;
+    document->id = view(operation->id); document->url = view(operation->url);
+    document->title = view(operation->title); document->body = view(operation->body);
+    document->metadata_json = view(operation->metadata_json);
+    document->updated_at_unix_ms = operation->updated_at_unix_ms;
+    for (j = 0U; j < batch->chunks[i].chunks.chunk_count; j++) {
+      YAP_V2_CHUNK *chunk = &batch->chunks[i].chunks.chunks[j];
+      YAP_V2_PASSAGE_VIEW *passage = &batch->passages[passage_index];
+      passage->id = view(chunk->id); passage->parent_document_id = view(operation->id);
+      passage->text = view(chunk->text); passage->ordinal = chunk->ordinal;
+      passage->start_char = chunk->start_char; passage->end_char = chunk->end_char;
+      if (batch->vector_values != NULL)
+        memcpy(batch->vector_values + passage_index * config->vector_dimensions,
+               operation->vectors + j * config->vector_dimensions,
+               config->vector_dimensions * sizeof(float));
+      passage_index++;
+    }
+    document_index++;
+  }
+  status = YAP_V2_segment_plan_with_policy(
+    config, batch->units, operation_count, 31U,
+    YAP_V2_segment_planner_size_policy(), &batch->plan, &capacity_error);
+  if (status == YAP_V2_SEGMENT_CAPACITY_EXCEEDED) {
+    (void)snprintf(error, error_size,
+      "document '%.*s' requires %zu bytes in %s (limit %zu)",
+      (int)capacity_error.document_id.len, capacity_error.document_id.data,
+      capacity_error.required_bytes, capacity_error.component, capacity_error.limit_bytes);
+    return status;
+  }
+  if (status != YAP_V2_OK) set_error(error, error_size, "segment planning failed");
+  return status;
+}
+
+static int write_batch_segments(YAP_V2_BUILD_BATCH *batch, const char *segments_path,
+                                uint64_t generation, const YAP_V2_CONFIG *config,
+                                size_t existing_segment_count,
+                                char *error, size_t error_size) {
+  size_t i, failed_slice;
+  int status = YAP_V2_OK;
+  if (mkdir(segments_path, 0700) != 0 && errno != EEXIST) return YAP_V2_IO_ERROR;
+  batch->generation = generation;
+write_segments:
+  failed_slice = SIZE_MAX;
+  if (YAP_V2_segment_count_validate(existing_segment_count, batch->plan.count) != YAP_V2_OK) {
+    set_error(error, error_size, "index segment limit reached"); return YAP_V2_OUT_OF_RANGE;
+  }
+  batch->descriptors = calloc(batch->plan.count, sizeof(*batch->descriptors));
+  batch->segment_paths = calloc(batch->plan.count, sizeof(*batch->segment_paths));
+  if (batch->descriptors == NULL || batch->segment_paths == NULL) return YAP_V2_ALLOCATION_FAILED;
+  batch->segment_count = batch->plan.count;
+  for (i = 0U; status == YAP_V2_OK && i < batch->plan.count; i++) {
+    const char *segment_id;
+    if (snprintf(batch->segment_paths[i], sizeof(batch->segment_paths[i]), "%s/seg-%020llu-XXXXXX",
+                 segments_path, (unsigned long long)generation) < 0 ||
+        mkdtemp(batch->segment_paths[i]) == NULL) {
+      batch->segment_paths[i][0] = '\0';
+      status = YAP_V2_IO_ERROR; set_error(error, error_size, "cannot create segment directory"); break;
+    }
+    segment_id = strrchr(batch->segment_paths[i], '/');
+    segment_id = segment_id == NULL ? batch->segment_paths[i] : segment_id + 1;
+    status = YAP_V2_segment_slice_write(batch->segment_paths[i], segment_id, generation, config,
+                                        batch->units, &batch->plan, batch->plan.slices[i],
+                                        NULL, &batch->descriptors[i]);
+    if (status == YAP_V2_SEGMENT_CAPACITY_EXCEEDED) failed_slice = i;
+    if (status == YAP_V2_OK) status = YAP_V2_segment_id_list_add(&batch->segment_ids, segment_id);
+    if (status == YAP_V2_OK && i == 0U && failpoint("after_first_segment")) {
+      status = YAP_V2_IO_ERROR;
+      set_error(error, error_size, "injected failure after first segment");
+    }
+  }
+  if (status == YAP_V2_SEGMENT_CAPACITY_EXCEEDED && failed_slice < batch->plan.count &&
+      batch->plan.slices[failed_slice].count > 1U) {
+    batch_discard_segments(batch);
+    status = YAP_V2_segment_plan_bisect(&batch->plan, failed_slice);
+    if (status == YAP_V2_OK) goto write_segments;
+  }
+  if (status != YAP_V2_OK) {
+    if (error != NULL && error_size > 0U && error[0] == '\0')
+      set_error(error, error_size, "segment creation failed");
+    return status;
+  }
+  return sync_directory(segments_path);
+}
+
+static int publish_batch_segments(const char *index_dir, const char *manifest_path,
+                                  YAP_V2_MANIFEST *manifest, YAP_V2_BUILD_BATCH *batch) {
+  size_t i;
+  int status = YAP_V2_OK;
+  for (i = 0U; status == YAP_V2_OK && i < batch->segment_count; i++)
+    status = YAP_V2_manifest_verify_segment_components(
+      index_dir, batch->generation, &batch->descriptors[i]);
+  for (i = 0U; status == YAP_V2_OK && i < batch->segment_count; i++)
+    status = YAP_V2_manifest_add_segment(manifest, &batch->descriptors[i]);
+  if (status == YAP_V2_OK) {
+    manifest->generation = batch->generation;
+    status = YAP_V2_manifest_publish_if_generation(manifest_path, batch->generation - 1U,
+                                                   manifest);
+  }
+  if (status == YAP_V2_OK) batch->published = 1;
+  return status;
+}
+
 static int apply_operations(const char *index_dir,
                             const YAP_V2_INGEST_OPERATION *operations,
                             size_t operation_count, size_t operation_limit,
@@ -112,23 +327,15 @@ static int apply_operations(const char *index_dir,
                             char *error, size_t error_size,
                             int writer_lock_held, int write_wal,
                             uint64_t expected_target_generation) {
-  YAP_V2_CONFIG config; YAP_V2_MANIFEST manifest;
-  YAP_V2_DOCUMENT_VIEW *documents = NULL; YAP_V2_PASSAGE_VIEW *passages = NULL;
-  YAP_V2_BYTES_VIEW *tombstones = NULL; OPERATION_CHUNKS *chunks = NULL;
-  YAP_V2_SEGMENT_UNIT *units = NULL; YAP_V2_SEGMENT_DESCRIPTOR *descriptors = NULL;
-  YAP_V2_SEGMENT_PLAN plan; YAP_V2_SEGMENT_CAPACITY_ERROR capacity_error;
-  float *vector_values = NULL; char (*segment_paths)[4096] = NULL;
+  YAP_V2_CONFIG config; YAP_V2_MANIFEST manifest; YAP_V2_BUILD_BATCH batch;
   char config_path[4096], manifest_path[4096], segments_path[4096];
   char config_error[256];
-  size_t i, j, document_count = 0U, passage_count = 0U, tombstone_count = 0U;
-  size_t document_index = 0U, passage_index = 0U, tombstone_index = 0U;
-  size_t failed_slice = SIZE_MAX;
-  uint64_t next_generation;
+  uint64_t next_generation, wal_sync_microseconds = 0U;
   int status = YAP_V2_OK, published = 0, owns_writer_lock = 0;
   int wal_active = expected_target_generation != 0U;
   int preserve_wal = expected_target_generation != 0U;
   YAP_V2_WRITER_LOCK writer_lock;
-  YAP_V2_manifest_init(&manifest); YAP_V2_segment_plan_init(&plan);
+  YAP_V2_manifest_init(&manifest); batch_init(&batch);
   YAP_V2_writer_lock_init(&writer_lock);
   if (index_dir == NULL || operations == NULL || result == NULL || operation_count == 0U ||
       operation_count > operation_limit) return YAP_V2_INVALID_ARGUMENT;
@@ -163,87 +370,11 @@ static int apply_operations(const char *index_dir,
     set_error(error, error_size, "WAL generation does not follow current manifest");
     goto done;
   }
-  chunks = calloc(operation_count, sizeof(*chunks));
-  if (chunks == NULL) { status = YAP_V2_ALLOCATION_FAILED; goto done; }
-  for (i = 0U; i < operation_count; i++) {
-    if (operations[i].kind == YAP_V2_INGEST_DELETE) { tombstone_count++; continue; }
-    document_count++;
-    status = YAP_V2_unicode_chunk(operations[i].id, operations[i].body, strlen(operations[i].body),
-                                  config.chunk_max_chars, config.chunk_overlap_chars,
-                                  &chunks[i].chunks);
-    if (status != YAP_V2_OK) { set_error(error, error_size, "document chunking failed"); goto done; }
-    if (chunks[i].chunks.chunk_count > SIZE_MAX - passage_count) { status = YAP_V2_OUT_OF_RANGE; goto done; }
-    passage_count += chunks[i].chunks.chunk_count;
-    if (config.vector_metric != YAP_V2_VECTOR_DISABLED &&
-        (operations[i].vectors == NULL ||
-         operations[i].vector_count != chunks[i].chunks.chunk_count ||
-         operations[i].vector_dimensions != config.vector_dimensions)) {
-      status = YAP_V2_INVALID_FORMAT;
-      set_error(error, error_size, "vectors must match generated passage count and configured dimensions");
-      goto done;
-    }
-    if (config.vector_metric == YAP_V2_VECTOR_DISABLED && operations[i].vectors != NULL) {
-      status = YAP_V2_INVALID_FORMAT; set_error(error, error_size, "vectors are disabled by config"); goto done;
-    }
-  }
-  documents = document_count == 0U ? NULL : calloc(document_count, sizeof(*documents));
-  passages = passage_count == 0U ? NULL : calloc(passage_count, sizeof(*passages));
-  tombstones = tombstone_count == 0U ? NULL : calloc(tombstone_count, sizeof(*tombstones));
-  units = calloc(operation_count, sizeof(*units));
-  if ((document_count != 0U && documents == NULL) || (passage_count != 0U && passages == NULL) ||
-      (tombstone_count != 0U && tombstones == NULL) || units == NULL) {
-    status = YAP_V2_ALLOCATION_FAILED; goto done;
-  }
-  if (config.vector_metric != YAP_V2_VECTOR_DISABLED && passage_count != 0U) {
-    if (passage_count > SIZE_MAX / config.vector_dimensions ||
-        passage_count * config.vector_dimensions > SIZE_MAX / sizeof(float)) { status = YAP_V2_OUT_OF_RANGE; goto done; }
-    vector_values = malloc(passage_count * config.vector_dimensions * sizeof(float));
-    if (vector_values == NULL) { status = YAP_V2_ALLOCATION_FAILED; goto done; }
-  }
-  for (i = 0U; i < operation_count; i++) {
-    const YAP_V2_INGEST_OPERATION *operation = &operations[i];
-    if (operation->kind == YAP_V2_INGEST_DELETE) {
-      tombstones[tombstone_index] = view(operation->id);
-      units[i].tombstone = tombstones[tombstone_index++];
-      continue;
-    }
-    units[i].document = &documents[document_index];
-    units[i].passages = &passages[passage_index];
-    units[i].passage_count = chunks[i].chunks.chunk_count;
-    units[i].vectors = vector_values == NULL ? NULL :
-      vector_values + passage_index * config.vector_dimensions;
-    documents[document_index].id = view(operation->id); documents[document_index].url = view(operation->url);
-    documents[document_index].title = view(operation->title); documents[document_index].body = view(operation->body);
-    documents[document_index].metadata_json = view(operation->metadata_json);
-    documents[document_index].updated_at_unix_ms = operation->updated_at_unix_ms;
-    for (j = 0U; j < chunks[i].chunks.chunk_count; j++) {
-      YAP_V2_CHUNK *chunk = &chunks[i].chunks.chunks[j];
-      passages[passage_index].id = view(chunk->id); passages[passage_index].parent_document_id = view(operation->id);
-      passages[passage_index].text = view(chunk->text); passages[passage_index].ordinal = chunk->ordinal;
-      passages[passage_index].start_char = chunk->start_char; passages[passage_index].end_char = chunk->end_char;
-      if (vector_values != NULL)
-        memcpy(vector_values + passage_index * config.vector_dimensions,
-               operation->vectors + j * config.vector_dimensions,
-               config.vector_dimensions * sizeof(float));
-      passage_index++;
-    }
-    document_index++;
-  }
-  if (mkdir(segments_path, 0700) != 0 && errno != EEXIST) { status = YAP_V2_IO_ERROR; goto done; }
-  status = YAP_V2_segment_plan_with_policy(
-    &config, units, operation_count, 31U,
-    YAP_V2_segment_planner_size_policy(), &plan, &capacity_error);
-  if (status == YAP_V2_SEGMENT_CAPACITY_EXCEEDED) {
-    (void)snprintf(error, error_size,
-      "document '%.*s' requires %zu bytes in %s (limit %zu)",
-      (int)capacity_error.document_id.len, capacity_error.document_id.data,
-      capacity_error.required_bytes, capacity_error.component, capacity_error.limit_bytes);
-    goto done;
-  }
-  if (status != YAP_V2_OK) { set_error(error, error_size, "segment planning failed"); goto done; }
+  status = prepare_batch(&batch, &config, operations, operation_count, error, error_size);
+  if (status != YAP_V2_OK) goto done;
   if (write_wal) {
     status = YAP_V2_update_wal_write(index_dir, manifest.generation,
-                                     operations, operation_count);
+                                     operations, operation_count, &wal_sync_microseconds);
     if (status != YAP_V2_OK) {
       set_error(error, error_size, "cannot persist update WAL");
       goto done;
@@ -256,59 +387,10 @@ static int apply_operations(const char *index_dir,
       goto done;
     }
   }
-write_segments:
-  failed_slice = SIZE_MAX;
-  if (YAP_V2_segment_count_validate(manifest.segment_count, plan.count) != YAP_V2_OK) {
-    status = YAP_V2_OUT_OF_RANGE; set_error(error, error_size, "index segment limit reached"); goto done;
-  }
-  descriptors = calloc(plan.count, sizeof(*descriptors));
-  segment_paths = calloc(plan.count, sizeof(*segment_paths));
-  if (descriptors == NULL || segment_paths == NULL) { status = YAP_V2_ALLOCATION_FAILED; goto done; }
-  for (i = 0U; status == YAP_V2_OK && i < plan.count; i++) {
-    const char *segment_id;
-    if (snprintf(segment_paths[i], sizeof(segment_paths[i]), "%s/seg-%020llu-XXXXXX",
-                 segments_path, (unsigned long long)next_generation) < 0 ||
-        mkdtemp(segment_paths[i]) == NULL) {
-      status = YAP_V2_IO_ERROR; set_error(error, error_size, "cannot create segment directory"); break;
-    }
-    segment_id = strrchr(segment_paths[i], '/');
-    segment_id = segment_id == NULL ? segment_paths[i] : segment_id + 1;
-    status = YAP_V2_segment_slice_write(segment_paths[i], segment_id, next_generation, &config,
-                                        units, &plan, plan.slices[i], &descriptors[i]);
-    if (status == YAP_V2_SEGMENT_CAPACITY_EXCEEDED) failed_slice = i;
-    if (status == YAP_V2_OK) status = YAP_V2_segment_id_list_add(&result->segment_ids, segment_id);
-    if (status == YAP_V2_OK && i == 0U && failpoint("after_first_segment")) {
-      status = YAP_V2_IO_ERROR;
-      set_error(error, error_size, "injected failure after first segment");
-    }
-  }
-  if (status == YAP_V2_SEGMENT_CAPACITY_EXCEEDED && failed_slice < plan.count &&
-      plan.slices[failed_slice].count > 1U) {
-    for (i = 0U; i < plan.count; i++)
-      if (segment_paths[i][0] != '\0') cleanup_segment_dir(segment_paths[i]);
-    free(descriptors); free(segment_paths); descriptors = NULL; segment_paths = NULL;
-    YAP_V2_segment_id_list_free(&result->segment_ids);
-    YAP_V2_segment_id_list_init(&result->segment_ids);
-    status = YAP_V2_segment_plan_bisect(&plan, failed_slice);
-    if (status == YAP_V2_OK) goto write_segments;
-  }
-  if (status != YAP_V2_OK) {
-    if (error != NULL && error_size > 0U && error[0] == '\0')
-      set_error(error, error_size, "segment creation failed");
-    goto done;
-  }
-  if (status == YAP_V2_OK) status = sync_directory(segments_path);
-  for (i = 0U; status == YAP_V2_OK && i < plan.count; i++) {
-    status = YAP_V2_manifest_verify_segment_components(
-      index_dir, next_generation, &descriptors[i]);
-  }
-  for (i = 0U; status == YAP_V2_OK && i < plan.count; i++)
-    status = YAP_V2_manifest_add_segment(&manifest, &descriptors[i]);
-  if (status == YAP_V2_OK) {
-    manifest.generation = next_generation;
-  }
-  if (status == YAP_V2_OK)
-    status = YAP_V2_manifest_publish_if_generation(manifest_path, next_generation - 1U, &manifest);
+  status = write_batch_segments(&batch, segments_path, next_generation, &config,
+                                manifest.segment_count, error, error_size);
+  if (status != YAP_V2_OK) goto done;
+  status = publish_batch_segments(index_dir, manifest_path, &manifest, &batch);
   if (status != YAP_V2_OK) {
     set_error(error, error_size,
               status == YAP_V2_CONFLICT ? "generation changed during update" :
@@ -316,6 +398,8 @@ write_segments:
     goto done;
   }
   published = 1;
+  result->segment_ids = batch.segment_ids;
+  YAP_V2_segment_id_list_init(&batch.segment_ids);
   if (failpoint("after_manifest_publish_before_wal_clear")) {
     preserve_wal = 1;
     status = YAP_V2_IO_ERROR;
@@ -333,17 +417,13 @@ write_segments:
     wal_active = 0;
   }
   result->generation = next_generation; result->accepted = operation_count;
-  result->upserts = document_count; result->deletes = tombstone_count;
+  result->wal_synced = write_wal; result->wal_sync_microseconds = wal_sync_microseconds;
+  result->upserts = batch.document_count; result->deletes = batch.tombstone_count;
 done:
-  if (!published && segment_paths != NULL)
-    for (i = 0U; i < plan.count; i++)
-      if (segment_paths[i][0] != '\0') cleanup_segment_dir(segment_paths[i]);
   if (wal_active && !published && !preserve_wal)
     (void)YAP_V2_update_wal_clear(index_dir);
   if (status != YAP_V2_OK) YAP_V2_update_result_free(result);
-  free(documents); free(passages); free(tombstones); free(vector_values);
-  free(units); free(descriptors); free(segment_paths); YAP_V2_segment_plan_free(&plan);
-  free_chunks(chunks, operation_count); YAP_V2_manifest_free(&manifest);
+  batch_release(&batch); YAP_V2_manifest_free(&manifest);
   if (owns_writer_lock) YAP_V2_writer_lock_release(&writer_lock);
   return status;
 }
@@ -380,7 +460,13 @@ int YAP_V2_update_recover(const char *index_dir, char *error,
     set_error(error, error_size, "update WAL is invalid or unreadable");
     goto done;
   }
-  if (wal.operation_count == 0U) goto done;
+  if (wal.operation_count == 0U) {
+    /* Only a torn, never acknowledged record was left behind. */
+    status = YAP_V2_update_wal_clear(index_dir);
+    if (status != YAP_V2_OK)
+      set_error(error, error_size, "empty update WAL could not be cleared");
+    goto done;
+  }
   status = YAP_V2_config_load(config_path, &config, config_error,
                               sizeof(config_error));
   if (status != YAP_V2_OK) {
@@ -432,6 +518,218 @@ int YAP_V2_build_apply(const char *index_dir, const YAP_V2_INGEST_OPERATION *ope
                           error_size, 0, 0, 0U);
 }
 
+int YAP_V2_build_batch_prepare(const YAP_V2_CONFIG *config,
+                               YAP_V2_INGEST_OPERATION *operations, size_t operation_count,
+                               YAP_V2_BUILD_BATCH **batch_out,
+                               char *error, size_t error_size) {
+  YAP_V2_BUILD_BATCH *batch;
+  int status;
+  if (batch_out != NULL) *batch_out = NULL;
+  if (config == NULL || operations == NULL || batch_out == NULL || operation_count == 0U ||
+      operation_count > YAP_V2_BUILD_BATCH_OPERATIONS) {
+    YAP_V2_update_operations_free(operations, operation_count);
+    return YAP_V2_INVALID_ARGUMENT;
+  }
+  batch = malloc(sizeof(*batch));
+  if (batch == NULL) {
+    YAP_V2_update_operations_free(operations, operation_count);
+    return YAP_V2_ALLOCATION_FAILED;
+  }
+  batch_init(batch);
+  batch->owned_operations = operations;
+  batch->operation_count = operation_count;
+  status = validate_unique_ids(operations, operation_count);
+  if (status != YAP_V2_OK)
+    set_error(error, error_size, "batch contains duplicate document IDs");
+  else
+    status = prepare_batch(batch, config, operations, operation_count, error, error_size);
+  if (status != YAP_V2_OK) { YAP_V2_build_batch_free(batch); return status; }
+  *batch_out = batch;
+  return YAP_V2_OK;
+}
+
+int YAP_V2_build_batch_write(const char *index_dir, const YAP_V2_CONFIG *config,
+                             uint64_t generation, YAP_V2_BUILD_BATCH *batch,
+                             char *error, size_t error_size) {
+  char segments_path[4096];
+  if (index_dir == NULL || config == NULL || batch == NULL || generation < 2U ||
+      batch->segment_count != 0U) return YAP_V2_INVALID_ARGUMENT;
+  if (join_path(segments_path, sizeof(segments_path), index_dir, "segments") != 0) {
+    set_error(error, error_size, "index path is too long"); return YAP_V2_OUT_OF_RANGE;
+  }
+  return write_batch_segments(batch, segments_path, generation, config, 0U, error, error_size);
+}
+
+/* Delta segments live under index_dir/memtable until they are promoted, so compaction GC
+ * never sees them and a crash leaves only the WAL as the record of the buffered batch. */
+int YAP_V2_build_batch_write_delta(const char *index_dir, const YAP_V2_CONFIG *config,
+                                   uint64_t generation, YAP_V2_BUILD_BATCH *batch,
+                                   char *error, size_t error_size) {
+  char delta_path[4096];
+  if (index_dir == NULL || config == NULL || batch == NULL || generation < 2U ||
+      batch->segment_count != 0U) return YAP_V2_INVALID_ARGUMENT;
+  if (join_path(delta_path, sizeof(delta_path), index_dir, "memtable") != 0) {
+    set_error(error, error_size, "index path is too long"); return YAP_V2_OUT_OF_RANGE;
+  }
+  return write_batch_segments(batch, delta_path, generation, config, 0U, error, error_size);
+}
+
+const YAP_V2_SEGMENT_DESCRIPTOR *YAP_V2_build_batch_segments(const YAP_V2_BUILD_BATCH *batch,
+                                                            size_t *count) {
+  if (count != NULL) *count = batch == NULL ? 0U : batch->segment_count;
+  return batch == NULL ? NULL : batch->descriptors;
+}
+
+int YAP_V2_build_batch_promote(const char *index_dir, YAP_V2_BUILD_BATCH *batch,
+                               char *error, size_t error_size) {
+  char segments_path[4096], target[4096];
+  size_t i;
+  if (index_dir == NULL || batch == NULL || batch->segment_count == 0U || batch->published)
+    return YAP_V2_INVALID_ARGUMENT;
+  if (join_path(segments_path, sizeof(segments_path), index_dir, "segments") != 0) {
+    set_error(error, error_size, "index path is too long"); return YAP_V2_OUT_OF_RANGE;
+  }
+  if (mkdir(segments_path, 0700) != 0 && errno != EEXIST) return YAP_V2_IO_ERROR;
+  for (i = 0U; i < batch->segment_count; i++) {
+    if (join_path(target, sizeof(target), segments_path, batch->descriptors[i].id) != 0 ||
+        rename(batch->segment_paths[i], target) != 0) {
+      set_error(error, error_size, "cannot promote delta segment");
+      return YAP_V2_IO_ERROR;
+    }
+    memcpy(batch->segment_paths[i], target, strlen(target) + 1U);
+  }
+  return sync_directory(segments_path);
+}
+
+void YAP_V2_build_delta_discard(const char *index_dir) {
+  char delta_path[4096], segment_path[4096];
+  struct dirent *entry;
+  DIR *directory;
+  if (index_dir == NULL ||
+      join_path(delta_path, sizeof(delta_path), index_dir, "memtable") != 0) return;
+  directory = opendir(delta_path);
+  if (directory == NULL) return;
+  while ((entry = readdir(directory)) != NULL) {
+    if (strncmp(entry->d_name, "seg-", 4U) != 0 ||
+        join_path(segment_path, sizeof(segment_path), delta_path, entry->d_name) != 0)
+      continue;
+    cleanup_segment_dir(segment_path);
+  }
+  (void)closedir(directory);
+  (void)rmdir(delta_path);
+}
+
+int YAP_V2_build_batch_publish(const char *index_dir, const YAP_V2_CONFIG *config,
+                               YAP_V2_BUILD_BATCH *batch, YAP_V2_UPDATE_RESULT *result,
+                               char *error, size_t error_size) {
+  YAP_V2_MANIFEST manifest;
+  YAP_V2_WRITER_LOCK writer_lock;
+  char manifest_path[4096];
+  int status;
+  if (index_dir == NULL || config == NULL || batch == NULL || result == NULL ||
+      batch->segment_count == 0U || batch->published) return YAP_V2_INVALID_ARGUMENT;
+  YAP_V2_update_result_init(result);
+  if (join_path(manifest_path, sizeof(manifest_path), index_dir, "manifest.yap2") != 0) {
+    set_error(error, error_size, "index path is too long"); return YAP_V2_OUT_OF_RANGE;
+  }
+  YAP_V2_manifest_init(&manifest);
+  YAP_V2_writer_lock_init(&writer_lock);
+  status = YAP_V2_writer_lock_acquire(&writer_lock, index_dir);
+  if (status != YAP_V2_OK) {
+    set_error(error, error_size, "cannot acquire index writer lock");
+    return status;
+  }
+  status = YAP_V2_manifest_load_for_config(manifest_path, config, &manifest);
+  if (status != YAP_V2_OK) { set_error(error, error_size, "current index snapshot is invalid"); goto done; }
+  if (manifest.generation + 1U != batch->generation) {
+    status = YAP_V2_CONFLICT; set_error(error, error_size, "generation changed during build"); goto done;
+  }
+  if (YAP_V2_segment_count_validate(manifest.segment_count, batch->segment_count) != YAP_V2_OK) {
+    status = YAP_V2_OUT_OF_RANGE; set_error(error, error_size, "index segment limit reached"); goto done;
+  }
+  status = publish_batch_segments(index_dir, manifest_path, &manifest, batch);
+  if (status != YAP_V2_OK) { set_error(error, error_size, "segment publish failed"); goto done; }
+  result->segment_ids = batch->segment_ids;
+  YAP_V2_segment_id_list_init(&batch->segment_ids);
+  result->generation = batch->generation; result->accepted = batch->operation_count;
+  result->upserts = batch->document_count; result->deletes = batch->tombstone_count;
+done:
+  YAP_V2_manifest_free(&manifest);
+  YAP_V2_writer_lock_release(&writer_lock);
+  return status;
+}
+
+int YAP_V2_build_batch_stage(YAP_V2_BUILD_BATCH *batch, YAP_V2_MANIFEST *staged,
+                             YAP_V2_UPDATE_RESULT *result) {
+  size_t i;
+  int status;
+  if (batch == NULL || staged == NULL || result == NULL || batch->segment_count == 0U ||
+      batch->published || batch->generation != staged->generation)
+    return YAP_V2_INVALID_ARGUMENT;
+  YAP_V2_update_result_init(result);
+  status = YAP_V2_segment_count_validate(staged->segment_count, batch->segment_count);
+  for (i = 0U; status == YAP_V2_OK && i < batch->segment_count; i++)
+    status = YAP_V2_manifest_add_segment(staged, &batch->descriptors[i]);
+  if (status != YAP_V2_OK) return status;
+  batch->published = 1;
+  result->segment_ids = batch->segment_ids;
+  YAP_V2_segment_id_list_init(&batch->segment_ids);
+  result->generation = batch->generation; result->accepted = batch->operation_count;
+  result->upserts = batch->document_count; result->deletes = batch->tombstone_count;
+  return YAP_V2_OK;
+}
+
+int YAP_V2_build_publish_staged(const char *index_dir, const YAP_V2_CONFIG *config,
+                                const YAP_V2_MANIFEST *staged,
+                                char *error, size_t error_size) {
+  YAP_V2_MANIFEST manifest;
+  YAP_V2_WRITER_LOCK writer_lock;
+  char manifest_path[4096];
+  size_t i;
+  int status;
+  if (index_dir == NULL || config == NULL || staged == NULL || staged->generation < 2U)
+    return YAP_V2_INVALID_ARGUMENT;
+  if (join_path(manifest_path, sizeof(manifest_path), index_dir, "manifest.yap2") != 0) {
+    set_error(error, error_size, "index path is too long"); return YAP_V2_OUT_OF_RANGE;
+  }
+  YAP_V2_manifest_init(&manifest);
+  YAP_V2_writer_lock_init(&writer_lock);
+  status = YAP_V2_writer_lock_acquire(&writer_lock, index_dir);
+  if (status != YAP_V2_OK) {
+    set_error(error, error_size, "cannot acquire index writer lock");
+    return status;
+  }
+  status = YAP_V2_manifest_load_for_config(manifest_path, config, &manifest);
+  if (status != YAP_V2_OK) { set_error(error, error_size, "current index snapshot is invalid"); goto done; }
+  if (manifest.generation + 1U != staged->generation) {
+    status = YAP_V2_CONFLICT; set_error(error, error_size, "generation changed during build"); goto done;
+  }
+  if (YAP_V2_segment_count_validate(manifest.segment_count, staged->segment_count) != YAP_V2_OK) {
+    status = YAP_V2_OUT_OF_RANGE; set_error(error, error_size, "index segment limit reached"); goto done;
+  }
+  for (i = 0U; status == YAP_V2_OK && i < staged->segment_count; i++)
+    status = YAP_V2_manifest_verify_segment_components(index_dir, staged->generation,
+                                                       &staged->segments[i]);
+  for (i = 0U; status == YAP_V2_OK && i < staged->segment_count; i++)
+    status = YAP_V2_manifest_add_segment(&manifest, &staged->segments[i]);
+  if (status == YAP_V2_OK) {
+    manifest.generation = staged->generation;
+    status = YAP_V2_manifest_publish_if_generation(manifest_path, staged->generation - 1U,
+                                                   &manifest);
+  }
+  if (status != YAP_V2_OK) set_error(error, error_size, "segment publish failed");
+done:
+  YAP_V2_manifest_free(&manifest);
+  YAP_V2_writer_lock_release(&writer_lock);
+  return status;
+}
+
+void YAP_V2_build_batch_free(YAP_V2_BUILD_BATCH *batch) {
+  if (batch == NULL) return;
+  batch_release(batch);
+  free(batch);
+}
+
 void YAP_V2_update_operations_free(YAP_V2_INGEST_OPERATION *operations,
                                    size_t count) {
   size_t i;
@@ -598,6 +896,7 @@ int YAP_V2_update_main(int argc, char **argv) {
   if (YAP_application_config_load(config_path, &application, error, sizeof(error)) != YAP_V2_OK) {
     fprintf(stderr, "Config error: %s\n", error); return EXIT_FAILURE;
   }
+  YAP_V2_ann_set_build_threads(application.ann_build_threads);
   status = read_operations(input_path, &operations, &operation_count, error, sizeof(error));
   if (status != YAP_V2_OK) {
     fprintf(stderr, "Update input failed: %s (%s)\n", error, YAP_V2_status_string(status));
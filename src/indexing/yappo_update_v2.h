@@ -12,9 +12,13 @@ typedef struct {
   size_t accepted;
   size_t upserts;
   size_t deletes;
+  int wal_synced;
+  uint64_t wal_sync_microseconds;
   YAP_V2_SEGMENT_ID_LIST segment_ids;
 } YAP_V2_UPDATE_RESULT;
 
+typedef struct YAP_V2_BUILD_BATCH YAP_V2_BUILD_BATCH;
+
 void YAP_V2_update_result_init(YAP_V2_UPDATE_RESULT *result);
 void YAP_V2_update_result_free(YAP_V2_UPDATE_RESULT *result);
 void YAP_V2_update_set_failpoint_for_testing(const char *name);
@@ -34,6 +38,30 @@ int YAP_V2_update_apply(const char *index_dir, const YAP_V2_INGEST_OPERATION *op
 int YAP_V2_build_apply(const char *index_dir, const YAP_V2_INGEST_OPERATION *operations,
                        size_t operation_count, YAP_V2_UPDATE_RESULT *result,
                        char *error, size_t error_size);
+int YAP_V2_build_batch_prepare(const YAP_V2_CONFIG *config,
+                               YAP_V2_INGEST_OPERATION *operations, size_t operation_count,
+                               YAP_V2_BUILD_BATCH **batch_out,
+                               char *error, size_t error_size);
+int YAP_V2_build_batch_write(const char *index_dir, const YAP_V2_CONFIG *config,
+                             uint64_t generation, YAP_V2_BUILD_BATCH *batch,
+                             char *error, size_t error_size);
+int YAP_V2_build_batch_write_delta(const char *index_dir, const YAP_V2_CONFIG *config,
+                                   uint64_t generation, YAP_V2_BUILD_BATCH *batch,
+                                   char *error, size_t error_size);
+const YAP_V2_SEGMENT_DESCRIPTOR *YAP_V2_build_batch_segments(const YAP_V2_BUILD_BATCH *batch,
+                                                            size_t *count);
+int YAP_V2_build_batch_promote(const char *index_dir, YAP_V2_BUILD_BATCH *batch,
+                               char *error, size_t error_size);
+void YAP_V2_build_delta_discard(const char *index_dir);
+int YAP_V2_build_batch_publish(const char *index_dir, const YAP_V2_CONFIG *config,
+                               YAP_V2_BUILD_BATCH *batch, YAP_V2_UPDATE_RESULT *result,
+                               char *error, size_t error_size);
+int YAP_V2_build_batch_stage(YAP_V2_BUILD_BATCH *batch, YAP_V2_MANIFEST *staged,
+                             YAP_V2_UPDATE_RESULT *result);
+int YAP_V2_build_publish_staged(const char *index_dir, const YAP_V2_CONFIG *config,
+                                const YAP_V2_MANIFEST *staged,
+                                char *error, size_t error_size);
+void YAP_V2_build_batch_free(YAP_V2_BUILD_BATCH *batch);
 int YAP_V2_update_ndjson(const char *index_dir, const unsigned char *input, size_t input_bytes,
                          YAP_V2_UPDATE_RESULT *result, char *error, size_t error_size);
 int YAP_V2_update_json_batch(const char *index_dir, const unsigned char *input,
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #define WAL_HEADER_BYTES 64U
@@ -47,19 +48,6 @@ static uint64_t get_u64(const unsigned char *input) {
   return value;
 }
 
-static uint32_t crc32c_update(uint32_t crc, const unsigned char *data,
-                              size_t length) {
-  size_t i;
-  for (i = 0U; i < length; i++) {
-    unsigned int bit;
-    crc ^= data[i];
-    for (bit = 0U; bit < 8U; bit++)
-      crc = (crc >> 1U) ^
-            (UINT32_C(0x82f63b78) & (uint32_t)-(int32_t)(crc & 1U));
-  }
-  return crc;
-}
-
 static int sync_directory(const char *path) {
   int descriptor = open(path, O_RDONLY | O_DIRECTORY);
   int status = YAP_V2_OK;
@@ -73,7 +61,7 @@ static int write_bytes(FILE *file, const void *data, size_t length,
                        uint32_t *crc, uint64_t *payload_bytes) {
   if (length != 0U && fwrite(data, 1U, length, file) != length)
     return YAP_V2_IO_ERROR;
-  *crc = crc32c_update(*crc, data, length);
+  *crc = YAP_V2_crc32c_update(*crc, data, length);
   if ((uint64_t)length > UINT64_MAX - *payload_bytes)
     return YAP_V2_OUT_OF_RANGE;
   *payload_bytes += (uint64_t)length;
@@ -105,37 +93,23 @@ int YAP_V2_update_wal_exists(const char *index_dir) {
   return access(path, F_OK) == 0;
 }
 
-int YAP_V2_update_wal_write(
-    const char *index_dir, uint64_t base_generation,
-    const YAP_V2_INGEST_OPERATION *operations, size_t operation_count) {
-  char path[4096], temporary[4096];
+static uint64_t monotonic_microseconds(void) {
+  struct timespec value;
+  if (clock_gettime(CLOCK_MONOTONIC, &value) != 0) return 0U;
+  return (uint64_t)value.tv_sec * UINT64_C(1000000) + (uint64_t)value.tv_nsec / 1000U;
+}
+
+/* Writes one record at the current position of file, which must equal start. The header is
+ * written last so a torn record keeps a zero magic until its payload is complete. */
+static int write_record(FILE *file, off_t start, uint64_t base_generation,
+                        const YAP_V2_INGEST_OPERATION *operations, size_t operation_count) {
   unsigned char header[WAL_HEADER_BYTES] = {0};
   uint32_t crc = UINT32_MAX;
   uint64_t payload_bytes = 0U;
-  FILE *file = NULL;
-  int descriptor = -1, status = YAP_V2_OK, renamed = 0;
+  int status = YAP_V2_OK;
   size_t i;
-  if (index_dir == NULL || operations == NULL || operation_count == 0U ||
-      operation_count > WAL_MAX_OPERATIONS || base_generation == UINT64_MAX)
-    return YAP_V2_INVALID_ARGUMENT;
-  if (join_path(path, sizeof(path), index_dir, "update.wal") != 0) 
-    return YAP_V2_OUT_OF_RANGE;
-  {
-    int written = snprintf(temporary, sizeof(temporary),
-                           "%s/update.wal.tmp-XXXXXX", index_dir);
-    if (written < 0 || (size_t)written >= sizeof(temporary))
-      return YAP_V2_OUT_OF_RANGE;
-  }
-  descriptor = mkstemp(temporary);
-  if (descriptor < 0) return YAP_V2_IO_ERROR;
-  file = fdopen(descriptor, "w+b");
-  if (file == NULL) {
-    (void)close(descriptor); (void)unlink(temporary);
-    return YAP_V2_IO_ERROR;
-  }
-  descriptor = -1;
   if (fwrite(header, 1U, sizeof(header), file) != sizeof(header))
-    status = YAP_V2_IO_ERROR;
+    return YAP_V2_IO_ERROR;
   for (i = 0U; status == YAP_V2_OK && i < operation_count; i++) {
     const YAP_V2_INGEST_OPERATION *operation = &operations[i];
     const char *texts[5] = {operation->id, operation->url, operation->title,
@@ -175,19 +149,54 @@ int YAP_V2_update_wal_write(
                            &payload_bytes);
     }
   }
+  if (status != YAP_V2_OK) return status;
+  memcpy(header, wal_magic, sizeof(wal_magic));
+  put_u32(header + 8U, WAL_VERSION);
+  put_u32(header + 12U, WAL_HEADER_BYTES);
+  put_u64(header + 16U, base_generation);
+  put_u64(header + 24U, base_generation + 1U);
+  put_u64(header + 32U, (uint64_t)operation_count);
+  put_u64(header + 40U, payload_bytes);
+  put_u32(header + 48U, ~crc);
+  if (fseeko(file, start, SEEK_SET) != 0 ||
+      fwrite(header, 1U, sizeof(header), file) != sizeof(header) ||
+      fseeko(file, 0, SEEK_END) != 0 || fflush(file) != 0)
+    return YAP_V2_IO_ERROR;
+  return YAP_V2_OK;
+}
+
+int YAP_V2_update_wal_write(
+    const char *index_dir, uint64_t base_generation,
+    const YAP_V2_INGEST_OPERATION *operations, size_t operation_count,
+    uint64_t *sync_microseconds) {
+  char path[4096], temporary[4096];
+  FILE *file = NULL;
+  uint64_t started = 0U;
+  int descriptor = -1, status = YAP_V2_OK, renamed = 0;
+  if (sync_microseconds != NULL) *sync_microseconds = 0U;
+  if (index_dir == NULL || operations == NULL || operation_count == 0U ||
+      operation_count > WAL_MAX_OPERATIONS || base_generation == UINT64_MAX)
+    return YAP_V2_INVALID_ARGUMENT;
+  if (join_path(path, sizeof(path), index_dir, "update.wal") != 0) 
+    return YAP_V2_OUT_OF_RANGE;
+  {
+    int written = snprintf(temporary, sizeof(temporary),
+                           "%s/update.wal.tmp-XXXXXX", index_dir);
+    if (written < 0 || (size_t)written >= sizeof(temporary))
+      return YAP_V2_OUT_OF_RANGE;
+  }
+  descriptor = mkstemp(temporary);
+  if (descriptor < 0) return YAP_V2_IO_ERROR;
+  file = fdopen(descriptor, "w+b");
+  if (file == NULL) {
+    (void)close(descriptor); (void)unlink(temporary);
+    return YAP_V2_IO_ERROR;
+  }
+  descriptor = -1;
+  status = write_record(file, 0, base_generation, operations, operation_count);
   if (status == YAP_V2_OK) {
-    memcpy(header, wal_magic, sizeof(wal_magic));
-    put_u32(header + 8U, WAL_VERSION);
-    put_u32(header + 12U, WAL_HEADER_BYTES);
-    put_u64(header + 16U, base_generation);
-    put_u64(header + 24U, base_generation + 1U);
-    put_u64(header + 32U, (uint64_t)operation_count);
-    put_u64(header + 40U, payload_bytes);
-    put_u32(header + 48U, ~crc);
-    if (fseek(file, 0L, SEEK_SET) != 0 ||
-        fwrite(header, 1U, sizeof(header), file) != sizeof(header) ||
-        fflush(file) != 0 || fsync(fileno(file)) != 0)
-      status = YAP_V2_IO_ERROR;
+    started = monotonic_microseconds();
+    if (fsync(fileno(file)) != 0) status = YAP_V2_IO_ERROR;
   }
   if (fclose(file) != 0 && status == YAP_V2_OK) status = YAP_V2_IO_ERROR;
   if (status == YAP_V2_OK) {
@@ -195,16 +204,112 @@ int YAP_V2_update_wal_write(
     else renamed = 1;
   }
   if (status == YAP_V2_OK) status = sync_directory(index_dir);
+  if (status == YAP_V2_OK && sync_microseconds != NULL)
+    *sync_microseconds = monotonic_microseconds() - started;
   if (!renamed) (void)unlink(temporary);
   return status;
 }
 
+int YAP_V2_update_wal_append(
+    const char *index_dir, uint64_t base_generation,
+    const YAP_V2_INGEST_OPERATION *operations, size_t operation_count) {
+  char path[4096];
+  unsigned char header[WAL_HEADER_BYTES];
+  struct stat info;
+  FILE *file;
+  off_t start = -1;
+  int descriptor, created = 0, status;
+  if (index_dir == NULL || operations == NULL || operation_count == 0U ||
+      operation_count > WAL_MAX_OPERATIONS || base_generation == UINT64_MAX)
+    return YAP_V2_INVALID_ARGUMENT;
+  if (join_path(path, sizeof(path), index_dir, "update.wal") != 0)
+    return YAP_V2_OUT_OF_RANGE;
+  descriptor = open(path, O_RDWR);
+  if (descriptor < 0 && errno == ENOENT) {
+    descriptor = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    created = descriptor >= 0;
+  }
+  if (descriptor < 0) return YAP_V2_IO_ERROR;
+  file = fdopen(descriptor, "r+b");
+  if (file == NULL) {
+    (void)close(descriptor);
+    if (created) (void)unlink(path);
+    return YAP_V2_IO_ERROR;
+  }
+  status = fstat(fileno(file), &info) == 0 ? YAP_V2_OK : YAP_V2_IO_ERROR;
+  if (status == YAP_V2_OK && info.st_size != 0) {
+    /* Every record of one log shares the base generation of the first record. */
+    if (info.st_size < (off_t)sizeof(header) ||
+        fread(header, 1U, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, wal_magic, sizeof(wal_magic)) != 0)
+      status = YAP_V2_INVALID_FORMAT;
+    else if (get_u64(header + 16U) != base_generation)
+      status = YAP_V2_CONFLICT;
+  }
+  if (status == YAP_V2_OK) {
+    if (fseeko(file, info.st_size, SEEK_SET) != 0) status = YAP_V2_IO_ERROR;
+    else start = info.st_size;
+  }
+  if (status == YAP_V2_OK)
+    status = write_record(file, start, base_generation, operations, operation_count);
+  if (fclose(file) != 0 && status == YAP_V2_OK) status = YAP_V2_IO_ERROR;
+  if (status == YAP_V2_OK) return created ? sync_directory(index_dir) : YAP_V2_OK;
+  /* Drops a partially appended record so later appends do not land behind it. */
+  if (created) (void)unlink(path);
+  else if (start >= 0) (void)truncate(path, start);
+  return status;
+}
+
+int YAP_V2_update_wal_sync(const char *index_dir, uint64_t *sync_microseconds) {
+  char path[4096];
+  uint64_t started;
+  int descriptor, status = YAP_V2_OK;
+  if (sync_microseconds != NULL) *sync_microseconds = 0U;
+  if (index_dir == NULL || join_path(path, sizeof(path), index_dir, "update.wal") != 0)
+    return YAP_V2_INVALID_ARGUMENT;
+  descriptor = open(path, O_RDWR);
+  if (descriptor < 0) return errno == ENOENT ? YAP_V2_NOT_FOUND : YAP_V2_IO_ERROR;
+  started = monotonic_microseconds();
+  if (fsync(descriptor) != 0) status = YAP_V2_IO_ERROR;
+  if (close(descriptor) != 0) status = YAP_V2_IO_ERROR;
+  if (status == YAP_V2_OK && sync_microseconds != NULL)
+    *sync_microseconds = monotonic_microseconds() - started;
+  return status;
+}
+
+int YAP_V2_update_wal_size(const char *index_dir, uint64_t *bytes) {
+  char path[4096];
+  struct stat info;
+  if (bytes != NULL) *bytes = 0U;
+  if (index_dir == NULL || bytes == NULL ||
+      join_path(path, sizeof(path), index_dir, "update.wal") != 0)
+    return YAP_V2_INVALID_ARGUMENT;
+  if (stat(path, &info) != 0) return errno == ENOENT ? YAP_V2_OK : YAP_V2_IO_ERROR;
+  *bytes = (uint64_t)info.st_size;
+  return YAP_V2_OK;
+}
+
+int YAP_V2_update_wal_truncate(const char *index_dir, uint64_t bytes) {
+  char path[4096];
+  int descriptor, status = YAP_V2_OK;
+  if (bytes == 0U) return YAP_V2_update_wal_clear(index_dir);
+  if (index_dir == NULL || bytes > (uint64_t)INT64_MAX ||
+      join_path(path, sizeof(path), index_dir, "update.wal") != 0)
+    return YAP_V2_INVALID_ARGUMENT;
+  descriptor = open(path, O_RDWR);
+  if (descriptor < 0) return errno == ENOENT ? YAP_V2_NOT_FOUND : YAP_V2_IO_ERROR;
+  if (ftruncate(descriptor, (off_t)bytes) != 0 || fsync(descriptor) != 0)
+    status = YAP_V2_IO_ERROR;
+  if (close(descriptor) != 0) status = YAP_V2_IO_ERROR;
+  return status;
+}
+
 static int read_exact(FILE *file, void *data, size_t length,
                       uint32_t *crc, uint64_t *remaining) {
   if ((uint64_t)length > *remaining) return YAP_V2_INVALID_FORMAT;
   if (length != 0U && fread(data, 1U, length, file) != length)
     return YAP_V2_INVALID_FORMAT;
-  *crc = crc32c_update(*crc, data, length);
+  *crc = YAP_V2_crc32c_update(*crc, data, length);
   *remaining -= (uint64_t)length;
   return YAP_V2_OK;
 }
@@ -223,14 +328,104 @@ static int read_text(FILE *file, uint64_t length, char **output,
   return YAP_V2_OK;
 }
 
+static int read_operation(FILE *file, YAP_V2_INGEST_OPERATION *operation,
+                          uint32_t *crc, uint64_t *remaining) {
+  unsigned char record[WAL_OPERATION_HEADER_BYTES];
+  uint64_t lengths[5], vector_count, vector_dimensions, vector_values;
+  char **texts[5] = {&operation->id, &operation->url, &operation->title,
+                     &operation->body, &operation->metadata_json};
+  size_t j;
+  int status = read_exact(file, record, sizeof(record), crc, remaining);
+  if (status != YAP_V2_OK) return status;
+  operation->kind = (YAP_V2_INGEST_KIND)get_u32(record);
+  operation->updated_at_unix_ms = (int64_t)get_u64(record + 8U);
+  vector_count = get_u64(record + 16U);
+  vector_dimensions = get_u64(record + 24U);
+  if ((operation->kind != YAP_V2_INGEST_UPSERT &&
+       operation->kind != YAP_V2_INGEST_DELETE) ||
+      vector_count > SIZE_MAX || vector_dimensions > SIZE_MAX ||
+      (vector_count != 0U && vector_dimensions > SIZE_MAX / vector_count))
+    return YAP_V2_INVALID_FORMAT;
+  operation->vector_count = (size_t)vector_count;
+  operation->vector_dimensions = (size_t)vector_dimensions;
+  for (j = 0U; j < 5U; j++) lengths[j] = get_u64(record + 32U + j * 8U);
+  for (j = 0U; status == YAP_V2_OK && j < 5U; j++)
+    status = read_text(file, lengths[j], texts[j], crc, remaining);
+  vector_values = vector_count * vector_dimensions;
+  if (status == YAP_V2_OK && vector_values != 0U) {
+    if (vector_values > SIZE_MAX / sizeof(float)) return YAP_V2_OUT_OF_RANGE;
+    operation->vectors = malloc((size_t)vector_values * sizeof(float));
+    if (operation->vectors == NULL) return YAP_V2_ALLOCATION_FAILED;
+    for (j = 0U; status == YAP_V2_OK && j < (size_t)vector_values; j++) {
+      unsigned char encoded[4];
+      uint32_t bits;
+      status = read_exact(file, encoded, sizeof(encoded), crc, remaining);
+      bits = get_u32(encoded);
+      memcpy(&operation->vectors[j], &bits, sizeof(bits));
+    }
+  }
+  if (status == YAP_V2_OK && operation->id[0] == '\0')
+    status = YAP_V2_INVALID_FORMAT;
+  return status;
+}
+
+static uint64_t id_hash(const char *value) {
+  uint64_t hash = UINT64_C(1469598103934665603);
+  for (; *value != '\0'; value++) {
+    hash ^= (unsigned char)*value;
+    hash *= UINT64_C(1099511628211);
+  }
+  return hash;
+}
+
+/* A later record replaces an earlier operation on the same ID in place, matching how the
+ * writer merged them in memory before appending. */
+static int merge_records(YAP_V2_UPDATE_WAL *wal) {
+  size_t capacity = 1U, count = 0U, i, *slots;
+  while (capacity < wal->operation_count * 2U) capacity *= 2U;
+  slots = malloc(capacity * sizeof(*slots));
+  if (slots == NULL) return YAP_V2_ALLOCATION_FAILED;
+  for (i = 0U; i < capacity; i++) slots[i] = SIZE_MAX;
+  for (i = 0U; i < wal->operation_count; i++) {
+    YAP_V2_INGEST_OPERATION *operation = &wal->operations[i];
+    size_t slot = (size_t)(id_hash(operation->id) & (uint64_t)(capacity - 1U));
+    while (slots[slot] != SIZE_MAX &&
+           strcmp(wal->operations[slots[slot]].id, operation->id) != 0)
+      slot = (slot + 1U) & (capacity - 1U);
+    if (slots[slot] == SIZE_MAX) {
+      slots[slot] = count;
+      if (count != i) {
+        wal->operations[count] = *operation;
+        memset(operation, 0, sizeof(*operation));
+      }
+      count++;
+    } else {
+      YAP_V2_ingest_operation_free(&wal->operations[slots[slot]]);
+      wal->operations[slots[slot]] = *operation;
+      memset(operation, 0, sizeof(*operation));
+    }
+  }
+  free(slots);
+  wal->operation_count = count;
+  return count > WAL_MAX_OPERATIONS ? YAP_V2_INVALID_FORMAT : YAP_V2_OK;
+}
+
+static int header_is_unwritten(const unsigned char *header) {
+  size_t i;
+  for (i = 0U; i < sizeof(wal_magic); i++)
+    if (header[i] != 0U) return 0;
+  return 1;
+}
+
+/* Reads every complete record. A torn final record was never acknowledged as durable and
+ * ends the log; damage anywhere else, or a corrupt first record, is reported. */
 int YAP_V2_update_wal_load(const char *index_dir, YAP_V2_UPDATE_WAL *wal) {
   char path[4096];
   unsigned char header[WAL_HEADER_BYTES];
   struct stat info;
   FILE *file;
-  uint64_t operation_count, payload_bytes, remaining;
-  uint32_t expected_crc, crc = UINT32_MAX;
-  size_t i;
+  uint64_t size, offset = 0U;
+  size_t records = 0U;
   int status = YAP_V2_OK;
   if (index_dir == NULL || wal == NULL ||
       join_path(path, sizeof(path), index_dir, "update.wal") != 0)
@@ -238,77 +433,63 @@ int YAP_V2_update_wal_load(const char *index_dir, YAP_V2_UPDATE_WAL *wal) {
   YAP_V2_update_wal_init(wal);
   file = fopen(path, "rb");
   if (file == NULL) return errno == ENOENT ? YAP_V2_NOT_FOUND : YAP_V2_IO_ERROR;
-  if (fstat(fileno(file), &info) != 0 || info.st_size < (off_t)sizeof(header) ||
-      fread(header, 1U, sizeof(header), file) != sizeof(header)) {
-    status = YAP_V2_INVALID_FORMAT; goto done;
-  }
-  operation_count = get_u64(header + 32U);
-  payload_bytes = get_u64(header + 40U);
-  expected_crc = get_u32(header + 48U);
-  if (memcmp(header, wal_magic, sizeof(wal_magic)) != 0 ||
-      get_u32(header + 8U) != WAL_VERSION ||
-      get_u32(header + 12U) != WAL_HEADER_BYTES || operation_count == 0U ||
-      operation_count > WAL_MAX_OPERATIONS ||
-      payload_bytes != (uint64_t)info.st_size - WAL_HEADER_BYTES) {
-    status = YAP_V2_INVALID_FORMAT; goto done;
+  if (fstat(fileno(file), &info) != 0 || info.st_size < 0) {
+    status = YAP_V2_IO_ERROR; goto done;
   }
-  wal->base_generation = get_u64(header + 16U);
-  wal->target_generation = get_u64(header + 24U);
-  if (wal->base_generation == UINT64_MAX ||
-      wal->target_generation != wal->base_generation + 1U) {
-    status = YAP_V2_INVALID_FORMAT; goto done;
-  }
-  wal->operations = calloc((size_t)operation_count, sizeof(*wal->operations));
-  if (wal->operations == NULL) { status = YAP_V2_ALLOCATION_FAILED; goto done; }
-  wal->operation_count = (size_t)operation_count;
-  remaining = payload_bytes;
-  for (i = 0U; status == YAP_V2_OK && i < wal->operation_count; i++) {
-    YAP_V2_INGEST_OPERATION *operation = &wal->operations[i];
-    unsigned char record[WAL_OPERATION_HEADER_BYTES];
-    uint64_t lengths[5], vector_count, vector_dimensions, vector_values;
-    char **texts[5] = {&operation->id, &operation->url, &operation->title,
-                       &operation->body, &operation->metadata_json};
-    size_t j;
-    status = read_exact(file, record, sizeof(record), &crc, &remaining);
-    if (status != YAP_V2_OK) break;
-    operation->kind = (YAP_V2_INGEST_KIND)get_u32(record);
-    operation->updated_at_unix_ms = (int64_t)get_u64(record + 8U);
-    vector_count = get_u64(record + 16U);
-    vector_dimensions = get_u64(record + 24U);
-    if ((operation->kind != YAP_V2_INGEST_UPSERT &&
-         operation->kind != YAP_V2_INGEST_DELETE) ||
-        vector_count > SIZE_MAX || vector_dimensions > SIZE_MAX ||
-        (vector_count != 0U && vector_dimensions > SIZE_MAX / vector_count)) {
+  size = (uint64_t)info.st_size;
+  while (status == YAP_V2_OK && offset < size) {
+    YAP_V2_INGEST_OPERATION *grown;
+    uint64_t operation_count, payload_bytes, remaining, base_generation;
+    uint32_t expected_crc, crc = UINT32_MAX;
+    size_t first, i;
+    if (size - offset < WAL_HEADER_BYTES ||
+        fread(header, 1U, sizeof(header), file) != sizeof(header) ||
+        header_is_unwritten(header))
+      break;
+    operation_count = get_u64(header + 32U);
+    payload_bytes = get_u64(header + 40U);
+    expected_crc = get_u32(header + 48U);
+    base_generation = get_u64(header + 16U);
+    if (memcmp(header, wal_magic, sizeof(wal_magic)) != 0 ||
+        get_u32(header + 8U) != WAL_VERSION ||
+        get_u32(header + 12U) != WAL_HEADER_BYTES || operation_count == 0U ||
+        operation_count > WAL_MAX_OPERATIONS || base_generation == UINT64_MAX ||
+        get_u64(header + 24U) != base_generation + 1U ||
+        (records != 0U && base_generation != wal->base_generation)) {
       status = YAP_V2_INVALID_FORMAT; break;
     }
-    operation->vector_count = (size_t)vector_count;
-    operation->vector_dimensions = (size_t)vector_dimensions;
-    for (j = 0U; j < 5U; j++) lengths[j] = get_u64(record + 32U + j * 8U);
-    for (j = 0U; status == YAP_V2_OK && j < 5U; j++)
-      status = read_text(file, lengths[j], texts[j], &crc, &remaining);
-    vector_values = vector_count * vector_dimensions;
-    if (status == YAP_V2_OK && vector_values != 0U) {
-      if (vector_values > SIZE_MAX / sizeof(float)) {
-        status = YAP_V2_OUT_OF_RANGE; break;
-      }
-      operation->vectors = malloc((size_t)vector_values * sizeof(float));
-      if (operation->vectors == NULL) {
-        status = YAP_V2_ALLOCATION_FAILED; break;
-      }
-      for (j = 0U; status == YAP_V2_OK && j < (size_t)vector_values; j++) {
-        unsigned char encoded[4];
-        uint32_t bits;
-        status = read_exact(file, encoded, sizeof(encoded), &crc, &remaining);
-        bits = get_u32(encoded);
-        memcpy(&operation->vectors[j], &bits, sizeof(bits));
-      }
+    if (payload_bytes > size - offset - WAL_HEADER_BYTES) {
+      if (records == 0U) status = YAP_V2_INVALID_FORMAT;
+      break;
     }
-    if (status == YAP_V2_OK && operation->id[0] == '\0')
+    grown = realloc(wal->operations, (wal->operation_count + (size_t)operation_count) *
+                                     sizeof(*grown));
+    if (grown == NULL) { status = YAP_V2_ALLOCATION_FAILED; break; }
+    wal->operations = grown;
+    first = wal->operation_count;
+    memset(wal->operations + first, 0, (size_t)operation_count * sizeof(*grown));
+    wal->operation_count += (size_t)operation_count;
+    remaining = payload_bytes;
+    for (i = 0U; status == YAP_V2_OK && i < (size_t)operation_count; i++)
+      status = read_operation(file, &wal->operations[first + i], &crc, &remaining);
+    if (status == YAP_V2_OK && (remaining != 0U || ~crc != expected_crc)) {
       status = YAP_V2_INVALID_FORMAT;
+      if (records != 0U && offset + WAL_HEADER_BYTES + payload_bytes == size) {
+        for (i = first; i < wal->operation_count; i++)
+          YAP_V2_ingest_operation_free(&wal->operations[i]);
+        wal->operation_count = first;
+        status = YAP_V2_OK;
+        break;
+      }
+    }
+    if (status != YAP_V2_OK) break;
+    if (records++ == 0U) {
+      wal->base_generation = base_generation;
+      wal->target_generation = base_generation + 1U;
+    }
+    offset += WAL_HEADER_BYTES + payload_bytes;
   }
-  if (status == YAP_V2_OK && (remaining != 0U || ~crc != expected_crc ||
-                              fgetc(file) != EOF))
-    status = YAP_V2_INVALID_FORMAT;
+  if (status == YAP_V2_OK && records > 1U) status = merge_records(wal);
 done:
   if (fclose(file) != 0 && status == YAP_V2_OK) status = YAP_V2_IO_ERROR;
   if (status != YAP_V2_OK) YAP_V2_update_wal_free(wal);
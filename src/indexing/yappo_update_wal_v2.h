@@ -16,9 +16,23 @@ typedef struct {
 void YAP_V2_update_wal_init(YAP_V2_UPDATE_WAL *wal);
 void YAP_V2_update_wal_free(YAP_V2_UPDATE_WAL *wal);
 int YAP_V2_update_wal_exists(const char *index_dir);
+/* Replaces update.wal with one synced record; sync_microseconds may be NULL. */
 int YAP_V2_update_wal_write(
+  const char *index_dir, uint64_t base_generation,
+  const YAP_V2_INGEST_OPERATION *operations, size_t operation_count,
+  uint64_t *sync_microseconds);
+/* Appends one record without syncing it; YAP_V2_update_wal_sync makes every appended
+ * record durable at once. All records of one log share base_generation. */
+int YAP_V2_update_wal_append(
   const char *index_dir, uint64_t base_generation,
   const YAP_V2_INGEST_OPERATION *operations, size_t operation_count);
+int YAP_V2_update_wal_sync(const char *index_dir, uint64_t *sync_microseconds);
+/* Reports the size of update.wal; a missing log has size 0. */
+int YAP_V2_update_wal_size(const char *index_dir, uint64_t *bytes);
+/* Cuts update.wal back to a size reported earlier, removing it when bytes is 0, and syncs
+ * the result. Used to drop appended records that could not be made durable. */
+int YAP_V2_update_wal_truncate(const char *index_dir, uint64_t bytes);
+/* Loads every record; later records replace earlier operations on the same ID. */
 int YAP_V2_update_wal_load(const char *index_dir, YAP_V2_UPDATE_WAL *wal);
 int YAP_V2_update_wal_clear(const char *index_dir);
 
@@ -13,7 +13,11 @@
 #define YAP_V2_ANN_CONNECTIVITY 16U
 #define YAP_V2_ANN_EXPANSION_ADD 128U
 #define YAP_V2_ANN_EXPANSION_SEARCH 128U
-#define YAP_V2_ANN_CACHE_PAYLOAD_VERSION 1U
+#define YAP_V2_ANN_CACHE_PAYLOAD_VERSION 4U
+#define YAP_V2_ANN_CACHE_FIXED_BYTES 44U
+#define YAP_V2_ANN_CACHE_READ_BYTES (1024U * 1024U)
+#define YAP_V2_ANN_DEFRAGMENT_DIVISOR 4U
+#define YAP_V2_ANN_MAX_CORPUS_SEGMENTS (2U * YAP_V2_MAX_SEGMENTS)
 #define YAP_V2_ANN_CACHE_META_NAME "ann-base.yap2"
 #define YAP_V2_ANN_CACHE_INDEX_NAME "ann-base.usearch"
 #define YAP_V2_ANN_CACHE_LOCK_NAME "ann-base.lock"
@@ -86,19 +90,6 @@ static uint64_t get_u64_le(const unsigned char *input) {
   return value;
 }
 
-static uint32_t crc32c(const unsigned char *data, size_t len) {
-  uint32_t crc = UINT32_MAX;
-  size_t i;
-  for (i = 0U; i < len; i++) {
-    uint32_t current = (crc ^ data[i]) & 0xffU;
-    unsigned int bit;
-    for (bit = 0U; bit < 8U; bit++)
-      current = (current >> 1U) ^ ((current & 1U) ? UINT32_C(0x82f63b78) : 0U);
-    crc = (crc >> 8U) ^ current;
-  }
-  return ~crc;
-}
-
 static int join_path(char *output, size_t capacity, const char *left, const char *right) {
   int written = snprintf(output, capacity, "%s/%s", left, right);
   return written < 0 || (size_t)written >= capacity ? -1 : 0;
@@ -152,6 +143,34 @@ static int read_file(const char *path, unsigned char **data, size_t *bytes) {
   return YAP_V2_OK;
 }
 
+/* CRC32C of the whole graph file, read in 1 MiB chunks. */
+static int ann_file_crc32c(const char *path, uint64_t *bytes, uint32_t *crc) {
+  unsigned char *buffer;
+  uint64_t total = 0U;
+  uint32_t state = UINT32_MAX;
+  ssize_t read_bytes;
+  int fd, status = YAP_V2_IO_ERROR;
+  fd = open(path, O_RDONLY);
+  if (fd < 0) return errno == ENOENT ? YAP_V2_NOT_FOUND : YAP_V2_IO_ERROR;
+  buffer = malloc(YAP_V2_ANN_CACHE_READ_BYTES);
+  if (buffer == NULL) { (void)close(fd); return YAP_V2_ALLOCATION_FAILED; }
+  for (;;) {
+    read_bytes = read(fd, buffer, YAP_V2_ANN_CACHE_READ_BYTES);
+    if (read_bytes < 0 && errno == EINTR) continue;
+    if (read_bytes <= 0) break;
+    state = YAP_V2_crc32c_update(state, buffer, (size_t)read_bytes);
+    total += (uint64_t)read_bytes;
+  }
+  if (read_bytes == 0) {
+    *bytes = total;
+    *crc = ~state;
+    status = YAP_V2_OK;
+  }
+  free(buffer);
+  (void)close(fd);
+  return status;
+}
+
 static int read_ann_cache_generation(const char *path, uint64_t *generation) {
   unsigned char encoded[YAP_V2_FILE_HEADER_BYTES];
   YAP_V2_FILE_HEADER header;
@@ -201,7 +220,9 @@ int YAP_V2_ann_corpus_build(const YAP_V2_MANIFEST *manifest,
                             const YAP_V2_ANN_SEGMENT *segments,
                             size_t segment_count, YAP_V2_ANN_CORPUS *corpus) {
   const YAP_V2_VECTOR_SEGMENT *representative = NULL;
-  size_t visible_count = 0U, s, i;
+  uint64_t *keys = NULL;
+  const float **values = NULL;
+  size_t visible_count = 0U, pending = 0U, s, i;
   int status = YAP_V2_OK;
   YAP_V2_ANN_CORPUS built;
   if (manifest == NULL || snapshot == NULL || segments == NULL || corpus == NULL ||
@@ -249,39 +270,205 @@ int YAP_V2_ann_corpus_build(const YAP_V2_MANIFEST *manifest,
                                     YAP_V2_ANN_EXPANSION_ADD, YAP_V2_ANN_EXPANSION_SEARCH,
                                     &built.index);
   if (status != YAP_ANN_OK) { status = YAP_V2_CONFLICT; goto done; }
+  keys = malloc(visible_count * sizeof(*keys));
+  values = malloc(visible_count * sizeof(*values));
+  if (keys == NULL || values == NULL) { status = YAP_V2_ALLOCATION_FAILED; goto done; }
   for (s = 0U; status == YAP_V2_OK && s < segment_count; s++) {
     const YAP_V2_VECTOR_SEGMENT *vectors = segments[s].vectors;
     const YAP_V2_SEGMENT *documents = YAP_V2_snapshot_segment_documents(snapshot, s);
     if (vectors == NULL) continue;
     if (s > UINT32_MAX) { status = YAP_V2_OUT_OF_RANGE; break; }
     for (i = 0U; i < vectors->entry_count; i++) {
-      uint64_t key;
       if (!vector_is_visible(snapshot, s, documents, i)) continue;
       if (i > UINT32_MAX) { status = YAP_V2_OUT_OF_RANGE; break; }
-      key = ((uint64_t)s << 32U) | (uint64_t)i;
-      if (YAP_V2_ann_index_add(&built.index, key, vectors->entries[i].values) != YAP_ANN_OK) {
-        status = YAP_V2_CONFLICT;
-        break;
-      }
+      keys[pending] = ((uint64_t)s << 32U) | (uint64_t)i;
+      values[pending++] = vectors->entries[i].values;
     }
   }
+  if (status == YAP_V2_OK &&
+      YAP_V2_ann_index_add_batch(&built.index, keys, values, pending) != YAP_ANN_OK)
+    status = YAP_V2_CONFLICT;
   if (status != YAP_V2_OK) goto done;
   built.vector_count = visible_count;
 publish:
+  free(keys);
+  free(values);
   YAP_V2_ann_corpus_free(corpus);
   *corpus = built;
   return YAP_V2_OK;
 done:
+  free(keys);
+  free(values);
   YAP_V2_ann_corpus_free(&built);
   return status;
 }
 
+static int segment_visible_count(const YAP_V2_SEARCH_SNAPSHOT *snapshot, size_t segment_ordinal,
+                                 const YAP_V2_VECTOR_SEGMENT *vectors, size_t *visible_count) {
+  const YAP_V2_SEGMENT *documents = YAP_V2_snapshot_segment_documents(snapshot, segment_ordinal);
+  size_t i;
+  if (documents == NULL || vectors->entry_count != documents->passage_count)
+    return YAP_V2_CONFLICT;
+  for (i = 0U; i < vectors->entry_count; i++) {
+    if (!bytes_equal(vectors->entries[i].id, documents->passages[i].id)) return YAP_V2_CONFLICT;
+    if (vector_is_visible(snapshot, segment_ordinal, documents, i)) (*visible_count)++;
+  }
+  return YAP_V2_OK;
+}
+
+static int remove_key(YAP_V2_ANN_INDEX *index, size_t segment_ordinal, size_t passage_ordinal,
+                      size_t *removed_count) {
+  int removed = 0;
+  if (YAP_V2_ann_index_remove(index, ((uint64_t)segment_ordinal << 32U) |
+                                     (uint64_t)passage_ordinal, &removed) != YAP_ANN_OK)
+    return YAP_V2_CONFLICT;
+  if (removed) (*removed_count)++;
+  return YAP_V2_OK;
+}
+
+int YAP_V2_ann_corpus_extend(const YAP_V2_ANN_CORPUS *base,
+                             const YAP_V2_MANIFEST *manifest,
+                             const YAP_V2_SEARCH_SNAPSHOT *snapshot,
+                             const YAP_V2_ANN_SEGMENT *segments,
+                             size_t segment_count, YAP_V2_ANN_CORPUS *corpus) {
+  const YAP_V2_VECTOR_SEGMENT *representative = NULL;
+  YAP_V2_ANN_QUERY_PLAN plan;
+  YAP_V2_ANN_CORPUS built;
+  uint64_t *keys = NULL;
+  const float **values = NULL;
+  size_t added_count = 0U, removed_count = 0U, pending = 0U, total_count, next, s, i;
+  int status;
+  if (base == NULL || manifest == NULL || snapshot == NULL || segments == NULL ||
+      corpus == NULL || base == corpus || base->index_pending || base->segment_count == 0U ||
+      segment_count == 0U ||
+      segment_count != manifest->segment_count ||
+      segment_count != YAP_V2_snapshot_segment_count(snapshot) ||
+      manifest->generation != YAP_V2_snapshot_generation(snapshot))
+    return YAP_V2_INVALID_ARGUMENT;
+  YAP_V2_ann_query_plan_init(&plan);
+  YAP_V2_ann_corpus_init(&built);
+  status = YAP_V2_ann_query_plan_build(base, manifest, &plan);
+  if (status != YAP_V2_OK) return status;
+  if (base->segment_count > YAP_V2_ANN_MAX_CORPUS_SEGMENTS ||
+      plan.delta_segment_count > YAP_V2_ANN_MAX_CORPUS_SEGMENTS - base->segment_count) {
+    status = YAP_V2_OUT_OF_RANGE;
+    goto done;
+  }
+  total_count = base->segment_count + plan.delta_segment_count;
+  for (s = 0U; status == YAP_V2_OK && s < segment_count; s++) {
+    const YAP_V2_VECTOR_SEGMENT *vectors = segments[s].vectors;
+    if (!plan.current_is_delta[s] || vectors == NULL || vectors->entry_count == 0U) continue;
+    if (vectors->entry_count - 1U > UINT32_MAX) { status = YAP_V2_OUT_OF_RANGE; break; }
+    if (representative == NULL) representative = vectors;
+    status = segment_visible_count(snapshot, s, vectors, &added_count);
+  }
+  if (status != YAP_V2_OK) goto done;
+  built.segments = calloc(total_count, sizeof(*built.segments));
+  built.segment_fingerprints = malloc(total_count * sizeof(*built.segment_fingerprints));
+  keys = malloc((added_count > 0U ? added_count : 1U) * sizeof(*keys));
+  values = malloc((added_count > 0U ? added_count : 1U) * sizeof(*values));
+  if (built.segments == NULL || built.segment_fingerprints == NULL || keys == NULL ||
+      values == NULL) {
+    status = YAP_V2_ALLOCATION_FAILED;
+    goto done;
+  }
+  memcpy(built.segments, base->segments, base->segment_count * sizeof(*built.segments));
+  memcpy(built.segment_fingerprints, base->segment_fingerprints,
+         base->segment_count * sizeof(*built.segment_fingerprints));
+  for (s = 0U, next = base->segment_count; s < segment_count; s++) {
+    if (!plan.current_is_delta[s]) continue;
+    built.segments[next] = manifest->segments[s];
+    built.segment_fingerprints[next++] = descriptor_fingerprint(&manifest->segments[s]);
+  }
+  built.segment_count = total_count;
+  built.generation = manifest->generation;
+  if (base->index.index != NULL) {
+    if (representative != NULL &&
+        (representative->metric != base->index.metric ||
+         representative->dimensions != base->index.dimensions)) {
+      status = YAP_V2_CONFLICT;
+      goto done;
+    }
+    if (YAP_V2_ann_index_clone(&base->index, base->index.entry_count + added_count,
+                               YAP_V2_ANN_EXPANSION_ADD, YAP_V2_ANN_EXPANSION_SEARCH,
+                               &built.index) != YAP_ANN_OK) {
+      status = YAP_V2_CONFLICT;
+      goto done;
+    }
+  } else if (added_count > 0U &&
+             YAP_V2_ann_index_create(representative->metric, representative->dimensions,
+                                     added_count, YAP_V2_ANN_CONNECTIVITY,
+                                     YAP_V2_ANN_EXPANSION_ADD, YAP_V2_ANN_EXPANSION_SEARCH,
+                                     &built.index) != YAP_ANN_OK) {
+    status = YAP_V2_CONFLICT;
+    goto done;
+  }
+  for (s = 0U; status == YAP_V2_OK && s < base->segment_count; s++) {
+    size_t current = plan.base_to_current[s];
+    const YAP_V2_SEGMENT *documents;
+    if (built.segments[s].id[0] == '\0') continue;
+    if (current == SIZE_MAX) {
+      for (i = 0U; built.index.index != NULL && status == YAP_V2_OK &&
+                   i < built.segments[s].passage_count; i++)
+        status = remove_key(&built.index, s, i, &removed_count);
+      memset(&built.segments[s], 0, sizeof(built.segments[s]));
+      built.segment_fingerprints[s] = 0U;
+      continue;
+    }
+    documents = YAP_V2_snapshot_segment_documents(snapshot, current);
+    if (documents == NULL) { status = YAP_V2_CONFLICT; break; }
+    for (i = 0U; built.index.index != NULL && status == YAP_V2_OK &&
+                 i < documents->passage_count; i++)
+      if (!vector_is_visible(snapshot, current, documents, i))
+        status = remove_key(&built.index, s, i, &removed_count);
+  }
+  for (s = 0U, next = base->segment_count; status == YAP_V2_OK && s < segment_count; s++) {
+    const YAP_V2_VECTOR_SEGMENT *vectors = segments[s].vectors;
+    const YAP_V2_SEGMENT *documents = YAP_V2_snapshot_segment_documents(snapshot, s);
+    size_t ordinal;
+    if (!plan.current_is_delta[s]) continue;
+    ordinal = next++;
+    if (vectors == NULL) continue;
+    for (i = 0U; i < vectors->entry_count; i++) {
+      if (!vector_is_visible(snapshot, s, documents, i)) continue;
+      keys[pending] = ((uint64_t)ordinal << 32U) | (uint64_t)i;
+      values[pending++] = vectors->entries[i].values;
+    }
+  }
+  if (status == YAP_V2_OK && pending > 0U &&
+      YAP_V2_ann_index_add_batch(&built.index, keys, values, pending) != YAP_ANN_OK)
+    status = YAP_V2_CONFLICT;
+  if (status != YAP_V2_OK) goto done;
+  built.vector_count = built.index.entry_count;
+  built.removed_vector_count = base->removed_vector_count + removed_count;
+  YAP_V2_ann_corpus_free(corpus);
+  *corpus = built;
+  YAP_V2_ann_corpus_init(&built);
+done:
+  free(keys);
+  free(values);
+  YAP_V2_ann_corpus_free(&built);
+  YAP_V2_ann_query_plan_free(&plan);
+  return status;
+}
+
+/* Incremental updates leave removed graph nodes and retired segment ordinals behind; a full
+ * build compacts both once they outweigh the live part. */
+int YAP_V2_ann_corpus_needs_rebuild(const YAP_V2_ANN_CORPUS *corpus) {
+  size_t retired = 0U, i;
+  if (corpus == NULL || corpus->index.index == NULL || corpus->segment_count == 0U) return 1;
+  for (i = 0U; i < corpus->segment_count; i++)
+    if (corpus->segments[i].id[0] == '\0') retired++;
+  return corpus->removed_vector_count > corpus->vector_count / YAP_V2_ANN_DEFRAGMENT_DIVISOR ||
+         retired > corpus->segment_count - retired;
+}
+
 int YAP_V2_ann_corpus_search(const YAP_V2_ANN_CORPUS *corpus, const float *query,
                              size_t dimensions, size_t top_k, uint64_t *keys,
                              size_t key_capacity, size_t *key_count) {
   if (corpus == NULL || query == NULL || keys == NULL || key_count == NULL || top_k == 0U)
     return YAP_V2_INVALID_ARGUMENT;
-  if (corpus->vector_count == 0U) { *key_count = 0U; return YAP_V2_OK; }
+  if (corpus->vector_count == 0U || corpus->index_pending) { *key_count = 0U; return YAP_V2_OK; }
   return YAP_V2_ann_index_search(&corpus->index, query, dimensions, top_k,
                                  keys, key_capacity, key_count);
 }
@@ -289,11 +476,11 @@ int YAP_V2_ann_corpus_search(const YAP_V2_ANN_CORPUS *corpus, const float *query
 int YAP_V2_ann_corpus_save_cache(const char *index_dir,
                                  const YAP_V2_ANN_CORPUS *corpus) {
   unsigned char *file_data = NULL, *payload;
-  unsigned char ann_checksum[32];
+  uint32_t ann_crc = 0U;
   YAP_V2_FILE_HEADER header;
   char ann_path[4096], ann_tmp[4096], meta_path[4096], meta_tmp[4096], lock_path[4096];
   uint64_t ann_bytes = 0U;
-  size_t payload_bytes = 64U, file_bytes, offset = 0U, i;
+  size_t payload_bytes = YAP_V2_ANN_CACHE_FIXED_BYTES, file_bytes, offset = 0U, i;
   int lock_fd = -1;
   int status = YAP_V2_IO_ERROR;
   if (index_dir == NULL || corpus == NULL || corpus->index.index == NULL ||
@@ -302,9 +489,9 @@ int YAP_V2_ann_corpus_save_cache(const char *index_dir,
     return YAP_V2_INVALID_ARGUMENT;
   for (i = 0U; i < corpus->segment_count; i++) {
     size_t id_bytes = strlen(corpus->segments[i].id);
-    if (id_bytes == 0U || id_bytes > YAP_V2_MAX_IDENTIFIER_BYTES ||
-        payload_bytes > SIZE_MAX - 12U - id_bytes) return YAP_V2_OUT_OF_RANGE;
-    payload_bytes += 12U + id_bytes;
+    if (id_bytes > YAP_V2_MAX_IDENTIFIER_BYTES ||
+        payload_bytes > SIZE_MAX - 20U - id_bytes) return YAP_V2_OUT_OF_RANGE;
+    payload_bytes += 20U + id_bytes;
   }
   if (payload_bytes > YAP_V2_MAX_MANIFEST_BYTES - YAP_V2_FILE_HEADER_BYTES ||
       join_path(ann_path, sizeof(ann_path), index_dir, YAP_V2_ANN_CACHE_INDEX_NAME) != 0 ||
@@ -323,7 +510,7 @@ int YAP_V2_ann_corpus_save_cache(const char *index_dir,
   (void)unlink(ann_tmp); (void)unlink(meta_tmp);
   if (YAP_V2_ann_index_save(&corpus->index, ann_tmp) != YAP_ANN_OK ||
       sync_file(ann_tmp) != 0 ||
-      YAP_V2_file_sha256(ann_tmp, ann_checksum, &ann_bytes) != YAP_V2_OK) goto done;
+      ann_file_crc32c(ann_tmp, &ann_bytes, &ann_crc) != YAP_V2_OK) goto done;
   if (payload_bytes > SIZE_MAX - YAP_V2_FILE_HEADER_BYTES) { status = YAP_V2_OUT_OF_RANGE; goto done; }
   file_bytes = YAP_V2_FILE_HEADER_BYTES + payload_bytes;
   file_data = calloc(1U, file_bytes);
@@ -335,11 +522,13 @@ int YAP_V2_ann_corpus_save_cache(const char *index_dir,
   put_u32_le(payload + offset, (uint32_t)corpus->segment_count); offset += 4U;
   put_u64_le(payload + offset, corpus->vector_count); offset += 8U;
   put_u64_le(payload + offset, ann_bytes); offset += 8U;
-  memcpy(payload + offset, ann_checksum, sizeof(ann_checksum)); offset += sizeof(ann_checksum);
+  put_u64_le(payload + offset, corpus->removed_vector_count); offset += 8U;
+  put_u32_le(payload + offset, ann_crc); offset += 4U;
   for (i = 0U; i < corpus->segment_count; i++) {
     size_t id_bytes = strlen(corpus->segments[i].id);
     put_u32_le(payload + offset, (uint32_t)id_bytes); offset += 4U;
     memcpy(payload + offset, corpus->segments[i].id, id_bytes); offset += id_bytes;
+    put_u64_le(payload + offset, corpus->segments[i].passage_count); offset += 8U;
     put_u64_le(payload + offset, corpus->segment_fingerprints[i]); offset += 8U;
   }
   if (offset != payload_bytes) { status = YAP_V2_CONFLICT; goto done; }
@@ -349,7 +538,7 @@ int YAP_V2_ann_corpus_save_cache(const char *index_dir,
   header.file_type = YAP_V2_FILE_ANN_BASE;
   header.generation = corpus->generation;
   header.payload_bytes = payload_bytes;
-  header.payload_crc32c = crc32c(payload, payload_bytes);
+  header.payload_crc32c = YAP_V2_crc32c(payload, payload_bytes);
   status = YAP_V2_file_header_encode(&header, file_data);
   if (status != YAP_V2_OK || write_file(meta_tmp, file_data, file_bytes) != 0) {
     status = YAP_V2_IO_ERROR; goto done;
@@ -378,18 +567,19 @@ done:
   return status;
 }
 
-int YAP_V2_ann_corpus_load_cache(const char *index_dir,
-                                 const YAP_V2_CONFIG *config,
-                                 const YAP_V2_MANIFEST *manifest,
-                                 YAP_V2_ANN_CORPUS *corpus) {
-  unsigned char *file_data = NULL, *payload, checksum[32];
+/* Without verify only the metadata and the graph's size are checked and the graph is left
+ * unmapped, so a mid-file corruption cannot reach USearch before its CRC32C has been compared. */
+static int load_cache(const char *index_dir, const YAP_V2_CONFIG *config,
+                      const YAP_V2_MANIFEST *manifest, int verify,
+                      YAP_V2_ANN_CORPUS *corpus) {
+  unsigned char *file_data = NULL, *payload;
   YAP_V2_FILE_HEADER header;
   YAP_V2_ANN_CORPUS loaded;
   char ann_path[4096], meta_path[4096];
-  uint64_t ann_bytes, actual_ann_bytes;
+  uint64_t ann_bytes, actual_ann_bytes = 0U;
   size_t file_bytes = 0U, payload_bytes, offset = 0U, i;
-  uint32_t dimensions, metric, segment_count;
-  uint64_t vector_count;
+  uint32_t dimensions, metric, segment_count, ann_crc, actual_ann_crc = 0U;
+  uint64_t vector_count, removed_vector_count;
   int status;
   if (index_dir == NULL || config == NULL || manifest == NULL || corpus == NULL)
     return YAP_V2_INVALID_ARGUMENT;
@@ -399,7 +589,7 @@ int YAP_V2_ann_corpus_load_cache(const char *index_dir,
   status = read_file(meta_path, &file_data, &file_bytes);
   if (status != YAP_V2_OK) return status;
   YAP_V2_ann_corpus_init(&loaded);
-  if (file_bytes < YAP_V2_FILE_HEADER_BYTES + 64U ||
+  if (file_bytes < YAP_V2_FILE_HEADER_BYTES + YAP_V2_ANN_CACHE_FIXED_BYTES ||
       YAP_V2_file_header_decode(file_data, &header) != YAP_V2_OK ||
       header.file_type != YAP_V2_FILE_ANN_BASE || header.generation > manifest->generation ||
       header.payload_bytes != file_bytes - YAP_V2_FILE_HEADER_BYTES) {
@@ -407,7 +597,7 @@ int YAP_V2_ann_corpus_load_cache(const char *index_dir,
   }
   payload = file_data + YAP_V2_FILE_HEADER_BYTES;
   payload_bytes = (size_t)header.payload_bytes;
-  if (crc32c(payload, payload_bytes) != header.payload_crc32c ||
+  if (YAP_V2_crc32c(payload, payload_bytes) != header.payload_crc32c ||
       get_u32_le(payload) != YAP_V2_ANN_CACHE_PAYLOAD_VERSION) {
     status = YAP_V2_CHECKSUM_MISMATCH; goto done;
   }
@@ -417,10 +607,11 @@ int YAP_V2_ann_corpus_load_cache(const char *index_dir,
   segment_count = get_u32_le(payload + offset); offset += 4U;
   vector_count = get_u64_le(payload + offset); offset += 8U;
   ann_bytes = get_u64_le(payload + offset); offset += 8U;
-  memcpy(checksum, payload + offset, sizeof(checksum)); offset += sizeof(checksum);
+  removed_vector_count = get_u64_le(payload + offset); offset += 8U;
+  ann_crc = get_u32_le(payload + offset); offset += 4U;
   if (dimensions != config->vector_dimensions || metric != (uint32_t)config->vector_metric ||
-      segment_count == 0U || segment_count > YAP_V2_MAX_SEGMENTS || vector_count == 0U ||
-      vector_count > SIZE_MAX) {
+      segment_count == 0U || segment_count > YAP_V2_ANN_MAX_CORPUS_SEGMENTS ||
+      vector_count == 0U || vector_count > SIZE_MAX || removed_vector_count > SIZE_MAX) {
     status = YAP_V2_CONFLICT; goto done;
   }
   loaded.segments = calloc(segment_count, sizeof(*loaded.segments));
@@ -434,32 +625,40 @@ int YAP_V2_ann_corpus_load_cache(const char *index_dir,
       status = YAP_V2_INVALID_FORMAT; goto done;
     }
     id_bytes = get_u32_le(payload + offset); offset += 4U;
-    if (id_bytes == 0U || id_bytes > YAP_V2_MAX_IDENTIFIER_BYTES ||
-        payload_bytes - offset < (size_t)id_bytes + 8U) {
+    if (id_bytes > YAP_V2_MAX_IDENTIFIER_BYTES ||
+        payload_bytes - offset < (size_t)id_bytes + 16U) {
       status = YAP_V2_INVALID_FORMAT; goto done;
     }
     memcpy(loaded.segments[i].id, payload + offset, id_bytes);
     loaded.segments[i].id[id_bytes] = '\0'; offset += id_bytes;
-    if (YAP_V2_segment_id_validate(loaded.segments[i].id) != YAP_V2_OK) {
+    if (id_bytes > 0U && YAP_V2_segment_id_validate(loaded.segments[i].id) != YAP_V2_OK) {
       status = YAP_V2_INVALID_FORMAT; goto done;
     }
+    loaded.segments[i].passage_count = get_u64_le(payload + offset); offset += 8U;
     loaded.segment_fingerprints[i] = get_u64_le(payload + offset); offset += 8U;
   }
   if (offset != payload_bytes) { status = YAP_V2_INVALID_FORMAT; goto done; }
-  {
-    unsigned char actual_checksum[32];
-    if (YAP_V2_file_sha256(ann_path, actual_checksum, &actual_ann_bytes) != YAP_V2_OK ||
-        actual_ann_bytes != ann_bytes || memcmp(actual_checksum, checksum, sizeof(checksum)) != 0) {
+  if (verify) {
+    if (ann_file_crc32c(ann_path, &actual_ann_bytes, &actual_ann_crc) != YAP_V2_OK ||
+        actual_ann_bytes != ann_bytes || actual_ann_crc != ann_crc) {
       status = YAP_V2_CHECKSUM_MISMATCH; goto done;
     }
-  }
-  if (YAP_V2_ann_index_view(ann_path, config->vector_metric, config->vector_dimensions,
-                            (size_t)vector_count, YAP_V2_ANN_EXPANSION_SEARCH,
-                            &loaded.index) != YAP_ANN_OK) {
-    status = YAP_V2_CONFLICT; goto done;
+    if (YAP_V2_ann_index_view(ann_path, config->vector_metric, config->vector_dimensions,
+                              (size_t)vector_count, YAP_V2_ANN_EXPANSION_SEARCH,
+                              &loaded.index) != YAP_ANN_OK) {
+      status = YAP_V2_CONFLICT; goto done;
+    }
+  } else {
+    struct stat info;
+    if (stat(ann_path, &info) != 0 || info.st_size < 0 ||
+        (uint64_t)info.st_size != ann_bytes) {
+      status = YAP_V2_CHECKSUM_MISMATCH; goto done;
+    }
+    loaded.index_pending = 1;
   }
   loaded.segment_count = segment_count;
   loaded.vector_count = (size_t)vector_count;
+  loaded.removed_vector_count = (size_t)removed_vector_count;
   loaded.generation = header.generation;
   YAP_V2_ann_corpus_free(corpus);
   *corpus = loaded;
@@ -471,6 +670,20 @@ done:
   return status;
 }
 
+int YAP_V2_ann_corpus_load_cache(const char *index_dir,
+                                 const YAP_V2_CONFIG *config,
+                                 const YAP_V2_MANIFEST *manifest,
+                                 YAP_V2_ANN_CORPUS *corpus) {
+  return load_cache(index_dir, config, manifest, 1, corpus);
+}
+
+int YAP_V2_ann_corpus_load_cache_deferred(const char *index_dir,
+                                          const YAP_V2_CONFIG *config,
+                                          const YAP_V2_MANIFEST *manifest,
+                                          YAP_V2_ANN_CORPUS *corpus) {
+  return load_cache(index_dir, config, manifest, 0, corpus);
+}
+
 void YAP_V2_ann_query_plan_init(YAP_V2_ANN_QUERY_PLAN *plan) {
   if (plan != NULL) memset(plan, 0, sizeof(*plan));
 }
@@ -504,9 +717,10 @@ int YAP_V2_ann_query_plan_build(const YAP_V2_ANN_CORPUS *corpus,
   for (i = 0U; i < capacity; i++) slots[i] = SIZE_MAX;
   for (i = 0U; i < corpus->segment_count; i++) {
     size_t slot = (size_t)(string_hash(corpus->segments[i].id) & (uint64_t)(capacity - 1U));
+    built.base_to_current[i] = SIZE_MAX;
+    if (corpus->segments[i].id[0] == '\0') continue;
     while (slots[slot] != SIZE_MAX) slot = (slot + 1U) & (capacity - 1U);
     slots[slot] = i;
-    built.base_to_current[i] = SIZE_MAX;
   }
   for (i = 0U; i < manifest->segment_count; i++) {
     size_t slot = (size_t)(string_hash(manifest->segments[i].id) & (uint64_t)(capacity - 1U));
@@ -532,9 +746,11 @@ int YAP_V2_ann_query_plan_build(const YAP_V2_ANN_CORPUS *corpus,
   }
   free(slots);
   for (i = 0U; i < corpus->segment_count; i++)
-    if (built.base_to_current[i] == SIZE_MAX) built.missing_base_segment_count++;
+    if (built.base_to_current[i] == SIZE_MAX && corpus->segments[i].id[0] != '\0')
+      built.missing_base_segment_count++;
   built.base_segment_count = corpus->segment_count;
   built.current_segment_count = manifest->segment_count;
+  built.base_pending = corpus->index_pending;
   YAP_V2_ann_query_plan_free(plan);
   *plan = built;
   return YAP_V2_OK;
@@ -5,13 +5,19 @@
 #include "storage/yappo_manifest_v2.h"
 #include "storage/yappo_snapshot_v2.h"
 
+/* Keys are (corpus segment ordinal << 32) | passage ordinal. An incrementally extended corpus
+ * keeps the ordinals of segments that left the manifest as retired entries with an empty id,
+ * and counts the keys it removed since the last full build in removed_vector_count.
+ * index_pending marks a corpus read by load_cache_deferred whose graph is not mapped yet. */
 typedef struct {
   YAP_V2_ANN_INDEX index;
   YAP_V2_SEGMENT_DESCRIPTOR *segments;
   uint64_t *segment_fingerprints;
   size_t segment_count;
   size_t vector_count;
+  size_t removed_vector_count;
   uint64_t generation;
+  int index_pending;
 } YAP_V2_ANN_CORPUS;
 
 typedef struct {
@@ -21,6 +27,8 @@ typedef struct {
   size_t current_segment_count;
   size_t delta_segment_count;
   size_t missing_base_segment_count;
+  /* The base graph is not mapped yet, so every segment is searched on its own. */
+  int base_pending;
 } YAP_V2_ANN_QUERY_PLAN;
 
 void YAP_V2_ann_corpus_init(YAP_V2_ANN_CORPUS *corpus);
@@ -29,15 +37,32 @@ int YAP_V2_ann_corpus_build(const YAP_V2_MANIFEST *manifest,
                             const YAP_V2_SEARCH_SNAPSHOT *snapshot,
                             const YAP_V2_ANN_SEGMENT *segments,
                             size_t segment_count, YAP_V2_ANN_CORPUS *corpus);
+/* Builds a corpus for the manifest from a copy of base: keys of retired base segments and of
+ * passages that are no longer visible are removed, and visible vectors of segments that are
+ * not in base are inserted. base is only read. */
+int YAP_V2_ann_corpus_extend(const YAP_V2_ANN_CORPUS *base,
+                             const YAP_V2_MANIFEST *manifest,
+                             const YAP_V2_SEARCH_SNAPSHOT *snapshot,
+                             const YAP_V2_ANN_SEGMENT *segments,
+                             size_t segment_count, YAP_V2_ANN_CORPUS *corpus);
+int YAP_V2_ann_corpus_needs_rebuild(const YAP_V2_ANN_CORPUS *corpus);
 int YAP_V2_ann_corpus_search(const YAP_V2_ANN_CORPUS *corpus, const float *query,
                              size_t dimensions, size_t top_k, uint64_t *keys,
                              size_t key_capacity, size_t *key_count);
 int YAP_V2_ann_corpus_save_cache(const char *index_dir,
                                  const YAP_V2_ANN_CORPUS *corpus);
+/* Compares the CRC32C of the whole ann-base.usearch before mapping it, so the cost grows with
+ * the graph. */
 int YAP_V2_ann_corpus_load_cache(const char *index_dir,
                                  const YAP_V2_CONFIG *config,
                                  const YAP_V2_MANIFEST *manifest,
                                  YAP_V2_ANN_CORPUS *corpus);
+/* Reads only the metadata and leaves the graph unmapped with index_pending set. The corpus
+ * plans queries but serves no base search until load_cache replaces it. */
+int YAP_V2_ann_corpus_load_cache_deferred(const char *index_dir,
+                                          const YAP_V2_CONFIG *config,
+                                          const YAP_V2_MANIFEST *manifest,
+                                          YAP_V2_ANN_CORPUS *corpus);
 void YAP_V2_ann_query_plan_init(YAP_V2_ANN_QUERY_PLAN *plan);
 void YAP_V2_ann_query_plan_free(YAP_V2_ANN_QUERY_PLAN *plan);
 int YAP_V2_ann_query_plan_build(const YAP_V2_ANN_CORPUS *corpus,
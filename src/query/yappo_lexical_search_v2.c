@@ -1,7 +1,9 @@
 #include "query/yappo_lexical_search_v2.h"
 
 #include "query/yappo_bm25.h"
+#include "query/yappo_phrase_v2.h"
 #include "common/yappo_unicode.h"
+#include "components/yappo_term_filter_v2.h"
 
 #include <math.h>
 #include <stdlib.h>
@@ -14,6 +16,8 @@ typedef struct {
   size_t index;
   uint64_t type_frequency[2];
   YAP_V2_POSTING_ITERATOR blocks;
+  YAP_V2_POSITION *positions;
+  size_t position_capacity;
 } TERM_STATE;
 
 static uint64_t posting_key(const YAP_V2_POSTING *posting) {
@@ -130,42 +134,43 @@ static void state_advance_to(TERM_STATE *state, uint64_t key, uint32_t object_ty
   } while (state->index < state->count && posting_key(&state->postings[state->index]) < key);
 }
 
+static int state_positions(const YAP_V2_LEXICAL_SEGMENT *segment, TERM_STATE *state) {
+  const YAP_V2_POSTING *posting = &state->postings[state->index];
+  if (posting->position_count > state->position_capacity) {
+    YAP_V2_POSITION *positions = (YAP_V2_POSITION *)realloc(
+      state->positions, (size_t)posting->position_count * sizeof(*positions));
+    if (positions == NULL)
+      return YAP_V2_ALLOCATION_FAILED;
+    state->positions = positions;
+    state->position_capacity = posting->position_count;
+  }
+  return YAP_V2_posting_positions_read(segment, state->term, posting, state->positions);
+}
+
+/* Decodes each distinct term's positions once; repeated tokens share them. */
 static int phrase_matches(const YAP_V2_LEXICAL_SEGMENT *segment, TERM_STATE *states,
-                          const YAP_V2_LEXICAL_QUERY_PLAN *plan, uint64_t key) {
-  const YAP_V2_POSTING *first = NULL;
-  size_t first_state = plan->token_terms[0];
+                          YAP_V2_PHRASE_TOKEN *tokens, const YAP_V2_LEXICAL_QUERY_PLAN *plan,
+                          uint64_t key, uint32_t slop, int *matches) {
   size_t i;
+  int status;
+  *matches = 0;
   for (i = 0U; i < plan->tokens.token_count; i++) {
     TERM_STATE *state = &states[plan->token_terms[i]];
     if (state->index >= state->count || posting_key(&state->postings[state->index]) != key)
-      return 0;
+      return YAP_V2_OK;
   }
-  first = &states[first_state].postings[states[first_state].index];
-  for (i = 0U; i < first->position_count; i++) {
-    YAP_V2_POSITION base;
-    size_t q;
-    int matched = 1;
-    if (YAP_V2_posting_position_at(segment, states[first_state].term, first, i, &base) != YAP_V2_OK)
-      return 0;
-    for (q = 1U; q < plan->tokens.token_count && matched; q++) {
-      TERM_STATE *state = &states[plan->token_terms[q]];
-      const YAP_V2_POSTING *posting = &state->postings[state->index];
-      size_t p;
-      matched = 0;
-      for (p = 0U; p < posting->position_count; p++) {
-        YAP_V2_POSITION position;
-        if (YAP_V2_posting_position_at(segment, state->term, posting, p, &position) != YAP_V2_OK)
-          return 0;
-        if (position.field == base.field && position.position == base.position + q) {
-          matched = 1;
-          break;
-        }
-      }
-    }
-    if (matched)
-      return 1;
+  for (i = 0U; i < plan->term_count; i++) {
+    status = state_positions(segment, &states[i]);
+    if (status != YAP_V2_OK)
+      return status;
   }
-  return 0;
+  for (i = 0U; i < plan->tokens.token_count; i++) {
+    TERM_STATE *state = &states[plan->token_terms[i]];
+    tokens[i].positions = state->positions;
+    tokens[i].count = state->postings[state->index].position_count;
+    tokens[i].offset = (uint32_t)i;
+  }
+  return YAP_V2_phrase_match(tokens, plan->tokens.token_count, slop, matches);
 }
 
 static double hit_threshold(const YAP_V2_LEXICAL_HIT *hits, size_t count, size_t top_k) {
@@ -216,8 +221,10 @@ void YAP_V2_lexical_query_plan_free(YAP_V2_LEXICAL_QUERY_PLAN *plan) {
     return;
   free(plan->terms);
   free(plan->token_terms);
+  free(plan->expansion_bytes);
   free(plan->segments);
   free(plan->segment_terms);
+  free(plan->segment_matched_terms);
   free(plan->type_frequency[0]);
   free(plan->type_frequency[1]);
   YAP_V2_token_sequence_free(&plan->tokens);
@@ -268,7 +275,7 @@ static int query_plan_valid(const YAP_V2_LEXICAL_QUERY_PLAN *plan) {
   if (plan->tokens.token_count == 0U)
     return plan->term_count == 0U;
   if (plan->terms == NULL || plan->token_terms == NULL || plan->term_count == 0U ||
-      plan->term_count > plan->tokens.token_count)
+      (plan->expansion_bytes == NULL && plan->term_count > plan->tokens.token_count))
     return 0;
   for (i = 0U; i < plan->term_count; i++)
     if (plan->terms[i].data == NULL || plan->terms[i].len == 0U)
@@ -279,25 +286,101 @@ static int query_plan_valid(const YAP_V2_LEXICAL_QUERY_PLAN *plan) {
   return 1;
 }
 
+int YAP_V2_lexical_query_plan_expand(YAP_V2_LEXICAL_QUERY_PLAN *plan,
+                                     const YAP_V2_BYTES_VIEW *terms, size_t count) {
+  YAP_V2_BYTES_VIEW *grown;
+  unsigned char *bytes;
+  size_t total = 0U, used = 0U, i;
+  if (plan == NULL || !query_plan_valid(plan) || plan->expansion_bytes != NULL ||
+      plan->segments != NULL || (terms == NULL && count > 0U))
+    return YAP_V2_INVALID_ARGUMENT;
+  if (count == 0U || plan->tokens.token_count == 0U)
+    return YAP_V2_OK;
+  for (i = 0U; i < count; i++) {
+    if (terms[i].data == NULL || terms[i].len == 0U || terms[i].len > SIZE_MAX - total)
+      return YAP_V2_INVALID_ARGUMENT;
+    total += terms[i].len;
+  }
+  if (count > SIZE_MAX / sizeof(*grown) - plan->term_count)
+    return YAP_V2_OUT_OF_RANGE;
+  grown = (YAP_V2_BYTES_VIEW *)realloc(plan->terms,
+                                       (plan->term_count + count) * sizeof(*grown));
+  if (grown == NULL)
+    return YAP_V2_ALLOCATION_FAILED;
+  plan->terms = grown;
+  bytes = (unsigned char *)malloc(total);
+  if (bytes == NULL)
+    return YAP_V2_ALLOCATION_FAILED;
+  for (i = 0U; i < count; i++) {
+    size_t existing;
+    for (existing = 0U; existing < plan->term_count; existing++)
+      if (plan->terms[existing].len == terms[i].len &&
+          memcmp(plan->terms[existing].data, terms[i].data, terms[i].len) == 0)
+        break;
+    if (existing < plan->term_count)
+      continue;
+    memcpy(bytes + used, terms[i].data, terms[i].len);
+    plan->terms[plan->term_count].data = bytes + used;
+    plan->terms[plan->term_count].len = terms[i].len;
+    plan->term_count++;
+    used += terms[i].len;
+  }
+  plan->expansion_bytes = bytes;
+  return YAP_V2_OK;
+}
+
 static void query_plan_bindings_free(YAP_V2_LEXICAL_QUERY_PLAN *plan) {
   free(plan->segments);
   free(plan->segment_terms);
+  free(plan->segment_matched_terms);
   free(plan->type_frequency[0]);
   free(plan->type_frequency[1]);
   plan->segments = NULL;
   plan->segment_terms = NULL;
+  plan->segment_matched_terms = NULL;
   plan->type_frequency[0] = NULL;
   plan->type_frequency[1] = NULL;
   plan->segment_count = 0U;
 }
 
+#define TERM_CACHED 1U
+#define TERM_CACHED_ABSENT 2U
+
+/* Stores the sums of the terms the cache did not hold, once they cover its segments. */
+static void term_stats_store(const YAP_V2_LEXICAL_QUERY_PLAN *plan,
+                             const YAP_V2_TERM_STATS_SOURCE *term_stats,
+                             const unsigned char *cached) {
+  size_t term_index;
+  for (term_index = 0U; term_index < plan->term_count; term_index++)
+    if (!cached[term_index]) {
+      uint64_t frequency[2];
+      frequency[0] = plan->type_frequency[0][term_index];
+      frequency[1] = plan->type_frequency[1][term_index];
+      term_stats->store(term_stats->context, plan->terms[term_index], frequency);
+    }
+}
+
 int YAP_V2_lexical_query_plan_bind(YAP_V2_LEXICAL_QUERY_PLAN *plan,
                                    const YAP_V2_LEXICAL_SEGMENT *const *segments,
                                    size_t segment_count) {
-  size_t s, term_index, slots;
+  return YAP_V2_lexical_query_plan_bind_cached(plan, segments, segment_count, NULL);
+}
+
+int YAP_V2_lexical_query_plan_bind_cached(YAP_V2_LEXICAL_QUERY_PLAN *plan,
+                                          const YAP_V2_LEXICAL_SEGMENT *const *segments,
+                                          size_t segment_count,
+                                          const YAP_V2_TERM_STATS_SOURCE *term_stats) {
+  uint64_t *hashes = NULL;
+  unsigned char *cached = NULL;
+  size_t s, term_index, slots, covered;
   int status = YAP_V2_OK;
   if (plan == NULL || !query_plan_valid(plan) || segments == NULL || segment_count == 0U)
     return YAP_V2_INVALID_ARGUMENT;
+  /* A source describing more segments than these belongs to another snapshot. */
+  if (term_stats != NULL &&
+      (term_stats->segment_count == 0U || term_stats->segment_count > segment_count))
+    term_stats = NULL;
+  covered = term_stats == NULL ? 0U : term_stats->segment_count;
   query_plan_bindings_free(plan);
   if (plan->term_count == 0U) {
     plan->segments = (const YAP_V2_LEXICAL_SEGMENT **)calloc(segment_count,
@@ -314,32 +397,64 @@ int YAP_V2_lexical_query_plan_bind(YAP_V2_LEXICAL_QUERY_PLAN *plan,
   slots = segment_count * plan->term_count;
   plan->segments = (const YAP_V2_LEXICAL_SEGMENT **)calloc(segment_count,
                                                            sizeof(*plan->segments));
-  plan->segment_terms = (const YAP_V2_TERM_ENTRY **)calloc(slots,
-                                                           sizeof(*plan->segment_terms));
+  plan->segment_terms = (YAP_V2_TERM_ENTRY *)calloc(slots, sizeof(*plan->segment_terms));
+  plan->segment_matched_terms = (size_t *)calloc(segment_count,
+                                                 sizeof(*plan->segment_matched_terms));
   plan->type_frequency[0] = (uint64_t *)calloc(plan->term_count,
                                                sizeof(*plan->type_frequency[0]));
   plan->type_frequency[1] = (uint64_t *)calloc(plan->term_count,
                                                sizeof(*plan->type_frequency[1]));
+  hashes = (uint64_t *)calloc(plan->term_count, sizeof(*hashes));
+  cached = (unsigned char *)calloc(plan->term_count, sizeof(*cached));
   if (plan->segments == NULL || plan->segment_terms == NULL ||
-      plan->type_frequency[0] == NULL || plan->type_frequency[1] == NULL) {
+      plan->segment_matched_terms == NULL || plan->type_frequency[0] == NULL ||
+      plan->type_frequency[1] == NULL || hashes == NULL || cached == NULL) {
+    free(hashes);
+    free(cached);
     query_plan_bindings_free(plan);
     return YAP_V2_ALLOCATION_FAILED;
   }
+  /* Cached sums replace the additions over the covered segments, and a term they count in no
+   * document or passage is not probed there at all. */
+  for (term_index = 0U; term_stats != NULL && term_index < plan->term_count; term_index++) {
+    uint64_t frequency[2];
+    if (term_stats->lookup(term_stats->context, plan->terms[term_index], frequency) ==
+        YAP_V2_OK) {
+      plan->type_frequency[0][term_index] = frequency[0];
+      plan->type_frequency[1][term_index] = frequency[1];
+      cached[term_index] =
+          frequency[0] == 0U && frequency[1] == 0U ? TERM_CACHED_ABSENT : TERM_CACHED;
+    }
+  }
+  /* Hashed once, so a term absent from a segment costs one filter probe there. */
+  for (term_index = 0U; term_index < plan->term_count; term_index++)
+    hashes[term_index] = YAP_V2_term_filter_hash(plan->terms[term_index].data,
+                                                 plan->terms[term_index].len);
   plan->segment_count = segment_count;
   for (s = 0U; status == YAP_V2_OK && s < segment_count; s++) {
+    if (s == covered && term_stats != NULL)
+      term_stats_store(plan, term_stats, cached);
     plan->segments[s] = segments[s];
     if (segments[s] == NULL)
       continue;
     for (term_index = 0U; status == YAP_V2_OK && term_index < plan->term_count;
          term_index++) {
-      const YAP_V2_TERM_ENTRY *term = YAP_V2_lexical_term_find(segments[s],
-                                                               plan->terms[term_index]);
+      YAP_V2_TERM_ENTRY *term = &plan->segment_terms[s * plan->term_count + term_index];
+      int summed = s >= covered || !cached[term_index];
       uint32_t object_type;
-      plan->segment_terms[s * plan->term_count + term_index] = term;
-      if (term == NULL)
+      if (s < covered && cached[term_index] == TERM_CACHED_ABSENT)
+        continue;
+      if (!YAP_V2_lexical_term_may_exist(segments[s], hashes[term_index]))
+        continue;
+      status = YAP_V2_lexical_term_find(segments[s], plan->terms[term_index], term);
+      if (status == YAP_V2_NOT_FOUND) {
+        status = YAP_V2_OK;
         continue;
+      }
+      if (status == YAP_V2_OK)
+        plan->segment_matched_terms[s]++;
       for (object_type = YAP_V2_LEXICAL_DOCUMENT;
-           status == YAP_V2_OK && object_type <= YAP_V2_LEXICAL_PASSAGE;
+           status == YAP_V2_OK && summed && object_type <= YAP_V2_LEXICAL_PASSAGE;
            object_type++) {
         uint64_t frequency;
         uint64_t *total = &plan->type_frequency[object_type - 1U][term_index];
@@ -354,15 +469,32 @@ int YAP_V2_lexical_query_plan_bind(YAP_V2_LEXICAL_QUERY_PLAN *plan,
       }
     }
   }
+  if (status == YAP_V2_OK && covered == segment_count && term_stats != NULL)
+    term_stats_store(plan, term_stats, cached);
+  free(hashes);
+  free(cached);
   if (status != YAP_V2_OK)
     query_plan_bindings_free(plan);
   return status;
 }
 
+int YAP_V2_lexical_query_plan_has_all_terms(const YAP_V2_LEXICAL_QUERY_PLAN *plan,
+                                            size_t segment_index) {
+  if (plan == NULL || segment_index >= plan->segment_count || plan->segments == NULL ||
+      plan->segments[segment_index] == NULL)
+    return 0;
+  if (plan->term_count == 0U)
+    return 1;
+  return plan->segment_matched_terms != NULL &&
+         plan->segment_matched_terms[segment_index] == plan->term_count;
+}
+
 static void states_free(TERM_STATE *states, size_t count) {
   size_t i;
-  for (i = 0U; i < count; i++)
+  for (i = 0U; i < count; i++) {
     free(states[i].postings);
+    free(states[i].positions);
+  }
   free(states);
 }
 
@@ -374,15 +506,21 @@ int YAP_V2_lexical_search_prepared(const YAP_V2_LEXICAL_QUERY_PLAN *plan,
                                    size_t *hit_count) {
   TERM_STATE *states = NULL;
   TERM_STATE **active = NULL;
+  YAP_V2_PHRASE_TOKEN *tokens = NULL;
   const YAP_V2_LEXICAL_SEGMENT *segment;
+  YAP_V2_LEXICAL_SEARCH_PROFILE profile;
   size_t state_count = 0U, result_count = 0U, i;
   int status;
+  memset(&profile, 0, sizeof(profile));
   if (plan == NULL || !query_plan_valid(plan) || stats == NULL || options == NULL ||
       hit_count == NULL ||
       options->top_k == 0U || options->top_k > hit_capacity || hits == NULL ||
       (options->object_type != 0U && options->object_type != YAP_V2_LEXICAL_DOCUMENT &&
        options->object_type != YAP_V2_LEXICAL_PASSAGE) ||
-      (options->query_operator != YAP_V2_QUERY_OR && options->query_operator != YAP_V2_QUERY_AND))
+      (options->query_operator != YAP_V2_QUERY_OR && options->query_operator != YAP_V2_QUERY_AND &&
+       options->query_operator != YAP_V2_QUERY_PREFIX) ||
+      (options->query_operator == YAP_V2_QUERY_PREFIX && options->phrase) ||
+      options->phrase_slop > YAP_V2_PHRASE_MAX_SLOP)
     return YAP_V2_INVALID_ARGUMENT;
   for (i = 0U; i < 3U; i++)
     if (!isfinite(options->field_boost[i]) || options->field_boost[i] < 0.0)
@@ -401,15 +539,17 @@ int YAP_V2_lexical_search_prepared(const YAP_V2_LEXICAL_QUERY_PLAN *plan,
       return YAP_V2_CONFLICT;
   states = (TERM_STATE *)calloc(plan->term_count, sizeof(*states));
   active = (TERM_STATE **)calloc(plan->term_count, sizeof(*active));
-  if (states == NULL || active == NULL) {
+  if (options->phrase)
+    tokens = (YAP_V2_PHRASE_TOKEN *)calloc(plan->tokens.token_count, sizeof(*tokens));
+  if (states == NULL || active == NULL || (options->phrase && tokens == NULL)) {
     status = YAP_V2_ALLOCATION_FAILED;
     goto done;
   }
   for (i = 0U; i < plan->term_count; i++) {
     const YAP_V2_TERM_ENTRY *term;
     size_t existing;
-    term = plan->segment_terms[segment_index * plan->term_count + i];
-    if (term == NULL) {
+    term = &plan->segment_terms[segment_index * plan->term_count + i];
+    if (term->document_frequency == 0U) {
       if (options->query_operator == YAP_V2_QUERY_AND || options->phrase) {
         status = YAP_V2_OK;
         goto done;
@@ -430,6 +570,7 @@ int YAP_V2_lexical_search_prepared(const YAP_V2_LEXICAL_QUERY_PLAN *plan,
     for (existing = 0U; existing < states[i].count; existing++)
       YAP_V2_posting_iterator_next(&states[i].blocks, &states[i].postings[existing]);
     states[i].blocks.index = 0U;
+    profile.postings_decoded += states[i].count;
     state_count++;
   }
   if (state_count == 0U) {
@@ -484,8 +625,16 @@ int YAP_V2_lexical_search_prepared(const YAP_V2_LEXICAL_QUERY_PLAN *plan,
     }
     {
       YAP_V2_LEXICAL_HIT hit;
-      int phrase_ok = !options->phrase || phrase_matches(segment, states, plan, pivot_key);
+      int phrase_ok = 1;
+      int accepted;
+      if (options->phrase) {
+        status = phrase_matches(segment, states, tokens, plan, pivot_key, options->phrase_slop,
+                                &phrase_ok);
+        if (status != YAP_V2_OK)
+          goto done;
+      }
       memset(&hit, 0, sizeof(hit));
+      profile.pivots++;
       hit.object_type = active[0]->postings[active[0]->index].object_type;
       hit.object_ordinal = active[0]->postings[active[0]->index].object_ordinal;
       for (i = 0U; i < active_count; i++) {
@@ -493,14 +642,17 @@ int YAP_V2_lexical_search_prepared(const YAP_V2_LEXICAL_QUERY_PLAN *plan,
           hit.score +=
             posting_score(stats, active[i], &active[i]->postings[active[i]->index], options);
           hit.matched_terms++;
+          profile.postings_scored++;
           state_advance_to(active[i], pivot_key + 1U, options->object_type);
         }
       }
-      if (phrase_ok &&
-          (options->query_operator == YAP_V2_QUERY_OR || hit.matched_terms == state_count) &&
-          (options->accept == NULL ||
-           options->accept(options->accept_context, hit.object_type, hit.object_ordinal)) &&
-          hit.score > 0.0)
+      accepted = phrase_ok &&
+                 (options->query_operator != YAP_V2_QUERY_AND || hit.matched_terms == state_count);
+      if (accepted && options->accept != NULL) {
+        profile.filter_evaluations++;
+        accepted = options->accept(options->accept_context, hit.object_type, hit.object_ordinal);
+      }
+      if (accepted && hit.score > 0.0)
         add_hit(hits, &result_count, options->top_k, &hit);
     }
   }
@@ -508,7 +660,14 @@ int YAP_V2_lexical_search_prepared(const YAP_V2_LEXICAL_QUERY_PLAN *plan,
   *hit_count = result_count;
   status = YAP_V2_OK;
 done:
+  if (options->profile != NULL) {
+    options->profile->postings_decoded += profile.postings_decoded;
+    options->profile->postings_scored += profile.postings_scored;
+    options->profile->pivots += profile.pivots;
+    options->profile->filter_evaluations += profile.filter_evaluations;
+  }
   free(active);
+  free(tokens);
   states_free(states, plan->term_count);
   return status;
 }
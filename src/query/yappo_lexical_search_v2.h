@@ -4,16 +4,35 @@
 #include "common/yappo_unicode.h"
 #include "components/yappo_lexical_v2.h"
 
-typedef enum { YAP_V2_QUERY_OR = 1, YAP_V2_QUERY_AND = 2 } YAP_V2_QUERY_OPERATOR;
+/* YAP_V2_QUERY_PREFIX searches like YAP_V2_QUERY_OR over a plan whose last token was widened
+ * with YAP_V2_lexical_query_plan_expand. */
+typedef enum {
+  YAP_V2_QUERY_OR = 1,
+  YAP_V2_QUERY_AND = 2,
+  YAP_V2_QUERY_PREFIX = 3
+} YAP_V2_QUERY_OPERATOR;
+
+/* Work done by YAP_V2_lexical_search_prepared, added to the caller's totals. Decoded
+ * postings that were never scored were skipped by the WAND bound or the AND alignment. */
+typedef struct {
+  uint64_t postings_decoded;
+  uint64_t postings_scored;
+  uint64_t pivots;
+  uint64_t filter_evaluations;
+} YAP_V2_LEXICAL_SEARCH_PROFILE;
 
 typedef struct {
   uint32_t object_type;
   YAP_V2_QUERY_OPERATOR query_operator;
   int phrase;
+  /* Positions each phrase token may sit from its exact place; 0 is an exact phrase. */
+  uint32_t phrase_slop;
   double field_boost[3];
   size_t top_k;
   int (*accept)(void *context, uint32_t object_type, uint64_t object_ordinal);
   void *accept_context;
+  /* NULL skips profiling. */
+  YAP_V2_LEXICAL_SEARCH_PROFILE *profile;
 } YAP_V2_LEXICAL_SEARCH_OPTIONS;
 
 typedef struct {
@@ -28,8 +47,10 @@ typedef struct {
   YAP_V2_BYTES_VIEW *terms;
   size_t *token_terms;
   size_t term_count;
+  unsigned char *expansion_bytes;
   const YAP_V2_LEXICAL_SEGMENT **segments;
-  const YAP_V2_TERM_ENTRY **segment_terms;
+  YAP_V2_TERM_ENTRY *segment_terms;
+  size_t *segment_matched_terms;
   uint64_t *type_frequency[2];
   size_t segment_count;
 } YAP_V2_LEXICAL_QUERY_PLAN;
@@ -40,14 +61,41 @@ typedef struct {
   uint64_t field_token_count[3];
 } YAP_V2_LEXICAL_CORPUS_STATS;
 
+/* Document and passage frequencies of terms summed over the first segment_count segments of a
+ * snapshot, shared by the queries bound to it. lookup returns YAP_V2_NOT_FOUND for a term it
+ * does not hold; store may keep or drop the sums. */
+typedef struct {
+  int (*lookup)(void *context, YAP_V2_BYTES_VIEW term, uint64_t type_frequency[2]);
+  void (*store)(void *context, YAP_V2_BYTES_VIEW term, const uint64_t type_frequency[2]);
+  void *context;
+  size_t segment_count;
+} YAP_V2_TERM_STATS_SOURCE;
+
 void YAP_V2_lexical_search_options_init(YAP_V2_LEXICAL_SEARCH_OPTIONS *options);
 void YAP_V2_lexical_query_plan_init(YAP_V2_LEXICAL_QUERY_PLAN *plan);
 void YAP_V2_lexical_query_plan_free(YAP_V2_LEXICAL_QUERY_PLAN *plan);
 int YAP_V2_lexical_query_plan_prepare(YAP_V2_BYTES_VIEW query,
                                       YAP_V2_LEXICAL_QUERY_PLAN *plan);
+/* Appends copies of terms that the plan does not have yet as extra OR terms, before bind. The
+ * last token keeps its own term, so a word that is already complete still matches. */
+int YAP_V2_lexical_query_plan_expand(YAP_V2_LEXICAL_QUERY_PLAN *plan,
+                                     const YAP_V2_BYTES_VIEW *terms, size_t count);
+/* Looks every term up in every segment. Each segment's vocabulary filter is probed first, so a
+ * term a segment lacks skips its dictionary search there. */
 int YAP_V2_lexical_query_plan_bind(YAP_V2_LEXICAL_QUERY_PLAN *plan,
                                    const YAP_V2_LEXICAL_SEGMENT *const *segments,
                                    size_t segment_count);
+/* Like bind, but takes the frequencies over the segments term_stats covers from it when it
+ * holds them, skips those segments for terms it counts nowhere, and stores the sums it made.
+ * The covered segments must be the leading ones here; NULL sums every time. */
+int YAP_V2_lexical_query_plan_bind_cached(YAP_V2_LEXICAL_QUERY_PLAN *plan,
+                                          const YAP_V2_LEXICAL_SEGMENT *const *segments,
+                                          size_t segment_count,
+                                          const YAP_V2_TERM_STATS_SOURCE *term_stats);
+/* After bind, returns 1 when the segment holds every term of the plan. Segments that do not
+ * can produce no AND or phrase hits and need not be searched for them. */
+int YAP_V2_lexical_query_plan_has_all_terms(const YAP_V2_LEXICAL_QUERY_PLAN *plan,
+                                            size_t segment_index);
 int YAP_V2_lexical_search_prepared(const YAP_V2_LEXICAL_QUERY_PLAN *plan,
                                    size_t segment_index,
                                    const YAP_V2_LEXICAL_CORPUS_STATS *stats,
@@ -0,0 +1,140 @@
+#include "query/yappo_phrase_v2.h"
+
+static int position_before(const YAP_V2_POSITION *position, uint32_t field, uint64_t target) {
+  return position->field < field || (position->field == field && position->position < target);
+}
+
+/* First index at or after from whose position is not before (field, target). The step doubles
+ * while it stays before the target, so a cursor that moves d entries costs O(log d). */
+static size_t gallop(const YAP_V2_POSITION *positions, size_t count, size_t from, uint32_t field,
+                     uint64_t target) {
+  size_t low = from, step = 1U, high;
+  if (from >= count || !position_before(&positions[from], field, target))
+    return from;
+  while (step < count - low && position_before(&positions[low + step], field, target)) {
+    low += step;
+    step *= 2U;
+  }
+  high = step < count - low ? low + step : count;
+  low++;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2U;
+    if (position_before(&positions[middle], field, target))
+      low = middle + 1U;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+/* Moves at past every entry an earlier token reading the same list already matched. */
+static size_t skip_claimed(const YAP_V2_PHRASE_TOKEN *tokens, size_t token_index, size_t at) {
+  size_t earlier;
+  int moved = 1;
+  while (moved && at < tokens[token_index].count) {
+    moved = 0;
+    for (earlier = 0U; earlier < token_index; earlier++)
+      if (tokens[earlier].positions == tokens[token_index].positions &&
+          tokens[earlier].claimed == at) {
+        at++;
+        moved = 1;
+      }
+  }
+  return at;
+}
+
+/* Entry of token q where its start, position minus offset, first reaches lowest. */
+static size_t first_start(const YAP_V2_PHRASE_TOKEN *tokens, size_t q, uint32_t field,
+                          int64_t lowest) {
+  int64_t target = lowest + (int64_t)tokens[q].offset;
+  return gallop(tokens[q].positions, tokens[q].count, tokens[q].cursor, field,
+                target < 0 ? 0U : (uint64_t)target);
+}
+
+/* Returns 1 when every token has a start in [lowest, lowest + slop] of field. Tokens sharing a
+ * list come in offset order and each takes the first entry the earlier ones left, which finds
+ * distinct entries whenever any exist. */
+static int window_matches(YAP_V2_PHRASE_TOKEN *tokens, size_t token_count, uint32_t field,
+                          int64_t lowest, uint32_t slop) {
+  size_t q;
+  for (q = 0U; q < token_count; q++) {
+    size_t at = skip_claimed(tokens, q, first_start(tokens, q, field, lowest));
+    const YAP_V2_POSITION *found;
+    if (at == tokens[q].count)
+      return 0;
+    found = &tokens[q].positions[at];
+    if (found->field != field ||
+        (int64_t)found->position - (int64_t)tokens[q].offset > lowest + (int64_t)slop)
+      return 0;
+    tokens[q].claimed = at;
+  }
+  return 1;
+}
+
+int YAP_V2_phrase_match(YAP_V2_PHRASE_TOKEN *tokens, size_t token_count, uint32_t slop,
+                        int *matches) {
+  const YAP_V2_PHRASE_TOKEN *rarest;
+  size_t i, q;
+  uint32_t tried_field = 0U;
+  int64_t untried = INT64_MIN;
+  if (matches == NULL || (tokens == NULL && token_count > 0U) || slop > YAP_V2_PHRASE_MAX_SLOP)
+    return YAP_V2_INVALID_ARGUMENT;
+  *matches = 0;
+  for (i = 0U; i < token_count; i++) {
+    if (tokens[i].positions == NULL && tokens[i].count > 0U)
+      return YAP_V2_INVALID_ARGUMENT;
+    if (tokens[i].count == 0U)
+      return YAP_V2_OK;
+    tokens[i].cursor = 0U;
+  }
+  if (token_count == 0U)
+    return YAP_V2_OK;
+  for (i = 1U; i < token_count; i++) {
+    YAP_V2_PHRASE_TOKEN token = tokens[i];
+    for (q = i; q > 0U && (tokens[q - 1U].count > token.count ||
+                           (tokens[q - 1U].count == token.count &&
+                            tokens[q - 1U].offset > token.offset)); q--)
+      tokens[q] = tokens[q - 1U];
+    tokens[q] = token;
+  }
+  rarest = &tokens[0];
+  /* Every match holds some start of the rarest token, so only windows whose lowest start lies
+   * within slop below one need trying. untried skips the ones an earlier anchor covered, and
+   * since anchors only grow every cursor only moves forward. */
+  for (i = 0U; i < rarest->count; i++) {
+    const YAP_V2_POSITION *anchor = &rarest->positions[i];
+    int64_t start = (int64_t)anchor->position - (int64_t)rarest->offset;
+    int64_t lowest = start - (int64_t)slop;
+    if (anchor->field == tried_field && lowest < untried)
+      lowest = untried;
+    for (q = 0U; q < token_count; q++) {
+      tokens[q].cursor = first_start(tokens, q, anchor->field, lowest);
+      if (tokens[q].cursor == tokens[q].count)
+        return YAP_V2_OK;
+    }
+    /* Windows begin at the smallest start not yet tried, so none is checked twice. */
+    while (lowest <= start) {
+      int64_t next = INT64_MAX;
+      for (q = 0U; q < token_count; q++) {
+        size_t at = first_start(tokens, q, anchor->field, lowest);
+        const YAP_V2_POSITION *found = &tokens[q].positions[at];
+        int64_t candidate;
+        if (at == tokens[q].count || found->field != anchor->field)
+          continue;
+        candidate = (int64_t)found->position - (int64_t)tokens[q].offset;
+        if (candidate < next)
+          next = candidate;
+      }
+      if (next > start)
+        break;
+      if (window_matches(tokens, token_count, anchor->field, next, slop)) {
+        *matches = 1;
+        return YAP_V2_OK;
+      }
+      lowest = next + 1;
+    }
+    tried_field = anchor->field;
+    untried = start + 1;
+  }
+  return YAP_V2_OK;
+}
@@ -0,0 +1,27 @@
+#ifndef YAPPO_PHRASE_V2_H
+#define YAPPO_PHRASE_V2_H
+
+#include "components/yappo_lexical_v2.h"
+
+#define YAP_V2_PHRASE_MAX_SLOP 64U
+
+/* Positions of one query token in one candidate, sorted by field and then position as the
+ * lexical writer stores them. offset is the token's place in the phrase. Tokens of a repeated
+ * term share one positions array. cursor and claimed are scratch. */
+typedef struct {
+  const YAP_V2_POSITION *positions;
+  size_t count;
+  uint32_t offset;
+  size_t cursor;
+  size_t claimed;
+} YAP_V2_PHRASE_TOKEN;
+
+/* A match needs every token in one field, each at a distinct position when tokens share a
+ * positions array, such that position minus offset differs by at most slop between any two
+ * tokens; slop 0 is an exact phrase and swapping two neighbours needs slop 2. Reorders tokens
+ * so the one with the fewest positions comes first, tries only alignments near its positions,
+ * and gallops every other token forward to them. */
+int YAP_V2_phrase_match(YAP_V2_PHRASE_TOKEN *tokens, size_t token_count, uint32_t slop,
+                        int *matches);
+
+#endif
@@ -206,6 +206,21 @@ void YAP_V2_query_request_init(YAP_V2_QUERY_REQUEST *request) {
   request->lexical_weight = 1.0; request->vector_weight = 1.0;
 }
 
+void YAP_V2_query_profile_init(YAP_V2_QUERY_PROFILE *profile) {
+  if (profile != NULL) memset(profile, 0, sizeof(*profile));
+}
+
+void YAP_V2_query_profile_free(YAP_V2_QUERY_PROFILE *profile) {
+  if (profile == NULL) return;
+  free(profile->segments);
+  memset(profile, 0, sizeof(*profile));
+}
+
+static void profile_ann_request(const YAP_V2_QUERY_REQUEST *request, size_t request_count) {
+  if (request->profile != NULL && request_count > request->profile->ann_max_k)
+    request->profile->ann_max_k = request_count;
+}
+
 typedef struct {
   const YAP_V2_SEARCH_SNAPSHOT *snapshot;
   const YAP_V2_SEGMENT *documents;
@@ -233,6 +248,33 @@ static int lexical_accept(void *opaque, uint32_t object_type, uint64_t object_or
   return filter_matches(context->filter, context->filter_enabled, hit.document_ordinal);
 }
 
+/* Widens the last token of a YAP_V2_QUERY_PREFIX plan with its most frequent completions. */
+static int expand_lexical_prefix(const YAP_V2_QUERY_REQUEST *request,
+                                 const YAP_V2_LEXICAL_SEGMENT *const *segments,
+                                 size_t segment_count, YAP_V2_LEXICAL_QUERY_PLAN *plan) {
+  YAP_V2_SUGGESTIONS expansions;
+  YAP_V2_BYTES_VIEW prefix, terms[YAP_V2_PREFIX_MAX_EXPANSIONS];
+  size_t count, i;
+  int status;
+  if (plan->tokens.token_count == 0U) return YAP_V2_OK;
+  prefix = plan->terms[plan->token_terms[plan->tokens.token_count - 1U]];
+  YAP_V2_suggestions_init(&expansions);
+  status = request->expand_prefix != NULL ?
+           request->expand_prefix(request->expand_context, prefix, &expansions) :
+           YAP_V2_suggest_terms(segments, segment_count, prefix,
+                                YAP_V2_PREFIX_MAX_EXPANSIONS, &expansions);
+  if (status == YAP_V2_OK) {
+    count = expansions.count < YAP_V2_PREFIX_MAX_EXPANSIONS ? expansions.count :
+            YAP_V2_PREFIX_MAX_EXPANSIONS;
+    for (i = 0U; i < count; i++) {
+      terms[i].data = expansions.items[i].term; terms[i].len = expansions.items[i].term_len;
+    }
+    status = YAP_V2_lexical_query_plan_expand(plan, terms, count);
+  }
+  YAP_V2_suggestions_free(&expansions);
+  return status;
+}
+
 static int collect_lexical(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
                            const YAP_V2_QUERY_SEGMENT *segments, size_t segment_count,
                            const YAP_V2_LEXICAL_CORPUS_STATS *corpus_stats,
@@ -253,26 +295,47 @@ static int collect_lexical(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
   }
   for (s = 0U; s < segment_count; s++)
     lexical_segments[s] = segments[s].lexical;
-  status = YAP_V2_lexical_query_plan_bind(&plan, lexical_segments, segment_count);
+  if (request->query_operator == YAP_V2_QUERY_PREFIX)
+    status = expand_lexical_prefix(request, lexical_segments, segment_count, &plan);
+  if (status == YAP_V2_OK)
+    status = YAP_V2_lexical_query_plan_bind_cached(&plan, lexical_segments, segment_count,
+                                                   request->term_stats);
   free(lexical_segments);
+  if (status == YAP_V2_OK && request->profile != NULL) {
+    YAP_V2_QUERY_SEGMENT_PROFILE *profiles =
+      (YAP_V2_QUERY_SEGMENT_PROFILE *)calloc(segment_count, sizeof(*profiles));
+    if (profiles == NULL) status = YAP_V2_ALLOCATION_FAILED;
+    else {
+      free(request->profile->segments);
+      request->profile->segments = profiles; request->profile->segment_count = segment_count;
+      for (s = 0U; s < segment_count; s++) profiles[s].segment_ordinal = s;
+    }
+  }
   if (status != YAP_V2_OK) {
     YAP_V2_lexical_query_plan_free(&plan);
     return status;
   }
   for (s = 0U; s < segment_count; s++) {
     const YAP_V2_SEGMENT *documents = YAP_V2_snapshot_segment_documents(snapshot, s);
+    YAP_V2_QUERY_SEGMENT_PROFILE *profile =
+      request->profile == NULL ? NULL : &request->profile->segments[s];
     YAP_V2_LEXICAL_SEARCH_OPTIONS options;
     YAP_V2_LEXICAL_HIT *local;
     YAP_V2_FILTER filter;
     LEXICAL_ACCEPT_CONTEXT accept_context;
     size_t local_count, local_limit, i;
+    uint64_t started = 0U;
     int filter_enabled = request->filter_json.len > 0U;
+    if (YAP_V2_cancellation_requested(request->cancellation)) { status = YAP_V2_CANCELLED; break; }
     if (documents == NULL) { status = YAP_V2_INVALID_ARGUMENT; break; }
     local_limit = request->scope == YAP_V2_SEARCH_DOCUMENTS ? documents->document_count :
                   documents->passage_count;
     if (local_limit > request->candidate_k) local_limit = request->candidate_k;
     if (local_limit == 0U) continue;
     if (segments[s].lexical == NULL) { status = YAP_V2_INVALID_ARGUMENT; break; }
+    /* A segment lacking any term has no AND or phrase hits; skip it before compiling filters. */
+    if ((request->query_operator == YAP_V2_QUERY_AND || request->phrase) &&
+        !YAP_V2_lexical_query_plan_has_all_terms(&plan, s)) continue;
     YAP_V2_filter_init(&filter);
     if (filter_enabled) {
       if (segments[s].metadata == NULL) {
@@ -289,6 +352,7 @@ static int collect_lexical(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
     options.object_type = request->scope == YAP_V2_SEARCH_DOCUMENTS ?
                           YAP_V2_LEXICAL_DOCUMENT : YAP_V2_LEXICAL_PASSAGE;
     options.query_operator = request->query_operator; options.phrase = request->phrase;
+    options.phrase_slop = request->phrase_slop;
     options.top_k = local_limit;
     accept_context.snapshot = snapshot;
     accept_context.documents = documents;
@@ -297,8 +361,15 @@ static int collect_lexical(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
     accept_context.filter_enabled = filter_enabled;
     options.accept = lexical_accept;
     options.accept_context = &accept_context;
+    if (profile != NULL) {
+      options.profile = &profile->lexical; started = YAP_V2_cancellation_clock_microseconds();
+    }
     status = YAP_V2_lexical_search_prepared(&plan, s, corpus_stats, &options,
                                             local, local_limit, &local_count);
+    if (profile != NULL) {
+      profile->lexical_microseconds = YAP_V2_cancellation_clock_microseconds() - started;
+      if (status == YAP_V2_OK) profile->lexical_hits = local_count;
+    }
     for (i = 0U; status == YAP_V2_OK && i < local_count; i++) {
       CANDIDATE candidate;
       if (local[i].object_type == YAP_V2_LEXICAL_DOCUMENT) {
@@ -336,7 +407,8 @@ static int collect_vector_base(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
   int status = YAP_V2_OK;
   int filter_enabled = request->filter_json.len > 0U;
   memset(&base_candidates, 0, sizeof(base_candidates));
-  if (corpus == NULL || plan == NULL || corpus->vector_count == 0U) return YAP_V2_OK;
+  if (corpus == NULL || plan == NULL || corpus->vector_count == 0U || plan->base_pending)
+    return YAP_V2_OK;
   if (plan->base_segment_count != corpus->segment_count ||
       plan->current_segment_count != segment_count) return YAP_V2_INVALID_ARGUMENT;
   request_count = request->candidate_k > SIZE_MAX / 4U ?
@@ -349,7 +421,9 @@ static int collect_vector_base(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
   status = candidate_set_init(&base_candidates, request->candidate_k);
   if (status != YAP_V2_OK) goto done;
   for (;;) {
-    uint64_t *resized = realloc(keys, sizeof(*keys) * request_count);
+    uint64_t *resized;
+    if (YAP_V2_cancellation_requested(request->cancellation)) { status = YAP_V2_CANCELLED; break; }
+    resized = realloc(keys, sizeof(*keys) * request_count);
     if (resized == NULL) { status = YAP_V2_ALLOCATION_FAILED; break; }
     keys = resized;
     memset(base_candidates.hash, 0,
@@ -358,6 +432,7 @@ static int collect_vector_base(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
     status = YAP_V2_ann_corpus_search(corpus, request->query_vector,
                                       request->query_dimensions, request_count,
                                       keys, request_count, &key_count);
+    profile_ann_request(request, request_count);
     if (stats != NULL) stats->base_search_calls++;
     if (status != YAP_VECTOR_OK && status != YAP_V2_OK) break;
     for (i = 0U; status == YAP_V2_OK && i < key_count; i++) {
@@ -452,7 +527,8 @@ static int collect_vector_segments(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
     CANDIDATE_SET segment_candidates;
     size_t local_count, i, request_count, entry_count;
     int status, filter_enabled = request->filter_json.len > 0U;
-    if (plan != NULL && !plan->current_is_delta[s]) continue;
+    if (plan != NULL && !plan->current_is_delta[s] && !plan->base_pending) continue;
+    if (YAP_V2_cancellation_requested(request->cancellation)) return YAP_V2_CANCELLED;
     if (documents == NULL)
       return YAP_V2_INVALID_ARGUMENT;
     if (documents->passage_count == 0U) continue;
@@ -487,6 +563,7 @@ static int collect_vector_segments(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
       status = YAP_V2_ann_search(segments[s].vector, request->query_vector,
                                  request->query_dimensions, request_count, local, request_count,
                                  &local_count);
+      profile_ann_request(request, request_count);
       if (stats != NULL) stats->delta_search_calls++;
       for (i = 0U; status == YAP_VECTOR_OK && i < local_count; i++) {
         const YAP_V2_PASSAGE_VIEW *passage;
@@ -598,6 +675,7 @@ int YAP_V2_query_execute_with_ann(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
   YAP_HYBRID_CANDIDATE *lexical_rrf = NULL, *vector_rrf = NULL;
   YAP_HYBRID_HIT *fused = NULL;
   size_t fused_count = 0U, i, j;
+  uint64_t started = 0U;
   int status = YAP_V2_OK;
   memset(&lexical, 0, sizeof(lexical));
   memset(&vector, 0, sizeof(vector));
@@ -621,12 +699,21 @@ int YAP_V2_query_execute_with_ann(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
   if (status != YAP_V2_OK || lexical_rrf == NULL || vector_rrf == NULL || fused == NULL) {
     status = YAP_V2_ALLOCATION_FAILED; goto done;
   }
+  if (query_stats != NULL) started = YAP_V2_cancellation_clock_microseconds();
   if (request->mode != YAP_V2_SEARCH_VECTOR)
     status = collect_lexical(snapshot, segments, segment_count, &stats->lexical,
                              request, &lexical);
+  if (query_stats != NULL) {
+    uint64_t now = YAP_V2_cancellation_clock_microseconds();
+    query_stats->lexical_microseconds = now - started; started = now;
+  }
   if (status == YAP_V2_OK && request->mode != YAP_V2_SEARCH_LEXICAL)
     status = collect_vector(snapshot, segments, segment_count, ann_corpus, ann_plan,
                             request, &vector, query_stats);
+  if (query_stats != NULL) {
+    uint64_t now = YAP_V2_cancellation_clock_microseconds();
+    query_stats->vector_microseconds = now - started; started = now;
+  }
   if (status != YAP_V2_OK) goto done;
   qsort(lexical.items, lexical.count, sizeof(*lexical.items), candidate_compare);
   qsort(vector.items, vector.count, sizeof(*vector.items), candidate_compare);
@@ -665,6 +752,8 @@ int YAP_V2_query_execute_with_ann(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
   }
   *hit_count = fused_count; status = YAP_V2_OK;
 done:
+  if (query_stats != NULL && started != 0U)
+    query_stats->fusion_microseconds = YAP_V2_cancellation_clock_microseconds() - started;
   candidate_set_free(&lexical);
   candidate_set_free(&vector);
   free(lexical_rrf);
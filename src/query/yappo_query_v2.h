@@ -5,6 +5,7 @@
 #include "query/yappo_filter_v2.h"
 #include "query/yappo_hybrid.h"
 #include "query/yappo_lexical_search_v2.h"
+#include "query/yappo_suggest_v2.h"
 #include "storage/yappo_snapshot_v2.h"
 
 typedef enum {
@@ -29,6 +30,22 @@ typedef struct {
   YAP_V2_LEXICAL_CORPUS_STATS lexical;
 } YAP_V2_QUERY_CORPUS_STATS;
 
+typedef struct {
+  size_t segment_ordinal;
+  uint64_t lexical_microseconds;
+  size_t lexical_hits;
+  YAP_V2_LEXICAL_SEARCH_PROFILE lexical;
+} YAP_V2_QUERY_SEGMENT_PROFILE;
+
+/* Filled only when a request points at one. segments has one entry per snapshot segment
+ * once lexical collection ran; ann_max_k is the largest candidate count asked of any ANN
+ * index, including retries. */
+typedef struct {
+  YAP_V2_QUERY_SEGMENT_PROFILE *segments;
+  size_t segment_count;
+  size_t ann_max_k;
+} YAP_V2_QUERY_PROFILE;
+
 typedef struct {
   YAP_V2_SEARCH_MODE mode;
   YAP_V2_SEARCH_SCOPE scope;
@@ -38,10 +55,24 @@ typedef struct {
   YAP_V2_BYTES_VIEW filter_json;
   YAP_V2_QUERY_OPERATOR query_operator;
   int phrase;
+  uint32_t phrase_slop;
   size_t top_k;
   size_t candidate_k;
   double lexical_weight;
   double vector_weight;
+  /* Fills the completions of the last query token for YAP_V2_QUERY_PREFIX, for example from
+   * a per-snapshot cache; at most YAP_V2_PREFIX_MAX_EXPANSIONS are used. NULL walks the term
+   * dictionaries of the searched segments on every request. */
+  int (*expand_prefix)(void *context, YAP_V2_BYTES_VIEW prefix,
+                       YAP_V2_SUGGESTIONS *expansions);
+  void *expand_context;
+  /* Corpus term frequencies over the leading segments of the snapshot, for example a cache of
+   * the published ones. NULL sums them across segments on every request. */
+  const YAP_V2_TERM_STATS_SOURCE *term_stats;
+  /* Polled between segments and ANN retries; NULL never cancels. */
+  const YAP_V2_CANCELLATION *cancellation;
+  /* NULL skips the per-segment timers and counters. */
+  YAP_V2_QUERY_PROFILE *profile;
 } YAP_V2_QUERY_REQUEST;
 
 typedef struct {
@@ -60,13 +91,20 @@ typedef struct {
   uint64_t retry_search_calls;
   uint64_t candidates_examined;
   uint64_t candidates_rejected;
+  /* Wall time of the lexical and vector collection and of the final RRF fusion. */
+  uint64_t lexical_microseconds;
+  uint64_t vector_microseconds;
+  uint64_t fusion_microseconds;
 } YAP_V2_QUERY_STATS;
 
 void YAP_V2_query_request_init(YAP_V2_QUERY_REQUEST *request);
+void YAP_V2_query_profile_init(YAP_V2_QUERY_PROFILE *profile);
+void YAP_V2_query_profile_free(YAP_V2_QUERY_PROFILE *profile);
 int YAP_V2_query_corpus_stats_build(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
                                     const YAP_V2_QUERY_SEGMENT *segments,
                                     size_t segment_count,
                                     YAP_V2_QUERY_CORPUS_STATS *stats);
+/* Both return YAP_V2_CANCELLED when request->cancellation fires mid-query. */
 int YAP_V2_query_execute(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
                          const YAP_V2_QUERY_SEGMENT *segments, size_t segment_count,
                          const YAP_V2_QUERY_CORPUS_STATS *stats,
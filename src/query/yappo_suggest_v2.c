@@ -0,0 +1,190 @@
+#include "query/yappo_suggest_v2.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int bytes_compare(const unsigned char *left, size_t left_len, const unsigned char *right,
+                         size_t right_len) {
+  size_t common = left_len < right_len ? left_len : right_len;
+  int compared = common == 0U ? 0 : memcmp(left, right, common);
+  if (compared != 0)
+    return compared;
+  return left_len < right_len ? -1 : left_len > right_len;
+}
+
+static int suggestion_compare(const void *left, const void *right) {
+  const YAP_V2_SUGGESTION *a = (const YAP_V2_SUGGESTION *)left;
+  const YAP_V2_SUGGESTION *b = (const YAP_V2_SUGGESTION *)right;
+  if (a->document_frequency != b->document_frequency)
+    return a->document_frequency > b->document_frequency ? -1 : 1;
+  return bytes_compare(a->term, a->term_len, b->term, b->term_len);
+}
+
+static int suggestion_set(YAP_V2_SUGGESTION *item, const unsigned char *term, size_t term_len,
+                          uint64_t frequency) {
+  unsigned char *copy = (unsigned char *)realloc(item->term, term_len);
+  if (copy == NULL)
+    return YAP_V2_ALLOCATION_FAILED;
+  memcpy(copy, term, term_len);
+  item->term = copy;
+  item->term_len = term_len;
+  item->document_frequency = frequency;
+  return YAP_V2_OK;
+}
+
+static int cursor_has_prefix(const YAP_V2_TERM_CURSOR *cursor, YAP_V2_BYTES_VIEW prefix) {
+  return cursor->term_len >= prefix.len && memcmp(cursor->term, prefix.data, prefix.len) == 0;
+}
+
+static int cursor_equal(const YAP_V2_TERM_CURSOR *left, const YAP_V2_TERM_CURSOR *right) {
+  return left->term_len == right->term_len &&
+         memcmp(left->term, right->term, left->term_len) == 0;
+}
+
+/* Moves to the next term; live drops once the cursor leaves the prefix range. */
+static int cursor_advance(YAP_V2_TERM_CURSOR *cursor, YAP_V2_BYTES_VIEW prefix,
+                          unsigned char *live) {
+  int status = YAP_V2_term_cursor_next(cursor);
+  if (status == YAP_V2_OUT_OF_RANGE) {
+    *live = 0U;
+    return YAP_V2_OK;
+  }
+  if (status == YAP_V2_OK)
+    *live = (unsigned char)cursor_has_prefix(cursor, prefix);
+  return status;
+}
+
+void YAP_V2_suggestions_init(YAP_V2_SUGGESTIONS *suggestions) {
+  if (suggestions != NULL)
+    memset(suggestions, 0, sizeof(*suggestions));
+}
+
+void YAP_V2_suggestions_free(YAP_V2_SUGGESTIONS *suggestions) {
+  size_t i;
+  if (suggestions == NULL)
+    return;
+  for (i = 0U; suggestions->items != NULL && i < suggestions->count; i++)
+    free(suggestions->items[i].term);
+  free(suggestions->items);
+  YAP_V2_suggestions_init(suggestions);
+}
+
+int YAP_V2_suggestions_copy(const YAP_V2_SUGGESTIONS *source, size_t limit,
+                            YAP_V2_SUGGESTIONS *target) {
+  size_t count, i;
+  int status = YAP_V2_OK;
+  if (source == NULL || target == NULL || source == target ||
+      (source->items == NULL && source->count > 0U))
+    return YAP_V2_INVALID_ARGUMENT;
+  YAP_V2_suggestions_free(target);
+  count = source->count < limit ? source->count : limit;
+  if (count == 0U)
+    return YAP_V2_OK;
+  target->items = (YAP_V2_SUGGESTION *)calloc(count, sizeof(*target->items));
+  if (target->items == NULL)
+    return YAP_V2_ALLOCATION_FAILED;
+  for (i = 0U; status == YAP_V2_OK && i < count; i++) {
+    status = suggestion_set(&target->items[i], source->items[i].term, source->items[i].term_len,
+                            source->items[i].document_frequency);
+    if (status == YAP_V2_OK)
+      target->count++;
+  }
+  if (status != YAP_V2_OK)
+    YAP_V2_suggestions_free(target);
+  return status;
+}
+
+int YAP_V2_suggest_terms(const YAP_V2_LEXICAL_SEGMENT *const *segments, size_t segment_count,
+                         YAP_V2_BYTES_VIEW prefix, size_t limit,
+                         YAP_V2_SUGGESTIONS *suggestions) {
+  YAP_V2_TERM_CURSOR *cursors = NULL;
+  unsigned char *live = NULL;
+  size_t worst = 0U, i;
+  int status = YAP_V2_OK;
+  if ((segments == NULL && segment_count > 0U) || prefix.data == NULL || prefix.len == 0U ||
+      limit == 0U || limit > YAP_V2_SUGGEST_MAX_TERMS || suggestions == NULL)
+    return YAP_V2_INVALID_ARGUMENT;
+  YAP_V2_suggestions_free(suggestions);
+  if (segment_count == 0U)
+    return YAP_V2_OK;
+  suggestions->items = (YAP_V2_SUGGESTION *)calloc(limit, sizeof(*suggestions->items));
+  cursors = (YAP_V2_TERM_CURSOR *)calloc(segment_count, sizeof(*cursors));
+  live = (unsigned char *)calloc(segment_count, sizeof(*live));
+  if (suggestions->items == NULL || cursors == NULL || live == NULL) {
+    status = YAP_V2_ALLOCATION_FAILED;
+    goto done;
+  }
+  for (i = 0U; i < segment_count; i++) {
+    if (segments[i] == NULL)
+      continue;
+    status = YAP_V2_term_cursor_seek(segments[i], prefix, &cursors[i]);
+    if (status == YAP_V2_OUT_OF_RANGE) {
+      status = YAP_V2_OK;
+      continue;
+    }
+    if (status != YAP_V2_OK)
+      goto done;
+    live[i] = (unsigned char)cursor_has_prefix(&cursors[i], prefix);
+  }
+  while (1) {
+    YAP_V2_SUGGESTION candidate;
+    size_t smallest = segment_count;
+    uint64_t frequency;
+    for (i = 0U; i < segment_count; i++)
+      if (live[i] && (smallest == segment_count ||
+                      bytes_compare(cursors[i].term, cursors[i].term_len,
+                                    cursors[smallest].term, cursors[smallest].term_len) < 0))
+        smallest = i;
+    if (smallest == segment_count)
+      break;
+    frequency = cursors[smallest].entry.document_frequency;
+    for (i = smallest + 1U; i < segment_count; i++)
+      if (live[i] && cursor_equal(&cursors[i], &cursors[smallest]))
+        frequency = cursors[i].entry.document_frequency > UINT64_MAX - frequency
+                      ? UINT64_MAX
+                      : frequency + cursors[i].entry.document_frequency;
+    candidate.term = cursors[smallest].term;
+    candidate.term_len = cursors[smallest].term_len;
+    candidate.document_frequency = frequency;
+    if (suggestions->count < limit) {
+      status = suggestion_set(&suggestions->items[suggestions->count], candidate.term,
+                              candidate.term_len, frequency);
+      if (status != YAP_V2_OK)
+        goto done;
+      suggestions->count++;
+      if (suggestions->count == limit)
+        for (i = 1U, worst = 0U; i < limit; i++)
+          if (suggestion_compare(&suggestions->items[i], &suggestions->items[worst]) > 0)
+            worst = i;
+    } else if (suggestion_compare(&candidate, &suggestions->items[worst]) < 0) {
+      status = suggestion_set(&suggestions->items[worst], candidate.term, candidate.term_len,
+                              frequency);
+      if (status != YAP_V2_OK)
+        goto done;
+      for (i = 1U, worst = 0U; i < limit; i++)
+        if (suggestion_compare(&suggestions->items[i], &suggestions->items[worst]) > 0)
+          worst = i;
+    }
+    /* The smallest cursor moves last, since the others compare against its term. */
+    for (i = smallest + 1U; i < segment_count; i++)
+      if (live[i] && cursor_equal(&cursors[i], &cursors[smallest])) {
+        status = cursor_advance(&cursors[i], prefix, &live[i]);
+        if (status != YAP_V2_OK)
+          goto done;
+      }
+    status = cursor_advance(&cursors[smallest], prefix, &live[smallest]);
+    if (status != YAP_V2_OK)
+      goto done;
+  }
+  qsort(suggestions->items, suggestions->count, sizeof(*suggestions->items),
+        suggestion_compare);
+done:
+  if (cursors != NULL)
+    for (i = 0U; i < segment_count; i++)
+      YAP_V2_term_cursor_free(&cursors[i]);
+  free(cursors);
+  free(live);
+  if (status != YAP_V2_OK)
+    YAP_V2_suggestions_free(suggestions);
+  return status;
+}
@@ -0,0 +1,32 @@
+#ifndef YAPPO_SUGGEST_V2_H
+#define YAPPO_SUGGEST_V2_H
+
+#include "components/yappo_lexical_v2.h"
+
+#define YAP_V2_SUGGEST_MAX_TERMS 32U
+#define YAP_V2_PREFIX_MAX_EXPANSIONS 16U
+
+typedef struct {
+  unsigned char *term;
+  size_t term_len;
+  uint64_t document_frequency;
+} YAP_V2_SUGGESTION;
+
+/* Most frequent first; equal frequencies keep UTF-8 byte order. Each term is owned. */
+typedef struct {
+  YAP_V2_SUGGESTION *items;
+  size_t count;
+} YAP_V2_SUGGESTIONS;
+
+void YAP_V2_suggestions_init(YAP_V2_SUGGESTIONS *suggestions);
+void YAP_V2_suggestions_free(YAP_V2_SUGGESTIONS *suggestions);
+int YAP_V2_suggestions_copy(const YAP_V2_SUGGESTIONS *source, size_t limit,
+                            YAP_V2_SUGGESTIONS *target);
+/* Walks the terms starting with prefix in every segment at once, in dictionary order, and
+ * keeps the limit terms with the highest document frequency summed over segments. NULL
+ * segments are skipped. Deleted documents still count until compaction removes them. */
+int YAP_V2_suggest_terms(const YAP_V2_LEXICAL_SEGMENT *const *segments, size_t segment_count,
+                         YAP_V2_BYTES_VIEW prefix, size_t limit,
+                         YAP_V2_SUGGESTIONS *suggestions);
+
+#endif
@@ -80,6 +80,14 @@ static int parse_content_length(const char *value, size_t *length) {
   return 0;
 }
 
+static int parse_timeout_ms(const char *value, uint32_t *timeout_ms) {
+  size_t parsed;
+  if (parse_content_length(value, &parsed) != 0 || parsed == 0U || parsed > UINT32_MAX)
+    return -1;
+  *timeout_ms = (uint32_t)parsed;
+  return 0;
+}
+
 static int header_name_valid(const char *name) {
   const unsigned char *cursor = (const unsigned char *)name;
   if (*cursor == '\0') return 0;
@@ -176,6 +184,11 @@ int YAP_V2_core_http_parse_head(const unsigned char *input, size_t input_bytes,
         return YAP_V2_CORE_HTTP_INVALID;
       }
       request->have_content_length = 1;
+    } else if (strcasecmp(cursor, "X-Yappo-Timeout-Ms") == 0) {
+      if (request->timeout_ms != 0U || parse_timeout_ms(value, &request->timeout_ms) != 0) {
+        free(copy);
+        return YAP_V2_CORE_HTTP_INVALID;
+      }
     } else if (strcasecmp(cursor, "Transfer-Encoding") == 0) {
       free(copy);
       return YAP_V2_CORE_HTTP_INVALID;
@@ -341,6 +354,7 @@ int YAP_V2_core_http_client_request(YAP_V2_CORE_HTTP_CLIENT *client,
   struct curl_slist *headers = NULL;
   response_buffer_t buffer = {0};
   char url[768], authorization_header[YAP_V2_AUTHORIZATION_MAX_BYTES + 32U];
+  char timeout_header[48];
   char *content_type = NULL;
   long http_status = 0L;
   int result = YAP_V2_CORE_HTTP_IO_ERROR;
@@ -359,6 +373,9 @@ int YAP_V2_core_http_client_request(YAP_V2_CORE_HTTP_CLIENT *client,
       append_header(&headers, "Connection: keep-alive") != 0 ||
       append_header(&headers, "Expect:") != 0)
     goto done;
+  (void)snprintf(timeout_header, sizeof(timeout_header), "X-Yappo-Timeout-Ms: %u",
+                 (unsigned)timeout_ms);
+  if (append_header(&headers, timeout_header) != 0) goto done;
   if (body_bytes != 0U && append_header(&headers, "Content-Type: application/json") != 0)
     goto done;
   if (authorization != NULL && authorization[0] != '\0') {
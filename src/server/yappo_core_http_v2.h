@@ -29,6 +29,8 @@ typedef struct {
   int json_content_type;
   int close_connection;
   char authorization[YAP_V2_AUTHORIZATION_MAX_BYTES + 1U];
+  /* Remaining front budget from X-Yappo-Timeout-Ms, or 0 when the header is absent. */
+  uint32_t timeout_ms;
   unsigned char *body;
   size_t body_bytes;
 } YAP_V2_CORE_HTTP_REQUEST;
@@ -59,6 +61,8 @@ int YAP_V2_core_http_read_request(FILE *stream, size_t max_body_bytes,
 int YAP_V2_core_http_write_response(FILE *stream, int status, const char *content_type,
                                     const char *allow, int accept_query,
                                     const void *body, size_t body_bytes);
+/* Sends timeout_ms as X-Yappo-Timeout-Ms so the core can drop the request once the caller
+ * has given up on it. */
 int YAP_V2_core_http_client_request(YAP_V2_CORE_HTTP_CLIENT *client,
                                     const char *host, int port,
                                     uint32_t timeout_ms, const char *method,
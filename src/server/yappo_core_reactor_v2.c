@@ -43,8 +43,12 @@ typedef struct execution {
   connection_t *connection;
   YAP_V2_HTTP_OPERATION operation;
   int health_request;
+  int admin_request;
   int limiter_acquired;
+  uint64_t submitted_microseconds;
+  YAP_V2_CANCELLATION cancellation;
   int http_status;
+  const char *content_type;
   char *json;
   size_t json_bytes;
   int result;
@@ -174,12 +178,19 @@ static void abandon_connection(connection_t *connection) {
     bufferevent_free(connection->buffered_event);
     connection->buffered_event = NULL;
   }
-  if (connection->inflight) connection->abandoned = 1;
-  else free_connection(connection);
+  if (connection->inflight) {
+    connection->abandoned = 1;
+    /* Nobody will read the result; let a running search stop at its next segment. */
+    if (connection->execution != NULL)
+      YAP_V2_cancellation_cancel(&connection->execution->cancellation);
+  } else {
+    free_connection(connection);
+  }
 }
 
 static int write_response(connection_t *connection, int status,
                           const char *allow, int accept_query,
+                          const char *content_type,
                           const char *body, size_t body_bytes) {
   struct evbuffer *output;
   if (connection == NULL || connection->buffered_event == NULL ||
@@ -192,9 +203,10 @@ static int write_response(connection_t *connection, int status,
   if (evbuffer_add_printf(
         output,
         "HTTP/1.1 %d %s\r\nServer: Yappo Search Core/2.0\r\n"
-        "Content-Type: application/json; charset=utf-8\r\n"
+        "Content-Type: %s; charset=utf-8\r\n"
         "Content-Length: %zu\r\nCache-Control: no-store\r\nConnection: %s\r\n",
-        status, reason_phrase(status), body_bytes,
+        status, reason_phrase(status),
+        content_type == NULL ? "application/json" : content_type, body_bytes,
         connection->close_after_response ? "close" : "keep-alive") < 0 ||
       (allow != NULL && evbuffer_add_printf(output, "Allow: %s\r\n", allow) < 0) ||
       (accept_query && evbuffer_add(output, "Accept-Query: application/json\r\n",
@@ -217,7 +229,7 @@ static void respond_error(connection_t *connection, int status,
   char *json = NULL;
   size_t json_bytes = 0U;
   if (make_error_json(code, message, &json, &json_bytes) != YAP_V2_OK ||
-      write_response(connection, status, allow, accept_query, json,
+      write_response(connection, status, allow, accept_query, NULL, json,
                      json_bytes) != YAP_V2_OK) {
     free(json);
     abandon_connection(connection);
@@ -252,10 +264,18 @@ static void run_execution(void *opaque) {
   connection_t *connection = execution->connection;
   if (execution->health_request) {
     YAP_V2_OPERATIONAL_STATE state, disk_state;
+    YAP_V2_RUNTIME_LIMITER_STATE admission;
     char error[256] = {0};
     memset(&state, 0, sizeof(state));
     memset(&disk_state, 0, sizeof(disk_state));
     execution->result = YAP_V2_http_runtime_state(server->runtime, &state);
+    if (execution->result == YAP_V2_OK)
+      execution->result = YAP_V2_runtime_limiter_state(server->search_limiter, &admission);
+    if (execution->result == YAP_V2_OK) {
+      state.core_concurrency_limit = admission.limit;
+      state.core_rtt_noload_microseconds = admission.rtt_noload_microseconds;
+      state.core_admission_rejected = admission.rejected;
+    }
     if (execution->result == YAP_V2_OK &&
         YAP_V2_operational_probe_index_with_policy(
           server->index_dir, &server->compaction_policy, &disk_state,
@@ -282,15 +302,45 @@ static void run_execution(void *opaque) {
     if (YAP_V2_operational_state_json(&state, "yappod_core", &execution->json,
                                       &execution->json_bytes) != YAP_V2_OK)
       execution->result = YAP_V2_IO_ERROR;
+  } else if (execution->admin_request) {
+    execution->result = YAP_V2_http_runtime_slow_queries(
+      server->runtime, YAP_V2_CORE_HTTP_MAX_RESPONSE_BYTES, &execution->json,
+      &execution->json_bytes);
+    execution->http_status = 200;
+    execution->content_type = "application/x-ndjson";
   } else {
-    execution->result = YAP_V2_http_runtime_execute(
+    if (execution->operation == YAP_V2_HTTP_SEARCH)
+      YAP_V2_http_runtime_record_search_stage(
+        server->runtime, YAP_V2_SEARCH_STAGE_QUEUE_WAIT,
+        YAP_V2_cancellation_clock_microseconds() - execution->submitted_microseconds);
+    execution->result = YAP_V2_http_runtime_execute_cancellable(
       server->runtime, execution->operation, connection->request.body,
-      connection->request.body_bytes, &execution->http_status,
-      &execution->json, &execution->json_bytes);
+      connection->request.body_bytes, &execution->cancellation,
+      &execution->http_status, &execution->json, &execution->json_bytes);
   }
   enqueue_message(execution->reactor, &execution->message);
 }
 
+/* Called by the executor instead of run_execution when the deadline passed in the queue. */
+static void expire_execution(void *opaque) {
+  execution_t *execution = opaque;
+  YAP_V2_http_runtime_record_search_expired(execution->reactor->server->runtime);
+  execution->http_status = 503;
+  execution->result = make_error_json("deadline_exceeded",
+                                      "search deadline expired before execution",
+                                      &execution->json, &execution->json_bytes);
+  enqueue_message(execution->reactor, &execution->message);
+}
+
+/* The front sends its remaining budget; the core never waits longer than its own limit. */
+static uint64_t execution_deadline(const server_state_t *server,
+                                   const YAP_V2_CORE_HTTP_REQUEST *request) {
+  uint32_t timeout_ms = server->runtime_policy.request_timeout_ms;
+  if (request->timeout_ms != 0U && request->timeout_ms < timeout_ms)
+    timeout_ms = request->timeout_ms;
+  return YAP_V2_cancellation_clock_microseconds() + (uint64_t)timeout_ms * 1000U;
+}
+
 void YAP_V2_core_reactor_execute_ingest_batch(void *context, void **items,
                                               size_t item_count) {
   execution_t **executions = (execution_t **)items;
@@ -333,16 +383,19 @@ void YAP_V2_core_reactor_execute_ingest_batch(void *context, void **items,
 }
 
 static const char *allow_for_target(const char *target) {
-  if (strcmp(target, "/v2/search") == 0 || strcmp(target, "/v2/retrieve") == 0)
+  if (strcmp(target, "/v2/search") == 0 || strcmp(target, "/v2/retrieve") == 0 ||
+      strcmp(target, "/v2/suggest") == 0)
     return "QUERY";
   if (strcmp(target, "/v2/documents:batch") == 0) return "POST";
-  if (strcmp(target, "/health/ready") == 0) return "GET";
+  if (strcmp(target, "/health/ready") == 0 ||
+      strcmp(target, "/admin/slow-queries") == 0) return "GET";
   return NULL;
 }
 
 static int is_query_target(const char *target) {
   return strcmp(target, "/v2/search") == 0 ||
-         strcmp(target, "/v2/retrieve") == 0;
+         strcmp(target, "/v2/retrieve") == 0 ||
+         strcmp(target, "/v2/suggest") == 0;
 }
 
 static void submit_request(connection_t *connection) {
@@ -361,13 +414,12 @@ static void submit_request(connection_t *connection) {
   if ((accept_query && strcmp(request->method, "QUERY") != 0) ||
       (strcmp(request->target, "/v2/documents:batch") == 0 &&
        strcmp(request->method, "POST") != 0) ||
-      (strcmp(request->target, "/health/ready") == 0 &&
-       strcmp(request->method, "GET") != 0)) {
+      (strcmp(allow, "GET") == 0 && strcmp(request->method, "GET") != 0)) {
     respond_error(connection, 405, "method_not_allowed", "Method Not Allowed",
                   allow, accept_query);
     return;
   }
-  if (strcmp(request->target, "/health/ready") == 0) {
+  if (strcmp(allow, "GET") == 0) {
     if (request->have_content_length) {
       respond_error(connection, 400, "invalid_request", "Bad Request", "GET", 0);
       return;
@@ -393,13 +445,17 @@ static void submit_request(connection_t *connection) {
   execution->reactor = reactor;
   execution->connection = connection;
   execution->health_request = strcmp(request->target, "/health/ready") == 0;
+  execution->admin_request = strcmp(request->target, "/admin/slow-queries") == 0;
   if (strcmp(request->target, "/v2/retrieve") == 0)
     execution->operation = YAP_V2_HTTP_RETRIEVE;
+  else if (strcmp(request->target, "/v2/suggest") == 0)
+    execution->operation = YAP_V2_HTTP_SUGGEST;
   else if (strcmp(request->target, "/v2/documents:batch") == 0)
     execution->operation = YAP_V2_HTTP_INGEST;
   else
     execution->operation = YAP_V2_HTTP_SEARCH;
-  if (execution->operation == YAP_V2_HTTP_INGEST &&
+  /* The slow-query log holds other clients' queries, so it takes the write token too. */
+  if ((execution->operation == YAP_V2_HTTP_INGEST || execution->admin_request) &&
       YAP_V2_authorize_write(
         &server->runtime_policy,
         request->authorization[0] == '\0' ? NULL : request->authorization) != YAP_V2_OK) {
@@ -407,7 +463,7 @@ static void submit_request(connection_t *connection) {
     respond_error(connection, 401, "unauthorized", "Unauthorized", NULL, 0);
     return;
   }
-  if (!execution->health_request &&
+  if (!execution->health_request && !execution->admin_request &&
       execution->operation != YAP_V2_HTTP_INGEST) {
     if (YAP_V2_runtime_limiter_acquire(server->search_limiter,
                                        request->body_bytes) != YAP_V2_OK) {
@@ -416,6 +472,7 @@ static void submit_request(connection_t *connection) {
       return;
     }
     execution->limiter_acquired = 1;
+    execution->submitted_microseconds = YAP_V2_cancellation_clock_microseconds();
   }
   connection->execution = execution;
   connection->inflight = 1;
@@ -425,7 +482,15 @@ static void submit_request(connection_t *connection) {
                                              execution);
   else {
     executor = server->search_executor;
-    status = YAP_V2_executor_try_submit(executor, run_execution, execution);
+    if (execution->health_request || execution->admin_request) {
+      status = YAP_V2_executor_try_submit(executor, run_execution, execution);
+    } else {
+      YAP_V2_cancellation_init(&execution->cancellation,
+                               execution_deadline(server, request));
+      status = YAP_V2_executor_try_submit_deadline(
+        executor, run_execution, expire_execution, execution,
+        execution->cancellation.deadline_microseconds);
+    }
   }
   if (status != YAP_V2_OK) {
     connection->execution = NULL;
@@ -599,12 +664,29 @@ static void add_connection(reactor_t *reactor, int descriptor) {
     abandon_connection(connection);
 }
 
+/* Expired in the queue or cancelled by its deadline mid-search; either way the core was too
+ * slow for it, which the limiter must hear about. */
+static int execution_missed_deadline(const execution_t *execution) {
+  return execution->http_status == 503 &&
+         execution->cancellation.deadline_microseconds != 0U &&
+         YAP_V2_cancellation_clock_microseconds() >=
+           execution->cancellation.deadline_microseconds;
+}
+
 static void complete_execution(execution_t *execution) {
   connection_t *connection = execution->connection;
   server_state_t *server = execution->reactor->server;
   connection->execution = NULL;
   connection->inflight = 0;
-  if (execution->limiter_acquired)
+  if (execution->limiter_acquired && execution->result == YAP_V2_OK &&
+      execution->http_status == 200)
+    YAP_V2_runtime_limiter_release_observed(
+      server->search_limiter, connection->request.body_bytes,
+      YAP_V2_cancellation_clock_microseconds() - execution->submitted_microseconds);
+  else if (execution->limiter_acquired && execution_missed_deadline(execution))
+    YAP_V2_runtime_limiter_release_dropped(server->search_limiter,
+                                           connection->request.body_bytes);
+  else if (execution->limiter_acquired)
     YAP_V2_runtime_limiter_release(server->search_limiter,
                                    connection->request.body_bytes);
   if (connection->abandoned || connection->buffered_event == NULL) {
@@ -616,7 +698,8 @@ static void complete_execution(execution_t *execution) {
   if (execution->result != YAP_V2_OK ||
       write_response(connection, execution->http_status, NULL,
                      is_query_target(connection->request.target),
-                     execution->json, execution->json_bytes) != YAP_V2_OK) {
+                     execution->content_type, execution->json,
+                     execution->json_bytes) != YAP_V2_OK) {
     free(execution->json);
     free(execution);
     abandon_connection(connection);
@@ -8,15 +8,66 @@
 
 #include "common/yappo_types_v2.h"
 
+#define EXECUTOR_CACHE_LINE 64U
+/* Injection queues by slack at submission: class k holds jobs with at most 2 ms << 3k
+ * left, the next class longer deadlines and the last class jobs without one. */
+#define EXECUTOR_DEADLINE_CLASSES 8U
+#define EXECUTOR_FIRST_SLACK_MICROSECONDS 2048U
+
+/* deadline_microseconds is on the YAP_V2_cancellation_clock_microseconds clock; 0 means
+ * the job never expires. */
 typedef struct {
   YAP_V2_EXECUTOR_FUNCTION function;
+  YAP_V2_EXECUTOR_FUNCTION expire_function;
   void *context;
+  uint64_t deadline_microseconds;
 } EXECUTOR_JOB;
 
+/* Chase-Lev deque. The owning worker pushes and pops at bottom; other workers steal
+ * from top. Slots never wrap onto a live job because the executor-wide queued count
+ * never exceeds queue_capacity, which is at most the deque capacity. */
+typedef struct {
+  int64_t top;
+  char top_padding[EXECUTOR_CACHE_LINE - sizeof(int64_t)];
+  int64_t bottom;
+  char bottom_padding[EXECUTOR_CACHE_LINE - sizeof(int64_t)];
+  EXECUTOR_JOB *jobs;
+  size_t mask;
+} EXECUTOR_DEQUE;
+
+typedef struct {
+  size_t sequence;
+  EXECUTOR_JOB job;
+} INJECTION_CELL;
+
+/* Bounded multi-producer multi-consumer queue for jobs submitted by non-worker threads. */
 typedef struct {
+  size_t enqueue_position;
+  char enqueue_padding[EXECUTOR_CACHE_LINE - sizeof(size_t)];
+  size_t dequeue_position;
+  char dequeue_padding[EXECUTOR_CACHE_LINE - sizeof(size_t)];
+  INJECTION_CELL *cells;
+  size_t mask;
+} INJECTION_QUEUE;
+
+typedef struct EXECUTOR_STATE EXECUTOR_STATE;
+
+typedef struct {
+  EXECUTOR_STATE *state;
+  EXECUTOR_DEQUE deque;
+  size_t index;
+} EXECUTOR_WORKER;
+
+/* Counters, accepting and sleepers are accessed only through the __atomic builtins.
+ * lock and available park idle workers and drive the batch worker; the work-stealing
+ * path never takes lock while a job is submitted or dequeued unless a worker sleeps. */
+struct EXECUTOR_STATE {
   pthread_mutex_t lock;
   pthread_cond_t available;
+  pthread_key_t worker_key;
   pthread_t *threads;
+  EXECUTOR_WORKER *workers;
+  INJECTION_QUEUE injection[EXECUTOR_DEADLINE_CLASSES];
   EXECUTOR_JOB *jobs;
   size_t worker_threads;
   size_t started_threads;
@@ -27,53 +78,223 @@ typedef struct {
   size_t submitted;
   size_t completed;
   size_t rejected;
+  size_t expired;
+  size_t sleepers;
   int accepting;
-  int initialized;
+  int worker_key_created;
   size_t max_batch;
   uint32_t max_delay_microseconds;
   YAP_V2_EXECUTOR_BATCH_FUNCTION batch_function;
   void *batch_context;
   void **batch_items;
-} EXECUTOR_STATE;
+};
 
-static void deadline_after_microseconds(struct timespec *deadline,
-                                        uint32_t microseconds) {
-  (void)clock_gettime(CLOCK_REALTIME, deadline);
-  deadline->tv_sec += (time_t)(microseconds / 1000000U);
-  deadline->tv_nsec += (long)(microseconds % 1000000U) * 1000L;
-  if (deadline->tv_nsec >= 1000000000L) {
-    deadline->tv_sec++;
-    deadline->tv_nsec -= 1000000000L;
+static size_t counter_load(const size_t *counter) {
+  return __atomic_load_n(counter, __ATOMIC_SEQ_CST);
+}
+
+static size_t counter_add(size_t *counter, size_t value) {
+  return __atomic_add_fetch(counter, value, __ATOMIC_SEQ_CST);
+}
+
+static void counter_sub(size_t *counter, size_t value) {
+  (void)__atomic_sub_fetch(counter, value, __ATOMIC_SEQ_CST);
+}
+
+static int state_accepting(const EXECUTOR_STATE *state) {
+  return __atomic_load_n(&state->accepting, __ATOMIC_SEQ_CST);
+}
+
+static void set_accepting(EXECUTOR_STATE *state, int accepting) {
+  __atomic_store_n(&state->accepting, accepting, __ATOMIC_SEQ_CST);
+}
+
+static size_t power_of_two_at_least(size_t value) {
+  size_t result = 1U;
+  while (result < value) result <<= 1U;
+  return result;
+}
+
+static void deque_push(EXECUTOR_DEQUE *deque, const EXECUTOR_JOB *job) {
+  int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+  deque->jobs[(size_t)bottom & deque->mask] = *job;
+  __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+}
+
+static int deque_pop(EXECUTOR_DEQUE *deque, EXECUTOR_JOB *job) {
+  int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1, top;
+  int taken = 1;
+  __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+  if (top > bottom) {
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return 0;
+  }
+  *job = deque->jobs[(size_t)bottom & deque->mask];
+  if (top == bottom) {
+    /* The last job races with thieves; whoever advances top owns it. */
+    taken = __atomic_compare_exchange_n(&deque->top, &top, top + 1, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
   }
+  return taken;
 }
 
-static void *run_worker(void *opaque) {
-  EXECUTOR_STATE *state = opaque;
+static int deque_steal(EXECUTOR_DEQUE *deque, EXECUTOR_JOB *job) {
+  int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE), bottom;
+  EXECUTOR_JOB candidate;
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+  if (top >= bottom) return 0;
+  candidate = deque->jobs[(size_t)top & deque->mask];
+  if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0,
+                                   __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    return 0;
+  *job = candidate;
+  return 1;
+}
+
+static int injection_push(INJECTION_QUEUE *queue, const EXECUTOR_JOB *job) {
+  size_t position = __atomic_load_n(&queue->enqueue_position, __ATOMIC_RELAXED);
+  INJECTION_CELL *cell;
   for (;;) {
-    EXECUTOR_JOB job;
-    pthread_mutex_lock(&state->lock);
-    while (state->queued == 0U && state->accepting)
-      pthread_cond_wait(&state->available, &state->lock);
-    if (state->queued == 0U && !state->accepting) {
-      pthread_mutex_unlock(&state->lock);
-      break;
+    size_t sequence;
+    intptr_t difference;
+    cell = &queue->cells[position & queue->mask];
+    sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+    difference = (intptr_t)sequence - (intptr_t)position;
+    if (difference == 0) {
+      if (__atomic_compare_exchange_n(&queue->enqueue_position, &position, position + 1U, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        break;
+    } else if (difference < 0) {
+      return 0;
+    } else {
+      position = __atomic_load_n(&queue->enqueue_position, __ATOMIC_RELAXED);
     }
-    job = state->jobs[state->head];
-    state->head = (state->head + 1U) % state->queue_capacity;
-    state->queued--;
-    state->active++;
-    pthread_mutex_unlock(&state->lock);
+  }
+  cell->job = *job;
+  __atomic_store_n(&cell->sequence, position + 1U, __ATOMIC_RELEASE);
+  return 1;
+}
 
-    job.function(job.context);
+static int injection_pop(INJECTION_QUEUE *queue, EXECUTOR_JOB *job) {
+  size_t position = __atomic_load_n(&queue->dequeue_position, __ATOMIC_RELAXED);
+  INJECTION_CELL *cell;
+  for (;;) {
+    size_t sequence;
+    intptr_t difference;
+    cell = &queue->cells[position & queue->mask];
+    sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+    difference = (intptr_t)sequence - (intptr_t)(position + 1U);
+    if (difference == 0) {
+      if (__atomic_compare_exchange_n(&queue->dequeue_position, &position, position + 1U, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        break;
+    } else if (difference < 0) {
+      return 0;
+    } else {
+      position = __atomic_load_n(&queue->dequeue_position, __ATOMIC_RELAXED);
+    }
+  }
+  *job = cell->job;
+  __atomic_store_n(&cell->sequence, position + queue->mask + 1U, __ATOMIC_RELEASE);
+  return 1;
+}
 
-    pthread_mutex_lock(&state->lock);
-    state->active--;
-    state->completed++;
-    pthread_mutex_unlock(&state->lock);
+/* Classifies by the time left at submission. Jobs of one class run in submission order,
+ * so ordering is earliest deadline first only up to the width of a class. */
+static size_t deadline_class(uint64_t deadline_microseconds) {
+  uint64_t now, slack, bound = EXECUTOR_FIRST_SLACK_MICROSECONDS;
+  size_t index = 0U;
+  if (deadline_microseconds == 0U) return EXECUTOR_DEADLINE_CLASSES - 1U;
+  now = YAP_V2_cancellation_clock_microseconds();
+  slack = deadline_microseconds > now ? deadline_microseconds - now : 0U;
+  while (index < EXECUTOR_DEADLINE_CLASSES - 2U && slack > bound) {
+    bound <<= 3U;
+    index++;
+  }
+  return index;
+}
+
+/* Own deque first for locality, then the injection queues from the tightest deadline
+ * class, then the other workers starting after self so thieves spread over victims. */
+static int find_job(EXECUTOR_STATE *state, EXECUTOR_WORKER *self, EXECUTOR_JOB *job) {
+  size_t first = self == NULL ? 0U : self->index + 1U, i;
+  if (self != NULL && deque_pop(&self->deque, job)) return 1;
+  for (i = 0U; i < EXECUTOR_DEADLINE_CLASSES; i++)
+    if (injection_pop(&state->injection[i], job)) return 1;
+  for (i = 0U; i < state->worker_threads; i++) {
+    EXECUTOR_WORKER *victim = &state->workers[(first + i) % state->worker_threads];
+    if (victim != self && deque_steal(&victim->deque, job)) return 1;
+  }
+  return 0;
+}
+
+/* A job whose deadline passed while it waited runs its expire function instead, so the
+ * owner can answer without spending a worker on a result nobody will read. */
+static void run_job(EXECUTOR_STATE *state, const EXECUTOR_JOB *job) {
+  counter_sub(&state->queued, 1U);
+  (void)counter_add(&state->active, 1U);
+  if (job->expire_function != NULL && job->deadline_microseconds != 0U &&
+      YAP_V2_cancellation_clock_microseconds() >= job->deadline_microseconds) {
+    (void)counter_add(&state->expired, 1U);
+    job->expire_function(job->context);
+  } else {
+    job->function(job->context);
+  }
+  counter_sub(&state->active, 1U);
+  (void)counter_add(&state->completed, 1U);
+}
+
+/* Returns 0 once the executor is closed and drained. The sleeper count is published
+ * before queued is re-read so a concurrent submit either sees the sleeper or is seen. */
+static int park_worker(EXECUTOR_STATE *state) {
+  int running;
+  pthread_mutex_lock(&state->lock);
+  (void)counter_add(&state->sleepers, 1U);
+  while (counter_load(&state->queued) == 0U && state_accepting(state))
+    pthread_cond_wait(&state->available, &state->lock);
+  counter_sub(&state->sleepers, 1U);
+  running = counter_load(&state->queued) != 0U || state_accepting(state);
+  pthread_mutex_unlock(&state->lock);
+  return running;
+}
+
+static void wake_worker(EXECUTOR_STATE *state) {
+  if (counter_load(&state->sleepers) == 0U) return;
+  pthread_mutex_lock(&state->lock);
+  pthread_cond_signal(&state->available);
+  pthread_mutex_unlock(&state->lock);
+}
+
+static void *run_worker(void *opaque) {
+  EXECUTOR_WORKER *worker = opaque;
+  EXECUTOR_STATE *state = worker->state;
+  (void)pthread_setspecific(state->worker_key, worker);
+  for (;;) {
+    EXECUTOR_JOB job;
+    if (find_job(state, worker, &job)) {
+      run_job(state, &job);
+      continue;
+    }
+    if (!park_worker(state)) break;
   }
   return NULL;
 }
 
+static void deadline_after_microseconds(struct timespec *deadline,
+                                        uint32_t microseconds) {
+  (void)clock_gettime(CLOCK_REALTIME, deadline);
+  deadline->tv_sec += (time_t)(microseconds / 1000000U);
+  deadline->tv_nsec += (long)(microseconds % 1000000U) * 1000L;
+  if (deadline->tv_nsec >= 1000000000L) {
+    deadline->tv_sec++;
+    deadline->tv_nsec -= 1000000000L;
+  }
+}
+
 static void *run_batch_worker(void *opaque) {
   EXECUTOR_STATE *state = opaque;
   void **items = state->batch_items;
@@ -81,36 +302,85 @@ static void *run_batch_worker(void *opaque) {
     size_t count = 0U;
     struct timespec deadline;
     pthread_mutex_lock(&state->lock);
-    while (state->queued == 0U && state->accepting)
+    while (counter_load(&state->queued) == 0U && state_accepting(state))
       pthread_cond_wait(&state->available, &state->lock);
-    if (state->queued == 0U && !state->accepting) {
+    if (counter_load(&state->queued) == 0U && !state_accepting(state)) {
       pthread_mutex_unlock(&state->lock);
       break;
     }
     deadline_after_microseconds(&deadline, state->max_delay_microseconds);
-    while (state->accepting && state->queued < state->max_batch) {
+    while (state_accepting(state) && counter_load(&state->queued) < state->max_batch) {
       int wait_status = pthread_cond_timedwait(&state->available, &state->lock,
                                                &deadline);
       if (wait_status != 0) break;
     }
-    while (count < state->max_batch && state->queued != 0U) {
+    while (count < state->max_batch && counter_load(&state->queued) != 0U) {
       items[count++] = state->jobs[state->head].context;
       state->head = (state->head + 1U) % state->queue_capacity;
-      state->queued--;
+      counter_sub(&state->queued, 1U);
     }
-    state->active += count;
+    (void)counter_add(&state->active, count);
     pthread_mutex_unlock(&state->lock);
 
     state->batch_function(state->batch_context, items, count);
 
-    pthread_mutex_lock(&state->lock);
-    state->active -= count;
-    state->completed += count;
-    pthread_mutex_unlock(&state->lock);
+    counter_sub(&state->active, count);
+    (void)counter_add(&state->completed, count);
+  }
+  return NULL;
+}
+
+static void state_free(EXECUTOR_STATE *state) {
+  size_t i;
+  if (state == NULL) return;
+  if (state->workers != NULL)
+    for (i = 0U; i < state->worker_threads; i++) free(state->workers[i].deque.jobs);
+  if (state->worker_key_created) (void)pthread_key_delete(state->worker_key);
+  for (i = 0U; i < EXECUTOR_DEADLINE_CLASSES; i++) free(state->injection[i].cells);
+  free(state->workers);
+  free(state->threads);
+  free(state->jobs);
+  free(state->batch_items);
+  free(state);
+}
+
+static EXECUTOR_STATE *state_create(size_t worker_threads, size_t queue_capacity,
+                                    int *status) {
+  EXECUTOR_STATE *state = calloc(1U, sizeof(*state));
+  *status = YAP_V2_ALLOCATION_FAILED;
+  if (state == NULL) return NULL;
+  state->worker_threads = worker_threads;
+  state->queue_capacity = queue_capacity;
+  state->threads = calloc(worker_threads, sizeof(*state->threads));
+  if (state->threads == NULL) goto fail;
+  if (pthread_mutex_init(&state->lock, NULL) != 0) {
+    *status = YAP_V2_IO_ERROR;
+    goto fail;
   }
+  if (pthread_cond_init(&state->available, NULL) != 0) {
+    pthread_mutex_destroy(&state->lock);
+    *status = YAP_V2_IO_ERROR;
+    goto fail;
+  }
+  state->accepting = 1;
+  *status = YAP_V2_OK;
+  return state;
+fail:
+  state_free(state);
   return NULL;
 }
 
+static void state_stop(EXECUTOR_STATE *state) {
+  size_t i;
+  set_accepting(state, 0);
+  pthread_mutex_lock(&state->lock);
+  pthread_cond_broadcast(&state->available);
+  pthread_mutex_unlock(&state->lock);
+  for (i = 0U; i < state->started_threads; i++)
+    (void)pthread_join(state->threads[i], NULL);
+  state->started_threads = 0U;
+}
+
 void YAP_V2_executor_init(YAP_V2_EXECUTOR *executor) {
   if (executor != NULL) executor->state = NULL;
 }
@@ -118,55 +388,66 @@ void YAP_V2_executor_init(YAP_V2_EXECUTOR *executor) {
 int YAP_V2_executor_open(YAP_V2_EXECUTOR *executor, size_t worker_threads,
                          size_t queue_capacity) {
   EXECUTOR_STATE *state;
-  size_t i;
+  size_t capacity, i;
+  int status;
   if (executor == NULL || executor->state != NULL || worker_threads == 0U ||
-      queue_capacity == 0U ||
+      queue_capacity == 0U || queue_capacity > SIZE_MAX / 4U ||
+      power_of_two_at_least(queue_capacity) > SIZE_MAX / sizeof(INJECTION_CELL) ||
       worker_threads > SIZE_MAX / sizeof(pthread_t) ||
-      queue_capacity > SIZE_MAX / sizeof(EXECUTOR_JOB))
+      worker_threads > SIZE_MAX / sizeof(EXECUTOR_WORKER) ||
+      power_of_two_at_least(queue_capacity) > SIZE_MAX / sizeof(EXECUTOR_JOB))
     return YAP_V2_INVALID_ARGUMENT;
-  state = calloc(1U, sizeof(*state));
-  if (state == NULL) return YAP_V2_ALLOCATION_FAILED;
-  state->threads = calloc(worker_threads, sizeof(*state->threads));
-  state->jobs = calloc(queue_capacity, sizeof(*state->jobs));
-  if (state->threads == NULL || state->jobs == NULL) {
-    free(state->threads);
-    free(state->jobs);
-    free(state);
-    return YAP_V2_ALLOCATION_FAILED;
+  state = state_create(worker_threads, queue_capacity, &status);
+  if (state == NULL) return status;
+  capacity = power_of_two_at_least(queue_capacity);
+  state->workers = calloc(worker_threads, sizeof(*state->workers));
+  status = state->workers == NULL ? YAP_V2_ALLOCATION_FAILED : YAP_V2_OK;
+  for (i = 0U; status == YAP_V2_OK && i < EXECUTOR_DEADLINE_CLASSES; i++) {
+    INJECTION_QUEUE *queue = &state->injection[i];
+    size_t j;
+    /* Every class can hold all queued jobs, since one class may receive all of them. */
+    queue->cells = calloc(capacity, sizeof(*queue->cells));
+    if (queue->cells == NULL) {
+      status = YAP_V2_ALLOCATION_FAILED;
+      break;
+    }
+    queue->mask = capacity - 1U;
+    for (j = 0U; j < capacity; j++) queue->cells[j].sequence = j;
   }
-  if (pthread_mutex_init(&state->lock, NULL) != 0) {
-    free(state->threads);
-    free(state->jobs);
-    free(state);
-    return YAP_V2_IO_ERROR;
+  if (status != YAP_V2_OK) {
+    pthread_cond_destroy(&state->available);
+    pthread_mutex_destroy(&state->lock);
+    state_free(state);
+    return status;
   }
-  if (pthread_cond_init(&state->available, NULL) != 0) {
+  for (i = 0U; i < worker_threads; i++) {
+    state->workers[i].state = state;
+    state->workers[i].index = i;
+    state->workers[i].deque.mask = capacity - 1U;
+    state->workers[i].deque.jobs = calloc(capacity, sizeof(EXECUTOR_JOB));
+    if (state->workers[i].deque.jobs == NULL) {
+      pthread_cond_destroy(&state->available);
+      pthread_mutex_destroy(&state->lock);
+      state_free(state);
+      return YAP_V2_ALLOCATION_FAILED;
+    }
+  }
+  if (pthread_key_create(&state->worker_key, NULL) != 0) {
+    pthread_cond_destroy(&state->available);
     pthread_mutex_destroy(&state->lock);
-    free(state->threads);
-    free(state->jobs);
-    free(state);
+    state_free(state);
     return YAP_V2_IO_ERROR;
   }
-  state->worker_threads = worker_threads;
-  state->queue_capacity = queue_capacity;
-  state->accepting = 1;
-  state->initialized = 1;
+  state->worker_key_created = 1;
   for (i = 0U; i < worker_threads; i++) {
-    if (pthread_create(&state->threads[i], NULL, run_worker, state) != 0) break;
+    if (pthread_create(&state->threads[i], NULL, run_worker, &state->workers[i]) != 0) break;
     state->started_threads++;
   }
   if (state->started_threads != worker_threads) {
-    pthread_mutex_lock(&state->lock);
-    state->accepting = 0;
-    pthread_cond_broadcast(&state->available);
-    pthread_mutex_unlock(&state->lock);
-    for (i = 0U; i < state->started_threads; i++)
-      (void)pthread_join(state->threads[i], NULL);
+    state_stop(state);
     pthread_cond_destroy(&state->available);
     pthread_mutex_destroy(&state->lock);
-    free(state->threads);
-    free(state->jobs);
-    free(state);
+    state_free(state);
     return YAP_V2_IO_ERROR;
   }
   executor->state = state;
@@ -182,62 +463,81 @@ int YAP_V2_executor_open_batch(YAP_V2_EXECUTOR *executor,
   int status;
   if (executor == NULL || executor->state != NULL || queue_capacity == 0U ||
       max_batch == 0U || max_batch > queue_capacity ||
-      max_delay_microseconds == 0U || function == NULL)
+      max_delay_microseconds == 0U || function == NULL ||
+      queue_capacity > SIZE_MAX / sizeof(EXECUTOR_JOB))
     return YAP_V2_INVALID_ARGUMENT;
-  status = YAP_V2_executor_open(executor, 1U, queue_capacity);
-  if (status != YAP_V2_OK) return status;
-  state = executor->state;
-  pthread_mutex_lock(&state->lock);
+  state = state_create(1U, queue_capacity, &status);
+  if (state == NULL) return status;
   state->max_batch = max_batch;
   state->max_delay_microseconds = max_delay_microseconds;
   state->batch_function = function;
   state->batch_context = batch_context;
-  pthread_mutex_unlock(&state->lock);
-  /* Replace the ordinary worker before it can consume submitted work. */
-  pthread_mutex_lock(&state->lock);
-  state->accepting = 0;
-  pthread_cond_broadcast(&state->available);
-  pthread_mutex_unlock(&state->lock);
-  (void)pthread_join(state->threads[0], NULL);
-  state->started_threads = 0U;
+  state->jobs = calloc(queue_capacity, sizeof(*state->jobs));
   state->batch_items = calloc(max_batch, sizeof(*state->batch_items));
-  if (state->batch_items == NULL) {
-    YAP_V2_executor_close(executor);
+  if (state->jobs == NULL || state->batch_items == NULL) {
+    pthread_cond_destroy(&state->available);
+    pthread_mutex_destroy(&state->lock);
+    state_free(state);
     return YAP_V2_ALLOCATION_FAILED;
   }
-  pthread_mutex_lock(&state->lock);
-  state->accepting = 1;
-  pthread_mutex_unlock(&state->lock);
   if (pthread_create(&state->threads[0], NULL, run_batch_worker, state) != 0) {
-    YAP_V2_executor_close(executor);
+    pthread_cond_destroy(&state->available);
+    pthread_mutex_destroy(&state->lock);
+    state_free(state);
     return YAP_V2_IO_ERROR;
   }
   state->started_threads = 1U;
+  executor->state = state;
   return YAP_V2_OK;
 }
 
+/* A slot is reserved in queued before accepting is re-checked, so close either
+ * rejects the job or keeps a worker running until it has been pushed and drained. */
+static int reserve_slot(EXECUTOR_STATE *state) {
+  if (counter_add(&state->queued, 1U) > state->queue_capacity || !state_accepting(state)) {
+    counter_sub(&state->queued, 1U);
+    (void)counter_add(&state->rejected, 1U);
+    return 0;
+  }
+  return 1;
+}
+
 int YAP_V2_executor_try_submit(YAP_V2_EXECUTOR *executor,
                                YAP_V2_EXECUTOR_FUNCTION function,
                                void *context) {
+  return YAP_V2_executor_try_submit_deadline(executor, function, NULL, context, 0U);
+}
+
+int YAP_V2_executor_try_submit_deadline(YAP_V2_EXECUTOR *executor,
+                                        YAP_V2_EXECUTOR_FUNCTION function,
+                                        YAP_V2_EXECUTOR_FUNCTION expire_function,
+                                        void *context, uint64_t deadline_microseconds) {
   EXECUTOR_STATE *state;
-  size_t tail;
-  if (executor == NULL || executor->state == NULL || function == NULL)
+  EXECUTOR_WORKER *worker;
+  EXECUTOR_JOB job;
+  if (executor == NULL || executor->state == NULL || function == NULL ||
+      (deadline_microseconds != 0U && expire_function == NULL))
     return YAP_V2_INVALID_ARGUMENT;
   state = executor->state;
-  pthread_mutex_lock(&state->lock);
-  if (state->batch_function != NULL || !state->accepting ||
-      state->queued == state->queue_capacity) {
-    state->rejected++;
-    pthread_mutex_unlock(&state->lock);
+  if (state->batch_function != NULL) {
+    (void)counter_add(&state->rejected, 1U);
     return YAP_V2_EXECUTOR_FULL;
   }
-  tail = (state->head + state->queued) % state->queue_capacity;
-  state->jobs[tail].function = function;
-  state->jobs[tail].context = context;
-  state->queued++;
-  state->submitted++;
-  pthread_cond_signal(&state->available);
-  pthread_mutex_unlock(&state->lock);
+  if (!reserve_slot(state)) return YAP_V2_EXECUTOR_FULL;
+  job.function = function;
+  job.expire_function = expire_function;
+  job.context = context;
+  job.deadline_microseconds = deadline_microseconds;
+  (void)counter_add(&state->submitted, 1U);
+  worker = pthread_getspecific(state->worker_key);
+  if (worker != NULL) {
+    deque_push(&worker->deque, &job);
+  } else {
+    INJECTION_QUEUE *queue = &state->injection[deadline_class(deadline_microseconds)];
+    /* Cannot fail: queued <= queue_capacity <= injection capacity. */
+    while (!injection_push(queue, &job)) {}
+  }
+  wake_worker(state);
   return YAP_V2_OK;
 }
 
@@ -248,58 +548,62 @@ int YAP_V2_executor_try_submit_item(YAP_V2_EXECUTOR *executor, void *item) {
     return YAP_V2_INVALID_ARGUMENT;
   state = executor->state;
   pthread_mutex_lock(&state->lock);
-  if (state->batch_function == NULL || !state->accepting ||
-      state->queued == state->queue_capacity) {
-    state->rejected++;
+  if (state->batch_function == NULL || !state_accepting(state) ||
+      counter_load(&state->queued) == state->queue_capacity) {
+    (void)counter_add(&state->rejected, 1U);
     pthread_mutex_unlock(&state->lock);
     return YAP_V2_EXECUTOR_FULL;
   }
-  tail = (state->head + state->queued) % state->queue_capacity;
+  tail = (state->head + counter_load(&state->queued)) % state->queue_capacity;
   state->jobs[tail].function = NULL;
   state->jobs[tail].context = item;
-  state->queued++;
-  state->submitted++;
+  (void)counter_add(&state->queued, 1U);
+  (void)counter_add(&state->submitted, 1U);
   pthread_cond_signal(&state->available);
   pthread_mutex_unlock(&state->lock);
   return YAP_V2_OK;
 }
 
+int YAP_V2_executor_help(YAP_V2_EXECUTOR *executor) {
+  EXECUTOR_STATE *state;
+  EXECUTOR_JOB job;
+  if (executor == NULL || executor->state == NULL) return 0;
+  state = executor->state;
+  if (state->batch_function != NULL) return 0;
+  if (!find_job(state, pthread_getspecific(state->worker_key), &job)) return 0;
+  run_job(state, &job);
+  return 1;
+}
+
 int YAP_V2_executor_snapshot(YAP_V2_EXECUTOR *executor,
                              YAP_V2_EXECUTOR_STATE *snapshot) {
   EXECUTOR_STATE *state;
+  size_t queued;
   if (executor == NULL || executor->state == NULL || snapshot == NULL)
     return YAP_V2_INVALID_ARGUMENT;
   state = executor->state;
-  pthread_mutex_lock(&state->lock);
   memset(snapshot, 0, sizeof(*snapshot));
+  /* A rejected submit briefly over-reserves; never report more than capacity. */
+  queued = counter_load(&state->queued);
   snapshot->worker_threads = state->worker_threads;
   snapshot->queue_capacity = state->queue_capacity;
-  snapshot->queued = state->queued;
-  snapshot->active = state->active;
-  snapshot->submitted = state->submitted;
-  snapshot->completed = state->completed;
-  snapshot->rejected = state->rejected;
-  snapshot->accepting = state->accepting;
-  pthread_mutex_unlock(&state->lock);
+  snapshot->queued = queued > state->queue_capacity ? state->queue_capacity : queued;
+  snapshot->active = counter_load(&state->active);
+  snapshot->submitted = counter_load(&state->submitted);
+  snapshot->completed = counter_load(&state->completed);
+  snapshot->rejected = counter_load(&state->rejected);
+  snapshot->expired = counter_load(&state->expired);
+  snapshot->accepting = state_accepting(state);
   return YAP_V2_OK;
 }
 
 void YAP_V2_executor_close(YAP_V2_EXECUTOR *executor) {
   EXECUTOR_STATE *state;
-  size_t i;
   if (executor == NULL || executor->state == NULL) return;
   state = executor->state;
-  pthread_mutex_lock(&state->lock);
-  state->accepting = 0;
-  pthread_cond_broadcast(&state->available);
-  pthread_mutex_unlock(&state->lock);
-  for (i = 0U; i < state->started_threads; i++)
-    (void)pthread_join(state->threads[i], NULL);
+  state_stop(state);
   pthread_cond_destroy(&state->available);
   pthread_mutex_destroy(&state->lock);
-  free(state->threads);
-  free(state->jobs);
-  free(state->batch_items);
-  free(state);
+  state_free(state);
   executor->state = NULL;
 }
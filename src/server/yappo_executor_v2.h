@@ -23,6 +23,7 @@ typedef struct {
   size_t submitted;
   size_t completed;
   size_t rejected;
+  size_t expired;
   int accepting;
 } YAP_V2_EXECUTOR_STATE;
 
@@ -34,10 +35,24 @@ int YAP_V2_executor_open_batch(YAP_V2_EXECUTOR *executor,
                                uint32_t max_delay_microseconds,
                                YAP_V2_EXECUTOR_BATCH_FUNCTION function,
                                void *batch_context);
+/* Jobs submitted from a worker go to that worker's deque and are stolen by idle workers;
+ * other threads submit through lock-free injection queues, one per coarse class of time
+ * left until the deadline, served tightest class first. Either way at most queue_capacity
+ * jobs wait, and YAP_V2_EXECUTOR_FULL is returned beyond that. */
 int YAP_V2_executor_try_submit(YAP_V2_EXECUTOR *executor,
                                YAP_V2_EXECUTOR_FUNCTION function,
                                void *context);
+/* deadline_microseconds is on the YAP_V2_cancellation_clock_microseconds clock, or 0 for
+ * none. A job dequeued at or after its deadline runs expire_function instead of function
+ * and is counted in expired; exactly one of the two is called. */
+int YAP_V2_executor_try_submit_deadline(YAP_V2_EXECUTOR *executor,
+                                        YAP_V2_EXECUTOR_FUNCTION function,
+                                        YAP_V2_EXECUTOR_FUNCTION expire_function,
+                                        void *context, uint64_t deadline_microseconds);
 int YAP_V2_executor_try_submit_item(YAP_V2_EXECUTOR *executor, void *item);
+/* Runs one waiting job on the calling thread and returns 1, or returns 0 when none is
+ * waiting. A job that fans out subtasks calls this while it waits for them. */
+int YAP_V2_executor_help(YAP_V2_EXECUTOR *executor);
 int YAP_V2_executor_snapshot(YAP_V2_EXECUTOR *executor,
                              YAP_V2_EXECUTOR_STATE *snapshot);
 void YAP_V2_executor_close(YAP_V2_EXECUTOR *executor);
@@ -7,20 +7,28 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <yyjson.h>
 
 #include "config/yappo_config_v2.h"
 #include "storage/yappo_manifest_v2.h"
+#include "query/yappo_phrase_v2.h"
 #include "query/yappo_query_v2.h"
 #include "query/yappo_retrieve_v2.h"
 #include "query/yappo_snippet_v2.h"
 #include "common/yappo_unicode.h"
+#include "indexing/yappo_memtable_v2.h"
 #include "indexing/yappo_update_v2.h"
+#include "server/yappo_slow_query_log_v2.h"
+#include "server/yappo_suggest_cache_v2.h"
+#include "server/yappo_term_stats_cache_v2.h"
 
 #define YAP_V2_CURSOR_MAX_OFFSET 10000U
 #define YAP_V2_HTTP_SNIPPET_GRAPHEMES 180U
 #define YAP_V2_ANN_MAX_DELTA_SEGMENTS 8U
+#define YAP_V2_HTTP_MAX_PARSE_THREADS 8U
 
 typedef struct { const char *key; size_t key_len; yyjson_val *value; } JSON_PAIR;
 
@@ -91,6 +99,12 @@ typedef struct {
   YAP_V2_ANN_CORPUS corpus;
 } HTTP_ANN_RESOURCE;
 
+typedef struct {
+  pthread_mutex_t references_lock;
+  size_t references;
+  YAP_V2_TERM_STATS_CACHE cache;
+} HTTP_TERM_STATS_RESOURCE;
+
 typedef struct {
   pthread_mutex_t references_lock;
   size_t references;
@@ -99,17 +113,27 @@ typedef struct {
   YAP_V2_MANIFEST manifest;
   HTTP_MANAGER_RESOURCE *manager_resource;
   YAP_V2_SEARCH_SNAPSHOT *snapshot;
+  YAP_V2_SEARCH_SNAPSHOT *base_snapshot;
   YAP_V2_QUERY_SEGMENT *query;
   HTTP_SEGMENT_RESOURCE **segments;
   YAP_V2_QUERY_CORPUS_STATS corpus_stats;
+  YAP_V2_SUGGEST_CACHE suggest_cache;
+  HTTP_TERM_STATS_RESOURCE *term_stats_resource;
+  YAP_V2_TERM_STATS_SOURCE term_stats;
   HTTP_ANN_RESOURCE *ann_resource;
   YAP_V2_ANN_QUERY_PLAN ann_plan;
   pthread_mutex_t ann_stats_lock;
   YAP_V2_QUERY_STATS ann_stats;
   uint64_t ann_rebuilds;
   uint64_t ann_rebuild_failures;
+  uint64_t ann_incremental_updates;
+  uint64_t ann_last_build_microseconds;
+  uint64_t ann_last_build_vectors;
   int ann_stats_initialized;
   size_t count;
+  size_t base_count;
+  uint64_t memtable_sequence;
+  size_t memtable_operations;
 } HTTP_RUNTIME;
 
 typedef struct {
@@ -125,10 +149,30 @@ typedef struct {
   uint64_t ingest_generations_saved;
   uint64_t ingest_max_batch_requests;
   uint64_t ingest_max_batch_operations;
+  uint64_t ingest_parse_microseconds;
+  uint64_t ingest_publish_microseconds;
   uint64_t update_wal_recoveries;
+  uint64_t memtable_flushes;
+  uint64_t wal_appends;
+  YAP_V2_WAL_FSYNC_HISTOGRAM wal_fsync;
+  uint64_t wal_synced_at_ms;
   uint64_t maintenance_foreground_deferrals;
+  uint64_t search_deadline_expired;
+  uint64_t search_cancelled;
+  YAP_V2_LATENCY_HISTOGRAM search_stages[YAP_V2_SEARCH_STAGE_COUNT];
+  YAP_V2_SLOW_QUERY_LOG slow_queries;
+  YAP_V2_MEMTABLE memtable;
 } HTTP_RUNTIME_STATE;
 
+static size_t memtable_max_operations;
+static uint64_t memtable_max_age_ms = 1000U;
+static YAP_V2_WAL_DURABILITY wal_durability = YAP_V2_WAL_SYNC_BATCH;
+static uint64_t wal_sync_interval_ms = YAP_V2_DEFAULT_WAL_SYNC_INTERVAL_MS;
+static unsigned latency_precision_bits = YAP_V2_LATENCY_DEFAULT_PRECISION_BITS;
+static size_t slow_query_entries = YAP_V2_SLOW_QUERY_DEFAULT_ENTRIES;
+static uint32_t slow_query_interval_seconds = YAP_V2_SLOW_QUERY_DEFAULT_INTERVAL_SECONDS;
+static uint32_t slow_query_sample_one_in;
+
 static int path_join(char *out, size_t capacity, const char *a, const char *b) {
   int written = snprintf(out, capacity, "%s/%s", a, b);
   return written < 0 || (size_t)written >= capacity ? -1 : 0;
@@ -138,6 +182,12 @@ static uint64_t saturated_add_u64(uint64_t left, uint64_t right) {
   return UINT64_MAX - left < right ? UINT64_MAX : left + right;
 }
 
+static uint64_t monotonic_microseconds(void) {
+  struct timespec value;
+  if (clock_gettime(CLOCK_MONOTONIC, &value) != 0) return 0U;
+  return (uint64_t)value.tv_sec * UINT64_C(1000000) + (uint64_t)value.tv_nsec / 1000U;
+}
+
 static void runtime_record_ann_stats(HTTP_RUNTIME *runtime,
                                      const YAP_V2_QUERY_STATS *stats) {
   if (runtime == NULL || stats == NULL || !runtime->ann_stats_initialized) return;
@@ -247,6 +297,50 @@ static int ann_resource_create(HTTP_ANN_RESOURCE **output) {
   return YAP_V2_OK;
 }
 
+static void term_stats_resource_retain(HTTP_TERM_STATS_RESOURCE *resource) {
+  if (resource == NULL) return;
+  pthread_mutex_lock(&resource->references_lock);
+  resource->references++;
+  pthread_mutex_unlock(&resource->references_lock);
+}
+
+static void term_stats_resource_release(HTTP_TERM_STATS_RESOURCE *resource) {
+  int destroy = 0;
+  if (resource == NULL) return;
+  pthread_mutex_lock(&resource->references_lock);
+  if (resource->references > 0U) {
+    resource->references--;
+    destroy = resource->references == 0U;
+  }
+  pthread_mutex_unlock(&resource->references_lock);
+  if (destroy) {
+    YAP_V2_term_stats_cache_free(&resource->cache);
+    pthread_mutex_destroy(&resource->references_lock);
+    free(resource);
+  }
+}
+
+static int term_stats_resource_create(size_t segment_count,
+                                      HTTP_TERM_STATS_RESOURCE **output) {
+  HTTP_TERM_STATS_RESOURCE *resource = calloc(1U, sizeof(*resource));
+  int status;
+  if (resource == NULL) return YAP_V2_ALLOCATION_FAILED;
+  if (pthread_mutex_init(&resource->references_lock, NULL) != 0) {
+    free(resource);
+    return YAP_V2_IO_ERROR;
+  }
+  resource->references = 1U;
+  status = YAP_V2_term_stats_cache_init(&resource->cache,
+                                        YAP_V2_TERM_STATS_CACHE_DEFAULT_SLOTS, segment_count);
+  if (status != YAP_V2_OK) {
+    pthread_mutex_destroy(&resource->references_lock);
+    free(resource);
+    return status;
+  }
+  *output = resource;
+  return YAP_V2_OK;
+}
+
 static void runtime_segment_close(YAP_V2_LEXICAL_SEGMENT *lexical,
                                   YAP_V2_VECTOR_SEGMENT *vectors,
                                   YAP_V2_ANN_SEGMENT *ann,
@@ -290,7 +384,7 @@ static void segment_resource_bind(HTTP_SEGMENT_RESOURCE *resource,
 }
 
 static int runtime_segment_open(
-  const char *index_dir, const YAP_V2_CONFIG *config,
+  const char *segments_dir, const YAP_V2_CONFIG *config,
   const YAP_V2_SEGMENT_DESCRIPTOR *descriptor,
   YAP_V2_QUERY_SEGMENT *query, YAP_V2_LEXICAL_SEGMENT *lexical,
   YAP_V2_VECTOR_SEGMENT *vectors, YAP_V2_ANN_SEGMENT *ann,
@@ -304,8 +398,8 @@ static int runtime_segment_open(
   YAP_V2_vector_segment_init(vectors);
   YAP_V2_ann_segment_init(ann);
   YAP_V2_metadata_index_init(metadata);
-  written = snprintf(segment_dir, sizeof(segment_dir), "%s/segments/%s",
-                     index_dir, descriptor->id);
+  written = snprintf(segment_dir, sizeof(segment_dir), "%s/%s",
+                     segments_dir, descriptor->id);
   if (written < 0 || (size_t)written >= sizeof(segment_dir))
     return YAP_V2_INVALID_ARGUMENT;
   if (component(descriptor, YAP_V2_FILE_TERMS) != NULL) {
@@ -339,7 +433,7 @@ static int runtime_segment_open(
 }
 
 static int segment_resource_open(
-    const char *index_dir, const YAP_V2_CONFIG *config,
+    const char *segments_dir, const YAP_V2_CONFIG *config,
     const YAP_V2_SEGMENT_DESCRIPTOR *descriptor,
     HTTP_SEGMENT_RESOURCE **output) {
   HTTP_SEGMENT_RESOURCE *resource;
@@ -353,7 +447,7 @@ static int segment_resource_open(
   }
   resource->references = 1U;
   status = runtime_segment_open(
-    index_dir, config, descriptor, &query, &resource->lexical,
+    segments_dir, config, descriptor, &query, &resource->lexical,
     &resource->vectors, &resource->ann, &resource->metadata);
   if (status != YAP_V2_OK) {
     runtime_segment_close(&resource->lexical, &resource->vectors,
@@ -373,12 +467,12 @@ static int runtime_ann_views(const HTTP_RUNTIME *runtime,
                              YAP_V2_ANN_SEGMENT **output) {
   YAP_V2_ANN_SEGMENT *views;
   size_t i;
-  if (runtime == NULL || output == NULL || runtime->count == 0U)
+  if (runtime == NULL || output == NULL || runtime->base_count == 0U)
     return YAP_V2_INVALID_ARGUMENT;
   *output = NULL;
-  views = calloc(runtime->count, sizeof(*views));
+  views = calloc(runtime->base_count, sizeof(*views));
   if (views == NULL) return YAP_V2_ALLOCATION_FAILED;
-  for (i = 0U; i < runtime->count; i++) {
+  for (i = 0U; i < runtime->base_count; i++) {
     if (runtime->segments[i] == NULL) {
       free(views);
       return YAP_V2_CONFLICT;
@@ -391,18 +485,86 @@ static int runtime_ann_views(const HTTP_RUNTIME *runtime,
   return YAP_V2_OK;
 }
 
+/* The global corpus only covers published segments; memtable deltas are searched on their own
+ * through the query plan until they are flushed. */
+static const YAP_V2_SEARCH_SNAPSHOT *runtime_published_snapshot(const HTTP_RUNTIME *runtime) {
+  return runtime->base_snapshot != NULL ? runtime->base_snapshot : runtime->snapshot;
+}
+
 static int runtime_build_ann_corpus(const HTTP_RUNTIME *runtime,
-                                    YAP_V2_ANN_CORPUS *corpus) {
+                                    YAP_V2_ANN_CORPUS *corpus,
+                                    uint64_t *build_microseconds) {
   YAP_V2_ANN_SEGMENT *views = NULL;
+  uint64_t started;
   int status;
   status = runtime_ann_views(runtime, &views);
   if (status != YAP_V2_OK) return status;
-  status = YAP_V2_ann_corpus_build(&runtime->manifest, runtime->snapshot,
-                                   views, runtime->count, corpus);
+  started = monotonic_microseconds();
+  status = YAP_V2_ann_corpus_build(&runtime->manifest, runtime_published_snapshot(runtime),
+                                   views, runtime->base_count, corpus);
+  *build_microseconds = monotonic_microseconds() - started;
   free(views);
   return status;
 }
 
+/* Extends the runtime's corpus with its delta segments, or rebuilds it when removed keys and
+ * retired segments have accumulated past YAP_V2_ann_corpus_needs_rebuild. */
+static int runtime_update_ann_corpus(const HTTP_RUNTIME *runtime,
+                                     YAP_V2_ANN_CORPUS *corpus, int *incremental,
+                                     uint64_t *build_microseconds) {
+  YAP_V2_ANN_SEGMENT *views = NULL;
+  int status;
+  *incremental = 0;
+  *build_microseconds = 0U;
+  if (!YAP_V2_ann_corpus_needs_rebuild(&runtime->ann_resource->corpus)) {
+    status = runtime_ann_views(runtime, &views);
+    if (status != YAP_V2_OK) return status;
+    status = YAP_V2_ann_corpus_extend(&runtime->ann_resource->corpus, &runtime->manifest,
+                                      runtime_published_snapshot(runtime), views,
+                                      runtime->base_count, corpus);
+    free(views);
+    if (status == YAP_V2_OK) {
+      *incremental = 1;
+      return YAP_V2_OK;
+    }
+  }
+  return runtime_build_ann_corpus(runtime, corpus, build_microseconds);
+}
+
+/* Prefix completions are cached per runtime. Corpus term frequencies cover only the published
+ * segments, so a runtime that merely absorbed the memtable keeps previous's cache and a new
+ * generation starts with an empty one. */
+static int runtime_open_caches(HTTP_RUNTIME *runtime, const HTTP_RUNTIME *previous) {
+  const YAP_V2_LEXICAL_SEGMENT **lexical;
+  size_t i;
+  int status;
+  lexical = calloc(runtime->count, sizeof(*lexical));
+  if (lexical == NULL) return YAP_V2_ALLOCATION_FAILED;
+  for (i = 0U; i < runtime->count; i++) lexical[i] = runtime->query[i].lexical;
+  status = YAP_V2_suggest_cache_init(&runtime->suggest_cache, lexical, runtime->count,
+                                     YAP_V2_SUGGEST_CACHE_DEFAULT_SLOTS);
+  free(lexical);
+  if (status != YAP_V2_OK) return status;
+  if (previous != NULL && previous->term_stats_resource != NULL &&
+      previous->manifest.generation == runtime->manifest.generation &&
+      previous->base_count == runtime->base_count) {
+    runtime->term_stats_resource = previous->term_stats_resource;
+    term_stats_resource_retain(runtime->term_stats_resource);
+  } else {
+    status = term_stats_resource_create(runtime->base_count, &runtime->term_stats_resource);
+    if (status != YAP_V2_OK) return status;
+  }
+  YAP_V2_term_stats_cache_source(&runtime->term_stats_resource->cache, &runtime->term_stats);
+  return YAP_V2_OK;
+}
+
+static int runtime_expand_prefix(void *context, YAP_V2_BYTES_VIEW prefix,
+                                 YAP_V2_SUGGESTIONS *expansions) {
+  HTTP_RUNTIME *runtime = context;
+  return YAP_V2_suggest_cache_lookup(&runtime->suggest_cache, prefix,
+                                     YAP_V2_PREFIX_MAX_EXPANSIONS, expansions);
+}
+
 static void runtime_close(HTTP_RUNTIME *runtime) {
   size_t i;
   if (runtime == NULL) return;
@@ -410,10 +572,13 @@ static void runtime_close(HTTP_RUNTIME *runtime) {
     for (i = 0U; i < runtime->count; i++)
       segment_resource_release(runtime->segments[i]);
   free(runtime->segments);
+  YAP_V2_suggest_cache_free(&runtime->suggest_cache);
+  term_stats_resource_release(runtime->term_stats_resource);
   free(runtime->query);
   YAP_V2_ann_query_plan_free(&runtime->ann_plan);
   ann_resource_release(runtime->ann_resource);
   if (runtime->snapshot != NULL) YAP_V2_snapshot_release(runtime->snapshot);
+  if (runtime->base_snapshot != NULL) YAP_V2_snapshot_release(runtime->base_snapshot);
   manager_resource_release(runtime->manager_resource);
   YAP_V2_manifest_free(&runtime->manifest);
   if (runtime->ann_stats_initialized) pthread_mutex_destroy(&runtime->ann_stats_lock);
@@ -455,7 +620,7 @@ static void runtime_release(HTTP_RUNTIME *runtime) {
 }
 
 static int runtime_open_once(HTTP_RUNTIME *runtime, const char *index_dir) {
-  char config_path[4096], manifest_path[4096];
+  char config_path[4096], manifest_path[4096], segments_dir[4096];
   char error[256]; size_t i; int status;
   memset(runtime, 0, sizeof(*runtime));
   YAP_V2_ann_query_plan_init(&runtime->ann_plan);
@@ -463,7 +628,8 @@ static int runtime_open_once(HTTP_RUNTIME *runtime, const char *index_dir) {
   runtime->ann_stats_initialized = 1;
   YAP_V2_manifest_init(&runtime->manifest);
   if (path_join(config_path, sizeof(config_path), index_dir, "config.toml") != 0 ||
-      path_join(manifest_path, sizeof(manifest_path), index_dir, "manifest.yap2") != 0)
+      path_join(manifest_path, sizeof(manifest_path), index_dir, "manifest.yap2") != 0 ||
+      path_join(segments_dir, sizeof(segments_dir), index_dir, "segments") != 0)
     return YAP_V2_INVALID_ARGUMENT;
   status = YAP_V2_config_load(config_path, &runtime->config, error, sizeof(error));
   if (status != YAP_V2_OK) return status;
@@ -474,6 +640,7 @@ static int runtime_open_once(HTTP_RUNTIME *runtime, const char *index_dir) {
   if (status != YAP_V2_OK) return status;
   runtime->snapshot = YAP_V2_snapshot_acquire(&runtime->manager_resource->manager);
   runtime->count = runtime->manifest.segment_count;
+  runtime->base_count = runtime->count;
   if (runtime->snapshot == NULL || runtime->count == 0U ||
       !YAP_V2_snapshot_matches_manifest(runtime->snapshot, &runtime->manifest))
     return YAP_V2_CONFLICT;
@@ -482,7 +649,7 @@ static int runtime_open_once(HTTP_RUNTIME *runtime, const char *index_dir) {
   if (runtime->query == NULL || runtime->segments == NULL)
     return YAP_V2_ALLOCATION_FAILED;
   for (i = 0U; i < runtime->count; i++) {
-    status = segment_resource_open(index_dir, &runtime->config,
+    status = segment_resource_open(segments_dir, &runtime->config,
                                    &runtime->manifest.segments[i],
                                    &runtime->segments[i]);
     if (status != YAP_V2_OK) return status;
@@ -490,15 +657,20 @@ static int runtime_open_once(HTTP_RUNTIME *runtime, const char *index_dir) {
   }
   status = YAP_V2_query_corpus_stats_build(runtime->snapshot, runtime->query,
                                            runtime->count, &runtime->corpus_stats);
+  if (status == YAP_V2_OK) status = runtime_open_caches(runtime, NULL);
   if (status == YAP_V2_OK) status = ann_resource_create(&runtime->ann_resource);
   if (status == YAP_V2_OK && runtime->config.vector_metric != YAP_V2_VECTOR_DISABLED) {
-    int cache_status = YAP_V2_ann_corpus_load_cache(index_dir, &runtime->config,
-                                                    &runtime->manifest,
-                                                    &runtime->ann_resource->corpus);
+    /* The graph's checksum is compared by YAP_V2_http_runtime_maintain_ann, off the startup
+     * path; until then queries search each segment's own graph. */
+    int cache_status = YAP_V2_ann_corpus_load_cache_deferred(index_dir, &runtime->config,
+                                                             &runtime->manifest,
+                                                             &runtime->ann_resource->corpus);
     if (cache_status != YAP_V2_OK) {
-      status = runtime_build_ann_corpus(runtime, &runtime->ann_resource->corpus);
+      status = runtime_build_ann_corpus(runtime, &runtime->ann_resource->corpus,
+                                        &runtime->ann_last_build_microseconds);
       if (status == YAP_V2_OK) {
         runtime->ann_rebuilds = saturated_add_u64(runtime->ann_rebuilds, 1U);
+        runtime->ann_last_build_vectors = runtime->ann_resource->corpus.vector_count;
         if (runtime->ann_resource->corpus.vector_count > 0U)
           (void)YAP_V2_ann_corpus_save_cache(
             index_dir, &runtime->ann_resource->corpus);
@@ -546,12 +718,51 @@ static int runtime_allocate_open(const char *index_dir, HTTP_RUNTIME **output) {
   return YAP_V2_OK;
 }
 
+/* Opens the memtable's delta segments from index_dir/memtable and layers them over the
+ * published snapshot, after every published segment. */
+static int runtime_overlay_memtable(HTTP_RUNTIME *runtime, const char *index_dir,
+                                    const YAP_V2_MEMTABLE *memtable) {
+  const YAP_V2_SEGMENT_DESCRIPTOR *delta;
+  YAP_V2_SEARCH_SNAPSHOT *overlay = NULL;
+  YAP_V2_QUERY_SEGMENT *query;
+  HTTP_SEGMENT_RESOURCE **segments;
+  char delta_dir[4096];
+  size_t delta_count = 0U, i;
+  int status;
+  runtime->base_count = runtime->count;
+  runtime->memtable_sequence = memtable->sequence;
+  delta = YAP_V2_memtable_segments(memtable, &delta_count);
+  if (delta_count == 0U) return YAP_V2_OK;
+  if (memtable->base_generation != runtime->manifest.generation) return YAP_V2_CONFLICT;
+  if (path_join(delta_dir, sizeof(delta_dir), index_dir, "memtable") != 0)
+    return YAP_V2_INVALID_ARGUMENT;
+  query = realloc(runtime->query, (runtime->count + delta_count) * sizeof(*query));
+  if (query == NULL) return YAP_V2_ALLOCATION_FAILED;
+  runtime->query = query;
+  segments = realloc(runtime->segments, (runtime->count + delta_count) * sizeof(*segments));
+  if (segments == NULL) return YAP_V2_ALLOCATION_FAILED;
+  runtime->segments = segments;
+  status = YAP_V2_snapshot_overlay(runtime->snapshot, delta_dir, delta, delta_count, &overlay);
+  if (status != YAP_V2_OK) return status;
+  runtime->base_snapshot = runtime->snapshot;
+  runtime->snapshot = overlay;
+  for (i = 0U; i < delta_count; i++) {
+    status = segment_resource_open(delta_dir, &runtime->config, &delta[i],
+                                   &runtime->segments[runtime->count]);
+    if (status != YAP_V2_OK) return status;
+    segment_resource_bind(runtime->segments[runtime->count], &runtime->query[runtime->count]);
+    runtime->count++;
+  }
+  runtime->memtable_operations = memtable->operation_count;
+  return YAP_V2_OK;
+}
+
 static int runtime_allocate_candidate(
-    HTTP_RUNTIME *previous, const char *index_dir,
+    HTTP_RUNTIME *previous, const char *index_dir, const YAP_V2_MEMTABLE *memtable,
     HTTP_ANN_RESOURCE *replacement_ann, HTTP_RUNTIME **output) {
   HTTP_RUNTIME *runtime = NULL;
   YAP_V2_MANIFEST_SEGMENT_MAP previous_segments;
-  char manifest_path[4096];
+  char manifest_path[4096], segments_dir[4096];
   size_t i;
   int manager_changed = 0;
   int status = YAP_V2_OK;
@@ -570,7 +781,8 @@ static int runtime_allocate_candidate(
   }
   runtime->ann_stats_initialized = 1;
   if (path_join(manifest_path, sizeof(manifest_path), index_dir,
-                "manifest.yap2") != 0) {
+                "manifest.yap2") != 0 ||
+      path_join(segments_dir, sizeof(segments_dir), index_dir, "segments") != 0) {
     status = YAP_V2_INVALID_ARGUMENT;
     goto done;
   }
@@ -608,16 +820,20 @@ static int runtime_allocate_candidate(
       runtime->segments[i] = previous->segments[previous_index];
       segment_resource_retain(runtime->segments[i]);
     } else {
-      status = segment_resource_open(index_dir, &runtime->config, descriptor,
+      status = segment_resource_open(segments_dir, &runtime->config, descriptor,
                                      &runtime->segments[i]);
       if (status != YAP_V2_OK) goto done;
     }
     segment_resource_bind(runtime->segments[i], &runtime->query[i]);
   }
+  status = runtime_overlay_memtable(runtime, index_dir, memtable);
+  if (status != YAP_V2_OK) goto done;
   status = YAP_V2_query_corpus_stats_build(runtime->snapshot, runtime->query,
                                            runtime->count,
                                            &runtime->corpus_stats);
   if (status != YAP_V2_OK) goto done;
+  status = runtime_open_caches(runtime, previous);
+  if (status != YAP_V2_OK) goto done;
   runtime->ann_resource = replacement_ann != NULL ? replacement_ann :
                           previous->ann_resource;
   ann_resource_retain(runtime->ann_resource);
@@ -627,7 +843,7 @@ static int runtime_allocate_candidate(
   }
   if (runtime->config.vector_metric != YAP_V2_VECTOR_DISABLED) {
     status = YAP_V2_ann_query_plan_build(&runtime->ann_resource->corpus,
-                                         &runtime->manifest,
+                                         YAP_V2_snapshot_manifest(runtime->snapshot),
                                          &runtime->ann_plan);
     if (status != YAP_V2_OK) goto done;
   }
@@ -659,6 +875,9 @@ static void runtime_copy_observability(HTTP_RUNTIME *candidate,
   candidate->ann_stats = previous->ann_stats;
   candidate->ann_rebuilds = previous->ann_rebuilds;
   candidate->ann_rebuild_failures = previous->ann_rebuild_failures;
+  candidate->ann_incremental_updates = previous->ann_incremental_updates;
+  candidate->ann_last_build_microseconds = previous->ann_last_build_microseconds;
+  candidate->ann_last_build_vectors = previous->ann_last_build_vectors;
   pthread_mutex_unlock(&previous->ann_stats_lock);
 }
 
@@ -721,24 +940,30 @@ done:
   return status;
 }
 
+/* Callers hold update_lock, which also guards state->memtable. */
 static int runtime_state_reload(HTTP_RUNTIME_STATE *state) {
   HTTP_RUNTIME *previous, *candidate = NULL;
   int changed = 0;
-  int status;
+  int status = YAP_V2_OK;
   previous = runtime_state_acquire(state);
   if (previous == NULL) return YAP_V2_CONFLICT;
-  status = runtime_manifest_relation(previous, state->index_dir, &changed);
-  if (status != YAP_V2_OK || !changed) {
+  if (state->memtable.batch_count != 0U)
+    status = YAP_V2_memtable_reconcile(&state->memtable, state->index_dir, &previous->config);
+  if (status == YAP_V2_OK)
+    status = runtime_manifest_relation(previous, state->index_dir, &changed);
+  if (status != YAP_V2_OK ||
+      (!changed && previous->memtable_sequence == state->memtable.sequence)) {
     runtime_release(previous);
     return status;
   }
-  status = runtime_allocate_candidate(previous, state->index_dir, NULL,
+  status = runtime_allocate_candidate(previous, state->index_dir, &state->memtable, NULL,
                                       &candidate);
   if (status != YAP_V2_OK) {
     runtime_release(previous);
     return status;
   }
-  if (candidate->manifest.generation <= previous->manifest.generation) {
+  if (candidate->manifest.generation < previous->manifest.generation ||
+      (changed && candidate->manifest.generation == previous->manifest.generation)) {
     runtime_release(candidate);
     runtime_release(previous);
     return YAP_V2_CONFLICT;
@@ -773,6 +998,8 @@ static int request_fingerprint(const YAP_V2_QUERY_REQUEST *request, yyjson_val *
       !yyjson_mut_obj_add_uint(doc, root, "scope", (uint64_t)request->scope) ||
       !yyjson_mut_obj_add_uint(doc, root, "operator", (uint64_t)request->query_operator) ||
       !yyjson_mut_obj_add_bool(doc, root, "phrase", request->phrase != 0) ||
+      (request->phrase_slop != 0U &&
+       !yyjson_mut_obj_add_uint(doc, root, "slop", request->phrase_slop)) ||
       !yyjson_mut_obj_add_uint(doc, root, "limit", request->top_k) ||
       !yyjson_mut_obj_add_strncpy(doc, root, "query", request->query.data == NULL ? "" : (const char *)request->query.data,
                                   request->query.len)) goto done;
@@ -826,9 +1053,10 @@ static int cursor_decode(const char *cursor, uint64_t expected_generation,
 
 static int parse_request(yyjson_val *root, const HTTP_RUNTIME *runtime,
                          YAP_V2_HTTP_OPERATION operation, YAP_V2_QUERY_REQUEST *request,
-                         float **vector_out, YAP_V2_RETRIEVE_OPTIONS *retrieve) {
-  static const char *const search_keys[] = {"query","vector","mode","scope","filter","operator","phrase","limit","cursor",NULL};
-  static const char *const retrieve_keys[] = {"query","vector","mode","filter","operator","phrase","limit","max_passages_per_document","max_context_bytes",NULL};
+                         float **vector_out, YAP_V2_RETRIEVE_OPTIONS *retrieve,
+                         int *profile) {
+  static const char *const search_keys[] = {"query","vector","mode","scope","filter","operator","phrase","slop","limit","cursor","profile",NULL};
+  static const char *const retrieve_keys[] = {"query","vector","mode","filter","operator","phrase","slop","limit","max_passages_per_document","max_context_bytes","profile",NULL};
   yyjson_val *query, *vector, *mode, *scope, *filter, *op, *phrase, *limit, *value;
   float *values = NULL; size_t i;
   if (!only_keys(root, operation == YAP_V2_HTTP_SEARCH ? search_keys : retrieve_keys)) return -1;
@@ -876,12 +1104,20 @@ static int parse_request(yyjson_val *root, const HTTP_RUNTIME *runtime,
   if (op != NULL) {
     if (!yyjson_is_str(op)) goto invalid;
     if (strcmp(yyjson_get_str(op), "and") == 0) request->query_operator = YAP_V2_QUERY_AND;
+    else if (strcmp(yyjson_get_str(op), "prefix") == 0) request->query_operator = YAP_V2_QUERY_PREFIX;
     else if (strcmp(yyjson_get_str(op), "or") != 0) goto invalid;
   }
   if (phrase != NULL) {
-    if (!yyjson_is_bool(phrase)) goto invalid;
+    if (!yyjson_is_bool(phrase) ||
+        (yyjson_get_bool(phrase) && request->query_operator == YAP_V2_QUERY_PREFIX)) goto invalid;
     request->phrase = yyjson_get_bool(phrase);
   }
+  value = yyjson_obj_get(root, "slop");
+  if (value != NULL) {
+    if (!yyjson_is_uint(value) || yyjson_get_uint(value) > YAP_V2_PHRASE_MAX_SLOP ||
+        (!request->phrase && yyjson_get_uint(value) != 0U)) goto invalid;
+    request->phrase_slop = (uint32_t)yyjson_get_uint(value);
+  }
   if (limit != NULL) {
     if (!yyjson_is_uint(limit) || yyjson_get_uint(limit) == 0U || yyjson_get_uint(limit) > 100U) goto invalid;
     request->top_k = (size_t)yyjson_get_uint(limit);
@@ -898,6 +1134,11 @@ static int parse_request(yyjson_val *root, const HTTP_RUNTIME *runtime,
     if (!yyjson_is_uint(value) || yyjson_get_uint(value) == 0U || yyjson_get_uint(value) > YAP_V2_HTTP_MAX_BODY_BYTES) goto invalid;
     retrieve->max_context_bytes = (size_t)yyjson_get_uint(value);
   }
+  value = yyjson_obj_get(root, "profile"); *profile = 0;
+  if (value != NULL) {
+    if (!yyjson_is_bool(value)) goto invalid;
+    *profile = yyjson_get_bool(value);
+  }
   *vector_out = values; return 0;
 invalid:
   free((void *)request->filter_json.data); free(values); request->filter_json.data = NULL; return -1;
@@ -954,12 +1195,70 @@ static int search_result_views(const HTTP_RUNTIME *runtime,
                                YAP_V2_HTTP_SNIPPET_GRAPHEMES, snippet);
 }
 
+/* Everything a "profile": true response reports; render time runs until the profile is
+ * appended, just before serialization. */
+typedef struct {
+  const YAP_V2_QUERY_PROFILE *query;
+  const YAP_V2_QUERY_STATS *stats;
+  const uint64_t *stages;
+  uint64_t render_started;
+} HTTP_PROFILE;
+
+static int lexical_profile_add(yyjson_mut_doc *doc, yyjson_mut_val *object,
+                               const YAP_V2_LEXICAL_SEARCH_PROFILE *profile) {
+  return yyjson_mut_obj_add_uint(doc, object, "postings_decoded", profile->postings_decoded) &&
+         yyjson_mut_obj_add_uint(doc, object, "postings_scored", profile->postings_scored) &&
+         yyjson_mut_obj_add_uint(doc, object, "postings_skipped",
+                                 profile->postings_decoded - profile->postings_scored) &&
+         yyjson_mut_obj_add_uint(doc, object, "pivots", profile->pivots) &&
+         yyjson_mut_obj_add_uint(doc, object, "filter_evaluations", profile->filter_evaluations);
+}
+
+static int profile_add(yyjson_mut_doc *doc, yyjson_mut_val *root, const HTTP_PROFILE *profile) {
+  yyjson_mut_val *object = yyjson_mut_obj(doc), *lexical = yyjson_mut_obj(doc),
+                 *segments = yyjson_mut_arr(doc), *ann = yyjson_mut_obj(doc);
+  YAP_V2_LEXICAL_SEARCH_PROFILE total; size_t i;
+  memset(&total, 0, sizeof(total));
+  if (object == NULL || lexical == NULL || segments == NULL || ann == NULL) return 0;
+  for (i = 0U; i < profile->query->segment_count; i++) {
+    const YAP_V2_QUERY_SEGMENT_PROFILE *segment = &profile->query->segments[i];
+    yyjson_mut_val *item = yyjson_mut_obj(doc);
+    total.postings_decoded += segment->lexical.postings_decoded;
+    total.postings_scored += segment->lexical.postings_scored;
+    total.pivots += segment->lexical.pivots;
+    total.filter_evaluations += segment->lexical.filter_evaluations;
+    if (item == NULL || !yyjson_mut_obj_add_uint(doc, item, "segment", segment->segment_ordinal) ||
+        !yyjson_mut_obj_add_uint(doc, item, "microseconds", segment->lexical_microseconds) ||
+        !yyjson_mut_obj_add_uint(doc, item, "hits", segment->lexical_hits) ||
+        !lexical_profile_add(doc, item, &segment->lexical) ||
+        !yyjson_mut_arr_append(segments, item)) return 0;
+  }
+  return lexical_profile_add(doc, lexical, &total) &&
+         yyjson_mut_obj_add_val(doc, lexical, "segments", segments) &&
+         yyjson_mut_obj_add_uint(doc, ann, "base_search_calls", profile->stats->base_search_calls) &&
+         yyjson_mut_obj_add_uint(doc, ann, "delta_search_calls", profile->stats->delta_search_calls) &&
+         yyjson_mut_obj_add_uint(doc, ann, "retry_search_calls", profile->stats->retry_search_calls) &&
+         yyjson_mut_obj_add_uint(doc, ann, "candidates_examined", profile->stats->candidates_examined) &&
+         yyjson_mut_obj_add_uint(doc, ann, "candidates_rejected", profile->stats->candidates_rejected) &&
+         yyjson_mut_obj_add_uint(doc, ann, "max_k", profile->query->ann_max_k) &&
+         yyjson_mut_obj_add_uint(doc, object, "parse_microseconds",
+                                 profile->stages[YAP_V2_SEARCH_STAGE_PARSE]) &&
+         yyjson_mut_obj_add_uint(doc, object, "lexical_microseconds", profile->stats->lexical_microseconds) &&
+         yyjson_mut_obj_add_uint(doc, object, "vector_microseconds", profile->stats->vector_microseconds) &&
+         yyjson_mut_obj_add_uint(doc, object, "fusion_microseconds", profile->stats->fusion_microseconds) &&
+         yyjson_mut_obj_add_uint(doc, object, "render_microseconds",
+                                 monotonic_microseconds() - profile->render_started) &&
+         yyjson_mut_obj_add_val(doc, object, "lexical", lexical) &&
+         yyjson_mut_obj_add_val(doc, object, "ann", ann) &&
+         yyjson_mut_obj_add_val(doc, root, "profile", object);
+}
+
 static int make_response(const HTTP_RUNTIME *runtime, YAP_V2_HTTP_OPERATION operation,
                          const YAP_V2_QUERY_HIT *hits, size_t hit_count,
                          const YAP_V2_QUERY_REQUEST *request,
                          const YAP_V2_RETRIEVE_OPTIONS *options, int has_more,
-                         size_t next_offset, const unsigned char query_digest[32], char **response,
-                         size_t *response_bytes) {
+                         size_t next_offset, const unsigned char query_digest[32],
+                         const HTTP_PROFILE *profile, char **response, size_t *response_bytes) {
   yyjson_mut_doc *doc = yyjson_mut_doc_new(NULL); yyjson_mut_val *root, *array; size_t i;
   unsigned char *context = NULL; YAP_V2_CITATION *citations = NULL;
   size_t context_bytes = 0U, citation_count = 0U; int status = YAP_V2_OK;
@@ -1018,6 +1317,7 @@ static int make_response(const HTTP_RUNTIME *runtime, YAP_V2_HTTP_OPERATION oper
           !yyjson_mut_arr_append(array, item)) goto memory;
     }
   }
+  if (profile != NULL && !profile_add(doc, root, profile)) goto memory;
   *response = yyjson_mut_write_opts(doc, YYJSON_WRITE_NOFLAG, NULL, response_bytes, NULL);
   if (*response == NULL) goto memory;
   goto done;
@@ -1116,26 +1416,171 @@ done:
   return status;
 }
 
+/* Completes the last token of prefix after the same normalization as search queries. */
+static int suggest_json(HTTP_RUNTIME *runtime, yyjson_val *root, char **response,
+                        size_t *response_bytes) {
+  static const char *const keys[] = {"prefix","limit",NULL};
+  YAP_V2_TOKEN_SEQUENCE tokens; YAP_V2_SUGGESTIONS suggestions; YAP_V2_BYTES_VIEW prefix;
+  yyjson_mut_doc *doc = NULL; yyjson_mut_val *object, *array;
+  yyjson_val *value = yyjson_obj_get(root, "prefix"), *limit = yyjson_obj_get(root, "limit");
+  size_t count = 10U, i; int status;
+  if (!only_keys(root, keys) || !yyjson_is_str(value) || yyjson_get_len(value) == 0U)
+    return YAP_V2_INVALID_ARGUMENT;
+  if (limit != NULL) {
+    if (!yyjson_is_uint(limit) || yyjson_get_uint(limit) == 0U ||
+        yyjson_get_uint(limit) > YAP_V2_SUGGEST_MAX_TERMS) return YAP_V2_INVALID_ARGUMENT;
+    count = (size_t)yyjson_get_uint(limit);
+  }
+  memset(&tokens, 0, sizeof(tokens)); YAP_V2_suggestions_init(&suggestions);
+  prefix.data = NULL; prefix.len = 0U;
+  status = YAP_V2_unicode_tokenize(yyjson_get_str(value), yyjson_get_len(value), &tokens);
+  if (status == YAP_V2_OK && tokens.token_count > 0U) {
+    const YAP_V2_TOKEN *last = &tokens.tokens[tokens.token_count - 1U];
+    prefix.data = (const unsigned char *)tokens.normalized_utf8 + last->byte_start;
+    prefix.len = last->byte_end - last->byte_start;
+    status = YAP_V2_suggest_cache_lookup(&runtime->suggest_cache, prefix, count, &suggestions);
+  }
+  if (status != YAP_V2_OK) goto done;
+  doc = yyjson_mut_doc_new(NULL);
+  object = doc == NULL ? NULL : yyjson_mut_obj(doc); array = doc == NULL ? NULL : yyjson_mut_arr(doc);
+  if (object == NULL || array == NULL) goto memory;
+  yyjson_mut_doc_set_root(doc, object);
+  if (!yyjson_mut_obj_add_uint(doc, object, "api_version", 2U) ||
+      !yyjson_mut_obj_add_uint(doc, object, "generation", YAP_V2_snapshot_generation(runtime->snapshot)) ||
+      !yyjson_mut_obj_add_val(doc, object, "prefix", view_string(doc, prefix)) ||
+      !yyjson_mut_obj_add_val(doc, object, "suggestions", array)) goto memory;
+  for (i = 0U; i < suggestions.count; i++) {
+    yyjson_mut_val *item = yyjson_mut_obj(doc);
+    if (item == NULL ||
+        !yyjson_mut_obj_add_strncpy(doc, item, "term", (const char *)suggestions.items[i].term,
+                                    suggestions.items[i].term_len) ||
+        !yyjson_mut_obj_add_uint(doc, item, "document_frequency",
+                                 suggestions.items[i].document_frequency) ||
+        !yyjson_mut_arr_append(array, item)) goto memory;
+  }
+  *response = yyjson_mut_write_opts(doc, YYJSON_WRITE_NOFLAG, NULL, response_bytes, NULL);
+  if (*response != NULL) goto done;
+memory:
+  status = YAP_V2_ALLOCATION_FAILED;
+done:
+  yyjson_mut_doc_free(doc); YAP_V2_suggestions_free(&suggestions);
+  YAP_V2_token_sequence_free(&tokens);
+  return status;
+}
+
+static const char *search_mode_name(YAP_V2_SEARCH_MODE mode) {
+  if (mode == YAP_V2_SEARCH_LEXICAL) return "lexical";
+  return mode == YAP_V2_SEARCH_VECTOR ? "vector" : "hybrid";
+}
+
+/* Keeps the fields request_fingerprint hashes, in request form, so the body replays as is
+ * against the same generation. Cursors stay valid there, so they are kept too. */
+static yyjson_mut_val *replay_request(yyjson_mut_doc *doc, YAP_V2_HTTP_OPERATION operation,
+                                      yyjson_val *root, const YAP_V2_QUERY_REQUEST *request,
+                                      size_t limit) {
+  static const char *const retrieve_keys[] = {"max_passages_per_document","max_context_bytes",NULL};
+  yyjson_mut_val *body = yyjson_mut_obj(doc); yyjson_val *value; size_t i;
+  if (body == NULL ||
+      !yyjson_mut_obj_add_str(doc, body, "mode", search_mode_name(request->mode)) ||
+      (operation == YAP_V2_HTTP_SEARCH &&
+       !yyjson_mut_obj_add_str(doc, body, "scope",
+                               request->scope == YAP_V2_SEARCH_PASSAGES ? "passages" : "documents")) ||
+      !yyjson_mut_obj_add_str(doc, body, "operator",
+                              request->query_operator == YAP_V2_QUERY_AND ? "and" :
+                              request->query_operator == YAP_V2_QUERY_PREFIX ? "prefix" : "or") ||
+      !yyjson_mut_obj_add_bool(doc, body, "phrase", request->phrase != 0) ||
+      (request->phrase_slop != 0U &&
+       !yyjson_mut_obj_add_uint(doc, body, "slop", request->phrase_slop)) ||
+      !yyjson_mut_obj_add_uint(doc, body, "limit", limit)) return NULL;
+  if (request->query.len > 0U &&
+      !yyjson_mut_obj_add_strncpy(doc, body, "query", (const char *)request->query.data,
+                                  request->query.len)) return NULL;
+  if (request->query_vector != NULL) {
+    yyjson_mut_val *vector = yyjson_mut_arr(doc);
+    if (vector == NULL) return NULL;
+    for (i = 0U; i < request->query_dimensions; i++)
+      if (!yyjson_mut_arr_add_real(doc, vector, request->query_vector[i])) return NULL;
+    if (!yyjson_mut_obj_add_val(doc, body, "vector", vector)) return NULL;
+  }
+  value = yyjson_obj_get(root, "filter");
+  if (value != NULL) {
+    yyjson_mut_val *filter = canonical_json_copy(doc, value);
+    if (filter == NULL || !yyjson_mut_obj_add_val(doc, body, "filter", filter)) return NULL;
+  }
+  value = yyjson_obj_get(root, "cursor");
+  if (operation == YAP_V2_HTTP_SEARCH && value != NULL &&
+      !yyjson_mut_obj_add_strcpy(doc, body, "cursor", yyjson_get_str(value))) return NULL;
+  for (i = 0U; operation == YAP_V2_HTTP_RETRIEVE && retrieve_keys[i] != NULL; i++) {
+    value = yyjson_obj_get(root, retrieve_keys[i]);
+    if (value != NULL && !yyjson_mut_obj_add_uint(doc, body, retrieve_keys[i], yyjson_get_uint(value)))
+      return NULL;
+  }
+  return body;
+}
+
+static void slow_query_capture(YAP_V2_SLOW_QUERY_LOG *log, const HTTP_RUNTIME *runtime,
+                               YAP_V2_HTTP_OPERATION operation, yyjson_val *root,
+                               const YAP_V2_QUERY_REQUEST *request, size_t limit,
+                               size_t result_count, const uint64_t *stages) {
+  static const char *const stage_keys[YAP_V2_SEARCH_STAGE_COUNT] = {
+    NULL, "parse_microseconds", "lexical_microseconds", "vector_microseconds",
+    "fusion_microseconds", "render_microseconds"};
+  yyjson_mut_doc *doc; yyjson_mut_val *entry, *timings, *body;
+  uint64_t latency = 0U, now; size_t stage, line_bytes; char *line; unsigned admission;
+  for (stage = YAP_V2_SEARCH_STAGE_PARSE; stage < YAP_V2_SEARCH_STAGE_COUNT; stage++)
+    latency = saturated_add_u64(latency, stages[stage]);
+  now = YAP_V2_cancellation_clock_microseconds();
+  admission = YAP_V2_slow_query_log_admit(log, latency, now);
+  if (admission == 0U) return;
+  doc = yyjson_mut_doc_new(NULL);
+  if (doc == NULL) return;
+  entry = yyjson_mut_obj(doc); timings = yyjson_mut_obj(doc); yyjson_mut_doc_set_root(doc, entry);
+  if (entry == NULL || timings == NULL ||
+      !yyjson_mut_obj_add_str(doc, entry, "operation",
+                              operation == YAP_V2_HTTP_SEARCH ? "search" : "retrieve") ||
+      !yyjson_mut_obj_add_str(doc, entry, "target",
+                              operation == YAP_V2_HTTP_SEARCH ? "/v2/search" : "/v2/retrieve") ||
+      !yyjson_mut_obj_add_uint(doc, entry, "generation", YAP_V2_snapshot_generation(runtime->snapshot)) ||
+      !yyjson_mut_obj_add_uint(doc, entry, "latency_microseconds", latency) ||
+      !yyjson_mut_obj_add_uint(doc, entry, "results", result_count)) goto done;
+  for (stage = YAP_V2_SEARCH_STAGE_PARSE; stage < YAP_V2_SEARCH_STAGE_COUNT; stage++)
+    if (!yyjson_mut_obj_add_uint(doc, timings, stage_keys[stage], stages[stage])) goto done;
+  body = replay_request(doc, operation, root, request, limit);
+  if (body == NULL || !yyjson_mut_obj_add_val(doc, entry, "stages", timings) ||
+      !yyjson_mut_obj_add_val(doc, entry, "request", body)) goto done;
+  line = yyjson_mut_write_opts(doc, YYJSON_WRITE_NOFLAG, NULL, &line_bytes, NULL);
+  if (line != NULL)
+    YAP_V2_slow_query_log_record(log, admission, latency, now, line, line_bytes);
+done:
+  yyjson_mut_doc_free(doc);
+}
+
 static int http_execute_loaded(HTTP_RUNTIME *runtime, const char *index_dir,
                                YAP_V2_HTTP_OPERATION operation,
                                const unsigned char *body, size_t body_bytes,
+                               const YAP_V2_CANCELLATION *cancellation, int *cancelled,
+                               uint64_t *stage_microseconds,
+                               YAP_V2_SLOW_QUERY_LOG *slow_queries,
                                int *http_status, char **response,
                                size_t *response_bytes) {
   yyjson_doc *document = NULL; yyjson_val *root;
+  uint64_t started = 0U;
   YAP_V2_QUERY_REQUEST request; YAP_V2_RETRIEVE_OPTIONS retrieve;
-  YAP_V2_QUERY_STATS query_stats;
+  YAP_V2_QUERY_STATS query_stats; YAP_V2_QUERY_PROFILE query_profile; HTTP_PROFILE profile;
   YAP_V2_QUERY_HIT *hits = NULL; float *vector = NULL; size_t hit_count = 0U, offset = 0U;
   size_t page_limit, execution_limit, page_count, body_limit;
-  unsigned char query_digest[32]; int status, parsed;
+  unsigned char query_digest[32]; int status, parsed, profiled = 0;
   if (http_status == NULL || response == NULL || response_bytes == NULL) return -1;
   memset(&request, 0, sizeof(request));
   memset(&query_stats, 0, sizeof(query_stats));
+  YAP_V2_query_profile_init(&query_profile);
   *http_status = 500; *response = NULL; *response_bytes = 0U;
   body_limit = operation == YAP_V2_HTTP_INGEST ?
                YAP_V2_HTTP_MAX_INGEST_BODY_BYTES : YAP_V2_HTTP_MAX_BODY_BYTES;
   if (index_dir == NULL || body == NULL || body_bytes == 0U || body_bytes > body_limit ||
       (operation != YAP_V2_HTTP_SEARCH && operation != YAP_V2_HTTP_RETRIEVE &&
-       operation != YAP_V2_HTTP_INGEST && operation != YAP_V2_HTTP_PREPARE)) return -1;
+       operation != YAP_V2_HTTP_INGEST && operation != YAP_V2_HTTP_PREPARE &&
+       operation != YAP_V2_HTTP_SUGGEST)) return -1;
   if (operation == YAP_V2_HTTP_INGEST) {
     YAP_V2_UPDATE_RESULT update; char update_error[256] = {0};
     YAP_V2_update_result_init(&update);
@@ -1158,6 +1603,7 @@ static int http_execute_loaded(HTTP_RUNTIME *runtime, const char *index_dir,
     return *response == NULL ? -1 : 0;
   }
   if (runtime == NULL) return -1;
+  if (stage_microseconds != NULL) started = monotonic_microseconds();
   document = yyjson_read((const char *)body, body_bytes, YYJSON_READ_NOFLAG);
   root = document == NULL ? NULL : yyjson_doc_get_root(document);
   if (!yyjson_is_obj(root)) goto bad_request;
@@ -1168,7 +1614,13 @@ static int http_execute_loaded(HTTP_RUNTIME *runtime, const char *index_dir,
     if (status != YAP_V2_OK) goto unavailable;
     *http_status = 200; goto done;
   }
-  parsed = parse_request(root, runtime, operation, &request, &vector, &retrieve);
+  if (operation == YAP_V2_HTTP_SUGGEST) {
+    status = suggest_json(runtime, root, response, response_bytes);
+    if (status == YAP_V2_INVALID_ARGUMENT) goto bad_request;
+    if (status != YAP_V2_OK) goto unavailable;
+    *http_status = 200; goto done;
+  }
+  parsed = parse_request(root, runtime, operation, &request, &vector, &retrieve, &profiled);
   if (parsed != 0) {
     if (parsed == -2) goto unavailable;
     goto bad_request;
@@ -1188,6 +1640,13 @@ static int http_execute_loaded(HTTP_RUNTIME *runtime, const char *index_dir,
   hits = calloc(execution_limit, sizeof(*hits));
   if (hits == NULL) goto unavailable;
   request.top_k = execution_limit; request.candidate_k = execution_limit < 100U ? 100U : execution_limit;
+  request.cancellation = cancellation;
+  request.expand_prefix = runtime_expand_prefix; request.expand_context = runtime;
+  request.term_stats = &runtime->term_stats;
+  /* Profiles report the stage timings, so they are only offered where those are measured. */
+  if (profiled && stage_microseconds != NULL) request.profile = &query_profile;
+  if (stage_microseconds != NULL)
+    stage_microseconds[YAP_V2_SEARCH_STAGE_PARSE] = monotonic_microseconds() - started;
   status = YAP_V2_query_execute_with_ann(
     runtime->snapshot, runtime->query, runtime->count, &runtime->corpus_stats,
     runtime->config.vector_metric == YAP_V2_VECTOR_DISABLED ? NULL :
@@ -1195,14 +1654,37 @@ static int http_execute_loaded(HTTP_RUNTIME *runtime, const char *index_dir,
     runtime->config.vector_metric == YAP_V2_VECTOR_DISABLED ? NULL : &runtime->ann_plan,
     &request, hits, execution_limit, &hit_count, &query_stats);
   runtime_record_ann_stats(runtime, &query_stats);
+  if (status == YAP_V2_CANCELLED) {
+    if (cancelled != NULL) *cancelled = 1;
+    *http_status = 503;
+    *response = error_json("deadline_exceeded", "search was cancelled before it completed",
+                           response_bytes);
+    goto done;
+  }
   if (status == YAP_V2_INVALID_ARGUMENT || status == YAP_V2_INVALID_FORMAT) goto bad_request;
   if (status != YAP_V2_OK) goto unavailable;
   if (offset > hit_count) goto bad_request;
   page_count = hit_count - offset < page_limit ? hit_count - offset : page_limit;
+  if (stage_microseconds != NULL) {
+    stage_microseconds[YAP_V2_SEARCH_STAGE_LEXICAL] = query_stats.lexical_microseconds;
+    stage_microseconds[YAP_V2_SEARCH_STAGE_VECTOR] = query_stats.vector_microseconds;
+    stage_microseconds[YAP_V2_SEARCH_STAGE_FUSION] = query_stats.fusion_microseconds;
+    started = monotonic_microseconds();
+  }
+  if (request.profile != NULL) {
+    profile.query = &query_profile; profile.stats = &query_stats;
+    profile.stages = stage_microseconds; profile.render_started = started;
+  }
   status = make_response(runtime, operation, hits + offset, page_count, &request, &retrieve,
                          operation == YAP_V2_HTTP_SEARCH && hit_count > offset + page_count,
-                         offset + page_count, query_digest, response, response_bytes);
+                         offset + page_count, query_digest,
+                         request.profile != NULL ? &profile : NULL, response, response_bytes);
   if (status != YAP_V2_OK) goto unavailable;
+  if (stage_microseconds != NULL)
+    stage_microseconds[YAP_V2_SEARCH_STAGE_RENDER] = monotonic_microseconds() - started;
+  if (slow_queries != NULL && stage_microseconds != NULL)
+    slow_query_capture(slow_queries, runtime, operation, root, &request, page_limit, page_count,
+                       stage_microseconds);
   *http_status = 200; goto done;
 bad_request:
   *http_status = 400; *response = error_json("invalid_request", "request does not match the v2 schema", response_bytes); goto done;
@@ -1210,6 +1692,7 @@ unavailable:
   *http_status = 503; *response = error_json("search_unavailable", "validated search snapshot is unavailable", response_bytes);
 done:
   free((void *)request.filter_json.data); free(vector); free(hits); if (document != NULL) yyjson_doc_free(document);
+  YAP_V2_query_profile_free(&query_profile);
   return *response == NULL ? -1 : 0;
 }
 
@@ -1219,9 +1702,18 @@ typedef struct {
   size_t upserts;
   size_t deletes;
   int parse_status;
+  int starts_group;
   char error[256];
 } HTTP_PARSED_INGEST;
 
+typedef struct {
+  pthread_mutex_t lock;
+  YAP_V2_HTTP_INGEST_ITEM *items;
+  HTTP_PARSED_INGEST *parsed;
+  size_t item_count;
+  size_t next;
+} HTTP_INGEST_PARSE_QUEUE;
+
 static int update_status_is_client_error(int status) {
   return status == YAP_V2_INVALID_ARGUMENT ||
          status == YAP_V2_INVALID_FORMAT || status == YAP_V2_OUT_OF_RANGE ||
@@ -1284,8 +1776,144 @@ static void update_group_add_ids(const char **slots, size_t capacity,
   }
 }
 
+static void parse_ingest_item(YAP_V2_HTTP_INGEST_ITEM *item, HTTP_PARSED_INGEST *parsed) {
+  size_t i;
+  memset(&item->http_status, 0,
+         sizeof(*item) - offsetof(YAP_V2_HTTP_INGEST_ITEM, http_status));
+  if (item->body == NULL || item->body_bytes == 0U ||
+      item->body_bytes > YAP_V2_HTTP_MAX_INGEST_BODY_BYTES) {
+    parsed->parse_status = YAP_V2_INVALID_ARGUMENT;
+    (void)snprintf(parsed->error, sizeof(parsed->error), "request body is invalid");
+    return;
+  }
+  parsed->parse_status = YAP_V2_update_parse_json_batch(
+    item->body, item->body_bytes, &parsed->operations, &parsed->operation_count,
+    parsed->error, sizeof(parsed->error));
+  if (parsed->parse_status != YAP_V2_OK) return;
+  for (i = 0U; i < parsed->operation_count; i++) {
+    if (parsed->operations[i].kind == YAP_V2_INGEST_DELETE)
+      parsed->deletes++;
+    else
+      parsed->upserts++;
+  }
+}
+
+static void *parse_ingest_worker(void *argument) {
+  HTTP_INGEST_PARSE_QUEUE *queue = argument;
+  for (;;) {
+    size_t index;
+    pthread_mutex_lock(&queue->lock);
+    index = queue->next < queue->item_count ? queue->next++ : SIZE_MAX;
+    pthread_mutex_unlock(&queue->lock);
+    if (index == SIZE_MAX) return NULL;
+    parse_ingest_item(&queue->items[index], &queue->parsed[index]);
+  }
+}
+
+/* Request bodies are independent, so a microbatch parses them concurrently before the writer
+ * serializes on update_lock. The calling writer thread takes part; helpers that fail to start
+ * only reduce the parallelism. */
+static void parse_ingest_items(YAP_V2_HTTP_INGEST_ITEM *items, HTTP_PARSED_INGEST *parsed,
+                               size_t item_count) {
+  HTTP_INGEST_PARSE_QUEUE queue;
+  pthread_t helpers[YAP_V2_HTTP_MAX_PARSE_THREADS - 1U];
+  size_t helper_count = 0U, wanted, i;
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  wanted = online > 0 ? (size_t)online : 1U;
+  if (wanted > YAP_V2_HTTP_MAX_PARSE_THREADS) wanted = YAP_V2_HTTP_MAX_PARSE_THREADS;
+  if (wanted > item_count) wanted = item_count;
+  queue.items = items;
+  queue.parsed = parsed;
+  queue.item_count = item_count;
+  queue.next = 0U;
+  if (wanted <= 1U || pthread_mutex_init(&queue.lock, NULL) != 0) {
+    for (i = 0U; i < item_count; i++) parse_ingest_item(&items[i], &parsed[i]);
+    return;
+  }
+  for (i = 1U; i < wanted; i++) {
+    if (pthread_create(&helpers[helper_count], NULL, parse_ingest_worker, &queue) != 0) break;
+    helper_count++;
+  }
+  (void)parse_ingest_worker(&queue);
+  for (i = 0U; i < helper_count; i++) (void)pthread_join(helpers[i], NULL);
+  pthread_mutex_destroy(&queue.lock);
+}
+
+/* Marks where a publication group must end: before a failed item, after the operation limit, or
+ * when a request repeats a document ID already present in the open group. */
+static void plan_ingest_groups(HTTP_PARSED_INGEST *parsed, size_t item_count,
+                               const char **id_slots, size_t slot_capacity) {
+  size_t group_count = 0U, group_operations = 0U, i;
+  for (i = 0U; i < item_count; i++) {
+    if (parsed[i].parse_status != YAP_V2_OK) {
+      if (group_count != 0U) memset(id_slots, 0, slot_capacity * sizeof(*id_slots));
+      group_count = 0U; group_operations = 0U;
+      continue;
+    }
+    if (group_count != 0U &&
+        (parsed[i].operation_count > YAP_V2_UPDATE_MAX_OPERATIONS - group_operations ||
+         update_group_contains_ids(id_slots, slot_capacity, &parsed[i]))) {
+      memset(id_slots, 0, slot_capacity * sizeof(*id_slots));
+      group_count = 0U; group_operations = 0U;
+    }
+    parsed[i].starts_group = group_count == 0U;
+    group_count++;
+    group_operations += parsed[i].operation_count;
+    update_group_add_ids(id_slots, slot_capacity, &parsed[i]);
+  }
+}
+
+static uint64_t monotonic_milliseconds(void) {
+  return monotonic_microseconds() / 1000U;
+}
+
+/* Publishes the buffered delta as the next generation; callers hold update_lock. */
+static int runtime_flush_memtable(HTTP_RUNTIME_STATE *state, const YAP_V2_CONFIG *config) {
+  YAP_V2_UPDATE_RESULT result;
+  char error[256] = {0};
+  int status;
+  if (state->memtable.batch_count == 0U) return YAP_V2_OK;
+  YAP_V2_update_result_init(&result);
+  status = YAP_V2_memtable_flush(&state->memtable, state->index_dir, config, &result,
+                                 error, sizeof(error));
+  YAP_V2_update_result_free(&result);
+  if (status != YAP_V2_OK) return status;
+  pthread_mutex_lock(&state->lock);
+  state->memtable_flushes = saturated_add_u64(state->memtable_flushes, 1U);
+  state->ingest_published_generations = saturated_add_u64(
+    state->ingest_published_generations, 1U);
+  pthread_mutex_unlock(&state->lock);
+  return YAP_V2_OK;
+}
+
+static void runtime_record_wal_write(HTTP_RUNTIME_STATE *state, int synced,
+                                     uint64_t sync_microseconds) {
+  pthread_mutex_lock(&state->lock);
+  state->wal_appends = saturated_add_u64(state->wal_appends, 1U);
+  if (synced) YAP_V2_wal_fsync_histogram_record(&state->wal_fsync, sync_microseconds);
+  pthread_mutex_unlock(&state->lock);
+}
+
+/* Makes every appended memtable WAL record durable with one fsync; callers hold
+ * update_lock. In interval mode the sync is skipped until the interval has elapsed. */
+static int runtime_sync_wal(HTTP_RUNTIME_STATE *state, int force) {
+  uint64_t now = monotonic_milliseconds(), sync_microseconds = 0U;
+  int status;
+  if (!state->memtable.wal_unsynced) return YAP_V2_OK;
+  if (!force && wal_durability == YAP_V2_WAL_SYNC_INTERVAL &&
+      now >= state->wal_synced_at_ms && now - state->wal_synced_at_ms < wal_sync_interval_ms)
+    return YAP_V2_OK;
+  status = YAP_V2_memtable_sync(&state->memtable, state->index_dir, &sync_microseconds);
+  if (status != YAP_V2_OK) return status;
+  state->wal_synced_at_ms = now;
+  pthread_mutex_lock(&state->lock);
+  YAP_V2_wal_fsync_histogram_record(&state->wal_fsync, sync_microseconds);
+  pthread_mutex_unlock(&state->lock);
+  return YAP_V2_OK;
+}
+
 static int apply_ingest_group(
-    const char *index_dir, HTTP_PARSED_INGEST *parsed,
+    HTTP_RUNTIME_STATE *state, const YAP_V2_CONFIG *config, HTTP_PARSED_INGEST *parsed,
     YAP_V2_HTTP_INGEST_ITEM *items, const size_t *indices,
     size_t index_count, uint64_t *published_generations,
     uint64_t *published_requests) {
@@ -1310,14 +1938,36 @@ static int apply_ingest_group(
     offset += batch->operation_count;
   }
   YAP_V2_update_result_init(&update);
-  status = YAP_V2_update_apply(index_dir, combined, operation_count, &update,
-                               error, sizeof(error));
+  if (memtable_max_operations == 0U) {
+    status = YAP_V2_update_apply(state->index_dir, combined, operation_count, &update,
+                                 error, sizeof(error));
+    if (status == YAP_V2_OK && update.wal_synced)
+      runtime_record_wal_write(state, 1, update.wal_sync_microseconds);
+  } else {
+    status = YAP_V2_OK;
+    if (state->memtable.operation_count + operation_count > memtable_max_operations)
+      status = runtime_flush_memtable(state, config);
+    if (status == YAP_V2_OK)
+      status = YAP_V2_memtable_absorb(&state->memtable, state->index_dir, config, combined,
+                                      operation_count, monotonic_milliseconds(), &update,
+                                      error, sizeof(error));
+    if (status == YAP_V2_OK) {
+      runtime_record_wal_write(state, 0, 0U);
+      if (wal_durability == YAP_V2_WAL_SYNC_REQUEST) {
+        status = runtime_sync_wal(state, 1);
+        if (status != YAP_V2_OK) {
+          (void)YAP_V2_memtable_rollback(&state->memtable, state->index_dir);
+          (void)snprintf(error, sizeof(error), "%s", "cannot sync update WAL");
+        }
+      }
+    }
+  }
   free(combined);
   if (status != YAP_V2_OK && index_count > 1U &&
       update_status_is_client_error(status)) {
     YAP_V2_update_result_free(&update);
     for (i = 0U; i < index_count; i++)
-      (void)apply_ingest_group(index_dir, parsed, items, &indices[i], 1U,
+      (void)apply_ingest_group(state, config, parsed, items, &indices[i], 1U,
                                published_generations, published_requests);
     return YAP_V2_OK;
   }
@@ -1337,7 +1987,8 @@ static int apply_ingest_group(
     }
   }
   if (status == YAP_V2_OK) {
-    *published_generations = saturated_add_u64(*published_generations, 1U);
+    if (memtable_max_operations == 0U)
+      *published_generations = saturated_add_u64(*published_generations, 1U);
     *published_requests = saturated_add_u64(
       *published_requests, (uint64_t)index_count);
   }
@@ -1350,16 +2001,22 @@ int YAP_V2_http_runtime_execute_ingest_batch(
     size_t item_count) {
   enum { ID_SLOT_CAPACITY = 32768 };
   HTTP_RUNTIME_STATE *state;
+  HTTP_RUNTIME *current;
+  YAP_V2_CONFIG config;
   HTTP_PARSED_INGEST *parsed;
   const char **id_slots;
   size_t *group_indices;
-  size_t group_count = 0U, group_operations = 0U;
-  size_t parsed_operations = 0U, i, j;
+  size_t group_count = 0U, parsed_operations = 0U, i;
   uint64_t published_generations = 0U, published_requests = 0U;
+  uint64_t started, parse_microseconds;
   if (runtime == NULL || runtime->state == NULL || items == NULL ||
       item_count == 0U)
     return YAP_V2_INVALID_ARGUMENT;
   state = runtime->state;
+  current = runtime_state_acquire(state);
+  if (current == NULL) return YAP_V2_CONFLICT;
+  config = current->config;
+  runtime_release(current);
   parsed = calloc(item_count, sizeof(*parsed));
   group_indices = calloc(item_count, sizeof(*group_indices));
   id_slots = calloc(ID_SLOT_CAPACITY, sizeof(*id_slots));
@@ -1367,65 +2024,52 @@ int YAP_V2_http_runtime_execute_ingest_batch(
     free(parsed); free(group_indices); free(id_slots);
     return YAP_V2_ALLOCATION_FAILED;
   }
+  started = monotonic_microseconds();
+  parse_ingest_items(items, parsed, item_count);
+  for (i = 0U; i < item_count; i++)
+    if (parsed[i].parse_status == YAP_V2_OK) parsed_operations += parsed[i].operation_count;
+  plan_ingest_groups(parsed, item_count, id_slots, ID_SLOT_CAPACITY);
+  parse_microseconds = monotonic_microseconds() - started;
   pthread_mutex_lock(&state->update_lock);
+  started = monotonic_microseconds();
+  /* In interval mode earlier batches were acknowledged before their WAL sync, so a failed
+   * sync below must only roll back what this batch absorbed. */
+  if (memtable_max_operations != 0U)
+    (void)YAP_V2_memtable_mark(&state->memtable, state->index_dir);
   for (i = 0U; i < item_count; i++) {
-    memset(&items[i].http_status, 0,
-           sizeof(items[i]) - offsetof(YAP_V2_HTTP_INGEST_ITEM, http_status));
-    if (items[i].body == NULL || items[i].body_bytes == 0U ||
-        items[i].body_bytes > YAP_V2_HTTP_MAX_INGEST_BODY_BYTES) {
-      parsed[i].parse_status = YAP_V2_INVALID_ARGUMENT;
-      (void)snprintf(parsed[i].error, sizeof(parsed[i].error),
-                     "request body is invalid");
-      continue;
+    if ((parsed[i].parse_status != YAP_V2_OK || parsed[i].starts_group) && group_count != 0U) {
+      (void)apply_ingest_group(
+        state, &config, parsed, items, group_indices, group_count,
+        &published_generations, &published_requests);
+      group_count = 0U;
     }
-    parsed[i].parse_status = YAP_V2_update_parse_json_batch(
-      items[i].body, items[i].body_bytes, &parsed[i].operations,
-      &parsed[i].operation_count, parsed[i].error,
-      sizeof(parsed[i].error));
-    if (parsed[i].parse_status == YAP_V2_OK)
-      for (j = 0U; j < parsed[i].operation_count; j++) {
-        if (parsed[i].operations[j].kind == YAP_V2_INGEST_DELETE)
-          parsed[i].deletes++;
-        else
-          parsed[i].upserts++;
-      }
-    if (parsed[i].parse_status == YAP_V2_OK)
-      parsed_operations += parsed[i].operation_count;
-  }
-  for (i = 0U; i < item_count; i++) {
-    int split = 0;
     if (parsed[i].parse_status != YAP_V2_OK) {
-      if (group_count != 0U) {
-        (void)apply_ingest_group(
-          state->index_dir, parsed, items, group_indices, group_count,
-          &published_generations, &published_requests);
-        group_count = 0U; group_operations = 0U;
-        memset(id_slots, 0, ID_SLOT_CAPACITY * sizeof(*id_slots));
-      }
       update_error_response(parsed[i].parse_status, parsed[i].error, &items[i]);
       continue;
     }
-    split = group_count != 0U &&
-            (parsed[i].operation_count >
-               YAP_V2_UPDATE_MAX_OPERATIONS - group_operations ||
-             update_group_contains_ids(id_slots, ID_SLOT_CAPACITY,
-                                       &parsed[i]));
-    if (split) {
-      (void)apply_ingest_group(
-        state->index_dir, parsed, items, group_indices, group_count,
-        &published_generations, &published_requests);
-      group_count = 0U; group_operations = 0U;
-      memset(id_slots, 0, ID_SLOT_CAPACITY * sizeof(*id_slots));
-    }
     group_indices[group_count++] = i;
-    group_operations += parsed[i].operation_count;
-    update_group_add_ids(id_slots, ID_SLOT_CAPACITY, &parsed[i]);
   }
   if (group_count != 0U)
     (void)apply_ingest_group(
-      state->index_dir, parsed, items, group_indices, group_count,
+      state, &config, parsed, items, group_indices, group_count,
       &published_generations, &published_requests);
-  if (published_generations != 0U && runtime_state_reload(state) != YAP_V2_OK) {
+  if (runtime_sync_wal(state, 0) != YAP_V2_OK) {
+    (void)YAP_V2_memtable_rollback(&state->memtable, state->index_dir);
+    for (i = 0U; i < item_count; i++) {
+      if (items[i].http_status != 200) continue;
+      free(items[i].response);
+      items[i].response = error_json(
+        "wal_sync_failed", "update was logged but could not be made durable",
+        &items[i].response_bytes);
+      items[i].http_status = 503;
+      items[i].result = items[i].response == NULL ? -1 : 0;
+    }
+  }
+  if (memtable_max_operations != 0U &&
+      YAP_V2_memtable_flush_due(&state->memtable, memtable_max_operations,
+                                memtable_max_age_ms, monotonic_milliseconds()))
+    (void)runtime_flush_memtable(state, &config);
+  if (published_requests != 0U && runtime_state_reload(state) != YAP_V2_OK) {
     for (i = 0U; i < item_count; i++) {
       if (items[i].http_status != 200) continue;
       free(items[i].response);
@@ -1454,6 +2098,10 @@ int YAP_V2_http_runtime_execute_ingest_batch(
     state->ingest_max_batch_requests = (uint64_t)item_count;
   if ((uint64_t)parsed_operations > state->ingest_max_batch_operations)
     state->ingest_max_batch_operations = (uint64_t)parsed_operations;
+  state->ingest_parse_microseconds = saturated_add_u64(
+    state->ingest_parse_microseconds, parse_microseconds);
+  state->ingest_publish_microseconds = saturated_add_u64(
+    state->ingest_publish_microseconds, monotonic_microseconds() - started);
   pthread_mutex_unlock(&state->lock);
   pthread_mutex_unlock(&state->update_lock);
   for (i = 0U; i < item_count; i++)
@@ -1463,6 +2111,22 @@ int YAP_V2_http_runtime_execute_ingest_batch(
   return YAP_V2_OK;
 }
 
+static void runtime_state_close_histograms(HTTP_RUNTIME_STATE *state) {
+  size_t stage;
+  for (stage = 0U; stage < YAP_V2_SEARCH_STAGE_COUNT; stage++)
+    YAP_V2_latency_histogram_free(&state->search_stages[stage]);
+}
+
+static int runtime_state_open_histograms(HTTP_RUNTIME_STATE *state) {
+  size_t stage;
+  int status = YAP_V2_OK;
+  for (stage = 0U; status == YAP_V2_OK && stage < YAP_V2_SEARCH_STAGE_COUNT; stage++)
+    status = YAP_V2_latency_histogram_init(&state->search_stages[stage],
+                                           latency_precision_bits);
+  if (status != YAP_V2_OK) runtime_state_close_histograms(state);
+  return status;
+}
+
 void YAP_V2_http_runtime_init(YAP_V2_HTTP_RUNTIME *runtime) {
   if (runtime != NULL) runtime->state = NULL;
 }
@@ -1478,8 +2142,10 @@ int YAP_V2_http_runtime_open(YAP_V2_HTTP_RUNTIME *runtime, const char *index_dir
   status = YAP_V2_update_recover(index_dir, recovery_error,
                                  sizeof(recovery_error));
   if (status != YAP_V2_OK) return status;
+  YAP_V2_build_delta_discard(index_dir);
   state = calloc(1U, sizeof(*state));
   if (state == NULL) return YAP_V2_ALLOCATION_FAILED;
+  YAP_V2_memtable_init(&state->memtable);
   state->update_wal_recoveries = had_wal ? 1U : 0U;
   if (pthread_mutex_init(&state->lock, NULL) != 0) { free(state); return YAP_V2_IO_ERROR; }
   if (pthread_mutex_init(&state->update_lock, NULL) != 0) {
@@ -1496,9 +2162,16 @@ int YAP_V2_http_runtime_open(YAP_V2_HTTP_RUNTIME *runtime, const char *index_dir
     pthread_mutex_destroy(&state->update_lock); pthread_mutex_destroy(&state->lock);
     free(state); return YAP_V2_ALLOCATION_FAILED;
   }
-  status = runtime_allocate_open(state->index_dir, &state->current);
+  status = runtime_state_open_histograms(state);
+  if (status == YAP_V2_OK)
+    status = YAP_V2_slow_query_log_init(&state->slow_queries, slow_query_entries,
+                                        slow_query_interval_seconds, slow_query_sample_one_in);
+  if (status == YAP_V2_OK)
+    status = runtime_allocate_open(state->index_dir, &state->current);
   if (status != YAP_V2_OK) {
-    runtime_release(state->current); free(state->index_dir);
+    runtime_release(state->current); runtime_state_close_histograms(state);
+    YAP_V2_slow_query_log_free(&state->slow_queries);
+    free(state->index_dir);
     pthread_mutex_destroy(&state->ann_maintenance_lock);
     pthread_mutex_destroy(&state->update_lock); pthread_mutex_destroy(&state->lock);
     free(state); return status;
@@ -1518,6 +2191,12 @@ void YAP_V2_http_runtime_close(YAP_V2_HTTP_RUNTIME *runtime) {
     pthread_mutex_unlock(&state->lock);
     runtime_release(current);
   }
+  pthread_mutex_lock(&state->update_lock);
+  (void)runtime_sync_wal(state, 1);
+  pthread_mutex_unlock(&state->update_lock);
+  YAP_V2_memtable_free(&state->memtable);
+  runtime_state_close_histograms(state);
+  YAP_V2_slow_query_log_free(&state->slow_queries);
   pthread_mutex_destroy(&state->ann_maintenance_lock);
   pthread_mutex_destroy(&state->update_lock); pthread_mutex_destroy(&state->lock);
   free(state->index_dir); free(state); runtime->state = NULL;
@@ -1528,14 +2207,26 @@ int YAP_V2_http_runtime_execute(YAP_V2_HTTP_RUNTIME *runtime,
                                 const unsigned char *body, size_t body_bytes,
                                 int *http_status, char **response,
                                 size_t *response_bytes) {
+  return YAP_V2_http_runtime_execute_cancellable(runtime, operation, body, body_bytes, NULL,
+                                                 http_status, response, response_bytes);
+}
+
+int YAP_V2_http_runtime_execute_cancellable(YAP_V2_HTTP_RUNTIME *runtime,
+                                            YAP_V2_HTTP_OPERATION operation,
+                                            const unsigned char *body, size_t body_bytes,
+                                            const YAP_V2_CANCELLATION *cancellation,
+                                            int *http_status, char **response,
+                                            size_t *response_bytes) {
   HTTP_RUNTIME_STATE *state;
-  int result;
+  uint64_t stages[YAP_V2_SEARCH_STAGE_COUNT];
+  size_t stage;
+  int result, cancelled = 0;
   if (runtime == NULL || runtime->state == NULL) return -1;
   state = runtime->state;
   if (operation == YAP_V2_HTTP_INGEST) {
     pthread_mutex_lock(&state->update_lock);
     result = http_execute_loaded(NULL, state->index_dir, operation, body, body_bytes,
-                                 http_status, response, response_bytes);
+                                 NULL, NULL, NULL, NULL, http_status, response, response_bytes);
     if (result == 0 && *http_status == 200) {
       if (runtime_state_reload(state) != YAP_V2_OK) {
         free(*response); *response = error_json("reload_failed",
@@ -1549,10 +2240,21 @@ int YAP_V2_http_runtime_execute(YAP_V2_HTTP_RUNTIME *runtime,
   {
     HTTP_RUNTIME *current = runtime_state_acquire(state);
     if (current == NULL) return -1;
-    result = http_execute_loaded(current, state->index_dir, operation, body,
-                               body_bytes, http_status, response, response_bytes);
+    memset(stages, 0, sizeof(stages));
+    result = http_execute_loaded(current, state->index_dir, operation, body, body_bytes,
+                                 cancellation, &cancelled, stages, &state->slow_queries,
+                                 http_status, response, response_bytes);
     runtime_release(current);
   }
+  /* Queue wait is measured by the caller; see YAP_V2_http_runtime_record_search_stage. */
+  if (result == 0 && operation == YAP_V2_HTTP_SEARCH && *http_status == 200)
+    for (stage = YAP_V2_SEARCH_STAGE_PARSE; stage < YAP_V2_SEARCH_STAGE_COUNT; stage++)
+      YAP_V2_latency_histogram_record(&state->search_stages[stage], stages[stage]);
+  if (cancelled) {
+    pthread_mutex_lock(&state->lock);
+    state->search_cancelled = saturated_add_u64(state->search_cancelled, 1U);
+    pthread_mutex_unlock(&state->lock);
+  }
   return result;
 }
 
@@ -1577,6 +2279,7 @@ int YAP_V2_http_runtime_state(YAP_V2_HTTP_RUNTIME *runtime,
     operational->ann_base_generation = current->ann_resource->corpus.generation;
     operational->ann_base_vectors = current->ann_resource->corpus.vector_count;
     operational->ann_delta_segments = current->ann_plan.delta_segment_count;
+    operational->memtable_operations = current->memtable_operations;
     operational->ann_missing_base_segments = current->ann_plan.missing_base_segment_count;
     pthread_mutex_lock(&current->ann_stats_lock);
     operational->ann_base_search_calls = current->ann_stats.base_search_calls;
@@ -1586,6 +2289,9 @@ int YAP_V2_http_runtime_state(YAP_V2_HTTP_RUNTIME *runtime,
     operational->ann_candidates_rejected = current->ann_stats.candidates_rejected;
     operational->ann_rebuilds = current->ann_rebuilds;
     operational->ann_rebuild_failures = current->ann_rebuild_failures;
+    operational->ann_incremental_updates = current->ann_incremental_updates;
+    operational->ann_last_build_microseconds = current->ann_last_build_microseconds;
+    operational->ann_last_build_vectors = current->ann_last_build_vectors;
     pthread_mutex_unlock(&current->ann_stats_lock);
   }
   pthread_mutex_lock(&state->lock);
@@ -1597,10 +2303,23 @@ int YAP_V2_http_runtime_state(YAP_V2_HTTP_RUNTIME *runtime,
   operational->ingest_generations_saved = state->ingest_generations_saved;
   operational->ingest_max_batch_requests = state->ingest_max_batch_requests;
   operational->ingest_max_batch_operations = state->ingest_max_batch_operations;
+  operational->ingest_parse_microseconds = state->ingest_parse_microseconds;
+  operational->ingest_publish_microseconds = state->ingest_publish_microseconds;
   operational->update_wal_recoveries = state->update_wal_recoveries;
+  operational->memtable_flushes = state->memtable_flushes;
+  operational->wal_appends = state->wal_appends;
+  operational->wal_fsync = state->wal_fsync;
   operational->maintenance_foreground_deferrals =
     state->maintenance_foreground_deferrals;
+  operational->search_deadline_expired = state->search_deadline_expired;
+  operational->search_cancelled = state->search_cancelled;
   pthread_mutex_unlock(&state->lock);
+  {
+    size_t stage;
+    for (stage = 0U; stage < YAP_V2_SEARCH_STAGE_COUNT; stage++)
+      YAP_V2_latency_histogram_summary(&state->search_stages[stage],
+                                       &operational->search_stages[stage]);
+  }
   {
     int available = current != NULL;
     runtime_release(current);
@@ -1619,6 +2338,35 @@ void YAP_V2_http_runtime_record_maintenance_deferral(
   pthread_mutex_unlock(&state->lock);
 }
 
+void YAP_V2_http_runtime_record_search_expired(YAP_V2_HTTP_RUNTIME *runtime) {
+  HTTP_RUNTIME_STATE *state;
+  if (runtime == NULL || runtime->state == NULL) return;
+  state = runtime->state;
+  pthread_mutex_lock(&state->lock);
+  state->search_deadline_expired = saturated_add_u64(state->search_deadline_expired, 1U);
+  pthread_mutex_unlock(&state->lock);
+}
+
+void YAP_V2_http_runtime_record_search_stage(YAP_V2_HTTP_RUNTIME *runtime,
+                                             YAP_V2_SEARCH_STAGE stage,
+                                             uint64_t elapsed_microseconds) {
+  HTTP_RUNTIME_STATE *state;
+  if (runtime == NULL || runtime->state == NULL || stage < 0 ||
+      stage >= YAP_V2_SEARCH_STAGE_COUNT) return;
+  state = runtime->state;
+  YAP_V2_latency_histogram_record(&state->search_stages[stage], elapsed_microseconds);
+}
+
+int YAP_V2_http_runtime_slow_queries(YAP_V2_HTTP_RUNTIME *runtime, size_t max_bytes,
+                                     char **ndjson, size_t *ndjson_bytes) {
+  HTTP_RUNTIME_STATE *state;
+  if (runtime == NULL || runtime->state == NULL) return YAP_V2_INVALID_ARGUMENT;
+  state = runtime->state;
+  return YAP_V2_slow_query_log_dump(&state->slow_queries,
+                                    YAP_V2_cancellation_clock_microseconds(), max_bytes,
+                                    ndjson, ndjson_bytes);
+}
+
 int YAP_V2_http_runtime_reload(YAP_V2_HTTP_RUNTIME *runtime) {
   HTTP_RUNTIME_STATE *state;
   int status;
@@ -1630,64 +2378,135 @@ int YAP_V2_http_runtime_reload(YAP_V2_HTTP_RUNTIME *runtime) {
   return status;
 }
 
+void YAP_V2_http_set_ann_build_threads(size_t threads) {
+  YAP_V2_ann_set_build_threads(threads);
+}
+
+void YAP_V2_http_set_memtable_policy(size_t max_operations, uint32_t max_age_ms) {
+  memtable_max_operations = max_operations > YAP_V2_UPDATE_MAX_OPERATIONS ?
+                            YAP_V2_UPDATE_MAX_OPERATIONS : max_operations;
+  memtable_max_age_ms = max_age_ms;
+}
+
+void YAP_V2_http_set_wal_durability(YAP_V2_WAL_DURABILITY durability,
+                                    uint32_t sync_interval_ms) {
+  wal_durability = durability;
+  wal_sync_interval_ms = sync_interval_ms;
+}
+
+void YAP_V2_http_set_latency_precision(unsigned precision_bits) {
+  if (precision_bits >= 1U && precision_bits <= YAP_V2_LATENCY_MAX_PRECISION_BITS)
+    latency_precision_bits = precision_bits;
+}
+
+void YAP_V2_http_set_slow_query_log(size_t entries, uint32_t interval_seconds,
+                                    uint32_t sample_one_in) {
+  if (entries > YAP_V2_SLOW_QUERY_MAX_ENTRIES || interval_seconds == 0U) return;
+  slow_query_entries = entries;
+  slow_query_interval_seconds = interval_seconds;
+  slow_query_sample_one_in = sample_one_in;
+}
+
+int YAP_V2_http_runtime_maintain_memtable(YAP_V2_HTTP_RUNTIME *runtime) {
+  HTTP_RUNTIME_STATE *state;
+  HTTP_RUNTIME *current;
+  int status = YAP_V2_OK;
+  if (runtime == NULL || runtime->state == NULL) return YAP_V2_INVALID_ARGUMENT;
+  state = runtime->state;
+  pthread_mutex_lock(&state->update_lock);
+  (void)runtime_sync_wal(state, 0);
+  if (YAP_V2_memtable_flush_due(&state->memtable, memtable_max_operations,
+                                memtable_max_age_ms, monotonic_milliseconds())) {
+    current = runtime_state_acquire(state);
+    status = current == NULL ? YAP_V2_CONFLICT :
+             runtime_flush_memtable(state, &current->config);
+    runtime_release(current);
+    if (status == YAP_V2_OK) status = runtime_state_reload(state);
+  }
+  pthread_mutex_unlock(&state->update_lock);
+  return status;
+}
+
+static void runtime_count_ann_failure(HTTP_RUNTIME *runtime) {
+  if (runtime == NULL) return;
+  pthread_mutex_lock(&runtime->ann_stats_lock);
+  runtime->ann_rebuild_failures = saturated_add_u64(runtime->ann_rebuild_failures, 1U);
+  pthread_mutex_unlock(&runtime->ann_stats_lock);
+}
+
+/* The global corpus is brought up to date outside update_lock so ingest keeps publishing
+ * generations meanwhile; only the runtime swap below takes the lock. */
 int YAP_V2_http_runtime_maintain_ann(YAP_V2_HTTP_RUNTIME *runtime) {
   HTTP_RUNTIME_STATE *state;
-  HTTP_RUNTIME *base = NULL, *replacement = NULL;
+  HTTP_RUNTIME *base = NULL, *current = NULL, *replacement = NULL;
   HTTP_ANN_RESOURCE *replacement_ann = NULL;
-  int status = YAP_V2_OK, needed = 0;
+  uint64_t build_microseconds = 0U;
+  int status = YAP_V2_OK, needed = 0, incremental = 0, verified = 0;
   if (runtime == NULL || runtime->state == NULL) return YAP_V2_INVALID_ARGUMENT;
   state = runtime->state;
   pthread_mutex_lock(&state->ann_maintenance_lock);
   pthread_mutex_lock(&state->update_lock);
   base = runtime_state_acquire(state);
-  if (base != NULL && base->config.vector_metric != YAP_V2_VECTOR_DISABLED &&
-      (base->ann_plan.delta_segment_count > YAP_V2_ANN_MAX_DELTA_SEGMENTS ||
-       base->ann_plan.missing_base_segment_count > 0U)) {
-    needed = 1;
-    status = ann_resource_create(&replacement_ann);
-    if (status == YAP_V2_OK)
-      status = runtime_build_ann_corpus(base, &replacement_ann->corpus);
-  }
+  pthread_mutex_unlock(&state->update_lock);
+  needed = base != NULL && base->config.vector_metric != YAP_V2_VECTOR_DISABLED &&
+           (base->ann_plan.base_pending ||
+            base->ann_plan.delta_segment_count > YAP_V2_ANN_MAX_DELTA_SEGMENTS ||
+            base->ann_plan.missing_base_segment_count > 0U);
   if (!needed) {
     runtime_release(base);
-    pthread_mutex_unlock(&state->update_lock);
     pthread_mutex_unlock(&state->ann_maintenance_lock);
     return YAP_V2_OK;
   }
+  status = ann_resource_create(&replacement_ann);
+  /* A base loaded at startup is mapped only after its whole graph matches the recorded CRC32C;
+   * a mismatch is rebuilt from the segments. */
+  if (status == YAP_V2_OK && base->ann_plan.base_pending) {
+    verified = YAP_V2_ann_corpus_load_cache(state->index_dir, &base->config, &base->manifest,
+                                            &replacement_ann->corpus) == YAP_V2_OK;
+    if (!verified)
+      status = runtime_build_ann_corpus(base, &replacement_ann->corpus, &build_microseconds);
+  } else if (status == YAP_V2_OK)
+    status = runtime_update_ann_corpus(base, &replacement_ann->corpus, &incremental,
+                                       &build_microseconds);
   if (status != YAP_V2_OK) {
-    pthread_mutex_lock(&base->ann_stats_lock);
-    base->ann_rebuild_failures = saturated_add_u64(
-      base->ann_rebuild_failures, 1U);
-    pthread_mutex_unlock(&base->ann_stats_lock);
+    runtime_count_ann_failure(base);
     goto done;
   }
-  if (replacement_ann->corpus.vector_count > 0U)
+  if (!verified && replacement_ann->corpus.vector_count > 0U)
     (void)YAP_V2_ann_corpus_save_cache(state->index_dir,
                                        &replacement_ann->corpus);
-  status = runtime_allocate_candidate(base, state->index_dir, replacement_ann,
-                                      &replacement);
+  pthread_mutex_lock(&state->update_lock);
+  current = runtime_state_acquire(state);
+  status = current != NULL ? runtime_allocate_candidate(current, state->index_dir,
+                                                        &state->memtable, replacement_ann,
+                                                        &replacement) :
+                             YAP_V2_CONFLICT;
   if (status == YAP_V2_OK &&
-      replacement->manifest.generation != base->manifest.generation)
+      replacement->manifest.generation != current->manifest.generation)
     status = YAP_V2_CONFLICT;
   if (status == YAP_V2_OK) {
-    runtime_copy_observability(replacement, base);
+    runtime_copy_observability(replacement, current);
     pthread_mutex_lock(&replacement->ann_stats_lock);
-    replacement->ann_rebuilds = saturated_add_u64(
-      replacement->ann_rebuilds, 1U);
+    if (verified) {
+      /* The cached base was mapped as it was saved; nothing was built. */
+    } else if (incremental)
+      replacement->ann_incremental_updates = saturated_add_u64(
+        replacement->ann_incremental_updates, 1U);
+    else {
+      replacement->ann_rebuilds = saturated_add_u64(replacement->ann_rebuilds, 1U);
+      replacement->ann_last_build_microseconds = build_microseconds;
+      replacement->ann_last_build_vectors = replacement_ann->corpus.vector_count;
+    }
     pthread_mutex_unlock(&replacement->ann_stats_lock);
-    status = runtime_state_publish_replacement(state, base, &replacement);
-  }
-  if (status != YAP_V2_OK) {
-    pthread_mutex_lock(&base->ann_stats_lock);
-    base->ann_rebuild_failures = saturated_add_u64(
-      base->ann_rebuild_failures, 1U);
-    pthread_mutex_unlock(&base->ann_stats_lock);
+    status = runtime_state_publish_replacement(state, current, &replacement);
   }
+  if (status != YAP_V2_OK) runtime_count_ann_failure(current != NULL ? current : base);
+  pthread_mutex_unlock(&state->update_lock);
 done:
   runtime_release(replacement);
+  runtime_release(current);
   ann_resource_release(replacement_ann);
   runtime_release(base);
-  pthread_mutex_unlock(&state->update_lock);
   pthread_mutex_unlock(&state->ann_maintenance_lock);
   return status;
 }
@@ -1696,15 +2515,17 @@ int YAP_V2_http_execute(const char *index_dir, YAP_V2_HTTP_OPERATION operation,
                         const unsigned char *body, size_t body_bytes, int *http_status,
                         char **response, size_t *response_bytes) {
   HTTP_RUNTIME runtime;
+  uint64_t stages[YAP_V2_SEARCH_STAGE_COUNT];
   int status, result;
   if (operation == YAP_V2_HTTP_INGEST)
     return http_execute_loaded(NULL, index_dir, operation, body, body_bytes,
-                               http_status, response, response_bytes);
+                               NULL, NULL, NULL, NULL, http_status, response, response_bytes);
   memset(&runtime, 0, sizeof(runtime));
   status = runtime_open(&runtime, index_dir);
   if (status != YAP_V2_OK) return -1;
+  memset(stages, 0, sizeof(stages));
   result = http_execute_loaded(&runtime, index_dir, operation, body, body_bytes,
-                               http_status, response, response_bytes);
+                               NULL, NULL, stages, NULL, http_status, response, response_bytes);
   runtime_close(&runtime);
   return result;
 }
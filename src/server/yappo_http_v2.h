@@ -2,6 +2,7 @@
 #define YAPPO_HTTP_V2_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "config/yappo_runtime_policy_v2.h"
 #include "server/yappo_observability_v2.h"
@@ -13,7 +14,8 @@ typedef enum {
   YAP_V2_HTTP_SEARCH = 1,
   YAP_V2_HTTP_RETRIEVE = 2,
   YAP_V2_HTTP_INGEST = 3,
-  YAP_V2_HTTP_PREPARE = 4
+  YAP_V2_HTTP_PREPARE = 4,
+  YAP_V2_HTTP_SUGGEST = 5
 } YAP_V2_HTTP_OPERATION;
 
 typedef struct {
@@ -37,12 +39,44 @@ int YAP_V2_http_runtime_execute(YAP_V2_HTTP_RUNTIME *runtime,
                                 const unsigned char *body, size_t body_bytes,
                                 int *http_status, char **response,
                                 size_t *response_bytes);
+/* Like YAP_V2_http_runtime_execute, but search and retrieve stop between segments once
+ * cancellation fires and answer 503 deadline_exceeded. */
+int YAP_V2_http_runtime_execute_cancellable(YAP_V2_HTTP_RUNTIME *runtime,
+                                            YAP_V2_HTTP_OPERATION operation,
+                                            const unsigned char *body, size_t body_bytes,
+                                            const YAP_V2_CANCELLATION *cancellation,
+                                            int *http_status, char **response,
+                                            size_t *response_bytes);
 int YAP_V2_http_runtime_state(YAP_V2_HTTP_RUNTIME *runtime,
                               YAP_V2_OPERATIONAL_STATE *state);
 int YAP_V2_http_runtime_reload(YAP_V2_HTTP_RUNTIME *runtime);
+/* The captured slow and sampled requests as NDJSON; see YAP_V2_slow_query_log_dump. */
+int YAP_V2_http_runtime_slow_queries(YAP_V2_HTTP_RUNTIME *runtime, size_t max_bytes,
+                                     char **ndjson, size_t *ndjson_bytes);
 int YAP_V2_http_runtime_maintain_ann(YAP_V2_HTTP_RUNTIME *runtime);
+/* Process-wide thread count for global and segment ANN graph construction; 0 uses all CPUs. */
+void YAP_V2_http_set_ann_build_threads(size_t threads);
+/* max_operations 0 disables the memtable; ingest then publishes one generation per group. */
+void YAP_V2_http_set_memtable_policy(size_t max_operations, uint32_t max_age_ms);
+/* Chooses when memtable WAL records are fsynced; see YAP_V2_WAL_DURABILITY. */
+void YAP_V2_http_set_wal_durability(YAP_V2_WAL_DURABILITY durability,
+                                    uint32_t sync_interval_ms);
+/* Significant bits of the per-stage search histograms of runtimes opened afterwards. */
+void YAP_V2_http_set_latency_precision(unsigned precision_bits);
+/* Slow-query log of runtimes opened afterwards: the slowest entries searches and retrieves
+ * per interval plus a one-in-sample_one_in random sample; entries 0 disables it. */
+void YAP_V2_http_set_slow_query_log(size_t entries, uint32_t interval_seconds,
+                                    uint32_t sample_one_in);
+int YAP_V2_http_runtime_maintain_memtable(YAP_V2_HTTP_RUNTIME *runtime);
 void YAP_V2_http_runtime_record_maintenance_deferral(
   YAP_V2_HTTP_RUNTIME *runtime);
+/* Counts a search dropped by the executor because its deadline passed while queued. */
+void YAP_V2_http_runtime_record_search_expired(YAP_V2_HTTP_RUNTIME *runtime);
+/* Searches record parse through render themselves; the caller adds the time a search
+ * waited for a worker as YAP_V2_SEARCH_STAGE_QUEUE_WAIT. */
+void YAP_V2_http_runtime_record_search_stage(YAP_V2_HTTP_RUNTIME *runtime,
+                                             YAP_V2_SEARCH_STAGE stage,
+                                             uint64_t elapsed_microseconds);
 int YAP_V2_http_runtime_execute_ingest_batch(
   YAP_V2_HTTP_RUNTIME *runtime, YAP_V2_HTTP_INGEST_ITEM *items,
   size_t item_count);
@@ -16,7 +16,8 @@
 #include <yyjson.h>
 
 #define YAP_V2_COMPACTION_STATUS_FILE "compaction.state"
-#define YAP_V2_METRICS_CAPACITY 32768U
+#define YAP_V2_METRICS_CAPACITY 65536U
+#define YAP_V2_LATENCY_MAX_MICROSECONDS UINT64_C(0xffffffff)
 
 static const uint64_t latency_bucket_us[YAP_V2_LATENCY_BUCKET_COUNT] = {
   5000U, 10000U, 25000U, 50000U, 100000U, 200000U, 500000U, 1000000U, UINT64_MAX
@@ -24,9 +25,32 @@ static const uint64_t latency_bucket_us[YAP_V2_LATENCY_BUCKET_COUNT] = {
 static const char *const latency_bucket_labels[YAP_V2_LATENCY_BUCKET_COUNT] = {
   "0.005", "0.010", "0.025", "0.050", "0.100", "0.200", "0.500", "1.000", "+Inf"
 };
+static const uint64_t wal_fsync_bucket_us[YAP_V2_WAL_FSYNC_BUCKET_COUNT] = {
+  500U, 1000U, 2000U, 5000U, 10000U, 25000U, 50000U, 100000U, UINT64_MAX
+};
+static const char *const wal_fsync_bucket_labels[YAP_V2_WAL_FSYNC_BUCKET_COUNT] = {
+  "0.0005", "0.001", "0.002", "0.005", "0.010", "0.025", "0.050", "0.100", "+Inf"
+};
 static const char *const operation_names[YAP_V2_OBSERVE_OPERATION_COUNT] = {
   "search", "retrieve", "ingest"
 };
+static const char *const search_stage_names[YAP_V2_SEARCH_STAGE_COUNT] = {
+  "queue_wait", "parse", "lexical", "vector", "fusion", "render"
+};
+static const double latency_quantiles[YAP_V2_LATENCY_QUANTILE_COUNT] = {
+  0.5, 0.9, 0.99, 0.999
+};
+static const char *const latency_quantile_labels[YAP_V2_LATENCY_QUANTILE_COUNT] = {
+  "0.5", "0.9", "0.99", "0.999"
+};
+static const char *const latency_quantile_keys[YAP_V2_LATENCY_QUANTILE_COUNT] = {
+  "p50_microseconds", "p90_microseconds", "p99_microseconds", "p999_microseconds"
+};
+
+static pthread_once_t shard_once = PTHREAD_ONCE_INIT;
+static pthread_key_t shard_key;
+static int shard_key_ready;
+static unsigned shard_next;
 
 static void set_error(char *error, size_t capacity, const char *message) {
   if (error != NULL && capacity > 0U) (void)snprintf(error, capacity, "%s", message);
@@ -36,6 +60,54 @@ static uint64_t saturated_add(uint64_t left, uint64_t right) {
   return UINT64_MAX - left < right ? UINT64_MAX : left + right;
 }
 
+static void shard_key_create(void) {
+  shard_key_ready = pthread_key_create(&shard_key, NULL) == 0;
+}
+
+/* Threads take shards round robin on first use, so a fixed worker pool spreads evenly. */
+static size_t metrics_shard(void) {
+  void *value;
+  uintptr_t shard;
+  if (pthread_once(&shard_once, shard_key_create) != 0 || !shard_key_ready) return 0U;
+  value = pthread_getspecific(shard_key);
+  if (value != NULL) return (size_t)((uintptr_t)value - 1U);
+  shard = __atomic_fetch_add(&shard_next, 1U, __ATOMIC_RELAXED) % YAP_V2_METRICS_SHARD_COUNT;
+  (void)pthread_setspecific(shard_key, (void *)(shard + 1U));
+  return (size_t)shard;
+}
+
+static void counter_add(uint64_t *counter, uint64_t value) {
+  (void)__atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static uint64_t counter_load(const uint64_t *counter) {
+  return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static size_t latency_bucket_index(unsigned precision_bits, uint64_t value) {
+  unsigned shift;
+  if (value > YAP_V2_LATENCY_MAX_MICROSECONDS) value = YAP_V2_LATENCY_MAX_MICROSECONDS;
+  if (value < (UINT64_C(1) << precision_bits)) return (size_t)value;
+  shift = 63U - (unsigned)__builtin_clzll(value) - precision_bits;
+  return ((size_t)(shift + 1U) << precision_bits) +
+         (size_t)((value >> shift) - (UINT64_C(1) << precision_bits));
+}
+
+static uint64_t latency_bucket_upper(unsigned precision_bits, size_t index) {
+  size_t sub_buckets = (size_t)1U << precision_bits;
+  unsigned shift;
+  if (index < sub_buckets) return (uint64_t)index;
+  shift = (unsigned)(index >> precision_bits) - 1U;
+  return (((uint64_t)(index & (sub_buckets - 1U)) + sub_buckets) << shift) +
+         ((UINT64_C(1) << shift) - 1U);
+}
+
+static double ann_build_vectors_per_second(const YAP_V2_OPERATIONAL_STATE *state) {
+  if (state->ann_last_build_microseconds == 0U) return 0.0;
+  return (double)state->ann_last_build_vectors * 1000000.0 /
+         (double)state->ann_last_build_microseconds;
+}
+
 static int join_path(char *output, size_t capacity, const char *left, const char *right) {
   int written = snprintf(output, capacity, "%s/%s", left, right);
   return written < 0 || (size_t)written >= capacity ? -1 : 0;
@@ -55,7 +127,8 @@ static YAP_V2_COMPACTION_STATE parse_compaction_state(const char *value) {
 
 static void read_compaction_status(const char *index_dir, YAP_V2_OPERATIONAL_STATE *state) {
   char path[4096], line[256], version[32], value[32], trailing;
-  long process_id; unsigned long long generation; long long updated; FILE *file;
+  long process_id; unsigned long long generation, ann[3] = {0U, 0U, 0U}; long long updated;
+  FILE *file; int fields;
   if (join_path(path, sizeof(path), index_dir, YAP_V2_COMPACTION_STATUS_FILE) != 0) {
     state->compaction_state = YAP_V2_COMPACTION_UNKNOWN; return;
   }
@@ -73,15 +146,20 @@ static void read_compaction_status(const char *index_dir, YAP_V2_OPERATIONAL_STA
       state->compaction_state = YAP_V2_COMPACTION_UNKNOWN; return;
     }
   }
-  if (
-      sscanf(line, "%31s\t%31s\t%ld\t%llu\t%lld%c", version, value, &process_id,
-             &generation, &updated, &trailing) != 6 || strcmp(version, "YAP2-COMPACTION") != 0 ||
+  /* Successful compactions append the ANN rebuild cost; older files end after the time. */
+  fields = sscanf(line, "%31s\t%31s\t%ld\t%llu\t%lld%c%llu\t%llu\t%llu%c", version, value,
+                  &process_id, &generation, &updated, &trailing, &ann[0], &ann[1], &ann[2],
+                  &trailing);
+  if ((fields != 6 && fields != 10) || strcmp(version, "YAP2-COMPACTION") != 0 ||
       trailing != '\n' || process_id < 0 || updated < 0) {
     state->compaction_state = YAP_V2_COMPACTION_UNKNOWN; return;
   }
   state->compaction_state = parse_compaction_state(value);
   state->compaction_generation = (uint64_t)generation;
   state->compaction_updated_at_unix = (int64_t)updated;
+  state->compaction_ann_build_microseconds = (uint64_t)ann[0];
+  state->compaction_ann_reused_vectors = (uint64_t)ann[1];
+  state->compaction_ann_inserted_vectors = (uint64_t)ann[2];
   if (state->compaction_state == YAP_V2_COMPACTION_RUNNING &&
       (process_id == 0 || (kill((pid_t)process_id, 0) != 0 && errno != EPERM)))
     state->compaction_state = YAP_V2_COMPACTION_INTERRUPTED;
@@ -159,12 +237,46 @@ int YAP_V2_operational_probe_index(
     index_dir, &policy, state, error, error_size);
 }
 
+static int add_latency_summary(yyjson_mut_doc *document, yyjson_mut_val *parent,
+                               const char *key, const YAP_V2_LATENCY_SUMMARY *summary) {
+  yyjson_mut_val *object = yyjson_mut_obj(document);
+  size_t quantile;
+  if (object == NULL ||
+      !yyjson_mut_obj_add_uint(document, object, "count", summary->count) ||
+      !yyjson_mut_obj_add_uint(document, object, "microseconds", summary->microseconds))
+    return -1;
+  for (quantile = 0U; quantile < YAP_V2_LATENCY_QUANTILE_COUNT; quantile++)
+    if (!yyjson_mut_obj_add_uint(document, object, latency_quantile_keys[quantile],
+                                 summary->quantiles[quantile])) return -1;
+  return yyjson_mut_obj_add_val(document, parent, key, object) ? 0 : -1;
+}
+
+static int read_latency_summary(yyjson_val *parent, const char *key,
+                                YAP_V2_LATENCY_SUMMARY *summary) {
+  yyjson_val *object = yyjson_obj_get(parent, key), *value;
+  size_t quantile;
+  if (!yyjson_is_obj(object)) return -1;
+  value = yyjson_obj_get(object, "count");
+  if (!yyjson_is_uint(value)) return -1;
+  summary->count = yyjson_get_uint(value);
+  value = yyjson_obj_get(object, "microseconds");
+  if (!yyjson_is_uint(value)) return -1;
+  summary->microseconds = yyjson_get_uint(value);
+  for (quantile = 0U; quantile < YAP_V2_LATENCY_QUANTILE_COUNT; quantile++) {
+    value = yyjson_obj_get(object, latency_quantile_keys[quantile]);
+    if (!yyjson_is_uint(value)) return -1;
+    summary->quantiles[quantile] = yyjson_get_uint(value);
+  }
+  return 0;
+}
+
 int YAP_V2_operational_state_json(const YAP_V2_OPERATIONAL_STATE *state, const char *service,
                                   char **json, size_t *json_bytes) {
   yyjson_mut_doc *document;
   yyjson_mut_val *root, *embedding, *ann, *compaction, *segment_health;
-  yyjson_mut_val *update_pipeline;
+  yyjson_mut_val *update_pipeline, *wal_fsync_buckets, *search_scheduling, *search_stages;
   char *rendered;
+  size_t stage;
   if (state == NULL || service == NULL || json == NULL || json_bytes == NULL) return YAP_V2_INVALID_ARGUMENT;
   *json = NULL; *json_bytes = 0U; document = yyjson_mut_doc_new(NULL);
   if (document == NULL) return YAP_V2_ALLOCATION_FAILED;
@@ -173,8 +285,15 @@ int YAP_V2_operational_state_json(const YAP_V2_OPERATIONAL_STATE *state, const c
   compaction = yyjson_mut_obj(document);
   segment_health = yyjson_mut_obj(document);
   update_pipeline = yyjson_mut_obj(document);
+  search_scheduling = yyjson_mut_obj(document);
+  search_stages = yyjson_mut_obj(document);
+  for (stage = 0U; search_stages != NULL && stage < YAP_V2_SEARCH_STAGE_COUNT; stage++) {
+    if (add_latency_summary(document, search_stages, search_stage_names[stage],
+                            &state->search_stages[stage]) != 0) search_stages = NULL;
+  }
   if (root == NULL || embedding == NULL || ann == NULL || compaction == NULL ||
-      segment_health == NULL || update_pipeline == NULL ||
+      segment_health == NULL || update_pipeline == NULL || search_scheduling == NULL ||
+      search_stages == NULL ||
       !yyjson_mut_obj_add_str(document, root, "status", state->ready ? "ready" : "not_ready") ||
       !yyjson_mut_obj_add_str(document, root, "service", service) ||
       !yyjson_mut_obj_add_bool(document, root, "ready", state->ready != 0) ||
@@ -235,6 +354,14 @@ int YAP_V2_operational_state_json(const YAP_V2_OPERATIONAL_STATE *state, const c
       !yyjson_mut_obj_add_uint(document, ann, "rebuilds", state->ann_rebuilds) ||
       !yyjson_mut_obj_add_uint(document, ann, "rebuild_failures",
                               state->ann_rebuild_failures) ||
+      !yyjson_mut_obj_add_uint(document, ann, "incremental_updates",
+                              state->ann_incremental_updates) ||
+      !yyjson_mut_obj_add_uint(document, ann, "last_build_vectors",
+                              state->ann_last_build_vectors) ||
+      !yyjson_mut_obj_add_uint(document, ann, "last_build_microseconds",
+                              state->ann_last_build_microseconds) ||
+      !yyjson_mut_obj_add_real(document, ann, "last_build_vectors_per_second",
+                              ann_build_vectors_per_second(state)) ||
       !yyjson_mut_obj_add_val(document, root, "ann", ann) ||
       !yyjson_mut_obj_add_uint(document, update_pipeline, "microbatches",
                               state->ingest_microbatches) ||
@@ -254,17 +381,54 @@ int YAP_V2_operational_state_json(const YAP_V2_OPERATIONAL_STATE *state, const c
       !yyjson_mut_obj_add_uint(document, update_pipeline,
                               "max_batch_operations",
                               state->ingest_max_batch_operations) ||
+      !yyjson_mut_obj_add_uint(document, update_pipeline, "parse_microseconds",
+                              state->ingest_parse_microseconds) ||
+      !yyjson_mut_obj_add_uint(document, update_pipeline, "publish_microseconds",
+                              state->ingest_publish_microseconds) ||
       !yyjson_mut_obj_add_uint(document, update_pipeline, "wal_recoveries",
                               state->update_wal_recoveries) ||
+      !yyjson_mut_obj_add_uint(document, update_pipeline, "memtable_operations",
+                              state->memtable_operations) ||
+      !yyjson_mut_obj_add_uint(document, update_pipeline, "memtable_flushes",
+                              state->memtable_flushes) ||
+      !yyjson_mut_obj_add_uint(document, update_pipeline, "wal_appends",
+                              state->wal_appends) ||
+      !yyjson_mut_obj_add_uint(document, update_pipeline, "wal_fsyncs",
+                              state->wal_fsync.count) ||
+      !yyjson_mut_obj_add_uint(document, update_pipeline, "wal_fsync_microseconds",
+                              state->wal_fsync.microseconds) ||
+      (wal_fsync_buckets = yyjson_mut_arr_with_uint64(
+         document, state->wal_fsync.buckets, YAP_V2_WAL_FSYNC_BUCKET_COUNT)) == NULL ||
+      !yyjson_mut_obj_add_val(document, update_pipeline, "wal_fsync_buckets",
+                             wal_fsync_buckets) ||
       !yyjson_mut_obj_add_uint(document, update_pipeline,
                               "maintenance_foreground_deferrals",
                               state->maintenance_foreground_deferrals) ||
       !yyjson_mut_obj_add_val(document, root, "update_pipeline",
                              update_pipeline) ||
+      !yyjson_mut_obj_add_uint(document, search_scheduling, "deadline_expired",
+                              state->search_deadline_expired) ||
+      !yyjson_mut_obj_add_uint(document, search_scheduling, "cancelled",
+                              state->search_cancelled) ||
+      !yyjson_mut_obj_add_uint(document, search_scheduling, "concurrency_limit",
+                              state->core_concurrency_limit) ||
+      !yyjson_mut_obj_add_uint(document, search_scheduling, "rtt_noload_microseconds",
+                              state->core_rtt_noload_microseconds) ||
+      !yyjson_mut_obj_add_uint(document, search_scheduling, "admission_rejected",
+                              state->core_admission_rejected) ||
+      !yyjson_mut_obj_add_val(document, root, "search_scheduling",
+                             search_scheduling) ||
+      !yyjson_mut_obj_add_val(document, root, "search_stages", search_stages) ||
       !yyjson_mut_obj_add_str(document, compaction, "state",
         YAP_V2_compaction_state_name(state->compaction_state)) ||
       !yyjson_mut_obj_add_uint(document, compaction, "generation", state->compaction_generation) ||
       !yyjson_mut_obj_add_sint(document, compaction, "updated_at_unix", state->compaction_updated_at_unix) ||
+      !yyjson_mut_obj_add_real(document, compaction, "ann_build_seconds",
+                               (double)state->compaction_ann_build_microseconds / 1000000.0) ||
+      !yyjson_mut_obj_add_uint(document, compaction, "ann_reused_vectors",
+                               state->compaction_ann_reused_vectors) ||
+      !yyjson_mut_obj_add_uint(document, compaction, "ann_inserted_vectors",
+                               state->compaction_ann_inserted_vectors) ||
       !yyjson_mut_obj_add_val(document, root, "compaction", compaction)) {
     yyjson_mut_doc_free(document); return YAP_V2_ALLOCATION_FAILED;
   }
@@ -279,14 +443,19 @@ int YAP_V2_operational_state_merge_core_json(YAP_V2_OPERATIONAL_STATE *state,
                                              const unsigned char *json,
                                              size_t json_bytes) {
   yyjson_doc *document;
-  yyjson_val *root, *ann, *update_pipeline, *value;
+  yyjson_val *root, *ann, *update_pipeline, *search_scheduling, *search_stages, *value;
+  size_t stage;
   if (state == NULL || json == NULL || json_bytes == 0U) return YAP_V2_INVALID_ARGUMENT;
   document = yyjson_read((const char *)json, json_bytes, YYJSON_READ_NOFLAG);
   root = document == NULL ? NULL : yyjson_doc_get_root(document);
   ann = yyjson_is_obj(root) ? yyjson_obj_get(root, "ann") : NULL;
   update_pipeline = yyjson_is_obj(root) ?
                     yyjson_obj_get(root, "update_pipeline") : NULL;
-  if (!yyjson_is_obj(ann) || !yyjson_is_obj(update_pipeline)) {
+  search_scheduling = yyjson_is_obj(root) ?
+                      yyjson_obj_get(root, "search_scheduling") : NULL;
+  search_stages = yyjson_is_obj(root) ? yyjson_obj_get(root, "search_stages") : NULL;
+  if (!yyjson_is_obj(ann) || !yyjson_is_obj(update_pipeline) ||
+      !yyjson_is_obj(search_scheduling) || !yyjson_is_obj(search_stages)) {
     if (document != NULL) yyjson_doc_free(document);
     return YAP_V2_INVALID_FORMAT;
   }
@@ -305,6 +474,9 @@ int YAP_V2_operational_state_merge_core_json(YAP_V2_OPERATIONAL_STATE *state,
   COPY_ANN_UINT("candidates_rejected", ann_candidates_rejected);
   COPY_ANN_UINT("rebuilds", ann_rebuilds);
   COPY_ANN_UINT("rebuild_failures", ann_rebuild_failures);
+  COPY_ANN_UINT("incremental_updates", ann_incremental_updates);
+  COPY_ANN_UINT("last_build_vectors", ann_last_build_vectors);
+  COPY_ANN_UINT("last_build_microseconds", ann_last_build_microseconds);
 #undef COPY_ANN_UINT
 #define COPY_UPDATE_UINT(json_key, field) \
   value = yyjson_obj_get(update_pipeline, json_key); \
@@ -317,41 +489,97 @@ int YAP_V2_operational_state_merge_core_json(YAP_V2_OPERATIONAL_STATE *state,
   COPY_UPDATE_UINT("generations_saved", ingest_generations_saved);
   COPY_UPDATE_UINT("max_batch_requests", ingest_max_batch_requests);
   COPY_UPDATE_UINT("max_batch_operations", ingest_max_batch_operations);
+  COPY_UPDATE_UINT("parse_microseconds", ingest_parse_microseconds);
+  COPY_UPDATE_UINT("publish_microseconds", ingest_publish_microseconds);
   COPY_UPDATE_UINT("wal_recoveries", update_wal_recoveries);
+  COPY_UPDATE_UINT("memtable_operations", memtable_operations);
+  COPY_UPDATE_UINT("memtable_flushes", memtable_flushes);
+  COPY_UPDATE_UINT("wal_appends", wal_appends);
+  COPY_UPDATE_UINT("wal_fsyncs", wal_fsync.count);
+  COPY_UPDATE_UINT("wal_fsync_microseconds", wal_fsync.microseconds);
+  value = yyjson_obj_get(update_pipeline, "wal_fsync_buckets");
+  if (yyjson_arr_size(value) != YAP_V2_WAL_FSYNC_BUCKET_COUNT) {
+    yyjson_doc_free(document); return YAP_V2_INVALID_FORMAT;
+  }
+  {
+    yyjson_arr_iter iterator;
+    yyjson_val *bucket;
+    size_t index = 0U;
+    yyjson_arr_iter_init(value, &iterator);
+    while ((bucket = yyjson_arr_iter_next(&iterator)) != NULL) {
+      if (!yyjson_is_uint(bucket)) { yyjson_doc_free(document); return YAP_V2_INVALID_FORMAT; }
+      state->wal_fsync.buckets[index++] = yyjson_get_uint(bucket);
+    }
+  }
   COPY_UPDATE_UINT("maintenance_foreground_deferrals",
                    maintenance_foreground_deferrals);
 #undef COPY_UPDATE_UINT
+  value = yyjson_obj_get(search_scheduling, "deadline_expired");
+  if (!yyjson_is_uint(value)) { yyjson_doc_free(document); return YAP_V2_INVALID_FORMAT; }
+  state->search_deadline_expired = yyjson_get_uint(value);
+  value = yyjson_obj_get(search_scheduling, "cancelled");
+  if (!yyjson_is_uint(value)) { yyjson_doc_free(document); return YAP_V2_INVALID_FORMAT; }
+  state->search_cancelled = yyjson_get_uint(value);
+  value = yyjson_obj_get(search_scheduling, "concurrency_limit");
+  if (!yyjson_is_uint(value)) { yyjson_doc_free(document); return YAP_V2_INVALID_FORMAT; }
+  state->core_concurrency_limit = yyjson_get_uint(value);
+  value = yyjson_obj_get(search_scheduling, "rtt_noload_microseconds");
+  if (!yyjson_is_uint(value)) { yyjson_doc_free(document); return YAP_V2_INVALID_FORMAT; }
+  state->core_rtt_noload_microseconds = yyjson_get_uint(value);
+  value = yyjson_obj_get(search_scheduling, "admission_rejected");
+  if (!yyjson_is_uint(value)) { yyjson_doc_free(document); return YAP_V2_INVALID_FORMAT; }
+  state->core_admission_rejected = yyjson_get_uint(value);
+  for (stage = 0U; stage < YAP_V2_SEARCH_STAGE_COUNT; stage++)
+    if (read_latency_summary(search_stages, search_stage_names[stage],
+                             &state->search_stages[stage]) != 0) {
+      yyjson_doc_free(document); return YAP_V2_INVALID_FORMAT;
+    }
   yyjson_doc_free(document);
   return YAP_V2_OK;
 }
 
 int YAP_V2_metrics_init(YAP_V2_METRICS *metrics) {
+  return YAP_V2_metrics_init_with_precision(metrics, YAP_V2_LATENCY_DEFAULT_PRECISION_BITS);
+}
+
+int YAP_V2_metrics_init_with_precision(YAP_V2_METRICS *metrics, unsigned precision_bits) {
+  size_t operation;
+  int status = YAP_V2_OK;
   if (metrics == NULL) return YAP_V2_INVALID_ARGUMENT;
   memset(metrics, 0, sizeof(*metrics));
-  if (pthread_mutex_init(&metrics->lock, NULL) != 0) return YAP_V2_IO_ERROR;
+  for (operation = 0U; status == YAP_V2_OK && operation < YAP_V2_OBSERVE_OPERATION_COUNT;
+       operation++)
+    status = YAP_V2_latency_histogram_init(&metrics->latency[operation], precision_bits);
+  if (status != YAP_V2_OK) {
+    for (operation = 0U; operation < YAP_V2_OBSERVE_OPERATION_COUNT; operation++)
+      YAP_V2_latency_histogram_free(&metrics->latency[operation]);
+    return status;
+  }
   metrics->initialized = 1; return YAP_V2_OK;
 }
 
 void YAP_V2_metrics_close(YAP_V2_METRICS *metrics) {
+  size_t operation;
   if (metrics == NULL || !metrics->initialized) return;
-  (void)pthread_mutex_destroy(&metrics->lock); memset(metrics, 0, sizeof(*metrics));
+  for (operation = 0U; operation < YAP_V2_OBSERVE_OPERATION_COUNT; operation++)
+    YAP_V2_latency_histogram_free(&metrics->latency[operation]);
+  memset(metrics, 0, sizeof(*metrics));
 }
 
 void YAP_V2_metrics_record(YAP_V2_METRICS *metrics, YAP_V2_OBSERVE_OPERATION operation,
                            int http_status, uint64_t elapsed_microseconds) {
+  YAP_V2_METRICS_SHARD *shard;
   size_t status_class, i;
   if (metrics == NULL || !metrics->initialized || operation < 0 ||
       operation >= YAP_V2_OBSERVE_OPERATION_COUNT) return;
   status_class = http_status >= 200 && http_status < 300 ? 0U :
                  http_status >= 400 && http_status < 500 ? 1U : 2U;
-  pthread_mutex_lock(&metrics->lock);
-  metrics->requests[operation][status_class] = saturated_add(metrics->requests[operation][status_class], 1U);
-  metrics->latency_count[operation] = saturated_add(metrics->latency_count[operation], 1U);
-  metrics->latency_microseconds[operation] = saturated_add(metrics->latency_microseconds[operation], elapsed_microseconds);
+  shard = &metrics->shards[metrics_shard()];
+  counter_add(&shard->requests[operation][status_class], 1U);
   for (i = 0U; i < YAP_V2_LATENCY_BUCKET_COUNT; i++)
     if (elapsed_microseconds <= latency_bucket_us[i])
-      metrics->latency_buckets[operation][i] = saturated_add(metrics->latency_buckets[operation][i], 1U);
-  pthread_mutex_unlock(&metrics->lock);
+      counter_add(&shard->latency_buckets[operation][i], 1U);
+  YAP_V2_latency_histogram_record(&metrics->latency[operation], elapsed_microseconds);
 }
 
 static int append(char *output, size_t capacity, size_t *used, const char *format, ...) {
@@ -366,16 +594,24 @@ int YAP_V2_metrics_render(YAP_V2_METRICS *metrics, const YAP_V2_OPERATIONAL_STAT
                           size_t inflight, size_t inflight_bytes, size_t max_inflight,
                           size_t max_inflight_bytes, char **output, size_t *output_bytes) {
   uint64_t requests[YAP_V2_OBSERVE_OPERATION_COUNT][3];
-  uint64_t counts[YAP_V2_OBSERVE_OPERATION_COUNT], sums[YAP_V2_OBSERVE_OPERATION_COUNT];
   uint64_t buckets[YAP_V2_OBSERVE_OPERATION_COUNT][YAP_V2_LATENCY_BUCKET_COUNT];
-  char *rendered; size_t used = 0U, operation, bucket;
+  YAP_V2_LATENCY_SUMMARY latency[YAP_V2_OBSERVE_OPERATION_COUNT];
+  char *rendered; size_t used = 0U, operation, bucket, shard, quantile, stage;
   if (metrics == NULL || !metrics->initialized || state == NULL || output == NULL || output_bytes == NULL)
     return YAP_V2_INVALID_ARGUMENT;
   *output = NULL; *output_bytes = 0U;
-  pthread_mutex_lock(&metrics->lock);
-  memcpy(requests, metrics->requests, sizeof(requests)); memcpy(counts, metrics->latency_count, sizeof(counts));
-  memcpy(sums, metrics->latency_microseconds, sizeof(sums)); memcpy(buckets, metrics->latency_buckets, sizeof(buckets));
-  pthread_mutex_unlock(&metrics->lock);
+  memset(requests, 0, sizeof(requests)); memset(buckets, 0, sizeof(buckets));
+  for (shard = 0U; shard < YAP_V2_METRICS_SHARD_COUNT; shard++)
+    for (operation = 0U; operation < YAP_V2_OBSERVE_OPERATION_COUNT; operation++) {
+      for (bucket = 0U; bucket < 3U; bucket++)
+        requests[operation][bucket] = saturated_add(requests[operation][bucket],
+          counter_load(&metrics->shards[shard].requests[operation][bucket]));
+      for (bucket = 0U; bucket < YAP_V2_LATENCY_BUCKET_COUNT; bucket++)
+        buckets[operation][bucket] = saturated_add(buckets[operation][bucket],
+          counter_load(&metrics->shards[shard].latency_buckets[operation][bucket]));
+    }
+  for (operation = 0U; operation < YAP_V2_OBSERVE_OPERATION_COUNT; operation++)
+    YAP_V2_latency_histogram_summary(&metrics->latency[operation], &latency[operation]);
   rendered = malloc(YAP_V2_METRICS_CAPACITY); if (rendered == NULL) return YAP_V2_ALLOCATION_FAILED;
   if (append(rendered,YAP_V2_METRICS_CAPACITY,&used,"# HELP yappod_v2_requests_total Completed v2 HTTP requests.\n# TYPE yappod_v2_requests_total counter\n") != 0) goto range;
   for (operation = 0U; operation < YAP_V2_OBSERVE_OPERATION_COUNT; operation++) {
@@ -396,8 +632,21 @@ int YAP_V2_metrics_render(YAP_V2_METRICS *metrics, const YAP_V2_OPERATIONAL_STAT
     if (append(rendered,YAP_V2_METRICS_CAPACITY,&used,
         "yappod_v2_request_duration_seconds_sum{operation=\"%s\"} %.6f\n"
         "yappod_v2_request_duration_seconds_count{operation=\"%s\"} %llu\n",
-        operation_names[operation], (double)sums[operation] / 1000000.0,
-        operation_names[operation], (unsigned long long)counts[operation]) != 0) goto range;
+        operation_names[operation], (double)latency[operation].microseconds / 1000000.0,
+        operation_names[operation], (unsigned long long)latency[operation].count) != 0) goto range;
+  }
+  if (append(rendered,YAP_V2_METRICS_CAPACITY,&used,"# HELP yappod_v2_request_latency_seconds End-to-end v2 HTTP request latency quantiles.\n# TYPE yappod_v2_request_latency_seconds summary\n") != 0) goto range;
+  for (operation = 0U; operation < YAP_V2_OBSERVE_OPERATION_COUNT; operation++) {
+    for (quantile = 0U; quantile < YAP_V2_LATENCY_QUANTILE_COUNT; quantile++)
+      if (append(rendered,YAP_V2_METRICS_CAPACITY,&used,
+          "yappod_v2_request_latency_seconds{operation=\"%s\",quantile=\"%s\"} %.6f\n",
+          operation_names[operation], latency_quantile_labels[quantile],
+          (double)latency[operation].quantiles[quantile] / 1000000.0) != 0) goto range;
+    if (append(rendered,YAP_V2_METRICS_CAPACITY,&used,
+        "yappod_v2_request_latency_seconds_sum{operation=\"%s\"} %.6f\n"
+        "yappod_v2_request_latency_seconds_count{operation=\"%s\"} %llu\n",
+        operation_names[operation], (double)latency[operation].microseconds / 1000000.0,
+        operation_names[operation], (unsigned long long)latency[operation].count) != 0) goto range;
   }
   if (append(rendered,YAP_V2_METRICS_CAPACITY,&used,
       "# TYPE yappod_v2_ready gauge\nyappod_v2_ready %d\n"
@@ -430,17 +679,9 @@ int YAP_V2_metrics_render(YAP_V2_METRICS *metrics, const YAP_V2_OPERATIONAL_STAT
       "yappod_v2_ann_candidates_total{result=\"rejected\"} %llu\n"
       "# TYPE yappod_v2_ann_rebuilds_total counter\nyappod_v2_ann_rebuilds_total{result=\"success\"} %llu\n"
       "yappod_v2_ann_rebuilds_total{result=\"failure\"} %llu\n"
-      "# TYPE yappod_v2_ingest_microbatches_total counter\nyappod_v2_ingest_microbatches_total %llu\n"
-      "# TYPE yappod_v2_ingest_requests_total counter\nyappod_v2_ingest_requests_total %llu\n"
-      "# TYPE yappod_v2_ingest_operations_total counter\nyappod_v2_ingest_operations_total %llu\n"
-      "# TYPE yappod_v2_ingest_published_generations_total counter\nyappod_v2_ingest_published_generations_total %llu\n"
-      "# TYPE yappod_v2_ingest_generations_saved_total counter\nyappod_v2_ingest_generations_saved_total %llu\n"
-      "# TYPE yappod_v2_ingest_max_batch_requests gauge\nyappod_v2_ingest_max_batch_requests %llu\n"
-      "# TYPE yappod_v2_ingest_max_batch_operations gauge\nyappod_v2_ingest_max_batch_operations %llu\n"
-      "# TYPE yappod_v2_update_wal_recoveries_total counter\nyappod_v2_update_wal_recoveries_total %llu\n"
-      "# TYPE yappod_v2_maintenance_foreground_deferrals_total counter\nyappod_v2_maintenance_foreground_deferrals_total %llu\n"
-      "# TYPE yappod_v2_compaction_state gauge\nyappod_v2_compaction_state{state=\"%s\"} 1\n"
-      "# TYPE yappod_v2_compaction_generation gauge\nyappod_v2_compaction_generation %llu\n",
+      "# TYPE yappod_v2_ann_incremental_updates_total counter\nyappod_v2_ann_incremental_updates_total %llu\n"
+      "# TYPE yappod_v2_ann_build_vectors gauge\nyappod_v2_ann_build_vectors %llu\n"
+      "# TYPE yappod_v2_ann_build_vectors_per_second gauge\nyappod_v2_ann_build_vectors_per_second %.1f\n",
       state->ready != 0, (unsigned long long)state->generation,
       state->segment_count,
       (unsigned long long)state->document_records,
@@ -465,6 +706,28 @@ int YAP_V2_metrics_render(YAP_V2_METRICS *metrics, const YAP_V2_OPERATIONAL_STAT
       (unsigned long long)state->ann_candidates_rejected,
       (unsigned long long)state->ann_rebuilds,
       (unsigned long long)state->ann_rebuild_failures,
+      (unsigned long long)state->ann_incremental_updates,
+      (unsigned long long)state->ann_last_build_vectors,
+      ann_build_vectors_per_second(state)) != 0 ||
+      append(rendered,YAP_V2_METRICS_CAPACITY,&used,
+      "# TYPE yappod_v2_ingest_microbatches_total counter\nyappod_v2_ingest_microbatches_total %llu\n"
+      "# TYPE yappod_v2_ingest_requests_total counter\nyappod_v2_ingest_requests_total %llu\n"
+      "# TYPE yappod_v2_ingest_operations_total counter\nyappod_v2_ingest_operations_total %llu\n"
+      "# TYPE yappod_v2_ingest_published_generations_total counter\nyappod_v2_ingest_published_generations_total %llu\n"
+      "# TYPE yappod_v2_ingest_generations_saved_total counter\nyappod_v2_ingest_generations_saved_total %llu\n"
+      "# TYPE yappod_v2_ingest_max_batch_requests gauge\nyappod_v2_ingest_max_batch_requests %llu\n"
+      "# TYPE yappod_v2_ingest_max_batch_operations gauge\nyappod_v2_ingest_max_batch_operations %llu\n"
+      "# TYPE yappod_v2_ingest_stage_seconds_total counter\nyappod_v2_ingest_stage_seconds_total{stage=\"parse\"} %.6f\n"
+      "yappod_v2_ingest_stage_seconds_total{stage=\"publish\"} %.6f\n"
+      "# TYPE yappod_v2_update_wal_recoveries_total counter\nyappod_v2_update_wal_recoveries_total %llu\n"
+      "# TYPE yappod_v2_memtable_operations gauge\nyappod_v2_memtable_operations %llu\n"
+      "# TYPE yappod_v2_memtable_flushes_total counter\nyappod_v2_memtable_flushes_total %llu\n"
+      "# TYPE yappod_v2_maintenance_foreground_deferrals_total counter\nyappod_v2_maintenance_foreground_deferrals_total %llu\n"
+      "# TYPE yappod_v2_compaction_state gauge\nyappod_v2_compaction_state{state=\"%s\"} 1\n"
+      "# TYPE yappod_v2_compaction_generation gauge\nyappod_v2_compaction_generation %llu\n"
+      "# TYPE yappod_v2_compaction_ann_build_seconds gauge\nyappod_v2_compaction_ann_build_seconds %.6f\n"
+      "# TYPE yappod_v2_compaction_ann_vectors gauge\nyappod_v2_compaction_ann_vectors{source=\"reused\"} %llu\n"
+      "yappod_v2_compaction_ann_vectors{source=\"inserted\"} %llu\n",
       (unsigned long long)state->ingest_microbatches,
       (unsigned long long)state->ingest_requests,
       (unsigned long long)state->ingest_operations,
@@ -472,15 +735,154 @@ int YAP_V2_metrics_render(YAP_V2_METRICS *metrics, const YAP_V2_OPERATIONAL_STAT
       (unsigned long long)state->ingest_generations_saved,
       (unsigned long long)state->ingest_max_batch_requests,
       (unsigned long long)state->ingest_max_batch_operations,
+      (double)state->ingest_parse_microseconds / 1000000.0,
+      (double)state->ingest_publish_microseconds / 1000000.0,
       (unsigned long long)state->update_wal_recoveries,
+      (unsigned long long)state->memtable_operations,
+      (unsigned long long)state->memtable_flushes,
       (unsigned long long)state->maintenance_foreground_deferrals,
       YAP_V2_compaction_state_name(state->compaction_state),
-      (unsigned long long)state->compaction_generation) != 0) goto range;
+      (unsigned long long)state->compaction_generation,
+      (double)state->compaction_ann_build_microseconds / 1000000.0,
+      (unsigned long long)state->compaction_ann_reused_vectors,
+      (unsigned long long)state->compaction_ann_inserted_vectors) != 0) goto range;
+  if (append(rendered,YAP_V2_METRICS_CAPACITY,&used,
+      "# TYPE yappod_v2_wal_appends_total counter\nyappod_v2_wal_appends_total %llu\n"
+      "# HELP yappod_v2_wal_fsync_seconds Core update WAL fsync latency.\n"
+      "# TYPE yappod_v2_wal_fsync_seconds histogram\n",
+      (unsigned long long)state->wal_appends) != 0) goto range;
+  for (bucket = 0U; bucket < YAP_V2_WAL_FSYNC_BUCKET_COUNT; bucket++)
+    if (append(rendered,YAP_V2_METRICS_CAPACITY,&used,
+        "yappod_v2_wal_fsync_seconds_bucket{le=\"%s\"} %llu\n", wal_fsync_bucket_labels[bucket],
+        (unsigned long long)state->wal_fsync.buckets[bucket]) != 0) goto range;
+  if (append(rendered,YAP_V2_METRICS_CAPACITY,&used,
+      "yappod_v2_wal_fsync_seconds_sum %.6f\nyappod_v2_wal_fsync_seconds_count %llu\n"
+      "# TYPE yappod_v2_search_deadline_expired_total counter\nyappod_v2_search_deadline_expired_total %llu\n"
+      "# TYPE yappod_v2_search_cancelled_total counter\nyappod_v2_search_cancelled_total %llu\n"
+      "# HELP yappod_v2_concurrency_limit Search count limit currently enforced by admission.\n"
+      "# TYPE yappod_v2_concurrency_limit gauge\n"
+      "yappod_v2_concurrency_limit{stage=\"front\"} %llu\n"
+      "yappod_v2_concurrency_limit{stage=\"core\"} %llu\n"
+      "# TYPE yappod_v2_concurrency_rtt_noload_seconds gauge\n"
+      "yappod_v2_concurrency_rtt_noload_seconds{stage=\"front\"} %.6f\n"
+      "yappod_v2_concurrency_rtt_noload_seconds{stage=\"core\"} %.6f\n"
+      "# TYPE yappod_v2_admission_rejected_total counter\n"
+      "yappod_v2_admission_rejected_total{stage=\"front\"} %llu\n"
+      "yappod_v2_admission_rejected_total{stage=\"core\"} %llu\n",
+      (double)state->wal_fsync.microseconds / 1000000.0,
+      (unsigned long long)state->wal_fsync.count,
+      (unsigned long long)state->search_deadline_expired,
+      (unsigned long long)state->search_cancelled,
+      (unsigned long long)state->front_concurrency_limit,
+      (unsigned long long)state->core_concurrency_limit,
+      (double)state->front_rtt_noload_microseconds / 1000000.0,
+      (double)state->core_rtt_noload_microseconds / 1000000.0,
+      (unsigned long long)state->front_admission_rejected,
+      (unsigned long long)state->core_admission_rejected) != 0) goto range;
+  if (append(rendered,YAP_V2_METRICS_CAPACITY,&used,"# HELP yappod_v2_search_stage_seconds Core search time per stage.\n# TYPE yappod_v2_search_stage_seconds summary\n") != 0) goto range;
+  for (stage = 0U; stage < YAP_V2_SEARCH_STAGE_COUNT; stage++) {
+    const YAP_V2_LATENCY_SUMMARY *summary = &state->search_stages[stage];
+    for (quantile = 0U; quantile < YAP_V2_LATENCY_QUANTILE_COUNT; quantile++)
+      if (append(rendered,YAP_V2_METRICS_CAPACITY,&used,
+          "yappod_v2_search_stage_seconds{stage=\"%s\",quantile=\"%s\"} %.6f\n",
+          search_stage_names[stage], latency_quantile_labels[quantile],
+          (double)summary->quantiles[quantile] / 1000000.0) != 0) goto range;
+    if (append(rendered,YAP_V2_METRICS_CAPACITY,&used,
+        "yappod_v2_search_stage_seconds_sum{stage=\"%s\"} %.6f\n"
+        "yappod_v2_search_stage_seconds_count{stage=\"%s\"} %llu\n",
+        search_stage_names[stage], (double)summary->microseconds / 1000000.0,
+        search_stage_names[stage], (unsigned long long)summary->count) != 0) goto range;
+  }
   *output = rendered; *output_bytes = used; return YAP_V2_OK;
 range:
   free(rendered); return YAP_V2_OUT_OF_RANGE;
 }
 
+void YAP_V2_wal_fsync_histogram_record(YAP_V2_WAL_FSYNC_HISTOGRAM *histogram,
+                                       uint64_t elapsed_microseconds) {
+  size_t i;
+  if (histogram == NULL) return;
+  histogram->count = saturated_add(histogram->count, 1U);
+  histogram->microseconds = saturated_add(histogram->microseconds, elapsed_microseconds);
+  for (i = 0U; i < YAP_V2_WAL_FSYNC_BUCKET_COUNT; i++)
+    if (elapsed_microseconds <= wal_fsync_bucket_us[i])
+      histogram->buckets[i] = saturated_add(histogram->buckets[i], 1U);
+}
+
+int YAP_V2_latency_histogram_init(YAP_V2_LATENCY_HISTOGRAM *histogram,
+                                  unsigned precision_bits) {
+  if (histogram == NULL) return YAP_V2_INVALID_ARGUMENT;
+  memset(histogram, 0, sizeof(*histogram));
+  if (precision_bits == 0U || precision_bits > YAP_V2_LATENCY_MAX_PRECISION_BITS)
+    return YAP_V2_OUT_OF_RANGE;
+  histogram->precision_bits = precision_bits;
+  histogram->bucket_count =
+    latency_bucket_index(precision_bits, YAP_V2_LATENCY_MAX_MICROSECONDS) + 1U;
+  /* count, microseconds and the buckets, rounded to whole cache lines plus one spare line. */
+  histogram->shard_stride = (2U + histogram->bucket_count + 7U) / 8U * 8U + 8U;
+  histogram->cells = calloc(YAP_V2_METRICS_SHARD_COUNT * histogram->shard_stride,
+                            sizeof(*histogram->cells));
+  if (histogram->cells == NULL) {
+    memset(histogram, 0, sizeof(*histogram));
+    return YAP_V2_ALLOCATION_FAILED;
+  }
+  return YAP_V2_OK;
+}
+
+void YAP_V2_latency_histogram_free(YAP_V2_LATENCY_HISTOGRAM *histogram) {
+  if (histogram == NULL) return;
+  free(histogram->cells);
+  memset(histogram, 0, sizeof(*histogram));
+}
+
+void YAP_V2_latency_histogram_record(YAP_V2_LATENCY_HISTOGRAM *histogram,
+                                     uint64_t elapsed_microseconds) {
+  uint64_t *cells;
+  if (histogram == NULL || histogram->cells == NULL) return;
+  cells = histogram->cells + metrics_shard() * histogram->shard_stride;
+  counter_add(&cells[0], 1U);
+  counter_add(&cells[1], elapsed_microseconds);
+  counter_add(&cells[2U + latency_bucket_index(histogram->precision_bits,
+                                               elapsed_microseconds)], 1U);
+}
+
+void YAP_V2_latency_histogram_summary(const YAP_V2_LATENCY_HISTOGRAM *histogram,
+                                      YAP_V2_LATENCY_SUMMARY *summary) {
+  uint64_t total = 0U, seen = 0U, ranks[YAP_V2_LATENCY_QUANTILE_COUNT];
+  size_t shard, bucket, quantile = 0U;
+  if (summary == NULL) return;
+  memset(summary, 0, sizeof(*summary));
+  if (histogram == NULL || histogram->cells == NULL) return;
+  for (shard = 0U; shard < YAP_V2_METRICS_SHARD_COUNT; shard++) {
+    const uint64_t *cells = histogram->cells + shard * histogram->shard_stride;
+    summary->count = saturated_add(summary->count, counter_load(&cells[0]));
+    summary->microseconds = saturated_add(summary->microseconds, counter_load(&cells[1]));
+    for (bucket = 0U; bucket < histogram->bucket_count; bucket++)
+      total = saturated_add(total, counter_load(&cells[2U + bucket]));
+  }
+  if (total == 0U) return;
+  for (quantile = 0U; quantile < YAP_V2_LATENCY_QUANTILE_COUNT; quantile++) {
+    double rank = latency_quantiles[quantile] * (double)total;
+    ranks[quantile] = (uint64_t)rank;
+    if ((double)ranks[quantile] < rank || ranks[quantile] == 0U) ranks[quantile]++;
+  }
+  /* Buckets only grow, so a second pass always reaches every rank taken from the first. */
+  quantile = 0U;
+  for (bucket = 0U; bucket < histogram->bucket_count &&
+                    quantile < YAP_V2_LATENCY_QUANTILE_COUNT; bucket++) {
+    for (shard = 0U; shard < YAP_V2_METRICS_SHARD_COUNT; shard++)
+      seen = saturated_add(seen, counter_load(
+        &histogram->cells[shard * histogram->shard_stride + 2U + bucket]));
+    while (quantile < YAP_V2_LATENCY_QUANTILE_COUNT && seen >= ranks[quantile])
+      summary->quantiles[quantile++] =
+        latency_bucket_upper(histogram->precision_bits, bucket);
+  }
+}
+
+const char *YAP_V2_search_stage_name(YAP_V2_SEARCH_STAGE stage) {
+  return stage >= 0 && stage < YAP_V2_SEARCH_STAGE_COUNT ? search_stage_names[stage] : "unknown";
+}
+
 uint64_t YAP_V2_monotonic_microseconds(void) {
   struct timespec value;
   if (clock_gettime(CLOCK_MONOTONIC, &value) != 0) return 0U;
@@ -8,6 +8,11 @@
 #include <pthread.h>
 
 #define YAP_V2_LATENCY_BUCKET_COUNT 9U
+#define YAP_V2_WAL_FSYNC_BUCKET_COUNT 9U
+#define YAP_V2_METRICS_SHARD_COUNT 8U
+#define YAP_V2_LATENCY_DEFAULT_PRECISION_BITS 5U
+#define YAP_V2_LATENCY_MAX_PRECISION_BITS 8U
+#define YAP_V2_LATENCY_QUANTILE_COUNT 4U
 
 typedef enum {
   YAP_V2_OBSERVE_SEARCH = 0,
@@ -16,6 +21,41 @@ typedef enum {
   YAP_V2_OBSERVE_OPERATION_COUNT = 3
 } YAP_V2_OBSERVE_OPERATION;
 
+typedef enum {
+  YAP_V2_SEARCH_STAGE_QUEUE_WAIT = 0,
+  YAP_V2_SEARCH_STAGE_PARSE = 1,
+  YAP_V2_SEARCH_STAGE_LEXICAL = 2,
+  YAP_V2_SEARCH_STAGE_VECTOR = 3,
+  YAP_V2_SEARCH_STAGE_FUSION = 4,
+  YAP_V2_SEARCH_STAGE_RENDER = 5,
+  YAP_V2_SEARCH_STAGE_COUNT = 6
+} YAP_V2_SEARCH_STAGE;
+
+/* Log-linear latency histogram: each power-of-two range of microseconds is split into
+ * 2^precision_bits buckets, so a recorded value is off by less than 2^-precision_bits of
+ * itself. Counts live in YAP_V2_METRICS_SHARD_COUNT per-thread shards that are updated with
+ * relaxed atomics and only summed when read. */
+typedef struct {
+  uint64_t *cells;
+  size_t bucket_count;
+  size_t shard_stride;
+  unsigned precision_bits;
+} YAP_V2_LATENCY_HISTOGRAM;
+
+/* quantiles are the upper bounds of the p50, p90, p99 and p99.9 buckets. */
+typedef struct {
+  uint64_t count;
+  uint64_t microseconds;
+  uint64_t quantiles[YAP_V2_LATENCY_QUANTILE_COUNT];
+} YAP_V2_LATENCY_SUMMARY;
+
+/* Cumulative Prometheus-style buckets; the last bucket is +Inf. */
+typedef struct {
+  uint64_t count;
+  uint64_t microseconds;
+  uint64_t buckets[YAP_V2_WAL_FSYNC_BUCKET_COUNT];
+} YAP_V2_WAL_FSYNC_HISTOGRAM;
+
 typedef struct {
   int ready;
   uint64_t generation;
@@ -45,6 +85,9 @@ typedef struct {
   uint64_t ann_candidates_rejected;
   uint64_t ann_rebuilds;
   uint64_t ann_rebuild_failures;
+  uint64_t ann_incremental_updates;
+  uint64_t ann_last_build_microseconds;
+  uint64_t ann_last_build_vectors;
   uint64_t ingest_microbatches;
   uint64_t ingest_requests;
   uint64_t ingest_operations;
@@ -52,19 +95,43 @@ typedef struct {
   uint64_t ingest_generations_saved;
   uint64_t ingest_max_batch_requests;
   uint64_t ingest_max_batch_operations;
+  uint64_t ingest_parse_microseconds;
+  uint64_t ingest_publish_microseconds;
   uint64_t update_wal_recoveries;
+  uint64_t memtable_operations;
+  uint64_t memtable_flushes;
+  uint64_t wal_appends;
+  YAP_V2_WAL_FSYNC_HISTOGRAM wal_fsync;
   uint64_t maintenance_foreground_deferrals;
+  uint64_t search_deadline_expired;
+  uint64_t search_cancelled;
+  YAP_V2_LATENCY_SUMMARY search_stages[YAP_V2_SEARCH_STAGE_COUNT];
+  /* Search admission limiters; the core values travel through the readiness JSON. */
+  uint64_t front_concurrency_limit;
+  uint64_t front_rtt_noload_microseconds;
+  uint64_t front_admission_rejected;
+  uint64_t core_concurrency_limit;
+  uint64_t core_rtt_noload_microseconds;
+  uint64_t core_admission_rejected;
   YAP_V2_COMPACTION_STATE compaction_state;
   uint64_t compaction_generation;
   int64_t compaction_updated_at_unix;
+  uint64_t compaction_ann_build_microseconds;
+  uint64_t compaction_ann_reused_vectors;
+  uint64_t compaction_ann_inserted_vectors;
 } YAP_V2_OPERATIONAL_STATE;
 
 typedef struct {
-  pthread_mutex_t lock;
   uint64_t requests[YAP_V2_OBSERVE_OPERATION_COUNT][3];
-  uint64_t latency_count[YAP_V2_OBSERVE_OPERATION_COUNT];
-  uint64_t latency_microseconds[YAP_V2_OBSERVE_OPERATION_COUNT];
   uint64_t latency_buckets[YAP_V2_OBSERVE_OPERATION_COUNT][YAP_V2_LATENCY_BUCKET_COUNT];
+  /* Keeps the counters of neighbouring shards on different cache lines. */
+  unsigned char padding[64];
+} YAP_V2_METRICS_SHARD;
+
+/* Recording never locks; YAP_V2_metrics_render sums the shards. */
+typedef struct {
+  YAP_V2_METRICS_SHARD shards[YAP_V2_METRICS_SHARD_COUNT];
+  YAP_V2_LATENCY_HISTOGRAM latency[YAP_V2_OBSERVE_OPERATION_COUNT];
   int initialized;
 } YAP_V2_METRICS;
 
@@ -80,12 +147,26 @@ int YAP_V2_operational_state_merge_core_json(YAP_V2_OPERATIONAL_STATE *state,
                                              const unsigned char *json,
                                              size_t json_bytes);
 int YAP_V2_metrics_init(YAP_V2_METRICS *metrics);
+/* precision_bits is 1 to YAP_V2_LATENCY_MAX_PRECISION_BITS. */
+int YAP_V2_metrics_init_with_precision(YAP_V2_METRICS *metrics, unsigned precision_bits);
 void YAP_V2_metrics_close(YAP_V2_METRICS *metrics);
 void YAP_V2_metrics_record(YAP_V2_METRICS *metrics, YAP_V2_OBSERVE_OPERATION operation,
                            int http_status, uint64_t elapsed_microseconds);
 int YAP_V2_metrics_render(YAP_V2_METRICS *metrics, const YAP_V2_OPERATIONAL_STATE *state,
                           size_t inflight, size_t inflight_bytes, size_t max_inflight,
                           size_t max_inflight_bytes, char **output, size_t *output_bytes);
+void YAP_V2_wal_fsync_histogram_record(YAP_V2_WAL_FSYNC_HISTOGRAM *histogram,
+                                       uint64_t elapsed_microseconds);
+int YAP_V2_latency_histogram_init(YAP_V2_LATENCY_HISTOGRAM *histogram,
+                                  unsigned precision_bits);
+void YAP_V2_latency_histogram_free(YAP_V2_LATENCY_HISTOGRAM *histogram);
+/* Safe to call from any number of threads concurrently with the other functions
+ * except init and free. Values above about 71 minutes share the last bucket. */
+void YAP_V2_latency_histogram_record(YAP_V2_LATENCY_HISTOGRAM *histogram,
+                                     uint64_t elapsed_microseconds);
+void YAP_V2_latency_histogram_summary(const YAP_V2_LATENCY_HISTOGRAM *histogram,
+                                      YAP_V2_LATENCY_SUMMARY *summary);
+const char *YAP_V2_search_stage_name(YAP_V2_SEARCH_STAGE stage);
 uint64_t YAP_V2_monotonic_microseconds(void);
 
 #endif
@@ -0,0 +1,250 @@
+#include "server/yappo_slow_query_log_v2.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common/yappo_types_v2.h"
+
+typedef struct {
+  const char *source;
+  const YAP_V2_SLOW_QUERY_ENTRY *entry;
+} DUMP_LINE;
+
+static void entries_clear(YAP_V2_SLOW_QUERY_ENTRY *entries, size_t count) {
+  size_t i;
+  for (i = 0U; i < count; i++) {
+    free(entries[i].line);
+    entries[i].line = NULL;
+  }
+}
+
+static uint64_t mix64(uint64_t value) {
+  value += UINT64_C(0x9e3779b97f4a7c15);
+  value = (value ^ (value >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  value = (value ^ (value >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return value ^ (value >> 31);
+}
+
+static void heap_swap(YAP_V2_SLOW_QUERY_ENTRY *heap, size_t left, size_t right) {
+  YAP_V2_SLOW_QUERY_ENTRY entry = heap[left];
+  heap[left] = heap[right];
+  heap[right] = entry;
+}
+
+/* The slowest set is a min-heap, so its root is the entry the next slower request evicts. */
+static void heap_up(YAP_V2_SLOW_QUERY_ENTRY *heap, size_t position) {
+  while (position > 0U) {
+    size_t parent = (position - 1U) / 2U;
+    if (heap[parent].latency_microseconds <= heap[position].latency_microseconds) break;
+    heap_swap(heap, parent, position);
+    position = parent;
+  }
+}
+
+static void heap_down(YAP_V2_SLOW_QUERY_ENTRY *heap, size_t count, size_t position) {
+  for (;;) {
+    size_t left = position * 2U + 1U, right = left + 1U, smallest = position;
+    if (left < count && heap[left].latency_microseconds < heap[smallest].latency_microseconds)
+      smallest = left;
+    if (right < count && heap[right].latency_microseconds < heap[smallest].latency_microseconds)
+      smallest = right;
+    if (smallest == position) return;
+    heap_swap(heap, smallest, position);
+    position = smallest;
+  }
+}
+
+static void publish_floor(YAP_V2_SLOW_QUERY_LOG *log) {
+  uint64_t floor = log->slowest_count < log->capacity ? 0U :
+                   log->slowest[0].latency_microseconds;
+  __atomic_store_n(&log->admission_floor, floor, __ATOMIC_RELAXED);
+}
+
+/* Called with the lock held. After an idle gap longer than an interval the previous set
+ * would describe an older interval, so it is dropped too. */
+static void rotate(YAP_V2_SLOW_QUERY_LOG *log, uint64_t now) {
+  YAP_V2_SLOW_QUERY_ENTRY *entries;
+  uint64_t elapsed = now - log->interval_started;
+  if (now < log->interval_started || elapsed < log->interval_microseconds) return;
+  entries_clear(log->previous, log->previous_count);
+  entries = log->previous;
+  log->previous = log->slowest;
+  log->previous_count = log->slowest_count;
+  log->slowest = entries;
+  log->slowest_count = 0U;
+  if (elapsed / 2U >= log->interval_microseconds) {
+    entries_clear(log->previous, log->previous_count);
+    log->previous_count = 0U;
+  }
+  __atomic_store_n(&log->interval_started, now, __ATOMIC_RELAXED);
+  publish_floor(log);
+}
+
+int YAP_V2_slow_query_log_init(YAP_V2_SLOW_QUERY_LOG *log, size_t capacity,
+                               uint32_t interval_seconds, uint32_t sample_one_in) {
+  if (log == NULL) return YAP_V2_INVALID_ARGUMENT;
+  memset(log, 0, sizeof(*log));
+  if (capacity > YAP_V2_SLOW_QUERY_MAX_ENTRIES || (capacity != 0U && interval_seconds == 0U))
+    return YAP_V2_INVALID_ARGUMENT;
+  if (pthread_mutex_init(&log->lock, NULL) != 0) return YAP_V2_IO_ERROR;
+  if (capacity != 0U) {
+    log->slowest = calloc(capacity, sizeof(*log->slowest));
+    log->previous = calloc(capacity, sizeof(*log->previous));
+    log->samples = calloc(capacity, sizeof(*log->samples));
+    if (log->slowest == NULL || log->previous == NULL || log->samples == NULL) {
+      free(log->slowest); free(log->previous); free(log->samples);
+      pthread_mutex_destroy(&log->lock);
+      memset(log, 0, sizeof(*log));
+      return YAP_V2_ALLOCATION_FAILED;
+    }
+  }
+  log->capacity = capacity;
+  log->interval_microseconds = (uint64_t)interval_seconds * 1000000U;
+  log->sample_one_in = sample_one_in;
+  log->sample_sequence = mix64((uint64_t)time(NULL) ^ (uint64_t)(uintptr_t)log);
+  log->initialized = 1;
+  return YAP_V2_OK;
+}
+
+void YAP_V2_slow_query_log_free(YAP_V2_SLOW_QUERY_LOG *log) {
+  if (log == NULL || !log->initialized) return;
+  entries_clear(log->slowest, log->slowest_count);
+  entries_clear(log->previous, log->previous_count);
+  entries_clear(log->samples, log->sample_count);
+  free(log->slowest); free(log->previous); free(log->samples);
+  pthread_mutex_destroy(&log->lock);
+  memset(log, 0, sizeof(*log));
+}
+
+unsigned YAP_V2_slow_query_log_admit(YAP_V2_SLOW_QUERY_LOG *log, uint64_t latency_microseconds,
+                                     uint64_t now) {
+  unsigned admission = 0U;
+  uint64_t started;
+  if (log == NULL || !log->initialized || log->capacity == 0U) return 0U;
+  started = __atomic_load_n(&log->interval_started, __ATOMIC_RELAXED);
+  if (latency_microseconds > __atomic_load_n(&log->admission_floor, __ATOMIC_RELAXED) ||
+      now - started >= log->interval_microseconds)
+    admission |= YAP_V2_SLOW_QUERY_SLOWEST;
+  if (log->sample_one_in != 0U &&
+      mix64(__atomic_fetch_add(&log->sample_sequence, 1U, __ATOMIC_RELAXED)) %
+        log->sample_one_in == 0U)
+    admission |= YAP_V2_SLOW_QUERY_SAMPLED;
+  return admission;
+}
+
+void YAP_V2_slow_query_log_record(YAP_V2_SLOW_QUERY_LOG *log, unsigned admission,
+                                  uint64_t latency_microseconds, uint64_t now, char *line,
+                                  size_t line_bytes) {
+  YAP_V2_SLOW_QUERY_ENTRY entry;
+  if (log == NULL || !log->initialized || log->capacity == 0U || line == NULL ||
+      line_bytes < 2U || line[0] != '{') {
+    free(line);
+    return;
+  }
+  entry.line = line; entry.line_bytes = line_bytes;
+  entry.latency_microseconds = latency_microseconds;
+  pthread_mutex_lock(&log->lock);
+  rotate(log, now);
+  if ((admission & YAP_V2_SLOW_QUERY_SAMPLED) != 0U) {
+    YAP_V2_SLOW_QUERY_ENTRY sample = entry;
+    if ((admission & YAP_V2_SLOW_QUERY_SLOWEST) != 0U) {
+      sample.line = malloc(line_bytes);
+      if (sample.line != NULL) memcpy(sample.line, line, line_bytes);
+    }
+    if (sample.line != NULL) {
+      if (log->sample_count < log->capacity) log->sample_count++;
+      else free(log->samples[log->sample_next].line);
+      log->samples[log->sample_next] = sample;
+      log->sample_next = (log->sample_next + 1U) % log->capacity;
+    }
+    if ((admission & YAP_V2_SLOW_QUERY_SLOWEST) == 0U) entry.line = NULL;
+  }
+  if (entry.line != NULL && (admission & YAP_V2_SLOW_QUERY_SLOWEST) != 0U) {
+    if (log->slowest_count < log->capacity) {
+      log->slowest[log->slowest_count] = entry;
+      heap_up(log->slowest, log->slowest_count++);
+      entry.line = NULL;
+    } else if (latency_microseconds > log->slowest[0].latency_microseconds) {
+      free(log->slowest[0].line);
+      log->slowest[0] = entry;
+      heap_down(log->slowest, log->slowest_count, 0U);
+      entry.line = NULL;
+    }
+    publish_floor(log);
+  }
+  pthread_mutex_unlock(&log->lock);
+  free(entry.line);
+}
+
+static int dump_line_compare(const void *left, const void *right) {
+  const DUMP_LINE *a = left, *b = right;
+  if (a->entry->latency_microseconds > b->entry->latency_microseconds) return -1;
+  return a->entry->latency_microseconds < b->entry->latency_microseconds;
+}
+
+static size_t dump_line_bytes(const DUMP_LINE *line) {
+  /* {"source":"<source>"  + "," when the entry has fields + the entry without '{' + '\n' */
+  return 12U + strlen(line->source) + (line->entry->line[1] == '}' ? 0U : 1U) +
+         line->entry->line_bytes - 1U + 1U;
+}
+
+int YAP_V2_slow_query_log_dump(YAP_V2_SLOW_QUERY_LOG *log, uint64_t now, size_t max_bytes,
+                               char **ndjson, size_t *ndjson_bytes) {
+  DUMP_LINE *lines = NULL;
+  size_t line_count = 0U, bytes = 0U, i;
+  char *output, *cursor;
+  if (log == NULL || !log->initialized || ndjson == NULL || ndjson_bytes == NULL)
+    return YAP_V2_INVALID_ARGUMENT;
+  *ndjson = NULL; *ndjson_bytes = 0U;
+  if (log->capacity == 0U) {
+    *ndjson = calloc(1U, 1U);
+    return *ndjson == NULL ? YAP_V2_ALLOCATION_FAILED : YAP_V2_OK;
+  }
+  lines = calloc(log->capacity * 3U, sizeof(*lines));
+  if (lines == NULL) return YAP_V2_ALLOCATION_FAILED;
+  pthread_mutex_lock(&log->lock);
+  rotate(log, now);
+  for (i = 0U; i < log->previous_count; i++) {
+    lines[line_count].source = "previous"; lines[line_count++].entry = &log->previous[i];
+  }
+  qsort(lines, line_count, sizeof(*lines), dump_line_compare);
+  for (i = 0U; i < log->slowest_count; i++) {
+    lines[line_count].source = "current"; lines[line_count++].entry = &log->slowest[i];
+  }
+  qsort(lines + log->previous_count, log->slowest_count, sizeof(*lines), dump_line_compare);
+  for (i = 0U; i < log->sample_count; i++) {
+    size_t index = log->sample_count < log->capacity ? i :
+                   (log->sample_next + i) % log->capacity;
+    lines[line_count].source = "sample"; lines[line_count++].entry = &log->samples[index];
+  }
+  for (i = 0U; i < line_count; i++) {
+    size_t line_bytes = dump_line_bytes(&lines[i]);
+    if (line_bytes > max_bytes - bytes) { lines[i].entry = NULL; continue; }
+    bytes += line_bytes;
+  }
+  output = malloc(bytes + 1U);
+  if (output == NULL) {
+    pthread_mutex_unlock(&log->lock);
+    free(lines);
+    return YAP_V2_ALLOCATION_FAILED;
+  }
+  cursor = output;
+  for (i = 0U; i < line_count; i++) {
+    const YAP_V2_SLOW_QUERY_ENTRY *entry = lines[i].entry;
+    size_t source_bytes;
+    if (entry == NULL) continue;
+    source_bytes = strlen(lines[i].source);
+    memcpy(cursor, "{\"source\":\"", 11U); cursor += 11U;
+    memcpy(cursor, lines[i].source, source_bytes); cursor += source_bytes;
+    *cursor++ = '"';
+    if (entry->line[1] != '}') *cursor++ = ',';
+    memcpy(cursor, entry->line + 1U, entry->line_bytes - 1U); cursor += entry->line_bytes - 1U;
+    *cursor++ = '\n';
+  }
+  *cursor = '\0';
+  pthread_mutex_unlock(&log->lock);
+  free(lines);
+  *ndjson = output; *ndjson_bytes = bytes;
+  return YAP_V2_OK;
+}
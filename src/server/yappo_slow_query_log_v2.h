@@ -0,0 +1,61 @@
+#ifndef YAPPO_SLOW_QUERY_LOG_V2_H
+#define YAPPO_SLOW_QUERY_LOG_V2_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define YAP_V2_SLOW_QUERY_MAX_ENTRIES 1024U
+#define YAP_V2_SLOW_QUERY_DEFAULT_ENTRIES 16U
+#define YAP_V2_SLOW_QUERY_DEFAULT_INTERVAL_SECONDS 60U
+#define YAP_V2_SLOW_QUERY_SLOWEST 1U
+#define YAP_V2_SLOW_QUERY_SAMPLED 2U
+
+/* One captured request, kept as a single JSON object without a trailing newline. */
+typedef struct {
+  char *line;
+  size_t line_bytes;
+  uint64_t latency_microseconds;
+} YAP_V2_SLOW_QUERY_ENTRY;
+
+/* Keeps the capacity slowest requests of the current interval, the slowest of the interval
+ * before it, and a ring of the last capacity requests chosen at random with probability
+ * 1/sample_one_in. Callers first ask YAP_V2_slow_query_log_admit, which does not lock, and
+ * only build an entry for a nonzero answer. */
+typedef struct {
+  pthread_mutex_t lock;
+  YAP_V2_SLOW_QUERY_ENTRY *slowest;
+  YAP_V2_SLOW_QUERY_ENTRY *previous;
+  YAP_V2_SLOW_QUERY_ENTRY *samples;
+  size_t capacity;
+  size_t slowest_count;
+  size_t previous_count;
+  size_t sample_count;
+  size_t sample_next;
+  uint64_t interval_microseconds;
+  uint64_t interval_started;
+  uint64_t admission_floor;
+  uint64_t sample_sequence;
+  uint32_t sample_one_in;
+  int initialized;
+} YAP_V2_SLOW_QUERY_LOG;
+
+/* capacity 0 disables the log; sample_one_in 0 disables sampling. */
+int YAP_V2_slow_query_log_init(YAP_V2_SLOW_QUERY_LOG *log, size_t capacity,
+                               uint32_t interval_seconds, uint32_t sample_one_in);
+void YAP_V2_slow_query_log_free(YAP_V2_SLOW_QUERY_LOG *log);
+/* Returns a mask of YAP_V2_SLOW_QUERY_SLOWEST and YAP_V2_SLOW_QUERY_SAMPLED, or 0. now is on
+ * the YAP_V2_cancellation_clock_microseconds clock. */
+unsigned YAP_V2_slow_query_log_admit(YAP_V2_SLOW_QUERY_LOG *log, uint64_t latency_microseconds,
+                                     uint64_t now);
+/* Takes ownership of line, which must be a JSON object, whether or not it is kept. */
+void YAP_V2_slow_query_log_record(YAP_V2_SLOW_QUERY_LOG *log, unsigned admission,
+                                  uint64_t latency_microseconds, uint64_t now, char *line,
+                                  size_t line_bytes);
+/* Writes one NDJSON line per entry with a leading "source" of "previous", "current" or
+ * "sample"; the slowest sets come first, slowest first, then the samples oldest first.
+ * Entries that would take the output past max_bytes are left out. */
+int YAP_V2_slow_query_log_dump(YAP_V2_SLOW_QUERY_LOG *log, uint64_t now, size_t max_bytes,
+                               char **ndjson, size_t *ndjson_bytes);
+
+#endif
@@ -0,0 +1,102 @@
+#include "server/yappo_suggest_cache_v2.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t prefix_hash(YAP_V2_BYTES_VIEW prefix) {
+  uint64_t hash = UINT64_C(1469598103934665603);
+  size_t i;
+  for (i = 0U; i < prefix.len; i++) {
+    hash ^= prefix.data[i];
+    hash *= UINT64_C(1099511628211);
+  }
+  return hash;
+}
+
+static void slot_clear(YAP_V2_SUGGEST_CACHE_SLOT *slot) {
+  free(slot->prefix);
+  YAP_V2_suggestions_free(&slot->suggestions);
+  slot->prefix = NULL;
+  slot->prefix_len = 0U;
+}
+
+int YAP_V2_suggest_cache_init(YAP_V2_SUGGEST_CACHE *cache,
+                              const YAP_V2_LEXICAL_SEGMENT *const *segments,
+                              size_t segment_count, size_t slot_count) {
+  size_t i;
+  if (cache == NULL || (segments == NULL && segment_count > 0U) || slot_count == 0U ||
+      (slot_count & (slot_count - 1U)) != 0U)
+    return YAP_V2_INVALID_ARGUMENT;
+  memset(cache, 0, sizeof(*cache));
+  if (segment_count > 0U) {
+    cache->segments = (const YAP_V2_LEXICAL_SEGMENT **)calloc(segment_count,
+                                                              sizeof(*cache->segments));
+    if (cache->segments == NULL)
+      return YAP_V2_ALLOCATION_FAILED;
+    for (i = 0U; i < segment_count; i++)
+      cache->segments[i] = segments[i];
+  }
+  cache->slots = (YAP_V2_SUGGEST_CACHE_SLOT *)calloc(slot_count, sizeof(*cache->slots));
+  if (cache->slots == NULL || pthread_mutex_init(&cache->lock, NULL) != 0) {
+    int status = cache->slots == NULL ? YAP_V2_ALLOCATION_FAILED : YAP_V2_IO_ERROR;
+    free(cache->segments);
+    free(cache->slots);
+    memset(cache, 0, sizeof(*cache));
+    return status;
+  }
+  cache->segment_count = segment_count;
+  cache->slot_count = slot_count;
+  cache->initialized = 1;
+  return YAP_V2_OK;
+}
+
+void YAP_V2_suggest_cache_free(YAP_V2_SUGGEST_CACHE *cache) {
+  size_t i;
+  if (cache == NULL || !cache->initialized)
+    return;
+  for (i = 0U; i < cache->slot_count; i++)
+    slot_clear(&cache->slots[i]);
+  free(cache->slots);
+  free(cache->segments);
+  pthread_mutex_destroy(&cache->lock);
+  memset(cache, 0, sizeof(*cache));
+}
+
+int YAP_V2_suggest_cache_lookup(YAP_V2_SUGGEST_CACHE *cache, YAP_V2_BYTES_VIEW prefix,
+                                size_t limit, YAP_V2_SUGGESTIONS *suggestions) {
+  YAP_V2_SUGGEST_CACHE_SLOT *slot;
+  YAP_V2_SUGGESTIONS computed;
+  unsigned char *copy;
+  int status;
+  if (cache == NULL || !cache->initialized || prefix.data == NULL || prefix.len == 0U ||
+      limit == 0U || limit > YAP_V2_SUGGEST_MAX_TERMS || suggestions == NULL)
+    return YAP_V2_INVALID_ARGUMENT;
+  slot = &cache->slots[prefix_hash(prefix) & (cache->slot_count - 1U)];
+  pthread_mutex_lock(&cache->lock);
+  if (slot->prefix != NULL && slot->prefix_len == prefix.len &&
+      memcmp(slot->prefix, prefix.data, prefix.len) == 0) {
+    status = YAP_V2_suggestions_copy(&slot->suggestions, limit, suggestions);
+    pthread_mutex_unlock(&cache->lock);
+    return status;
+  }
+  pthread_mutex_unlock(&cache->lock);
+  YAP_V2_suggestions_init(&computed);
+  status = YAP_V2_suggest_terms(cache->segments, cache->segment_count, prefix,
+                                YAP_V2_SUGGEST_MAX_TERMS, &computed);
+  if (status == YAP_V2_OK)
+    status = YAP_V2_suggestions_copy(&computed, limit, suggestions);
+  copy = status == YAP_V2_OK ? (unsigned char *)malloc(prefix.len) : NULL;
+  if (copy == NULL) {
+    /* An answer that could not be cached is still an answer. */
+    YAP_V2_suggestions_free(&computed);
+    return status;
+  }
+  memcpy(copy, prefix.data, prefix.len);
+  pthread_mutex_lock(&cache->lock);
+  slot_clear(slot);
+  slot->prefix = copy;
+  slot->prefix_len = prefix.len;
+  slot->suggestions = computed;
+  pthread_mutex_unlock(&cache->lock);
+  return YAP_V2_OK;
+}
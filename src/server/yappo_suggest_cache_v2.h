@@ -0,0 +1,40 @@
+#ifndef YAPPO_SUGGEST_CACHE_V2_H
+#define YAPPO_SUGGEST_CACHE_V2_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "query/yappo_suggest_v2.h"
+
+#define YAP_V2_SUGGEST_CACHE_DEFAULT_SLOTS 1024U
+
+typedef struct {
+  unsigned char *prefix;
+  size_t prefix_len;
+  YAP_V2_SUGGESTIONS suggestions;
+} YAP_V2_SUGGEST_CACHE_SLOT;
+
+/* Completions of one snapshot's term dictionaries, direct-mapped by a hash of the prefix. Each
+ * slot keeps the YAP_V2_SUGGEST_MAX_TERMS most frequent terms, so every limit is answered from
+ * one entry. The cache never outlives the segments it was built over. */
+typedef struct {
+  pthread_mutex_t lock;
+  const YAP_V2_LEXICAL_SEGMENT **segments;
+  size_t segment_count;
+  YAP_V2_SUGGEST_CACHE_SLOT *slots;
+  size_t slot_count;
+  int initialized;
+} YAP_V2_SUGGEST_CACHE;
+
+/* slot_count must be a power of two. NULL segments are skipped. */
+int YAP_V2_suggest_cache_init(YAP_V2_SUGGEST_CACHE *cache,
+                              const YAP_V2_LEXICAL_SEGMENT *const *segments,
+                              size_t segment_count, size_t slot_count);
+void YAP_V2_suggest_cache_free(YAP_V2_SUGGEST_CACHE *cache);
+/* Copies at most limit completions of prefix into suggestions. A miss walks the dictionaries
+ * without the lock held and then replaces whatever occupied the prefix's slot. */
+int YAP_V2_suggest_cache_lookup(YAP_V2_SUGGEST_CACHE *cache, YAP_V2_BYTES_VIEW prefix,
+                                size_t limit, YAP_V2_SUGGESTIONS *suggestions);
+
+#endif
@@ -0,0 +1,105 @@
+#include "server/yappo_term_stats_cache_v2.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TERM_WORDS (YAP_V2_TERM_STATS_CACHE_TERM_BYTES / sizeof(uint64_t))
+
+static uint64_t term_hash(YAP_V2_BYTES_VIEW term) {
+  uint64_t hash = UINT64_C(1469598103934665603);
+  size_t i;
+  for (i = 0U; i < term.len; i++) {
+    hash ^= term.data[i];
+    hash *= UINT64_C(1099511628211);
+  }
+  return hash;
+}
+
+static YAP_V2_TERM_STATS_CACHE_SLOT *slot_for(YAP_V2_TERM_STATS_CACHE *cache,
+                                              YAP_V2_BYTES_VIEW term) {
+  return &cache->slots[term_hash(term) & (cache->slot_count - 1U)];
+}
+
+static int cacheable(const YAP_V2_TERM_STATS_CACHE *cache, YAP_V2_BYTES_VIEW term) {
+  return cache != NULL && cache->slots != NULL && term.data != NULL && term.len != 0U &&
+         term.len <= YAP_V2_TERM_STATS_CACHE_TERM_BYTES;
+}
+
+/* Seqlock read: the copy counts only when sequence was even and unchanged around it. */
+static int cache_lookup(void *context, YAP_V2_BYTES_VIEW term, uint64_t type_frequency[2]) {
+  YAP_V2_TERM_STATS_CACHE *cache = (YAP_V2_TERM_STATS_CACHE *)context;
+  YAP_V2_TERM_STATS_CACHE_SLOT *slot;
+  uint64_t words[TERM_WORDS], frequency[2], before, length;
+  size_t i;
+  if (!cacheable(cache, term)) return YAP_V2_NOT_FOUND;
+  slot = slot_for(cache, term);
+  before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+  if ((before & 1U) != 0U) return YAP_V2_NOT_FOUND;
+  length = __atomic_load_n(&slot->term_len, __ATOMIC_RELAXED);
+  for (i = 0U; i < TERM_WORDS; i++)
+    words[i] = __atomic_load_n(&slot->term[i], __ATOMIC_RELAXED);
+  frequency[0] = __atomic_load_n(&slot->type_frequency[0], __ATOMIC_RELAXED);
+  frequency[1] = __atomic_load_n(&slot->type_frequency[1], __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != before ||
+      length != term.len || memcmp(words, term.data, term.len) != 0)
+    return YAP_V2_NOT_FOUND;
+  type_frequency[0] = frequency[0];
+  type_frequency[1] = frequency[1];
+  return YAP_V2_OK;
+}
+
+/* A store that finds the slot being written by another query gives up instead of waiting. */
+static void cache_store(void *context, YAP_V2_BYTES_VIEW term, const uint64_t type_frequency[2]) {
+  YAP_V2_TERM_STATS_CACHE *cache = (YAP_V2_TERM_STATS_CACHE *)context;
+  YAP_V2_TERM_STATS_CACHE_SLOT *slot;
+  uint64_t words[TERM_WORDS], sequence;
+  size_t i;
+  if (!cacheable(cache, term)) return;
+  memset(words, 0, sizeof(words));
+  memcpy(words, term.data, term.len);
+  slot = slot_for(cache, term);
+  sequence = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+  if ((sequence & 1U) != 0U ||
+      !__atomic_compare_exchange_n(&slot->sequence, &sequence, sequence + 1U, 0,
+                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    return;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&slot->term_len, (uint64_t)term.len, __ATOMIC_RELAXED);
+  for (i = 0U; i < TERM_WORDS; i++)
+    __atomic_store_n(&slot->term[i], words[i], __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->type_frequency[0], type_frequency[0], __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->type_frequency[1], type_frequency[1], __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->sequence, sequence + 2U, __ATOMIC_RELEASE);
+}
+
+int YAP_V2_term_stats_cache_init(YAP_V2_TERM_STATS_CACHE *cache, size_t slot_count,
+                                 size_t segment_count) {
+  if (cache == NULL || slot_count == 0U || (slot_count & (slot_count - 1U)) != 0U ||
+      segment_count == 0U)
+    return YAP_V2_INVALID_ARGUMENT;
+  memset(cache, 0, sizeof(*cache));
+  cache->slots = (YAP_V2_TERM_STATS_CACHE_SLOT *)calloc(slot_count, sizeof(*cache->slots));
+  if (cache->slots == NULL)
+    return YAP_V2_ALLOCATION_FAILED;
+  cache->slot_count = slot_count;
+  cache->segment_count = segment_count;
+  return YAP_V2_OK;
+}
+
+void YAP_V2_term_stats_cache_free(YAP_V2_TERM_STATS_CACHE *cache) {
+  if (cache == NULL)
+    return;
+  free(cache->slots);
+  memset(cache, 0, sizeof(*cache));
+}
+
+void YAP_V2_term_stats_cache_source(YAP_V2_TERM_STATS_CACHE *cache,
+                                    YAP_V2_TERM_STATS_SOURCE *source) {
+  if (source == NULL)
+    return;
+  source->lookup = cache_lookup;
+  source->store = cache_store;
+  source->context = cache;
+  source->segment_count = cache == NULL ? 0U : cache->segment_count;
+}
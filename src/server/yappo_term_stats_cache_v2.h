@@ -0,0 +1,39 @@
+#ifndef YAPPO_TERM_STATS_CACHE_V2_H
+#define YAPPO_TERM_STATS_CACHE_V2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "query/yappo_lexical_search_v2.h"
+
+#define YAP_V2_TERM_STATS_CACHE_DEFAULT_SLOTS 4096U
+#define YAP_V2_TERM_STATS_CACHE_TERM_BYTES 64U
+
+/* Every field is accessed through the __atomic builtins. sequence is odd while a writer
+ * fills the slot; readers never wait and treat a slot written under them as a miss. */
+typedef struct {
+  uint64_t sequence;
+  uint64_t term_len;
+  uint64_t type_frequency[2];
+  uint64_t term[YAP_V2_TERM_STATS_CACHE_TERM_BYTES / sizeof(uint64_t)];
+} YAP_V2_TERM_STATS_CACHE_SLOT;
+
+/* Corpus document and passage frequencies over the first segment_count segments of a
+ * snapshot, filled as queries bind and direct-mapped by a hash of the term. Lookups and
+ * stores take no lock and never allocate; terms longer than
+ * YAP_V2_TERM_STATS_CACHE_TERM_BYTES are not cached. */
+typedef struct {
+  YAP_V2_TERM_STATS_CACHE_SLOT *slots;
+  size_t slot_count;
+  size_t segment_count;
+} YAP_V2_TERM_STATS_CACHE;
+
+/* slot_count must be a power of two and segment_count at least 1. */
+int YAP_V2_term_stats_cache_init(YAP_V2_TERM_STATS_CACHE *cache, size_t slot_count,
+                                 size_t segment_count);
+void YAP_V2_term_stats_cache_free(YAP_V2_TERM_STATS_CACHE *cache);
+/* Points source at the cache for YAP_V2_lexical_query_plan_bind_cached. */
+void YAP_V2_term_stats_cache_source(YAP_V2_TERM_STATS_CACHE *cache,
+                                    YAP_V2_TERM_STATS_SOURCE *source);
+
+#endif
@@ -27,6 +27,12 @@ const char *YAP_V2_compaction_state_name(YAP_V2_COMPACTION_STATE state) {
 
 int YAP_V2_compaction_status_write(const char *index_dir, YAP_V2_COMPACTION_STATE state,
                                    uint64_t generation) {
+  return YAP_V2_compaction_status_write_report(index_dir, state, generation, NULL);
+}
+
+int YAP_V2_compaction_status_write_report(const char *index_dir, YAP_V2_COMPACTION_STATE state,
+                                          uint64_t generation,
+                                          const YAP_V2_COMPACTION_ANN_REPORT *ann_report) {
   char path[4096], temporary[4096]; FILE *file = NULL; int fd = -1, status = YAP_V2_IO_ERROR;
   long process_id; time_t now; int written;
   if (index_dir == NULL || (state != YAP_V2_COMPACTION_RUNNING &&
@@ -40,9 +46,14 @@ int YAP_V2_compaction_status_write(const char *index_dir, YAP_V2_COMPACTION_STAT
   if (fchmod(fd, 0600) != 0 || (file = fdopen(fd, "wb")) == NULL) goto done;
   fd = -1; process_id = state == YAP_V2_COMPACTION_RUNNING ? (long)getpid() : 0L;
   now = time(NULL); if (now < 0 ||
-      fprintf(file, "YAP2-COMPACTION\t%s\t%ld\t%llu\t%lld\n",
+      fprintf(file, "YAP2-COMPACTION\t%s\t%ld\t%llu\t%lld",
               YAP_V2_compaction_state_name(state), process_id,
               (unsigned long long)generation, (long long)now) < 0 ||
+      (ann_report != NULL &&
+       fprintf(file, "\t%llu\t%llu\t%llu", (unsigned long long)ann_report->build_microseconds,
+               (unsigned long long)ann_report->reused_vectors,
+               (unsigned long long)ann_report->inserted_vectors) < 0) ||
+      fputc('\n', file) == EOF ||
       fflush(file) != 0 || fsync(fileno(file)) != 0 || fclose(file) != 0) {
     file = NULL; goto done;
   }
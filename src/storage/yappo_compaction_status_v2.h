@@ -12,8 +12,19 @@ typedef enum {
   YAP_V2_COMPACTION_UNKNOWN = 5
 } YAP_V2_COMPACTION_STATE;
 
+typedef struct {
+  uint64_t build_microseconds;
+  uint64_t reused_vectors;
+  uint64_t inserted_vectors;
+} YAP_V2_COMPACTION_ANN_REPORT;
+
 const char *YAP_V2_compaction_state_name(YAP_V2_COMPACTION_STATE state);
 int YAP_V2_compaction_status_write(const char *index_dir, YAP_V2_COMPACTION_STATE state,
                                    uint64_t generation);
+/* Same as YAP_V2_compaction_status_write, appending the ANN rebuild cost of the compaction
+ * when ann_report is not NULL. */
+int YAP_V2_compaction_status_write_report(const char *index_dir, YAP_V2_COMPACTION_STATE state,
+                                          uint64_t generation,
+                                          const YAP_V2_COMPACTION_ANN_REPORT *ann_report);
 
 #endif
@@ -145,18 +145,6 @@ static uint64_t get_u64_le(const unsigned char *input) {
   return value;
 }
 
-static uint32_t crc32c(const unsigned char *data, size_t len) {
-  uint32_t crc = UINT32_C(0xffffffff);
-  size_t i;
-  for (i = 0U; i < len; i++) {
-    unsigned int bit;
-    crc ^= data[i];
-    for (bit = 0U; bit < 8U; bit++)
-      crc = (crc >> 1U) ^ (UINT32_C(0x82f63b78) & (uint32_t)-(int32_t)(crc & 1U));
-  }
-  return ~crc;
-}
-
 static int reader_take(MANIFEST_READER *reader, size_t bytes, const unsigned char **value) {
   if (reader->offset > reader->len || bytes > reader->len - reader->offset)
     return YAP_V2_INVALID_FORMAT;
@@ -287,7 +275,7 @@ int YAP_V2_manifest_load(const char *path, YAP_V2_MANIFEST *manifest) {
        header.payload_bytes != file_size - YAP_V2_FILE_HEADER_BYTES))
     status = YAP_V2_INVALID_FORMAT;
   if (status == YAP_V2_OK &&
-      crc32c(data + YAP_V2_FILE_HEADER_BYTES, (size_t)header.payload_bytes) !=
+      YAP_V2_crc32c(data + YAP_V2_FILE_HEADER_BYTES, (size_t)header.payload_bytes) !=
         header.payload_crc32c)
     status = YAP_V2_CHECKSUM_MISMATCH;
   reader.data = data + YAP_V2_FILE_HEADER_BYTES;
@@ -418,7 +406,7 @@ static int encode_manifest(const YAP_V2_MANIFEST *manifest, unsigned char *file_
   header.file_type = YAP_V2_FILE_MANIFEST;
   header.generation = manifest->generation;
   header.payload_bytes = offset;
-  header.payload_crc32c = crc32c(payload, offset);
+  header.payload_crc32c = YAP_V2_crc32c(payload, offset);
   return YAP_V2_file_header_encode(&header, file_data);
 }
 
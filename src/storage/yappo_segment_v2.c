@@ -188,20 +188,6 @@ static int validate_segment_views(const YAP_V2_DOCUMENT_VIEW *documents, size_t
   return YAP_V2_OK;
 }
 
-static uint32_t crc32c(const unsigned char *data, size_t len) {
-  uint32_t crc = UINT32_MAX;
-  size_t i;
-  unsigned int bit;
-
-  for (i = 0; i < len; i++) {
-    crc ^= data[i];
-    for (bit = 0; bit < 8U; bit++) {
-      crc = (crc & 1U) != 0U ? (crc >> 1) ^ UINT32_C(0x82f63b78) : crc >> 1;
-    }
-  }
-  return ~crc;
-}
-
 typedef struct {
   uint32_t state[8];
   uint64_t bit_length;
@@ -412,7 +398,7 @@ int YAP_V2_tombstones_write(const char *path, uint64_t generation,
   header.file_type = YAP_V2_FILE_TOMBSTONES;
   header.generation = generation;
   header.payload_bytes = payload.len;
-  header.payload_crc32c = crc32c(payload.data, payload.len);
+  header.payload_crc32c = YAP_V2_crc32c(payload.data, payload.len);
   status = YAP_V2_file_header_encode(&header, encoded_header);
   if (status != YAP_V2_OK || payload.len > SIZE_MAX - YAP_V2_FILE_HEADER_BYTES) {
     buffer_free(&payload);
@@ -674,7 +660,7 @@ int YAP_V2_segment_write(const char *path, const char *segment_id, uint64_t gene
   header.file_type = YAP_V2_FILE_DOCUMENTS;
   header.generation = generation;
   header.payload_bytes = (uint64_t)payload.len;
-  header.payload_crc32c = crc32c(payload.data, payload.len);
+  header.payload_crc32c = YAP_V2_crc32c(payload.data, payload.len);
   status = YAP_V2_file_header_encode(&header, header_bytes);
   if (status != YAP_V2_OK || payload.len > SIZE_MAX - YAP_V2_FILE_HEADER_BYTES) {
     buffer_free(&payload);
@@ -832,7 +818,7 @@ int YAP_V2_tombstones_read(const char *path, uint64_t expected_generation,
     free(file_bytes);
     return YAP_V2_INVALID_FORMAT;
   }
-  if (crc32c(file_bytes + YAP_V2_FILE_HEADER_BYTES, file_size - YAP_V2_FILE_HEADER_BYTES) !=
+  if (YAP_V2_crc32c(file_bytes + YAP_V2_FILE_HEADER_BYTES, file_size - YAP_V2_FILE_HEADER_BYTES) !=
       header.payload_crc32c) {
     free(file_bytes);
     return YAP_V2_CHECKSUM_MISMATCH;
@@ -918,7 +904,7 @@ int YAP_V2_segment_read(const char *path, uint64_t expected_generation, YAP_V2_S
     free(file_bytes);
     return YAP_V2_INVALID_FORMAT;
   }
-  if (crc32c(file_bytes + YAP_V2_FILE_HEADER_BYTES, file_size - YAP_V2_FILE_HEADER_BYTES) !=
+  if (YAP_V2_crc32c(file_bytes + YAP_V2_FILE_HEADER_BYTES, file_size - YAP_V2_FILE_HEADER_BYTES) !=
       header.payload_crc32c) {
     free(file_bytes);
     return YAP_V2_CHECKSUM_MISMATCH;
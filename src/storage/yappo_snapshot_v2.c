@@ -36,6 +36,7 @@ struct YAP_V2_SEARCH_SNAPSHOT {
 typedef struct {
   pthread_mutex_t lock;
   char *index_dir;
+  char *segments_dir;
   char *manifest_path;
   YAP_V2_CONFIG config;
   YAP_V2_SEARCH_SNAPSHOT *current;
@@ -67,27 +68,35 @@ static char *copy_string(const char *value) {
   return copy;
 }
 
+static void snapshot_segment_retain(SNAPSHOT_SEGMENT *segment) {
+  pthread_mutex_lock(&segment->references_lock);
+  segment->references++;
+  pthread_mutex_unlock(&segment->references_lock);
+}
+
+static void snapshot_segment_release(SNAPSHOT_SEGMENT *segment) {
+  int destroy = 0;
+  if (segment == NULL) return;
+  pthread_mutex_lock(&segment->references_lock);
+  if (segment->references > 0U) {
+    segment->references--;
+    destroy = segment->references == 0U;
+  }
+  pthread_mutex_unlock(&segment->references_lock);
+  if (destroy) {
+    YAP_V2_segment_free(&segment->documents);
+    YAP_V2_tombstones_free(&segment->tombstones);
+    pthread_mutex_destroy(&segment->references_lock);
+    free(segment);
+  }
+}
+
 static void snapshot_destroy(YAP_V2_SEARCH_SNAPSHOT *snapshot) {
   size_t i;
   if (snapshot == NULL) return;
   free(snapshot->visibility);
-  for (i = 0U; i < snapshot->segment_count; i++) {
-    SNAPSHOT_SEGMENT *segment = snapshot->segments[i];
-    int destroy = 0;
-    if (segment == NULL) continue;
-    pthread_mutex_lock(&segment->references_lock);
-    if (segment->references > 0U) {
-      segment->references--;
-      destroy = segment->references == 0U;
-    }
-    pthread_mutex_unlock(&segment->references_lock);
-    if (destroy) {
-      YAP_V2_segment_free(&segment->documents);
-      YAP_V2_tombstones_free(&segment->tombstones);
-      pthread_mutex_destroy(&segment->references_lock);
-      free(segment);
-    }
-  }
+  for (i = 0U; i < snapshot->segment_count; i++)
+    snapshot_segment_release(snapshot->segments[i]);
   free(snapshot->segments);
   YAP_V2_manifest_free(&snapshot->manifest);
   pthread_mutex_destroy(&snapshot->references_lock);
@@ -191,20 +200,64 @@ static const YAP_V2_COMPONENT_DESCRIPTOR *component(const YAP_V2_SEGMENT_DESCRIP
   return NULL;
 }
 
-static int component_path(const char *index_dir, const char *segment_id, const char *name,
+static int component_path(const char *segments_dir, const char *segment_id, const char *name,
                           char **path_out) {
   size_t length;
   char *path;
-  if (strlen(index_dir) > SIZE_MAX - strlen(segment_id) - strlen(name) - 12U)
+  if (strlen(segments_dir) > SIZE_MAX - strlen(segment_id) - strlen(name) - 3U)
     return YAP_V2_OUT_OF_RANGE;
-  length = strlen(index_dir) + strlen(segment_id) + strlen(name) + 12U;
+  length = strlen(segments_dir) + strlen(segment_id) + strlen(name) + 3U;
   path = (char *)malloc(length);
   if (path == NULL) return YAP_V2_ALLOCATION_FAILED;
-  (void)snprintf(path, length, "%s/segments/%s/%s", index_dir, segment_id, name);
+  (void)snprintf(path, length, "%s/%s/%s", segments_dir, segment_id, name);
   *path_out = path;
   return YAP_V2_OK;
 }
 
+static int snapshot_segment_load(const char *segments_dir,
+                                 const YAP_V2_SEGMENT_DESCRIPTOR *descriptor,
+                                 SNAPSHOT_SEGMENT **segment_out) {
+  const YAP_V2_COMPONENT_DESCRIPTOR *documents = component(descriptor, YAP_V2_FILE_DOCUMENTS);
+  const YAP_V2_COMPONENT_DESCRIPTOR *tombstones = component(descriptor, YAP_V2_FILE_TOMBSTONES);
+  SNAPSHOT_SEGMENT *segment;
+  char *path = NULL;
+  int status;
+  *segment_out = NULL;
+  if (documents == NULL) return YAP_V2_INVALID_FORMAT;
+  segment = calloc(1U, sizeof(*segment));
+  if (segment == NULL) return YAP_V2_ALLOCATION_FAILED;
+  if (pthread_mutex_init(&segment->references_lock, NULL) != 0) {
+    free(segment);
+    return YAP_V2_IO_ERROR;
+  }
+  segment->references = 1U;
+  YAP_V2_segment_init(&segment->documents);
+  YAP_V2_tombstones_init(&segment->tombstones);
+  status = component_path(segments_dir, descriptor->id, documents->name, &path);
+  if (status == YAP_V2_OK)
+    status = YAP_V2_segment_read(path, 0U, &segment->documents, NULL);
+  free(path); path = NULL;
+  if (status == YAP_V2_OK &&
+      (strcmp(segment->documents.id, descriptor->id) != 0 ||
+       segment->documents.document_count != descriptor->document_count ||
+       segment->documents.passage_count != descriptor->passage_count))
+    status = YAP_V2_CONFLICT;
+  if (status == YAP_V2_OK && tombstones != NULL) {
+    status = component_path(segments_dir, descriptor->id, tombstones->name, &path);
+    if (status == YAP_V2_OK)
+      status = YAP_V2_tombstones_read(path, 0U, &segment->tombstones);
+    free(path);
+  }
+  if (status == YAP_V2_OK && segment->tombstones.count != descriptor->tombstone_count)
+    status = YAP_V2_CONFLICT;
+  if (status != YAP_V2_OK) {
+    snapshot_segment_release(segment);
+    return status;
+  }
+  *segment_out = segment;
+  return YAP_V2_OK;
+}
+
 static int snapshot_load(const MANAGER_STATE *state,
                          const YAP_V2_SEARCH_SNAPSHOT *previous,
                          YAP_V2_SEARCH_SNAPSHOT **snapshot_out) {
@@ -231,9 +284,6 @@ static int snapshot_load(const MANAGER_STATE *state,
                                                &previous->manifest);
   for (i = 0U; status == YAP_V2_OK && i < snapshot->segment_count; i++) {
     const YAP_V2_SEGMENT_DESCRIPTOR *descriptor = &snapshot->manifest.segments[i];
-    const YAP_V2_COMPONENT_DESCRIPTOR *documents = component(descriptor, YAP_V2_FILE_DOCUMENTS);
-    const YAP_V2_COMPONENT_DESCRIPTOR *tombstones = component(descriptor, YAP_V2_FILE_TOMBSTONES);
-    char *path = NULL;
     size_t previous_index = 0U;
     if (previous != NULL) {
       int found = YAP_V2_manifest_segment_map_find(
@@ -242,9 +292,7 @@ static int snapshot_load(const MANAGER_STATE *state,
           YAP_V2_segment_descriptor_equal(
             &previous->manifest.segments[previous_index], descriptor)) {
         snapshot->segments[i] = previous->segments[previous_index];
-        pthread_mutex_lock(&snapshot->segments[i]->references_lock);
-        snapshot->segments[i]->references++;
-        pthread_mutex_unlock(&snapshot->segments[i]->references_lock);
+        snapshot_segment_retain(snapshot->segments[i]);
         continue;
       }
       if (found != YAP_V2_OK && found != YAP_V2_NOT_FOUND) {
@@ -254,37 +302,8 @@ static int snapshot_load(const MANAGER_STATE *state,
     }
     status = YAP_V2_manifest_verify_segment_components(
       state->index_dir, snapshot->manifest.generation, descriptor);
-    if (status != YAP_V2_OK) break;
-    snapshot->segments[i] = calloc(1U, sizeof(*snapshot->segments[i]));
-    if (snapshot->segments[i] == NULL) { status = YAP_V2_ALLOCATION_FAILED; break; }
-    if (pthread_mutex_init(&snapshot->segments[i]->references_lock, NULL) != 0) {
-      free(snapshot->segments[i]); snapshot->segments[i] = NULL;
-      status = YAP_V2_IO_ERROR; break;
-    }
-    snapshot->segments[i]->references = 1U;
-    YAP_V2_segment_init(&snapshot->segments[i]->documents);
-    YAP_V2_tombstones_init(&snapshot->segments[i]->tombstones);
-    if (documents == NULL) { status = YAP_V2_INVALID_FORMAT; break; }
-    status = component_path(state->index_dir, descriptor->id, documents->name, &path);
     if (status == YAP_V2_OK)
-      status = YAP_V2_segment_read(path, 0U,
-                                   &snapshot->segments[i]->documents, NULL);
-    free(path); path = NULL;
-    if (status == YAP_V2_OK &&
-        (strcmp(snapshot->segments[i]->documents.id, descriptor->id) != 0 ||
-         snapshot->segments[i]->documents.document_count != descriptor->document_count ||
-         snapshot->segments[i]->documents.passage_count != descriptor->passage_count))
-      status = YAP_V2_CONFLICT;
-    if (status == YAP_V2_OK && tombstones != NULL) {
-      status = component_path(state->index_dir, descriptor->id, tombstones->name, &path);
-      if (status == YAP_V2_OK)
-        status = YAP_V2_tombstones_read(path, 0U,
-                                        &snapshot->segments[i]->tombstones);
-      free(path);
-    }
-    if (status == YAP_V2_OK &&
-        snapshot->segments[i]->tombstones.count != descriptor->tombstone_count)
-      status = YAP_V2_CONFLICT;
+      status = snapshot_segment_load(state->segments_dir, descriptor, &snapshot->segments[i]);
   }
   if (status == YAP_V2_OK) status = snapshot_build_visibility(snapshot);
   YAP_V2_manifest_segment_map_free(&previous_segments);
@@ -306,7 +325,8 @@ void YAP_V2_snapshot_manager_close(YAP_V2_SNAPSHOT_MANAGER *manager) {
   pthread_mutex_unlock(&state->lock);
   YAP_V2_snapshot_release(current);
   pthread_mutex_destroy(&state->lock);
-  free(state->index_dir); free(state->manifest_path); free(state); manager->state = NULL;
+  free(state->index_dir); free(state->segments_dir); free(state->manifest_path); free(state);
+  manager->state = NULL;
 }
 
 int YAP_V2_snapshot_manager_open(YAP_V2_SNAPSHOT_MANAGER *manager, const char *index_dir,
@@ -322,14 +342,19 @@ int YAP_V2_snapshot_manager_open(YAP_V2_SNAPSHOT_MANAGER *manager, const char *i
   if (pthread_mutex_init(&state->lock, NULL) != 0) { free(state); return YAP_V2_IO_ERROR; }
   state->index_dir = copy_string(index_dir); state->manifest_path = copy_string(manifest_path);
   state->config = *config;
-  if (state->index_dir == NULL || state->manifest_path == NULL) {
-    pthread_mutex_destroy(&state->lock); free(state->index_dir); free(state->manifest_path);
-    free(state); return YAP_V2_ALLOCATION_FAILED;
+  if (state->index_dir != NULL && strlen(index_dir) < SIZE_MAX - 10U) {
+    state->segments_dir = (char *)malloc(strlen(index_dir) + 10U);
+    if (state->segments_dir != NULL)
+      (void)snprintf(state->segments_dir, strlen(index_dir) + 10U, "%s/segments", index_dir);
+  }
+  if (state->index_dir == NULL || state->segments_dir == NULL || state->manifest_path == NULL) {
+    pthread_mutex_destroy(&state->lock); free(state->index_dir); free(state->segments_dir);
+    free(state->manifest_path); free(state); return YAP_V2_ALLOCATION_FAILED;
   }
   status = snapshot_load(state, NULL, &snapshot);
   if (status != YAP_V2_OK) {
-    pthread_mutex_destroy(&state->lock); free(state->index_dir); free(state->manifest_path);
-    free(state); return status;
+    pthread_mutex_destroy(&state->lock); free(state->index_dir); free(state->segments_dir);
+    free(state->manifest_path); free(state); return status;
   }
   state->current = snapshot; manager->state = state; return YAP_V2_OK;
 }
@@ -379,6 +404,52 @@ uint64_t YAP_V2_snapshot_generation(const YAP_V2_SEARCH_SNAPSHOT *snapshot) {
   return snapshot == NULL ? 0U : snapshot->manifest.generation;
 }
 
+int YAP_V2_snapshot_overlay(YAP_V2_SEARCH_SNAPSHOT *base, const char *delta_dir,
+                            const YAP_V2_SEGMENT_DESCRIPTOR *segments, size_t segment_count,
+                            YAP_V2_SEARCH_SNAPSHOT **snapshot_out) {
+  YAP_V2_SEARCH_SNAPSHOT *snapshot;
+  size_t i;
+  int status = YAP_V2_OK;
+  if (base == NULL || delta_dir == NULL || segments == NULL || segment_count == 0U ||
+      snapshot_out == NULL)
+    return YAP_V2_INVALID_ARGUMENT;
+  *snapshot_out = NULL;
+  snapshot = (YAP_V2_SEARCH_SNAPSHOT *)calloc(1U, sizeof(*snapshot));
+  if (snapshot == NULL) return YAP_V2_ALLOCATION_FAILED;
+  if (pthread_mutex_init(&snapshot->references_lock, NULL) != 0) { free(snapshot); return YAP_V2_IO_ERROR; }
+  snapshot->references = 1U;
+  YAP_V2_manifest_init(&snapshot->manifest);
+  snapshot->manifest.format_version = base->manifest.format_version;
+  snapshot->manifest.generation = base->manifest.generation;
+  memcpy(snapshot->manifest.config_fingerprint, base->manifest.config_fingerprint,
+         sizeof(snapshot->manifest.config_fingerprint));
+  for (i = 0U; status == YAP_V2_OK && i < base->manifest.segment_count; i++)
+    status = YAP_V2_manifest_add_segment(&snapshot->manifest, &base->manifest.segments[i]);
+  for (i = 0U; status == YAP_V2_OK && i < segment_count; i++)
+    status = YAP_V2_manifest_add_segment(&snapshot->manifest, &segments[i]);
+  if (status == YAP_V2_OK) {
+    snapshot->segments = (SNAPSHOT_SEGMENT **)calloc(snapshot->manifest.segment_count,
+                                                     sizeof(*snapshot->segments));
+    if (snapshot->segments == NULL) status = YAP_V2_ALLOCATION_FAILED;
+  }
+  if (status == YAP_V2_OK) snapshot->segment_count = snapshot->manifest.segment_count;
+  for (i = 0U; status == YAP_V2_OK && i < base->segment_count; i++) {
+    snapshot->segments[i] = base->segments[i];
+    snapshot_segment_retain(snapshot->segments[i]);
+  }
+  for (i = 0U; status == YAP_V2_OK && i < segment_count; i++)
+    status = snapshot_segment_load(delta_dir, &segments[i],
+                                   &snapshot->segments[base->segment_count + i]);
+  if (status == YAP_V2_OK) status = snapshot_build_visibility(snapshot);
+  if (status != YAP_V2_OK) { snapshot_destroy(snapshot); return status; }
+  *snapshot_out = snapshot;
+  return YAP_V2_OK;
+}
+
+const YAP_V2_MANIFEST *YAP_V2_snapshot_manifest(const YAP_V2_SEARCH_SNAPSHOT *snapshot) {
+  return snapshot == NULL ? NULL : &snapshot->manifest;
+}
+
 size_t YAP_V2_snapshot_segment_count(const YAP_V2_SEARCH_SNAPSHOT *snapshot) {
   return snapshot == NULL ? 0U : snapshot->segment_count;
 }
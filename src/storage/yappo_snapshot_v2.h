@@ -24,6 +24,13 @@ int YAP_V2_snapshot_manager_reload(YAP_V2_SNAPSHOT_MANAGER *manager, int *change
 YAP_V2_SEARCH_SNAPSHOT *YAP_V2_snapshot_acquire(YAP_V2_SNAPSHOT_MANAGER *manager);
 void YAP_V2_snapshot_release(YAP_V2_SEARCH_SNAPSHOT *snapshot);
 uint64_t YAP_V2_snapshot_generation(const YAP_V2_SEARCH_SNAPSHOT *snapshot);
+/* Shares every segment of base and appends unpublished delta segments stored under
+ * delta_dir, so their documents and tombstones shadow older versions. The overlay keeps
+ * base's generation and is released like any other snapshot. */
+int YAP_V2_snapshot_overlay(YAP_V2_SEARCH_SNAPSHOT *base, const char *delta_dir,
+                            const YAP_V2_SEGMENT_DESCRIPTOR *segments, size_t segment_count,
+                            YAP_V2_SEARCH_SNAPSHOT **snapshot_out);
+const YAP_V2_MANIFEST *YAP_V2_snapshot_manifest(const YAP_V2_SEARCH_SNAPSHOT *snapshot);
 size_t YAP_V2_snapshot_segment_count(const YAP_V2_SEARCH_SNAPSHOT *snapshot);
 int YAP_V2_snapshot_matches_manifest(const YAP_V2_SEARCH_SNAPSHOT *snapshot,
                                      const YAP_V2_MANIFEST *manifest);
@@ -6,6 +6,7 @@
 #include "common/yappo_unicode.h"
 
 #include <ctype.h>
+#include <pthread.h>
 #include <string.h>
 
 static void test_nfkc_casefold_word_boundaries(void **state) {
@@ -21,6 +22,56 @@ static void test_nfkc_casefold_word_boundaries(void **state) {
   YAP_V2_token_sequence_free(&sequence);
 }
 
+static void assert_tokens(const char *input, const char *const *expected, size_t count) {
+  YAP_V2_TOKEN_SEQUENCE sequence;
+  size_t i;
+  assert_int_equal(YAP_V2_unicode_tokenize(input, strlen(input), &sequence), YAP_V2_OK);
+  assert_int_equal(sequence.token_count, count);
+  for (i = 0; i < count; i++) {
+    const YAP_V2_TOKEN *token = &sequence.tokens[i];
+    assert_int_equal(token->byte_end - token->byte_start, strlen(expected[i]));
+    assert_memory_equal(sequence.normalized_utf8 + token->byte_start, expected[i],
+                        strlen(expected[i]));
+  }
+  YAP_V2_token_sequence_free(&sequence);
+}
+
+static void test_ascii_words_keep_icu_joining_rules(void **state) {
+  static const char *const plain[] = {"search", "the", "index", "2026", "v2"};
+  static const char *const joined[] = {"hello", "e.g", "can't", "3.14", "1,000", "foo_bar",
+                                       "user@example.com"};
+  static const char *const mixed[] = {"yappod2", "で", "全文", "検索", "api", "を", "使う"};
+  (void)state;
+  assert_tokens("Search THE index -- 2026 (v2)!", plain, 5);
+  assert_tokens("Hello, e.g. can't 3.14 1,000 foo_bar user@example.com", joined, 7);
+  assert_tokens("Yappod2で全文検索 API を使う", mixed, 7);
+}
+
+static void *tokenize_repeatedly(void *argument) {
+  const char input[] = "東京タワー Tokyo Tower 333m";
+  size_t i;
+  (void)argument;
+  for (i = 0; i < 200; i++) {
+    YAP_V2_TOKEN_SEQUENCE sequence;
+    if (YAP_V2_unicode_tokenize(input, strlen(input), &sequence) != YAP_V2_OK ||
+        sequence.token_count != 4) return (void *)1;
+    YAP_V2_token_sequence_free(&sequence);
+  }
+  return NULL;
+}
+
+static void test_tokenizer_contexts_are_per_thread(void **state) {
+  pthread_t threads[4];
+  void *result;
+  size_t i;
+  (void)state;
+  for (i = 0; i < 4; i++) assert_int_equal(pthread_create(&threads[i], NULL, tokenize_repeatedly, NULL), 0);
+  for (i = 0; i < 4; i++) {
+    assert_int_equal(pthread_join(threads[i], &result), 0);
+    assert_null(result);
+  }
+}
+
 static void test_invalid_utf8_is_rejected(void **state) {
   const char input[] = {(char)0xc3, (char)0x28};
   YAP_V2_TOKEN_SEQUENCE sequence;
@@ -84,6 +135,6 @@ static void test_chunker_does_not_emit_whitespace_only_passages(void **state) {
 }
 
 int main(void) {
-  const struct CMUnitTest tests[]={cmocka_unit_test(test_nfkc_casefold_word_boundaries),cmocka_unit_test(test_invalid_utf8_is_rejected),cmocka_unit_test(test_sentence_chunks_are_deterministic),cmocka_unit_test(test_grapheme_fallback_does_not_split_emoji),cmocka_unit_test(test_chunker_does_not_emit_whitespace_only_passages)};
+  const struct CMUnitTest tests[]={cmocka_unit_test(test_nfkc_casefold_word_boundaries),cmocka_unit_test(test_ascii_words_keep_icu_joining_rules),cmocka_unit_test(test_tokenizer_contexts_are_per_thread),cmocka_unit_test(test_invalid_utf8_is_rejected),cmocka_unit_test(test_sentence_chunks_are_deterministic),cmocka_unit_test(test_grapheme_fallback_does_not_split_emoji),cmocka_unit_test(test_chunker_does_not_emit_whitespace_only_passages)};
   return cmocka_run_group_tests(tests,NULL,NULL);
 }
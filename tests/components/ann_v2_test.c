@@ -88,6 +88,54 @@ static void test_build_save_view_search_and_fallback(void **state) {
   assert_int_equal(unlink(vectors_path), 0);
 }
 
+static void test_seeded_build_reuses_live_keys_and_falls_back(void **state) {
+  const float source_values[6] = {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+  const float merged_values[6] = {0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+  const float query[3] = {0.0f, 0.0f, 1.0f};
+  const uint64_t ordinals[2] = {UINT64_MAX, 0U};
+  char source_path[] = "/tmp/yappod-ann-source-XXXXXX";
+  char merged_path[] = "/tmp/yappod-ann-merged-XXXXXX";
+  char seed_path[] = "/tmp/yappod-ann-seed-XXXXXX";
+  char ann_path[] = "/tmp/yappod-ann-output-XXXXXX";
+  YAP_V2_VECTOR_SEGMENT source, merged;
+  YAP_V2_ANN_SEGMENT ann;
+  YAP_VECTOR_HIT hits[2];
+  YAP_V2_COMPONENT_DESCRIPTOR component;
+  size_t count, reused = 99U;
+  int fd;
+  (void)state;
+  create_vectors(source_path, &source, "p1", "p2", source_values);
+  create_vectors(merged_path, &merged, "p2", "p3", merged_values);
+  fd = mkstemp(seed_path); assert_true(fd >= 0); close(fd); unlink(seed_path);
+  fd = mkstemp(ann_path); assert_true(fd >= 0); close(fd); unlink(ann_path);
+  assert_int_equal(YAP_V2_ann_build_save(seed_path, &source, 8U, 32U, 24U, NULL), YAP_ANN_OK);
+  assert_int_equal(YAP_V2_ann_build_save_seeded(ann_path, &merged, seed_path, ordinals, 2U, 8U,
+                                                32U, 24U, &reused, &component),
+                   YAP_ANN_OK);
+  assert_int_equal(reused, 1U);
+  assert_int_equal(component.record_count, 2U);
+  YAP_V2_ann_segment_init(&ann);
+  assert_int_equal(YAP_V2_ann_view(ann_path, &merged, 24U, &ann, NULL), YAP_ANN_OK);
+  assert_int_equal(YAP_V2_ann_search(&ann, query, 3U, 2U, hits, 2U, &count), YAP_VECTOR_OK);
+  assert_int_equal(count, 2U);
+  assert_memory_equal(hits[0].id.data, "p3", 2U);
+  assert_memory_equal(hits[1].id.data, "p2", 2U);
+  YAP_V2_ann_segment_close(&ann);
+  assert_int_equal(YAP_V2_ann_build_save_seeded(ann_path, &merged, seed_path, ordinals, 1U, 8U,
+                                                32U, 24U, &reused, NULL),
+                   YAP_ANN_OK);
+  assert_int_equal(reused, 0U);
+  YAP_V2_ann_segment_init(&ann);
+  assert_int_equal(YAP_V2_ann_view(ann_path, &merged, 24U, &ann, NULL), YAP_ANN_OK);
+  YAP_V2_ann_segment_close(&ann);
+  YAP_V2_vector_segment_close(&source);
+  YAP_V2_vector_segment_close(&merged);
+  assert_int_equal(unlink(ann_path), 0);
+  assert_int_equal(unlink(seed_path), 0);
+  assert_int_equal(unlink(merged_path), 0);
+  assert_int_equal(unlink(source_path), 0);
+}
+
 static void test_cross_segment_candidates(void **state) {
   const float first_values[6] = {0.8f, 0.2f, 0.0f, 0.0f, 1.0f, 0.0f};
   const float second_values[6] = {1.0f, 0.0f, 0.0f, 0.5f, 0.5f, 0.0f};
@@ -121,7 +169,8 @@ static uint32_t random_u32(uint32_t *state) {
 }
 
 static void test_ann_recall_at_10_against_exact_ground_truth(void **state) {
-  enum { VECTOR_COUNT = 512, DIMENSIONS = 16, QUERY_COUNT = 40, TOP_K = 10 };
+  enum { VECTOR_COUNT = 2048, DIMENSIONS = 16, QUERY_COUNT = 40, TOP_K = 10 };
+  static const size_t build_threads[] = {1U, 4U};
   YAP_V2_CONFIG cfg;
   YAP_V2_PASSAGE_VIEW *passages;
   YAP_EMBEDDING_RESULT embeddings;
@@ -134,7 +183,7 @@ static void test_ann_recall_at_10_against_exact_ground_truth(void **state) {
   char vectors_path[] = "/tmp/yappod-ann-recall-vectors-XXXXXX";
   char ann_path[] = "/tmp/yappod-ann-recall-index-XXXXXX";
   uint32_t rng = 0x6d2b79f5U;
-  size_t i, j, query, exact_count, approximate_count, matches = 0U;
+  size_t i, j, t, query, exact_count, approximate_count, matches;
   int fd;
   double recall;
   (void)state;
@@ -171,32 +220,41 @@ static void test_ann_recall_at_10_against_exact_ground_truth(void **state) {
   YAP_V2_vector_segment_init(&vectors);
   assert_int_equal(YAP_V2_vector_segment_open(vectors_path, 1U, &cfg, &vectors, NULL),
                    YAP_V2_OK);
-  assert_int_equal(YAP_V2_ann_build_save(ann_path, &vectors, 16U, 128U, 128U, NULL),
-                   YAP_ANN_OK);
-  YAP_V2_ann_segment_init(&ann);
-  assert_int_equal(YAP_V2_ann_view(ann_path, &vectors, 128U, &ann, NULL), YAP_ANN_OK);
-  for (query = 0U; query < QUERY_COUNT; query++) {
-    const float *query_vector = &values[(query * 11U) * DIMENSIONS];
-    assert_int_equal(YAP_V2_vector_segment_search(&vectors, query_vector, DIMENSIONS, TOP_K,
-                                                  exact, TOP_K, &exact_count), YAP_VECTOR_OK);
-    assert_int_equal(YAP_V2_ann_search(&ann, query_vector, DIMENSIONS, TOP_K, approximate,
-                                       TOP_K, &approximate_count), YAP_VECTOR_OK);
-    assert_int_equal(exact_count, TOP_K); assert_int_equal(approximate_count, TOP_K);
-    for (i = 0U; i < approximate_count; i++)
-      for (j = 0U; j < exact_count; j++)
-        if (approximate[i].ordinal == exact[j].ordinal) { matches++; break; }
+  for (t = 0U; t < sizeof(build_threads) / sizeof(build_threads[0]); t++) {
+    YAP_V2_ann_set_build_threads(build_threads[t]);
+    assert_int_equal(YAP_V2_ann_build_threads(), build_threads[t]);
+    assert_int_equal(YAP_V2_ann_build_save(ann_path, &vectors, 16U, 128U, 128U, NULL),
+                     YAP_ANN_OK);
+    YAP_V2_ann_segment_init(&ann);
+    assert_int_equal(YAP_V2_ann_view(ann_path, &vectors, 128U, &ann, NULL), YAP_ANN_OK);
+    matches = 0U;
+    for (query = 0U; query < QUERY_COUNT; query++) {
+      const float *query_vector = &values[(query * 11U) * DIMENSIONS];
+      assert_int_equal(YAP_V2_vector_segment_search(&vectors, query_vector, DIMENSIONS, TOP_K,
+                                                    exact, TOP_K, &exact_count), YAP_VECTOR_OK);
+      assert_int_equal(YAP_V2_ann_search(&ann, query_vector, DIMENSIONS, TOP_K, approximate,
+                                         TOP_K, &approximate_count), YAP_VECTOR_OK);
+      assert_int_equal(exact_count, TOP_K); assert_int_equal(approximate_count, TOP_K);
+      for (i = 0U; i < approximate_count; i++)
+        for (j = 0U; j < exact_count; j++)
+          if (approximate[i].ordinal == exact[j].ordinal) { matches++; break; }
+    }
+    recall = (double)matches / (double)(QUERY_COUNT * TOP_K);
+    print_message("ann_recall_at_10\tthreads=%zu\t%.6f\n", build_threads[t], recall);
+    assert_true(recall >= 0.95);
+    YAP_V2_ann_segment_close(&ann);
+    assert_int_equal(unlink(ann_path), 0);
   }
-  recall = (double)matches / (double)(QUERY_COUNT * TOP_K);
-  print_message("ann_recall_at_10\t%.6f\n", recall);
-  assert_true(recall >= 0.95);
-  YAP_V2_ann_segment_close(&ann); YAP_V2_vector_segment_close(&vectors);
-  assert_int_equal(unlink(ann_path), 0); assert_int_equal(unlink(vectors_path), 0);
+  YAP_V2_ann_set_build_threads(0U);
+  YAP_V2_vector_segment_close(&vectors);
+  assert_int_equal(unlink(vectors_path), 0);
   free(ids); free(values); free(passages);
 }
 
 int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_build_save_view_search_and_fallback),
+    cmocka_unit_test(test_seeded_build_reuses_live_keys_and_falls_back),
     cmocka_unit_test(test_cross_segment_candidates),
     cmocka_unit_test(test_ann_recall_at_10_against_exact_ground_truth)
   };
@@ -11,6 +11,7 @@
 #include "test_env.h"
 #include "test_fs.h"
 #include "components/yappo_lexical_v2.h"
+#include "components/yappo_term_filter_v2.h"
 
 static YAP_V2_BYTES_VIEW bytes(const char *value) {
   YAP_V2_BYTES_VIEW view;
@@ -44,7 +45,8 @@ static void write_fixture(const char *directory) {
 static void test_reader_lookup_and_iterators(void **state) {
   ytest_env_t env;
   YAP_V2_LEXICAL_SEGMENT segment;
-  const YAP_V2_TERM_ENTRY *term;
+  YAP_V2_TERM_ENTRY entry;
+  const YAP_V2_TERM_ENTRY *term = &entry;
   YAP_V2_POSTING_ITERATOR postings;
   YAP_V2_POSITION_ITERATOR positions;
   YAP_V2_POSTING posting;
@@ -64,41 +66,175 @@ static void test_reader_lookup_and_iterators(void **state) {
   assert_int_equal(segment.generation, 11U);
   assert_int_equal(segment.document_count, 2U);
   assert_int_equal(segment.passage_count, 1U);
-  term = YAP_V2_lexical_term_find(&segment, bytes("search"));
-  assert_non_null(term);
+  assert_int_equal(YAP_V2_lexical_term_find(&segment, bytes("search"), &entry), YAP_V2_OK);
   assert_int_equal(term->document_frequency, 3U);
+  assert_int_equal(term->passage_frequency, 1U);
   assert_int_equal(YAP_V2_lexical_term_type_frequency(
                      &segment, term, YAP_V2_LEXICAL_DOCUMENT, &document_frequency), YAP_V2_OK);
   assert_int_equal(YAP_V2_lexical_term_type_frequency(
                      &segment, term, YAP_V2_LEXICAL_PASSAGE, &passage_frequency), YAP_V2_OK);
   assert_int_equal(document_frequency, 2U);
   assert_int_equal(passage_frequency, 1U);
-  assert_non_null(YAP_V2_lexical_term_find(&segment, bytes("searching")));
-  assert_null(YAP_V2_lexical_term_find(&segment, bytes("missing")));
+  assert_int_equal(YAP_V2_lexical_term_find(&segment, bytes("searching"), &entry), YAP_V2_OK);
+  assert_int_equal(YAP_V2_lexical_term_find(&segment, bytes("missing"), &entry),
+                   YAP_V2_NOT_FOUND);
+  assert_int_equal(YAP_V2_lexical_term_find(&segment, bytes("search"), &entry), YAP_V2_OK);
   assert_int_equal(YAP_V2_posting_iterator_init(&segment, term, &postings), YAP_V2_OK);
   assert_int_equal(YAP_V2_posting_iterator_block(&postings, 0U, &block), YAP_V2_OK);
   assert_int_equal(block.first_posting, 0U);
   assert_int_equal(block.posting_count, 3U);
   while (YAP_V2_posting_iterator_next(&postings, &posting) == YAP_V2_OK) {
+    size_t first = position_count;
     if (posting_count == 0U) {
       assert_int_equal(posting.object_type, YAP_V2_LEXICAL_DOCUMENT);
       assert_int_equal(posting.object_ordinal, 0U);
       assert_int_equal(posting.term_frequency[0], 2U);
       assert_int_equal(posting.field_length[0], 2U);
     }
+    assert_int_equal(YAP_V2_position_iterator_init(&segment, term, &posting, &positions),
+                     YAP_V2_OK);
+    while (YAP_V2_position_iterator_next(&positions, &position) == YAP_V2_OK) {
+      assert_true(position.field >= YAP_V2_FIELD_TITLE && position.field <= YAP_V2_FIELD_PASSAGE);
+      if (posting_count == 0U) {
+        assert_int_equal(position.field, YAP_V2_FIELD_TITLE);
+        assert_int_equal(position.position, position_count - first);
+      }
+      position_count++;
+    }
+    assert_int_equal(position_count - first, posting.position_count);
     posting_count++;
   }
   assert_int_equal(posting_count, 3U);
-  assert_int_equal(YAP_V2_position_iterator_init(&segment, term, &positions), YAP_V2_OK);
-  while (YAP_V2_position_iterator_next(&positions, &position) == YAP_V2_OK) {
-    assert_true(position.field >= YAP_V2_FIELD_TITLE && position.field <= YAP_V2_FIELD_PASSAGE);
-    position_count++;
-  }
   assert_int_equal(position_count, 4U);
   YAP_V2_lexical_segment_close(&segment);
   ytest_env_destroy(&env);
 }
 
+static void test_reader_decodes_long_position_runs(void **state) {
+  ytest_env_t env;
+  YAP_V2_LEXICAL_SEGMENT segment;
+  YAP_V2_DOCUMENT_VIEW document;
+  YAP_V2_COMPONENT_DESCRIPTOR components[3];
+  YAP_V2_POSTING_ITERATOR postings;
+  YAP_V2_POSITION_ITERATOR positions;
+  YAP_V2_POSTING posting;
+  YAP_V2_POSITION decoded[51], position;
+  YAP_V2_TERM_ENTRY entry;
+  const YAP_V2_TERM_ENTRY *term = &entry;
+  char directory[PATH_MAX], body[2048];
+  size_t i, length = 0U;
+
+  (void)state;
+  /* A run of adjacent occurrences, a gap that needs a two-byte varint, and a second run. */
+  for (i = 0U; i < 250U; i++)
+    length += (size_t)snprintf(body + length, sizeof(body) - length, "%s ",
+                               i < 20U || i >= 220U ? "word" : "filler");
+  memset(&document, 0, sizeof(document));
+  document.id = bytes("doc-1");
+  document.title = bytes("word");
+  document.body = bytes(body);
+  document.updated_at_unix_ms = 1;
+  assert_int_equal(ytest_env_init(&env), 0);
+  assert_int_equal(ytest_path_join(directory, sizeof(directory), env.tmp_root, "segment"), 0);
+  assert_int_equal(ytest_mkdir_p(directory, 0700), 0);
+  assert_int_equal(YAP_V2_lexical_write(directory, 3U, &document, 1U, NULL, 0U, components),
+                   YAP_V2_OK);
+  YAP_V2_lexical_segment_init(&segment);
+  assert_int_equal(YAP_V2_lexical_segment_open(directory, 3U, &segment), YAP_V2_OK);
+  assert_int_equal(YAP_V2_lexical_term_find(&segment, bytes("word"), &entry), YAP_V2_OK);
+  assert_int_equal(YAP_V2_posting_iterator_init(&segment, term, &postings), YAP_V2_OK);
+  assert_int_equal(YAP_V2_posting_iterator_next(&postings, &posting), YAP_V2_OK);
+  assert_int_equal(posting.position_count, 51U);
+  assert_int_equal(YAP_V2_posting_positions_read(&segment, term, &posting, decoded), YAP_V2_OK);
+  assert_int_equal(YAP_V2_position_iterator_init(&segment, term, &posting, &positions),
+                   YAP_V2_OK);
+  for (i = 0U; i < 51U; i++) {
+    uint32_t expected = i == 0U ? 0U : i <= 20U ? (uint32_t)i - 1U : (uint32_t)i + 199U;
+    assert_int_equal(decoded[i].field, i == 0U ? YAP_V2_FIELD_TITLE : YAP_V2_FIELD_BODY);
+    assert_int_equal(decoded[i].position, expected);
+    assert_int_equal(YAP_V2_position_iterator_next(&positions, &position), YAP_V2_OK);
+    assert_int_equal(position.field, decoded[i].field);
+    assert_int_equal(position.position, decoded[i].position);
+  }
+  assert_int_equal(YAP_V2_position_iterator_next(&positions, &position), YAP_V2_OUT_OF_RANGE);
+  /* One title byte, twenty for the first run, two for the jump, and one per later gap. */
+  assert_int_equal(term->positions_bytes, 16U + 1U + 20U + 2U + 29U);
+  YAP_V2_lexical_segment_close(&segment);
+  ytest_env_destroy(&env);
+}
+
+static void test_term_dictionary_spans_front_coded_blocks(void **state) {
+  ytest_env_t env;
+  YAP_V2_LEXICAL_SEGMENT segment;
+  YAP_V2_DOCUMENT_VIEW document;
+  YAP_V2_COMPONENT_DESCRIPTOR components[3];
+  YAP_V2_TERM_CURSOR cursor;
+  YAP_V2_TERM_ENTRY entry;
+  char directory[PATH_MAX], body[1024], term[16];
+  size_t i, length = 0U, passed = 0U;
+  int status;
+
+  (void)state;
+  /* Forty terms share long prefixes and span three dictionary blocks. */
+  for (i = 0U; i < 40U; i++)
+    length += (size_t)snprintf(body + length, sizeof(body) - length, "prefix%02zu ", i);
+  memset(&document, 0, sizeof(document));
+  document.id = bytes("doc-1");
+  document.body = bytes(body);
+  document.updated_at_unix_ms = 1;
+  assert_int_equal(ytest_env_init(&env), 0);
+  assert_int_equal(ytest_path_join(directory, sizeof(directory), env.tmp_root, "segment"), 0);
+  assert_int_equal(ytest_mkdir_p(directory, 0700), 0);
+  assert_int_equal(YAP_V2_lexical_write(directory, 5U, &document, 1U, NULL, 0U, components),
+                   YAP_V2_OK);
+  YAP_V2_lexical_segment_init(&segment);
+  assert_int_equal(YAP_V2_lexical_segment_open(directory, 5U, &segment), YAP_V2_OK);
+  assert_int_equal(segment.term_count, 40U);
+  assert_int_equal(segment.term_block_count, 3U);
+  for (i = 0U; i < 40U; i++) {
+    assert_true(snprintf(term, sizeof(term), "prefix%02zu", i) > 0);
+    assert_int_equal(YAP_V2_lexical_term_find(&segment, bytes(term), &entry), YAP_V2_OK);
+    assert_int_equal(entry.document_frequency, 1U);
+    assert_true(snprintf(term, sizeof(term), "prefix%02zu0", i) > 0);
+    assert_int_equal(YAP_V2_lexical_term_find(&segment, bytes(term), &entry), YAP_V2_NOT_FOUND);
+  }
+  assert_int_equal(YAP_V2_lexical_term_find(&segment, bytes("prefix"), &entry), YAP_V2_NOT_FOUND);
+  assert_int_equal(YAP_V2_lexical_term_find(&segment, bytes("a"), &entry), YAP_V2_NOT_FOUND);
+  assert_int_equal(YAP_V2_lexical_term_find(&segment, bytes("z"), &entry), YAP_V2_NOT_FOUND);
+  /* The vocabulary filter keeps every term and rejects nearly all others. */
+  for (i = 0U; i < 40U; i++) {
+    assert_true(snprintf(term, sizeof(term), "prefix%02zu", i) > 0);
+    assert_true(YAP_V2_lexical_term_may_exist(
+      &segment, YAP_V2_term_filter_hash((const unsigned char *)term, strlen(term))));
+  }
+  for (i = 0U; i < 1000U; i++) {
+    assert_true(snprintf(term, sizeof(term), "absent%04zu", i) > 0);
+    passed += (size_t)YAP_V2_lexical_term_may_exist(
+      &segment, YAP_V2_term_filter_hash((const unsigned char *)term, strlen(term)));
+  }
+  assert_true(passed < 20U);
+
+  YAP_V2_term_cursor_init(&cursor);
+  i = 17U;
+  for (status = YAP_V2_term_cursor_seek(&segment, bytes("prefix165"), &cursor);
+       status == YAP_V2_OK; status = YAP_V2_term_cursor_next(&cursor)) {
+    assert_true(snprintf(term, sizeof(term), "prefix%02zu", i) > 0);
+    assert_int_equal(cursor.term_len, strlen(term));
+    assert_memory_equal(cursor.term, term, cursor.term_len);
+    assert_int_equal(YAP_V2_lexical_term_find(&segment, bytes(term), &entry), YAP_V2_OK);
+    assert_int_equal(cursor.entry.postings_offset, entry.postings_offset);
+    assert_int_equal(cursor.entry.positions_offset, entry.positions_offset);
+    i++;
+  }
+  assert_int_equal(status, YAP_V2_OUT_OF_RANGE);
+  assert_int_equal(i, 40U);
+  assert_int_equal(YAP_V2_term_cursor_seek(&segment, bytes("prefix40"), &cursor),
+                   YAP_V2_OUT_OF_RANGE);
+  YAP_V2_term_cursor_free(&cursor);
+  YAP_V2_lexical_segment_close(&segment);
+  ytest_env_destroy(&env);
+}
+
 static void test_reader_rejects_generation_and_corruption(void **state) {
   ytest_env_t env;
   YAP_V2_LEXICAL_SEGMENT segment;
@@ -126,6 +262,8 @@ static void test_reader_rejects_generation_and_corruption(void **state) {
 int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_reader_lookup_and_iterators),
+    cmocka_unit_test(test_reader_decodes_long_position_runs),
+    cmocka_unit_test(test_term_dictionary_spans_front_coded_blocks),
     cmocka_unit_test(test_reader_rejects_generation_and_corruption),
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
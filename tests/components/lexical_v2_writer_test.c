@@ -90,10 +90,110 @@ static void test_writer_rejects_invalid_utf8(void **state) {
                    YAP_V2_INVALID_FORMAT);
 }
 
+static void test_merge_matches_fresh_write_of_kept_documents(void **state) {
+  ytest_env_t env;
+  YAP_V2_DOCUMENT_VIEW first_documents[2], second_documents[1], kept_documents[2];
+  YAP_V2_PASSAGE_VIEW passages[2], kept_passages[2];
+  YAP_V2_LEXICAL_SEGMENT segments[2];
+  YAP_V2_LEXICAL_MERGE_SOURCE sources[2];
+  YAP_V2_COMPONENT_DESCRIPTOR merged[3], fresh[3];
+  YAP_V2_TERM_ENTRY entry;
+  const uint64_t first_document_ordinals[] = {YAP_V2_LEXICAL_ORDINAL_DROPPED, 0U};
+  const uint64_t first_passage_ordinals[] = {YAP_V2_LEXICAL_ORDINAL_DROPPED, 0U};
+  const uint64_t second_document_ordinals[] = {1U};
+  const uint64_t second_passage_ordinals[] = {1U};
+  char first_dir[PATH_MAX], second_dir[PATH_MAX], merged_dir[PATH_MAX], fresh_dir[PATH_MAX];
+  size_t i;
+
+  (void)state;
+  assert_int_equal(ytest_env_init(&env), 0);
+  assert_int_equal(ytest_path_join(first_dir, sizeof(first_dir), env.tmp_root, "first"), 0);
+  assert_int_equal(ytest_path_join(second_dir, sizeof(second_dir), env.tmp_root, "second"), 0);
+  assert_int_equal(ytest_path_join(merged_dir, sizeof(merged_dir), env.tmp_root, "merged"), 0);
+  assert_int_equal(ytest_path_join(fresh_dir, sizeof(fresh_dir), env.tmp_root, "fresh"), 0);
+  assert_int_equal(ytest_mkdir_p(first_dir, 0700), 0);
+  assert_int_equal(ytest_mkdir_p(second_dir, 0700), 0);
+  assert_int_equal(ytest_mkdir_p(merged_dir, 0700), 0);
+  assert_int_equal(ytest_mkdir_p(fresh_dir, 0700), 0);
+  memset(first_documents, 0, sizeof(first_documents));
+  memset(second_documents, 0, sizeof(second_documents));
+  memset(passages, 0, sizeof(passages));
+  first_documents[0].id = bytes("doc-old");
+  first_documents[0].title = bytes("Obsolete search");
+  first_documents[0].body = bytes("removed retrieval text");
+  first_documents[0].updated_at_unix_ms = 1;
+  first_documents[1].id = bytes("doc-1");
+  first_documents[1].title = bytes("Search Search");
+  first_documents[1].body = bytes("Modern retrieval engine");
+  first_documents[1].updated_at_unix_ms = 2;
+  second_documents[0].id = bytes("doc-2");
+  second_documents[0].title = bytes("東京 search");
+  second_documents[0].body = bytes("vector retrieval engine");
+  second_documents[0].updated_at_unix_ms = 3;
+  passages[0].id = bytes("doc-old#0");
+  passages[0].parent_document_id = bytes("doc-old");
+  passages[0].text = bytes("removed retrieval");
+  passages[1].id = bytes("doc-1#0");
+  passages[1].parent_document_id = bytes("doc-1");
+  passages[1].text = bytes("Search retrieval");
+  kept_documents[0] = first_documents[1];
+  kept_documents[1] = second_documents[0];
+  kept_passages[0] = passages[1];
+  kept_passages[1] = passages[0];
+  kept_passages[1].id = bytes("doc-2#0");
+  kept_passages[1].parent_document_id = bytes("doc-2");
+  kept_passages[1].text = bytes("vector engine");
+
+  assert_int_equal(YAP_V2_lexical_write(first_dir, 3U, first_documents, 2U, passages, 2U,
+                                        merged),
+                   YAP_V2_OK);
+  assert_int_equal(YAP_V2_lexical_write(second_dir, 4U, second_documents, 1U, &kept_passages[1],
+                                        1U, merged),
+                   YAP_V2_OK);
+  YAP_V2_lexical_segment_init(&segments[0]);
+  YAP_V2_lexical_segment_init(&segments[1]);
+  assert_int_equal(YAP_V2_lexical_segment_open(first_dir, 3U, &segments[0]), YAP_V2_OK);
+  assert_int_equal(YAP_V2_lexical_segment_open(second_dir, 4U, &segments[1]), YAP_V2_OK);
+  sources[0].segment = &segments[0];
+  sources[0].document_ordinals = first_document_ordinals;
+  sources[0].passage_ordinals = first_passage_ordinals;
+  sources[1].segment = &segments[1];
+  sources[1].document_ordinals = second_document_ordinals;
+  sources[1].passage_ordinals = second_passage_ordinals;
+
+  assert_int_equal(YAP_V2_lexical_merge(merged_dir, 5U, sources, 2U, 2U, 2U, merged), YAP_V2_OK);
+  assert_int_equal(YAP_V2_lexical_write(fresh_dir, 5U, kept_documents, 2U, kept_passages, 2U,
+                                        fresh),
+                   YAP_V2_OK);
+  for (i = 0U; i < 3U; i++) {
+    assert_string_equal(merged[i].name, fresh[i].name);
+    assert_int_equal(merged[i].record_count, fresh[i].record_count);
+    assert_int_equal(merged[i].file_bytes, fresh[i].file_bytes);
+    assert_memory_equal(merged[i].checksum, fresh[i].checksum, sizeof(merged[i].checksum));
+  }
+  assert_int_equal(YAP_V2_lexical_term_find(&segments[0], bytes("obsolete"), &entry), YAP_V2_OK);
+  YAP_V2_lexical_segment_close(&segments[0]);
+  assert_int_equal(YAP_V2_lexical_segment_open(merged_dir, 5U, &segments[0]), YAP_V2_OK);
+  assert_int_equal(YAP_V2_lexical_term_find(&segments[0], bytes("obsolete"), &entry),
+                   YAP_V2_NOT_FOUND);
+  assert_int_equal(segments[0].document_count, 2U);
+  assert_int_equal(segments[0].passage_count, 2U);
+
+  sources[0].segment = &segments[1];
+  sources[0].document_ordinals = second_document_ordinals;
+  sources[0].passage_ordinals = second_passage_ordinals;
+  assert_int_equal(YAP_V2_lexical_merge(merged_dir, 6U, sources, 1U, 1U, 1U, merged),
+                   YAP_V2_INVALID_ARGUMENT);
+  YAP_V2_lexical_segment_close(&segments[0]);
+  YAP_V2_lexical_segment_close(&segments[1]);
+  ytest_env_destroy(&env);
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_writer_is_deterministic_and_describes_components),
     cmocka_unit_test(test_writer_rejects_invalid_utf8),
+    cmocka_unit_test(test_merge_matches_fresh_write_of_kept_documents),
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -32,9 +32,14 @@ static const char valid[] =
   "[metadata]\nfilterable_fields=['language','source']\n"
   "[daemon]\nrun_directory='./run'\ncore_host='127.0.0.1'\ncore_port=18401\n"
   "front_host='127.0.0.1'\nfront_port=18400\nmax_inflight=8\n"
-  "front_io_threads=4\ncore_io_threads=5\ncore_search_threads=6\n"
+  "front_io_threads=4\ncore_io_threads=5\ncore_search_threads=6\nann_build_threads=3\n"
   "core_writer_queue_capacity=7\ncore_writer_queue_bytes=268435456\n"
+  "memtable_max_operations=512\nmemtable_max_age_ms=250\n"
+  "wal_durability='interval'\nwal_sync_interval_ms=20\n"
   "max_inflight_bytes=8192\nrequest_timeout_ms=2500\n"
+  "adaptive_concurrency=true\nadaptive_min_inflight=2\nadaptive_latency_target_ms=40\n"
+  "latency_precision_bits=7\n"
+  "slow_query_entries=32\nslow_query_interval_seconds=30\nslow_query_sample_one_in=100\n"
   "ingest_max_body_bytes=33554432\ningest_timeout_ms=120000\n"
   "auto_compact_enabled=false\nauto_compact_check_interval_ms=5000\n"
   "auto_compact_small_segment_bytes=1048576\n"
@@ -55,9 +60,21 @@ static void test_loads_shared_config_and_resolves_paths(void **state) {
   assert_int_equal(config.front_io_threads, 4U);
   assert_int_equal(config.core_io_threads, 5U);
   assert_int_equal(config.core_search_threads, 6U);
+  assert_int_equal(config.ann_build_threads, 3U);
   assert_int_equal(config.core_writer_queue_capacity, 7U);
   assert_int_equal(config.core_writer_queue_bytes, 268435456U);
+  assert_int_equal(config.memtable_max_operations, 512U);
+  assert_int_equal(config.memtable_max_age_ms, 250U);
+  assert_int_equal(config.wal_durability, YAP_V2_WAL_SYNC_INTERVAL);
+  assert_int_equal(config.wal_sync_interval_ms, 20U);
   assert_int_equal(config.runtime_policy.max_inflight, 8U);
+  assert_true(config.runtime_policy.adaptive_concurrency);
+  assert_int_equal(config.runtime_policy.adaptive_min_inflight, 2U);
+  assert_int_equal(config.runtime_policy.adaptive_latency_target_ms, 40U);
+  assert_int_equal(config.latency_precision_bits, 7U);
+  assert_int_equal(config.slow_query_entries, 32U);
+  assert_int_equal(config.slow_query_interval_seconds, 30U);
+  assert_int_equal(config.slow_query_sample_one_in, 100U);
   assert_int_equal(config.runtime_policy.request_timeout_ms, 2500U);
   assert_int_equal(config.runtime_policy.ingest_max_body_bytes, 33554432U);
   assert_int_equal(config.runtime_policy.ingest_timeout_ms, 120000U);
@@ -119,6 +136,14 @@ static void test_rejects_invalid_ranges_and_removed_schema_version(void **state)
   invalid = write_config(source);
   assert_int_equal(YAP_application_config_load(invalid, &config, NULL, 0U), YAP_V2_OUT_OF_RANGE);
   unlink(invalid); free(invalid);
+  assert_true(snprintf(source, sizeof(source), "%s", valid) > 0);
+  {
+    char *minimum = strstr(source, "adaptive_min_inflight=2");
+    assert_non_null(minimum); minimum[strlen("adaptive_min_inflight=")] = '9';
+  }
+  invalid = write_config(source);
+  assert_int_equal(YAP_application_config_load(invalid, &config, NULL, 0U), YAP_V2_OUT_OF_RANGE);
+  unlink(invalid); free(invalid);
   invalid = write_config(
     "schema_version=1\nformat_version=2\nindex.directory='./x'\n"
     "[tokenizer]\n[chunking]\n[vector]\nenabled=false\n[daemon]\n"
@@ -138,9 +163,21 @@ static void test_execution_threads_defaults_and_ranges(void **state) {
   assert_int_equal(config.front_io_threads, YAP_APPLICATION_DEFAULT_IO_THREADS);
   assert_int_equal(config.core_io_threads, YAP_APPLICATION_DEFAULT_IO_THREADS);
   assert_int_equal(config.core_search_threads, YAP_APPLICATION_DEFAULT_SEARCH_THREADS);
+  assert_int_equal(config.ann_build_threads, 0U);
   assert_int_equal(config.core_writer_queue_capacity, 1U);
   assert_int_equal(config.core_writer_queue_bytes,
                    YAP_APPLICATION_DEFAULT_WRITER_QUEUE_BYTES);
+  assert_int_equal(config.memtable_max_operations, 0U);
+  assert_int_equal(config.memtable_max_age_ms,
+                   YAP_APPLICATION_DEFAULT_MEMTABLE_MAX_AGE_MS);
+  assert_int_equal(config.wal_durability, YAP_V2_WAL_SYNC_BATCH);
+  assert_int_equal(config.wal_sync_interval_ms, YAP_V2_DEFAULT_WAL_SYNC_INTERVAL_MS);
+  assert_int_equal(config.latency_precision_bits,
+                   YAP_APPLICATION_DEFAULT_LATENCY_PRECISION_BITS);
+  assert_int_equal(config.slow_query_entries, YAP_APPLICATION_DEFAULT_SLOW_QUERY_ENTRIES);
+  assert_int_equal(config.slow_query_interval_seconds,
+                   YAP_APPLICATION_DEFAULT_SLOW_QUERY_INTERVAL_SECONDS);
+  assert_int_equal(config.slow_query_sample_one_in, 0U);
 
   assert_true(snprintf(source, sizeof(source), "%s", valid) > 0);
   {
@@ -166,6 +203,70 @@ static void test_execution_threads_defaults_and_ranges(void **state) {
   assert_int_equal(YAP_application_config_load(path, &config, NULL, 0U), YAP_V2_OUT_OF_RANGE);
   unlink(path); free(path);
 
+  assert_true(snprintf(source, sizeof(source), "%s", valid) > 0);
+  {
+    char *value = strstr(source, "ann_build_threads=3");
+    const char *replacement = "ann_build_threads=257";
+    size_t old_bytes = strlen("ann_build_threads=3");
+    size_t new_bytes = strlen(replacement);
+    assert_non_null(value);
+    memmove(value + new_bytes, value + old_bytes, strlen(value + old_bytes) + 1U);
+    memcpy(value, replacement, new_bytes);
+  }
+  path = write_config(source);
+  assert_int_equal(YAP_application_config_load(path, &config, NULL, 0U), YAP_V2_OUT_OF_RANGE);
+  unlink(path); free(path);
+
+  assert_true(snprintf(source, sizeof(source), "%s", valid) > 0);
+  {
+    char *value = strstr(source, "memtable_max_operations=512");
+    const char *replacement = "memtable_max_operations=10001";
+    size_t old_bytes = strlen("memtable_max_operations=512");
+    size_t new_bytes = strlen(replacement);
+    assert_non_null(value);
+    memmove(value + new_bytes, value + old_bytes, strlen(value + old_bytes) + 1U);
+    memcpy(value, replacement, new_bytes);
+  }
+  path = write_config(source);
+  assert_int_equal(YAP_application_config_load(path, &config, NULL, 0U), YAP_V2_OUT_OF_RANGE);
+  unlink(path); free(path);
+
+  assert_true(snprintf(source, sizeof(source), "%s", valid) > 0);
+  {
+    char *value = strstr(source, "latency_precision_bits=7");
+    assert_non_null(value);
+    value[strlen("latency_precision_bits=")] = '9';
+  }
+  path = write_config(source);
+  assert_int_equal(YAP_application_config_load(path, &config, NULL, 0U), YAP_V2_OUT_OF_RANGE);
+  unlink(path); free(path);
+
+  assert_true(snprintf(source, sizeof(source), "%s", valid) > 0);
+  {
+    char *value = strstr(source, "slow_query_interval_seconds=30");
+    assert_non_null(value);
+    value[strlen("slow_query_interval_seconds=")] = '0';
+    value[strlen("slow_query_interval_seconds=") + 1U] = ' ';
+  }
+  path = write_config(source);
+  assert_int_equal(YAP_application_config_load(path, &config, NULL, 0U), YAP_V2_OUT_OF_RANGE);
+  unlink(path); free(path);
+
+  assert_true(snprintf(source, sizeof(source), "%s", valid) > 0);
+  {
+    char *value = strstr(source, "wal_durability='interval'");
+    const char *replacement = "wal_durability='never'";
+    size_t old_bytes = strlen("wal_durability='interval'");
+    size_t new_bytes = strlen(replacement);
+    assert_non_null(value);
+    memmove(value + new_bytes, value + old_bytes, strlen(value + old_bytes) + 1U);
+    memcpy(value, replacement, new_bytes);
+  }
+  path = write_config(source);
+  assert_int_equal(YAP_application_config_load(path, &config, NULL, 0U),
+                   YAP_V2_INVALID_FORMAT);
+  unlink(path); free(path);
+
   path = write_config(
     "format_version=2\n[index]\ndirectory='./x'\n[tokenizer]\n[chunking]\n"
     "[vector]\nenabled=false\n[daemon]\nrun_directory='./run'\n"
@@ -78,6 +78,70 @@ static void test_limiter_fails_closed_on_count_and_bytes(void **state) {
   YAP_V2_runtime_limiter_close(&limiter);
 }
 
+static void test_adaptive_limiter_follows_latency_between_bounds(void **state) {
+  YAP_V2_RUNTIME_POLICY policy; YAP_V2_RUNTIME_LIMITER limiter = {0};
+  YAP_V2_RUNTIME_LIMITER_STATE limiter_state;
+  size_t acquired = 0U, i;
+  (void)state; YAP_V2_runtime_policy_init(&policy);
+  policy.max_inflight = 16U; policy.adaptive_concurrency = 1;
+  policy.adaptive_min_inflight = 20U;
+  assert_int_equal(YAP_V2_runtime_limiter_init(&limiter, &policy), YAP_V2_INVALID_ARGUMENT);
+  policy.adaptive_min_inflight = 2U; policy.adaptive_latency_target_ms = 50U;
+  assert_int_equal(YAP_V2_runtime_limiter_init(&limiter, &policy), YAP_V2_OK);
+  while (YAP_V2_runtime_limiter_acquire(&limiter, 1U) == YAP_V2_OK) acquired++;
+  assert_int_equal(acquired, 8U);
+  for (i = 0U; i < 200U; i++) {
+    YAP_V2_runtime_limiter_release_observed(&limiter, 1U, 1000U);
+    while (YAP_V2_runtime_limiter_acquire(&limiter, 1U) == YAP_V2_OK) {}
+  }
+  assert_int_equal(YAP_V2_runtime_limiter_state(&limiter, &limiter_state), YAP_V2_OK);
+  assert_true(limiter_state.adaptive);
+  assert_int_equal(limiter_state.limit, 16U);
+  assert_int_equal(limiter_state.rtt_noload_microseconds, 1000U);
+  assert_true(limiter_state.rejected > 200U);
+  for (i = 0U; i < 200U; i++) {
+    YAP_V2_runtime_limiter_release_observed(&limiter, 1U, 200000U);
+    (void)YAP_V2_runtime_limiter_acquire(&limiter, 1U);
+  }
+  assert_int_equal(YAP_V2_runtime_limiter_state(&limiter, &limiter_state), YAP_V2_OK);
+  assert_int_equal(limiter_state.limit, 2U);
+  YAP_V2_runtime_limiter_close(&limiter);
+}
+
+static void test_adaptive_limiter_backs_off_on_deadline_misses(void **state) {
+  YAP_V2_RUNTIME_POLICY policy; YAP_V2_RUNTIME_LIMITER limiter = {0};
+  YAP_V2_RUNTIME_LIMITER_STATE limiter_state;
+  size_t inflight, inflight_bytes, max_inflight, max_inflight_bytes, previous, i;
+  (void)state; YAP_V2_runtime_policy_init(&policy);
+  policy.max_inflight = 16U; policy.adaptive_concurrency = 1;
+  policy.adaptive_min_inflight = 2U; policy.adaptive_latency_target_ms = 50U;
+  assert_int_equal(YAP_V2_runtime_limiter_init(&limiter, &policy), YAP_V2_OK);
+  while (YAP_V2_runtime_limiter_acquire(&limiter, 1U) == YAP_V2_OK) {}
+  for (i = 0U; i < 200U; i++) {
+    YAP_V2_runtime_limiter_release_observed(&limiter, 1U, 1000U);
+    while (YAP_V2_runtime_limiter_acquire(&limiter, 1U) == YAP_V2_OK) {}
+  }
+  assert_int_equal(YAP_V2_runtime_limiter_state(&limiter, &limiter_state), YAP_V2_OK);
+  assert_int_equal(limiter_state.limit, 16U);
+  /* Deadline misses carry no latency sample, yet each one lowers the limit to the floor. */
+  previous = limiter_state.limit;
+  for (i = 0U; i < 16U; i++) {
+    YAP_V2_runtime_limiter_release_dropped(&limiter, 1U);
+    assert_int_equal(YAP_V2_runtime_limiter_state(&limiter, &limiter_state), YAP_V2_OK);
+    assert_true(limiter_state.limit <= previous);
+    if (i == 0U) assert_true(limiter_state.limit < 16U);
+    previous = limiter_state.limit;
+  }
+  assert_int_equal(limiter_state.limit, 2U);
+  assert_int_equal(YAP_V2_runtime_limiter_snapshot(&limiter, &inflight, &inflight_bytes,
+                                                   &max_inflight, &max_inflight_bytes),
+                   YAP_V2_OK);
+  assert_int_equal(inflight, 0U);
+  assert_int_equal(inflight_bytes, 0U);
+  assert_int_equal(max_inflight, 2U);
+  YAP_V2_runtime_limiter_close(&limiter);
+}
+
 static void test_write_token_authorization(void **state) {
   YAP_V2_RUNTIME_POLICY policy; char authorization[300];
   char *config;
@@ -103,6 +167,8 @@ int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_policy_defaults_and_strict_config),
     cmocka_unit_test(test_limiter_fails_closed_on_count_and_bytes),
+    cmocka_unit_test(test_adaptive_limiter_follows_latency_between_bounds),
+    cmocka_unit_test(test_adaptive_limiter_backs_off_on_deadline_misses),
     cmocka_unit_test(test_write_token_authorization),
     cmocka_unit_test(test_socket_deadline_is_applied)
   };
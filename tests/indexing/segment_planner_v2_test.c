@@ -124,7 +124,8 @@ static void test_exact_payload_sizes_include_block_metadata_vector_and_tombstone
   assert_int_equal(ytest_path_join(directory, sizeof(directory), env.tmp_root, "seg-test"), 0);
   assert_int_equal(ytest_mkdir_p(directory, 0700), 0);
   assert_int_equal(YAP_V2_segment_slice_write(directory, "seg-test", 1U, &config, units,
-                                               &plan, plan.slices[0], &descriptor), YAP_V2_OK);
+                                               &plan, plan.slices[0], NULL, &descriptor),
+                   YAP_V2_OK);
   assert_payloads_equal(directory, &plan.slices[0]);
   YAP_V2_segment_plan_free(&plan);
 
@@ -139,7 +140,8 @@ static void test_exact_payload_sizes_include_block_metadata_vector_and_tombstone
   assert_int_equal(ytest_path_join(directory, sizeof(directory), env.tmp_root, "seg-delete"), 0);
   assert_int_equal(ytest_mkdir_p(directory, 0700), 0);
   assert_int_equal(YAP_V2_segment_slice_write(directory, "seg-delete", 2U, &config,
-                                               delete_units, &plan, plan.slices[0], &descriptor),
+                                               delete_units, &plan, plan.slices[0], NULL,
+                                               &descriptor),
                    YAP_V2_OK);
   assert_payloads_equal(directory, &plan.slices[0]);
   YAP_V2_segment_plan_free(&plan);
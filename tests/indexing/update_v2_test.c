@@ -24,6 +24,7 @@
 #include "server/yappo_observability_v2.h"
 #include "indexing/yappo_segment_planner_v2.h"
 #include "indexing/yappo_update_v2.h"
+#include "indexing/yappo_update_wal_v2.h"
 #include "components/yappo_vector_v2.h"
 
 static YAP_V2_BYTES_VIEW bytes(const char *text) {
@@ -261,6 +262,106 @@ static void test_build_batch_uses_the_same_split_planner(void **state) {
   ytest_env_destroy(&env);
 }
 
+static YAP_V2_BUILD_BATCH *prepare_build_batch(const YAP_V2_CONFIG *config, const char *line) {
+  YAP_V2_INGEST_OPERATION *operations = calloc(1U, sizeof(*operations));
+  YAP_V2_BUILD_BATCH *batch = NULL;
+  char error[256] = {0};
+  assert_non_null(operations);
+  assert_int_equal(YAP_V2_ingest_parse_ndjson(line, strlen(line), operations,
+                                              error, sizeof(error)), YAP_V2_OK);
+  assert_int_equal(YAP_V2_build_batch_prepare(config, operations, 1U, &batch,
+                                              error, sizeof(error)), YAP_V2_OK);
+  assert_non_null(batch);
+  return batch;
+}
+
+static void test_build_batches_written_out_of_order_publish_in_sequence(void **state) {
+  ytest_env_t env;
+  YAP_V2_CONFIG config;
+  YAP_V2_BUILD_BATCH *first, *second;
+  YAP_V2_UPDATE_RESULT result;
+  char path[PATH_MAX], error[256] = {0};
+  size_t segments;
+  (void)state;
+  assert_int_equal(ytest_env_init(&env), 0); create_index(&env);
+  assert_int_equal(ytest_path_join(path, sizeof(path), env.tmp_root, "config.toml"), 0);
+  assert_int_equal(YAP_V2_config_load(path, &config, NULL, 0U), YAP_V2_OK);
+  first = prepare_build_batch(&config,
+    "{\"operation\":\"upsert\",\"id\":\"build-a\",\"title\":\"Alpha\","
+    "\"body\":\"alpha\",\"metadata\":{\"category\":\"new\"},\"vectors\":[[1,0]]}");
+  second = prepare_build_batch(&config,
+    "{\"operation\":\"upsert\",\"id\":\"build-b\",\"title\":\"Beta\","
+    "\"body\":\"beta\",\"metadata\":{\"category\":\"new\"},\"vectors\":[[0,1]]}");
+  assert_int_equal(YAP_V2_build_batch_write(env.tmp_root, &config, 3U, second,
+                                            error, sizeof(error)), YAP_V2_OK);
+  assert_int_equal(YAP_V2_build_batch_write(env.tmp_root, &config, 2U, first,
+                                            error, sizeof(error)), YAP_V2_OK);
+  YAP_V2_update_result_init(&result);
+  assert_int_equal(YAP_V2_build_batch_publish(env.tmp_root, &config, second, &result,
+                                              error, sizeof(error)), YAP_V2_CONFLICT);
+  assert_int_equal(manifest_generation(&env, &segments), 1U);
+  assert_int_equal(YAP_V2_build_batch_publish(env.tmp_root, &config, first, &result,
+                                              error, sizeof(error)), YAP_V2_OK);
+  assert_int_equal(result.generation, 2U); assert_int_equal(result.accepted, 1U);
+  YAP_V2_update_result_free(&result);
+  assert_int_equal(YAP_V2_build_batch_publish(env.tmp_root, &config, second, &result,
+                                              error, sizeof(error)), YAP_V2_OK);
+  assert_int_equal(result.generation, 3U); assert_int_equal(result.segment_ids.count, 1U);
+  YAP_V2_update_result_free(&result);
+  assert_int_equal(manifest_generation(&env, &segments), 3U); assert_int_equal(segments, 3U);
+  assert_int_equal(segment_directory_count(&env), 3U);
+  YAP_V2_build_batch_free(first); YAP_V2_build_batch_free(second);
+  assert_int_equal(segment_directory_count(&env), 3U);
+  ytest_env_destroy(&env);
+}
+
+static void test_bulk_build_merges_staged_batches_into_one_generation(void **state) {
+  ytest_env_t env;
+  YAP_V2_CONFIG config;
+  YAP_V2_MANIFEST staged;
+  YAP_V2_BUILD_BATCH *first, *second;
+  YAP_V2_UPDATE_RESULT result;
+  char path[PATH_MAX], error[256] = {0};
+  size_t segments, merged = 0U;
+  (void)state;
+  assert_int_equal(ytest_env_init(&env), 0); create_index(&env);
+  assert_int_equal(ytest_path_join(path, sizeof(path), env.tmp_root, "config.toml"), 0);
+  assert_int_equal(YAP_V2_config_load(path, &config, NULL, 0U), YAP_V2_OK);
+  YAP_V2_manifest_init(&staged); staged.generation = 2U;
+  assert_int_equal(YAP_V2_config_fingerprint(&config, staged.config_fingerprint), YAP_V2_OK);
+  first = prepare_build_batch(&config,
+    "{\"operation\":\"upsert\",\"id\":\"build-a\",\"title\":\"Alpha\","
+    "\"body\":\"alpha\",\"metadata\":{\"category\":\"new\"},\"vectors\":[[1,0]]}");
+  second = prepare_build_batch(&config,
+    "{\"operation\":\"upsert\",\"id\":\"build-b\",\"title\":\"Beta\","
+    "\"body\":\"beta\",\"metadata\":{\"category\":\"new\"},\"vectors\":[[0,1]]}");
+  assert_int_equal(YAP_V2_build_batch_write(env.tmp_root, &config, 2U, first,
+                                            error, sizeof(error)), YAP_V2_OK);
+  assert_int_equal(YAP_V2_build_batch_write(env.tmp_root, &config, 2U, second,
+                                            error, sizeof(error)), YAP_V2_OK);
+  YAP_V2_update_result_init(&result);
+  assert_int_equal(YAP_V2_build_batch_stage(first, &staged, &result), YAP_V2_OK);
+  YAP_V2_update_result_free(&result);
+  assert_int_equal(YAP_V2_build_batch_stage(second, &staged, &result), YAP_V2_OK);
+  assert_int_equal(result.generation, 2U); assert_int_equal(result.accepted, 1U);
+  YAP_V2_update_result_free(&result);
+  YAP_V2_build_batch_free(first); YAP_V2_build_batch_free(second);
+  assert_int_equal(staged.segment_count, 2U);
+  assert_int_equal(manifest_generation(&env, &segments), 1U);
+  assert_int_equal(segment_directory_count(&env), 3U);
+  assert_int_equal(YAP_V2_compact_staged(env.tmp_root, &config, &staged, &merged,
+                                         error, sizeof(error)), YAP_V2_OK);
+  assert_int_equal(merged, 2U); assert_int_equal(staged.segment_count, 1U);
+  assert_int_equal(segment_directory_count(&env), 2U);
+  assert_int_equal(YAP_V2_build_publish_staged(env.tmp_root, &config, &staged,
+                                               error, sizeof(error)), YAP_V2_OK);
+  assert_int_equal(manifest_generation(&env, &segments), 2U); assert_int_equal(segments, 2U);
+  assert_int_equal(YAP_V2_build_publish_staged(env.tmp_root, &config, &staged,
+                                               error, sizeof(error)), YAP_V2_CONFLICT);
+  YAP_V2_manifest_free(&staged);
+  ytest_env_destroy(&env);
+}
+
 static void test_update_accepts_more_than_legacy_limit_and_rejects_over_max(void **state) {
   ytest_env_t env;
   YAP_V2_INGEST_OPERATION operations[101];
@@ -670,6 +771,54 @@ static void test_corrupt_wal_blocks_recovery(void **state) {
   ytest_env_destroy(&env);
 }
 
+static void append_wal_batch(ytest_env_t *env, const char *request) {
+  YAP_V2_INGEST_OPERATION *operations = NULL;
+  size_t count = 0U;
+  char error[256] = {0};
+  assert_int_equal(YAP_V2_update_parse_json_batch((const unsigned char *)request,
+                                                  strlen(request), &operations, &count,
+                                                  error, sizeof(error)), YAP_V2_OK);
+  assert_int_equal(YAP_V2_update_wal_append(env->tmp_root, 1U, operations, count),
+                   YAP_V2_OK);
+  YAP_V2_update_operations_free(operations, count);
+}
+
+static void test_group_commit_wal_merges_records_and_ignores_torn_tail(void **state) {
+  ytest_env_t env;
+  YAP_V2_UPDATE_WAL wal;
+  FILE *file;
+  char path[PATH_MAX], error[256] = {0};
+  uint64_t sync_microseconds = 0U;
+  size_t segments;
+  (void)state;
+  assert_int_equal(ytest_env_init(&env), 0);
+  create_index(&env);
+  append_wal_batch(&env, "{\"operations\":[{\"operation\":\"upsert\","
+    "\"id\":\"wal-doc\",\"title\":\"WAL\",\"body\":\"stale\","
+    "\"metadata\":{\"category\":\"new\"},\"vectors\":[[1,0]]},"
+    "{\"operation\":\"delete\",\"id\":\"doc-b\"}]}");
+  append_wal_batch(&env, "{\"operations\":[{\"operation\":\"upsert\","
+    "\"id\":\"wal-doc\",\"title\":\"WAL\",\"body\":\"fresh\","
+    "\"metadata\":{\"category\":\"new\"},\"vectors\":[[1,0]]}]}");
+  assert_int_equal(YAP_V2_update_wal_sync(env.tmp_root, &sync_microseconds), YAP_V2_OK);
+  assert_int_equal(ytest_path_join(path, sizeof(path), env.tmp_root, "update.wal"), 0);
+  file = fopen(path, "ab"); assert_non_null(file);
+  assert_int_equal(fwrite("YAPWAL2", 1U, 8U, file), 8U);
+  assert_int_equal(fclose(file), 0);
+  YAP_V2_update_wal_init(&wal);
+  assert_int_equal(YAP_V2_update_wal_load(env.tmp_root, &wal), YAP_V2_OK);
+  assert_int_equal(wal.base_generation, 1U);
+  assert_int_equal(wal.operation_count, 2U);
+  YAP_V2_update_wal_free(&wal);
+  assert_int_equal(YAP_V2_update_recover(env.tmp_root, error, sizeof(error)), YAP_V2_OK);
+  assert_false(YAP_V2_update_wal_exists(env.tmp_root));
+  assert_int_equal(manifest_generation(&env, &segments), 2U);
+  assert_int_equal(search_count(&env, "fresh", "wal-doc"), 1U);
+  assert_int_equal(search_count(&env, "stale", NULL), 0U);
+  assert_int_equal(search_count(&env, "gone", NULL), 0U);
+  ytest_env_destroy(&env);
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_http_atomic_update_latest_wins_and_delete),
@@ -677,6 +826,8 @@ int main(void) {
     cmocka_unit_test(test_update_split_is_atomic_and_cleans_failed_segments),
     cmocka_unit_test(test_single_document_capacity_error_is_detailed),
     cmocka_unit_test(test_build_batch_uses_the_same_split_planner),
+    cmocka_unit_test(test_build_batches_written_out_of_order_publish_in_sequence),
+    cmocka_unit_test(test_bulk_build_merges_staged_batches_into_one_generation),
     cmocka_unit_test(test_update_accepts_more_than_legacy_limit_and_rejects_over_max),
     cmocka_unit_test(test_compaction_live_only_preserves_all_search_modes),
     cmocka_unit_test(test_compaction_splits_output_and_builds_segment_local_bm25_stats),
@@ -687,7 +838,8 @@ int main(void) {
     cmocka_unit_test(test_compaction_crash_recovery_and_orphan_gc),
     cmocka_unit_test(test_wal_replays_unpublished_update),
     cmocka_unit_test(test_wal_clears_after_manifest_was_published),
-    cmocka_unit_test(test_corrupt_wal_blocks_recovery)
+    cmocka_unit_test(test_corrupt_wal_blocks_recovery),
+    cmocka_unit_test(test_group_commit_wal_merges_records_and_ignores_torn_tail)
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -0,0 +1,254 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common/yappo_unicode.h"
+
+typedef struct {
+  size_t documents;
+  size_t document_words;
+  size_t iterations;
+  size_t threads;
+} OPTIONS;
+
+typedef enum {
+  CORPUS_ENGLISH = 0,
+  CORPUS_JAPANESE = 1,
+  CORPUS_MIXED = 2,
+  CORPUS_COUNT = 3
+} CORPUS_KIND;
+
+typedef struct {
+  char **texts;
+  size_t *bytes;
+  size_t count;
+  size_t total_bytes;
+} CORPUS;
+
+typedef struct {
+  const CORPUS *corpus;
+  size_t first;
+  size_t end;
+  int chunk;
+  size_t tokens;
+  int status;
+} WORKER;
+
+static const char *const english_words[] = {
+  "search", "index", "Segment", "query", "ranking", "passage", "vector", "the",
+  "of", "and", "BM25", "2026", "latency", "Tokyo", "server", "update", "manifest",
+  "compaction", "HTTP/1.1", "e.g.", "don't", "3.14", "user@example.com"};
+static const char *const japanese_words[] = {
+  "検索", "索引", "は", "を", "に", "形態素", "東京", "タワー", "ベクトル", "近似",
+  "セグメント", "更新します", "文書", "の", "全文検索エンジン", "です", "。", "、",
+  "ｶﾀｶﾅ", "ＡＢＣ", "１２３"};
+
+static int parse_size(const char *value, size_t minimum, size_t maximum,
+                      size_t *output) {
+  char *end = NULL;
+  unsigned long long parsed;
+  errno = 0;
+  parsed = strtoull(value, &end, 10);
+  if (errno != 0 || end == value || *end != '\0' || parsed < minimum ||
+      parsed > maximum)
+    return -1;
+  *output = (size_t)parsed;
+  return 0;
+}
+
+static int parse_options(int argc, char **argv, OPTIONS *options) {
+  int i;
+  options->documents = 2000U;
+  options->document_words = 400U;
+  options->iterations = 11U;
+  options->threads = 1U;
+  for (i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) return -1;
+    if (strcmp(argv[i], "--documents") == 0) {
+      if (parse_size(argv[i + 1], 1U, 10000000U, &options->documents) != 0) return -1;
+    } else if (strcmp(argv[i], "--document-words") == 0) {
+      if (parse_size(argv[i + 1], 1U, 100000U, &options->document_words) != 0) return -1;
+    } else if (strcmp(argv[i], "--iterations") == 0) {
+      if (parse_size(argv[i + 1], 3U, 100000U, &options->iterations) != 0) return -1;
+    } else if (strcmp(argv[i], "--threads") == 0) {
+      if (parse_size(argv[i + 1], 1U, 256U, &options->threads) != 0) return -1;
+    } else {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static uint64_t next_random(uint64_t *state) {
+  uint64_t value = *state;
+  value ^= value >> 12U;
+  value ^= value << 25U;
+  value ^= value >> 27U;
+  *state = value;
+  return value * UINT64_C(2685821657736338717);
+}
+
+static void corpus_free(CORPUS *corpus) {
+  size_t i;
+  for (i = 0U; i < corpus->count; i++) free(corpus->texts[i]);
+  free(corpus->texts);
+  free(corpus->bytes);
+  memset(corpus, 0, sizeof(*corpus));
+}
+
+/* Mixed documents alternate Japanese sentences and English phrases the way
+ * technical Japanese pages do, so ASCII runs are short and embedded. */
+static int corpus_generate(CORPUS *corpus, CORPUS_KIND kind, const OPTIONS *options) {
+  const size_t english_count = sizeof(english_words) / sizeof(english_words[0]);
+  const size_t japanese_count = sizeof(japanese_words) / sizeof(japanese_words[0]);
+  uint64_t random_state = UINT64_C(0x9e3779b97f4a7c15) + (uint64_t)kind;
+  size_t i, w;
+  memset(corpus, 0, sizeof(*corpus));
+  corpus->texts = calloc(options->documents, sizeof(*corpus->texts));
+  corpus->bytes = calloc(options->documents, sizeof(*corpus->bytes));
+  if (corpus->texts == NULL || corpus->bytes == NULL) return -1;
+  corpus->count = options->documents;
+  for (i = 0U; i < options->documents; i++) {
+    size_t capacity = options->document_words * 32U + 1U, used = 0U;
+    int japanese = kind == CORPUS_JAPANESE;
+    char *text = malloc(capacity);
+    if (text == NULL) return -1;
+    for (w = 0U; w < options->document_words; w++) {
+      const char *word;
+      size_t length;
+      if (kind == CORPUS_MIXED && next_random(&random_state) % 6U == 0U) japanese = !japanese;
+      word = japanese ? japanese_words[next_random(&random_state) % japanese_count]
+                      : english_words[next_random(&random_state) % english_count];
+      length = strlen(word);
+      if (used + length + 1U >= capacity) break;
+      memcpy(text + used, word, length);
+      used += length;
+      if (!japanese) text[used++] = ' ';
+    }
+    text[used] = '\0';
+    corpus->texts[i] = text;
+    corpus->bytes[i] = used;
+    corpus->total_bytes += used;
+  }
+  return 0;
+}
+
+static void *worker_main(void *argument) {
+  WORKER *worker = argument;
+  size_t i;
+  worker->tokens = 0U;
+  worker->status = YAP_V2_OK;
+  for (i = worker->first; i < worker->end && worker->status == YAP_V2_OK; i++) {
+    if (worker->chunk) {
+      YAP_V2_CHUNK_SEQUENCE chunks;
+      worker->status = YAP_V2_unicode_chunk("doc", worker->corpus->texts[i],
+                                            worker->corpus->bytes[i], 512U, 64U, &chunks);
+      if (worker->status == YAP_V2_OK) {
+        worker->tokens += chunks.chunk_count;
+        YAP_V2_chunk_sequence_free(&chunks);
+      }
+    } else {
+      YAP_V2_TOKEN_SEQUENCE tokens;
+      worker->status = YAP_V2_unicode_tokenize(worker->corpus->texts[i],
+                                               worker->corpus->bytes[i], &tokens);
+      if (worker->status == YAP_V2_OK) {
+        worker->tokens += tokens.token_count;
+        YAP_V2_token_sequence_free(&tokens);
+      }
+    }
+  }
+  return NULL;
+}
+
+static int compare_double(const void *left, const void *right) {
+  const double a = *(const double *)left;
+  const double b = *(const double *)right;
+  return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static double elapsed_ms(struct timespec start, struct timespec end) {
+  return (double)(end.tv_sec - start.tv_sec) * 1000.0 +
+         (double)(end.tv_nsec - start.tv_nsec) / 1000000.0;
+}
+
+static int run_pass(const CORPUS *corpus, const OPTIONS *options, int chunk,
+                    WORKER *workers, pthread_t *threads, size_t *produced) {
+  size_t i, started = 0U;
+  int status = 0;
+  *produced = 0U;
+  for (i = 0U; i < options->threads; i++) {
+    workers[i].corpus = corpus;
+    workers[i].first = corpus->count * i / options->threads;
+    workers[i].end = corpus->count * (i + 1U) / options->threads;
+    workers[i].chunk = chunk;
+    if (pthread_create(&threads[i], NULL, worker_main, &workers[i]) != 0) {
+      status = -1;
+      break;
+    }
+    started++;
+  }
+  for (i = 0U; i < started; i++) {
+    (void)pthread_join(threads[i], NULL);
+    if (workers[i].status != YAP_V2_OK) status = -1;
+    *produced += workers[i].tokens;
+  }
+  return status;
+}
+
+int main(int argc, char **argv) {
+  static const char *const corpus_names[CORPUS_COUNT] = {"english", "japanese", "mixed"};
+  OPTIONS options;
+  CORPUS corpora[CORPUS_COUNT];
+  WORKER *workers = NULL;
+  pthread_t *threads = NULL;
+  double *samples = NULL;
+  size_t kind, iteration;
+  int chunk, status = EXIT_FAILURE;
+  if (parse_options(argc, argv, &options) != 0) {
+    fprintf(stderr, "usage: %s [--documents N] [--document-words N] [--iterations N] "
+                    "[--threads N]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  memset(corpora, 0, sizeof(corpora));
+  workers = calloc(options.threads, sizeof(*workers));
+  threads = calloc(options.threads, sizeof(*threads));
+  samples = malloc(options.iterations * sizeof(*samples));
+  if (workers == NULL || threads == NULL || samples == NULL) goto done;
+  for (kind = 0U; kind < CORPUS_COUNT; kind++)
+    if (corpus_generate(&corpora[kind], (CORPUS_KIND)kind, &options) != 0) goto done;
+  printf("corpus\toperation\tthreads\tdocuments\tbytes\toutputs\tmedian_ms\tp95_ms\t"
+         "mib_per_second\tdocuments_per_second\n");
+  for (kind = 0U; kind < CORPUS_COUNT; kind++) {
+    for (chunk = 0; chunk <= 1; chunk++) {
+      size_t produced = 0U;
+      double median;
+      for (iteration = 0U; iteration < options.iterations + 2U; iteration++) {
+        struct timespec start, end;
+        if (clock_gettime(CLOCK_MONOTONIC, &start) != 0 ||
+            run_pass(&corpora[kind], &options, chunk, workers, threads, &produced) != 0 ||
+            clock_gettime(CLOCK_MONOTONIC, &end) != 0)
+          goto done;
+        if (iteration >= 2U) samples[iteration - 2U] = elapsed_ms(start, end);
+      }
+      qsort(samples, options.iterations, sizeof(*samples), compare_double);
+      median = samples[options.iterations / 2U];
+      printf("%s\t%s\t%zu\t%zu\t%zu\t%zu\t%.3f\t%.3f\t%.2f\t%.0f\n", corpus_names[kind],
+             chunk ? "chunk" : "tokenize", options.threads, corpora[kind].count,
+             corpora[kind].total_bytes, produced, median,
+             samples[(options.iterations * 95U) / 100U],
+             (double)corpora[kind].total_bytes / (1024.0 * 1024.0) / (median / 1000.0),
+             (double)corpora[kind].count / (median / 1000.0));
+    }
+  }
+  status = EXIT_SUCCESS;
+done:
+  for (kind = 0U; kind < CORPUS_COUNT; kind++) corpus_free(&corpora[kind]);
+  free(workers);
+  free(threads);
+  free(samples);
+  return status;
+}
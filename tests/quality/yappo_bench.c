@@ -0,0 +1,1026 @@
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <yyjson.h>
+
+#include "test_env.h"
+#include "test_fs.h"
+#include "components/yappo_embedding.h"
+#include "components/yappo_lexical_v2.h"
+#include "components/yappo_metadata_v2.h"
+#include "components/yappo_vector_v2.h"
+#include "config/yappo_config_v2.h"
+#include "server/yappo_http_v2.h"
+#include "server/yappo_observability_v2.h"
+#include "storage/yappo_manifest_v2.h"
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+#define BENCH_FORMAT_VERSION 1U
+#define BENCH_MAX_REQUESTS 10000000U
+#define BENCH_MAX_QUERY_TERMS 3U
+/* Percentiles are within 2^-7, under 1%, of the recorded latency. */
+#define BENCH_PRECISION_BITS 7U
+
+typedef enum {
+  MIX_LEXICAL = 0,
+  MIX_VECTOR = 1,
+  MIX_HYBRID = 2,
+  MIX_FILTER = 3,
+  MIX_RETRIEVE = 4,
+  MIX_INGEST = 5,
+  MIX_PHRASE = 6,
+  MIX_COUNT = 7
+} MIX_KIND;
+
+static const char *const mix_names[MIX_COUNT] = {
+  "lexical", "vector", "hybrid", "filter", "retrieve", "ingest", "phrase"};
+
+typedef struct {
+  size_t documents;
+  size_t segments;
+  size_t vocabulary;
+  size_t document_terms;
+  size_t dimensions;
+  size_t categories;
+  double zipf_exponent;
+  uint64_t seed;
+  double rate;
+  size_t duration_seconds;
+  size_t threads;
+  size_t warmup;
+  size_t mix[MIX_COUNT];
+  const char *output;
+  const char *baseline;
+  const char *retain_index;
+  double tolerance_percent;
+} OPTIONS;
+
+/* Cumulative rank probabilities; rank r is drawn with weight 1 / r^exponent. */
+typedef struct {
+  double *cdf;
+  size_t count;
+} ZIPF;
+
+typedef struct {
+  YAP_V2_LATENCY_HISTOGRAM latency;
+  YAP_V2_LATENCY_HISTOGRAM service;
+  uint64_t requests;
+  uint64_t errors;
+  uint64_t max_microseconds;
+} KIND_STATS;
+
+typedef struct {
+  const OPTIONS *options;
+  const ZIPF *terms;
+  YAP_V2_HTTP_RUNTIME *runtime;
+  const uint64_t *arrivals;
+  const unsigned char *kinds;
+  size_t request_count;
+  size_t next;
+  uint64_t started;
+  KIND_STATS stats[MIX_COUNT];
+} LOAD;
+
+typedef struct {
+  uint64_t index_bytes;
+  double build_ms;
+  double open_ms;
+  double ann_ms;
+  double elapsed_ms;
+  double cpu_user_ms;
+  double cpu_system_ms;
+  uint64_t peak_rss_bytes;
+} RUN_RESULT;
+
+static double elapsed_ms(uint64_t started, uint64_t ended) {
+  return ended > started ? (double)(ended - started) / 1000.0 : 0.0;
+}
+
+static uint64_t mix64(uint64_t value) {
+  value += UINT64_C(0x9e3779b97f4a7c15);
+  value = (value ^ (value >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  value = (value ^ (value >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return value ^ (value >> 31);
+}
+
+static uint64_t next_random(uint64_t *state) {
+  *state += UINT64_C(0x9e3779b97f4a7c15);
+  return mix64(*state);
+}
+
+/* Uniform in [0, 1). */
+static double next_unit(uint64_t *state) {
+  return (double)(next_random(state) >> 11) / 9007199254740992.0;
+}
+
+static int parse_size(const char *value, size_t minimum, size_t maximum, size_t *parsed) {
+  char *end = NULL;
+  unsigned long long number;
+  errno = 0;
+  number = strtoull(value, &end, 10);
+  if (errno != 0 || end == value || *end != '\0' || number < minimum || number > maximum)
+    return -1;
+  *parsed = (size_t)number;
+  return 0;
+}
+
+static int parse_double(const char *value, double minimum, double maximum, double *parsed) {
+  char *end = NULL;
+  double number;
+  errno = 0;
+  number = strtod(value, &end);
+  if (errno != 0 || end == value || *end != '\0' || !(number >= minimum) || number > maximum)
+    return -1;
+  *parsed = number;
+  return 0;
+}
+
+/* "lexical=60,vector=20,ingest=5"; kinds left out get no requests. */
+static int parse_mix(const char *value, size_t mix[MIX_COUNT]) {
+  char buffer[256], *item, *saveptr = NULL;
+  size_t total = 0U, kind;
+  if (strlen(value) >= sizeof(buffer)) return -1;
+  memcpy(buffer, value, strlen(value) + 1U);
+  memset(mix, 0, sizeof(size_t) * MIX_COUNT);
+  for (item = strtok_r(buffer, ",", &saveptr); item != NULL;
+       item = strtok_r(NULL, ",", &saveptr)) {
+    char *equals = strchr(item, '=');
+    if (equals == NULL) return -1;
+    *equals = '\0';
+    for (kind = 0U; kind < MIX_COUNT; kind++)
+      if (strcmp(item, mix_names[kind]) == 0) break;
+    if (kind == MIX_COUNT || parse_size(equals + 1, 0U, 1000000U, &mix[kind]) != 0) return -1;
+    total += mix[kind];
+  }
+  return total > 0U ? 0 : -1;
+}
+
+static int parse_options(int argc, char **argv, OPTIONS *options) {
+  int i;
+  memset(options, 0, sizeof(*options));
+  options->documents = 10000U;
+  options->segments = 4U;
+  options->vocabulary = 20000U;
+  options->document_terms = 64U;
+  options->dimensions = 32U;
+  options->categories = 16U;
+  options->zipf_exponent = 1.0;
+  options->seed = 1U;
+  options->rate = 200.0;
+  options->duration_seconds = 10U;
+  options->threads = 4U;
+  options->warmup = 100U;
+  options->tolerance_percent = 10.0;
+  if (parse_mix("lexical=50,vector=15,hybrid=15,filter=10,retrieve=5,ingest=5",
+                options->mix) != 0)
+    return -1;
+  for (i = 1; i < argc; i += 2) {
+    const char *key = argv[i], *value;
+    if (i + 1 >= argc) return -1;
+    value = argv[i + 1];
+    if (strcmp(key, "--documents") == 0) {
+      if (parse_size(value, 1U, 100000000U, &options->documents) != 0) return -1;
+    } else if (strcmp(key, "--segments") == 0) {
+      if (parse_size(value, 1U, 100000U, &options->segments) != 0) return -1;
+    } else if (strcmp(key, "--vocabulary") == 0) {
+      if (parse_size(value, 1U, 10000000U, &options->vocabulary) != 0) return -1;
+    } else if (strcmp(key, "--document-terms") == 0) {
+      if (parse_size(value, 1U, 512U, &options->document_terms) != 0) return -1;
+    } else if (strcmp(key, "--dimensions") == 0) {
+      if (parse_size(value, 0U, 4096U, &options->dimensions) != 0) return -1;
+    } else if (strcmp(key, "--categories") == 0) {
+      if (parse_size(value, 1U, 100000U, &options->categories) != 0) return -1;
+    } else if (strcmp(key, "--zipf") == 0) {
+      if (parse_double(value, 0.0, 4.0, &options->zipf_exponent) != 0) return -1;
+    } else if (strcmp(key, "--seed") == 0) {
+      size_t seed;
+      if (parse_size(value, 0U, SIZE_MAX, &seed) != 0) return -1;
+      options->seed = (uint64_t)seed;
+    } else if (strcmp(key, "--rate") == 0) {
+      if (parse_double(value, 0.001, 1000000.0, &options->rate) != 0) return -1;
+    } else if (strcmp(key, "--duration-seconds") == 0) {
+      if (parse_size(value, 1U, 86400U, &options->duration_seconds) != 0) return -1;
+    } else if (strcmp(key, "--threads") == 0) {
+      if (parse_size(value, 1U, 1024U, &options->threads) != 0) return -1;
+    } else if (strcmp(key, "--warmup") == 0) {
+      if (parse_size(value, 0U, 1000000U, &options->warmup) != 0) return -1;
+    } else if (strcmp(key, "--mix") == 0) {
+      if (parse_mix(value, options->mix) != 0) return -1;
+    } else if (strcmp(key, "--output") == 0) {
+      options->output = value;
+    } else if (strcmp(key, "--baseline") == 0) {
+      options->baseline = value;
+    } else if (strcmp(key, "--tolerance-percent") == 0) {
+      if (parse_double(value, 0.0, 1000.0, &options->tolerance_percent) != 0) return -1;
+    } else if (strcmp(key, "--retain-index") == 0) {
+      if (value[0] == '\0' || strlen(value) >= PATH_MAX) return -1;
+      options->retain_index = value;
+    } else {
+      return -1;
+    }
+  }
+  if (options->segments > options->documents) return -1;
+  if (options->documents / options->segments > YAP_V2_MAX_SEGMENT_DOCUMENTS) return -1;
+  if (options->dimensions == 0U &&
+      (options->mix[MIX_VECTOR] != 0U || options->mix[MIX_HYBRID] != 0U)) return -1;
+  return options->rate * (double)options->duration_seconds <= (double)BENCH_MAX_REQUESTS ? 0 : -1;
+}
+
+static void usage(FILE *output, const char *program) {
+  fprintf(output,
+          "usage: %s [--documents N] [--segments N] [--vocabulary N] [--document-terms N]\n"
+          "          [--dimensions N] [--categories N] [--zipf S] [--seed N]\n"
+          "          [--rate PER_SECOND] [--duration-seconds N] [--threads N] [--warmup N]\n"
+          "          [--mix lexical=N,vector=N,hybrid=N,filter=N,retrieve=N,ingest=N,phrase=N]\n"
+          "          [--output FILE] [--baseline FILE] [--tolerance-percent P]\n"
+          "          [--retain-index PATH]\n", program);
+}
+
+static int zipf_init(ZIPF *zipf, size_t count, double exponent) {
+  double total = 0.0;
+  size_t i;
+  zipf->count = count;
+  zipf->cdf = malloc(count * sizeof(*zipf->cdf));
+  if (zipf->cdf == NULL) return -1;
+  for (i = 0U; i < count; i++) {
+    total += 1.0 / pow((double)(i + 1U), exponent);
+    zipf->cdf[i] = total;
+  }
+  for (i = 0U; i < count; i++) zipf->cdf[i] /= total;
+  return 0;
+}
+
+static size_t zipf_draw(const ZIPF *zipf, uint64_t *state) {
+  double target = next_unit(state);
+  size_t low = 0U, high = zipf->count - 1U;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2U;
+    if (zipf->cdf[middle] <= target) low = middle + 1U;
+    else high = middle;
+  }
+  return low;
+}
+
+static int appendf(char *buffer, size_t capacity, size_t *used, const char *format, ...) {
+  va_list arguments;
+  int written;
+  if (*used >= capacity) return -1;
+  va_start(arguments, format);
+  written = vsnprintf(buffer + *used, capacity - *used, format, arguments);
+  va_end(arguments);
+  if (written < 0 || (size_t)written >= capacity - *used) return -1;
+  *used += (size_t)written;
+  return 0;
+}
+
+static int append_terms(char *buffer, size_t capacity, size_t *used, const ZIPF *terms,
+                        size_t count, uint64_t *state) {
+  size_t i;
+  for (i = 0U; i < count; i++)
+    if (appendf(buffer, capacity, used, i == 0U ? "w%zu" : " w%zu",
+                zipf_draw(terms, state)) != 0) return -1;
+  return 0;
+}
+
+static float random_component(uint64_t *state) {
+  return (float)(next_unit(state) * 2.0 - 1.0);
+}
+
+static int append_vector(char *buffer, size_t capacity, size_t *used, size_t dimensions,
+                         uint64_t *state) {
+  size_t d;
+  if (appendf(buffer, capacity, used, "[") != 0) return -1;
+  for (d = 0U; d < dimensions; d++)
+    if (appendf(buffer, capacity, used, d == 0U ? "%.4f" : ",%.4f",
+                (double)random_component(state)) != 0) return -1;
+  return appendf(buffer, capacity, used, "]");
+}
+
+static size_t request_capacity(const OPTIONS *options) {
+  return 512U + options->dimensions * 16U + options->document_terms * 12U;
+}
+
+/* The body depends only on the seed, the kind and the ordinal, so a run is reproducible
+ * regardless of which thread sends which request. */
+static int build_request(const OPTIONS *options, const ZIPF *terms, MIX_KIND kind,
+                         const char *id_prefix, size_t ordinal, char *buffer, size_t capacity,
+                         size_t *bytes, YAP_V2_HTTP_OPERATION *operation) {
+  uint64_t state = mix64(options->seed ^ mix64((uint64_t)ordinal * 8U + (uint64_t)kind));
+  size_t used = 0U, query_terms = 1U + (size_t)(next_random(&state) % BENCH_MAX_QUERY_TERMS);
+  *operation = kind == MIX_RETRIEVE ? YAP_V2_HTTP_RETRIEVE :
+               kind == MIX_INGEST ? YAP_V2_HTTP_INGEST : YAP_V2_HTTP_SEARCH;
+  if (kind == MIX_INGEST) {
+    if (appendf(buffer, capacity, &used,
+                "{\"operations\":[{\"operation\":\"upsert\",\"id\":\"%s-%zu\","
+                "\"title\":\"bench\",\"body\":\"", id_prefix, ordinal) != 0 ||
+        append_terms(buffer, capacity, &used, terms, options->document_terms, &state) != 0 ||
+        appendf(buffer, capacity, &used, "\",\"metadata\":{\"category\":\"c%zu\"}",
+                (size_t)(next_random(&state) % options->categories)) != 0)
+      return -1;
+    if (options->dimensions > 0U &&
+        (appendf(buffer, capacity, &used, ",\"vectors\":[") != 0 ||
+         append_vector(buffer, capacity, &used, options->dimensions, &state) != 0 ||
+         appendf(buffer, capacity, &used, "]") != 0))
+      return -1;
+    if (appendf(buffer, capacity, &used, "}]}") != 0) return -1;
+    *bytes = used;
+    return 0;
+  }
+  if (appendf(buffer, capacity, &used, "{\"mode\":\"%s\",\"limit\":10",
+              kind == MIX_VECTOR ? "vector" : kind == MIX_HYBRID ? "hybrid" : "lexical") != 0)
+    return -1;
+  if (kind == MIX_PHRASE && query_terms < 2U) query_terms = 2U;
+  if (kind != MIX_VECTOR &&
+      (appendf(buffer, capacity, &used, ",\"query\":\"") != 0 ||
+       append_terms(buffer, capacity, &used, terms, query_terms, &state) != 0 ||
+       appendf(buffer, capacity, &used, "\"") != 0))
+    return -1;
+  if ((kind == MIX_VECTOR || kind == MIX_HYBRID) &&
+      (appendf(buffer, capacity, &used, ",\"vector\":") != 0 ||
+       append_vector(buffer, capacity, &used, options->dimensions, &state) != 0))
+    return -1;
+  if (kind == MIX_PHRASE && appendf(buffer, capacity, &used, ",\"phrase\":true") != 0)
+    return -1;
+  if (kind == MIX_FILTER &&
+      appendf(buffer, capacity, &used,
+              ",\"filter\":{\"eq\":{\"field\":\"category\",\"value\":\"c%zu\"}}",
+              (size_t)(next_random(&state) % options->categories)) != 0)
+    return -1;
+  if (appendf(buffer, capacity, &used, "}") != 0) return -1;
+  *bytes = used;
+  return 0;
+}
+
+static YAP_V2_BYTES_VIEW bytes_view(const char *value) {
+  YAP_V2_BYTES_VIEW view = {(const unsigned char *)value, strlen(value)};
+  return view;
+}
+
+static int write_config(const char *index_dir, const OPTIONS *options, YAP_V2_CONFIG *config) {
+  char path[PATH_MAX];
+  FILE *file;
+  int written;
+  if (ytest_path_join(path, sizeof(path), index_dir, "config.toml") != 0) return -1;
+  file = fopen(path, "wb");
+  if (file == NULL) return -1;
+  if (options->dimensions > 0U)
+    written = fprintf(file, "format_version=2\n[tokenizer]\nid=\"unicode_nfkc_casefold_v2\"\n"
+                            "[chunking]\nmax_chars=8192\noverlap_chars=0\n"
+                            "[vector]\nenabled=true\nmodel_id=\"bench\"\ndimensions=%zu\n"
+                            "metric=\"cosine\"\n[metadata]\nfilterable_fields=[\"category\"]\n",
+                      options->dimensions);
+  else
+    written = fprintf(file, "format_version=2\n[tokenizer]\nid=\"unicode_nfkc_casefold_v2\"\n"
+                            "[chunking]\nmax_chars=8192\noverlap_chars=0\n"
+                            "[vector]\nenabled=false\n[metadata]\nfilterable_fields=[\"category\"]\n");
+  if (fclose(file) != 0 || written < 0) return -1;
+  return YAP_V2_config_load(path, config, NULL, 0U) == YAP_V2_OK ? 0 : -1;
+}
+
+typedef struct {
+  YAP_V2_DOCUMENT_VIEW *documents;
+  YAP_V2_PASSAGE_VIEW *passages;
+  char *ids;
+  char *metadata;
+  char **bodies;
+  float *vectors;
+  size_t capacity;
+} SEGMENT_BUFFERS;
+
+static void segment_buffers_free(SEGMENT_BUFFERS *buffers) {
+  size_t i;
+  if (buffers->bodies != NULL)
+    for (i = 0U; i < buffers->capacity; i++) free(buffers->bodies[i]);
+  free(buffers->documents); free(buffers->passages); free(buffers->ids);
+  free(buffers->metadata); free(buffers->bodies); free(buffers->vectors);
+  memset(buffers, 0, sizeof(*buffers));
+}
+
+static int segment_buffers_init(SEGMENT_BUFFERS *buffers, size_t capacity, size_t dimensions) {
+  memset(buffers, 0, sizeof(*buffers));
+  buffers->capacity = capacity;
+  buffers->documents = calloc(capacity, sizeof(*buffers->documents));
+  buffers->passages = calloc(capacity, sizeof(*buffers->passages));
+  buffers->ids = calloc(capacity, 64U);
+  buffers->metadata = calloc(capacity, 64U);
+  buffers->bodies = calloc(capacity, sizeof(*buffers->bodies));
+  buffers->vectors = dimensions > 0U ? calloc(capacity * dimensions, sizeof(float)) : NULL;
+  if (buffers->documents == NULL || buffers->passages == NULL || buffers->ids == NULL ||
+      buffers->metadata == NULL || buffers->bodies == NULL ||
+      (dimensions > 0U && buffers->vectors == NULL)) {
+    segment_buffers_free(buffers);
+    return -1;
+  }
+  return 0;
+}
+
+static int prepare_segment(const OPTIONS *options, const ZIPF *terms, size_t first,
+                           size_t count, SEGMENT_BUFFERS *buffers) {
+  size_t i, d, capacity = options->document_terms * 12U + 1U;
+  memset(buffers->documents, 0, sizeof(*buffers->documents) * count);
+  memset(buffers->passages, 0, sizeof(*buffers->passages) * count);
+  for (i = 0U; i < count; i++) {
+    uint64_t state = mix64(options->seed ^ UINT64_C(0x5bd1e995) ^ (uint64_t)(first + i));
+    char *id = buffers->ids + i * 64U, *metadata = buffers->metadata + i * 64U;
+    size_t used = 0U;
+    free(buffers->bodies[i]);
+    buffers->bodies[i] = malloc(capacity);
+    if (buffers->bodies[i] == NULL ||
+        append_terms(buffers->bodies[i], capacity, &used, terms, options->document_terms,
+                     &state) != 0 ||
+        snprintf(id, 64U, "doc-%zu", first + i) < 0 ||
+        snprintf(metadata, 64U, "{\"category\":\"c%zu\"}",
+                 (size_t)(next_random(&state) % options->categories)) < 0)
+      return -1;
+    buffers->documents[i].id = bytes_view(id);
+    buffers->documents[i].title = bytes_view("bench");
+    buffers->documents[i].body = bytes_view(buffers->bodies[i]);
+    buffers->documents[i].metadata_json = bytes_view(metadata);
+    buffers->passages[i].id = buffers->documents[i].id;
+    buffers->passages[i].parent_document_id = buffers->documents[i].id;
+    buffers->passages[i].text = buffers->documents[i].body;
+    buffers->passages[i].end_char = used;
+    for (d = 0U; d < options->dimensions; d++)
+      buffers->vectors[i * options->dimensions + d] = random_component(&state);
+  }
+  return 0;
+}
+
+static int create_index(const char *index_dir, const OPTIONS *options, const ZIPF *terms) {
+  YAP_V2_CONFIG config;
+  YAP_V2_MANIFEST manifest;
+  YAP_V2_COMPONENT_DESCRIPTOR lexical[3], vectors, metadata;
+  YAP_V2_SEGMENT_DESCRIPTOR descriptor;
+  YAP_EMBEDDING_RESULT embeddings;
+  SEGMENT_BUFFERS buffers;
+  char segments_dir[PATH_MAX], segment_dir[PATH_MAX], path[PATH_MAX], segment_id[64];
+  size_t segment, first = 0U, per_segment = options->documents / options->segments;
+  int status = -1;
+  if (write_config(index_dir, options, &config) != 0 ||
+      ytest_path_join(segments_dir, sizeof(segments_dir), index_dir, "segments") != 0 ||
+      ytest_mkdir_p(segments_dir, 0700) != 0 ||
+      segment_buffers_init(&buffers, per_segment + 1U, options->dimensions) != 0)
+    return -1;
+  YAP_V2_manifest_init(&manifest);
+  manifest.generation = 1U;
+  if (YAP_V2_config_fingerprint(&config, manifest.config_fingerprint) != YAP_V2_OK) goto done;
+  for (segment = 0U; segment < options->segments; segment++) {
+    size_t count = per_segment + (segment < options->documents % options->segments ? 1U : 0U);
+    if (prepare_segment(options, terms, first, count, &buffers) != 0 ||
+        snprintf(segment_id, sizeof(segment_id), "bench-%020zu", segment) < 0 ||
+        ytest_path_join(segment_dir, sizeof(segment_dir), segments_dir, segment_id) != 0 ||
+        ytest_mkdir_p(segment_dir, 0700) != 0 ||
+        ytest_path_join(path, sizeof(path), segment_dir, "documents.yap2") != 0 ||
+        YAP_V2_segment_write(path, segment_id, 1U, buffers.documents, count,
+                             buffers.passages, count, &descriptor) != YAP_V2_OK ||
+        YAP_V2_lexical_write(segment_dir, 1U, buffers.documents, count,
+                             buffers.passages, count, lexical) != YAP_V2_OK ||
+        YAP_V2_segment_descriptor_add_component(&descriptor, &lexical[0]) != YAP_V2_OK ||
+        YAP_V2_segment_descriptor_add_component(&descriptor, &lexical[1]) != YAP_V2_OK ||
+        YAP_V2_segment_descriptor_add_component(&descriptor, &lexical[2]) != YAP_V2_OK ||
+        ytest_path_join(path, sizeof(path), segment_dir, "metadata.yap2") != 0 ||
+        YAP_V2_metadata_write(path, 1U, &config, buffers.documents, count,
+                              &metadata) != YAP_V2_OK ||
+        YAP_V2_segment_descriptor_add_component(&descriptor, &metadata) != YAP_V2_OK)
+      goto done;
+    if (options->dimensions > 0U) {
+      embeddings.values = buffers.vectors;
+      embeddings.input_count = count;
+      embeddings.dimensions = options->dimensions;
+      if (ytest_path_join(path, sizeof(path), segment_dir, "vectors.yap2") != 0 ||
+          YAP_V2_vectors_write(path, 1U, &config, buffers.passages, count, &embeddings,
+                               &vectors) != YAP_V2_OK ||
+          YAP_V2_segment_descriptor_add_component(&descriptor, &vectors) != YAP_V2_OK)
+        goto done;
+    }
+    if (YAP_V2_manifest_add_segment(&manifest, &descriptor) != YAP_V2_OK) goto done;
+    first += count;
+  }
+  if (ytest_path_join(path, sizeof(path), index_dir, "manifest.yap2") != 0 ||
+      YAP_V2_manifest_save_atomic(path, &manifest) != YAP_V2_OK)
+    goto done;
+  status = 0;
+done:
+  YAP_V2_manifest_free(&manifest);
+  segment_buffers_free(&buffers);
+  return status;
+}
+
+static int directory_bytes(const char *path, uint64_t *total) {
+  struct stat metadata;
+  DIR *directory;
+  struct dirent *entry;
+  if (lstat(path, &metadata) != 0) return -1;
+  if (!S_ISDIR(metadata.st_mode)) {
+    if (metadata.st_size < 0 || *total > UINT64_MAX - (uint64_t)metadata.st_size) return -1;
+    *total += (uint64_t)metadata.st_size;
+    return 0;
+  }
+  directory = opendir(path);
+  if (directory == NULL) return -1;
+  while ((entry = readdir(directory)) != NULL) {
+    char child[PATH_MAX];
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+    if (ytest_path_join(child, sizeof(child), path, entry->d_name) != 0 ||
+        directory_bytes(child, total) != 0) {
+      (void)closedir(directory);
+      return -1;
+    }
+  }
+  return closedir(directory) == 0 ? 0 : -1;
+}
+
+static void atomic_max(uint64_t *target, uint64_t value) {
+  uint64_t current = __atomic_load_n(target, __ATOMIC_RELAXED);
+  while (value > current &&
+         !__atomic_compare_exchange_n(target, &current, value, 1, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+  }
+}
+
+static void sleep_until(uint64_t target) {
+  for (;;) {
+    uint64_t now = YAP_V2_monotonic_microseconds();
+    struct timespec delay;
+    if (now >= target) return;
+    delay.tv_sec = (time_t)((target - now) / 1000000U);
+    delay.tv_nsec = (long)((target - now) % 1000000U) * 1000L;
+    (void)nanosleep(&delay, NULL);
+  }
+}
+
+/* Open loop: each request has an arrival time fixed before the run, and latency is taken
+ * from that time, so a stalled server is charged for the requests queued behind it
+ * instead of silently slowing the client down. */
+static void *run_worker(void *opaque) {
+  LOAD *load = opaque;
+  size_t capacity = request_capacity(load->options);
+  char *body = malloc(capacity);
+  if (body == NULL) return (void *)1;
+  for (;;) {
+    size_t index = __atomic_fetch_add(&load->next, 1U, __ATOMIC_RELAXED), body_bytes = 0U;
+    size_t response_bytes = 0U;
+    MIX_KIND kind;
+    YAP_V2_HTTP_OPERATION operation;
+    KIND_STATS *stats;
+    uint64_t intended, started, ended;
+    char *response = NULL;
+    int http_status = 0, result;
+    if (index >= load->request_count) break;
+    kind = (MIX_KIND)load->kinds[index];
+    stats = &load->stats[kind];
+    if (build_request(load->options, load->terms, kind, "bench-ingest", index, body, capacity,
+                      &body_bytes, &operation) != 0) {
+      __atomic_fetch_add(&stats->errors, 1U, __ATOMIC_RELAXED);
+      continue;
+    }
+    intended = load->started + load->arrivals[index];
+    sleep_until(intended);
+    started = YAP_V2_monotonic_microseconds();
+    result = YAP_V2_http_runtime_execute(load->runtime, operation, (const unsigned char *)body,
+                                         body_bytes, &http_status, &response, &response_bytes);
+    ended = YAP_V2_monotonic_microseconds();
+    free(response);
+    __atomic_fetch_add(&stats->requests, 1U, __ATOMIC_RELAXED);
+    if (result != 0 || http_status != 200)
+      __atomic_fetch_add(&stats->errors, 1U, __ATOMIC_RELAXED);
+    YAP_V2_latency_histogram_record(&stats->latency, ended - intended);
+    YAP_V2_latency_histogram_record(&stats->service, ended - started);
+    atomic_max(&stats->max_microseconds, ended - intended);
+  }
+  free(body);
+  return NULL;
+}
+
+static int warm_up(const OPTIONS *options, const ZIPF *terms, YAP_V2_HTTP_RUNTIME *runtime) {
+  size_t capacity = request_capacity(options), i, kind = 0U;
+  char *body = malloc(capacity);
+  if (body == NULL) return -1;
+  for (i = 0U; i < options->warmup; i++) {
+    size_t body_bytes = 0U, response_bytes = 0U;
+    YAP_V2_HTTP_OPERATION operation;
+    char *response = NULL;
+    int http_status = 0;
+    while (options->mix[kind % MIX_COUNT] == 0U) kind++;
+    if (build_request(options, terms, (MIX_KIND)(kind % MIX_COUNT), "bench-warmup", i, body,
+                      capacity, &body_bytes, &operation) != 0 ||
+        YAP_V2_http_runtime_execute(runtime, operation, (const unsigned char *)body, body_bytes,
+                                    &http_status, &response, &response_bytes) != 0 ||
+        http_status != 200) {
+      fprintf(stderr, "warmup %s request failed with status %d\n",
+              mix_names[kind % MIX_COUNT], http_status);
+      free(response);
+      free(body);
+      return -1;
+    }
+    free(response);
+    kind++;
+  }
+  free(body);
+  return 0;
+}
+
+static int schedule(const OPTIONS *options, LOAD *load, uint64_t **arrivals,
+                    unsigned char **kinds) {
+  uint64_t state = mix64(options->seed ^ UINT64_C(0xa0761d6478bd642f));
+  size_t i, kind, total = 0U;
+  double at = 0.0;
+  load->request_count = (size_t)(options->rate * (double)options->duration_seconds);
+  if (load->request_count == 0U) return -1;
+  *arrivals = malloc(load->request_count * sizeof(**arrivals));
+  *kinds = malloc(load->request_count);
+  if (*arrivals == NULL || *kinds == NULL) return -1;
+  for (kind = 0U; kind < MIX_COUNT; kind++) total += options->mix[kind];
+  for (i = 0U; i < load->request_count; i++) {
+    size_t pick = (size_t)(next_random(&state) % total);
+    /* Poisson arrivals: exponential gaps with mean 1 / rate. */
+    at += -log(1.0 - next_unit(&state)) * 1000000.0 / options->rate;
+    (*arrivals)[i] = (uint64_t)at;
+    for (kind = 0U; pick >= options->mix[kind]; kind++) pick -= options->mix[kind];
+    (*kinds)[i] = (unsigned char)kind;
+  }
+  load->arrivals = *arrivals;
+  load->kinds = *kinds;
+  return 0;
+}
+
+static double cpu_ms(const struct timeval *value) {
+  return (double)value->tv_sec * 1000.0 + (double)value->tv_usec / 1000.0;
+}
+
+static uint64_t peak_rss_bytes(const struct rusage *usage) {
+#ifdef __APPLE__
+  return (uint64_t)usage->ru_maxrss;
+#else
+  return (uint64_t)usage->ru_maxrss * 1024U;
+#endif
+}
+
+static int run_load(const OPTIONS *options, const ZIPF *terms, YAP_V2_HTTP_RUNTIME *runtime,
+                    LOAD *load, RUN_RESULT *result) {
+  pthread_t *threads = NULL;
+  uint64_t *arrivals = NULL, ended;
+  unsigned char *kinds = NULL;
+  struct rusage before, after;
+  size_t i, started_threads = 0U;
+  int status = -1;
+  load->options = options;
+  load->terms = terms;
+  load->runtime = runtime;
+  threads = calloc(options->threads, sizeof(*threads));
+  if (threads == NULL || schedule(options, load, &arrivals, &kinds) != 0 ||
+      getrusage(RUSAGE_SELF, &before) != 0)
+    goto done;
+  load->started = YAP_V2_monotonic_microseconds() + 10000U;
+  for (i = 0U; i < options->threads; i++) {
+    if (pthread_create(&threads[i], NULL, run_worker, load) != 0) break;
+    started_threads++;
+  }
+  status = started_threads == options->threads ? 0 : -1;
+  if (status != 0) __atomic_store_n(&load->next, load->request_count, __ATOMIC_RELAXED);
+  for (i = 0U; i < started_threads; i++) {
+    void *worker_status = NULL;
+    if (pthread_join(threads[i], &worker_status) != 0 || worker_status != NULL) status = -1;
+  }
+  ended = YAP_V2_monotonic_microseconds();
+  if (getrusage(RUSAGE_SELF, &after) != 0) status = -1;
+  result->elapsed_ms = elapsed_ms(load->started, ended);
+  result->cpu_user_ms = cpu_ms(&after.ru_utime) - cpu_ms(&before.ru_utime);
+  result->cpu_system_ms = cpu_ms(&after.ru_stime) - cpu_ms(&before.ru_stime);
+  result->peak_rss_bytes = peak_rss_bytes(&after);
+done:
+  free(threads);
+  free(arrivals);
+  free(kinds);
+  load->arrivals = NULL;
+  load->kinds = NULL;
+  return status;
+}
+
+static int add_ms(yyjson_mut_doc *doc, yyjson_mut_val *object, const char *key,
+                  uint64_t microseconds) {
+  return yyjson_mut_obj_add_real(doc, object, key, (double)microseconds / 1000.0);
+}
+
+static yyjson_mut_val *kind_json(yyjson_mut_doc *doc, const KIND_STATS *stats,
+                                 double elapsed) {
+  static const char *const keys[YAP_V2_LATENCY_QUANTILE_COUNT] = {
+    "p50_ms", "p90_ms", "p99_ms", "p999_ms"};
+  static const char *const service_keys[YAP_V2_LATENCY_QUANTILE_COUNT] = {
+    "service_p50_ms", "service_p90_ms", "service_p99_ms", "service_p999_ms"};
+  YAP_V2_LATENCY_SUMMARY latency, service;
+  yyjson_mut_val *object = yyjson_mut_obj(doc);
+  size_t q;
+  if (object == NULL) return NULL;
+  YAP_V2_latency_histogram_summary(&stats->latency, &latency);
+  YAP_V2_latency_histogram_summary(&stats->service, &service);
+  if (!yyjson_mut_obj_add_uint(doc, object, "requests", stats->requests) ||
+      !yyjson_mut_obj_add_uint(doc, object, "errors", stats->errors) ||
+      !yyjson_mut_obj_add_real(doc, object, "throughput_rps",
+                               elapsed > 0.0 ? (double)stats->requests * 1000.0 / elapsed : 0.0) ||
+      !yyjson_mut_obj_add_real(doc, object, "mean_ms",
+                               latency.count > 0U ?
+                               (double)latency.microseconds / 1000.0 / (double)latency.count :
+                               0.0) ||
+      !add_ms(doc, object, "max_ms", stats->max_microseconds))
+    return NULL;
+  for (q = 0U; q < YAP_V2_LATENCY_QUANTILE_COUNT; q++)
+    if (!add_ms(doc, object, keys[q], latency.quantiles[q]) ||
+        !add_ms(doc, object, service_keys[q], service.quantiles[q]))
+      return NULL;
+  return object;
+}
+
+static yyjson_mut_val *report_json(yyjson_mut_doc *doc, const OPTIONS *options,
+                                   const LOAD *load, const RUN_RESULT *result) {
+  yyjson_mut_val *root = yyjson_mut_obj(doc), *corpus = yyjson_mut_obj(doc);
+  yyjson_mut_val *run = yyjson_mut_obj(doc), *resources = yyjson_mut_obj(doc);
+  yyjson_mut_val *mix = yyjson_mut_obj(doc), *operations = yyjson_mut_obj(doc);
+  uint64_t requests = 0U;
+  size_t kind;
+  if (root == NULL || corpus == NULL || run == NULL || resources == NULL || mix == NULL ||
+      operations == NULL)
+    return NULL;
+  for (kind = 0U; kind < MIX_COUNT; kind++) {
+    requests += load->stats[kind].requests;
+    if (!yyjson_mut_obj_add_uint(doc, mix, mix_names[kind], options->mix[kind])) return NULL;
+    if (options->mix[kind] != 0U) {
+      yyjson_mut_val *stats = kind_json(doc, &load->stats[kind], result->elapsed_ms);
+      if (stats == NULL || !yyjson_mut_obj_add_val(doc, operations, mix_names[kind], stats))
+        return NULL;
+    }
+  }
+  if (!yyjson_mut_obj_add_uint(doc, root, "format_version", BENCH_FORMAT_VERSION) ||
+      !yyjson_mut_obj_add_uint(doc, corpus, "seed", options->seed) ||
+      !yyjson_mut_obj_add_uint(doc, corpus, "documents", options->documents) ||
+      !yyjson_mut_obj_add_uint(doc, corpus, "segments", options->segments) ||
+      !yyjson_mut_obj_add_uint(doc, corpus, "vocabulary", options->vocabulary) ||
+      !yyjson_mut_obj_add_real(doc, corpus, "zipf_exponent", options->zipf_exponent) ||
+      !yyjson_mut_obj_add_uint(doc, corpus, "document_terms", options->document_terms) ||
+      !yyjson_mut_obj_add_uint(doc, corpus, "dimensions", options->dimensions) ||
+      !yyjson_mut_obj_add_uint(doc, corpus, "categories", options->categories) ||
+      !yyjson_mut_obj_add_uint(doc, corpus, "index_bytes", result->index_bytes) ||
+      !yyjson_mut_obj_add_real(doc, corpus, "build_ms", result->build_ms) ||
+      !yyjson_mut_obj_add_real(doc, corpus, "open_ms", result->open_ms) ||
+      !yyjson_mut_obj_add_real(doc, corpus, "ann_build_ms", result->ann_ms) ||
+      !yyjson_mut_obj_add_real(doc, run, "rate", options->rate) ||
+      !yyjson_mut_obj_add_uint(doc, run, "duration_seconds", options->duration_seconds) ||
+      !yyjson_mut_obj_add_uint(doc, run, "threads", options->threads) ||
+      !yyjson_mut_obj_add_uint(doc, run, "warmup", options->warmup) ||
+      !yyjson_mut_obj_add_val(doc, run, "mix", mix) ||
+      !yyjson_mut_obj_add_uint(doc, run, "requests", requests) ||
+      !yyjson_mut_obj_add_real(doc, run, "elapsed_ms", result->elapsed_ms) ||
+      !yyjson_mut_obj_add_real(doc, run, "throughput_rps",
+                               result->elapsed_ms > 0.0 ?
+                               (double)requests * 1000.0 / result->elapsed_ms : 0.0) ||
+      !yyjson_mut_obj_add_real(doc, resources, "cpu_user_ms", result->cpu_user_ms) ||
+      !yyjson_mut_obj_add_real(doc, resources, "cpu_system_ms", result->cpu_system_ms) ||
+      !yyjson_mut_obj_add_real(doc, resources, "cpu_ms_per_request",
+                               requests > 0U ? (result->cpu_user_ms + result->cpu_system_ms) /
+                                               (double)requests : 0.0) ||
+      !yyjson_mut_obj_add_uint(doc, resources, "peak_rss_bytes", result->peak_rss_bytes) ||
+      !yyjson_mut_obj_add_val(doc, root, "corpus", corpus) ||
+      !yyjson_mut_obj_add_val(doc, root, "run", run) ||
+      !yyjson_mut_obj_add_val(doc, root, "resources", resources) ||
+      !yyjson_mut_obj_add_val(doc, root, "operations", operations))
+    return NULL;
+  return root;
+}
+
+static double json_number(yyjson_val *object, const char *section, const char *key) {
+  yyjson_val *value = yyjson_obj_get(yyjson_obj_get(object, section), key);
+  return yyjson_is_num(value) ? yyjson_get_num(value) : -1.0;
+}
+
+static int add_regression(yyjson_mut_doc *doc, yyjson_mut_val *regressions, const char *name,
+                          double baseline, double current, size_t *count) {
+  yyjson_mut_val *entry = yyjson_mut_obj(doc);
+  (*count)++;
+  fprintf(stderr, "regression %s: baseline=%.3f current=%.3f\n", name, baseline, current);
+  return entry != NULL && yyjson_mut_obj_add_strcpy(doc, entry, "metric", name) &&
+         yyjson_mut_obj_add_real(doc, entry, "baseline", baseline) &&
+         yyjson_mut_obj_add_real(doc, entry, "current", current) &&
+         yyjson_mut_arr_append(regressions, entry) ? 0 : -1;
+}
+
+/* Latency and CPU may grow and throughput may shrink by tolerance_percent; anything beyond
+ * is a regression. Metrics the baseline lacks are not compared. */
+static int compare_metric(yyjson_mut_doc *doc, yyjson_mut_val *regressions, const char *name,
+                          double baseline, double current, int higher_is_worse,
+                          double tolerance, size_t *count) {
+  int regressed;
+  if (baseline <= 0.0 || current < 0.0) return 0;
+  regressed = higher_is_worse ? current > baseline * (1.0 + tolerance) :
+                                current < baseline * (1.0 - tolerance);
+  return regressed ? add_regression(doc, regressions, name, baseline, current, count) : 0;
+}
+
+static int compare_baseline(yyjson_mut_doc *doc, yyjson_mut_val *report, const OPTIONS *options,
+                            int *passed) {
+  static const char *const latency_keys[] = {"p50_ms", "p99_ms", "service_p99_ms", NULL};
+  static const char *const corpus_keys[] = {"seed", "documents", "segments", "vocabulary",
+                                            "document_terms", "dimensions", NULL};
+  yyjson_doc *baseline_doc, *current_doc;
+  yyjson_val *baseline, *current, *operations;
+  yyjson_mut_val *comparison = yyjson_mut_obj(doc), *regressions = yyjson_mut_arr(doc);
+  yyjson_read_err error;
+  double tolerance = options->tolerance_percent / 100.0;
+  size_t count = 0U, i;
+  int comparable = 1, status = -1;
+  char name[96];
+  baseline_doc = yyjson_read_file(options->baseline, 0U, NULL, &error);
+  if (baseline_doc == NULL) {
+    fprintf(stderr, "cannot read baseline %s: %s\n", options->baseline, error.msg);
+    return -1;
+  }
+  current_doc = yyjson_mut_val_imut_copy(report, NULL);
+  baseline = yyjson_doc_get_root(baseline_doc);
+  current = yyjson_doc_get_root(current_doc);
+  if (current_doc == NULL || comparison == NULL || regressions == NULL ||
+      !yyjson_is_obj(baseline) ||
+      yyjson_get_uint(yyjson_obj_get(baseline, "format_version")) != BENCH_FORMAT_VERSION)
+    goto done;
+  for (i = 0U; corpus_keys[i] != NULL; i++)
+    if (json_number(baseline, "corpus", corpus_keys[i]) !=
+        json_number(current, "corpus", corpus_keys[i])) {
+      fprintf(stderr, "baseline corpus differs in %s\n", corpus_keys[i]);
+      comparable = 0;
+    }
+  if (json_number(baseline, "run", "rate") != json_number(current, "run", "rate")) {
+    fprintf(stderr, "baseline rate differs\n");
+    comparable = 0;
+  }
+  operations = yyjson_obj_get(current, "operations");
+  for (i = 0U; i < MIX_COUNT; i++) {
+    yyjson_val *base = yyjson_obj_get(yyjson_obj_get(baseline, "operations"), mix_names[i]);
+    yyjson_val *now = yyjson_obj_get(operations, mix_names[i]);
+    size_t k;
+    if (!yyjson_is_obj(base) || !yyjson_is_obj(now)) continue;
+    for (k = 0U; latency_keys[k] != NULL; k++) {
+      yyjson_val *b = yyjson_obj_get(base, latency_keys[k]), *c = yyjson_obj_get(now, latency_keys[k]);
+      if (snprintf(name, sizeof(name), "%s.%s", mix_names[i], latency_keys[k]) < 0 ||
+          compare_metric(doc, regressions, name, yyjson_is_num(b) ? yyjson_get_num(b) : -1.0,
+                         yyjson_is_num(c) ? yyjson_get_num(c) : -1.0, 1, tolerance,
+                         &count) != 0)
+        goto done;
+    }
+    if (snprintf(name, sizeof(name), "%s.throughput_rps", mix_names[i]) < 0 ||
+        compare_metric(doc, regressions, name,
+                       yyjson_get_num(yyjson_obj_get(base, "throughput_rps")),
+                       yyjson_get_num(yyjson_obj_get(now, "throughput_rps")), 0, tolerance,
+                       &count) != 0)
+      goto done;
+    /* Errors have no tolerance: any request that failed where the baseline did not. */
+    if (yyjson_get_uint(yyjson_obj_get(now, "errors")) >
+        yyjson_get_uint(yyjson_obj_get(base, "errors")) &&
+        (snprintf(name, sizeof(name), "%s.errors", mix_names[i]) < 0 ||
+         add_regression(doc, regressions, name,
+                        (double)yyjson_get_uint(yyjson_obj_get(base, "errors")),
+                        (double)yyjson_get_uint(yyjson_obj_get(now, "errors")), &count) != 0))
+      goto done;
+  }
+  if (compare_metric(doc, regressions, "resources.cpu_ms_per_request",
+                     json_number(baseline, "resources", "cpu_ms_per_request"),
+                     json_number(current, "resources", "cpu_ms_per_request"), 1, tolerance,
+                     &count) != 0 ||
+      compare_metric(doc, regressions, "resources.peak_rss_bytes",
+                     json_number(baseline, "resources", "peak_rss_bytes"),
+                     json_number(current, "resources", "peak_rss_bytes"), 1, tolerance,
+                     &count) != 0)
+    goto done;
+  *passed = count == 0U;
+  if (!yyjson_mut_obj_add_strcpy(doc, comparison, "baseline", options->baseline) ||
+      !yyjson_mut_obj_add_real(doc, comparison, "tolerance_percent",
+                               options->tolerance_percent) ||
+      !yyjson_mut_obj_add_bool(doc, comparison, "comparable", comparable) ||
+      !yyjson_mut_obj_add_val(doc, comparison, "regressions", regressions) ||
+      !yyjson_mut_obj_add_bool(doc, comparison, "passed", *passed) ||
+      !yyjson_mut_obj_add_val(doc, report, "comparison", comparison))
+    goto done;
+  status = 0;
+done:
+  if (status != 0) fprintf(stderr, "cannot compare with baseline %s\n", options->baseline);
+  yyjson_doc_free(current_doc);
+  yyjson_doc_free(baseline_doc);
+  return status;
+}
+
+static int write_report(yyjson_mut_doc *doc, const char *path) {
+  size_t bytes = 0U;
+  char *json = yyjson_mut_write(doc, YYJSON_WRITE_PRETTY, &bytes);
+  FILE *output;
+  int status;
+  if (json == NULL) return -1;
+  output = path == NULL ? stdout : fopen(path, "wb");
+  if (output == NULL) {
+    free(json);
+    return -1;
+  }
+  status = fwrite(json, 1U, bytes, output) == bytes && fputc('\n', output) != EOF ? 0 : -1;
+  if (path != NULL && fclose(output) != 0) status = -1;
+  free(json);
+  return status;
+}
+
+int main(int argc, char **argv) {
+  OPTIONS options;
+  ZIPF terms = {NULL, 0U};
+  LOAD load;
+  RUN_RESULT result;
+  ytest_env_t env;
+  YAP_V2_HTTP_RUNTIME runtime;
+  yyjson_mut_doc *doc = NULL;
+  yyjson_mut_val *report;
+  const char *index_dir;
+  uint64_t build_started, build_ended, opened, ann_built;
+  size_t kind;
+  int temporary_index = 0, runtime_open = 0, passed = 1, status = 1;
+  if (argc == 2 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0)) {
+    usage(stdout, argv[0]);
+    return 0;
+  }
+  if (parse_options(argc, argv, &options) != 0) {
+    usage(stderr, argv[0]);
+    return 2;
+  }
+  memset(&load, 0, sizeof(load));
+  memset(&result, 0, sizeof(result));
+  for (kind = 0U; kind < MIX_COUNT; kind++)
+    if (YAP_V2_latency_histogram_init(&load.stats[kind].latency,
+                                      BENCH_PRECISION_BITS) != YAP_V2_OK ||
+        YAP_V2_latency_histogram_init(&load.stats[kind].service,
+                                      BENCH_PRECISION_BITS) != YAP_V2_OK)
+      goto done;
+  if (zipf_init(&terms, options.vocabulary, options.zipf_exponent) != 0) goto done;
+  if (options.retain_index != NULL) {
+    if (mkdir(options.retain_index, 0700) != 0) {
+      fprintf(stderr, "cannot create retained index directory: %s\n", strerror(errno));
+      goto done;
+    }
+    index_dir = options.retain_index;
+  } else {
+    if (ytest_env_init(&env) != 0) goto done;
+    temporary_index = 1;
+    index_dir = env.tmp_root;
+  }
+  fprintf(stderr, "index_dir=%s retained=%s\n", index_dir,
+          options.retain_index == NULL ? "false" : "true");
+  build_started = YAP_V2_monotonic_microseconds();
+  if (create_index(index_dir, &options, &terms) != 0) {
+    fprintf(stderr, "cannot generate the corpus\n");
+    goto done;
+  }
+  build_ended = YAP_V2_monotonic_microseconds();
+  if (directory_bytes(index_dir, &result.index_bytes) != 0) goto done;
+  YAP_V2_http_runtime_init(&runtime);
+  if (YAP_V2_http_runtime_open(&runtime, index_dir) != YAP_V2_OK) {
+    fprintf(stderr, "cannot open the generated index\n");
+    goto done;
+  }
+  runtime_open = 1;
+  opened = YAP_V2_monotonic_microseconds();
+  if (options.dimensions > 0U && YAP_V2_http_runtime_maintain_ann(&runtime) != YAP_V2_OK)
+    goto done;
+  ann_built = YAP_V2_monotonic_microseconds();
+  result.build_ms = elapsed_ms(build_started, build_ended);
+  result.open_ms = elapsed_ms(build_ended, opened);
+  result.ann_ms = elapsed_ms(opened, ann_built);
+  fprintf(stderr, "index_bytes=%llu build_ms=%.0f open_ms=%.0f ann_build_ms=%.0f\n",
+          (unsigned long long)result.index_bytes, result.build_ms, result.open_ms,
+          result.ann_ms);
+  if (warm_up(&options, &terms, &runtime) != 0 ||
+      run_load(&options, &terms, &runtime, &load, &result) != 0)
+    goto done;
+  doc = yyjson_mut_doc_new(NULL);
+  report = doc == NULL ? NULL : report_json(doc, &options, &load, &result);
+  if (report == NULL) goto done;
+  yyjson_mut_doc_set_root(doc, report);
+  if (options.baseline != NULL && compare_baseline(doc, report, &options, &passed) != 0)
+    goto done;
+  if (write_report(doc, options.output) != 0) goto done;
+  status = passed ? 0 : 1;
+done:
+  yyjson_mut_doc_free(doc);
+  if (runtime_open) YAP_V2_http_runtime_close(&runtime);
+  if (temporary_index) ytest_env_destroy(&env);
+  for (kind = 0U; kind < MIX_COUNT; kind++) {
+    YAP_V2_latency_histogram_free(&load.stats[kind].latency);
+    YAP_V2_latency_histogram_free(&load.stats[kind].service);
+  }
+  free(terms.cdf);
+  return status;
+}
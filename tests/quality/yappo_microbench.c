@@ -0,0 +1,546 @@
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "test_env.h"
+#include "test_fs.h"
+#include "common/yappo_unicode.h"
+#include "components/yappo_lexical_v2.h"
+#include "components/yappo_metadata_v2.h"
+#include "components/yappo_vector.h"
+#include "config/yappo_config_v2.h"
+#include "query/yappo_filter_v2.h"
+#include "query/yappo_hybrid.h"
+#include "query/yappo_lexical_search_v2.h"
+#include "query/yappo_snippet_v2.h"
+
+#define MAX_SIZES 16U
+#define RRF_TOP_K 10U
+#define SNIPPET_GRAPHEMES 160U
+#define PHRASE_DOCUMENTS 64U
+
+typedef struct {
+  const char *kernel;
+  size_t sizes[MAX_SIZES];
+  size_t size_count;
+  size_t warmup;
+  size_t repetitions;
+  uint64_t min_sample_ns;
+} OPTIONS;
+
+/* Everything a kernel touches is built by its setup outside the timed loop. */
+typedef struct {
+  ytest_env_t env;
+  YAP_V2_CONFIG config;
+  char *text;
+  size_t text_bytes;
+  YAP_V2_LEXICAL_SEGMENT segment;
+  YAP_V2_TERM_ENTRY term;
+  YAP_V2_LEXICAL_HIT *hits;
+  YAP_V2_METADATA_INDEX metadata;
+  YAP_V2_FILTER filter;
+  float *vectors;
+  YAP_HYBRID_CANDIDATE *candidates;
+  char *candidate_ids;
+  YAP_HYBRID_HIT fused[RRF_TOP_K];
+  char *output;
+  size_t size;
+  int segment_open;
+  uint64_t sink;
+} CONTEXT;
+
+typedef struct {
+  const char *name;
+  const char *unit;
+  int byte_sized;
+  size_t default_sizes[3];
+  int (*setup)(CONTEXT *context, size_t size);
+  int (*run)(CONTEXT *context);
+} KERNEL;
+
+static const char *const words[] = {
+  "search", "index", "Segment", "query", "ranking", "passage", "vector", "the", "of",
+  "BM25", "2026", "latency", "検索", "索引", "は", "を", "形態素", "東京", "ベクトル",
+  "セグメント", "更新します", "文書", "です", "。", "ｶﾀｶﾅ", "ＡＢＣ"};
+
+static YAP_V2_BYTES_VIEW bytes_view(const char *value, size_t length) {
+  YAP_V2_BYTES_VIEW view = {(const unsigned char *)value, length};
+  return view;
+}
+
+static uint64_t next_random(uint64_t *state) {
+  uint64_t value = *state;
+  value ^= value >> 12U;
+  value ^= value << 25U;
+  value ^= value >> 27U;
+  *state = value;
+  return value * UINT64_C(2685821657736338717);
+}
+
+static uint64_t now_ns(void) {
+  struct timespec value;
+  if (clock_gettime(CLOCK_MONOTONIC, &value) != 0) return 0U;
+  return (uint64_t)value.tv_sec * UINT64_C(1000000000) + (uint64_t)value.tv_nsec;
+}
+
+static int compare_double(const void *left, const void *right) {
+  double a = *(const double *)left, b = *(const double *)right;
+  return a < b ? -1 : a > b;
+}
+
+/* Mixed English and Japanese words cut at a word boundary just below bytes. */
+static int make_text(CONTEXT *context, size_t bytes) {
+  uint64_t state = UINT64_C(0x9e3779b97f4a7c15);
+  size_t used = 0U;
+  context->text = malloc(bytes + 1U);
+  if (context->text == NULL) return -1;
+  for (;;) {
+    const char *word = words[next_random(&state) % (sizeof(words) / sizeof(words[0]))];
+    size_t length = strlen(word);
+    if (used + length + 1U > bytes) break;
+    memcpy(context->text + used, word, length);
+    used += length;
+    context->text[used++] = ' ';
+  }
+  if (used == 0U) {
+    memcpy(context->text, "search", bytes < 6U ? bytes : 6U);
+    used = bytes < 6U ? bytes : 6U;
+  } else {
+    used--;
+  }
+  context->text[used] = '\0';
+  context->text_bytes = used;
+  return 0;
+}
+
+static int setup_text(CONTEXT *context, size_t size) {
+  return make_text(context, size);
+}
+
+static int setup_snippet(CONTEXT *context, size_t size) {
+  if (make_text(context, size) != 0) return -1;
+  context->output = malloc(size * 2U + 1024U);
+  return context->output != NULL ? 0 : -1;
+}
+
+/* One segment of size documents, each holding "common" and a category for the filter. */
+static int setup_segment(CONTEXT *context, size_t size) {
+  YAP_V2_DOCUMENT_VIEW *documents = calloc(size, sizeof(*documents));
+  YAP_V2_COMPONENT_DESCRIPTOR lexical[3], component;
+  char *ids = calloc(size, 32U), *metadata = calloc(size, 32U), *bodies = calloc(size, 48U);
+  char segment_dir[PATH_MAX], name[64], path[PATH_MAX];
+  const char *filter = "{\"eq\":{\"field\":\"category\",\"value\":\"c3\"}}";
+  uint64_t state = UINT64_C(0x2545f4914f6cdd1d);
+  size_t i;
+  int status = -1;
+  if (documents == NULL || ids == NULL || metadata == NULL || bodies == NULL ||
+      snprintf(name, sizeof(name), "segment-%zu", size) < 0 ||
+      ytest_path_join(segment_dir, sizeof(segment_dir), context->env.tmp_root, name) != 0 ||
+      ytest_mkdir_p(segment_dir, 0700) != 0)
+    goto done;
+  for (i = 0U; i < size; i++) {
+    int id_bytes = snprintf(ids + i * 32U, 32U, "doc-%zu", i);
+    int metadata_bytes = snprintf(metadata + i * 32U, 32U, "{\"category\":\"c%zu\"}", i % 16U);
+    int body_bytes = snprintf(bodies + i * 48U, 48U, "common w%llu w%llu",
+                              (unsigned long long)(next_random(&state) % 1000U),
+                              (unsigned long long)(next_random(&state) % 1000U));
+    if (id_bytes < 0 || metadata_bytes < 0 || body_bytes < 0) goto done;
+    documents[i].id = bytes_view(ids + i * 32U, (size_t)id_bytes);
+    documents[i].body = bytes_view(bodies + i * 48U, (size_t)body_bytes);
+    documents[i].metadata_json = bytes_view(metadata + i * 32U, (size_t)metadata_bytes);
+  }
+  YAP_V2_lexical_segment_init(&context->segment);
+  YAP_V2_metadata_index_init(&context->metadata);
+  if (YAP_V2_lexical_write(segment_dir, 1U, documents, size, NULL, 0U, lexical) != YAP_V2_OK ||
+      YAP_V2_lexical_segment_open(segment_dir, 1U, &context->segment) != YAP_V2_OK)
+    goto done;
+  context->segment_open = 1;
+  context->hits = calloc(size, sizeof(*context->hits));
+  if (YAP_V2_lexical_term_find(&context->segment, bytes_view("common", 6U), &context->term) !=
+        YAP_V2_OK ||
+      context->hits == NULL ||
+      ytest_path_join(path, sizeof(path), segment_dir, "metadata.yap2") != 0 ||
+      YAP_V2_metadata_write(path, 1U, &context->config, documents, size,
+                            &component) != YAP_V2_OK ||
+      YAP_V2_metadata_read(path, 1U, &context->config, &context->metadata,
+                           &component) != YAP_V2_OK ||
+      YAP_V2_filter_compile(bytes_view(filter, strlen(filter)), &context->metadata,
+                            &context->filter) != YAP_V2_OK)
+    goto done;
+  status = 0;
+done:
+  free(documents);
+  free(ids);
+  free(metadata);
+  free(bodies);
+  return status;
+}
+
+/* PHRASE_DOCUMENTS documents of size tokens drawn from four words, so every document holds
+ * every phrase term many times and the phrase check dominates. */
+static int setup_phrase(CONTEXT *context, size_t size) {
+  static const char *const phrase_words[] = {"alpha", "beta", "gamma", "delta"};
+  YAP_V2_DOCUMENT_VIEW documents[PHRASE_DOCUMENTS];
+  YAP_V2_COMPONENT_DESCRIPTOR lexical[3];
+  char *bodies = malloc(PHRASE_DOCUMENTS * size * 6U);
+  char segment_dir[PATH_MAX], name[64];
+  uint64_t state = UINT64_C(0x853c49e6748fea9b);
+  size_t d, t, used = 0U;
+  int status = -1;
+  memset(documents, 0, sizeof(documents));
+  if (bodies == NULL || snprintf(name, sizeof(name), "phrase-%zu", size) < 0 ||
+      ytest_path_join(segment_dir, sizeof(segment_dir), context->env.tmp_root, name) != 0 ||
+      ytest_mkdir_p(segment_dir, 0700) != 0)
+    goto done;
+  for (d = 0U; d < PHRASE_DOCUMENTS; d++) {
+    size_t start = used;
+    for (t = 0U; t < size; t++) {
+      const char *word = phrase_words[next_random(&state) % 4U];
+      size_t length = strlen(word);
+      memcpy(bodies + used, word, length);
+      used += length;
+      bodies[used++] = ' ';
+    }
+    documents[d].id = bytes_view("doc", 3U);
+    documents[d].body = bytes_view(bodies + start, used - start - 1U);
+  }
+  YAP_V2_lexical_segment_init(&context->segment);
+  if (YAP_V2_lexical_write(segment_dir, 1U, documents, PHRASE_DOCUMENTS, NULL, 0U,
+                           lexical) != YAP_V2_OK ||
+      YAP_V2_lexical_segment_open(segment_dir, 1U, &context->segment) != YAP_V2_OK)
+    goto done;
+  context->segment_open = 1;
+  context->hits = calloc(PHRASE_DOCUMENTS, sizeof(*context->hits));
+  status = context->hits != NULL ? 0 : -1;
+done:
+  free(bodies);
+  return status;
+}
+
+static int setup_vector(CONTEXT *context, size_t size) {
+  uint64_t state = UINT64_C(0x5851f42d4c957f2d);
+  size_t i;
+  context->vectors = malloc(size * 2U * sizeof(*context->vectors));
+  if (context->vectors == NULL) return -1;
+  for (i = 0U; i < size * 2U; i++)
+    context->vectors[i] = (float)((int)(next_random(&state) % 20001U) - 10000) / 10000.0f;
+  return 0;
+}
+
+/* Two ranked lists of size candidates; every other vector candidate is also lexical. */
+static int setup_rrf(CONTEXT *context, size_t size) {
+  size_t i;
+  context->candidates = calloc(size * 2U, sizeof(*context->candidates));
+  context->candidate_ids = calloc(size * 2U, 24U);
+  if (context->candidates == NULL || context->candidate_ids == NULL) return -1;
+  for (i = 0U; i < size * 2U; i++) {
+    char *id = context->candidate_ids + i * 24U;
+    size_t key = i < size ? i : (i - size) % 2U == 0U ? i - size : size + i;
+    int length = snprintf(id, 24U, "doc-%zu", key);
+    if (length < 0) return -1;
+    context->candidates[i].id = bytes_view(id, (size_t)length);
+    context->candidates[i].score = 1.0 / (double)(i % size + 1U);
+  }
+  return 0;
+}
+
+static int run_tokenize(CONTEXT *context) {
+  YAP_V2_TOKEN_SEQUENCE sequence;
+  int status;
+  memset(&sequence, 0, sizeof(sequence));
+  status = YAP_V2_unicode_tokenize(context->text, context->text_bytes, &sequence);
+  context->sink += sequence.token_count;
+  YAP_V2_token_sequence_free(&sequence);
+  return status;
+}
+
+static int run_chunk(CONTEXT *context) {
+  YAP_V2_CHUNK_SEQUENCE sequence;
+  int status;
+  memset(&sequence, 0, sizeof(sequence));
+  status = YAP_V2_unicode_chunk("doc-bench", context->text, context->text_bytes, 256U, 32U,
+                                &sequence);
+  context->sink += sequence.chunk_count;
+  YAP_V2_chunk_sequence_free(&sequence);
+  return status;
+}
+
+static int run_postings(CONTEXT *context) {
+  YAP_V2_POSTING_ITERATOR iterator;
+  YAP_V2_POSTING posting;
+  int status = YAP_V2_posting_iterator_init(&context->segment, &context->term, &iterator);
+  if (status != YAP_V2_OK) return status;
+  while (YAP_V2_posting_iterator_next(&iterator, &posting) == YAP_V2_OK)
+    context->sink += posting.object_ordinal;
+  return YAP_V2_OK;
+}
+
+/* top_k covers every document so no posting is skipped by the score bound and each one
+ * goes through posting_score. */
+static int run_score(CONTEXT *context) {
+  YAP_V2_LEXICAL_SEARCH_OPTIONS options;
+  size_t count = 0U;
+  int status;
+  YAP_V2_lexical_search_options_init(&options);
+  options.object_type = YAP_V2_LEXICAL_DOCUMENT;
+  options.top_k = context->size;
+  status = YAP_V2_lexical_search(&context->segment, bytes_view("common", 6U), &options,
+                                 context->hits, context->size, &count);
+  context->sink += count;
+  return status;
+}
+
+static int run_phrase(CONTEXT *context) {
+  YAP_V2_LEXICAL_SEARCH_OPTIONS options;
+  size_t count = 0U;
+  int status;
+  YAP_V2_lexical_search_options_init(&options);
+  options.object_type = YAP_V2_LEXICAL_DOCUMENT;
+  options.phrase = 1;
+  options.top_k = PHRASE_DOCUMENTS;
+  status = YAP_V2_lexical_search(&context->segment, bytes_view("alpha beta gamma delta", 22U),
+                                 &options, context->hits, PHRASE_DOCUMENTS, &count);
+  context->sink += count;
+  return status;
+}
+
+static int run_filter(CONTEXT *context) {
+  size_t i;
+  for (i = 0U; i < context->size; i++) {
+    int matches = 0, status = YAP_V2_filter_matches(&context->filter, i, &matches);
+    if (status != YAP_V2_OK) return status;
+    context->sink += (uint64_t)matches;
+  }
+  return YAP_V2_OK;
+}
+
+static int run_vector(CONTEXT *context) {
+  double score = 0.0;
+  int status = YAP_Vector_score(YAP_V2_VECTOR_COSINE, context->vectors,
+                                context->vectors + context->size, context->size, &score);
+  context->sink += (uint64_t)(score > 0.0);
+  return status == YAP_VECTOR_OK ? YAP_V2_OK : YAP_V2_INVALID_ARGUMENT;
+}
+
+static int run_rrf(CONTEXT *context) {
+  size_t count = 0U;
+  int status = YAP_Hybrid_fuse_rrf(context->candidates, context->size,
+                                   context->candidates + context->size, context->size, 1.0, 1.0,
+                                   RRF_TOP_K, context->fused, RRF_TOP_K, &count);
+  context->sink += count;
+  return status == YAP_HYBRID_OK ? YAP_V2_OK : YAP_V2_INVALID_ARGUMENT;
+}
+
+static int run_crc32c(CONTEXT *context) {
+  context->sink += YAP_V2_crc32c((const unsigned char *)context->text, context->text_bytes);
+  return YAP_V2_OK;
+}
+
+static int run_sha256(CONTEXT *context) {
+  unsigned char digest[YAP_V2_CONFIG_FINGERPRINT_BYTES];
+  YAP_V2_sha256_bytes((const unsigned char *)context->text, context->text_bytes, digest);
+  context->sink += digest[0];
+  return YAP_V2_OK;
+}
+
+static int run_snippet(CONTEXT *context) {
+  YAP_V2_BYTES_VIEW terms[2];
+  size_t output_bytes = 0U;
+  int status;
+  terms[0] = bytes_view("latency", 7U);
+  terms[1] = bytes_view("東京", strlen("東京"));
+  status = YAP_V2_snippet(bytes_view(context->text, context->text_bytes), terms, 2U,
+                          SNIPPET_GRAPHEMES, "<b>", "</b>", context->output,
+                          context->text_bytes * 2U + 1024U, &output_bytes);
+  context->sink += output_bytes;
+  return status;
+}
+
+static const KERNEL kernels[] = {
+  {"tokenize", "bytes", 1, {256U, 4096U, 65536U}, setup_text, run_tokenize},
+  {"chunk", "bytes", 1, {256U, 4096U, 65536U}, setup_text, run_chunk},
+  {"postings", "postings", 0, {128U, 4096U, 65536U}, setup_segment, run_postings},
+  {"score", "postings", 0, {128U, 4096U, 65536U}, setup_segment, run_score},
+  {"phrase", "tokens", 0, {64U, 1024U, 16384U}, setup_phrase, run_phrase},
+  {"filter", "documents", 0, {128U, 4096U, 65536U}, setup_segment, run_filter},
+  {"vector", "dimensions", 0, {64U, 384U, 1536U}, setup_vector, run_vector},
+  {"rrf", "candidates", 0, {16U, 256U, 4096U}, setup_rrf, run_rrf},
+  {"crc32c", "bytes", 1, {64U, 4096U, 1048576U}, setup_text, run_crc32c},
+  {"sha256", "bytes", 1, {64U, 4096U, 1048576U}, setup_text, run_sha256},
+  {"snippet", "bytes", 1, {256U, 1024U, 4096U}, setup_snippet, run_snippet},
+};
+
+static void context_reset(CONTEXT *context) {
+  free(context->text);
+  free(context->hits);
+  free(context->vectors);
+  free(context->candidates);
+  free(context->candidate_ids);
+  free(context->output);
+  YAP_V2_filter_free(&context->filter);
+  YAP_V2_metadata_index_free(&context->metadata);
+  if (context->segment_open) YAP_V2_lexical_segment_close(&context->segment);
+  context->text = NULL; context->text_bytes = 0U; context->hits = NULL;
+  context->vectors = NULL; context->candidates = NULL; context->candidate_ids = NULL;
+  context->output = NULL; context->segment_open = 0;
+  YAP_V2_filter_init(&context->filter);
+  YAP_V2_metadata_index_init(&context->metadata);
+}
+
+static int parse_size(const char *value, size_t minimum, size_t maximum, size_t *output) {
+  char *end = NULL;
+  unsigned long long parsed;
+  errno = 0;
+  parsed = strtoull(value, &end, 10);
+  if (errno != 0 || end == value || *end != '\0' || parsed < minimum || parsed > maximum)
+    return -1;
+  *output = (size_t)parsed;
+  return 0;
+}
+
+static int parse_sizes(const char *value, OPTIONS *options) {
+  char buffer[256], *item, *saveptr = NULL;
+  if (strlen(value) >= sizeof(buffer)) return -1;
+  memcpy(buffer, value, strlen(value) + 1U);
+  options->size_count = 0U;
+  for (item = strtok_r(buffer, ",", &saveptr); item != NULL;
+       item = strtok_r(NULL, ",", &saveptr)) {
+    if (options->size_count == MAX_SIZES ||
+        parse_size(item, 1U, 16777216U, &options->sizes[options->size_count]) != 0)
+      return -1;
+    options->size_count++;
+  }
+  return options->size_count > 0U ? 0 : -1;
+}
+
+static int parse_options(int argc, char **argv, OPTIONS *options) {
+  int i;
+  size_t min_sample_us = 2000U, k;
+  memset(options, 0, sizeof(*options));
+  options->warmup = 3U;
+  options->repetitions = 21U;
+  for (i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) return -1;
+    if (strcmp(argv[i], "--kernel") == 0) {
+      options->kernel = argv[i + 1];
+    } else if (strcmp(argv[i], "--sizes") == 0) {
+      if (parse_sizes(argv[i + 1], options) != 0) return -1;
+    } else if (strcmp(argv[i], "--warmup") == 0) {
+      if (parse_size(argv[i + 1], 0U, 1000U, &options->warmup) != 0) return -1;
+    } else if (strcmp(argv[i], "--repetitions") == 0) {
+      if (parse_size(argv[i + 1], 3U, 100000U, &options->repetitions) != 0) return -1;
+    } else if (strcmp(argv[i], "--min-sample-us") == 0) {
+      if (parse_size(argv[i + 1], 1U, 10000000U, &min_sample_us) != 0) return -1;
+    } else {
+      return -1;
+    }
+  }
+  options->min_sample_ns = (uint64_t)min_sample_us * 1000U;
+  if (options->kernel == NULL) return 0;
+  for (k = 0U; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    if (strcmp(options->kernel, kernels[k].name) == 0) return 0;
+  return -1;
+}
+
+/* Doubles the calls per sample until one sample lasts min_sample_ns, so clock resolution
+ * and loop overhead stay small next to the kernel. */
+static int calibrate(const KERNEL *kernel, CONTEXT *context, uint64_t min_sample_ns,
+                     size_t *calls) {
+  *calls = 1U;
+  for (;;) {
+    uint64_t started = now_ns(), elapsed;
+    size_t i;
+    for (i = 0U; i < *calls; i++)
+      if (kernel->run(context) != YAP_V2_OK) return -1;
+    elapsed = now_ns() - started;
+    if (elapsed >= min_sample_ns || *calls >= ((size_t)1 << 30)) return 0;
+    *calls *= 2U;
+  }
+}
+
+static int benchmark(const KERNEL *kernel, CONTEXT *context, const OPTIONS *options,
+                     size_t size, double *samples) {
+  double mean = 0.0, variance = 0.0, median;
+  size_t calls, sample, i;
+  context->size = size;
+  if (kernel->setup(context, size) != 0) {
+    fprintf(stderr, "%s: setup failed for size %zu\n", kernel->name, size);
+    return -1;
+  }
+  if (calibrate(kernel, context, options->min_sample_ns, &calls) != 0) goto failed;
+  for (sample = 0U; sample < options->warmup + options->repetitions; sample++) {
+    uint64_t started = now_ns();
+    for (i = 0U; i < calls; i++)
+      if (kernel->run(context) != YAP_V2_OK) goto failed;
+    if (sample >= options->warmup)
+      samples[sample - options->warmup] = (double)(now_ns() - started) / (double)calls;
+  }
+  for (i = 0U; i < options->repetitions; i++) mean += samples[i];
+  mean /= (double)options->repetitions;
+  for (i = 0U; i < options->repetitions; i++)
+    variance += (samples[i] - mean) * (samples[i] - mean);
+  variance /= (double)(options->repetitions - 1U);
+  qsort(samples, options->repetitions, sizeof(*samples), compare_double);
+  median = samples[options->repetitions / 2U];
+  printf("%s\t%zu\t%s\t%zu\t%zu\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.2f\t%.0f\n", kernel->name,
+         size, kernel->unit, calls, options->repetitions, samples[0], median,
+         samples[(options->repetitions * 95U) / 100U], mean, sqrt(variance),
+         kernel->byte_sized ? (double)context->text_bytes / (1024.0 * 1024.0) /
+                              (median / 1e9) : 0.0,
+         (double)size / (median / 1e9));
+  return 0;
+failed:
+  fprintf(stderr, "%s: kernel failed for size %zu\n", kernel->name, size);
+  return -1;
+}
+
+int main(int argc, char **argv) {
+  OPTIONS options;
+  CONTEXT context;
+  double *samples = NULL;
+  size_t k, s;
+  int status = EXIT_FAILURE;
+  if (parse_options(argc, argv, &options) != 0) {
+    fprintf(stderr, "usage: %s [--kernel NAME] [--sizes N,N,...] [--warmup N] "
+                    "[--repetitions N] [--min-sample-us N]\nkernels:", argv[0]);
+    for (k = 0U; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+      fprintf(stderr, " %s", kernels[k].name);
+    fputc('\n', stderr);
+    return EXIT_FAILURE;
+  }
+  memset(&context, 0, sizeof(context));
+  YAP_V2_filter_init(&context.filter);
+  YAP_V2_metadata_index_init(&context.metadata);
+  samples = malloc(options.repetitions * sizeof(*samples));
+  if (samples == NULL || ytest_env_init(&context.env) != 0) {
+    free(samples);
+    return EXIT_FAILURE;
+  }
+  YAP_V2_config_init(&context.config);
+  context.config.filterable_field_count = 1U;
+  strcpy(context.config.filterable_fields[0], "category");
+  printf("kernel\tsize\tunit\tcalls_per_sample\trepetitions\tmin_ns\tmedian_ns\tp95_ns\t"
+         "mean_ns\tstddev_ns\tmib_per_second\titems_per_second\n");
+  for (k = 0U; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    const size_t *sizes = options.size_count > 0U ? options.sizes : kernels[k].default_sizes;
+    size_t size_count = options.size_count > 0U ? options.size_count : 3U;
+    if (options.kernel != NULL && strcmp(options.kernel, kernels[k].name) != 0) continue;
+    for (s = 0U; s < size_count; s++) {
+      int result = benchmark(&kernels[k], &context, &options, sizes[s], samples);
+      context_reset(&context);
+      if (result != 0) goto done;
+      fflush(stdout);
+    }
+  }
+  fprintf(stderr, "sink=%llu\n", (unsigned long long)context.sink);
+  status = EXIT_SUCCESS;
+done:
+  context_reset(&context);
+  ytest_env_destroy(&context.env);
+  free(samples);
+  return status;
+}
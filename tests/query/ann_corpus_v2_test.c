@@ -13,7 +13,7 @@
 #include "test_env.h"
 #include "test_fs.h"
 
-enum { SEGMENT_COUNT = 1000, DIMENSIONS = 4, TOP_K = 10 };
+enum { SEGMENT_COUNT = 1000, RETIRED_COUNT = 10, DIMENSIONS = 4, TOP_K = 10 };
 
 static YAP_V2_BYTES_VIEW bytes(const char *value) {
   YAP_V2_BYTES_VIEW view = {(const unsigned char *)value, strlen(value)};
@@ -163,6 +163,8 @@ static void test_corpus_replaces_segment_fanout_and_preserves_results(void **sta
                                                &loaded), YAP_V2_OK);
   assert_int_equal(loaded.generation, corpus.generation);
   assert_int_equal(loaded.vector_count, corpus.vector_count);
+  assert_non_null(loaded.index.mapping);
+  assert_true(loaded.index.mapping_bytes > 0U);
   assert_int_equal(YAP_V2_ann_query_plan_build(&loaded, &manifest, &loaded_plan),
                    YAP_V2_OK);
   assert_int_equal(YAP_V2_query_execute_with_ann(
@@ -178,6 +180,40 @@ static void test_corpus_replaces_segment_fanout_and_preserves_results(void **sta
   YAP_V2_ann_corpus_free(&loaded);
   assert_int_equal(ytest_path_join(ann_cache_path, sizeof(ann_cache_path),
                                    env.tmp_root, "ann-base.usearch"), 0);
+  {
+    FILE *cache_file = fopen(ann_cache_path, "r+b");
+    long middle;
+    int byte;
+    assert_non_null(cache_file);
+    assert_int_equal(fseek(cache_file, 0L, SEEK_END), 0);
+    middle = ftell(cache_file) / 2L;
+    assert_true(middle > 0L);
+    assert_int_equal(fseek(cache_file, middle, SEEK_SET), 0);
+    byte = fgetc(cache_file);
+    assert_true(byte != EOF);
+    assert_int_equal(fseek(cache_file, middle, SEEK_SET), 0);
+    assert_int_equal(fputc(byte ^ 0xff, cache_file), byte ^ 0xff);
+    assert_int_equal(fclose(cache_file), 0);
+  }
+  assert_int_equal(YAP_V2_ann_corpus_load_cache(env.tmp_root, &config, &manifest,
+                                               &loaded), YAP_V2_CHECKSUM_MISMATCH);
+  /* The deferred load never maps the graph, so queries fall back to every segment's own. */
+  assert_int_equal(YAP_V2_ann_corpus_load_cache_deferred(env.tmp_root, &config, &manifest,
+                                                        &loaded), YAP_V2_OK);
+  assert_true(loaded.index_pending);
+  assert_null(loaded.index.mapping);
+  assert_int_equal(YAP_V2_ann_query_plan_build(&loaded, &manifest, &loaded_plan),
+                   YAP_V2_OK);
+  assert_true(loaded_plan.base_pending);
+  assert_int_equal(loaded_plan.delta_segment_count, 0U);
+  assert_int_equal(YAP_V2_query_execute_with_ann(
+    snapshot, query_segments, SEGMENT_COUNT, &corpus_stats, &loaded, &loaded_plan,
+    &request, persisted, TOP_K, &persisted_count, &persisted_stats), YAP_V2_OK);
+  assert_int_equal(persisted_count, optimized_count);
+  assert_int_equal(persisted_stats.base_search_calls, 0U);
+  assert_int_equal(persisted_stats.delta_search_calls, SEGMENT_COUNT);
+  YAP_V2_ann_query_plan_free(&loaded_plan);
+  YAP_V2_ann_corpus_free(&loaded);
   {
     FILE *cache_file = fopen(ann_cache_path, "r+b");
     int first;
@@ -190,6 +226,69 @@ static void test_corpus_replaces_segment_fanout_and_preserves_results(void **sta
   }
   assert_int_equal(YAP_V2_ann_corpus_load_cache(env.tmp_root, &config, &manifest,
                                                &loaded), YAP_V2_CHECKSUM_MISMATCH);
+  {
+    YAP_V2_MANIFEST compacted;
+    YAP_V2_SEARCH_SNAPSHOT *compacted_snapshot;
+    YAP_V2_ANN_CORPUS extended;
+    YAP_V2_ANN_QUERY_PLAN extended_plan;
+    YAP_V2_QUERY_CORPUS_STATS compacted_stats;
+    YAP_V2_QUERY_STATS extended_stats;
+    size_t extended_count = 0U;
+    int changed = 0;
+    YAP_V2_manifest_init(&compacted);
+    compacted.generation = 2U;
+    memcpy(compacted.config_fingerprint, manifest.config_fingerprint,
+           sizeof(compacted.config_fingerprint));
+    for (s = RETIRED_COUNT; s < SEGMENT_COUNT; s++)
+      assert_int_equal(YAP_V2_manifest_add_segment(&compacted, &manifest.segments[s]),
+                       YAP_V2_OK);
+    assert_int_equal(YAP_V2_manifest_save_atomic(manifest_path, &compacted), YAP_V2_OK);
+    assert_int_equal(YAP_V2_snapshot_manager_reload(&manager, &changed), YAP_V2_OK);
+    assert_true(changed);
+    compacted_snapshot = YAP_V2_snapshot_acquire(&manager);
+    assert_non_null(compacted_snapshot);
+    YAP_V2_ann_corpus_init(&extended); YAP_V2_ann_query_plan_init(&extended_plan);
+    assert_int_equal(YAP_V2_ann_corpus_extend(&corpus, &compacted, compacted_snapshot,
+                                              ann + RETIRED_COUNT,
+                                              SEGMENT_COUNT - RETIRED_COUNT, &extended),
+                     YAP_V2_OK);
+    assert_int_equal(corpus.vector_count, SEGMENT_COUNT);
+    assert_int_equal(extended.generation, 2U);
+    assert_int_equal(extended.segment_count, SEGMENT_COUNT);
+    assert_int_equal(extended.vector_count, SEGMENT_COUNT - RETIRED_COUNT);
+    assert_int_equal(extended.removed_vector_count, RETIRED_COUNT);
+    assert_string_equal(extended.segments[0].id, "");
+    assert_false(YAP_V2_ann_corpus_needs_rebuild(&extended));
+    assert_int_equal(YAP_V2_ann_query_plan_build(&extended, &compacted, &extended_plan),
+                     YAP_V2_OK);
+    assert_int_equal(extended_plan.delta_segment_count, 0U);
+    assert_int_equal(extended_plan.missing_base_segment_count, 0U);
+    assert_int_equal(YAP_V2_query_corpus_stats_build(
+      compacted_snapshot, query_segments + RETIRED_COUNT, SEGMENT_COUNT - RETIRED_COUNT,
+      &compacted_stats), YAP_V2_OK);
+    assert_int_equal(YAP_V2_query_execute_with_ann(
+      compacted_snapshot, query_segments + RETIRED_COUNT, SEGMENT_COUNT - RETIRED_COUNT,
+      &compacted_stats, &extended, &extended_plan, &request, persisted, TOP_K,
+      &extended_count, &extended_stats), YAP_V2_OK);
+    assert_int_equal(extended_count, TOP_K);
+    assert_int_equal(extended_stats.base_search_calls, 1U);
+    assert_int_equal(extended_stats.delta_search_calls, 0U);
+    for (i = 0U; i < extended_count; i++)
+      for (s = 0U; s < RETIRED_COUNT; s++)
+        assert_false(persisted[i].id.len == strlen(ids[s]) &&
+                     memcmp(persisted[i].id.data, ids[s], persisted[i].id.len) == 0);
+    assert_int_equal(YAP_V2_ann_corpus_save_cache(env.tmp_root, &extended), YAP_V2_OK);
+    assert_int_equal(YAP_V2_ann_corpus_load_cache(env.tmp_root, &config, &compacted,
+                                                 &loaded), YAP_V2_OK);
+    assert_int_equal(loaded.segment_count, SEGMENT_COUNT);
+    assert_int_equal(loaded.vector_count, SEGMENT_COUNT - RETIRED_COUNT);
+    assert_int_equal(loaded.removed_vector_count, RETIRED_COUNT);
+    assert_int_equal(loaded.segments[RETIRED_COUNT].passage_count, 1U);
+    YAP_V2_ann_corpus_free(&loaded);
+    YAP_V2_ann_query_plan_free(&extended_plan); YAP_V2_ann_corpus_free(&extended);
+    YAP_V2_snapshot_release(compacted_snapshot);
+    YAP_V2_manifest_free(&compacted);
+  }
   YAP_V2_ann_query_plan_free(&plan); YAP_V2_ann_corpus_free(&corpus);
   for (s = 0U; s < SEGMENT_COUNT; s++) {
     YAP_V2_ann_segment_close(&ann[s]);
@@ -11,6 +11,7 @@
 #include "test_env.h"
 #include "test_fs.h"
 #include "query/yappo_lexical_search_v2.h"
+#include "query/yappo_phrase_v2.h"
 
 static YAP_V2_BYTES_VIEW bytes(const char *value) {
   YAP_V2_BYTES_VIEW view;
@@ -73,12 +74,149 @@ static void test_bm25f_boolean_and_phrase(void **state) {
   ytest_env_destroy(&env);
 }
 
+static void test_phrase_slop_allows_nearby_terms(void **state) {
+  ytest_env_t env;
+  YAP_V2_LEXICAL_SEGMENT segment;
+  YAP_V2_LEXICAL_SEARCH_OPTIONS options;
+  YAP_V2_LEXICAL_HIT hits[10];
+  size_t count;
+  char directory[PATH_MAX];
+
+  (void)state;
+  assert_int_equal(ytest_env_init(&env), 0);
+  assert_int_equal(ytest_path_join(directory, sizeof(directory), env.tmp_root, "segment"), 0);
+  assert_int_equal(ytest_mkdir_p(directory, 0700), 0);
+  build_small(directory);
+  YAP_V2_lexical_segment_init(&segment);
+  assert_int_equal(YAP_V2_lexical_segment_open(directory, 20U, &segment), YAP_V2_OK);
+  YAP_V2_lexical_search_options_init(&options);
+  options.object_type = YAP_V2_LEXICAL_DOCUMENT;
+  options.top_k = 10U;
+  options.phrase = 1;
+  assert_int_equal(
+    YAP_V2_lexical_search(&segment, bytes("quick fox"), &options, hits, 10U, &count), YAP_V2_OK);
+  assert_int_equal(count, 1U);
+  assert_int_equal(hits[0].object_ordinal, 1U);
+  options.phrase_slop = 1U;
+  assert_int_equal(
+    YAP_V2_lexical_search(&segment, bytes("quick fox"), &options, hits, 10U, &count), YAP_V2_OK);
+  assert_int_equal(count, 2U);
+  assert_int_equal(
+    YAP_V2_lexical_search(&segment, bytes("brown quick"), &options, hits, 10U, &count), YAP_V2_OK);
+  assert_int_equal(count, 0U);
+  options.phrase_slop = 2U;
+  assert_int_equal(
+    YAP_V2_lexical_search(&segment, bytes("brown quick"), &options, hits, 10U, &count), YAP_V2_OK);
+  assert_int_equal(count, 1U);
+  assert_int_equal(hits[0].object_ordinal, 0U);
+  assert_int_equal(
+    YAP_V2_lexical_search(&segment, bytes("quick engine"), &options, hits, 10U, &count),
+    YAP_V2_OK);
+  assert_int_equal(count, 0U);
+  options.phrase_slop = YAP_V2_PHRASE_MAX_SLOP + 1U;
+  assert_int_equal(
+    YAP_V2_lexical_search(&segment, bytes("quick fox"), &options, hits, 10U, &count),
+    YAP_V2_INVALID_ARGUMENT);
+  YAP_V2_lexical_segment_close(&segment);
+  ytest_env_destroy(&env);
+}
+
+static void test_phrase_gallops_from_rarest_token(void **state) {
+  YAP_V2_POSITION common[1000];
+  YAP_V2_POSITION rare[1];
+  YAP_V2_PHRASE_TOKEN tokens[2];
+  size_t i;
+  int matches;
+
+  (void)state;
+  for (i = 0U; i < 1000U; i++) {
+    common[i].field = 1U;
+    common[i].position = (uint32_t)(i * 2U);
+  }
+  rare[0].field = 1U;
+  rare[0].position = 999U;
+  memset(tokens, 0, sizeof(tokens));
+  tokens[0].positions = common; tokens[0].count = 1000U; tokens[0].offset = 0U;
+  tokens[1].positions = rare; tokens[1].count = 1U; tokens[1].offset = 1U;
+  assert_int_equal(YAP_V2_phrase_match(tokens, 2U, 0U, &matches), YAP_V2_OK);
+  assert_true(matches);
+  assert_int_equal(tokens[0].count, 1U);
+  assert_int_equal(tokens[0].offset, 1U);
+  rare[0].position = 1000U;
+  assert_int_equal(YAP_V2_phrase_match(tokens, 2U, 0U, &matches), YAP_V2_OK);
+  assert_false(matches);
+  assert_int_equal(YAP_V2_phrase_match(tokens, 2U, 1U, &matches), YAP_V2_OK);
+  assert_true(matches);
+  rare[0].field = 2U;
+  assert_int_equal(YAP_V2_phrase_match(tokens, 2U, 1U, &matches), YAP_V2_OK);
+  assert_false(matches);
+  tokens[1].count = 0U;
+  assert_int_equal(YAP_V2_phrase_match(tokens, 2U, 0U, &matches), YAP_V2_OK);
+  assert_false(matches);
+}
+
+static void test_phrase_repeated_term_needs_distinct_positions(void **state) {
+  YAP_V2_POSITION positions[2];
+  YAP_V2_PHRASE_TOKEN tokens[3];
+  int matches;
+
+  (void)state;
+  positions[0].field = 2U; positions[0].position = 5U;
+  positions[1].field = 2U; positions[1].position = 7U;
+  memset(tokens, 0, sizeof(tokens));
+  /* "a a" against a single "a": both tokens read the same list. */
+  tokens[0].positions = positions; tokens[0].count = 1U; tokens[0].offset = 0U;
+  tokens[1].positions = positions; tokens[1].count = 1U; tokens[1].offset = 1U;
+  assert_int_equal(YAP_V2_phrase_match(tokens, 2U, 1U, &matches), YAP_V2_OK);
+  assert_false(matches);
+  assert_int_equal(YAP_V2_phrase_match(tokens, 2U, YAP_V2_PHRASE_MAX_SLOP, &matches), YAP_V2_OK);
+  assert_false(matches);
+  /* Two occurrences two positions apart satisfy "a a" only once slop covers the gap. */
+  tokens[0].count = 2U; tokens[1].count = 2U;
+  assert_int_equal(YAP_V2_phrase_match(tokens, 2U, 0U, &matches), YAP_V2_OK);
+  assert_false(matches);
+  assert_int_equal(YAP_V2_phrase_match(tokens, 2U, 1U, &matches), YAP_V2_OK);
+  assert_true(matches);
+  /* A third "a" has no occurrence left to claim. */
+  tokens[2].positions = positions; tokens[2].count = 2U; tokens[2].offset = 2U;
+  assert_int_equal(YAP_V2_phrase_match(tokens, 3U, 2U, &matches), YAP_V2_OK);
+  assert_false(matches);
+}
+
+static int match_a_b_c(const YAP_V2_POSITION *a, size_t a_count, const YAP_V2_POSITION *b,
+                       size_t b_count, const YAP_V2_POSITION *c, uint32_t slop) {
+  YAP_V2_PHRASE_TOKEN tokens[3];
+  int matches;
+  memset(tokens, 0, sizeof(tokens));
+  tokens[0].positions = a; tokens[0].count = a_count; tokens[0].offset = 0U;
+  tokens[1].positions = b; tokens[1].count = b_count; tokens[1].offset = 1U;
+  tokens[2].positions = c; tokens[2].count = 1U; tokens[2].offset = 2U;
+  assert_int_equal(YAP_V2_phrase_match(tokens, 3U, slop, &matches), YAP_V2_OK);
+  return matches;
+}
+
+static void test_phrase_slop_ignores_unrelated_occurrences(void **state) {
+  /* "a c b" in one field, then the same with two more a's and b's far away. */
+  const YAP_V2_POSITION a[3] = {{1U, 0U}, {1U, 20U}, {1U, 40U}};
+  const YAP_V2_POSITION b[3] = {{1U, 2U}, {1U, 22U}, {1U, 42U}};
+  const YAP_V2_POSITION c[1] = {{1U, 1U}};
+  uint32_t slop;
+
+  (void)state;
+  for (slop = 0U; slop <= 3U; slop++)
+    assert_int_equal(match_a_b_c(a, 1U, b, 1U, c, slop), match_a_b_c(a, 3U, b, 3U, c, slop));
+  /* Starts are a 0, b 1 and c -1, so the phrase needs slop 2 either way. */
+  assert_false(match_a_b_c(a, 3U, b, 3U, c, 1U));
+  assert_true(match_a_b_c(a, 3U, b, 3U, c, 2U));
+}
+
 static void test_block_max_wand_keeps_rare_top_hit(void **state) {
   ytest_env_t env;
   YAP_V2_DOCUMENT_VIEW *documents;
   YAP_V2_COMPONENT_DESCRIPTOR components[3];
   YAP_V2_LEXICAL_SEGMENT segment;
   YAP_V2_LEXICAL_SEARCH_OPTIONS options;
+  YAP_V2_LEXICAL_SEARCH_PROFILE profile;
   YAP_V2_LEXICAL_HIT hit;
   size_t count;
   size_t i;
@@ -103,10 +241,17 @@ static void test_block_max_wand_keeps_rare_top_hit(void **state) {
   YAP_V2_lexical_search_options_init(&options);
   options.object_type = YAP_V2_LEXICAL_DOCUMENT;
   options.top_k = 1U;
+  memset(&profile, 0, sizeof(profile));
+  options.profile = &profile;
   assert_int_equal(
     YAP_V2_lexical_search(&segment, bytes("common rare"), &options, &hit, 1U, &count), YAP_V2_OK);
   assert_int_equal(count, 1U);
   assert_int_equal(hit.object_ordinal, 259U);
+  assert_int_equal(profile.postings_decoded, 261U);
+  assert_true(profile.postings_scored >= 2U);
+  assert_true(profile.postings_scored <= profile.postings_decoded);
+  assert_true(profile.pivots > 0U);
+  assert_int_equal(profile.filter_evaluations, 0U);
   YAP_V2_lexical_segment_close(&segment);
   ytest_env_destroy(&env);
 }
@@ -214,6 +359,8 @@ static void test_global_bm25_is_independent_of_segment_split(void **state) {
   assert_int_equal(YAP_V2_lexical_query_plan_bind(&plan, segments, 2U), YAP_V2_OK);
   assert_int_equal(plan.type_frequency[0][0], 1U);
   assert_int_equal(plan.type_frequency[0][1], 4U);
+  assert_true(YAP_V2_lexical_query_plan_has_all_terms(&plan, 0U));
+  assert_false(YAP_V2_lexical_query_plan_has_all_terms(&plan, 1U));
   memset(&stats, 0, sizeof(stats));
   for (field = 0U; field < 3U; field++)
     stats.field_token_count[field] = split[0].field_token_count[field] +
@@ -240,6 +387,10 @@ static void test_global_bm25_is_independent_of_segment_split(void **state) {
 int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_bm25f_boolean_and_phrase),
+    cmocka_unit_test(test_phrase_slop_allows_nearby_terms),
+    cmocka_unit_test(test_phrase_slop_ignores_unrelated_occurrences),
+    cmocka_unit_test(test_phrase_gallops_from_rarest_token),
+    cmocka_unit_test(test_phrase_repeated_term_needs_distinct_positions),
     cmocka_unit_test(test_block_max_wand_keeps_rare_top_hit),
     cmocka_unit_test(test_prepared_query_reuses_normalized_unique_terms),
     cmocka_unit_test(test_global_bm25_is_independent_of_segment_split),
@@ -38,6 +38,7 @@ static void test_hybrid_filter_and_scope_aggregation(void **state) {
   YAP_V2_VECTOR_SEGMENT vectors;
   YAP_V2_ANN_SEGMENT ann;
   YAP_V2_METADATA_INDEX metadata;
+  YAP_V2_CANCELLATION cancellation;
   YAP_V2_QUERY_SEGMENT runtime;
   YAP_V2_QUERY_CORPUS_STATS corpus_stats;
   YAP_V2_QUERY_REQUEST request;
@@ -136,6 +137,12 @@ static void test_hybrid_filter_and_scope_aggregation(void **state) {
                    YAP_V2_OK);
   assert_int_equal(hit_count, 1U); assert_memory_equal(hits[0].id.data, "passage-fruit", 13U);
   assert_memory_equal(hits[0].parent_document_id.data, "doc-fruit", 9U);
+  YAP_V2_cancellation_init(&cancellation, 0U);
+  YAP_V2_cancellation_cancel(&cancellation);
+  request.cancellation = &cancellation;
+  assert_int_equal(YAP_V2_query_execute(snapshot, &runtime, 1U, &corpus_stats, &request,
+                                        hits, 2U, &hit_count),
+                   YAP_V2_CANCELLED);
   YAP_V2_metadata_index_free(&metadata); YAP_V2_vector_segment_close(&vectors);
   YAP_V2_lexical_segment_close(&lexical); YAP_V2_snapshot_release(snapshot);
   YAP_V2_snapshot_manager_close(&manager); ytest_env_destroy(&env);
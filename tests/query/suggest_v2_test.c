@@ -0,0 +1,166 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "test_env.h"
+#include "test_fs.h"
+#include "query/yappo_lexical_search_v2.h"
+#include "query/yappo_suggest_v2.h"
+
+static YAP_V2_BYTES_VIEW bytes(const char *value) {
+  YAP_V2_BYTES_VIEW view;
+  view.data = (const unsigned char *)value;
+  view.len = strlen(value);
+  return view;
+}
+
+static void open_segment(const ytest_env_t *env, const char *name, uint64_t generation,
+                         const YAP_V2_DOCUMENT_VIEW *documents, size_t document_count,
+                         YAP_V2_LEXICAL_SEGMENT *segment) {
+  YAP_V2_COMPONENT_DESCRIPTOR components[3];
+  char directory[PATH_MAX];
+  assert_int_equal(ytest_path_join(directory, sizeof(directory), env->tmp_root, name), 0);
+  assert_int_equal(ytest_mkdir_p(directory, 0700), 0);
+  assert_int_equal(YAP_V2_lexical_write(directory, generation, documents, document_count, NULL,
+                                        0U, components),
+                   YAP_V2_OK);
+  YAP_V2_lexical_segment_init(segment);
+  assert_int_equal(YAP_V2_lexical_segment_open(directory, generation, segment), YAP_V2_OK);
+}
+
+static void open_fixture(const ytest_env_t *env, YAP_V2_LEXICAL_SEGMENT segments[2]) {
+  YAP_V2_DOCUMENT_VIEW first[2], second[1];
+  memset(first, 0, sizeof(first));
+  memset(second, 0, sizeof(second));
+  first[0].id = bytes("doc-0");
+  first[0].title = bytes("search engine");
+  first[0].body = bytes("seal search");
+  first[1].id = bytes("doc-1");
+  first[1].title = bytes("season");
+  first[1].body = bytes("search");
+  second[0].id = bytes("doc-2");
+  second[0].title = bytes("seal");
+  second[0].body = bytes("sea");
+  open_segment(env, "first", 20U, first, 2U, &segments[0]);
+  open_segment(env, "second", 21U, second, 1U, &segments[1]);
+}
+
+static void assert_suggestion(const YAP_V2_SUGGESTION *suggestion, const char *term,
+                              uint64_t document_frequency) {
+  assert_int_equal(suggestion->term_len, strlen(term));
+  assert_memory_equal(suggestion->term, term, strlen(term));
+  assert_int_equal(suggestion->document_frequency, document_frequency);
+}
+
+static void test_suggest_sums_frequencies_across_segments(void **state) {
+  ytest_env_t env;
+  YAP_V2_LEXICAL_SEGMENT segments[2];
+  const YAP_V2_LEXICAL_SEGMENT *views[3];
+  YAP_V2_SUGGESTIONS suggestions, copy;
+  (void)state;
+  assert_int_equal(ytest_env_init(&env), 0);
+  open_fixture(&env, segments);
+  views[0] = &segments[0];
+  views[1] = NULL;
+  views[2] = &segments[1];
+  YAP_V2_suggestions_init(&suggestions);
+  YAP_V2_suggestions_init(&copy);
+  assert_int_equal(YAP_V2_suggest_terms(views, 3U, bytes("sea"), 3U, &suggestions), YAP_V2_OK);
+  assert_int_equal(suggestions.count, 3U);
+  assert_suggestion(&suggestions.items[0], "seal", 2U);
+  assert_suggestion(&suggestions.items[1], "search", 2U);
+  assert_suggestion(&suggestions.items[2], "sea", 1U);
+  assert_int_equal(YAP_V2_suggestions_copy(&suggestions, 1U, &copy), YAP_V2_OK);
+  assert_int_equal(copy.count, 1U);
+  assert_suggestion(&copy.items[0], "seal", 2U);
+  assert_int_equal(YAP_V2_suggest_terms(views, 3U, bytes("s"), YAP_V2_SUGGEST_MAX_TERMS,
+                                        &suggestions),
+                   YAP_V2_OK);
+  assert_int_equal(suggestions.count, 4U);
+  assert_suggestion(&suggestions.items[3], "season", 1U);
+  assert_int_equal(YAP_V2_suggest_terms(views, 3U, bytes("seb"), 3U, &suggestions), YAP_V2_OK);
+  assert_int_equal(suggestions.count, 0U);
+  assert_int_equal(YAP_V2_suggest_terms(views, 3U, bytes("zz"), 3U, &suggestions), YAP_V2_OK);
+  assert_int_equal(suggestions.count, 0U);
+  assert_int_equal(YAP_V2_suggest_terms(views, 3U, bytes(""), 3U, &suggestions),
+                   YAP_V2_INVALID_ARGUMENT);
+  assert_int_equal(YAP_V2_suggest_terms(views, 3U, bytes("sea"), YAP_V2_SUGGEST_MAX_TERMS + 1U,
+                                        &suggestions),
+                   YAP_V2_INVALID_ARGUMENT);
+  YAP_V2_suggestions_free(&copy);
+  YAP_V2_suggestions_free(&suggestions);
+  YAP_V2_lexical_segment_close(&segments[0]);
+  YAP_V2_lexical_segment_close(&segments[1]);
+  ytest_env_destroy(&env);
+}
+
+static void search_segment(const YAP_V2_LEXICAL_SEGMENT *segment, const char *query,
+                           const char *const *expansions, size_t expansion_count,
+                           YAP_V2_QUERY_OPERATOR query_operator, YAP_V2_LEXICAL_HIT *hits,
+                           size_t *count) {
+  YAP_V2_LEXICAL_QUERY_PLAN plan;
+  YAP_V2_LEXICAL_SEARCH_OPTIONS options;
+  YAP_V2_LEXICAL_CORPUS_STATS stats;
+  YAP_V2_BYTES_VIEW terms[4];
+  const YAP_V2_LEXICAL_SEGMENT *segments[1];
+  size_t i;
+  memset(&stats, 0, sizeof(stats));
+  stats.document_count = segment->document_count;
+  memcpy(stats.field_token_count, segment->field_token_count, sizeof(stats.field_token_count));
+  for (i = 0U; i < expansion_count; i++)
+    terms[i] = bytes(expansions[i]);
+  segments[0] = segment;
+  YAP_V2_lexical_query_plan_init(&plan);
+  assert_int_equal(YAP_V2_lexical_query_plan_prepare(bytes(query), &plan), YAP_V2_OK);
+  assert_int_equal(YAP_V2_lexical_query_plan_expand(&plan, terms, expansion_count), YAP_V2_OK);
+  assert_int_equal(YAP_V2_lexical_query_plan_bind(&plan, segments, 1U), YAP_V2_OK);
+  YAP_V2_lexical_search_options_init(&options);
+  options.object_type = YAP_V2_LEXICAL_DOCUMENT;
+  options.query_operator = query_operator;
+  options.top_k = 10U;
+  assert_int_equal(YAP_V2_lexical_search_prepared(&plan, 0U, &stats, &options, hits, 10U, count),
+                   YAP_V2_OK);
+  options.phrase = 1;
+  assert_int_equal(YAP_V2_lexical_search_prepared(&plan, 0U, &stats, &options, hits, 10U, count),
+                   query_operator == YAP_V2_QUERY_PREFIX ? YAP_V2_INVALID_ARGUMENT : YAP_V2_OK);
+  options.phrase = 0;
+  assert_int_equal(YAP_V2_lexical_search_prepared(&plan, 0U, &stats, &options, hits, 10U, count),
+                   YAP_V2_OK);
+  YAP_V2_lexical_query_plan_free(&plan);
+}
+
+static void test_prefix_plan_searches_expansions(void **state) {
+  static const char *const expansions[] = {"seal", "search", "engine", "season"};
+  ytest_env_t env;
+  YAP_V2_LEXICAL_SEGMENT segments[2];
+  YAP_V2_LEXICAL_HIT hits[10];
+  size_t count;
+  (void)state;
+  assert_int_equal(ytest_env_init(&env), 0);
+  open_fixture(&env, segments);
+  search_segment(&segments[0], "engine sea", NULL, 0U, YAP_V2_QUERY_OR, hits, &count);
+  assert_int_equal(count, 1U);
+  assert_int_equal(hits[0].object_ordinal, 0U);
+  search_segment(&segments[0], "engine sea", expansions, 4U, YAP_V2_QUERY_PREFIX, hits, &count);
+  assert_int_equal(count, 2U);
+  assert_int_equal(hits[0].object_ordinal, 0U);
+  assert_int_equal(hits[0].matched_terms, 3U);
+  assert_int_equal(hits[1].object_ordinal, 1U);
+  assert_int_equal(hits[1].matched_terms, 2U);
+  YAP_V2_lexical_segment_close(&segments[0]);
+  YAP_V2_lexical_segment_close(&segments[1]);
+  ytest_env_destroy(&env);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_suggest_sums_frequencies_across_segments),
+    cmocka_unit_test(test_prefix_plan_searches_expansions),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -17,6 +17,7 @@ static void test_parse_query_head(void **state) {
     "Content-Type: application/json; charset=utf-8\r\n"
     "Content-Length: 2\r\n"
     "Authorization: Bearer test-token\r\n"
+    "X-Yappo-Timeout-Ms: 250\r\n"
     "Connection: close\r\n\r\n";
   YAP_V2_CORE_HTTP_REQUEST request;
   (void)state;
@@ -30,6 +31,7 @@ static void test_parse_query_head(void **state) {
   assert_true(request.json_content_type);
   assert_true(request.close_connection);
   assert_string_equal(request.authorization, "Bearer test-token");
+  assert_int_equal(request.timeout_ms, 250U);
   YAP_V2_core_http_request_free(&request);
 }
 
@@ -51,8 +53,14 @@ static void test_parse_rejects_invalid_heads(void **state) {
   static const char duplicate_connection[] =
     "QUERY /v2/search HTTP/1.1\r\nHost: localhost\r\n"
     "Connection: close\r\nConnection: keep-alive\r\n\r\n";
+  static const char zero_timeout[] =
+    "QUERY /v2/search HTTP/1.1\r\nHost: localhost\r\nX-Yappo-Timeout-Ms: 0\r\n\r\n";
+  static const char duplicate_timeout[] =
+    "QUERY /v2/search HTTP/1.1\r\nHost: localhost\r\n"
+    "X-Yappo-Timeout-Ms: 10\r\nX-Yappo-Timeout-Ms: 10\r\n\r\n";
   const char *cases[] = {missing_host, old_version, transfer_encoding, duplicate_length,
-                         signed_length, invalid_header_name, duplicate_connection};
+                         signed_length, invalid_header_name, duplicate_connection,
+                         zero_timeout, duplicate_timeout};
   size_t i;
   YAP_V2_CORE_HTTP_REQUEST request;
   (void)state;
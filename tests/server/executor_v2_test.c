@@ -158,11 +158,164 @@ static void test_batch_executor_rejects_overflow_and_drains_on_close(
   assert_int_equal(pthread_mutex_destroy(&state.lock), 0);
 }
 
+typedef struct {
+  YAP_V2_EXECUTOR *executor;
+  pthread_mutex_t lock;
+  size_t children;
+  size_t pending;
+  size_t parents;
+} FAN_OUT_STATE;
+
+static void run_fan_out_child(void *opaque) {
+  FAN_OUT_STATE *state = opaque;
+  pthread_mutex_lock(&state->lock);
+  state->children++;
+  state->pending--;
+  pthread_mutex_unlock(&state->lock);
+}
+
+static void run_fan_out_parent(void *opaque) {
+  FAN_OUT_STATE *state = opaque;
+  size_t i, pending;
+  for (i = 0U; i < 8U; i++) {
+    pthread_mutex_lock(&state->lock);
+    state->pending++;
+    pthread_mutex_unlock(&state->lock);
+    if (YAP_V2_executor_try_submit(state->executor, run_fan_out_child, state) != YAP_V2_OK)
+      run_fan_out_child(state);
+  }
+  do {
+    (void)YAP_V2_executor_help(state->executor);
+    pthread_mutex_lock(&state->lock);
+    pending = state->pending;
+    pthread_mutex_unlock(&state->lock);
+  } while (pending != 0U);
+  pthread_mutex_lock(&state->lock);
+  state->parents++;
+  pthread_mutex_unlock(&state->lock);
+}
+
+static void test_work_stealing_executor_runs_fan_out_jobs(void **unused) {
+  YAP_V2_EXECUTOR executor;
+  YAP_V2_EXECUTOR_STATE snapshot;
+  FAN_OUT_STATE state;
+  size_t i, accepted = 0U;
+  (void)unused;
+  memset(&state, 0, sizeof(state));
+  assert_int_equal(pthread_mutex_init(&state.lock, NULL), 0);
+  state.executor = &executor;
+  YAP_V2_executor_init(&executor);
+  assert_int_equal(YAP_V2_executor_open(&executor, 4U, 64U), YAP_V2_OK);
+  for (i = 0U; i < 32U; i++)
+    if (YAP_V2_executor_try_submit(&executor, run_fan_out_parent, &state) == YAP_V2_OK)
+      accepted++;
+  assert_true(accepted > 0U);
+  YAP_V2_executor_close(&executor);
+  assert_int_equal(state.parents, accepted);
+  assert_int_equal(state.children, accepted * 8U);
+  assert_int_equal(YAP_V2_executor_open(&executor, 2U, 4U), YAP_V2_OK);
+  assert_int_equal(YAP_V2_executor_snapshot(&executor, &snapshot), YAP_V2_OK);
+  assert_int_equal(snapshot.worker_threads, 2U);
+  assert_int_equal(snapshot.queue_capacity, 4U);
+  assert_true(snapshot.accepting);
+  YAP_V2_executor_close(&executor);
+  assert_int_equal(pthread_mutex_destroy(&state.lock), 0);
+}
+
+typedef struct {
+  pthread_mutex_t lock;
+  char order[8];
+  size_t count;
+} ORDER_STATE;
+
+typedef struct {
+  ORDER_STATE *order;
+  char name;
+} ORDER_JOB;
+
+static void record_order(ORDER_JOB *job, char name) {
+  pthread_mutex_lock(&job->order->lock);
+  if (job->order->count + 1U < sizeof(job->order->order))
+    job->order->order[job->order->count++] = name;
+  pthread_mutex_unlock(&job->order->lock);
+}
+
+static void run_order_job(void *opaque) {
+  ORDER_JOB *job = opaque;
+  record_order(job, job->name);
+}
+
+static void expire_order_job(void *opaque) {
+  ORDER_JOB *job = opaque;
+  record_order(job, 'x');
+}
+
+static void test_executor_runs_earliest_deadline_first_and_expires_late_jobs(
+    void **unused) {
+  YAP_V2_EXECUTOR executor;
+  YAP_V2_EXECUTOR_STATE snapshot;
+  JOB_STATE blocker;
+  ORDER_STATE order;
+  ORDER_JOB late = {NULL, 'L'}, expired = {NULL, 'E'}, none = {NULL, 'N'},
+            soon = {NULL, 'S'};
+  uint64_t now = YAP_V2_cancellation_clock_microseconds();
+  (void)unused;
+  memset(&order, 0, sizeof(order));
+  assert_int_equal(pthread_mutex_init(&order.lock, NULL), 0);
+  late.order = expired.order = none.order = soon.order = &order;
+  blocker.entered = 0U;
+  blocker.finished = 0U;
+  blocker.blocked = 1;
+  assert_int_equal(pthread_mutex_init(&blocker.lock, NULL), 0);
+  assert_int_equal(pthread_cond_init(&blocker.release, NULL), 0);
+  YAP_V2_executor_init(&executor);
+  assert_int_equal(YAP_V2_executor_open(&executor, 1U, 8U), YAP_V2_OK);
+  assert_int_equal(YAP_V2_executor_try_submit(&executor, run_job, &blocker), YAP_V2_OK);
+  for (;;) {
+    pthread_mutex_lock(&blocker.lock);
+    if (blocker.entered == 1U) {
+      pthread_mutex_unlock(&blocker.lock);
+      break;
+    }
+    pthread_mutex_unlock(&blocker.lock);
+  }
+  assert_int_equal(YAP_V2_executor_try_submit_deadline(&executor, run_order_job, NULL,
+                                                       &none, 1U),
+                   YAP_V2_INVALID_ARGUMENT);
+  assert_int_equal(YAP_V2_executor_try_submit(&executor, run_order_job, &none), YAP_V2_OK);
+  assert_int_equal(YAP_V2_executor_try_submit_deadline(&executor, run_order_job,
+                                                       expire_order_job, &late,
+                                                       now + 600000000U),
+                   YAP_V2_OK);
+  assert_int_equal(YAP_V2_executor_try_submit_deadline(&executor, run_order_job,
+                                                       expire_order_job, &expired, 1U),
+                   YAP_V2_OK);
+  assert_int_equal(YAP_V2_executor_try_submit_deadline(&executor, run_order_job,
+                                                       expire_order_job, &soon,
+                                                       now + 2000000U),
+                   YAP_V2_OK);
+  pthread_mutex_lock(&blocker.lock);
+  blocker.blocked = 0;
+  pthread_cond_broadcast(&blocker.release);
+  pthread_mutex_unlock(&blocker.lock);
+  while (YAP_V2_executor_snapshot(&executor, &snapshot) == YAP_V2_OK &&
+         snapshot.completed < 5U) {
+  }
+  assert_int_equal(snapshot.expired, 1U);
+  YAP_V2_executor_close(&executor);
+  assert_string_equal(order.order, "xSLN");
+  assert_int_equal(pthread_cond_destroy(&blocker.release), 0);
+  assert_int_equal(pthread_mutex_destroy(&blocker.lock), 0);
+  assert_int_equal(pthread_mutex_destroy(&order.lock), 0);
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_bounded_executor_drains_and_rejects_overflow),
     cmocka_unit_test(test_batch_executor_groups_and_drains),
     cmocka_unit_test(test_batch_executor_rejects_overflow_and_drains_on_close),
+    cmocka_unit_test(test_work_stealing_executor_runs_fan_out_jobs),
+    cmocka_unit_test(test_executor_runs_earliest_deadline_first_and_expires_late_jobs),
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <cmocka.h>
 #include <yyjson.h>
@@ -18,6 +19,7 @@
 #include "components/yappo_metadata_v2.h"
 #include "components/yappo_vector_v2.h"
 #include "indexing/yappo_compact_v2.h"
+#include "indexing/yappo_memtable_v2.h"
 
 static YAP_V2_BYTES_VIEW bytes(const char *text) {
   YAP_V2_BYTES_VIEW value = {(const unsigned char *)text, strlen(text)}; return value;
@@ -260,6 +262,82 @@ static void test_real_search_and_retrieve_runtime(void **state) {
   yyjson_doc_free(document); ytest_env_destroy(&env);
 }
 
+static void test_search_profile_is_returned_on_request(void **state) {
+  ytest_env_t env; yyjson_doc *document; yyjson_val *root, *profile, *lexical, *segment, *ann;
+  (void)state; assert_int_equal(ytest_env_init(&env), 0); create_index(&env);
+  document = execute(&env, YAP_V2_HTTP_SEARCH,
+    "{\"query\":\"apple\",\"vector\":[1,0],\"mode\":\"hybrid\",\"scope\":\"documents\","
+    "\"filter\":{\"eq\":{\"field\":\"category\",\"value\":\"fruit\"}},\"limit\":1,"
+    "\"profile\":true}", 200);
+  root = yyjson_doc_get_root(document); profile = yyjson_obj_get(root, "profile");
+  assert_true(yyjson_is_obj(profile));
+  assert_true(yyjson_is_uint(yyjson_obj_get(profile, "parse_microseconds")));
+  assert_true(yyjson_is_uint(yyjson_obj_get(profile, "lexical_microseconds")));
+  assert_true(yyjson_is_uint(yyjson_obj_get(profile, "vector_microseconds")));
+  assert_true(yyjson_is_uint(yyjson_obj_get(profile, "fusion_microseconds")));
+  assert_true(yyjson_is_uint(yyjson_obj_get(profile, "render_microseconds")));
+  lexical = yyjson_obj_get(profile, "lexical");
+  assert_true(yyjson_get_uint(yyjson_obj_get(lexical, "postings_decoded")) >= 2U);
+  assert_int_equal(yyjson_get_uint(yyjson_obj_get(lexical, "postings_decoded")),
+                   yyjson_get_uint(yyjson_obj_get(lexical, "postings_scored")) +
+                   yyjson_get_uint(yyjson_obj_get(lexical, "postings_skipped")));
+  assert_int_equal(yyjson_get_uint(yyjson_obj_get(lexical, "filter_evaluations")), 2U);
+  assert_int_equal(yyjson_arr_size(yyjson_obj_get(lexical, "segments")), 1U);
+  segment = yyjson_arr_get_first(yyjson_obj_get(lexical, "segments"));
+  assert_int_equal(yyjson_get_uint(yyjson_obj_get(segment, "segment")), 0U);
+  assert_int_equal(yyjson_get_uint(yyjson_obj_get(segment, "hits")), 1U);
+  assert_int_equal(yyjson_get_uint(yyjson_obj_get(segment, "filter_evaluations")), 2U);
+  ann = yyjson_obj_get(profile, "ann");
+  assert_true(yyjson_get_uint(yyjson_obj_get(ann, "base_search_calls")) +
+              yyjson_get_uint(yyjson_obj_get(ann, "delta_search_calls")) >= 1U);
+  assert_true(yyjson_get_uint(yyjson_obj_get(ann, "max_k")) >= 1U);
+  yyjson_doc_free(document);
+  document = execute(&env, YAP_V2_HTTP_SEARCH,
+    "{\"query\":\"apple\",\"mode\":\"lexical\",\"profile\":false}", 200);
+  assert_null(yyjson_obj_get(yyjson_doc_get_root(document), "profile"));
+  yyjson_doc_free(document);
+  document = execute(&env, YAP_V2_HTTP_SEARCH,
+    "{\"query\":\"apple\",\"mode\":\"lexical\",\"profile\":1}", 400);
+  yyjson_doc_free(document);
+  document = execute(&env, YAP_V2_HTTP_RETRIEVE,
+    "{\"query\":\"apple\",\"mode\":\"lexical\",\"limit\":1,\"profile\":true}", 200);
+  profile = yyjson_obj_get(yyjson_doc_get_root(document), "profile");
+  assert_true(yyjson_is_obj(profile));
+  assert_int_equal(yyjson_get_uint(yyjson_obj_get(yyjson_obj_get(profile, "ann"), "max_k")), 0U);
+  yyjson_doc_free(document); ytest_env_destroy(&env);
+}
+
+static void test_suggest_and_prefix_operator(void **state) {
+  ytest_env_t env; yyjson_doc *document; yyjson_val *root, *suggestion, *result;
+  (void)state; assert_int_equal(ytest_env_init(&env), 0); create_index(&env);
+  document = execute(&env, YAP_V2_HTTP_SUGGEST, "{\"prefix\":\"AP\",\"limit\":1}", 200);
+  root = yyjson_doc_get_root(document);
+  assert_int_equal(yyjson_get_uint(yyjson_obj_get(root, "generation")), 1U);
+  assert_string_equal(yyjson_get_str(yyjson_obj_get(root, "prefix")), "ap");
+  assert_int_equal(yyjson_arr_size(yyjson_obj_get(root, "suggestions")), 1U);
+  suggestion = yyjson_arr_get_first(yyjson_obj_get(root, "suggestions"));
+  assert_string_equal(yyjson_get_str(yyjson_obj_get(suggestion, "term")), "apple");
+  assert_true(yyjson_get_uint(yyjson_obj_get(suggestion, "document_frequency")) >= 2U);
+  yyjson_doc_free(document);
+  document = execute(&env, YAP_V2_HTTP_SUGGEST, "{\"prefix\":\"zz\"}", 200);
+  assert_int_equal(yyjson_arr_size(yyjson_obj_get(yyjson_doc_get_root(document), "suggestions")), 0U);
+  yyjson_doc_free(document);
+  document = execute(&env, YAP_V2_HTTP_SUGGEST, "{\"prefix\":\"ap\",\"limit\":33}", 400);
+  yyjson_doc_free(document);
+  document = execute(&env, YAP_V2_HTTP_SUGGEST, "{\"prefix\":\"\"}", 400);
+  yyjson_doc_free(document);
+  document = execute(&env, YAP_V2_HTTP_SEARCH,
+    "{\"query\":\"comp\",\"mode\":\"lexical\",\"operator\":\"prefix\"}", 200);
+  root = yyjson_doc_get_root(document);
+  assert_int_equal(yyjson_arr_size(yyjson_obj_get(root, "results")), 1U);
+  result = yyjson_arr_get_first(yyjson_obj_get(root, "results"));
+  assert_string_equal(yyjson_get_str(yyjson_obj_get(result, "id")), "doc-tech");
+  yyjson_doc_free(document);
+  document = execute(&env, YAP_V2_HTTP_SEARCH,
+    "{\"query\":\"comp\",\"mode\":\"lexical\",\"operator\":\"prefix\",\"phrase\":true}", 400);
+  yyjson_doc_free(document); ytest_env_destroy(&env);
+}
+
 static void test_runtime_reload_reuses_reorders_and_replaces_segments(void **state) {
   static const char ingest[] =
     "{\"operations\":[{\"operation\":\"upsert\",\"id\":\"doc-live\","
@@ -358,7 +436,8 @@ static void test_ann_base_delta_update_delete_and_rebuild(void **state) {
   assert_int_equal(operational.ann_base_generation, 10U);
   assert_int_equal(operational.ann_base_vectors, 3U);
   assert_int_equal(operational.ann_delta_segments, 0U);
-  assert_true(operational.ann_rebuilds >= 2U);
+  assert_true(operational.ann_rebuilds >= 1U);
+  assert_int_equal(operational.ann_incremental_updates, 1U);
   assert_runtime_vector_id(&runtime, 0.6f, 0.8f, NULL, "doc-live", 10U);
 
   {
@@ -399,6 +478,42 @@ static void test_ann_base_delta_update_delete_and_rebuild(void **state) {
   assert_int_equal(operational.ann_delta_segments, 2U);
   assert_int_equal(operational.ann_rebuilds, 0U);
   assert_runtime_vector_id(&runtime, 0.8f, 0.6f, NULL, "doc-fruit", 12U);
+  /* The cached graph is mapped only after maintenance has compared its CRC32C. */
+  assert_int_equal(YAP_V2_http_runtime_state(&runtime, &operational), YAP_V2_OK);
+  assert_int_equal(operational.ann_base_search_calls, 0U);
+  assert_int_equal(YAP_V2_http_runtime_maintain_ann(&runtime), YAP_V2_OK);
+  assert_runtime_vector_id(&runtime, 0.8f, 0.6f, NULL, "doc-fruit", 12U);
+  assert_int_equal(YAP_V2_http_runtime_state(&runtime, &operational), YAP_V2_OK);
+  assert_int_equal(operational.ann_base_generation, 10U);
+  assert_int_equal(operational.ann_rebuilds, 0U);
+  assert_true(operational.ann_base_search_calls >= 1U);
+  YAP_V2_http_runtime_close(&runtime);
+
+  {
+    char cache_path[PATH_MAX];
+    FILE *cache_file;
+    long middle;
+    int byte;
+    assert_int_equal(ytest_path_join(cache_path, sizeof(cache_path), env.tmp_root,
+                                     "ann-base.usearch"), 0);
+    cache_file = fopen(cache_path, "r+b");
+    assert_non_null(cache_file);
+    assert_int_equal(fseek(cache_file, 0L, SEEK_END), 0);
+    middle = ftell(cache_file) / 2L;
+    assert_int_equal(fseek(cache_file, middle, SEEK_SET), 0);
+    byte = fgetc(cache_file);
+    assert_true(byte != EOF);
+    assert_int_equal(fseek(cache_file, middle, SEEK_SET), 0);
+    assert_int_equal(fputc(byte ^ 0xff, cache_file), byte ^ 0xff);
+    assert_int_equal(fclose(cache_file), 0);
+  }
+  YAP_V2_http_runtime_init(&runtime);
+  assert_int_equal(YAP_V2_http_runtime_open(&runtime, env.tmp_root), YAP_V2_OK);
+  assert_int_equal(YAP_V2_http_runtime_maintain_ann(&runtime), YAP_V2_OK);
+  assert_int_equal(YAP_V2_http_runtime_state(&runtime, &operational), YAP_V2_OK);
+  assert_int_equal(operational.ann_base_generation, 12U);
+  assert_int_equal(operational.ann_rebuilds, 1U);
+  assert_runtime_vector_id(&runtime, 0.8f, 0.6f, NULL, "doc-fruit", 12U);
   YAP_V2_http_runtime_close(&runtime);
   ytest_env_destroy(&env);
 }
@@ -458,6 +573,7 @@ static void test_ingest_batch_publishes_one_generation(void **state) {
   assert_int_equal(operational.ingest_generations_saved, 1U);
   assert_int_equal(operational.ingest_max_batch_requests, 2U);
   assert_int_equal(operational.ingest_max_batch_operations, 2U);
+  assert_true(operational.ingest_publish_microseconds > 0U);
   YAP_V2_http_runtime_record_maintenance_deferral(&runtime);
   assert_int_equal(YAP_V2_http_runtime_state(&runtime, &operational),
                    YAP_V2_OK);
@@ -468,11 +584,141 @@ static void test_ingest_batch_publishes_one_generation(void **state) {
   ytest_env_destroy(&env);
 }
 
+static void test_memtable_buffers_ingest_until_flush(void **state) {
+  static const char first[] =
+    "{\"operations\":[{\"operation\":\"upsert\",\"id\":\"doc-memtable\","
+    "\"body\":\"buffered alpha\",\"vectors\":[[1,0]]}]}";
+  static const char second[] =
+    "{\"operations\":[{\"operation\":\"upsert\",\"id\":\"doc-memtable\","
+    "\"body\":\"buffered gamma\",\"vectors\":[[0,1]]}]}";
+  ytest_env_t env;
+  YAP_V2_HTTP_RUNTIME runtime;
+  YAP_V2_HTTP_INGEST_ITEM item;
+  YAP_V2_OPERATIONAL_STATE operational;
+  YAP_V2_MANIFEST manifest;
+  char path[PATH_MAX];
+  (void)state;
+  assert_int_equal(ytest_env_init(&env), 0);
+  create_index(&env);
+  YAP_V2_http_set_memtable_policy(4U, 3600000U);
+  YAP_V2_http_runtime_init(&runtime);
+  assert_int_equal(YAP_V2_http_runtime_open(&runtime, env.tmp_root), YAP_V2_OK);
+  memset(&item, 0, sizeof(item));
+  item.body = (const unsigned char *)first;
+  item.body_bytes = sizeof(first) - 1U;
+  assert_int_equal(YAP_V2_http_runtime_execute_ingest_batch(&runtime, &item, 1U), YAP_V2_OK);
+  assert_int_equal(item.http_status, 200);
+  free(item.response);
+  assert_runtime_search_id(&runtime, "alpha", "doc-memtable", 1U);
+  memset(&item, 0, sizeof(item));
+  item.body = (const unsigned char *)second;
+  item.body_bytes = sizeof(second) - 1U;
+  assert_int_equal(YAP_V2_http_runtime_execute_ingest_batch(&runtime, &item, 1U), YAP_V2_OK);
+  assert_int_equal(item.http_status, 200);
+  free(item.response);
+  assert_runtime_search_id(&runtime, "gamma", "doc-memtable", 1U);
+  assert_int_equal(ytest_path_join(path, sizeof(path), env.tmp_root, "update.wal"), 0);
+  assert_int_equal(access(path, F_OK), 0);
+  assert_int_equal(ytest_path_join(path, sizeof(path), env.tmp_root, "manifest.yap2"), 0);
+  YAP_V2_manifest_init(&manifest);
+  assert_int_equal(YAP_V2_manifest_load(path, &manifest), YAP_V2_OK);
+  assert_int_equal(manifest.generation, 1U);
+  YAP_V2_manifest_free(&manifest);
+  assert_int_equal(YAP_V2_http_runtime_state(&runtime, &operational), YAP_V2_OK);
+  assert_int_equal(operational.memtable_operations, 1U);
+  assert_int_equal(operational.memtable_flushes, 0U);
+  YAP_V2_http_set_memtable_policy(4U, 0U);
+  assert_int_equal(YAP_V2_http_runtime_maintain_memtable(&runtime), YAP_V2_OK);
+  YAP_V2_manifest_init(&manifest);
+  assert_int_equal(YAP_V2_manifest_load(path, &manifest), YAP_V2_OK);
+  assert_int_equal(manifest.generation, 2U);
+  YAP_V2_manifest_free(&manifest);
+  assert_int_equal(ytest_path_join(path, sizeof(path), env.tmp_root, "update.wal"), 0);
+  assert_int_not_equal(access(path, F_OK), 0);
+  assert_int_equal(YAP_V2_http_runtime_state(&runtime, &operational), YAP_V2_OK);
+  assert_int_equal(operational.memtable_operations, 0U);
+  assert_int_equal(operational.memtable_flushes, 1U);
+  assert_runtime_search_id(&runtime, "gamma", "doc-memtable", 2U);
+  YAP_V2_http_runtime_close(&runtime);
+  YAP_V2_http_set_memtable_policy(0U, 1000U);
+  ytest_env_destroy(&env);
+}
+
+static void assert_runtime_search_empty(YAP_V2_HTTP_RUNTIME *runtime, const char *query) {
+  char request[512];
+  yyjson_doc *document;
+  assert_true(snprintf(request, sizeof(request),
+    "{\"query\":\"%s\",\"mode\":\"lexical\",\"scope\":\"documents\",\"limit\":1}",
+    query) > 0);
+  document = runtime_execute(runtime, YAP_V2_HTTP_SEARCH, request, 200);
+  assert_int_equal(yyjson_arr_size(
+    yyjson_obj_get(yyjson_doc_get_root(document), "results")), 0U);
+  yyjson_doc_free(document);
+}
+
+static void ingest_one(YAP_V2_HTTP_RUNTIME *runtime, const char *body, int expected_status) {
+  YAP_V2_HTTP_INGEST_ITEM item;
+  memset(&item, 0, sizeof(item));
+  item.body = (const unsigned char *)body;
+  item.body_bytes = strlen(body);
+  assert_int_equal(YAP_V2_http_runtime_execute_ingest_batch(runtime, &item, 1U), YAP_V2_OK);
+  assert_int_equal(item.http_status, expected_status);
+  free(item.response);
+}
+
+static void test_memtable_rolls_back_updates_when_wal_sync_fails(void **state) {
+  static const char kept[] =
+    "{\"operations\":[{\"operation\":\"upsert\",\"id\":\"doc-kept\","
+    "\"body\":\"buffered alpha\",\"vectors\":[[1,0]]}]}";
+  static const char request_lost[] =
+    "{\"operations\":[{\"operation\":\"upsert\",\"id\":\"doc-request-lost\","
+    "\"body\":\"buffered zeta\",\"vectors\":[[0,1]]}]}";
+  static const char batch_lost[] =
+    "{\"operations\":[{\"operation\":\"upsert\",\"id\":\"doc-kept\","
+    "\"body\":\"buffered theta\",\"vectors\":[[0,1]]}]}";
+  ytest_env_t env;
+  YAP_V2_HTTP_RUNTIME runtime;
+  YAP_V2_OPERATIONAL_STATE operational;
+  (void)state;
+  assert_int_equal(ytest_env_init(&env), 0);
+  create_index(&env);
+  YAP_V2_http_set_memtable_policy(4U, 3600000U);
+  YAP_V2_http_set_wal_durability(YAP_V2_WAL_SYNC_REQUEST, YAP_V2_DEFAULT_WAL_SYNC_INTERVAL_MS);
+  YAP_V2_http_runtime_init(&runtime);
+  assert_int_equal(YAP_V2_http_runtime_open(&runtime, env.tmp_root), YAP_V2_OK);
+  ingest_one(&runtime, kept, 200);
+  assert_runtime_search_id(&runtime, "alpha", "doc-kept", 1U);
+  YAP_V2_memtable_set_failpoint_for_testing("before_wal_sync");
+  ingest_one(&runtime, request_lost, 503);
+  assert_runtime_search_empty(&runtime, "zeta");
+  YAP_V2_http_set_wal_durability(YAP_V2_WAL_SYNC_BATCH, YAP_V2_DEFAULT_WAL_SYNC_INTERVAL_MS);
+  ingest_one(&runtime, batch_lost, 503);
+  YAP_V2_memtable_set_failpoint_for_testing(NULL);
+  assert_runtime_search_empty(&runtime, "theta");
+  assert_runtime_search_id(&runtime, "alpha", "doc-kept", 1U);
+  assert_int_equal(YAP_V2_http_runtime_state(&runtime, &operational), YAP_V2_OK);
+  assert_int_equal(operational.memtable_operations, 1U);
+  /* Reopening replays update.wal, so the dropped records must be gone from it as well. */
+  YAP_V2_http_runtime_close(&runtime);
+  YAP_V2_http_runtime_init(&runtime);
+  assert_int_equal(YAP_V2_http_runtime_open(&runtime, env.tmp_root), YAP_V2_OK);
+  assert_runtime_search_id(&runtime, "alpha", "doc-kept", 2U);
+  assert_runtime_search_empty(&runtime, "zeta");
+  assert_runtime_search_empty(&runtime, "theta");
+  YAP_V2_http_runtime_close(&runtime);
+  YAP_V2_http_set_memtable_policy(0U, 1000U);
+  ytest_env_destroy(&env);
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_real_search_and_retrieve_runtime),
+    cmocka_unit_test(test_search_profile_is_returned_on_request),
+    cmocka_unit_test(test_suggest_and_prefix_operator),
     cmocka_unit_test(test_runtime_reload_reuses_reorders_and_replaces_segments),
     cmocka_unit_test(test_ingest_batch_publishes_one_generation),
+    cmocka_unit_test(test_memtable_buffers_ingest_until_flush),
+    cmocka_unit_test(test_memtable_rolls_back_updates_when_wal_sync_fails),
     cmocka_unit_test(test_ann_base_delta_update_delete_and_rebuild)
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
@@ -37,7 +37,8 @@ static void make_empty_index(ytest_env_t *env) {
 
 static void test_probe_json_and_compaction_status(void **state) {
   ytest_env_t env; YAP_V2_OPERATIONAL_STATE operational, merged; char *json = NULL; size_t json_bytes = 0U;
-  char path[PATH_MAX], error[256] = {0}; (void)state;
+  char path[PATH_MAX], error[256] = {0};
+  const YAP_V2_COMPACTION_ANN_REPORT ann_report = {1500000U, 30U, 6U}; (void)state;
   assert_int_equal(ytest_env_init(&env), 0); make_empty_index(&env);
   assert_int_equal(YAP_V2_operational_probe_index(env.tmp_root, &operational, error, sizeof(error)), YAP_V2_OK);
   assert_true(operational.ready); assert_int_equal(operational.generation, 7U);
@@ -50,16 +51,41 @@ static void test_probe_json_and_compaction_status(void **state) {
   assert_int_equal(YAP_V2_operational_probe_index(env.tmp_root, &operational, error, sizeof(error)), YAP_V2_OK);
   assert_int_equal(operational.compaction_state, YAP_V2_COMPACTION_SUCCEEDED);
   assert_int_equal(operational.compaction_generation, 8U);
+  assert_int_equal(operational.compaction_ann_reused_vectors, 0U);
+  assert_int_equal(YAP_V2_compaction_status_write_report(env.tmp_root, YAP_V2_COMPACTION_SUCCEEDED,
+                                                         8U, &ann_report), YAP_V2_OK);
+  assert_int_equal(YAP_V2_operational_probe_index(env.tmp_root, &operational, error, sizeof(error)), YAP_V2_OK);
+  assert_int_equal(operational.compaction_state, YAP_V2_COMPACTION_SUCCEEDED);
+  assert_int_equal(operational.compaction_ann_build_microseconds, 1500000U);
+  assert_int_equal(operational.compaction_ann_reused_vectors, 30U);
+  assert_int_equal(operational.compaction_ann_inserted_vectors, 6U);
   operational.ingest_microbatches = 3U;
   operational.ingest_generations_saved = 2U;
   operational.maintenance_foreground_deferrals = 4U;
+  operational.ann_last_build_vectors = 2000U;
+  operational.ann_last_build_microseconds = 250000U;
+  operational.ingest_parse_microseconds = 1200U;
+  operational.ingest_publish_microseconds = 56000U;
+  operational.search_deadline_expired = 5U;
+  operational.search_cancelled = 6U;
+  operational.core_concurrency_limit = 12U;
+  operational.core_rtt_noload_microseconds = 900U;
+  operational.core_admission_rejected = 4U;
+  operational.search_stages[YAP_V2_SEARCH_STAGE_LEXICAL].count = 4U;
+  operational.search_stages[YAP_V2_SEARCH_STAGE_LEXICAL].microseconds = 900U;
+  operational.search_stages[YAP_V2_SEARCH_STAGE_LEXICAL].quantiles[2] = 300U;
   assert_int_equal(YAP_V2_operational_state_json(&operational, "test-service", &json, &json_bytes), YAP_V2_OK);
   assert_non_null(strstr(json, "\"generation\":7")); assert_non_null(strstr(json, "\"precomputed_ready\""));
   assert_non_null(strstr(json, "\"succeeded\""));
+  assert_non_null(strstr(json, "\"ann_reused_vectors\":30"));
   assert_non_null(strstr(json, "\"segment_health\""));
   assert_non_null(strstr(json, "\"ann\""));
   assert_non_null(strstr(json, "\"update_pipeline\""));
+  assert_non_null(strstr(json, "\"search_scheduling\""));
+  assert_non_null(strstr(json, "\"search_stages\""));
+  assert_non_null(strstr(json, "\"queue_wait\""));
   assert_non_null(strstr(json, "\"base_search_calls\":0"));
+  assert_non_null(strstr(json, "\"last_build_vectors_per_second\":8000"));
   assert_non_null(strstr(json, "\"small_segment_threshold_bytes\":67108864"));
   YAP_V2_operational_state_init(&merged);
   assert_int_equal(YAP_V2_operational_state_merge_core_json(
@@ -68,6 +94,18 @@ static void test_probe_json_and_compaction_status(void **state) {
   assert_int_equal(merged.ingest_microbatches, 3U);
   assert_int_equal(merged.ingest_generations_saved, 2U);
   assert_int_equal(merged.maintenance_foreground_deferrals, 4U);
+  assert_int_equal(merged.ann_last_build_vectors, 2000U);
+  assert_int_equal(merged.ann_last_build_microseconds, 250000U);
+  assert_int_equal(merged.ingest_parse_microseconds, 1200U);
+  assert_int_equal(merged.ingest_publish_microseconds, 56000U);
+  assert_int_equal(merged.search_deadline_expired, 5U);
+  assert_int_equal(merged.search_cancelled, 6U);
+  assert_int_equal(merged.core_concurrency_limit, 12U);
+  assert_int_equal(merged.core_rtt_noload_microseconds, 900U);
+  assert_int_equal(merged.core_admission_rejected, 4U);
+  assert_int_equal(merged.search_stages[YAP_V2_SEARCH_STAGE_LEXICAL].count, 4U);
+  assert_int_equal(merged.search_stages[YAP_V2_SEARCH_STAGE_LEXICAL].microseconds, 900U);
+  assert_int_equal(merged.search_stages[YAP_V2_SEARCH_STAGE_LEXICAL].quantiles[2], 300U);
   assert_int_equal(strlen(json), json_bytes); free(json);
   assert_int_equal(ytest_path_join(path, sizeof(path), env.tmp_root, "compaction.state"), 0);
   write_text(path, "invalid\n");
@@ -118,6 +156,9 @@ static void test_metrics_are_thread_safe_and_bounded(void **state) {
   operational.ann_candidates_rejected = 25U;
   operational.ann_rebuilds = 4U;
   operational.ann_rebuild_failures = 1U;
+  operational.ann_incremental_updates = 6U;
+  operational.ann_last_build_vectors = 75U;
+  operational.ann_last_build_microseconds = 500000U;
   operational.ingest_microbatches = 5U;
   operational.ingest_requests = 12U;
   operational.ingest_operations = 30U;
@@ -125,7 +166,23 @@ static void test_metrics_are_thread_safe_and_bounded(void **state) {
   operational.ingest_generations_saved = 5U;
   operational.ingest_max_batch_requests = 4U;
   operational.ingest_max_batch_operations = 9U;
+  operational.ingest_parse_microseconds = 250000U;
+  operational.ingest_publish_microseconds = 1500000U;
   operational.update_wal_recoveries = 2U;
+  operational.memtable_operations = 13U;
+  operational.memtable_flushes = 3U;
+  operational.wal_appends = 6U;
+  operational.search_deadline_expired = 7U;
+  operational.search_cancelled = 8U;
+  operational.front_concurrency_limit = 9U;
+  operational.core_concurrency_limit = 11U;
+  operational.core_rtt_noload_microseconds = 1500U;
+  operational.front_admission_rejected = 3U;
+  operational.search_stages[YAP_V2_SEARCH_STAGE_QUEUE_WAIT].count = 10U;
+  operational.search_stages[YAP_V2_SEARCH_STAGE_QUEUE_WAIT].microseconds = 5000U;
+  operational.search_stages[YAP_V2_SEARCH_STAGE_QUEUE_WAIT].quantiles[2] = 2047U;
+  YAP_V2_wal_fsync_histogram_record(&operational.wal_fsync, 700U);
+  YAP_V2_wal_fsync_histogram_record(&operational.wal_fsync, 200000U);
   operational.maintenance_foreground_deferrals = 11U;
   assert_int_equal(YAP_V2_metrics_render(&metrics, &operational, 2U, 100U, 4U, 4096U,
                                          &output, &output_bytes), YAP_V2_OK);
@@ -134,6 +191,14 @@ static void test_metrics_are_thread_safe_and_bounded(void **state) {
   assert_non_null(strstr(output, "yappod_v2_requests_total{operation=\"ingest\",status_class=\"4xx\"} 1"));
   assert_non_null(strstr(output, "operation=\"search\",le=\"0.010\"} 1000"));
   assert_non_null(strstr(output, "operation=\"search\",le=\"+Inf\"} 1001"));
+  assert_non_null(strstr(output,
+    "yappod_v2_request_latency_seconds{operation=\"search\",quantile=\"0.99\"} 0.006015"));
+  assert_non_null(strstr(output,
+    "yappod_v2_request_latency_seconds_count{operation=\"search\"} 1001"));
+  assert_non_null(strstr(output,
+    "yappod_v2_search_stage_seconds{stage=\"queue_wait\",quantile=\"0.99\"} 0.002047"));
+  assert_non_null(strstr(output, "yappod_v2_search_stage_seconds_count{stage=\"queue_wait\"} 10"));
+  assert_non_null(strstr(output, "yappod_v2_search_stage_seconds_count{stage=\"render\"} 0"));
   assert_non_null(strstr(output, "yappod_v2_manifest_generation 9"));
   assert_non_null(strstr(output, "yappod_v2_manifest_segments 3"));
   assert_non_null(strstr(output, "yappod_v2_manifest_document_records 40"));
@@ -155,6 +220,9 @@ static void test_metrics_are_thread_safe_and_bounded(void **state) {
   assert_non_null(strstr(output, "yappod_v2_ann_candidates_total{result=\"rejected\"} 25"));
   assert_non_null(strstr(output, "yappod_v2_ann_rebuilds_total{result=\"success\"} 4"));
   assert_non_null(strstr(output, "yappod_v2_ann_rebuilds_total{result=\"failure\"} 1"));
+  assert_non_null(strstr(output, "yappod_v2_ann_incremental_updates_total 6"));
+  assert_non_null(strstr(output, "yappod_v2_ann_build_vectors 75"));
+  assert_non_null(strstr(output, "yappod_v2_ann_build_vectors_per_second 150.0"));
   assert_non_null(strstr(output, "yappod_v2_ingest_microbatches_total 5"));
   assert_non_null(strstr(output, "yappod_v2_ingest_requests_total 12"));
   assert_non_null(strstr(output, "yappod_v2_ingest_operations_total 30"));
@@ -164,17 +232,60 @@ static void test_metrics_are_thread_safe_and_bounded(void **state) {
                          "yappod_v2_ingest_generations_saved_total 5"));
   assert_non_null(strstr(output, "yappod_v2_ingest_max_batch_requests 4"));
   assert_non_null(strstr(output, "yappod_v2_ingest_max_batch_operations 9"));
+  assert_non_null(strstr(
+    output, "yappod_v2_ingest_stage_seconds_total{stage=\"parse\"} 0.250000"));
+  assert_non_null(strstr(
+    output, "yappod_v2_ingest_stage_seconds_total{stage=\"publish\"} 1.500000"));
   assert_non_null(strstr(output, "yappod_v2_update_wal_recoveries_total 2"));
+  assert_non_null(strstr(output, "yappod_v2_memtable_operations 13"));
+  assert_non_null(strstr(output, "yappod_v2_memtable_flushes_total 3"));
+  assert_non_null(strstr(output, "yappod_v2_wal_appends_total 6"));
+  assert_non_null(strstr(output, "yappod_v2_wal_fsync_seconds_bucket{le=\"0.0005\"} 0"));
+  assert_non_null(strstr(output, "yappod_v2_wal_fsync_seconds_bucket{le=\"0.001\"} 1"));
+  assert_non_null(strstr(output, "yappod_v2_wal_fsync_seconds_bucket{le=\"+Inf\"} 2"));
+  assert_non_null(strstr(output, "yappod_v2_wal_fsync_seconds_count 2"));
+  assert_non_null(strstr(output, "yappod_v2_search_deadline_expired_total 7"));
+  assert_non_null(strstr(output, "yappod_v2_search_cancelled_total 8"));
+  assert_non_null(strstr(output, "yappod_v2_concurrency_limit{stage=\"front\"} 9"));
+  assert_non_null(strstr(output, "yappod_v2_concurrency_limit{stage=\"core\"} 11"));
+  assert_non_null(strstr(output,
+                         "yappod_v2_concurrency_rtt_noload_seconds{stage=\"core\"} 0.001500"));
+  assert_non_null(strstr(output, "yappod_v2_admission_rejected_total{stage=\"front\"} 3"));
   assert_non_null(strstr(
     output, "yappod_v2_maintenance_foreground_deferrals_total 11"));
   assert_non_null(strstr(output, "yappod_v2_compaction_state{state=\"running\"} 1"));
   assert_int_equal(strlen(output), output_bytes); free(output); YAP_V2_metrics_close(&metrics);
 }
 
+static void test_latency_histogram_quantiles_are_bounded(void **state) {
+  YAP_V2_LATENCY_HISTOGRAM histogram; YAP_V2_LATENCY_SUMMARY summary;
+  static const uint64_t expected[YAP_V2_LATENCY_QUANTILE_COUNT] = {5000U, 9000U, 9900U, 9990U};
+  uint64_t value; size_t quantile; (void)state;
+  assert_int_equal(YAP_V2_latency_histogram_init(&histogram, 0U), YAP_V2_OUT_OF_RANGE);
+  assert_int_equal(YAP_V2_latency_histogram_init(
+                     &histogram, YAP_V2_LATENCY_MAX_PRECISION_BITS + 1U), YAP_V2_OUT_OF_RANGE);
+  assert_int_equal(YAP_V2_latency_histogram_init(&histogram, 7U), YAP_V2_OK);
+  YAP_V2_latency_histogram_summary(&histogram, &summary);
+  assert_int_equal(summary.count, 0U); assert_int_equal(summary.quantiles[3], 0U);
+  for (value = 1U; value <= 10000U; value++) YAP_V2_latency_histogram_record(&histogram, value);
+  YAP_V2_latency_histogram_summary(&histogram, &summary);
+  assert_int_equal(summary.count, 10000U);
+  assert_int_equal(summary.microseconds, 50005000U);
+  for (quantile = 0U; quantile < YAP_V2_LATENCY_QUANTILE_COUNT; quantile++) {
+    assert_true(summary.quantiles[quantile] >= expected[quantile]);
+    assert_true(summary.quantiles[quantile] - expected[quantile] <= expected[quantile] / 128U);
+  }
+  YAP_V2_latency_histogram_record(&histogram, UINT64_MAX);
+  YAP_V2_latency_histogram_summary(&histogram, &summary);
+  assert_int_equal(summary.count, 10001U);
+  YAP_V2_latency_histogram_free(&histogram);
+}
+
 int main(void) {
   const struct CMUnitTest tests[] = {
     cmocka_unit_test(test_probe_json_and_compaction_status),
-    cmocka_unit_test(test_metrics_are_thread_safe_and_bounded)
+    cmocka_unit_test(test_metrics_are_thread_safe_and_bounded),
+    cmocka_unit_test(test_latency_histogram_quantiles_are_bounded)
   };
   return cmocka_run_group_tests(tests, NULL, NULL);
 }
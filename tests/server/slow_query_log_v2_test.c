@@ -0,0 +1,126 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "common/yappo_types_v2.h"
+#include "server/yappo_slow_query_log_v2.h"
+
+#define SECOND 1000000U
+
+static void record(YAP_V2_SLOW_QUERY_LOG *log, uint64_t latency, uint64_t now) {
+  char buffer[64];
+  unsigned admission = YAP_V2_slow_query_log_admit(log, latency, now);
+  int bytes;
+  char *line;
+  if (admission == 0U) return;
+  bytes = snprintf(buffer, sizeof(buffer), "{\"latency_microseconds\":%llu}",
+                   (unsigned long long)latency);
+  assert_true(bytes > 0);
+  line = malloc((size_t)bytes + 1U);
+  assert_non_null(line);
+  memcpy(line, buffer, (size_t)bytes + 1U);
+  YAP_V2_slow_query_log_record(log, admission, latency, now, line, (size_t)bytes);
+}
+
+static char *dump(YAP_V2_SLOW_QUERY_LOG *log, uint64_t now, size_t max_bytes) {
+  char *ndjson = NULL;
+  size_t bytes = 0U;
+  assert_int_equal(YAP_V2_slow_query_log_dump(log, now, max_bytes, &ndjson, &bytes), YAP_V2_OK);
+  assert_non_null(ndjson);
+  assert_int_equal(strlen(ndjson), bytes);
+  return ndjson;
+}
+
+static void test_keeps_slowest_requests_of_interval(void **state) {
+  YAP_V2_SLOW_QUERY_LOG log;
+  char *ndjson;
+  (void)state;
+  assert_int_equal(YAP_V2_slow_query_log_init(&log, 3U, 60U, 0U), YAP_V2_OK);
+  record(&log, 50U, 10U * SECOND);
+  record(&log, 10U, 10U * SECOND);
+  record(&log, 70U, 11U * SECOND);
+  record(&log, 30U, 12U * SECOND);
+  record(&log, 90U, 13U * SECOND);
+  assert_int_equal(YAP_V2_slow_query_log_admit(&log, 40U, 14U * SECOND), 0U);
+  ndjson = dump(&log, 14U * SECOND, 1U << 20);
+  assert_string_equal(ndjson,
+                      "{\"source\":\"current\",\"latency_microseconds\":90}\n"
+                      "{\"source\":\"current\",\"latency_microseconds\":70}\n"
+                      "{\"source\":\"current\",\"latency_microseconds\":50}\n");
+  free(ndjson);
+  YAP_V2_slow_query_log_free(&log);
+}
+
+static void test_rotates_interval_into_previous(void **state) {
+  YAP_V2_SLOW_QUERY_LOG log;
+  char *ndjson;
+  (void)state;
+  assert_int_equal(YAP_V2_slow_query_log_init(&log, 2U, 60U, 0U), YAP_V2_OK);
+  record(&log, 500U, 100U * SECOND);
+  record(&log, 700U, 101U * SECOND);
+  record(&log, 20U, 170U * SECOND);
+  ndjson = dump(&log, 171U * SECOND, 1U << 20);
+  assert_string_equal(ndjson,
+                      "{\"source\":\"previous\",\"latency_microseconds\":700}\n"
+                      "{\"source\":\"previous\",\"latency_microseconds\":500}\n"
+                      "{\"source\":\"current\",\"latency_microseconds\":20}\n");
+  free(ndjson);
+  ndjson = dump(&log, 400U * SECOND, 1U << 20);
+  assert_string_equal(ndjson, "");
+  free(ndjson);
+  YAP_V2_slow_query_log_free(&log);
+}
+
+static void test_samples_ring_and_output_cap(void **state) {
+  YAP_V2_SLOW_QUERY_LOG log;
+  char *ndjson;
+  (void)state;
+  assert_int_equal(YAP_V2_slow_query_log_init(&log, 2U, 60U, 1U), YAP_V2_OK);
+  record(&log, 1U, 10U * SECOND);
+  record(&log, 2U, 10U * SECOND);
+  record(&log, 3U, 10U * SECOND);
+  ndjson = dump(&log, 10U * SECOND, 1U << 20);
+  assert_string_equal(ndjson,
+                      "{\"source\":\"current\",\"latency_microseconds\":3}\n"
+                      "{\"source\":\"current\",\"latency_microseconds\":2}\n"
+                      "{\"source\":\"sample\",\"latency_microseconds\":2}\n"
+                      "{\"source\":\"sample\",\"latency_microseconds\":3}\n");
+  free(ndjson);
+  ndjson = dump(&log, 10U * SECOND, 100U);
+  assert_string_equal(ndjson,
+                      "{\"source\":\"current\",\"latency_microseconds\":3}\n"
+                      "{\"source\":\"current\",\"latency_microseconds\":2}\n");
+  free(ndjson);
+  YAP_V2_slow_query_log_free(&log);
+}
+
+static void test_disabled_log_admits_nothing(void **state) {
+  YAP_V2_SLOW_QUERY_LOG log;
+  char *ndjson;
+  (void)state;
+  assert_int_equal(YAP_V2_slow_query_log_init(&log, 0U, 60U, 1U), YAP_V2_OK);
+  assert_int_equal(YAP_V2_slow_query_log_admit(&log, 1000000U, SECOND), 0U);
+  ndjson = dump(&log, SECOND, 1U << 20);
+  assert_string_equal(ndjson, "");
+  free(ndjson);
+  YAP_V2_slow_query_log_free(&log);
+  assert_int_equal(YAP_V2_slow_query_log_init(&log, YAP_V2_SLOW_QUERY_MAX_ENTRIES + 1U, 60U, 0U),
+                   YAP_V2_INVALID_ARGUMENT);
+  assert_int_equal(YAP_V2_slow_query_log_init(&log, 4U, 0U, 0U), YAP_V2_INVALID_ARGUMENT);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_keeps_slowest_requests_of_interval),
+    cmocka_unit_test(test_rotates_interval_into_previous),
+    cmocka_unit_test(test_samples_ring_and_output_cap),
+    cmocka_unit_test(test_disabled_log_admits_nothing),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
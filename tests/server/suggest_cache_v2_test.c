@@ -0,0 +1,94 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "test_env.h"
+#include "test_fs.h"
+#include "server/yappo_suggest_cache_v2.h"
+
+static YAP_V2_BYTES_VIEW bytes(const char *value) {
+  YAP_V2_BYTES_VIEW view;
+  view.data = (const unsigned char *)value;
+  view.len = strlen(value);
+  return view;
+}
+
+static void open_segment(const ytest_env_t *env, YAP_V2_LEXICAL_SEGMENT *segment) {
+  YAP_V2_DOCUMENT_VIEW documents[2];
+  YAP_V2_COMPONENT_DESCRIPTOR components[3];
+  char directory[PATH_MAX];
+  memset(documents, 0, sizeof(documents));
+  documents[0].id = bytes("doc-0");
+  documents[0].title = bytes("tokyo tower");
+  documents[0].body = bytes("tokyo station toyama");
+  documents[1].id = bytes("doc-1");
+  documents[1].title = bytes("tokyo");
+  documents[1].body = bytes("kyoto tower");
+  assert_int_equal(ytest_path_join(directory, sizeof(directory), env->tmp_root, "segment"), 0);
+  assert_int_equal(ytest_mkdir_p(directory, 0700), 0);
+  assert_int_equal(YAP_V2_lexical_write(directory, 20U, documents, 2U, NULL, 0U, components),
+                   YAP_V2_OK);
+  YAP_V2_lexical_segment_init(segment);
+  assert_int_equal(YAP_V2_lexical_segment_open(directory, 20U, segment), YAP_V2_OK);
+}
+
+static void assert_terms(const YAP_V2_SUGGESTIONS *suggestions, const char *const *terms,
+                         size_t count) {
+  size_t i;
+  assert_int_equal(suggestions->count, count);
+  for (i = 0U; i < count; i++) {
+    assert_int_equal(suggestions->items[i].term_len, strlen(terms[i]));
+    assert_memory_equal(suggestions->items[i].term, terms[i], strlen(terms[i]));
+  }
+}
+
+static void test_cache_answers_every_limit_from_one_slot(void **state) {
+  static const char *const to[] = {"tokyo", "tower", "toyama"};
+  static const char *const k[] = {"kyoto"};
+  ytest_env_t env;
+  YAP_V2_LEXICAL_SEGMENT segment;
+  const YAP_V2_LEXICAL_SEGMENT *segments[1];
+  YAP_V2_SUGGEST_CACHE cache;
+  YAP_V2_SUGGESTIONS suggestions;
+  size_t round;
+  (void)state;
+  assert_int_equal(ytest_env_init(&env), 0);
+  open_segment(&env, &segment);
+  segments[0] = &segment;
+  assert_int_equal(YAP_V2_suggest_cache_init(&cache, segments, 1U, 3U), YAP_V2_INVALID_ARGUMENT);
+  /* One slot makes every new prefix evict the previous one. */
+  assert_int_equal(YAP_V2_suggest_cache_init(&cache, segments, 1U, 1U), YAP_V2_OK);
+  YAP_V2_suggestions_init(&suggestions);
+  for (round = 0U; round < 2U; round++) {
+    assert_int_equal(YAP_V2_suggest_cache_lookup(&cache, bytes("to"), 10U, &suggestions),
+                     YAP_V2_OK);
+    assert_terms(&suggestions, to, 3U);
+    assert_int_equal(suggestions.items[0].document_frequency, 2U);
+    assert_int_equal(YAP_V2_suggest_cache_lookup(&cache, bytes("to"), 1U, &suggestions),
+                     YAP_V2_OK);
+    assert_terms(&suggestions, to, 1U);
+    assert_int_equal(YAP_V2_suggest_cache_lookup(&cache, bytes("k"), 10U, &suggestions),
+                     YAP_V2_OK);
+    assert_terms(&suggestions, k, 1U);
+  }
+  assert_int_equal(YAP_V2_suggest_cache_lookup(&cache, bytes("x"), 10U, &suggestions), YAP_V2_OK);
+  assert_int_equal(suggestions.count, 0U);
+  assert_int_equal(YAP_V2_suggest_cache_lookup(&cache, bytes("to"), 0U, &suggestions),
+                   YAP_V2_INVALID_ARGUMENT);
+  YAP_V2_suggestions_free(&suggestions);
+  YAP_V2_suggest_cache_free(&cache);
+  YAP_V2_lexical_segment_close(&segment);
+  ytest_env_destroy(&env);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_cache_answers_every_limit_from_one_slot),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
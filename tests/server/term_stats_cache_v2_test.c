@@ -0,0 +1,171 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "test_env.h"
+#include "test_fs.h"
+#include "server/yappo_term_stats_cache_v2.h"
+
+static YAP_V2_BYTES_VIEW bytes(const char *value) {
+  YAP_V2_BYTES_VIEW view;
+  view.data = (const unsigned char *)value;
+  view.len = strlen(value);
+  return view;
+}
+
+static void open_segment(const ytest_env_t *env, const char *name,
+                         YAP_V2_LEXICAL_SEGMENT *segment) {
+  YAP_V2_DOCUMENT_VIEW documents[2];
+  YAP_V2_COMPONENT_DESCRIPTOR components[3];
+  char directory[PATH_MAX];
+  memset(documents, 0, sizeof(documents));
+  documents[0].id = bytes("doc-0");
+  documents[0].title = bytes("tokyo tower");
+  documents[0].body = bytes("tokyo station");
+  documents[1].id = bytes("doc-1");
+  documents[1].title = bytes("kyoto");
+  documents[1].body = bytes("kyoto tower");
+  assert_int_equal(ytest_path_join(directory, sizeof(directory), env->tmp_root, name), 0);
+  assert_int_equal(ytest_mkdir_p(directory, 0700), 0);
+  assert_int_equal(YAP_V2_lexical_write(directory, 20U, documents, 2U, NULL, 0U, components),
+                   YAP_V2_OK);
+  YAP_V2_lexical_segment_init(segment);
+  assert_int_equal(YAP_V2_lexical_segment_open(directory, 20U, segment), YAP_V2_OK);
+}
+
+static void bind_plan(const char *query, const YAP_V2_LEXICAL_SEGMENT *const *segments,
+                      const YAP_V2_TERM_STATS_SOURCE *source, YAP_V2_LEXICAL_QUERY_PLAN *plan) {
+  YAP_V2_lexical_query_plan_init(plan);
+  assert_int_equal(YAP_V2_lexical_query_plan_prepare(bytes(query), plan), YAP_V2_OK);
+  assert_int_equal(YAP_V2_lexical_query_plan_bind_cached(plan, segments, 2U, source),
+                   YAP_V2_OK);
+}
+
+static void test_bind_reuses_summed_frequencies(void **state) {
+  ytest_env_t env;
+  YAP_V2_LEXICAL_SEGMENT first, second;
+  const YAP_V2_LEXICAL_SEGMENT *segments[2];
+  YAP_V2_TERM_STATS_CACHE cache;
+  YAP_V2_TERM_STATS_SOURCE source;
+  YAP_V2_LEXICAL_QUERY_PLAN plain, summed, cached;
+  uint64_t frequency[2];
+  const uint64_t planted[2] = {7U, 11U};
+  size_t i;
+  (void)state;
+  assert_int_equal(ytest_env_init(&env), 0);
+  open_segment(&env, "first", &first);
+  open_segment(&env, "second", &second);
+  segments[0] = &first;
+  segments[1] = &second;
+  assert_int_equal(YAP_V2_term_stats_cache_init(&cache, 3U, 2U), YAP_V2_INVALID_ARGUMENT);
+  assert_int_equal(YAP_V2_term_stats_cache_init(&cache, 64U, 0U), YAP_V2_INVALID_ARGUMENT);
+  assert_int_equal(YAP_V2_term_stats_cache_init(&cache, 64U, 2U), YAP_V2_OK);
+  YAP_V2_term_stats_cache_source(&cache, &source);
+  assert_int_equal(source.lookup(source.context, bytes("tokyo"), frequency), YAP_V2_NOT_FOUND);
+
+  /* The first bind sums over both segments and leaves the sums behind. */
+  bind_plan("tokyo tower", segments, NULL, &plain);
+  bind_plan("tokyo tower", segments, &source, &summed);
+  assert_int_equal(summed.term_count, plain.term_count);
+  for (i = 0U; i < summed.term_count; i++) {
+    assert_true(summed.type_frequency[0][i] > 0U);
+    assert_int_equal(summed.type_frequency[0][i], plain.type_frequency[0][i]);
+    assert_int_equal(summed.type_frequency[1][i], plain.type_frequency[1][i]);
+    assert_int_equal(source.lookup(source.context, summed.terms[i], frequency), YAP_V2_OK);
+    assert_int_equal(frequency[0], summed.type_frequency[0][i]);
+    assert_int_equal(frequency[1], summed.type_frequency[1][i]);
+  }
+
+  /* A planted entry proves the next bind takes the cache rather than the segments. */
+  source.store(source.context, bytes("tokyo"), planted);
+  bind_plan("tokyo tower", segments, &source, &cached);
+  for (i = 0U; i < cached.term_count; i++) {
+    if (cached.terms[i].len == 5U && memcmp(cached.terms[i].data, "tokyo", 5U) == 0) {
+      assert_int_equal(cached.type_frequency[0][i], planted[0]);
+      assert_int_equal(cached.type_frequency[1][i], planted[1]);
+    } else {
+      assert_int_equal(cached.type_frequency[0][i], summed.type_frequency[0][i]);
+    }
+  }
+  /* Postings are still looked up in every segment. */
+  assert_int_equal(cached.segment_matched_terms[0], cached.term_count);
+  assert_int_equal(cached.segment_matched_terms[1], cached.term_count);
+
+  YAP_V2_lexical_query_plan_free(&cached);
+  YAP_V2_lexical_query_plan_free(&summed);
+  YAP_V2_lexical_query_plan_free(&plain);
+  YAP_V2_term_stats_cache_free(&cache);
+  YAP_V2_lexical_segment_close(&second);
+  YAP_V2_lexical_segment_close(&first);
+  ytest_env_destroy(&env);
+}
+
+static size_t term_index_of(const YAP_V2_LEXICAL_QUERY_PLAN *plan, const char *term) {
+  size_t i;
+  for (i = 0U; i < plan->term_count; i++)
+    if (plan->terms[i].len == strlen(term) &&
+        memcmp(plan->terms[i].data, term, plan->terms[i].len) == 0)
+      return i;
+  return plan->term_count;
+}
+
+static void test_bind_covers_leading_segments_and_skips_absent_terms(void **state) {
+  ytest_env_t env;
+  YAP_V2_LEXICAL_SEGMENT base, delta;
+  const YAP_V2_LEXICAL_SEGMENT *segments[2];
+  YAP_V2_TERM_STATS_CACHE cache;
+  YAP_V2_TERM_STATS_SOURCE source;
+  YAP_V2_LEXICAL_QUERY_PLAN plain, summed, cached;
+  uint64_t frequency[2];
+  const uint64_t absent[2] = {0U, 0U};
+  size_t kyoto, tokyo;
+  (void)state;
+  assert_int_equal(ytest_env_init(&env), 0);
+  open_segment(&env, "base", &base);
+  open_segment(&env, "delta", &delta);
+  segments[0] = &base;
+  segments[1] = &delta;
+  /* Like a published segment followed by a memtable delta: only the first is cached. */
+  assert_int_equal(YAP_V2_term_stats_cache_init(&cache, 64U, 1U), YAP_V2_OK);
+  YAP_V2_term_stats_cache_source(&cache, &source);
+
+  bind_plan("kyoto tokyo", segments, NULL, &plain);
+  bind_plan("kyoto tokyo", segments, &source, &summed);
+  kyoto = term_index_of(&plain, "kyoto");
+  tokyo = term_index_of(&plain, "tokyo");
+  assert_true(kyoto < plain.term_count && tokyo < plain.term_count);
+  assert_int_equal(summed.type_frequency[0][kyoto], plain.type_frequency[0][kyoto]);
+  /* Both segments hold the same documents, so the stored sum is half of the total. */
+  assert_int_equal(source.lookup(source.context, bytes("kyoto"), frequency), YAP_V2_OK);
+  assert_int_equal(frequency[0] * 2U, plain.type_frequency[0][kyoto]);
+  assert_int_equal(frequency[1] * 2U, plain.type_frequency[1][kyoto]);
+
+  /* A term cached as absent is not probed in the covered segment, but the delta still is. */
+  source.store(source.context, bytes("tokyo"), absent);
+  bind_plan("kyoto tokyo", segments, &source, &cached);
+  assert_int_equal(cached.type_frequency[0][tokyo] * 2U, plain.type_frequency[0][tokyo]);
+  assert_int_equal(cached.type_frequency[0][kyoto], plain.type_frequency[0][kyoto]);
+  assert_int_equal(cached.segment_matched_terms[0], cached.term_count - 1U);
+  assert_int_equal(cached.segment_matched_terms[1], cached.term_count);
+
+  YAP_V2_lexical_query_plan_free(&cached);
+  YAP_V2_lexical_query_plan_free(&summed);
+  YAP_V2_lexical_query_plan_free(&plain);
+  YAP_V2_term_stats_cache_free(&cache);
+  YAP_V2_lexical_segment_close(&delta);
+  YAP_V2_lexical_segment_close(&base);
+  ytest_env_destroy(&env);
+}
+
+int main(void) {
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_bind_reuses_summed_frequencies),
+    cmocka_unit_test(test_bind_covers_leading_segments_and_skips_absent_terms),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}